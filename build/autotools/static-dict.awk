@@ -0,0 +1,54 @@
+# Generates the data of a StaticDict from a .dict file.
+#
+# A .dict file contains one word per line, grouped into sections which are
+# started by a "[section]" line. Blank lines and lines starting with "#" are
+# ignored.
+#
+#   awk -v mode=records -f static-dict.awk foo.dict | LC_ALL=C sort -u | \
+#     awk -v mode=c -v name=foo_dict_data -f static-dict.awk > foo-dict.h
+#
+# The first pass writes one "section<TAB>word" line per word, the second
+# turns the sorted lines into a C string literal.
+#
+# Author: Christian Hergert <chergert@redhat.com>
+
+BEGIN {
+	FS = "\t"
+	if (mode == "c") {
+		print "/* Generated by static-dict.awk, do not edit. */"
+		print ""
+		print "static const char " name "[] ="
+	}
+}
+
+mode == "records" && /^[ \t]*(#|$)/ {
+	next
+}
+
+mode == "records" && /^\[.*\]$/ {
+	section = substr($0, 2, length($0) - 2)
+	next
+}
+
+mode == "records" {
+	word = $0
+	gsub(/^[ \t]+|[ \t]+$/, "", word)
+	if (section == "") {
+		printf "%s:%d: word outside of a section\n", FILENAME, FNR > "/dev/stderr"
+		exit 1
+	}
+	if (section ~ /[\t"\\]/ || word ~ /[\t"\\]/) {
+		printf "%s:%d: invalid character\n", FILENAME, FNR > "/dev/stderr"
+		exit 1
+	}
+	print section "\t" word
+}
+
+mode == "c" {
+	printf "  \"%s\\t%s\\0\"\n", $1, $2
+}
+
+END {
+	if (mode == "c")
+		print "  \"\";"
+}
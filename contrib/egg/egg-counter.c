@@ -41,7 +41,7 @@ G_DEFINE_BOXED_TYPE (EggCounterArena, egg_counter_arena, egg_counter_arena_ref,
 
 #define MAX_COUNTERS       2000
 #define NAME_FORMAT        "/EggCounters-%u"
-#define MAGIC              0x71167125
+#define MAGIC              0x71167126
 #define COUNTER_MAX_SHM    (1024 * 1024 * 4)
 #define COUNTERS_PER_GROUP 8
 #define DATA_CELL_SIZE     64
@@ -54,11 +54,14 @@ G_DEFINE_BOXED_TYPE (EggCounterArena, egg_counter_arena, egg_counter_arena_ref,
 
 typedef struct
 {
-  guint cell : 29;       /* Counter groups starting cell */
-  guint position : 3;    /* Index within counter group */
-  gchar category[20];    /* Counter category name. */
-  gchar name[32];        /* Counter name. */
-  gchar description[72]; /* Counter description */
+  guint  cell : 29;       /* Counter groups starting cell */
+  guint  position : 3;    /* Index within counter group */
+  gchar  category[20];    /* Counter category name. */
+  gchar  name[32];        /* Counter name. */
+  gchar  description[64]; /* Counter description */
+  guint8 bucket;          /* Index of the histogram bucket */
+  guint8 n_buckets;       /* Number of histogram buckets, or 0 for counters */
+  guint8 padding[6];
 } CounterInfo __attribute__((aligned (DATA_CELL_SIZE)));
 
 G_STATIC_ASSERT (sizeof (CounterInfo) == 128);
@@ -100,6 +103,7 @@ struct _EggCounterArena
   GPid      pid;
   guint     n_counters;
   GList    *counters;
+  GList    *histograms;
 };
 
 G_LOCK_DEFINE_STATIC (reglock);
@@ -142,6 +146,97 @@ egg_counter_reset (EggCounter *counter)
   EGG_MEMORY_BARRIER;
 }
 
+/**
+ * egg_histogram_get:
+ * @histogram: An #EggHistogram
+ * @counts: (out caller-allocates): location for the bucket counts
+ *
+ * Reads the number of values recorded in each bucket of @histogram.
+ */
+void
+egg_histogram_get (EggHistogram *histogram,
+                   guint64       counts[EGG_HISTOGRAM_N_BUCKETS])
+{
+  guint i;
+
+  g_return_if_fail (histogram != NULL);
+  g_return_if_fail (counts != NULL);
+
+  for (i = 0; i < EGG_HISTOGRAM_N_BUCKETS; i++)
+    counts [i] = (guint64)egg_counter_get (&histogram->buckets [i]);
+}
+
+void
+egg_histogram_reset (EggHistogram *histogram)
+{
+  guint i;
+
+  g_return_if_fail (histogram != NULL);
+
+  for (i = 0; i < EGG_HISTOGRAM_N_BUCKETS; i++)
+    egg_counter_reset (&histogram->buckets [i]);
+}
+
+/**
+ * egg_histogram_get_bucket_limit:
+ * @bucket: the index of a bucket
+ *
+ * Gets the largest value that is recorded into @bucket.
+ *
+ * Returns: the inclusive upper bound of @bucket.
+ */
+gint64
+egg_histogram_get_bucket_limit (guint bucket)
+{
+  g_return_val_if_fail (bucket < EGG_HISTOGRAM_N_BUCKETS, G_MAXINT64);
+
+  if (bucket == EGG_HISTOGRAM_N_BUCKETS - 1)
+    return G_MAXINT64;
+
+  return (G_GINT64_CONSTANT (1) << bucket) - 1;
+}
+
+/**
+ * egg_histogram_percentile:
+ * @counts: the bucket counts from egg_histogram_get()
+ * @percentile: the percentile, between 0.0 and 1.0
+ *
+ * Finds the bucket containing @percentile of the recorded values and
+ * returns its upper bound. Since buckets are log2 sized, the result may be
+ * up to twice the real value.
+ *
+ * Returns: the upper bound for @percentile, or -1 if @counts is empty.
+ */
+gint64
+egg_histogram_percentile (const guint64 *counts,
+                          gdouble        percentile)
+{
+  guint64 total = 0;
+  guint64 seen = 0;
+  guint64 wanted;
+  guint i;
+
+  g_return_val_if_fail (counts != NULL, -1);
+
+  for (i = 0; i < EGG_HISTOGRAM_N_BUCKETS; i++)
+    total += counts [i];
+
+  if (total == 0)
+    return -1;
+
+  wanted = MAX (1, (guint64)(CLAMP (percentile, 0.0, 1.0) * total + 0.5));
+
+  for (i = 0; i < EGG_HISTOGRAM_N_BUCKETS; i++)
+    {
+      seen += counts [i];
+
+      if (seen >= wanted)
+        break;
+    }
+
+  return egg_histogram_get_bucket_limit (MIN (i, EGG_HISTOGRAM_N_BUCKETS - 1));
+}
+
 static void
 _egg_counter_arena_atexit (void)
 {
@@ -180,8 +275,16 @@ _egg_counter_arena_init_local (EggCounterArena *arena)
    * We have some very tricky work ahead of us to add unlimited numbers
    * of counters at runtime. We basically need to avoid placing counters
    * that could overlap a page.
+   *
+   * Until then, reserve enough room for MAX_COUNTERS. Each histogram uses
+   * a counter per bucket, so a handful of pages is not enough. Pages we
+   * never touch are not backed by memory, so this is cheap.
    */
-  size = page_size * 4;
+  size = DATA_CELL_SIZE *
+         (CELLS_PER_HEADER +
+          ((MAX_COUNTERS / COUNTERS_PER_GROUP) * CELLS_PER_GROUP (g_get_num_processors ())));
+  size = MIN (size, COUNTER_MAX_SHM);
+  size = (size + page_size - 1) / page_size * page_size;
 
   arena->ref_count = 1;
   arena->is_local_arena = TRUE;
@@ -340,6 +443,37 @@ _egg_counter_arena_init_remote (EggCounterArena *arena,
 
       info = &(((CounterInfo *)&arena->cells[group_start_cell])[position]);
 
+      if (info->n_buckets != 0)
+        {
+          EggHistogram *histogram;
+
+          /* Buckets are registered in order, starting a new histogram at 0 */
+          if (info->n_buckets != EGG_HISTOGRAM_N_BUCKETS ||
+              info->bucket >= EGG_HISTOGRAM_N_BUCKETS ||
+              (info->bucket != 0 && arena->histograms == NULL) ||
+              (info->bucket != 0 &&
+               ((EggHistogram *)arena->histograms->data)->buckets [info->bucket - 1].values == NULL))
+            goto failure;
+
+          if (info->bucket == 0)
+            {
+              histogram = g_new0 (EggHistogram, 1);
+              histogram->category = g_strndup (info->category, sizeof info->category);
+              histogram->name = g_strndup (info->name, sizeof info->name);
+              histogram->description = g_strndup (info->description, sizeof info->description);
+              arena->histograms = g_list_prepend (arena->histograms, histogram);
+            }
+
+          histogram = arena->histograms->data;
+          counter = &histogram->buckets [info->bucket];
+          counter->category = histogram->category;
+          counter->name = histogram->name;
+          counter->description = histogram->description;
+          counter->values = (EggCounterValue *)&arena->cells [info->cell].values[info->position];
+
+          continue;
+        }
+
       counter = g_new0 (EggCounter, 1);
       counter->category = g_strndup (info->category, sizeof info->category);
       counter->name = g_strndup (info->name, sizeof info->name);
@@ -355,6 +489,14 @@ _egg_counter_arena_init_remote (EggCounterArena *arena,
       arena->counters = g_list_prepend (arena->counters, counter);
     }
 
+  /* Drop a histogram we caught in the middle of registration */
+  if (arena->histograms != NULL &&
+      ((EggHistogram *)arena->histograms->data)->buckets [EGG_HISTOGRAM_N_BUCKETS - 1].values == NULL)
+    {
+      g_free (arena->histograms->data);
+      arena->histograms = g_list_delete_link (arena->histograms, arena->histograms);
+    }
+
   close (fd);
 
   return TRUE;
@@ -362,6 +504,8 @@ _egg_counter_arena_init_remote (EggCounterArena *arena,
 failure:
   close (fd);
 
+  g_list_free_full (g_steal_pointer (&arena->histograms), g_free);
+
   if ((mem != NULL) && (mem != MAP_FAILED))
     munmap (mem, header.size);
 
@@ -396,6 +540,11 @@ _egg_counter_arena_destroy (EggCounterArena *arena)
 
   g_clear_pointer (&arena->counters, g_list_free);
 
+  if (arena->is_local_arena)
+    g_clear_pointer (&arena->histograms, g_list_free);
+  else
+    g_list_free_full (g_steal_pointer (&arena->histograms), g_free);
+
   arena->cells = NULL;
 
   if (arena->arena_is_malloced)
@@ -460,9 +609,44 @@ egg_counter_arena_foreach (EggCounterArena       *arena,
     func (iter->data, user_data);
 }
 
+/**
+ * egg_counter_arena_foreach_histogram:
+ * @arena: An #EggCounterArena
+ * @func: (scope call): A callback to execute
+ * @user_data: user data for @func
+ *
+ * Calls @func for every histogram found in @area.
+ */
 void
-egg_counter_arena_register (EggCounterArena *arena,
-                            EggCounter      *counter)
+egg_counter_arena_foreach_histogram (EggCounterArena         *arena,
+                                     EggHistogramForeachFunc  func,
+                                     gpointer                 user_data)
+{
+  GList *iter;
+
+  g_return_if_fail (arena != NULL);
+  g_return_if_fail (func != NULL);
+
+  for (iter = arena->histograms; iter; iter = iter->next)
+    func (iter->data, user_data);
+}
+
+static gboolean
+_egg_counter_arena_has_room_locked (EggCounterArena *arena,
+                                    guint            n_counters)
+{
+  guint last = arena->n_counters + n_counters - 1;
+  guint group = last / COUNTERS_PER_GROUP;
+  guint ncpu = g_get_num_processors ();
+
+  return CELLS_PER_HEADER + (CELLS_PER_GROUP (ncpu) * (group + 1)) <= arena->n_cells;
+}
+
+static gboolean
+_egg_counter_arena_register_locked (EggCounterArena *arena,
+                                    EggCounter      *counter,
+                                    guint            bucket,
+                                    guint            n_buckets)
 {
   CounterInfo *info;
   guint group;
@@ -470,19 +654,8 @@ egg_counter_arena_register (EggCounterArena *arena,
   guint position;
   guint group_start_cell;
 
-  g_return_if_fail (arena != NULL);
-  g_return_if_fail (counter != NULL);
-
-  if (!arena->is_local_arena)
-    {
-      g_warning ("Cannot add counters to a remote arena.");
-      return;
-    }
-
   ncpu = g_get_num_processors ();
 
-  G_LOCK (reglock);
-
   /*
    * Get the counter group and position within the group of the counter.
    */
@@ -496,7 +669,9 @@ egg_counter_arena_register (EggCounterArena *arena,
   info = &((CounterInfo *)&arena->cells [group_start_cell])[position];
 
   g_assert (position < COUNTERS_PER_GROUP);
-  g_assert (group_start_cell < arena->n_cells);
+
+  if (group_start_cell + CELLS_PER_GROUP (ncpu) > arena->n_cells)
+    return FALSE;
 
   /*
    * Store information about the counter in the SHM area. Also, update
@@ -504,6 +679,8 @@ egg_counter_arena_register (EggCounterArena *arena,
    */
   info->cell = group_start_cell + (COUNTERS_PER_GROUP * CELLS_PER_INFO);
   info->position = position;
+  info->bucket = bucket;
+  info->n_buckets = n_buckets;
   g_snprintf (info->category, sizeof info->category, "%s", counter->category);
   g_snprintf (info->description, sizeof info->description, "%s", counter->description);
   g_snprintf (info->name, sizeof info->name, "%s", counter->name);
@@ -514,10 +691,6 @@ egg_counter_arena_register (EggCounterArena *arena,
            info->cell, info->position, info->category, info->name);
 #endif
 
-  /*
-   * Track the counter address, so we can _foreach() them.
-   */
-  arena->counters = g_list_append (arena->counters, counter);
   arena->n_counters++;
 
   /*
@@ -526,6 +699,86 @@ egg_counter_arena_register (EggCounterArena *arena,
   EGG_MEMORY_BARRIER;
   ((ShmHeader *)&arena->cells[0])->n_counters++;
 
+  return TRUE;
+}
+
+void
+egg_counter_arena_register (EggCounterArena *arena,
+                            EggCounter      *counter)
+{
+  g_return_if_fail (arena != NULL);
+  g_return_if_fail (counter != NULL);
+
+  if (!arena->is_local_arena)
+    {
+      g_warning ("Cannot add counters to a remote arena.");
+      return;
+    }
+
+  G_LOCK (reglock);
+
+  if (!_egg_counter_arena_register_locked (arena, counter, 0, 0))
+    {
+      g_warning ("No room left for counter %s.%s", counter->category, counter->name);
+      counter->values = g_malloc0 (sizeof (EggCounterValue) * g_get_num_processors ());
+    }
+  else
+    {
+      /*
+       * Track the counter address, so we can _foreach() them.
+       */
+      arena->counters = g_list_append (arena->counters, counter);
+    }
+
+  G_UNLOCK (reglock);
+}
+
+void
+egg_counter_arena_register_histogram (EggCounterArena *arena,
+                                      EggHistogram    *histogram)
+{
+  guint i;
+
+  g_return_if_fail (arena != NULL);
+  g_return_if_fail (histogram != NULL);
+
+  if (!arena->is_local_arena)
+    {
+      g_warning ("Cannot add histograms to a remote arena.");
+      return;
+    }
+
+  G_LOCK (reglock);
+
+  /*
+   * Readers expect every bucket of a histogram to be in the arena, so only
+   * register it if all of them fit.
+   */
+  if (!_egg_counter_arena_has_room_locked (arena, EGG_HISTOGRAM_N_BUCKETS))
+    {
+      g_warning ("No room left for histogram %s.%s", histogram->category, histogram->name);
+
+      for (i = 0; i < EGG_HISTOGRAM_N_BUCKETS; i++)
+        histogram->buckets [i].values = g_malloc0 (sizeof (EggCounterValue) * g_get_num_processors ());
+
+      G_UNLOCK (reglock);
+
+      return;
+    }
+
+  for (i = 0; i < EGG_HISTOGRAM_N_BUCKETS; i++)
+    {
+      EggCounter *counter = &histogram->buckets [i];
+
+      counter->category = histogram->category;
+      counter->name = histogram->name;
+      counter->description = histogram->description;
+
+      _egg_counter_arena_register_locked (arena, counter, i, EGG_HISTOGRAM_N_BUCKETS);
+    }
+
+  arena->histograms = g_list_append (arena->histograms, histogram);
+
   G_UNLOCK (reglock);
 }
 
@@ -58,6 +58,25 @@
  *   EGG_COUNTER_INC (Symbol);
  *
  *
+ * Using EggHistogram
+ * ==================
+ *
+ * For durations, a sum is rarely what you want. EggHistogram keeps a
+ * distribution of values in log2 sized buckets instead, so that an external
+ * program can compute percentiles. Each bucket is a regular counter in the
+ * arena, so recording a value costs about the same as EGG_COUNTER_INC.
+ *
+ *   EGG_DEFINE_HISTOGRAM (Symbol, "Category", "Name", "Description")
+ *
+ * Values are expected to be in microseconds, but any non-negative integer
+ * works. Bucket N contains the values which need N bits to be represented,
+ * with the last bucket containing everything larger.
+ *
+ *   gint64 begin = g_get_monotonic_time ();
+ *   ...
+ *   EGG_HISTOGRAM_RECORD_SINCE (Symbol, begin);
+ *
+ *
  * Architecture Support
  * ====================
  *
@@ -118,6 +137,10 @@
  *
  *  [8 CounterInfo Structs (128-bytes each)][N_CPU Data Zones (64-byte each)]
  *
+ * Histogram buckets are stored as consecutive counters. Their CounterInfo
+ * contains the bucket index and the number of buckets so that readers can
+ * put the histogram back together.
+ *
  * See egg-counter.c for more information on the contents of these structures.
  *
  *
@@ -186,6 +209,26 @@ G_BEGIN_DECLS
    egg_counter_arena_register (egg_counter_arena_get_default(), &Identifier##_ctr); \
  }
 
+/**
+ * EGG_DEFINE_HISTOGRAM:
+ * @Identifier: The symbol name of the histogram
+ * @Category: A string category for the histogram.
+ * @Name: A string name for the histogram.
+ * @Description: A string description for the histogram.
+ *
+ * |[<!-- language="C" -->
+ * EGG_DEFINE_HISTOGRAM (my_latency, "My", "Latency", "My operation latency");
+ * ]|
+ */
+#define EGG_DEFINE_HISTOGRAM(Identifier, Category, Name, Description)                       \
+ static EggHistogram Identifier##_hist = { Category, Name, Description };                  \
+ static void Identifier##_hist_init (void) __attribute__((constructor));                   \
+ static void                                                                              \
+ Identifier##_hist_init (void)                                                            \
+ {                                                                                        \
+   egg_counter_arena_register_histogram (egg_counter_arena_get_default(), &Identifier##_hist); \
+ }
+
 /**
  * EGG_COUNTER_INC:
  * @Identifier: The identifier of the counter.
@@ -241,9 +284,45 @@ G_BEGIN_DECLS
   } G_STMT_END
 #endif
 
+/**
+ * EGG_HISTOGRAM_RECORD:
+ * @Identifier: The identifier of the histogram.
+ * @Value: the value to record, usually in microseconds.
+ *
+ * Adds @Value to the distribution of @Identifier. Like EGG_COUNTER_ADD(),
+ * this favors speed over full correctness.
+ */
+#ifdef EGG_COUNTER_REQUIRES_ATOMIC
+# define EGG_HISTOGRAM_RECORD(Identifier, Value)                                     \
+  G_STMT_START {                                                                    \
+    guint _bucket = egg_histogram_get_bucket ((gint64)(Value));                     \
+    __sync_add_and_fetch ((gint64 *)&Identifier##_hist.buckets[_bucket].values[0], \
+                          G_GINT64_CONSTANT(1));                                    \
+  } G_STMT_END
+#else
+# define EGG_HISTOGRAM_RECORD(Identifier, Value)                                     \
+  G_STMT_START {                                                                    \
+    guint _bucket = egg_histogram_get_bucket ((gint64)(Value));                     \
+    Identifier##_hist.buckets[_bucket].values[egg_get_current_cpu()].value++;       \
+  } G_STMT_END
+#endif
+
+/**
+ * EGG_HISTOGRAM_RECORD_SINCE:
+ * @Identifier: The identifier of the histogram.
+ * @Begin: a time from g_get_monotonic_time().
+ *
+ * Records the number of microseconds elapsed since @Begin.
+ */
+#define EGG_HISTOGRAM_RECORD_SINCE(Identifier, Begin) \
+  EGG_HISTOGRAM_RECORD(Identifier, g_get_monotonic_time () - (Begin))
+
+#define EGG_HISTOGRAM_N_BUCKETS 24
+
 typedef struct _EggCounter      EggCounter;
 typedef struct _EggCounterArena EggCounterArena;
 typedef struct _EggCounterValue EggCounterValue;
+typedef struct _EggHistogram    EggHistogram;
 
 /**
  * EggCounterForeachFunc:
@@ -255,6 +334,17 @@ typedef struct _EggCounterValue EggCounterValue;
 typedef void (*EggCounterForeachFunc) (EggCounter *counter,
                                        gpointer    user_data);
 
+/**
+ * EggHistogramForeachFunc:
+ * @histogram: the histogram.
+ * @user_data: data supplied to egg_counter_arena_foreach_histogram().
+ *
+ * Function prototype for callbacks provided to
+ * egg_counter_arena_foreach_histogram().
+ */
+typedef void (*EggHistogramForeachFunc) (EggHistogram *histogram,
+                                         gpointer      user_data);
+
 struct _EggCounter
 {
   /*< Private >*/
@@ -270,6 +360,27 @@ struct _EggCounterValue
   gint64          padding [7];
 } __attribute__ ((aligned(8)));
 
+struct _EggHistogram
+{
+  const gchar *category;
+  const gchar *name;
+  const gchar *description;
+  /*< Private >*/
+  EggCounter   buckets [EGG_HISTOGRAM_N_BUCKETS];
+};
+
+static inline guint
+egg_histogram_get_bucket (gint64 value)
+{
+  if (value <= 0)
+    return 0;
+
+  if (value >= (G_GINT64_CONSTANT (1) << (EGG_HISTOGRAM_N_BUCKETS - 2)))
+    return EGG_HISTOGRAM_N_BUCKETS - 1;
+
+  return g_bit_storage ((gulong)value);
+}
+
 GType            egg_counter_arena_get_type     (void);
 guint            egg_get_current_cpu_call       (void);
 EggCounterArena *egg_counter_arena_get_default  (void);
@@ -281,8 +392,21 @@ void             egg_counter_arena_register     (EggCounterArena       *arena,
 void             egg_counter_arena_foreach      (EggCounterArena       *arena,
                                                  EggCounterForeachFunc  func,
                                                  gpointer               user_data);
+void             egg_counter_arena_register_histogram
+                                                (EggCounterArena       *arena,
+                                                 EggHistogram          *histogram);
+void             egg_counter_arena_foreach_histogram
+                                                (EggCounterArena       *arena,
+                                                 EggHistogramForeachFunc func,
+                                                 gpointer               user_data);
 void             egg_counter_reset              (EggCounter            *counter);
 gint64           egg_counter_get                (EggCounter            *counter);
+void             egg_histogram_get              (EggHistogram          *histogram,
+                                                 guint64                counts[EGG_HISTOGRAM_N_BUCKETS]);
+void             egg_histogram_reset            (EggHistogram          *histogram);
+gint64           egg_histogram_get_bucket_limit (guint                  bucket);
+gint64           egg_histogram_percentile       (const guint64         *counts,
+                                                 gdouble                percentile);
 
 G_END_DECLS
 
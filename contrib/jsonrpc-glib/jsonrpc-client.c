@@ -47,6 +47,18 @@
  * For synchronous calls, #JsonrpcClient will use the thread-default
  * #GMainContext. If you have special needs here ensure you've set the context
  * before calling into any #JsonrpcClient API.
+ *
+ * When both peers are built upon #JsonrpcClient, one side may set the
+ * #JsonrpcClient:use-gvariant property to encode messages as #GVariant
+ * instead of JSON text. The peer switches to #GVariant encoding for its
+ * own messages as soon as it receives the first #GVariant message. This
+ * must never be enabled when talking to third-party JSON-RPC peers.
+ *
+ * Consumers that use jsonrpc_client_call_variant_async(),
+ * jsonrpc_client_reply_variant_async() and the "-variant" signals
+ * exchange #GVariant messages with such peers without ever converting
+ * them to JSON. The #JsonNode API keeps working with either kind of
+ * peer, converting at the API boundary when necessary.
  */
 
 #include <glib.h>
@@ -122,6 +134,12 @@ typedef struct
    * circuit on future operations sooner.
    */
   guint failed : 1;
+
+  /*
+   * If we should encode messages as GVariant. This is set either by the
+   * consumer or automatically when the peer sends us a GVariant message.
+   */
+  guint use_gvariant : 1;
 } JsonrpcClientPrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE (JsonrpcClient, jsonrpc_client, G_TYPE_OBJECT)
@@ -129,12 +147,15 @@ G_DEFINE_TYPE_WITH_PRIVATE (JsonrpcClient, jsonrpc_client, G_TYPE_OBJECT)
 enum {
   PROP_0,
   PROP_IO_STREAM,
+  PROP_USE_GVARIANT,
   N_PROPS
 };
 
 enum {
   HANDLE_CALL,
+  HANDLE_CALL_VARIANT,
   NOTIFICATION,
+  NOTIFICATION_VARIANT,
   N_SIGNALS
 };
 
@@ -288,6 +309,79 @@ unwrap_jsonrpc_error (JsonNode  *node,
   return FALSE;
 }
 
+/*
+ * Looks up an integer field of a #GVariant message. Messages converted from
+ * JSON use "x", but be relaxed about the integer type the peer chose.
+ */
+static gboolean
+variant_lookup_int (GVariant    *dict,
+                    const gchar *key,
+                    gint64      *value)
+{
+  g_autoptr(GVariant) child = NULL;
+
+  g_assert (dict != NULL);
+  g_assert (key != NULL);
+  g_assert (value != NULL);
+
+  if (NULL == (child = g_variant_lookup_value (dict, key, NULL)))
+    return FALSE;
+
+  if (g_variant_is_of_type (child, G_VARIANT_TYPE_INT64))
+    *value = g_variant_get_int64 (child);
+  else if (g_variant_is_of_type (child, G_VARIANT_TYPE_INT32))
+    *value = g_variant_get_int32 (child);
+  else if (g_variant_is_of_type (child, G_VARIANT_TYPE_UINT32))
+    *value = g_variant_get_uint32 (child);
+  else
+    return FALSE;
+
+  return TRUE;
+}
+
+/*
+ * Completes an inflight invocation with the "result" field of the reply,
+ * which is @node for JSON peers and @variant for GVariant peers. It is only
+ * converted when the caller used the API of the other representation.
+ */
+static void
+jsonrpc_client_return_result (GTask    *task,
+                              JsonNode *node,
+                              GVariant *variant)
+{
+  g_assert (G_IS_TASK (task));
+  g_assert (node != NULL || variant != NULL);
+
+  if (g_task_get_source_tag (task) == jsonrpc_client_call_variant_async)
+    {
+      g_autoptr(GError) error = NULL;
+      GVariant *ret;
+
+      if (variant != NULL)
+        ret = g_variant_ref (variant);
+      else if (NULL != (ret = json_gvariant_deserialize (node, NULL, &error)))
+        g_variant_take_ref (ret);
+      else
+        {
+          g_task_return_error (task, g_steal_pointer (&error));
+          return;
+        }
+
+      g_task_return_pointer (task, ret, (GDestroyNotify)g_variant_unref);
+    }
+  else
+    {
+      JsonNode *ret;
+
+      if (node != NULL)
+        ret = json_node_copy (node);
+      else
+        ret = json_gvariant_serialize (variant);
+
+      g_task_return_pointer (task, ret, (GDestroyNotify)json_node_unref);
+    }
+}
+
 /*
  * jsonrpc_client_panic:
  *
@@ -382,6 +476,8 @@ jsonrpc_client_constructed (GObject *object)
 
   priv->input_stream = jsonrpc_input_stream_new (input_stream);
   priv->output_stream = jsonrpc_output_stream_new (output_stream);
+
+  jsonrpc_output_stream_set_use_gvariant (priv->output_stream, priv->use_gvariant);
 }
 
 static void
@@ -400,6 +496,25 @@ jsonrpc_client_finalize (GObject *object)
   G_OBJECT_CLASS (jsonrpc_client_parent_class)->finalize (object);
 }
 
+static void
+jsonrpc_client_get_property (GObject    *object,
+                             guint       prop_id,
+                             GValue     *value,
+                             GParamSpec *pspec)
+{
+  JsonrpcClient *self = JSONRPC_CLIENT (object);
+
+  switch (prop_id)
+    {
+    case PROP_USE_GVARIANT:
+      g_value_set_boolean (value, jsonrpc_client_get_use_gvariant (self));
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
 static void
 jsonrpc_client_set_property (GObject      *object,
                              guint         prop_id,
@@ -415,6 +530,10 @@ jsonrpc_client_set_property (GObject      *object,
       priv->io_stream = g_value_dup_object (value);
       break;
 
+    case PROP_USE_GVARIANT:
+      jsonrpc_client_set_use_gvariant (self, g_value_get_boolean (value));
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     }
@@ -427,6 +546,7 @@ jsonrpc_client_class_init (JsonrpcClientClass *klass)
 
   object_class->constructed = jsonrpc_client_constructed;
   object_class->finalize = jsonrpc_client_finalize;
+  object_class->get_property = jsonrpc_client_get_property;
   object_class->set_property = jsonrpc_client_set_property;
 
   properties [PROP_IO_STREAM] =
@@ -436,6 +556,13 @@ jsonrpc_client_class_init (JsonrpcClientClass *klass)
                          G_TYPE_IO_STREAM,
                          (G_PARAM_WRITABLE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS));
 
+  properties [PROP_USE_GVARIANT] =
+    g_param_spec_boolean ("use-gvariant",
+                          "Use GVariant",
+                          "If messages should be encoded as GVariant instead of JSON",
+                          FALSE,
+                          (G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS));
+
   g_object_class_install_properties (object_class, N_PROPS, properties);
 
   /**
@@ -466,6 +593,33 @@ jsonrpc_client_class_init (JsonrpcClientClass *klass)
                   JSON_TYPE_NODE,
                   JSON_TYPE_NODE);
 
+  /**
+   * JsonrpcClient::handle-call-variant:
+   * @self: A #JsonrpcClient
+   * @method: the method name
+   * @id: The "id" field of the JSONRPC message
+   * @params: The "params" field of the JSONRPC message
+   *
+   * This signal is like #JsonrpcClient::handle-call but is emitted for
+   * messages from peers that use #GVariant encoding, before they are
+   * converted to JSON. Only if no handler returns %TRUE is the message
+   * converted and #JsonrpcClient::handle-call emitted.
+   *
+   * If you handle the message, reply to the peer using
+   * jsonrpc_client_reply_variant_async().
+   */
+  signals [HANDLE_CALL_VARIANT] =
+    g_signal_new ("handle-call-variant",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  G_STRUCT_OFFSET (JsonrpcClientClass, handle_call_variant),
+                  g_signal_accumulator_true_handled, NULL, NULL,
+                  G_TYPE_BOOLEAN,
+                  3,
+                  G_TYPE_STRING | G_SIGNAL_TYPE_STATIC_SCOPE,
+                  G_TYPE_VARIANT,
+                  G_TYPE_VARIANT);
+
   /**
    * JsonrpcClient::notification:
    * @self: A #JsonrpcClient
@@ -487,6 +641,28 @@ jsonrpc_client_class_init (JsonrpcClientClass *klass)
                   2,
                   G_TYPE_STRING | G_SIGNAL_TYPE_STATIC_SCOPE,
                   JSON_TYPE_NODE);
+
+  /**
+   * JsonrpcClient::notification-variant:
+   * @self: A #JsonrpcClient
+   * @method: the method name of the notification
+   * @params: params for the notification
+   *
+   * This signal is like #JsonrpcClient::notification but is emitted for
+   * messages from peers that use #GVariant encoding. Return %TRUE if you
+   * have handled the notification, otherwise it is converted to JSON and
+   * #JsonrpcClient::notification is emitted.
+   */
+  signals [NOTIFICATION_VARIANT] =
+    g_signal_new ("notification-variant",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  G_STRUCT_OFFSET (JsonrpcClientClass, notification_variant),
+                  g_signal_accumulator_true_handled, NULL, NULL,
+                  G_TYPE_BOOLEAN,
+                  2,
+                  G_TYPE_STRING | G_SIGNAL_TYPE_STATIC_SCOPE,
+                  G_TYPE_VARIANT);
 }
 
 static void
@@ -541,6 +717,42 @@ jsonrpc_client_call_notify_completed (GTask      *task,
   g_hash_table_remove (priv->invocations, id);
 }
 
+/*
+ * Registers @task as an inflight invocation and allocates its request id.
+ *
+ * Returns: the request id, or 0 if the client is not ready, in which case
+ *   @task has been completed with an error.
+ */
+static gint
+jsonrpc_client_begin_call (JsonrpcClient *self,
+                           GTask         *task)
+{
+  JsonrpcClientPrivate *priv = jsonrpc_client_get_instance_private (self);
+  g_autoptr(GError) error = NULL;
+  gint id;
+
+  g_assert (JSONRPC_IS_CLIENT (self));
+  g_assert (G_IS_TASK (task));
+
+  if (!jsonrpc_client_check_ready (self, &error))
+    {
+      g_task_return_error (task, g_steal_pointer (&error));
+      return 0;
+    }
+
+  g_signal_connect (task,
+                    "notify::completed",
+                    G_CALLBACK (jsonrpc_client_call_notify_completed),
+                    NULL);
+
+  id = ++priv->sequence;
+
+  g_task_set_task_data (task, GINT_TO_POINTER (id), NULL);
+  g_hash_table_insert (priv->invocations, GINT_TO_POINTER (id), g_object_ref (task));
+
+  return id;
+}
+
 static void
 jsonrpc_client_call_write_cb (GObject      *object,
                               GAsyncResult *result,
@@ -565,6 +777,205 @@ jsonrpc_client_call_write_cb (GObject      *object,
    */
 }
 
+static void
+jsonrpc_client_call_write_variant_cb (GObject      *object,
+                                      GAsyncResult *result,
+                                      gpointer      user_data)
+{
+  JsonrpcOutputStream *stream = (JsonrpcOutputStream *)object;
+  g_autoptr(GTask) task = user_data;
+  g_autoptr(GError) error = NULL;
+
+  g_assert (JSONRPC_IS_OUTPUT_STREAM (stream));
+  g_assert (G_IS_TASK (task));
+
+  /* As with jsonrpc_client_call_write_cb(), the reply completes the task. */
+  if (!jsonrpc_output_stream_write_variant_finish (stream, result, &error))
+    g_task_return_error (task, g_steal_pointer (&error));
+}
+
+static void
+jsonrpc_client_write_variant_cb (GObject      *object,
+                                 GAsyncResult *result,
+                                 gpointer      user_data)
+{
+  JsonrpcOutputStream *stream = (JsonrpcOutputStream *)object;
+  g_autoptr(GTask) task = user_data;
+  g_autoptr(GError) error = NULL;
+
+  g_assert (JSONRPC_IS_OUTPUT_STREAM (stream));
+  g_assert (G_IS_ASYNC_RESULT (result));
+  g_assert (G_IS_TASK (task));
+
+  if (!jsonrpc_output_stream_write_variant_finish (stream, result, &error))
+    g_task_return_error (task, g_steal_pointer (&error));
+  else
+    g_task_return_boolean (task, TRUE);
+}
+
+/*
+ * Dispatches a message from a peer that uses GVariant encoding. This
+ * follows the JSON handling in jsonrpc_client_call_read_cb(), but reads
+ * the fields directly from the a{sv} so that the message is never
+ * converted unless it ends up at a #JsonNode based API.
+ *
+ * Returns: %FALSE if the client panic'd and the read loop must stop.
+ */
+static gboolean
+jsonrpc_client_dispatch_variant (JsonrpcClient *self,
+                                 GVariant      *message)
+{
+  JsonrpcClientPrivate *priv = jsonrpc_client_get_instance_private (self);
+  JsonrpcClientClass *klass = JSONRPC_CLIENT_GET_CLASS (self);
+  g_autoptr(GVariant) id = NULL;
+  g_autoptr(GVariant) params = NULL;
+  g_autoptr(GVariant) result = NULL;
+  g_autoptr(GVariant) err = NULL;
+  g_autoptr(GError) error = NULL;
+  const gchar *version = NULL;
+  const gchar *method = NULL;
+  gint64 id_value = -1;
+
+  g_assert (JSONRPC_IS_CLIENT (self));
+  g_assert (message != NULL);
+
+  if (!g_variant_is_of_type (message, G_VARIANT_TYPE_VARDICT) ||
+      !g_variant_lookup (message, "jsonrpc", "&s", &version) ||
+      g_strcmp0 (version, "2.0") != 0)
+    {
+      error = g_error_new_literal (G_IO_ERROR,
+                                   G_IO_ERROR_INVALID_DATA,
+                                   "Received malformed response from peer");
+      jsonrpc_client_panic (self, error);
+      return FALSE;
+    }
+
+  id = g_variant_lookup_value (message, "id", NULL);
+  params = g_variant_lookup_value (message, "params", NULL);
+  result = g_variant_lookup_value (message, "result", NULL);
+
+  if (!g_variant_lookup (message, "method", "&s", &method) || *method == '\0')
+    method = NULL;
+
+  if (!variant_lookup_int (message, "id", &id_value))
+    id_value = -1;
+
+  if (id == NULL && method != NULL)
+    {
+      gboolean ret = FALSE;
+
+      if (params == NULL)
+        params = g_variant_ref_sink (g_variant_new_array (G_VARIANT_TYPE_VARIANT, NULL, 0));
+
+      g_signal_emit (self, signals [NOTIFICATION_VARIANT], 0, method, params, &ret);
+
+      if (ret == FALSE &&
+          (klass->notification != NULL ||
+           g_signal_has_handler_pending (self, signals [NOTIFICATION], 0, TRUE)))
+        {
+          g_autoptr(JsonNode) params_node = json_gvariant_serialize (params);
+
+          g_signal_emit (self, signals [NOTIFICATION], 0, method, params_node);
+        }
+
+      return TRUE;
+    }
+
+  if (id_value > 0 && result != NULL)
+    {
+      GTask *task = g_hash_table_lookup (priv->invocations, GINT_TO_POINTER (id_value));
+
+      if (task != NULL)
+        {
+          jsonrpc_client_return_result (task, NULL, result);
+          return TRUE;
+        }
+
+      error = g_error_new_literal (G_IO_ERROR,
+                                   G_IO_ERROR_INVALID_DATA,
+                                   "Reply to missing or invalid task");
+      jsonrpc_client_panic (self, error);
+      return FALSE;
+    }
+
+  if (id != NULL && method != NULL && params != NULL)
+    {
+      gboolean ret = FALSE;
+
+      g_signal_emit (self, signals [HANDLE_CALL_VARIANT], 0, method, id, params, &ret);
+
+      if (ret == FALSE &&
+          (klass->handle_call != NULL ||
+           g_signal_has_handler_pending (self, signals [HANDLE_CALL], 0, TRUE)))
+        {
+          g_autoptr(JsonNode) id_node = json_gvariant_serialize (id);
+          g_autoptr(JsonNode) params_node = json_gvariant_serialize (params);
+
+          g_signal_emit (self, signals [HANDLE_CALL], 0, method, id_node, params_node, &ret);
+        }
+
+      if (ret == FALSE)
+        {
+          GVariantDict reply;
+          GVariantDict reply_error;
+
+          g_variant_dict_init (&reply_error, NULL);
+          g_variant_dict_insert (&reply_error, "code", "x", G_GINT64_CONSTANT (-32601));
+          g_variant_dict_insert (&reply_error, "message", "s",
+                                 "The method does not exist or is not available");
+
+          g_variant_dict_init (&reply, NULL);
+          g_variant_dict_insert (&reply, "jsonrpc", "s", "2.0");
+          g_variant_dict_insert_value (&reply, "id", id);
+          g_variant_dict_insert_value (&reply, "error", g_variant_dict_end (&reply_error));
+
+          jsonrpc_output_stream_write_variant_async (priv->output_stream,
+                                                     g_variant_dict_end (&reply),
+                                                     NULL, NULL, NULL);
+        }
+
+      return TRUE;
+    }
+
+  if (g_variant_lookup (message, "error", "@a{sv}", &err))
+    {
+      const gchar *err_message = NULL;
+      gint64 code = 0;
+
+      if (!g_variant_lookup (err, "message", "&s", &err_message) || *err_message == '\0')
+        err_message = "Unknown error occurred";
+
+      variant_lookup_int (err, "code", &code);
+
+      g_set_error_literal (&error, JSONRPC_CLIENT_ERROR, code, err_message);
+
+      if (id_value > 0)
+        {
+          GTask *task = g_hash_table_lookup (priv->invocations, GINT_TO_POINTER (id_value));
+
+          if (task != NULL)
+            {
+              g_task_return_error (task, g_steal_pointer (&error));
+              return TRUE;
+            }
+        }
+
+      /*
+       * Generic error, not tied to any specific task we had in flight. So
+       * take this as a failure case and panic on the line.
+       */
+      jsonrpc_client_panic (self, error);
+      return FALSE;
+    }
+
+  {
+    g_autofree gchar *str = g_variant_print (message, TRUE);
+    g_warning ("Unhandled message: %s", str);
+  }
+
+  return TRUE;
+}
+
 static void
 jsonrpc_client_call_read_cb (GObject      *object,
                              GAsyncResult *result,
@@ -574,6 +985,7 @@ jsonrpc_client_call_read_cb (GObject      *object,
   g_autoptr(JsonrpcClient) self = user_data;
   JsonrpcClientPrivate *priv = jsonrpc_client_get_instance_private (self);
   g_autoptr(JsonNode) node = NULL;
+  g_autoptr(GVariant) message = NULL;
   g_autoptr(GError) error = NULL;
   JsonNode *id_node = NULL;
   JsonNode *params_node = NULL;
@@ -583,7 +995,7 @@ jsonrpc_client_call_read_cb (GObject      *object,
   g_assert (JSONRPC_IS_INPUT_STREAM (stream));
   g_assert (JSONRPC_IS_CLIENT (self));
 
-  if (!jsonrpc_input_stream_read_message_finish (stream, result, &node, &error))
+  if (!jsonrpc_input_stream_read_any_finish (stream, result, &node, &message, &error))
     {
       /*
        * Handle jsonrpc_client_close() conditions gracefully.
@@ -600,6 +1012,24 @@ jsonrpc_client_call_read_cb (GObject      *object,
       return;
     }
 
+  /*
+   * If the peer is talking GVariant to us, it can understand GVariant
+   * too, so switch our outgoing messages over to the cheaper encoding.
+   */
+  if (!priv->use_gvariant && jsonrpc_input_stream_get_has_seen_gvariant (stream))
+    jsonrpc_client_set_use_gvariant (self, TRUE);
+
+  /*
+   * GVariant messages are dispatched as they were received rather than
+   * being converted to JSON first.
+   */
+  if (message != NULL)
+    {
+      if (!jsonrpc_client_dispatch_variant (self, message))
+        return;
+      goto begin_next_read;
+    }
+
   g_assert (node != NULL);
 
   /*
@@ -653,7 +1083,7 @@ jsonrpc_client_call_read_cb (GObject      *object,
 
       if (task != NULL)
         {
-          g_task_return_pointer (task, json_node_copy (res), (GDestroyNotify)json_node_unref);
+          jsonrpc_client_return_result (task, res, NULL);
           goto begin_next_read;
         }
 
@@ -694,7 +1124,7 @@ jsonrpc_client_call_read_cb (GObject      *object,
                                                      NULL, NULL, NULL);
         }
 
-      return;
+      goto begin_next_read;
     }
 
   /*
@@ -729,10 +1159,10 @@ jsonrpc_client_call_read_cb (GObject      *object,
 
 begin_next_read:
   if (priv->input_stream != NULL && priv->in_shutdown == FALSE)
-    jsonrpc_input_stream_read_message_async (priv->input_stream,
-                                             priv->read_loop_cancellable,
-                                             jsonrpc_client_call_read_cb,
-                                             g_steal_pointer (&self));
+    jsonrpc_input_stream_read_any_async (priv->input_stream,
+                                         priv->read_loop_cancellable,
+                                         jsonrpc_client_call_read_cb,
+                                         g_steal_pointer (&self));
 }
 
 static void
@@ -838,13 +1268,43 @@ jsonrpc_client_call_async (JsonrpcClient       *self,
                            GCancellable        *cancellable,
                            GAsyncReadyCallback  callback,
                            gpointer             user_data)
+{
+  jsonrpc_client_call_with_id_async (self, method, params, NULL, cancellable, callback, user_data);
+}
+
+/**
+ * jsonrpc_client_call_with_id_async:
+ * @self: A #JsonrpcClient
+ * @method: the name of the method to call
+ * @params: (transfer full) (nullable): A #JsonNode of parameters or %NULL
+ * @id_out: (out) (optional): A location for the request id, or %NULL
+ * @cancellable: (nullable): A #GCancellable or %NULL
+ * @callback: a callback to executed upon completion
+ * @user_data: user data for @callback
+ *
+ * This is similar to jsonrpc_client_call_async() but also provides the
+ * "id" of the request that was sent to the peer. That allows protocols
+ * layered upon JSON-RPC to refer to the request, such as to cancel it.
+ *
+ * @id_out is set to 0 if the request could not be sent.
+ */
+void
+jsonrpc_client_call_with_id_async (JsonrpcClient       *self,
+                                   const gchar         *method,
+                                   JsonNode            *params,
+                                   gint                *id_out,
+                                   GCancellable        *cancellable,
+                                   GAsyncReadyCallback  callback,
+                                   gpointer             user_data)
 {
   JsonrpcClientPrivate *priv = jsonrpc_client_get_instance_private (self);
   g_autoptr(JsonNode) message = NULL;
   g_autoptr(GTask) task = NULL;
-  g_autoptr(GError) error = NULL;
   gint id;
 
+  if (id_out != NULL)
+    *id_out = 0;
+
   g_return_if_fail (JSONRPC_IS_CLIENT (self));
   g_return_if_fail (method != NULL);
   g_return_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable));
@@ -852,20 +1312,11 @@ jsonrpc_client_call_async (JsonrpcClient       *self,
   task = g_task_new (self, cancellable, callback, user_data);
   g_task_set_source_tag (task, jsonrpc_client_call_async);
 
-  if (!jsonrpc_client_check_ready (self, &error))
-    {
-      g_task_return_error (task, g_steal_pointer (&error));
-      return;
-    }
+  if (0 == (id = jsonrpc_client_begin_call (self, task)))
+    return;
 
-  g_signal_connect (task,
-                    "notify::completed",
-                    G_CALLBACK (jsonrpc_client_call_notify_completed),
-                    NULL);
-
-  id = ++priv->sequence;
-
-  g_task_set_task_data (task, GINT_TO_POINTER (id), NULL);
+  if (id_out != NULL)
+    *id_out = id;
 
   if (params == NULL)
     params = json_node_new (JSON_NODE_NULL);
@@ -877,8 +1328,6 @@ jsonrpc_client_call_async (JsonrpcClient       *self,
     "params", JCON_NODE (params)
   );
 
-  g_hash_table_insert (priv->invocations, GINT_TO_POINTER (id), g_object_ref (task));
-
   jsonrpc_output_stream_write_message_async (priv->output_stream,
                                              message,
                                              cancellable,
@@ -921,6 +1370,100 @@ jsonrpc_client_call_finish (JsonrpcClient  *self,
   return ret;
 }
 
+/**
+ * jsonrpc_client_call_variant_async:
+ * @self: A #JsonrpcClient
+ * @method: the name of the method to call
+ * @params: (nullable): A #GVariant of parameters or %NULL
+ * @cancellable: (nullable): A #GCancellable or %NULL
+ * @callback: a callback to executed upon completion
+ * @user_data: user data for @callback
+ *
+ * This is like jsonrpc_client_call_async() but uses #GVariant for the
+ * parameters and the reply. When the peer uses #GVariant encoding, the
+ * message is written and the reply is provided without any conversion.
+ *
+ * If @params is a floating reference, it is consumed.
+ *
+ * Call jsonrpc_client_call_variant_finish() to get the result.
+ */
+void
+jsonrpc_client_call_variant_async (JsonrpcClient       *self,
+                                   const gchar         *method,
+                                   GVariant            *params,
+                                   GCancellable        *cancellable,
+                                   GAsyncReadyCallback  callback,
+                                   gpointer             user_data)
+{
+  JsonrpcClientPrivate *priv = jsonrpc_client_get_instance_private (self);
+  g_autoptr(GVariant) sunk = NULL;
+  g_autoptr(GTask) task = NULL;
+  GVariantDict message;
+  gint id;
+
+  g_return_if_fail (JSONRPC_IS_CLIENT (self));
+  g_return_if_fail (method != NULL);
+  g_return_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+  if (params == NULL)
+    params = g_variant_new_maybe (G_VARIANT_TYPE_VARIANT, NULL);
+
+  sunk = g_variant_ref_sink (params);
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_source_tag (task, jsonrpc_client_call_variant_async);
+
+  if (0 == (id = jsonrpc_client_begin_call (self, task)))
+    return;
+
+  g_variant_dict_init (&message, NULL);
+  g_variant_dict_insert (&message, "jsonrpc", "s", "2.0");
+  g_variant_dict_insert (&message, "id", "x", (gint64)id);
+  g_variant_dict_insert (&message, "method", "s", method);
+  g_variant_dict_insert_value (&message, "params", params);
+
+  jsonrpc_output_stream_write_variant_async (priv->output_stream,
+                                             g_variant_dict_end (&message),
+                                             cancellable,
+                                             jsonrpc_client_call_write_variant_cb,
+                                             g_steal_pointer (&task));
+
+  if (priv->is_first_call)
+    jsonrpc_client_start_listening (self);
+}
+
+/**
+ * jsonrpc_client_call_variant_finish:
+ * @self: A #JsonrpcClient.
+ * @result: A #GAsyncResult provided to the callback in jsonrpc_client_call_variant_async()
+ * @return_value: (out) (nullable): A location for a #GVariant or %NULL
+ * @error: a location for a #GError or %NULL
+ *
+ * Completes an asynchronous call to jsonrpc_client_call_variant_async().
+ *
+ * Returns: %TRUE if successful and @return_value is set, otherwise %FALSE and @error is set.
+ */
+gboolean
+jsonrpc_client_call_variant_finish (JsonrpcClient  *self,
+                                    GAsyncResult   *result,
+                                    GVariant      **return_value,
+                                    GError        **error)
+{
+  g_autoptr(GVariant) local_return_value = NULL;
+  gboolean ret;
+
+  g_return_val_if_fail (JSONRPC_IS_CLIENT (self), FALSE);
+  g_return_val_if_fail (G_IS_TASK (result), FALSE);
+
+  local_return_value = g_task_propagate_pointer (G_TASK (result), error);
+  ret = local_return_value != NULL;
+
+  if (return_value != NULL)
+    *return_value = g_steal_pointer (&local_return_value);
+
+  return ret;
+}
+
 GQuark
 jsonrpc_client_error_quark (void)
 {
@@ -1078,6 +1621,65 @@ jsonrpc_client_send_notification_finish (JsonrpcClient  *self,
   return g_task_propagate_boolean (G_TASK (result), error);
 }
 
+/**
+ * jsonrpc_client_send_notification_variant_async:
+ * @self: A #JsonrpcClient
+ * @method: the name of the method to call
+ * @params: (nullable): A #GVariant of parameters or %NULL
+ * @cancellable: (nullable): A #GCancellable or %NULL
+ * @callback: a callback to executed upon completion
+ * @user_data: user data for @callback
+ *
+ * This is like jsonrpc_client_send_notification_async() but uses #GVariant
+ * for the parameters, which are not converted when the peer uses #GVariant
+ * encoding. If @params is a floating reference, it is consumed.
+ *
+ * Call jsonrpc_client_send_notification_finish() to complete the operation.
+ */
+void
+jsonrpc_client_send_notification_variant_async (JsonrpcClient       *self,
+                                                const gchar         *method,
+                                                GVariant            *params,
+                                                GCancellable        *cancellable,
+                                                GAsyncReadyCallback  callback,
+                                                gpointer             user_data)
+{
+  JsonrpcClientPrivate *priv = jsonrpc_client_get_instance_private (self);
+  g_autoptr(GVariant) sunk = NULL;
+  g_autoptr(GTask) task = NULL;
+  g_autoptr(GError) error = NULL;
+  GVariantDict message;
+
+  g_return_if_fail (JSONRPC_IS_CLIENT (self));
+  g_return_if_fail (method != NULL);
+  g_return_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+  if (params == NULL)
+    params = g_variant_new_maybe (G_VARIANT_TYPE_VARIANT, NULL);
+
+  sunk = g_variant_ref_sink (params);
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_source_tag (task, jsonrpc_client_send_notification_variant_async);
+
+  if (!jsonrpc_client_check_ready (self, &error))
+    {
+      g_task_return_error (task, g_steal_pointer (&error));
+      return;
+    }
+
+  g_variant_dict_init (&message, NULL);
+  g_variant_dict_insert (&message, "jsonrpc", "s", "2.0");
+  g_variant_dict_insert (&message, "method", "s", method);
+  g_variant_dict_insert_value (&message, "params", params);
+
+  jsonrpc_output_stream_write_variant_async (priv->output_stream,
+                                             g_variant_dict_end (&message),
+                                             cancellable,
+                                             jsonrpc_client_write_variant_cb,
+                                             g_steal_pointer (&task));
+}
+
 /**
  * jsonrpc_client_close:
  * @self: A #JsonrpcClient
@@ -1245,7 +1847,7 @@ jsonrpc_client_reply_cb (GObject      *object,
   g_assert (G_IS_TASK (task));
 
   if (!jsonrpc_output_stream_write_message_finish (stream, result, &error))
-    g_task_return_error (task, g_steal_pointer (&task));
+    g_task_return_error (task, g_steal_pointer (&error));
   else
     g_task_return_boolean (task, TRUE);
 }
@@ -1327,6 +1929,67 @@ jsonrpc_client_reply_finish (JsonrpcClient  *self,
   return g_task_propagate_boolean (G_TASK (result), error);
 }
 
+/**
+ * jsonrpc_client_reply_variant_async:
+ * @self: A #JsonrpcClient
+ * @id: (not nullable): the id of the message to reply
+ * @result: (nullable): the return value or %NULL
+ * @cancellable: (nullable): A #GCancellable or %NULL
+ * @callback: a callback to executed upon completion
+ * @user_data: user data for @callback
+ *
+ * This is like jsonrpc_client_reply_async() but uses #GVariant for @id
+ * and @result, such as from #JsonrpcClient::handle-call-variant. Floating
+ * references are consumed.
+ *
+ * Call jsonrpc_client_reply_finish() to complete the operation.
+ */
+void
+jsonrpc_client_reply_variant_async (JsonrpcClient       *self,
+                                    GVariant            *id,
+                                    GVariant            *result,
+                                    GCancellable        *cancellable,
+                                    GAsyncReadyCallback  callback,
+                                    gpointer             user_data)
+{
+  JsonrpcClientPrivate *priv = jsonrpc_client_get_instance_private (self);
+  g_autoptr(GVariant) sunk_id = NULL;
+  g_autoptr(GVariant) sunk_result = NULL;
+  g_autoptr(GTask) task = NULL;
+  g_autoptr(GError) error = NULL;
+  GVariantDict message;
+
+  g_return_if_fail (JSONRPC_IS_CLIENT (self));
+  g_return_if_fail (id != NULL);
+  g_return_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+  if (result == NULL)
+    result = g_variant_new_maybe (G_VARIANT_TYPE_VARIANT, NULL);
+
+  sunk_id = g_variant_ref_sink (id);
+  sunk_result = g_variant_ref_sink (result);
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_source_tag (task, jsonrpc_client_reply_variant_async);
+
+  if (!jsonrpc_client_check_ready (self, &error))
+    {
+      g_task_return_error (task, g_steal_pointer (&error));
+      return;
+    }
+
+  g_variant_dict_init (&message, NULL);
+  g_variant_dict_insert (&message, "jsonrpc", "s", "2.0");
+  g_variant_dict_insert_value (&message, "id", id);
+  g_variant_dict_insert_value (&message, "result", result);
+
+  jsonrpc_output_stream_write_variant_async (priv->output_stream,
+                                             g_variant_dict_end (&message),
+                                             cancellable,
+                                             jsonrpc_client_write_variant_cb,
+                                             g_steal_pointer (&task));
+}
+
 void
 jsonrpc_client_start_listening (JsonrpcClient *self)
 {
@@ -1350,9 +2013,58 @@ jsonrpc_client_start_listening (JsonrpcClient *self)
        * jsonrpc_client_close_async() so that we can cancel the operation and
        * allow it to cleanup any outstanding references.
        */
-      jsonrpc_input_stream_read_message_async (priv->input_stream,
-                                               priv->read_loop_cancellable,
-                                               jsonrpc_client_call_read_cb,
-                                               g_object_ref (self));
+      jsonrpc_input_stream_read_any_async (priv->input_stream,
+                                           priv->read_loop_cancellable,
+                                           jsonrpc_client_call_read_cb,
+                                           g_object_ref (self));
+    }
+}
+
+/**
+ * jsonrpc_client_get_use_gvariant:
+ * @self: a #JsonrpcClient
+ *
+ * Gets the #JsonrpcClient:use-gvariant property.
+ *
+ * Returns: %TRUE if messages are encoded as #GVariant.
+ */
+gboolean
+jsonrpc_client_get_use_gvariant (JsonrpcClient *self)
+{
+  JsonrpcClientPrivate *priv = jsonrpc_client_get_instance_private (self);
+
+  g_return_val_if_fail (JSONRPC_IS_CLIENT (self), FALSE);
+
+  return priv->use_gvariant;
+}
+
+/**
+ * jsonrpc_client_set_use_gvariant:
+ * @self: a #JsonrpcClient
+ * @use_gvariant: if #GVariant encoding should be used
+ *
+ * Sets the #JsonrpcClient:use-gvariant property.
+ *
+ * Only enable this when the peer is also a #JsonrpcClient or
+ * #JsonrpcServer, such as one of Builder's own helper processes.
+ * Use the #GVariant API, such as jsonrpc_client_call_variant_async(),
+ * to avoid converting messages to and from #JsonNode.
+ */
+void
+jsonrpc_client_set_use_gvariant (JsonrpcClient *self,
+                                 gboolean       use_gvariant)
+{
+  JsonrpcClientPrivate *priv = jsonrpc_client_get_instance_private (self);
+
+  g_return_if_fail (JSONRPC_IS_CLIENT (self));
+
+  use_gvariant = !!use_gvariant;
+
+  if (priv->use_gvariant != use_gvariant)
+    {
+      priv->use_gvariant = use_gvariant;
+      if (priv->output_stream != NULL)
+        jsonrpc_output_stream_set_use_gvariant (priv->output_stream, use_gvariant);
+      g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_USE_GVARIANT]);
     }
 }
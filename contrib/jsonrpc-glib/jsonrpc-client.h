@@ -40,6 +40,13 @@ struct _JsonrpcClientClass
                             const gchar   *method,
                             JsonNode      *id,
                             JsonNode      *params);
+  gboolean (*handle_call_variant)  (JsonrpcClient *self,
+                                    const gchar   *method,
+                                    GVariant      *id,
+                                    GVariant      *params);
+  gboolean (*notification_variant) (JsonrpcClient *self,
+                                    const gchar   *method_name,
+                                    GVariant      *params);
 
   gpointer _reserved1;
   gpointer _reserved2;
@@ -47,67 +54,97 @@ struct _JsonrpcClientClass
   gpointer _reserved4;
   gpointer _reserved5;
   gpointer _reserved6;
-  gpointer _reserved7;
-  gpointer _reserved8;
 };
 
-GQuark         jsonrpc_client_error_quark              (void);
-JsonrpcClient *jsonrpc_client_new                      (GIOStream            *io_stream);
-gboolean       jsonrpc_client_close                    (JsonrpcClient        *self,
-                                                        GCancellable         *cancellable,
-                                                        GError              **error);
-void           jsonrpc_client_close_async              (JsonrpcClient        *self,
-                                                        GCancellable         *cancellable,
-                                                        GAsyncReadyCallback   callback,
-                                                        gpointer              user_data);
-gboolean       jsonrpc_client_close_finish             (JsonrpcClient        *self,
-                                                        GAsyncResult         *result,
-                                                        GError              **error);
-gboolean       jsonrpc_client_call                     (JsonrpcClient        *self,
-                                                        const gchar          *method,
-                                                        JsonNode             *params,
-                                                        GCancellable         *cancellable,
-                                                        JsonNode            **return_value,
-                                                        GError              **error);
-void           jsonrpc_client_call_async               (JsonrpcClient        *self,
-                                                        const gchar          *method,
-                                                        JsonNode             *params,
-                                                        GCancellable         *cancellable,
-                                                        GAsyncReadyCallback   callback,
-                                                        gpointer              user_data);
-gboolean       jsonrpc_client_call_finish              (JsonrpcClient        *self,
-                                                        GAsyncResult         *result,
-                                                        JsonNode            **return_value,
-                                                        GError              **error);
-gboolean       jsonrpc_client_send_notification        (JsonrpcClient        *self,
-                                                        const gchar          *method,
-                                                        JsonNode             *params,
-                                                        GCancellable         *cancellable,
-                                                        GError              **error);
-void           jsonrpc_client_send_notification_async  (JsonrpcClient        *self,
-                                                        const gchar          *method,
-                                                        JsonNode             *params,
-                                                        GCancellable         *cancellable,
-                                                        GAsyncReadyCallback   callback,
-                                                        gpointer              user_data);
-gboolean       jsonrpc_client_send_notification_finish (JsonrpcClient        *self,
-                                                        GAsyncResult         *result,
-                                                        GError              **error);
-gboolean       jsonrpc_client_reply                    (JsonrpcClient        *self,
-                                                        JsonNode             *id,
-                                                        JsonNode             *result,
-                                                        GCancellable         *cancellable,
-                                                        GError              **error);
-void           jsonrpc_client_reply_async              (JsonrpcClient        *self,
-                                                        JsonNode             *id,
-                                                        JsonNode             *result,
-                                                        GCancellable         *cancellable,
-                                                        GAsyncReadyCallback   callback,
-                                                        gpointer              user_data);
-gboolean       jsonrpc_client_reply_finish             (JsonrpcClient        *self,
-                                                        GAsyncResult         *result,
-                                                        GError              **error);
-void           jsonrpc_client_start_listening          (JsonrpcClient        *self);
+GQuark         jsonrpc_client_error_quark                     (void);
+JsonrpcClient *jsonrpc_client_new                             (GIOStream            *io_stream);
+gboolean       jsonrpc_client_close                           (JsonrpcClient        *self,
+                                                               GCancellable         *cancellable,
+                                                               GError              **error);
+void           jsonrpc_client_close_async                     (JsonrpcClient        *self,
+                                                               GCancellable         *cancellable,
+                                                               GAsyncReadyCallback   callback,
+                                                               gpointer              user_data);
+gboolean       jsonrpc_client_close_finish                    (JsonrpcClient        *self,
+                                                               GAsyncResult         *result,
+                                                               GError              **error);
+gboolean       jsonrpc_client_call                            (JsonrpcClient        *self,
+                                                               const gchar          *method,
+                                                               JsonNode             *params,
+                                                               GCancellable         *cancellable,
+                                                               JsonNode            **return_value,
+                                                               GError              **error);
+void           jsonrpc_client_call_async                      (JsonrpcClient        *self,
+                                                               const gchar          *method,
+                                                               JsonNode             *params,
+                                                               GCancellable         *cancellable,
+                                                               GAsyncReadyCallback   callback,
+                                                               gpointer              user_data);
+void           jsonrpc_client_call_with_id_async              (JsonrpcClient        *self,
+                                                               const gchar          *method,
+                                                               JsonNode             *params,
+                                                               gint                 *id_out,
+                                                               GCancellable         *cancellable,
+                                                               GAsyncReadyCallback   callback,
+                                                               gpointer              user_data);
+gboolean       jsonrpc_client_call_finish                     (JsonrpcClient        *self,
+                                                               GAsyncResult         *result,
+                                                               JsonNode            **return_value,
+                                                               GError              **error);
+gboolean       jsonrpc_client_send_notification               (JsonrpcClient        *self,
+                                                               const gchar          *method,
+                                                               JsonNode             *params,
+                                                               GCancellable         *cancellable,
+                                                               GError              **error);
+void           jsonrpc_client_send_notification_async         (JsonrpcClient        *self,
+                                                               const gchar          *method,
+                                                               JsonNode             *params,
+                                                               GCancellable         *cancellable,
+                                                               GAsyncReadyCallback   callback,
+                                                               gpointer              user_data);
+gboolean       jsonrpc_client_send_notification_finish        (JsonrpcClient        *self,
+                                                               GAsyncResult         *result,
+                                                               GError              **error);
+gboolean       jsonrpc_client_reply                           (JsonrpcClient        *self,
+                                                               JsonNode             *id,
+                                                               JsonNode             *result,
+                                                               GCancellable         *cancellable,
+                                                               GError              **error);
+void           jsonrpc_client_reply_async                     (JsonrpcClient        *self,
+                                                               JsonNode             *id,
+                                                               JsonNode             *result,
+                                                               GCancellable         *cancellable,
+                                                               GAsyncReadyCallback   callback,
+                                                               gpointer              user_data);
+gboolean       jsonrpc_client_reply_finish                    (JsonrpcClient        *self,
+                                                               GAsyncResult         *result,
+                                                               GError              **error);
+void           jsonrpc_client_call_variant_async              (JsonrpcClient        *self,
+                                                               const gchar          *method,
+                                                               GVariant             *params,
+                                                               GCancellable         *cancellable,
+                                                               GAsyncReadyCallback   callback,
+                                                               gpointer              user_data);
+gboolean       jsonrpc_client_call_variant_finish             (JsonrpcClient        *self,
+                                                               GAsyncResult         *result,
+                                                               GVariant            **return_value,
+                                                               GError              **error);
+void           jsonrpc_client_send_notification_variant_async (JsonrpcClient        *self,
+                                                               const gchar          *method,
+                                                               GVariant             *params,
+                                                               GCancellable         *cancellable,
+                                                               GAsyncReadyCallback   callback,
+                                                               gpointer              user_data);
+void           jsonrpc_client_reply_variant_async             (JsonrpcClient        *self,
+                                                               GVariant             *id,
+                                                               GVariant             *result,
+                                                               GCancellable         *cancellable,
+                                                               GAsyncReadyCallback   callback,
+                                                               gpointer              user_data);
+void           jsonrpc_client_start_listening                 (JsonrpcClient        *self);
+gboolean       jsonrpc_client_get_use_gvariant                (JsonrpcClient        *self);
+void           jsonrpc_client_set_use_gvariant                (JsonrpcClient        *self,
+                                                               gboolean              use_gvariant);
 
 G_END_DECLS
 
@@ -18,25 +18,48 @@
 
 #define G_LOG_DOMAIN "jsonrpc-input-stream"
 
-#include <errno.h>
 #include <string.h>
 
 #include "jsonrpc-input-stream.h"
 
+/*
+ * Headers are parsed directly out of the GBufferedInputStream buffer, which
+ * is grown on demand and reused for subsequent messages. When the whole body
+ * is available in that buffer, the parser is handed a pointer into it so we
+ * avoid both the per-line allocations of g_data_input_stream_read_line() and
+ * a separate body allocation.
+ */
+#define DEFAULT_BUFFER_SIZE (4096 * 4)
+#define MAX_HEADER_SIZE     (4096 * 4)
+
+/*
+ * Peers that set this content type send the body as a serialized GVariant
+ * of type "v" instead of JSON text. Such bodies are read into their own
+ * allocation so the GVariant can be used in place without a copy.
+ */
+#define GVARIANT_CONTENT_TYPE "application/gvariant"
+
 typedef struct
 {
-  gssize content_length;
-  gchar *buffer;
-  gint priority;
+  gssize   content_length;
+  gsize    header_length;
+  gchar   *body;
+  gsize    body_read;
+  gint     priority;
+  gboolean use_gvariant;
 } ReadState;
 
 typedef struct
 {
   gssize max_size_bytes;
+  guint  has_seen_gvariant : 1;
 } JsonrpcInputStreamPrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE (JsonrpcInputStream, jsonrpc_input_stream, G_TYPE_DATA_INPUT_STREAM)
 
+static void jsonrpc_input_stream_pump          (GTask *task);
+static void jsonrpc_input_stream_read_gvariant (GTask *task);
+
 static gboolean jsonrpc_input_stream_debug;
 
 static void
@@ -44,7 +67,7 @@ read_state_free (gpointer data)
 {
   ReadState *state = data;
 
-  g_free (state->buffer);
+  g_free (state->body);
   g_slice_free (ReadState, state);
 }
 
@@ -62,6 +85,7 @@ jsonrpc_input_stream_init (JsonrpcInputStream *self)
   /* 16 MB */
   priv->max_size_bytes = 16 * 1024 * 1024;
 
+  g_buffered_input_stream_set_buffer_size (G_BUFFERED_INPUT_STREAM (self), DEFAULT_BUFFER_SIZE);
   g_data_input_stream_set_newline_type (G_DATA_INPUT_STREAM (self),
                                         G_DATA_STREAM_NEWLINE_TYPE_ANY);
 }
@@ -74,185 +98,459 @@ jsonrpc_input_stream_new (GInputStream *base_stream)
                        NULL);
 }
 
+/*
+ * Parses the header block found at the beginning of @data.
+ *
+ * Returns -1 if the headers are invalid and @error is set, 0 if more data
+ * is needed to locate the end of the headers, or 1 if the headers were
+ * parsed and @header_length and @content_length have been set.
+ */
+static gint
+jsonrpc_input_stream_parse_headers (JsonrpcInputStream  *self,
+                                    const gchar         *data,
+                                    gsize                len,
+                                    gsize               *header_length,
+                                    gssize              *content_length,
+                                    gboolean            *use_gvariant,
+                                    GError             **error)
+{
+  JsonrpcInputStreamPrivate *priv = jsonrpc_input_stream_get_instance_private (self);
+  const gchar *line = data;
+  const gchar *end = data + len;
+  gssize length = -1;
+
+  g_assert (JSONRPC_IS_INPUT_STREAM (self));
+  g_assert (header_length != NULL);
+  g_assert (content_length != NULL);
+  g_assert (use_gvariant != NULL);
+
+  *use_gvariant = FALSE;
+
+  while (line < end)
+    {
+      const gchar *eol;
+      gsize line_len;
+
+      if (NULL == (eol = memchr (line, '\n', end - line)))
+        return 0;
+
+      line_len = eol - line;
+      if (line_len > 0 && line[line_len - 1] == '\r')
+        line_len--;
+
+      /*
+       * If we are at the end of the headers, we can make progress towards
+       * parsing the JSON content. Otherwise we need to continue parsing
+       * the next header.
+       */
+      if (line_len == 0)
+        {
+          if (length <= 0)
+            {
+              g_set_error (error,
+                           G_IO_ERROR,
+                           G_IO_ERROR_INVALID_DATA,
+                           "Invalid or missing Content-Length header from peer");
+              return -1;
+            }
+
+          *header_length = eol + 1 - data;
+          *content_length = length;
+
+          return 1;
+        }
+
+      if (line_len > 16 && strncasecmp ("Content-Length: ", line, 16) == 0)
+        {
+          const gchar *iter = line + 16;
+          const gchar *line_end = line + line_len;
+
+          length = 0;
+
+          for (; iter < line_end && g_ascii_isdigit (*iter); iter++)
+            {
+              length = (length * 10) + (*iter - '0');
+
+              if (length > priv->max_size_bytes)
+                break;
+            }
+
+          if (iter == line + 16 || iter != line_end)
+            {
+              g_set_error (error,
+                           G_IO_ERROR,
+                           G_IO_ERROR_INVALID_DATA,
+                           "Invalid Content-Length received from peer");
+              return -1;
+            }
+        }
+
+      if (line_len > 14 && strncasecmp ("Content-Type: ", line, 14) == 0)
+        {
+          gsize type_len = line_len - 14;
+
+          *use_gvariant = (type_len == strlen (GVARIANT_CONTENT_TYPE) &&
+                           strncmp (line + 14, GVARIANT_CONTENT_TYPE, type_len) == 0);
+        }
+
+      line = eol + 1;
+    }
+
+  return 0;
+}
+
 static void
-jsonrpc_input_stream_read_body_cb (GObject      *object,
-                                   GAsyncResult *result,
-                                   gpointer      user_data)
+jsonrpc_input_stream_complete_gvariant (GTask *task)
 {
-  JsonrpcInputStream *self = (JsonrpcInputStream *)object;
+  JsonrpcInputStream *self = g_task_get_source_object (task);
+  JsonrpcInputStreamPrivate *priv = jsonrpc_input_stream_get_instance_private (self);
+  ReadState *state = g_task_get_task_data (task);
+  g_autoptr(GVariant) message = NULL;
+  g_autoptr(GVariant) child = NULL;
+  g_autoptr(GBytes) bytes = NULL;
+
+  g_assert (JSONRPC_IS_INPUT_STREAM (self));
+  g_assert (state->body != NULL);
+
+  priv->has_seen_gvariant = TRUE;
+
+  bytes = g_bytes_new_take (g_steal_pointer (&state->body), state->content_length);
+  message = g_variant_new_from_bytes (G_VARIANT_TYPE_VARIANT, bytes, FALSE);
+  child = g_variant_get_variant (message);
+
+  if G_UNLIKELY (jsonrpc_input_stream_debug)
+    {
+      g_autofree gchar *str = g_variant_print (child, TRUE);
+      g_message ("<<< %s", str);
+    }
+
+  if (!g_variant_is_of_type (child, G_VARIANT_TYPE_VARDICT) &&
+      !g_variant_is_of_type (child, G_VARIANT_TYPE ("av")))
+    {
+      g_task_return_new_error (task,
+                               G_IO_ERROR,
+                               G_IO_ERROR_INVALID_DATA,
+                               "Invalid GVariant message received from peer");
+      g_object_unref (task);
+      return;
+    }
+
+  /*
+   * The child shares the serialized data of @message, so the body that
+   * was read from the peer is handed to the consumer without a copy.
+   */
+  g_task_return_pointer (task, g_steal_pointer (&child), (GDestroyNotify)g_variant_unref);
+  g_object_unref (task);
+}
+
+static void
+jsonrpc_input_stream_read_gvariant_cb (GObject      *object,
+                                       GAsyncResult *result,
+                                       gpointer      user_data)
+{
+  GInputStream *stream = (GInputStream *)object;
   g_autoptr(GTask) task = user_data;
-  g_autoptr(JsonParser) parser = NULL;
   g_autoptr(GError) error = NULL;
   ReadState *state;
-  JsonNode *root;
-  gsize n_read;
+  gsize n_read = 0;
 
-  g_assert (JSONRPC_IS_INPUT_STREAM (self));
+  g_assert (JSONRPC_IS_INPUT_STREAM (stream));
   g_assert (G_IS_TASK (task));
 
   state = g_task_get_task_data (task);
 
-  if (!g_input_stream_read_all_finish (G_INPUT_STREAM (self), result, &n_read, &error))
+  if (!g_input_stream_read_all_finish (stream, result, &n_read, &error))
     {
       g_task_return_error (task, g_steal_pointer (&error));
       return;
     }
 
-  if ((gssize)n_read != state->content_length)
+  if (n_read != state->content_length - state->body_read)
     {
       g_task_return_new_error (task,
                                G_IO_ERROR,
-                               G_IO_ERROR_INVALID_DATA,
+                               G_IO_ERROR_CLOSED,
                                "Failed to read %"G_GSSIZE_FORMAT" bytes",
                                state->content_length);
       return;
     }
 
-  state->buffer [state->content_length] = '\0';
+  jsonrpc_input_stream_complete_gvariant (g_steal_pointer (&task));
+}
 
-  if G_UNLIKELY (jsonrpc_input_stream_debug)
-    g_message ("<<< %s", state->buffer);
+/*
+ * GVariant messages are copied out of the shared buffer only for the
+ * portion that has already been buffered. The remainder is read directly
+ * into the destination allocation, which GBufferedInputStream does without
+ * staging through its own buffer once that buffer is drained.
+ */
+static void
+jsonrpc_input_stream_read_gvariant (GTask *task)
+{
+  JsonrpcInputStream *self = g_task_get_source_object (task);
+  GInputStream *stream = G_INPUT_STREAM (self);
+  ReadState *state = g_task_get_task_data (task);
+  const gchar *data;
+  gsize available = 0;
+  gsize n_buffered;
 
-  parser = json_parser_new_immutable ();
+  g_assert (JSONRPC_IS_INPUT_STREAM (self));
+  g_assert (state->use_gvariant);
+  g_assert (state->body == NULL);
 
-  if (!json_parser_load_from_data (parser, state->buffer, state->content_length, &error))
+  g_input_stream_skip (stream, state->header_length, NULL, NULL);
+
+  data = g_buffered_input_stream_peek_buffer (G_BUFFERED_INPUT_STREAM (self), &available);
+  n_buffered = MIN (available, (gsize)state->content_length);
+
+  state->body = g_malloc (state->content_length);
+  memcpy (state->body, data, n_buffered);
+  g_input_stream_skip (stream, n_buffered, NULL, NULL);
+
+  if (n_buffered == (gsize)state->content_length)
+    {
+      jsonrpc_input_stream_complete_gvariant (task);
+      return;
+    }
+
+  state->body_read = n_buffered;
+
+  g_input_stream_read_all_async (stream,
+                                 state->body + n_buffered,
+                                 state->content_length - n_buffered,
+                                 state->priority,
+                                 g_task_get_cancellable (task),
+                                 jsonrpc_input_stream_read_gvariant_cb,
+                                 task);
+}
+
+static void
+jsonrpc_input_stream_fill_cb (GObject      *object,
+                              GAsyncResult *result,
+                              gpointer      user_data)
+{
+  GBufferedInputStream *stream = (GBufferedInputStream *)object;
+  g_autoptr(GTask) task = user_data;
+  g_autoptr(GError) error = NULL;
+  gssize n_read;
+
+  g_assert (JSONRPC_IS_INPUT_STREAM (stream));
+  g_assert (G_IS_TASK (task));
+
+  n_read = g_buffered_input_stream_fill_finish (stream, result, &error);
+
+  if (n_read < 0)
     {
       g_task_return_error (task, g_steal_pointer (&error));
       return;
     }
 
-  if (NULL == (root = json_parser_get_root (parser)))
+  if (n_read == 0)
     {
-      /*
-       * If we get back a NULL root node, that means that we got
-       * a short read (such as a closed stream).
-       */
       g_task_return_new_error (task,
                                G_IO_ERROR,
                                G_IO_ERROR_CLOSED,
-                               "The peer did not send a reply");
+                               "The peer has closed the stream");
       return;
     }
 
-  g_task_return_pointer (task, json_node_copy (root), (GDestroyNotify)json_node_unref);
+  jsonrpc_input_stream_pump (g_steal_pointer (&task));
 }
 
 static void
-jsonrpc_input_stream_read_headers_cb (GObject      *object,
-                                      GAsyncResult *result,
-                                      gpointer      user_data)
+jsonrpc_input_stream_fill (GTask *task,
+                           gsize  required)
 {
-  JsonrpcInputStream *self = (JsonrpcInputStream *)object;
-  JsonrpcInputStreamPrivate *priv = jsonrpc_input_stream_get_instance_private (self);
-  g_autoptr(GTask) task = user_data;
+  JsonrpcInputStream *self = g_task_get_source_object (task);
+  GBufferedInputStream *stream = G_BUFFERED_INPUT_STREAM (self);
+  ReadState *state = g_task_get_task_data (task);
+  gsize available;
+  gsize buffer_size;
+
+  g_assert (JSONRPC_IS_INPUT_STREAM (self));
+
+  available = g_buffered_input_stream_get_available (stream);
+  buffer_size = g_buffered_input_stream_get_buffer_size (stream);
+
+  g_assert (required > available);
+
+  /*
+   * Grow the buffer so the entire message can be parsed in place. The
+   * buffer is kept around for the next message, so steady-state reads
+   * do not allocate at all. GBufferedInputStream will compact unread
+   * data to the front of the buffer when filling.
+   */
+  if (required > buffer_size)
+    g_buffered_input_stream_set_buffer_size (stream, MAX (required, buffer_size * 2));
+
+  g_buffered_input_stream_fill_async (stream,
+                                      required - available,
+                                      state->priority,
+                                      g_task_get_cancellable (task),
+                                      jsonrpc_input_stream_fill_cb,
+                                      task);
+}
+
+static void
+jsonrpc_input_stream_pump (GTask *task)
+{
+  JsonrpcInputStream *self;
+  g_autoptr(JsonParser) parser = NULL;
   g_autoptr(GError) error = NULL;
-  g_autofree gchar *line = NULL;
-  GCancellable *cancellable = NULL;
+  const gchar *data;
+  const gchar *body;
   ReadState *state;
-  gsize length = 0;
+  JsonNode *root;
+  gsize available = 0;
+  gsize required;
 
-  g_assert (JSONRPC_IS_INPUT_STREAM (self));
   g_assert (G_IS_TASK (task));
 
-  line = g_data_input_stream_read_line_finish_utf8 (G_DATA_INPUT_STREAM (self), result, &length, &error);
+  self = g_task_get_source_object (task);
+  state = g_task_get_task_data (task);
 
-  if (line == NULL)
-    {
-      if (error != NULL)
-        g_task_return_error (task, g_steal_pointer (&error));
-      else
-        g_task_return_new_error (task,
-                                 G_IO_ERROR,
-                                 G_IO_ERROR_CLOSED,
-                                 "The peer has closed the stream");
-      return;
-    }
+  g_assert (JSONRPC_IS_INPUT_STREAM (self));
 
-  state = g_task_get_task_data (task);
-  cancellable = g_task_get_cancellable (task);
+  data = g_buffered_input_stream_peek_buffer (G_BUFFERED_INPUT_STREAM (self), &available);
 
-  if (strncasecmp ("Content-Length: ", line, 16) == 0)
+  if (state->content_length < 0)
     {
-      const gchar *lenptr = line + 16;
-      gint64 content_length;
+      gint r;
 
-      content_length = g_ascii_strtoll (lenptr, NULL, 10);
+      r = jsonrpc_input_stream_parse_headers (self,
+                                              data,
+                                              available,
+                                              &state->header_length,
+                                              &state->content_length,
+                                              &state->use_gvariant,
+                                              &error);
 
-      if (((content_length == G_MININT64 || content_length == G_MAXINT64) && errno == ERANGE) ||
-          (content_length < 0) ||
-          (content_length > G_MAXSSIZE) ||
-          (content_length > priv->max_size_bytes))
+      if (r < 0)
         {
-          g_task_return_new_error (task,
-                                   G_IO_ERROR,
-                                   G_IO_ERROR_INVALID_DATA,
-                                   "Invalid Content-Length received from peer");
+          g_task_return_error (task, g_steal_pointer (&error));
+          g_object_unref (task);
           return;
         }
 
-      state->content_length = content_length;
+      if (r == 0)
+        {
+          if (available >= MAX_HEADER_SIZE)
+            {
+              g_task_return_new_error (task,
+                                       G_IO_ERROR,
+                                       G_IO_ERROR_INVALID_DATA,
+                                       "Headers from peer are too large");
+              g_object_unref (task);
+              return;
+            }
+
+          jsonrpc_input_stream_fill (task, MAX (available + 1, DEFAULT_BUFFER_SIZE));
+          return;
+        }
+    }
+
+  if (state->use_gvariant)
+    {
+      jsonrpc_input_stream_read_gvariant (task);
+      return;
+    }
+
+  required = state->header_length + state->content_length;
+
+  if (available < required)
+    {
+      jsonrpc_input_stream_fill (task, required);
+      return;
+    }
+
+  body = data + state->header_length;
+
+  if G_UNLIKELY (jsonrpc_input_stream_debug)
+    g_message ("<<< %.*s", (gint)state->content_length, body);
+
+  parser = json_parser_new_immutable ();
+
+  if (!json_parser_load_from_data (parser, body, state->content_length, &error))
+    {
+      /* Drop the message so the stream can still make progress. */
+      g_input_stream_skip (G_INPUT_STREAM (self), required, NULL, NULL);
+      g_task_return_error (task, g_steal_pointer (&error));
+      g_object_unref (task);
+      return;
     }
 
   /*
-   * If we are at the end of the headers, we can make progress towards
-   * parsing the JSON content. Otherwise we need to continue parsing
-   * the next header.
+   * The message is fully parsed, so it is now safe to consume it from
+   * the buffer. The skip is satisfied entirely from buffered data and
+   * therefore never blocks.
    */
+  g_input_stream_skip (G_INPUT_STREAM (self), required, NULL, NULL);
 
-  if (line[0] == '\0')
+  if (NULL == (root = json_parser_get_root (parser)))
     {
-      if (state->content_length <= 0)
-        {
-          g_task_return_new_error (task,
-                                   G_IO_ERROR,
-                                   G_IO_ERROR_INVALID_DATA,
-                                   "Invalid or missing Content-Length header from peer");
-          return;
-        }
-
-      state->buffer = g_malloc (state->content_length + 1);
-      g_input_stream_read_all_async (G_INPUT_STREAM (self),
-                                     state->buffer,
-                                     state->content_length,
-                                     state->priority,
-                                     cancellable,
-                                     jsonrpc_input_stream_read_body_cb,
-                                     g_steal_pointer (&task));
+      /*
+       * If we get back a NULL root node, that means that we got
+       * a short read (such as a closed stream).
+       */
+      g_task_return_new_error (task,
+                               G_IO_ERROR,
+                               G_IO_ERROR_CLOSED,
+                               "The peer did not send a reply");
+      g_object_unref (task);
       return;
     }
 
-  g_data_input_stream_read_line_async (G_DATA_INPUT_STREAM (self),
-                                       state->priority,
-                                       cancellable,
-                                       jsonrpc_input_stream_read_headers_cb,
-                                       g_steal_pointer (&task));
+  /*
+   * Nodes from an immutable parser are sealed, so we can simply take a
+   * reference instead of performing a deep copy of the tree.
+   */
+  g_task_return_pointer (task, json_node_ref (root), (GDestroyNotify)json_node_unref);
+  g_object_unref (task);
 }
 
-void
-jsonrpc_input_stream_read_message_async (JsonrpcInputStream  *self,
-                                         GCancellable        *cancellable,
-                                         GAsyncReadyCallback  callback,
-                                         gpointer             user_data)
+/*
+ * The task resolves to a GVariant for messages encoded as GVariant and to
+ * a JsonNode otherwise. The finish functions convert only when the caller
+ * asked for the other representation.
+ */
+static void
+jsonrpc_input_stream_read_async (JsonrpcInputStream  *self,
+                                 gpointer             source_tag,
+                                 GCancellable        *cancellable,
+                                 GAsyncReadyCallback  callback,
+                                 gpointer             user_data)
 {
-  g_autoptr(GTask) task = NULL;
+  GTask *task;
   ReadState *state;
 
-  g_return_if_fail (JSONRPC_IS_INPUT_STREAM (self));
-  g_return_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable));
+  g_assert (JSONRPC_IS_INPUT_STREAM (self));
+  g_assert (!cancellable || G_IS_CANCELLABLE (cancellable));
 
   state = g_slice_new0 (ReadState);
   state->content_length = -1;
   state->priority = G_PRIORITY_DEFAULT;
 
   task = g_task_new (self, cancellable, callback, user_data);
-  g_task_set_source_tag (task, jsonrpc_input_stream_read_message_async);
+  g_task_set_source_tag (task, source_tag);
   g_task_set_task_data (task, state, read_state_free);
 
-  g_data_input_stream_read_line_async (G_DATA_INPUT_STREAM (self),
-                                       state->priority,
-                                       cancellable,
-                                       jsonrpc_input_stream_read_headers_cb,
-                                       g_steal_pointer (&task));
+  jsonrpc_input_stream_pump (task);
+}
+
+void
+jsonrpc_input_stream_read_message_async (JsonrpcInputStream  *self,
+                                         GCancellable        *cancellable,
+                                         GAsyncReadyCallback  callback,
+                                         gpointer             user_data)
+{
+  g_return_if_fail (JSONRPC_IS_INPUT_STREAM (self));
+  g_return_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+  jsonrpc_input_stream_read_async (self,
+                                   jsonrpc_input_stream_read_message_async,
+                                   cancellable,
+                                   callback,
+                                   user_data);
 }
 
 gboolean
@@ -262,18 +560,188 @@ jsonrpc_input_stream_read_message_finish (JsonrpcInputStream  *self,
                                           GError             **error)
 {
   g_autoptr(JsonNode) local_node = NULL;
-  gboolean ret;
+  ReadState *state;
+  gpointer ret;
 
   g_return_val_if_fail (JSONRPC_IS_INPUT_STREAM (self), FALSE);
   g_return_val_if_fail (G_IS_TASK (result), FALSE);
 
-  local_node = g_task_propagate_pointer (G_TASK (result), error);
-  ret = local_node != NULL;
+  state = g_task_get_task_data (G_TASK (result));
+
+  if (NULL == (ret = g_task_propagate_pointer (G_TASK (result), error)))
+    return FALSE;
+
+  if (state->use_gvariant)
+    {
+      g_autoptr(GVariant) message = ret;
+
+      local_node = json_gvariant_serialize (message);
+    }
+  else
+    local_node = ret;
 
   if (node != NULL)
     *node = g_steal_pointer (&local_node);
 
-  return ret;
+  return TRUE;
+}
+
+/**
+ * jsonrpc_input_stream_read_variant_async:
+ * @self: a #JsonrpcInputStream
+ * @cancellable: (nullable): a #GCancellable or %NULL
+ * @callback: a callback to execute upon completion
+ * @user_data: user data for @callback
+ *
+ * Reads the next message from the peer as a #GVariant. Messages encoded as
+ * #GVariant by the peer are provided without being copied or converted.
+ * JSON messages are converted with json_gvariant_deserialize().
+ */
+void
+jsonrpc_input_stream_read_variant_async (JsonrpcInputStream  *self,
+                                         GCancellable        *cancellable,
+                                         GAsyncReadyCallback  callback,
+                                         gpointer             user_data)
+{
+  g_return_if_fail (JSONRPC_IS_INPUT_STREAM (self));
+  g_return_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+  jsonrpc_input_stream_read_async (self,
+                                   jsonrpc_input_stream_read_variant_async,
+                                   cancellable,
+                                   callback,
+                                   user_data);
+}
+
+/**
+ * jsonrpc_input_stream_read_variant_finish:
+ * @self: a #JsonrpcInputStream
+ * @result: a #GAsyncResult
+ * @message: (out) (optional) (transfer full): a location for the message
+ * @error: a location for a #GError, or %NULL
+ *
+ * Completes a request to jsonrpc_input_stream_read_variant_async().
+ *
+ * Returns: %TRUE if a message was read, otherwise %FALSE and @error is set.
+ */
+gboolean
+jsonrpc_input_stream_read_variant_finish (JsonrpcInputStream  *self,
+                                          GAsyncResult        *result,
+                                          GVariant           **message,
+                                          GError             **error)
+{
+  g_autoptr(GVariant) local_message = NULL;
+  ReadState *state;
+  gpointer ret;
+
+  g_return_val_if_fail (JSONRPC_IS_INPUT_STREAM (self), FALSE);
+  g_return_val_if_fail (G_IS_TASK (result), FALSE);
+
+  state = g_task_get_task_data (G_TASK (result));
+
+  if (NULL == (ret = g_task_propagate_pointer (G_TASK (result), error)))
+    return FALSE;
+
+  if (!state->use_gvariant)
+    {
+      g_autoptr(JsonNode) node = ret;
+
+      if (NULL == (local_message = json_gvariant_deserialize (node, NULL, error)))
+        return FALSE;
+
+      g_variant_take_ref (local_message);
+    }
+  else
+    local_message = ret;
+
+  if (message != NULL)
+    *message = g_steal_pointer (&local_message);
+
+  return TRUE;
+}
+
+/**
+ * jsonrpc_input_stream_read_any_async:
+ * @self: a #JsonrpcInputStream
+ * @cancellable: (nullable): a #GCancellable or %NULL
+ * @callback: a callback to execute upon completion
+ * @user_data: user data for @callback
+ *
+ * Reads the next message from the peer in the encoding the peer used,
+ * so that neither JSON nor #GVariant messages are converted. This is
+ * useful for consumers that can handle both representations.
+ */
+void
+jsonrpc_input_stream_read_any_async (JsonrpcInputStream  *self,
+                                     GCancellable        *cancellable,
+                                     GAsyncReadyCallback  callback,
+                                     gpointer             user_data)
+{
+  g_return_if_fail (JSONRPC_IS_INPUT_STREAM (self));
+  g_return_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+  jsonrpc_input_stream_read_async (self,
+                                   jsonrpc_input_stream_read_any_async,
+                                   cancellable,
+                                   callback,
+                                   user_data);
+}
+
+/**
+ * jsonrpc_input_stream_read_any_finish:
+ * @self: a #JsonrpcInputStream
+ * @result: a #GAsyncResult
+ * @node: (out) (optional) (transfer full): a location for a JSON message
+ * @message: (out) (optional) (transfer full): a location for a #GVariant message
+ * @error: a location for a #GError, or %NULL
+ *
+ * Completes a request to jsonrpc_input_stream_read_any_async().
+ *
+ * Upon success, @node is set if the peer sent JSON text and @message is
+ * set if the peer sent a #GVariant. The other location is set to %NULL.
+ *
+ * Returns: %TRUE if a message was read, otherwise %FALSE and @error is set.
+ */
+gboolean
+jsonrpc_input_stream_read_any_finish (JsonrpcInputStream  *self,
+                                      GAsyncResult        *result,
+                                      JsonNode           **node,
+                                      GVariant           **message,
+                                      GError             **error)
+{
+  ReadState *state;
+  gpointer ret;
+
+  g_return_val_if_fail (JSONRPC_IS_INPUT_STREAM (self), FALSE);
+  g_return_val_if_fail (G_IS_TASK (result), FALSE);
+
+  if (node != NULL)
+    *node = NULL;
+
+  if (message != NULL)
+    *message = NULL;
+
+  state = g_task_get_task_data (G_TASK (result));
+
+  if (NULL == (ret = g_task_propagate_pointer (G_TASK (result), error)))
+    return FALSE;
+
+  if (state->use_gvariant)
+    {
+      if (message != NULL)
+        *message = ret;
+      else
+        g_variant_unref (ret);
+    }
+  else
+    {
+      if (node != NULL)
+        *node = ret;
+      else
+        json_node_unref (ret);
+    }
+
+  return TRUE;
 }
 
 static void
@@ -331,3 +799,87 @@ jsonrpc_input_stream_read_message (JsonrpcInputStream  *self,
   return ret;
 }
 
+static void
+jsonrpc_input_stream_read_variant_sync_cb (GObject      *object,
+                                           GAsyncResult *result,
+                                           gpointer      user_data)
+{
+  JsonrpcInputStream *self = (JsonrpcInputStream *)object;
+  g_autoptr(GError) error = NULL;
+  g_autoptr(GVariant) message = NULL;
+  GTask *task = user_data;
+
+  g_assert (JSONRPC_IS_INPUT_STREAM (self));
+  g_assert (G_IS_TASK (task));
+
+  if (!jsonrpc_input_stream_read_variant_finish (self, result, &message, &error))
+    g_task_return_error (task, g_steal_pointer (&error));
+  else
+    g_task_return_pointer (task, g_steal_pointer (&message), (GDestroyNotify)g_variant_unref);
+}
+
+/**
+ * jsonrpc_input_stream_read_variant:
+ * @self: a #JsonrpcInputStream
+ * @cancellable: (nullable): a #GCancellable or %NULL
+ * @message: (out) (optional) (transfer full): a location for the message
+ * @error: a location for a #GError, or %NULL
+ *
+ * Synchronous version of jsonrpc_input_stream_read_variant_async().
+ *
+ * Returns: %TRUE if a message was read, otherwise %FALSE and @error is set.
+ */
+gboolean
+jsonrpc_input_stream_read_variant (JsonrpcInputStream  *self,
+                                   GCancellable        *cancellable,
+                                   GVariant           **message,
+                                   GError             **error)
+{
+  g_autoptr(GMainContext) main_context = NULL;
+  g_autoptr(GVariant) local_message = NULL;
+  g_autoptr(GTask) task = NULL;
+  gboolean ret;
+
+  g_return_val_if_fail (JSONRPC_IS_INPUT_STREAM (self), FALSE);
+  g_return_val_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable), FALSE);
+
+  main_context = g_main_context_ref_thread_default ();
+
+  task = g_task_new (NULL, NULL, NULL, NULL);
+  g_task_set_source_tag (task, jsonrpc_input_stream_read_variant);
+
+  jsonrpc_input_stream_read_variant_async (self,
+                                           cancellable,
+                                           jsonrpc_input_stream_read_variant_sync_cb,
+                                           task);
+
+  while (!g_task_get_completed (task))
+    g_main_context_iteration (main_context, TRUE);
+
+  local_message = g_task_propagate_pointer (task, error);
+  ret = local_message != NULL;
+
+  if (message != NULL)
+    *message = g_steal_pointer (&local_message);
+
+  return ret;
+}
+
+/**
+ * jsonrpc_input_stream_get_has_seen_gvariant:
+ * @self: a #JsonrpcInputStream
+ *
+ * Checks if the peer has sent us a message encoded as a #GVariant rather
+ * than JSON text. Peers that do so can also accept #GVariant messages.
+ *
+ * Returns: %TRUE if a #GVariant message has been received.
+ */
+gboolean
+jsonrpc_input_stream_get_has_seen_gvariant (JsonrpcInputStream *self)
+{
+  JsonrpcInputStreamPrivate *priv = jsonrpc_input_stream_get_instance_private (self);
+
+  g_return_val_if_fail (JSONRPC_IS_INPUT_STREAM (self), FALSE);
+
+  return priv->has_seen_gvariant;
+}
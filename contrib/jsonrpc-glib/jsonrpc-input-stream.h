@@ -42,19 +42,41 @@ struct _JsonrpcInputStreamClass
   gpointer _reserved8;
 };
 
-JsonrpcInputStream *jsonrpc_input_stream_new                 (GInputStream         *base_stream);
-gboolean            jsonrpc_input_stream_read_message        (JsonrpcInputStream   *self,
-                                                              GCancellable         *cancellable,
-                                                              JsonNode            **node,
-                                                              GError              **error);
-void                jsonrpc_input_stream_read_message_async  (JsonrpcInputStream   *self,
-                                                              GCancellable         *cancellable,
-                                                              GAsyncReadyCallback   callback,
-                                                              gpointer              user_data);
-gboolean            jsonrpc_input_stream_read_message_finish (JsonrpcInputStream   *self,
-                                                              GAsyncResult         *result,
-                                                              JsonNode            **node,
-                                                              GError              **error);
+JsonrpcInputStream *jsonrpc_input_stream_new                   (GInputStream         *base_stream);
+gboolean            jsonrpc_input_stream_read_message          (JsonrpcInputStream   *self,
+                                                                GCancellable         *cancellable,
+                                                                JsonNode            **node,
+                                                                GError              **error);
+void                jsonrpc_input_stream_read_message_async    (JsonrpcInputStream   *self,
+                                                                GCancellable         *cancellable,
+                                                                GAsyncReadyCallback   callback,
+                                                                gpointer              user_data);
+gboolean            jsonrpc_input_stream_read_message_finish   (JsonrpcInputStream   *self,
+                                                                GAsyncResult         *result,
+                                                                JsonNode            **node,
+                                                                GError              **error);
+gboolean            jsonrpc_input_stream_read_variant          (JsonrpcInputStream   *self,
+                                                                GCancellable         *cancellable,
+                                                                GVariant            **message,
+                                                                GError              **error);
+void                jsonrpc_input_stream_read_variant_async    (JsonrpcInputStream   *self,
+                                                                GCancellable         *cancellable,
+                                                                GAsyncReadyCallback   callback,
+                                                                gpointer              user_data);
+gboolean            jsonrpc_input_stream_read_variant_finish   (JsonrpcInputStream   *self,
+                                                                GAsyncResult         *result,
+                                                                GVariant            **message,
+                                                                GError              **error);
+void                jsonrpc_input_stream_read_any_async        (JsonrpcInputStream   *self,
+                                                                GCancellable         *cancellable,
+                                                                GAsyncReadyCallback   callback,
+                                                                gpointer              user_data);
+gboolean            jsonrpc_input_stream_read_any_finish       (JsonrpcInputStream   *self,
+                                                                GAsyncResult         *result,
+                                                                JsonNode            **node,
+                                                                GVariant            **message,
+                                                                GError              **error);
+gboolean            jsonrpc_input_stream_get_has_seen_gvariant (JsonrpcInputStream   *self);
 
 G_END_DECLS
 
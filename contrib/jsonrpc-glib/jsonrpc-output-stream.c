@@ -23,13 +23,33 @@
 #include "jsonrpc-output-stream.h"
 #include "jsonrpc-version.h"
 
+/*
+ * Enough room to hold "Content-Length: " followed by the largest possible
+ * gsize in decimal and the trailing "\r\n\r\n". We reserve this at the
+ * front of the message buffer and serialize the body directly after it,
+ * so the header can be written in place once the body length is known.
+ */
+#define HEADER_RESERVE (sizeof "Content-Length: \r\n\r\n" - 1 + 20)
+
+#define GVARIANT_CONTENT_TYPE "application/gvariant"
+
 typedef struct
 {
   GQueue queue;
+  gsize  size_hint;
+  guint  use_gvariant : 1;
 } JsonrpcOutputStreamPrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE (JsonrpcOutputStream, jsonrpc_output_stream, G_TYPE_DATA_OUTPUT_STREAM)
 
+enum {
+  PROP_0,
+  PROP_USE_GVARIANT,
+  N_PROPS
+};
+
+static GParamSpec *properties [N_PROPS];
+
 static void jsonrpc_output_stream_write_message_async_cb (GObject      *object,
                                                           GAsyncResult *result,
                                                           gpointer      user_data);
@@ -48,12 +68,61 @@ jsonrpc_output_stream_finalize (GObject *object)
   G_OBJECT_CLASS (jsonrpc_output_stream_parent_class)->finalize (object);
 }
 
+static void
+jsonrpc_output_stream_get_property (GObject    *object,
+                                    guint       prop_id,
+                                    GValue     *value,
+                                    GParamSpec *pspec)
+{
+  JsonrpcOutputStream *self = JSONRPC_OUTPUT_STREAM (object);
+
+  switch (prop_id)
+    {
+    case PROP_USE_GVARIANT:
+      g_value_set_boolean (value, jsonrpc_output_stream_get_use_gvariant (self));
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+jsonrpc_output_stream_set_property (GObject      *object,
+                                    guint         prop_id,
+                                    const GValue *value,
+                                    GParamSpec   *pspec)
+{
+  JsonrpcOutputStream *self = JSONRPC_OUTPUT_STREAM (object);
+
+  switch (prop_id)
+    {
+    case PROP_USE_GVARIANT:
+      jsonrpc_output_stream_set_use_gvariant (self, g_value_get_boolean (value));
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
 static void
 jsonrpc_output_stream_class_init (JsonrpcOutputStreamClass *klass)
 {
   GObjectClass *object_class = G_OBJECT_CLASS (klass);
 
   object_class->finalize = jsonrpc_output_stream_finalize;
+  object_class->get_property = jsonrpc_output_stream_get_property;
+  object_class->set_property = jsonrpc_output_stream_set_property;
+
+  properties [PROP_USE_GVARIANT] =
+    g_param_spec_boolean ("use-gvariant",
+                          "Use GVariant",
+                          "If messages should be encoded as GVariant",
+                          FALSE,
+                          (G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_properties (object_class, N_PROPS, properties);
 
   jsonrpc_output_stream_debug = !!g_getenv ("JSONRPC_DEBUG");
 }
@@ -66,13 +135,69 @@ jsonrpc_output_stream_init (JsonrpcOutputStream *self)
   g_queue_init (&priv->queue);
 }
 
+/*
+ * Frames @variant as a GVariant of type "v". The GVariant is stored
+ * directly into the message buffer after the headers, so the only copy
+ * is the one performed by g_variant_store().
+ */
+static GBytes *
+jsonrpc_output_stream_create_gvariant_bytes (JsonrpcOutputStream  *self,
+                                             GVariant             *variant,
+                                             GError              **error)
+{
+  g_autoptr(GVariant) message = NULL;
+  g_autofree gchar *header = NULL;
+  gchar *buffer;
+  gsize header_len;
+  gsize body_len;
+
+  g_assert (JSONRPC_IS_OUTPUT_STREAM (self));
+  g_assert (variant != NULL);
+
+  if (!g_variant_is_of_type (variant, G_VARIANT_TYPE_VARDICT) &&
+      !g_variant_is_of_type (variant, G_VARIANT_TYPE ("av")))
+    {
+      g_set_error (error,
+                   G_IO_ERROR,
+                   G_IO_ERROR_INVAL,
+                   "message must be of type a{sv} or av");
+      return NULL;
+    }
+
+  message = g_variant_ref_sink (g_variant_new_variant (variant));
+  body_len = g_variant_get_size (message);
+
+  if G_UNLIKELY (jsonrpc_output_stream_debug)
+    {
+      g_autofree gchar *str = g_variant_print (message, TRUE);
+      g_message (">>> %s", str);
+    }
+
+  header = g_strdup_printf ("Content-Length: %"G_GSIZE_FORMAT"\r\n"
+                            "Content-Type: "GVARIANT_CONTENT_TYPE"\r\n"
+                            "\r\n",
+                            body_len);
+  header_len = strlen (header);
+
+  buffer = g_malloc (header_len + body_len);
+  memcpy (buffer, header, header_len);
+  g_variant_store (message, buffer + header_len);
+
+  return g_bytes_new_take (buffer, header_len + body_len);
+}
+
 static GBytes *
 jsonrpc_output_stream_create_bytes (JsonrpcOutputStream  *self,
                                     JsonNode             *node,
                                     GError              **error)
 {
-  g_autofree gchar *str = NULL;
+  JsonrpcOutputStreamPrivate *priv = jsonrpc_output_stream_get_instance_private (self);
+  g_autoptr(GBytes) bytes = NULL;
+  gchar header[HEADER_RESERVE + 1];
   GString *message;
+  gsize header_len;
+  gsize body_len;
+  gsize offset;
   gsize len;
 
   g_assert (JSONRPC_IS_OUTPUT_STREAM (self));
@@ -87,25 +212,61 @@ jsonrpc_output_stream_create_bytes (JsonrpcOutputStream  *self,
       return FALSE;
     }
 
-  str = json_to_string (node, FALSE);
-  len = strlen (str);
+  if (priv->use_gvariant)
+    {
+      g_autoptr(GVariant) variant = NULL;
 
-  if G_UNLIKELY (jsonrpc_output_stream_debug)
-    g_message (">>> %s", str);
+      /* Only callers of the JsonNode API pay for the conversion */
+      if (NULL == (variant = json_gvariant_deserialize (node, NULL, error)))
+        return NULL;
+
+      g_variant_take_ref (variant);
+
+      return jsonrpc_output_stream_create_gvariant_bytes (self, variant, error);
+    }
 
   /*
-   * Try to allocate our buffer in a single shot. Sadly we can't serialize
-   * JsonNode directly into a GString or we could remove the double
-   * allocation going on here.
+   * Allocate our buffer in a single shot, sized from the previous message
+   * so that runs of similarly sized replies do not need to grow the buffer while
+   * serializing. The header is written into space reserved in front of
+   * the body, which avoids a second buffer for the framing.
    */
-  message = g_string_sized_new (len + 32);
+  message = g_string_sized_new (HEADER_RESERVE + priv->size_hint);
+  g_string_set_size (message, HEADER_RESERVE);
+
+#if JSON_CHECK_VERSION(1, 4, 0)
+  {
+    g_autoptr(JsonGenerator) generator = json_generator_new ();
+
+    json_generator_set_root (generator, node);
+    json_generator_to_gstring (generator, message);
+  }
+#else
+  {
+    g_autofree gchar *str = json_to_string (node, FALSE);
+
+    g_string_append (message, str);
+  }
+#endif
+
+  body_len = message->len - HEADER_RESERVE;
+  priv->size_hint = body_len + 1;
+
+  if G_UNLIKELY (jsonrpc_output_stream_debug)
+    g_message (">>> %.*s", (gint)body_len, message->str + HEADER_RESERVE);
+
+  header_len = g_snprintf (header, sizeof header,
+                           "Content-Length: %"G_GSIZE_FORMAT"\r\n\r\n",
+                           body_len);
+  g_assert (header_len <= HEADER_RESERVE);
 
-  g_string_append_printf (message, "Content-Length: %"G_GSIZE_FORMAT"\r\n\r\n", len);
-  g_string_append_len (message, str, len);
+  offset = HEADER_RESERVE - header_len;
+  memcpy (message->str + offset, header, header_len);
 
   len = message->len;
+  bytes = g_bytes_new_take (g_string_free (message, FALSE), len);
 
-  return g_bytes_new_take (g_string_free (message, FALSE), len);
+  return g_bytes_new_from_bytes (bytes, offset, len - offset);
 }
 
 JsonrpcOutputStream *
@@ -214,6 +375,29 @@ jsonrpc_output_stream_write_message_async_cb (GObject      *object,
   jsonrpc_output_stream_pump (self);
 }
 
+static void
+jsonrpc_output_stream_queue (JsonrpcOutputStream *self,
+                             GTask               *task,
+                             GBytes              *bytes,
+                             GError              *error)
+{
+  JsonrpcOutputStreamPrivate *priv = jsonrpc_output_stream_get_instance_private (self);
+
+  g_assert (JSONRPC_IS_OUTPUT_STREAM (self));
+  g_assert (G_IS_TASK (task));
+
+  if (bytes == NULL)
+    {
+      g_task_return_error (task, error);
+      g_object_unref (task);
+      return;
+    }
+
+  g_task_set_task_data (task, bytes, (GDestroyNotify)g_bytes_unref);
+  g_queue_push_tail (&priv->queue, task);
+  jsonrpc_output_stream_pump (self);
+}
+
 void
 jsonrpc_output_stream_write_message_async (JsonrpcOutputStream *self,
                                            JsonNode            *node,
@@ -221,10 +405,9 @@ jsonrpc_output_stream_write_message_async (JsonrpcOutputStream *self,
                                            GAsyncReadyCallback  callback,
                                            gpointer             user_data)
 {
-  JsonrpcOutputStreamPrivate *priv = jsonrpc_output_stream_get_instance_private (self);
-  g_autoptr(GBytes) bytes = NULL;
-  g_autoptr(GTask) task = NULL;
-  g_autoptr(GError) error = NULL;
+  GError *error = NULL;
+  GBytes *bytes;
+  GTask *task;
 
   g_return_if_fail (JSONRPC_IS_OUTPUT_STREAM (self));
   g_return_if_fail (node != NULL);
@@ -233,15 +416,138 @@ jsonrpc_output_stream_write_message_async (JsonrpcOutputStream *self,
   task = g_task_new (self, cancellable, callback, user_data);
   g_task_set_source_tag (task, jsonrpc_output_stream_write_message_async);
 
-  if (NULL == (bytes = jsonrpc_output_stream_create_bytes (self, node, &error)))
+  bytes = jsonrpc_output_stream_create_bytes (self, node, &error);
+
+  jsonrpc_output_stream_queue (self, task, bytes, error);
+}
+
+/**
+ * jsonrpc_output_stream_write_variant_async:
+ * @self: a #JsonrpcOutputStream
+ * @message: a #GVariant of type a{sv} or av
+ * @cancellable: (nullable): a #GCancellable or %NULL
+ * @callback: a callback to execute upon completion
+ * @user_data: user data for @callback
+ *
+ * Writes @message to the peer. When #JsonrpcOutputStream:use-gvariant is
+ * set, @message is framed as is without any conversion. Otherwise it is
+ * converted to JSON with json_gvariant_serialize().
+ */
+void
+jsonrpc_output_stream_write_variant_async (JsonrpcOutputStream *self,
+                                           GVariant            *message,
+                                           GCancellable        *cancellable,
+                                           GAsyncReadyCallback  callback,
+                                           gpointer             user_data)
+{
+  JsonrpcOutputStreamPrivate *priv = jsonrpc_output_stream_get_instance_private (self);
+  g_autoptr(GVariant) sunk = NULL;
+  GError *error = NULL;
+  GBytes *bytes;
+  GTask *task;
+
+  g_return_if_fail (JSONRPC_IS_OUTPUT_STREAM (self));
+  g_return_if_fail (message != NULL);
+  g_return_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+  sunk = g_variant_ref_sink (message);
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_source_tag (task, jsonrpc_output_stream_write_variant_async);
+
+  if (priv->use_gvariant)
     {
-      g_task_return_error (task, g_steal_pointer (&error));
-      return;
+      bytes = jsonrpc_output_stream_create_gvariant_bytes (self, message, &error);
     }
+  else
+    {
+      g_autoptr(JsonNode) node = json_gvariant_serialize (message);
 
-  g_task_set_task_data (task, g_steal_pointer (&bytes), (GDestroyNotify)g_bytes_unref);
-  g_queue_push_tail (&priv->queue, g_steal_pointer (&task));
-  jsonrpc_output_stream_pump (self);
+      bytes = jsonrpc_output_stream_create_bytes (self, node, &error);
+    }
+
+  jsonrpc_output_stream_queue (self, task, bytes, error);
+}
+
+/**
+ * jsonrpc_output_stream_write_variant_finish:
+ * @self: a #JsonrpcOutputStream
+ * @result: a #GAsyncResult
+ * @error: a location for a #GError, or %NULL
+ *
+ * Completes a request to jsonrpc_output_stream_write_variant_async().
+ *
+ * Returns: %TRUE if the message was written, otherwise %FALSE and @error is set.
+ */
+gboolean
+jsonrpc_output_stream_write_variant_finish (JsonrpcOutputStream  *self,
+                                            GAsyncResult         *result,
+                                            GError              **error)
+{
+  g_return_val_if_fail (JSONRPC_IS_OUTPUT_STREAM (self), FALSE);
+  g_return_val_if_fail (G_IS_TASK (result), FALSE);
+
+  return g_task_propagate_boolean (G_TASK (result), error);
+}
+
+static void
+jsonrpc_output_stream_write_variant_sync_cb (GObject      *object,
+                                             GAsyncResult *result,
+                                             gpointer      user_data)
+{
+  JsonrpcOutputStream *self = (JsonrpcOutputStream *)object;
+  GTask *task = user_data;
+  g_autoptr(GError) error = NULL;
+
+  g_assert (JSONRPC_IS_OUTPUT_STREAM (self));
+  g_assert (G_IS_ASYNC_RESULT (result));
+  g_assert (G_IS_TASK (task));
+
+  if (!jsonrpc_output_stream_write_variant_finish (self, result, &error))
+    g_task_return_error (task, g_steal_pointer (&error));
+  else
+    g_task_return_boolean (task, TRUE);
+}
+
+/**
+ * jsonrpc_output_stream_write_variant:
+ * @self: a #JsonrpcOutputStream
+ * @message: a #GVariant of type a{sv} or av
+ * @cancellable: (nullable): a #GCancellable or %NULL
+ * @error: a location for a #GError, or %NULL
+ *
+ * Synchronous version of jsonrpc_output_stream_write_variant_async().
+ *
+ * Returns: %TRUE if the message was written, otherwise %FALSE and @error is set.
+ */
+gboolean
+jsonrpc_output_stream_write_variant (JsonrpcOutputStream  *self,
+                                     GVariant             *message,
+                                     GCancellable         *cancellable,
+                                     GError              **error)
+{
+  g_autoptr(GTask) task = NULL;
+  g_autoptr(GMainContext) main_context = NULL;
+
+  g_return_val_if_fail (JSONRPC_IS_OUTPUT_STREAM (self), FALSE);
+  g_return_val_if_fail (message != NULL, FALSE);
+  g_return_val_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable), FALSE);
+
+  main_context = g_main_context_ref_thread_default ();
+
+  task = g_task_new (NULL, NULL, NULL, NULL);
+  g_task_set_source_tag (task, jsonrpc_output_stream_write_variant);
+
+  jsonrpc_output_stream_write_variant_async (self,
+                                             message,
+                                             cancellable,
+                                             jsonrpc_output_stream_write_variant_sync_cb,
+                                             task);
+
+  while (!g_task_get_completed (task))
+    g_main_context_iteration (main_context, TRUE);
+
+  return g_task_propagate_boolean (task, error);
 }
 
 gboolean
@@ -303,3 +609,50 @@ jsonrpc_output_stream_write_message (JsonrpcOutputStream  *self,
 
   return g_task_propagate_boolean (task, error);
 }
+
+/**
+ * jsonrpc_output_stream_get_use_gvariant:
+ * @self: a #JsonrpcOutputStream
+ *
+ * Gets the #JsonrpcOutputStream:use-gvariant property.
+ *
+ * Returns: %TRUE if messages are encoded as #GVariant.
+ */
+gboolean
+jsonrpc_output_stream_get_use_gvariant (JsonrpcOutputStream *self)
+{
+  JsonrpcOutputStreamPrivate *priv = jsonrpc_output_stream_get_instance_private (self);
+
+  g_return_val_if_fail (JSONRPC_IS_OUTPUT_STREAM (self), FALSE);
+
+  return priv->use_gvariant;
+}
+
+/**
+ * jsonrpc_output_stream_set_use_gvariant:
+ * @self: a #JsonrpcOutputStream
+ * @use_gvariant: if #GVariant encoding should be used
+ *
+ * Sets the #JsonrpcOutputStream:use-gvariant property.
+ *
+ * When enabled, messages are sent as serialized #GVariant with a
+ * "Content-Type: application/gvariant" header instead of JSON text.
+ * This must only be enabled when the peer is known to support it, such
+ * as helper processes that are also built upon #JsonrpcClient.
+ */
+void
+jsonrpc_output_stream_set_use_gvariant (JsonrpcOutputStream *self,
+                                        gboolean             use_gvariant)
+{
+  JsonrpcOutputStreamPrivate *priv = jsonrpc_output_stream_get_instance_private (self);
+
+  g_return_if_fail (JSONRPC_IS_OUTPUT_STREAM (self));
+
+  use_gvariant = !!use_gvariant;
+
+  if (priv->use_gvariant != use_gvariant)
+    {
+      priv->use_gvariant = use_gvariant;
+      g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_USE_GVARIANT]);
+    }
+}
@@ -47,6 +47,9 @@ struct _JsonrpcOutputStreamClass
 };
 
 JsonrpcOutputStream *jsonrpc_output_stream_new                  (GOutputStream        *base_stream);
+gboolean             jsonrpc_output_stream_get_use_gvariant     (JsonrpcOutputStream  *self);
+void                 jsonrpc_output_stream_set_use_gvariant     (JsonrpcOutputStream  *self,
+                                                                 gboolean              use_gvariant);
 gboolean             jsonrpc_output_stream_write_message        (JsonrpcOutputStream  *self,
                                                                  JsonNode             *node,
                                                                  GCancellable         *cancellable,
@@ -59,6 +62,18 @@ void                 jsonrpc_output_stream_write_message_async  (JsonrpcOutputSt
 gboolean             jsonrpc_output_stream_write_message_finish (JsonrpcOutputStream  *self,
                                                                  GAsyncResult         *result,
                                                                  GError              **error);
+gboolean             jsonrpc_output_stream_write_variant        (JsonrpcOutputStream  *self,
+                                                                 GVariant             *message,
+                                                                 GCancellable         *cancellable,
+                                                                 GError              **error);
+void                 jsonrpc_output_stream_write_variant_async  (JsonrpcOutputStream  *self,
+                                                                 GVariant             *message,
+                                                                 GCancellable         *cancellable,
+                                                                 GAsyncReadyCallback   callback,
+                                                                 gpointer              user_data);
+gboolean             jsonrpc_output_stream_write_variant_finish (JsonrpcOutputStream  *self,
+                                                                 GAsyncResult         *result,
+                                                                 GError              **error);
 
 G_END_DECLS
 
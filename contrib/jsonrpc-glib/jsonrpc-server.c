@@ -25,16 +25,26 @@
 typedef struct
 {
   GHashTable *clients;
+  guint       use_gvariant : 1;
 } JsonrpcServerPrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE (JsonrpcServer, jsonrpc_server, G_TYPE_OBJECT)
 
+enum {
+  PROP_0,
+  PROP_USE_GVARIANT,
+  N_PROPS
+};
+
 enum {
   HANDLE_CALL,
+  HANDLE_CALL_VARIANT,
   NOTIFICATION,
+  NOTIFICATION_VARIANT,
   N_SIGNALS
 };
 
+static GParamSpec *properties [N_PROPS];
 static guint signals [N_SIGNALS];
 
 static void
@@ -48,12 +58,61 @@ jsonrpc_server_finalize (GObject *object)
   G_OBJECT_CLASS (jsonrpc_server_parent_class)->finalize (object);
 }
 
+static void
+jsonrpc_server_get_property (GObject    *object,
+                             guint       prop_id,
+                             GValue     *value,
+                             GParamSpec *pspec)
+{
+  JsonrpcServer *self = JSONRPC_SERVER (object);
+
+  switch (prop_id)
+    {
+    case PROP_USE_GVARIANT:
+      g_value_set_boolean (value, jsonrpc_server_get_use_gvariant (self));
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+jsonrpc_server_set_property (GObject      *object,
+                             guint         prop_id,
+                             const GValue *value,
+                             GParamSpec   *pspec)
+{
+  JsonrpcServer *self = JSONRPC_SERVER (object);
+
+  switch (prop_id)
+    {
+    case PROP_USE_GVARIANT:
+      jsonrpc_server_set_use_gvariant (self, g_value_get_boolean (value));
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
 static void
 jsonrpc_server_class_init (JsonrpcServerClass *klass)
 {
   GObjectClass *object_class = G_OBJECT_CLASS (klass);
 
   object_class->finalize = jsonrpc_server_finalize;
+  object_class->get_property = jsonrpc_server_get_property;
+  object_class->set_property = jsonrpc_server_set_property;
+
+  properties [PROP_USE_GVARIANT] =
+    g_param_spec_boolean ("use-gvariant",
+                          "Use GVariant",
+                          "If accepted clients should encode messages as GVariant",
+                          FALSE,
+                          (G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_properties (object_class, N_PROPS, properties);
 
   signals [HANDLE_CALL] =
     g_signal_new ("handle-call",
@@ -68,6 +127,19 @@ jsonrpc_server_class_init (JsonrpcServerClass *klass)
                   JSON_TYPE_NODE,
                   JSON_TYPE_NODE);
 
+  signals [HANDLE_CALL_VARIANT] =
+    g_signal_new ("handle-call-variant",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  G_STRUCT_OFFSET (JsonrpcServerClass, handle_call_variant),
+                  g_signal_accumulator_true_handled, NULL, NULL,
+                  G_TYPE_BOOLEAN,
+                  4,
+                  JSONRPC_TYPE_CLIENT,
+                  G_TYPE_STRING | G_SIGNAL_TYPE_STATIC_SCOPE,
+                  G_TYPE_VARIANT,
+                  G_TYPE_VARIANT);
+
   signals [NOTIFICATION] =
     g_signal_new ("notification",
                   G_TYPE_FROM_CLASS (klass),
@@ -79,6 +151,18 @@ jsonrpc_server_class_init (JsonrpcServerClass *klass)
                   JSONRPC_TYPE_CLIENT,
                   G_TYPE_STRING | G_SIGNAL_TYPE_STATIC_SCOPE,
                   JSON_TYPE_NODE);
+
+  signals [NOTIFICATION_VARIANT] =
+    g_signal_new ("notification-variant",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  G_STRUCT_OFFSET (JsonrpcServerClass, notification_variant),
+                  g_signal_accumulator_true_handled, NULL, NULL,
+                  G_TYPE_BOOLEAN,
+                  3,
+                  JSONRPC_TYPE_CLIENT,
+                  G_TYPE_STRING | G_SIGNAL_TYPE_STATIC_SCOPE,
+                  G_TYPE_VARIANT);
 }
 
 static void
@@ -102,7 +186,7 @@ jsonrpc_server_client_handle_call (JsonrpcServer *self,
                                    JsonNode      *params,
                                    JsonrpcClient *client)
 {
-  gboolean ret;
+  gboolean ret = FALSE;
 
   g_assert (JSONRPC_IS_SERVER (self));
   g_assert (method != NULL);
@@ -129,6 +213,44 @@ jsonrpc_server_client_notification (JsonrpcServer *self,
   g_signal_emit (self, signals [NOTIFICATION], 0, client, method, params);
 }
 
+static gboolean
+jsonrpc_server_client_handle_call_variant (JsonrpcServer *self,
+                                           const gchar   *method,
+                                           GVariant      *id,
+                                           GVariant      *params,
+                                           JsonrpcClient *client)
+{
+  gboolean ret = FALSE;
+
+  g_assert (JSONRPC_IS_SERVER (self));
+  g_assert (method != NULL);
+  g_assert (id != NULL);
+  g_assert (params != NULL);
+  g_assert (JSONRPC_IS_CLIENT (client));
+
+  g_signal_emit (self, signals [HANDLE_CALL_VARIANT], 0, client, method, id, params, &ret);
+
+  return ret;
+}
+
+static gboolean
+jsonrpc_server_client_notification_variant (JsonrpcServer *self,
+                                            const gchar   *method,
+                                            GVariant      *params,
+                                            JsonrpcClient *client)
+{
+  gboolean ret = FALSE;
+
+  g_assert (JSONRPC_IS_SERVER (self));
+  g_assert (method != NULL);
+  g_assert (params != NULL);
+  g_assert (JSONRPC_IS_CLIENT (client));
+
+  g_signal_emit (self, signals [NOTIFICATION_VARIANT], 0, client, method, params, &ret);
+
+  return ret;
+}
+
 void
 jsonrpc_server_accept_io_stream (JsonrpcServer *self,
                                  GIOStream     *io_stream)
@@ -140,6 +262,24 @@ jsonrpc_server_accept_io_stream (JsonrpcServer *self,
   g_return_if_fail (G_IS_IO_STREAM (io_stream));
 
   client = jsonrpc_client_new (io_stream);
+  jsonrpc_client_set_use_gvariant (client, priv->use_gvariant);
+
+  /*
+   * The GVariant signals are only emitted for clients using GVariant
+   * encoding. Messages the server does not handle there are converted
+   * by the client and delivered through the JsonNode signals.
+   */
+  g_signal_connect_object (client,
+                           "handle-call-variant",
+                           G_CALLBACK (jsonrpc_server_client_handle_call_variant),
+                           self,
+                           G_CONNECT_SWAPPED);
+
+  g_signal_connect_object (client,
+                           "notification-variant",
+                           G_CALLBACK (jsonrpc_server_client_notification_variant),
+                           self,
+                           G_CONNECT_SWAPPED);
 
   g_signal_connect_object (client,
                            "handle-call",
@@ -157,3 +297,47 @@ jsonrpc_server_accept_io_stream (JsonrpcServer *self,
 
   jsonrpc_client_start_listening (client);
 }
+
+/**
+ * jsonrpc_server_get_use_gvariant:
+ * @self: a #JsonrpcServer
+ *
+ * Gets the #JsonrpcServer:use-gvariant property.
+ *
+ * Returns: %TRUE if accepted clients encode messages as #GVariant.
+ */
+gboolean
+jsonrpc_server_get_use_gvariant (JsonrpcServer *self)
+{
+  JsonrpcServerPrivate *priv = jsonrpc_server_get_instance_private (self);
+
+  g_return_val_if_fail (JSONRPC_IS_SERVER (self), FALSE);
+
+  return priv->use_gvariant;
+}
+
+/**
+ * jsonrpc_server_set_use_gvariant:
+ * @self: a #JsonrpcServer
+ * @use_gvariant: if #GVariant encoding should be used
+ *
+ * Sets the #JsonrpcServer:use-gvariant property, which is applied to
+ * the #JsonrpcClient of every stream accepted afterwards. See
+ * jsonrpc_client_set_use_gvariant() for when this is appropriate.
+ */
+void
+jsonrpc_server_set_use_gvariant (JsonrpcServer *self,
+                                 gboolean       use_gvariant)
+{
+  JsonrpcServerPrivate *priv = jsonrpc_server_get_instance_private (self);
+
+  g_return_if_fail (JSONRPC_IS_SERVER (self));
+
+  use_gvariant = !!use_gvariant;
+
+  if (priv->use_gvariant != use_gvariant)
+    {
+      priv->use_gvariant = use_gvariant;
+      g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_USE_GVARIANT]);
+    }
+}
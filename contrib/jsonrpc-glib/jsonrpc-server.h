@@ -43,6 +43,15 @@ struct _JsonrpcServerClass
                             JsonrpcClient *client,
                             const gchar   *method,
                             JsonNode      *params);
+  gboolean (*handle_call_variant)  (JsonrpcServer *self,
+                                    JsonrpcClient *client,
+                                    const gchar   *method,
+                                    GVariant      *id,
+                                    GVariant      *params);
+  gboolean (*notification_variant) (JsonrpcServer *self,
+                                    JsonrpcClient *client,
+                                    const gchar   *method,
+                                    GVariant      *params);
 
   gpointer _reserved1;
   gpointer _reserved2;
@@ -50,13 +59,14 @@ struct _JsonrpcServerClass
   gpointer _reserved4;
   gpointer _reserved5;
   gpointer _reserved6;
-  gpointer _reserved7;
-  gpointer _reserved8;
 };
 
 JsonrpcServer *jsonrpc_server_new              (void);
 void           jsonrpc_server_accept_io_stream (JsonrpcServer *self,
                                                 GIOStream     *stream);
+gboolean       jsonrpc_server_get_use_gvariant (JsonrpcServer *self);
+void           jsonrpc_server_set_use_gvariant (JsonrpcServer *self,
+                                                gboolean       use_gvariant);
 
 G_END_DECLS
 
@@ -0,0 +1,185 @@
+/* static-dict.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "static-dict.h"
+
+/**
+ * SECTION:static-dict
+ * @title: StaticDict
+ * @short_description: A sorted word list compiled at build time.
+ *
+ * #StaticDict is a read-only dictionary for vocabularies which are known at
+ * build time, such as the elements of a markup language. There is nothing
+ * to build at runtime, the dictionary is used in place from read-only data.
+ *
+ * The data is a sequence of records of the form "section\tword\0", sorted
+ * bytewise. Since a tab sorts before any character allowed in a section
+ * name, the records of a section are contiguous, and so are the words of a
+ * section sharing a prefix. Lookups find the first and last matching record
+ * by binary search over the bytes, moving back to the start of a record
+ * whenever the search lands in the middle of one.
+ *
+ * Use build/autotools/Makefile.am.static-dict to generate the data from a
+ * .dict file, then STATIC_DICT_INIT() to initialize a #StaticDict from it.
+ */
+
+/*
+ * Compares @record against "@section\t@prefix". A record starting with the
+ * key compares equal to it.
+ */
+static gint
+compare_record (const gchar *record,
+                const gchar *section,
+                const gchar *prefix)
+{
+  const guchar *r = (const guchar *)record;
+  const guchar *k;
+
+  for (k = (const guchar *)section; *k; k++, r++)
+    {
+      if (*r != *k)
+        return (gint)*r - (gint)*k;
+    }
+
+  if (*r != '\t')
+    return (gint)*r - (gint)'\t';
+
+  r++;
+
+  for (k = (const guchar *)prefix; *k; k++, r++)
+    {
+      if (*r != *k)
+        return (gint)*r - (gint)*k;
+    }
+
+  return 0;
+}
+
+/*
+ * Returns the first record comparing greater than or equal to the key, or
+ * when @upper is set, the first record comparing greater than it.
+ */
+static const gchar *
+static_dict_bound (const StaticDict *dict,
+                   const gchar      *section,
+                   const gchar      *prefix,
+                   gboolean          upper)
+{
+  const gchar *lo = dict->data;
+  const gchar *hi = dict->data + dict->len;
+
+  while (lo < hi)
+    {
+      const gchar *mid = lo + (hi - lo) / 2;
+      gint cmp;
+
+      while (mid > lo && mid [-1] != '\0')
+        mid--;
+
+      cmp = compare_record (mid, section, prefix);
+
+      if (cmp < 0 || (upper && cmp == 0))
+        lo = mid + strlen (mid) + 1;
+      else
+        hi = mid;
+    }
+
+  return lo;
+}
+
+/**
+ * static_dict_iter_init:
+ * @iter: A #StaticDictIter
+ * @dict: A #StaticDict
+ * @section: the section to search
+ * @prefix: the prefix of the words to iterate
+ *
+ * Initializes @iter to iterate, in sorted order, the words of @section in
+ * @dict starting with @prefix. Use an empty @prefix for every word.
+ */
+void
+static_dict_iter_init (StaticDictIter   *iter,
+                       const StaticDict *dict,
+                       const gchar      *section,
+                       const gchar      *prefix)
+{
+  g_return_if_fail (iter != NULL);
+  g_return_if_fail (dict != NULL);
+  g_return_if_fail (section != NULL);
+  g_return_if_fail (prefix != NULL);
+
+  iter->pos = static_dict_bound (dict, section, prefix, FALSE);
+  iter->end = static_dict_bound (dict, section, prefix, TRUE);
+  iter->skip = strlen (section) + 1;
+}
+
+/**
+ * static_dict_iter_next:
+ * @iter: A #StaticDictIter
+ * @word: (out): a location for the word
+ *
+ * Moves @iter to the next word. @word points into the dictionary data and
+ * remains valid for as long as the data does.
+ *
+ * Returns: %TRUE if @word was set, %FALSE when there are no more words.
+ */
+gboolean
+static_dict_iter_next (StaticDictIter  *iter,
+                       const gchar    **word)
+{
+  g_return_val_if_fail (iter != NULL, FALSE);
+  g_return_val_if_fail (word != NULL, FALSE);
+
+  if (iter->pos >= iter->end)
+    return FALSE;
+
+  *word = iter->pos + iter->skip;
+  iter->pos += strlen (iter->pos) + 1;
+
+  return TRUE;
+}
+
+/**
+ * static_dict_contains:
+ * @dict: A #StaticDict
+ * @section: the section to search
+ * @word: the word to find
+ *
+ * Checks if @word is in @section of @dict.
+ *
+ * Returns: %TRUE if @dict contains @word.
+ */
+gboolean
+static_dict_contains (const StaticDict *dict,
+                      const gchar      *section,
+                      const gchar      *word)
+{
+  StaticDictIter iter;
+  const gchar *found;
+
+  g_return_val_if_fail (dict != NULL, FALSE);
+  g_return_val_if_fail (section != NULL, FALSE);
+  g_return_val_if_fail (word != NULL, FALSE);
+
+  static_dict_iter_init (&iter, dict, section, word);
+
+  /* The shortest word with the prefix sorts first */
+  return static_dict_iter_next (&iter, &found) && g_str_equal (found, word);
+}
@@ -0,0 +1,57 @@
+/* static-dict.h
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef STATIC_DICT_H
+#define STATIC_DICT_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _StaticDict     StaticDict;
+typedef struct _StaticDictIter StaticDictIter;
+
+struct _StaticDict
+{
+  const gchar *data;
+  gsize        len;
+};
+
+struct _StaticDictIter
+{
+  const gchar *pos;
+  const gchar *end;
+  gsize        skip;
+};
+
+/* Initializes a StaticDict from a string literal generated at build time */
+#define STATIC_DICT_INIT(literal) { (literal), sizeof (literal) - 1 }
+
+gboolean static_dict_contains  (const StaticDict  *dict,
+                                const gchar       *section,
+                                const gchar       *word);
+void     static_dict_iter_init (StaticDictIter    *iter,
+                                const StaticDict  *dict,
+                                const gchar       *section,
+                                const gchar       *prefix);
+gboolean static_dict_iter_next (StaticDictIter    *iter,
+                                const gchar      **word);
+
+G_END_DECLS
+
+#endif /* STATIC_DICT_H */
@@ -22,15 +22,6 @@
 
 #include "trie.h"
 
-#if defined(__LP64__) || __WORDSIZE == 64
-#define TRIE_64 1
-#endif
-
-#define STATIC_ASSERT(a)                              \
-   G_STMT_START {                                     \
-      G_GNUC_UNUSED gchar static_assert[(a)? 0 : -1]; \
-   } G_STMT_END
-
 /**
  * SECTION:trie
  * @title: Trie
@@ -43,432 +34,326 @@
  * To insert a key and value pair into the #Trie use trie_insert().
  * To remove a key from the #Trie use trie_remove().
  * To traverse all children of the #Trie from a given key use trie_traverse().
+ *
+ * The trie is a radix tree. Each edge is labeled with a run of bytes rather
+ * than a single character, so chains of single-child nodes are collapsed.
+ * Nodes live in a single contiguous array and refer to each other by index,
+ * and the edge labels live in a second contiguous byte array. Once a trie
+ * has been populated, trie_freeze() may be used to lay the nodes out in
+ * breadth-first order so that siblings are adjacent in memory.
  */
 
-typedef struct _TrieNode      TrieNode;
-typedef struct _TrieNodeChunk TrieNodeChunk;
+#define TRIE_ROOT 0
+#define TRIE_NONE 0
 
-/**
- * Try to optimize for 64 bit vs 32 bit pointers. We are assuming that the
- * 32 bit also has a 32 byte cacheline. This is very likely not the case
- * everwhere, such as x86_64 compiled with -m32. However, accomidating that
- * will require some changes to the layout of each chunk.
- */
-#ifdef TRIE_64
-#define FIRST_CHUNK_KEYS         4
-#define TRIE_NODE_SIZE          64
-#define TRIE_NODE_CHUNK_SIZE    64
-#define TRIE_NODE_CHUNK_KEYS(c) (((c)->is_inline) ? 4 : 6)
-#else
-#define FIRST_CHUNK_KEYS         3
-#define TRIE_NODE_SIZE          32
-#define TRIE_NODE_CHUNK_SIZE    32
-#define TRIE_NODE_CHUNK_KEYS(c) (((c)->is_inline) ? 3 : 5)
-#endif
-
-/**
- * TrieNodeChunk:
- * @flags: Flags describing behaviors of the TrieNodeChunk.
- * @count: The number of items added to this chunk.
- * @keys: The keys for @children.
- * @next: The next #TrieNodeChunk if there is one.
- * @children: The children #TrieNodeChunk or %NULL. If the chunk is
- *   inline the TrieNode, then there will be fewer items.
- */
-#pragma pack(push, 1)
-struct _TrieNodeChunk
-{
-   TrieNodeChunk *next;
-   gboolean       is_inline : 1;
-   guint          flags : 7;
-   guint          count : 8;
-   guint8         keys[6];
-   TrieNode      *children[0];
-};
-#pragma pack(pop)
+typedef struct _TrieNode TrieNode;
 
 /**
  * TrieNode:
- * @parent: The parent #TrieNode. When a node is destroyed, it may need to
- *    walk up to the parent node and unlink itself.
  * @value: A pointer to the user provided value, or %NULL.
- * @chunk: The first chunk in the chain. Inline chunks have fewer children
- *    elements than extra allocated chunks so that they are cache aligned.
+ * @label: The offset of the edge label within the label arena.
+ * @label_len: The number of bytes in the edge label.
+ * @first_child: The index of the first child, or %TRIE_NONE.
+ * @next_sibling: The index of the next sibling, or %TRIE_NONE. Siblings are
+ *    kept sorted by the first byte of their label. Freed nodes are chained
+ *    through this field.
+ *
+ * The root node has an empty label and is always found at index 0, which
+ * is why index 0 can double as "no node" for children and siblings.
  */
-#pragma pack(push, 1)
 struct _TrieNode
 {
-   TrieNode      *parent;
-   gpointer       value;
-   TrieNodeChunk  chunk;
+   gpointer value;
+   guint32  label;
+   guint32  label_len;
+   guint32  first_child;
+   guint32  next_sibling;
 };
-#pragma pack(pop)
 
 /**
  * Trie:
  * @value_destroy: A #GDestroyNotify to free data pointers.
- * @root: The root TrieNode.
+ * @nodes: The arena of #TrieNode.
+ * @labels: The arena of edge label bytes.
+ * @free_list: The first freed node available for reuse, or %TRIE_NONE.
  */
 struct _Trie
 {
    GDestroyNotify  value_destroy;
-   TrieNode       *root;
+   GArray         *nodes;
+   GByteArray     *labels;
+   guint32         free_list;
 };
 
-/**
- * trie_malloc0:
- * @trie: A #Trie
- * @size: Number of bytes to allocate.
- *
- * Wrapper function to allocate a memory chunk. This gives us somewhere to
- * perform the abstraction if we want to use mmap()'d I/O at some point.
- * The memory will be zero'd before being returned.
- *
- * Returns: A pointer to the allocation.
- */
-static gpointer
-trie_malloc0 (Trie  *trie,
-              gsize  size)
-{
-   return g_malloc0(size);
-}
-
-/**
- * trie_free:
- * @trie: A #Trie.
- * @data: The data to free.
- *
- * Frees a portion of memory allocated by @trie.
- */
-static void
-trie_free (Trie     *trie,
-           gpointer  data)
-{
-   g_free(data);
-}
+#define NODE(t,i)  (&g_array_index((t)->nodes, TrieNode, (i)))
+#define LABEL(t,n) ((const gchar *)&(t)->labels->data[(n)->label])
 
 /**
- * trie_node_new:
+ * trie_append_label:
  * @trie: A #Trie.
- * @parent: The nodes parent or %NULL.
+ * @data: The bytes to append.
+ * @len: The number of bytes in @data.
  *
- * Create a new node that can be placed in a Trie. The node contains a chunk
- * embedded in it that may contain only 4 pointers instead of the full 6 do
- * to the overhead of the TrieNode itself.
+ * Copies @data into the label arena.
  *
- * Returns: A newly allocated TrieNode that should be freed with g_free().
+ * Returns: The offset of the copy within the arena.
  */
-TrieNode *
-trie_node_new (Trie     *trie,
-               TrieNode *parent)
+static guint32
+trie_append_label (Trie        *trie,
+                   const gchar *data,
+                   gsize        len)
 {
-   TrieNode *node;
+   guint32 offset;
 
-   node = trie_malloc0(trie, TRIE_NODE_SIZE);
-   node->chunk.is_inline = TRUE;
-   node->parent = parent;
-   return node;
-}
+   g_assert(trie);
+   g_assert(len <= G_MAXUINT32);
 
-/**
- * trie_node_chunk_is_full:
- * @chunk: A #TrieNodeChunk.
- *
- * Checks to see if all children slots are full in @chunk.
- *
- * Returns: %TRUE if there are no free slots in @chunk.
- */
-G_INLINE_FUNC gboolean
-trie_node_chunk_is_full (TrieNodeChunk *chunk)
-{
-   g_assert(chunk);
-   return (chunk->count == TRIE_NODE_CHUNK_KEYS(chunk));
-}
+   offset = trie->labels->len;
+   g_byte_array_append(trie->labels, (const guint8 *)data, len);
 
-/**
- * trie_node_chunk_new:
- * @trie: The Trie that the chunk belongs to.
- *
- * Creates a new #TrieNodeChunk with empty state.
- *
- * Returns: (transfer full): A #TrieNodeChunk.
- */
-TrieNodeChunk *
-trie_node_chunk_new (Trie *trie)
-{
-   return trie_malloc0(trie, TRIE_NODE_CHUNK_SIZE);
+   return offset;
 }
 
 /**
- * trie_append_to_node:
- * @chunk: A #TrieNodeChunk.
- * @key: The key to append.
- * @child: A #TrieNode to append.
+ * trie_node_new:
+ * @trie: A #Trie.
+ * @label: The offset of the label within the label arena.
+ * @label_len: The length of the label.
  *
- * Appends @child to the chunk. If there is not room in the chunk,
- * then a new chunk will be added and append to @chunk.
+ * Allocates a node from the arena, reusing a freed node if possible.
  *
- * @chunk MUST be the last chunk in the chain (therefore chunk->next
- * is %NULL).
+ * Any #TrieNode pointers held by the caller are invalid after calling
+ * this function since the arena may have been reallocated.
+ *
+ * Returns: The index of the new node.
  */
-static void
-trie_append_to_node (Trie          *trie,
-                     TrieNode      *node,
-                     TrieNodeChunk *chunk,
-                     guint8         key,
-                     TrieNode      *child)
+static guint32
+trie_node_new (Trie    *trie,
+               guint32  label,
+               guint32  label_len)
 {
+   TrieNode *node;
+   guint32 idx;
+
    g_assert(trie);
-   g_assert(node);
-   g_assert(chunk);
-   g_assert(child);
 
-   if (trie_node_chunk_is_full(chunk)) {
-      chunk->next = trie_node_chunk_new(trie);
-      chunk = chunk->next;
+   if (trie->free_list != TRIE_NONE) {
+      idx = trie->free_list;
+      trie->free_list = NODE(trie, idx)->next_sibling;
+   } else {
+      idx = trie->nodes->len;
+      g_array_set_size(trie->nodes, idx + 1);
    }
 
-   chunk->keys[chunk->count] = key;
-   chunk->children[chunk->count] = child;
-   chunk->count++;
+   node = NODE(trie, idx);
+   node->value = NULL;
+   node->label = label;
+   node->label_len = label_len;
+   node->first_child = TRIE_NONE;
+   node->next_sibling = TRIE_NONE;
+
+   return idx;
 }
 
 /**
- * trie_node_move_to_front:
- * @node: A #TrieNode.
- * @chunk: A #TrieNodeChunk.
- * @idx: The index of the item to move.
+ * trie_node_release:
+ * @trie: A #Trie.
+ * @idx: The node to release.
  *
- * Moves the key and child found at @idx to the beginning of the first chunk
- * to achieve better cache locality.
+ * Returns the node at @idx to the free list. The node must already have
+ * been unlinked from its parent.
  */
 static void
-trie_node_move_to_front (TrieNode      *node,
-                         TrieNodeChunk *chunk,
-                         guint          idx)
+trie_node_release (Trie    *trie,
+                   guint32  idx)
 {
-   TrieNodeChunk *first;
-   TrieNode *child;
-   guint8 offset;
-   guint8 key;
-
-   g_assert(node);
-   g_assert(chunk);
-
-   first = &node->chunk;
-
-   key = chunk->keys[idx];
-   child = chunk->children[idx];
-
-   offset = ((first == chunk) ? first->count : FIRST_CHUNK_KEYS) - 1;
-   chunk->keys[idx] = first->keys[offset];
-   chunk->children[idx] = first->children[offset];
-
-#ifdef TRIE_64
-   STATIC_ASSERT(sizeof(gpointer) == 8);
-   STATIC_ASSERT((FIRST_CHUNK_KEYS-1) == 3);
-   STATIC_ASSERT(((FIRST_CHUNK_KEYS-1) * sizeof(gpointer)) == 24);
-#else
-   STATIC_ASSERT(sizeof(gpointer) == 4);
-   STATIC_ASSERT((FIRST_CHUNK_KEYS-1) == 2);
-   STATIC_ASSERT(((FIRST_CHUNK_KEYS-1) * sizeof(gpointer)) == 8);
-#endif
+   TrieNode *node;
 
-   memmove(&first->keys[1], &first->keys[0], (FIRST_CHUNK_KEYS-1));
-   memmove(&first->children[1], &first->children[0], (FIRST_CHUNK_KEYS-1) * sizeof(TrieNode *));
+   g_assert(trie);
+   g_assert(idx != TRIE_ROOT);
 
-   first->keys[0] = key;
-   first->children[0] = child;
+   node = NODE(trie, idx);
+   node->value = NULL;
+   node->first_child = TRIE_NONE;
+   node->next_sibling = trie->free_list;
+   trie->free_list = idx;
 }
 
 /**
- * trie_find_node:
- * @trie: The #Trie we are searching.
- * @node: A #TrieNode.
- * @key: The key to find in this node.
+ * trie_find_child:
+ * @trie: A #Trie.
+ * @parent: The index of the parent node.
+ * @key: The first byte of the edge to follow.
  *
- * Searches the chunk chain of the current node for the key provided. If
- * found, the child node for that key is returned.
+ * Finds the child of @parent whose label begins with @key.
  *
- * Returns: (transfer none): A #TrieNode or %NULL.
+ * Returns: The index of the child, or %TRIE_NONE.
  */
-static TrieNode *
-trie_find_node (Trie     *trie,
-                TrieNode *node,
-                guint8    key)
+static inline guint32
+trie_find_child (Trie    *trie,
+                 guint32  parent,
+                 guint8   key)
 {
-   TrieNodeChunk *iter;
-   guint i;
-
-   g_assert(node);
-
-   for (iter = &node->chunk; iter; iter = iter->next) {
-      for (i = 0; i < iter->count; i++) {
-         if (iter->keys[i] == key) {
-            if (iter != &node->chunk) {
-               trie_node_move_to_front(node, iter, i);
-               __builtin_prefetch(node->chunk.children[0]);
-               return node->chunk.children[0];
-            }
-            __builtin_prefetch(iter->children[i]);
-            return iter->children[i];
-         }
+   guint32 idx;
+
+   for (idx = NODE(trie, parent)->first_child;
+        idx != TRIE_NONE;
+        idx = NODE(trie, idx)->next_sibling) {
+      TrieNode *child = NODE(trie, idx);
+      guint8 first = trie->labels->data[child->label];
+
+      if (first == key) {
+         return idx;
+      } else if (first > key) {
+         break;
       }
    }
 
-   return NULL;
+   return TRIE_NONE;
 }
 
 /**
- * trie_find_or_create_node:
+ * trie_link_child:
  * @trie: A #Trie.
- * @node: A #TrieNode.
- * @key: The key to insert.
- *
- * Attempts to find key within @node. If @key is not found, it is added to the
- * node. The child for the key is returned.
+ * @parent: The index of the parent node.
+ * @child: The index of the child to link.
  *
- * Returns: (transfer none): The child #TrieNode for @key.
+ * Inserts @child into the children of @parent, keeping siblings sorted by
+ * the first byte of their label.
  */
-static TrieNode *
-trie_find_or_create_node (Trie     *trie,
-                          TrieNode *node,
-                          guint8    key)
+static void
+trie_link_child (Trie    *trie,
+                 guint32  parent,
+                 guint32  child)
 {
-   TrieNodeChunk *iter;
-   TrieNodeChunk *last = NULL;
-   guint i;
+   guint32 *link;
+   guint8 key;
 
-   g_assert(node);
-
-   for (iter = &node->chunk; iter; iter = iter->next) {
-      for (i = 0; i < iter->count; i++) {
-         if (iter->keys[i] == key) {
-            if (iter != &node->chunk) {
-               trie_node_move_to_front(node, iter, i);
-               __builtin_prefetch(node->chunk.children[0]);
-               return node->chunk.children[0];
-            }
-            __builtin_prefetch(iter->children[i]);
-            return iter->children[i];
-         }
+   g_assert(trie);
+
+   key = trie->labels->data[NODE(trie, child)->label];
+
+   for (link = &NODE(trie, parent)->first_child;
+        *link != TRIE_NONE;
+        link = &NODE(trie, *link)->next_sibling) {
+      if (trie->labels->data[NODE(trie, *link)->label] > key) {
+         break;
       }
-      last = iter;
    }
 
-   g_assert(last);
-
-   node = trie_node_new(trie, node);
-   trie_append_to_node(trie, node->parent, last, key, node);
-   return node;
+   NODE(trie, child)->next_sibling = *link;
+   *link = child;
 }
 
 /**
- * trie_node_remove_fast:
- * @node: A #TrieNode.
- * @chunk: A #TrieNodeChunk.
- * @idx: The child within the chunk.
+ * trie_unlink_child:
+ * @trie: A #Trie.
+ * @parent: The index of the parent node.
+ * @child: The index of the child to unlink.
  *
- * Removes child at index @idx from the chunk. The last item in the
- * chain of chunks will be moved to the slot indicated by @idx.
+ * Removes @child from the children of @parent.
  */
-G_INLINE_FUNC void
-trie_node_remove_fast (TrieNode      *node,
-                       TrieNodeChunk *chunk,
-                       guint          idx)
+static void
+trie_unlink_child (Trie    *trie,
+                   guint32  parent,
+                   guint32  child)
 {
-   TrieNodeChunk *iter;
+   guint32 *link;
 
-   g_assert(node);
-   g_assert(chunk);
-
-   for (iter = chunk; iter->next && iter->next->count; iter = iter->next) { }
-
-   g_assert(iter->count);
-
-   chunk->keys[idx] = iter->keys[iter->count-1];
-   chunk->children[idx] = iter->children[iter->count-1];
+   g_assert(trie);
 
-   iter->count--;
+   for (link = &NODE(trie, parent)->first_child;
+        *link != TRIE_NONE;
+        link = &NODE(trie, *link)->next_sibling) {
+      if (*link == child) {
+         *link = NODE(trie, child)->next_sibling;
+         NODE(trie, child)->next_sibling = TRIE_NONE;
+         return;
+      }
+   }
 
-   iter->keys[iter->count] = '\0';
-   iter->children[iter->count] = NULL;
+   g_assert_not_reached();
 }
 
 /**
- * trie_node_unlink:
- * @node: A #TrieNode.
+ * trie_node_merge_child:
+ * @trie: A #Trie.
+ * @idx: A node without a value and with exactly one child.
  *
- * Unlinks @node from the Trie. The parent node has its pointer to @node
- * removed.
+ * Collapses @idx and its only child into a single node so that the trie
+ * stays path-compressed after a removal.
  */
 static void
-trie_node_unlink (TrieNode *node)
+trie_node_merge_child (Trie    *trie,
+                       guint32  idx)
 {
-   TrieNodeChunk *iter;
-   TrieNode *parent;
-   guint i;
+   TrieNode *node;
+   TrieNode *child;
+   guint32 child_idx;
+   guint32 label;
+   guint32 len;
 
-   g_assert(node);
-
-   if ((parent = node->parent)) {
-      node->parent = NULL;
-      for (iter = &parent->chunk; iter; iter = iter->next) {
-         for (i = 0; i < iter->count; i++) {
-            if (iter->children[i] == node) {
-               trie_node_remove_fast(node, iter, i);
-               g_assert(iter->children[i] != node);
-               return;
-            }
-         }
-      }
-   }
+   g_assert(trie);
+   g_assert(idx != TRIE_ROOT);
+
+   node = NODE(trie, idx);
+   child_idx = node->first_child;
+   child = NODE(trie, child_idx);
+
+   g_assert(node->value == NULL);
+   g_assert(child_idx != TRIE_NONE);
+   g_assert(child->next_sibling == TRIE_NONE);
+
+   len = node->label_len + child->label_len;
+   label = trie->labels->len;
+
+   /*
+    * The two labels are generally not adjacent in the arena, so append the
+    * concatenation. The old bytes are reclaimed by trie_freeze().
+    */
+   g_byte_array_set_size(trie->labels, label + len);
+   node = NODE(trie, idx);
+   child = NODE(trie, child_idx);
+   memcpy(&trie->labels->data[label],
+          &trie->labels->data[node->label],
+          node->label_len);
+   memcpy(&trie->labels->data[label + node->label_len],
+          &trie->labels->data[child->label],
+          child->label_len);
+
+   node->label = label;
+   node->label_len = len;
+   node->value = child->value;
+   node->first_child = child->first_child;
+
+   trie_node_release(trie, child_idx);
 }
 
 /**
- * trie_destroy_node:
+ * trie_destroy_values:
  * @trie: A #Trie.
- * @node: A #TrieNode.
- * @value_destroy: A #GDestroyNotify or %NULL.
- *
- * Removes @node from the #Trie and releases all memory associated with it.
- * If the nodes value is set, @value_destroy will be called to release it.
- *
- * The reclaimation happens as such:
  *
- * 1) the node is unlinked from its parent.
- * 2) each of the children are destroyed, leaving us an empty chain.
- * 3) each of the allocated chain links are freed.
- * 4) the value pointer is freed.
- * 5) the structure itself is freed.
+ * Releases every value stored in @trie using the value destroy function.
  */
 static void
-trie_destroy_node (Trie           *trie,
-                   TrieNode       *node,
-                   GDestroyNotify  value_destroy)
+trie_destroy_values (Trie *trie)
 {
-   TrieNodeChunk *iter;
-   TrieNodeChunk *tmp;
-
-   g_assert(node);
+   guint i;
 
-   trie_node_unlink(node);
+   g_assert(trie);
 
-   while (node->chunk.count) {
-      trie_destroy_node(trie, node->chunk.children[0], value_destroy);
+   if (!trie->value_destroy) {
+      return;
    }
 
-   for (iter = node->chunk.next; iter;) {
-      tmp = iter;
-      iter = iter->next;
-      trie_free(trie, tmp);
-   }
+   for (i = 0; i < trie->nodes->len; i++) {
+      TrieNode *node = NODE(trie, i);
 
-   if (node->value && value_destroy) {
-      value_destroy(node->value);
+      if (node->value) {
+         trie->value_destroy(node->value);
+         node->value = NULL;
+      }
    }
-
-   trie_free(trie, node);
 }
 
 /**
@@ -486,17 +371,14 @@ trie_new (GDestroyNotify value_destroy)
 {
    Trie *trie;
 
-#ifdef TRIE_64
-   STATIC_ASSERT(sizeof(TrieNode) == 32);
-   STATIC_ASSERT(sizeof(TrieNodeChunk) == 16);
-#else
-   STATIC_ASSERT(sizeof(TrieNode) == 20);
-   STATIC_ASSERT(sizeof(TrieNodeChunk) == 12);
-#endif
-
    trie = g_new0(Trie, 1);
-   trie->root = trie_node_new(trie, NULL);
    trie->value_destroy = value_destroy;
+   trie->nodes = g_array_sized_new(FALSE, TRUE, sizeof(TrieNode), 64);
+   trie->labels = g_byte_array_sized_new(256);
+   trie->free_list = TRIE_NONE;
+
+   /* The root is always index 0 with an empty label. */
+   trie_node_new(trie, 0, 0);
 
    return trie;
 }
@@ -514,24 +396,134 @@ trie_insert (Trie        *trie,
              const gchar *key,
              gpointer     value)
 {
-   TrieNode *node;
+   guint32 idx;
 
    g_return_if_fail(trie);
    g_return_if_fail(key);
    g_return_if_fail(value);
 
-   node = trie->root;
+   idx = TRIE_ROOT;
+
+   while (*key) {
+      TrieNode *child;
+      const gchar *label;
+      guint32 child_idx;
+      guint32 mid_idx;
+      guint32 i;
+
+      child_idx = trie_find_child(trie, idx, *key);
+
+      if (child_idx == TRIE_NONE) {
+         gsize len = strlen(key);
+         guint32 offset = trie_append_label(trie, key, len);
+
+         child_idx = trie_node_new(trie, offset, len);
+         trie_link_child(trie, idx, child_idx);
+         idx = child_idx;
+         break;
+      }
+
+      child = NODE(trie, child_idx);
+      label = LABEL(trie, child);
+
+      for (i = 1; i < child->label_len && key[i] && key[i] == label[i]; i++) { }
+
+      if (i == child->label_len) {
+         idx = child_idx;
+         key += i;
+         continue;
+      }
+
+      /*
+       * The key diverges (or ends) within this edge. Split the edge so that
+       * the shared prefix becomes a new node taking the child's place, and
+       * the child keeps the remainder of its label.
+       */
+      mid_idx = trie_node_new(trie, child->label, i);
+      child = NODE(trie, child_idx);
+      trie_unlink_child(trie, idx, child_idx);
+      child->label += i;
+      child->label_len -= i;
+      NODE(trie, mid_idx)->first_child = child_idx;
+      trie_link_child(trie, idx, mid_idx);
+
+      idx = mid_idx;
+      key += i;
+   }
+
+   {
+      TrieNode *node = NODE(trie, idx);
+
+      if (node->value && trie->value_destroy) {
+         trie->value_destroy(node->value);
+      }
+
+      node->value = value;
+   }
+}
+
+/**
+ * trie_find_position:
+ * @trie: A #Trie.
+ * @key: The key to find.
+ * @offset: (out): The number of label bytes of the resulting node that were
+ *    consumed by @key.
+ * @parent: (out) (allow-none): The parent of the resulting node.
+ *
+ * Walks @key through @trie. If @key ends in the middle of an edge, the
+ * node at the end of that edge is returned and @offset is less than its
+ * label length.
+ *
+ * Returns: The index of the node, or %G_MAXUINT32 if @key is not a prefix
+ *   of any key in @trie.
+ */
+static guint32
+trie_find_position (Trie        *trie,
+                    const gchar *key,
+                    guint32     *offset,
+                    guint32     *parent)
+{
+   guint32 idx = TRIE_ROOT;
+   guint32 up = TRIE_NONE;
+
+   g_assert(trie);
+   g_assert(key);
+   g_assert(offset);
+
+   *offset = 0;
 
    while (*key) {
-      node = trie_find_or_create_node(trie, node, *key);
-      key++;
+      TrieNode *child;
+      const gchar *label;
+      guint32 child_idx;
+      guint32 i;
+
+      child_idx = trie_find_child(trie, idx, *key);
+
+      if (child_idx == TRIE_NONE) {
+         return G_MAXUINT32;
+      }
+
+      child = NODE(trie, child_idx);
+      label = LABEL(trie, child);
+
+      for (i = 1; i < child->label_len && key[i]; i++) {
+         if (key[i] != label[i]) {
+            return G_MAXUINT32;
+         }
+      }
+
+      up = idx;
+      idx = child_idx;
+      key += i;
+      *offset = i;
    }
 
-   if (node->value && trie->value_destroy) {
-      trie->value_destroy(node->value);
+   if (parent) {
+      *parent = up;
    }
 
-   node->value = value;
+   return idx;
 }
 
 /**
@@ -547,22 +539,19 @@ gpointer
 trie_lookup (Trie        *trie,
              const gchar *key)
 {
-   TrieNode *node;
-
-   __builtin_prefetch(trie);
-   __builtin_prefetch(key);
+   guint32 offset;
+   guint32 idx;
 
    g_return_val_if_fail(trie, NULL);
    g_return_val_if_fail(key, NULL);
 
-   node = trie->root;
+   idx = trie_find_position(trie, key, &offset, NULL);
 
-   while (*key && node) {
-      node = trie_find_node(trie, node, *key);
-      key++;
+   if (idx == G_MAXUINT32 || offset != NODE(trie, idx)->label_len) {
+      return NULL;
    }
 
-   return node ? node->value : NULL;
+   return NODE(trie, idx)->value;
 }
 
 /**
@@ -580,160 +569,228 @@ trie_remove (Trie        *trie,
              const gchar *key)
 {
    TrieNode *node;
+   guint32 offset;
+   guint32 parent = TRIE_NONE;
+   guint32 idx;
 
    g_return_val_if_fail(trie, FALSE);
    g_return_val_if_fail(key, FALSE);
 
-   node = trie->root;
+   idx = trie_find_position(trie, key, &offset, &parent);
 
-   while (*key && node) {
-      node = trie_find_node(trie, node, *key);
-      key++;
+   if (idx == G_MAXUINT32) {
+      return FALSE;
    }
 
-   if (node && node->value) {
-      if (trie->value_destroy) {
-         trie->value_destroy(node->value);
-      }
+   node = NODE(trie, idx);
 
-      node->value = NULL;
+   if (offset != node->label_len || !node->value) {
+      return FALSE;
+   }
 
-      if (!node->chunk.count) {
-         while (node->parent &&
-                node->parent->parent &&
-                !node->parent->value &&
-                (node->parent->chunk.count == 1)) {
-            node = node->parent;
-         }
-         trie_destroy_node(trie, node, trie->value_destroy);
-      }
+   if (trie->value_destroy) {
+      trie->value_destroy(node->value);
+   }
+
+   node->value = NULL;
 
+   if (idx == TRIE_ROOT) {
       return TRUE;
    }
 
-   return FALSE;
+   if (node->first_child == TRIE_NONE) {
+      TrieNode *up;
+
+      trie_unlink_child(trie, parent, idx);
+      trie_node_release(trie, idx);
+
+      /*
+       * The parent may now be a valueless node with a single child, in
+       * which case the two are merged to keep the path compressed.
+       */
+      up = NODE(trie, parent);
+      if (parent != TRIE_ROOT &&
+          !up->value &&
+          up->first_child != TRIE_NONE &&
+          NODE(trie, up->first_child)->next_sibling == TRIE_NONE) {
+         trie_node_merge_child(trie, parent);
+      }
+   } else if (NODE(trie, node->first_child)->next_sibling == TRIE_NONE) {
+      trie_node_merge_child(trie, idx);
+   }
+
+   return TRUE;
 }
 
 /**
- * trie_traverse_node_pre_order:
+ * trie_freeze:
  * @trie: A #Trie.
- * @node: A #TrieNode.
- * @str: The prefix for this node.
- * @flags: The flags for which nodes to callback.
- * @max_depth: the maximum depth to process.
- * @func: The func to execute for each matching node.
- * @user_data: User data for @func.
- *
- * Traverses node and all of its children according to the parameters
- * provided. @func is called for each matching node.
  *
- * This assumes that the order is %G_POST_ORDER, and therefore does not
- * have the conditionals to check pre-vs-pre ordering.
+ * Rewrites the node and label arenas of @trie in breadth-first order. The
+ * children of every node become adjacent in memory, as do their labels,
+ * and storage left behind by removals and edge splits is reclaimed.
  *
- * Returns: %TRUE if traversal was cancelled; otherwise %FALSE.
+ * This is meant to be called once a trie has been populated and will mostly
+ * be read from. The trie may still be modified afterwards, but new nodes
+ * will not benefit from the improved layout until the next freeze.
  */
-static gboolean
-trie_traverse_node_pre_order (Trie             *trie,
-                              TrieNode         *node,
-                              GString          *str,
-                              GTraverseFlags    flags,
-                              gint              max_depth,
-                              TrieTraverseFunc  func,
-                              gpointer          user_data)
+void
+trie_freeze (Trie *trie)
 {
-   TrieNodeChunk *iter;
-   gboolean ret = FALSE;
-   guint i;
+   GByteArray *labels;
+   GArray *nodes;
+   guint32 head;
 
-   g_assert(trie);
-   g_assert(node);
-   g_assert(str);
-
-   if (max_depth) {
-      if ((!node->value && (flags & G_TRAVERSE_NON_LEAVES)) ||
-          (node->value && (flags & G_TRAVERSE_LEAVES))) {
-         if (func(trie, str->str, node->value, user_data)) {
-            return TRUE;
-         }
-      }
-      for (iter = &node->chunk; iter; iter = iter->next) {
-         for (i = 0; i < iter->count; i++) {
-            g_string_append_c(str, iter->keys[i]);
-            if (trie_traverse_node_pre_order(trie,
-                                             iter->children[i],
-                                             str,
-                                             flags,
-                                             max_depth - 1,
-                                             func,
-                                             user_data)) {
-               return TRUE;
-            }
-            g_string_truncate(str, str->len - 1);
+   g_return_if_fail(trie);
+
+   nodes = g_array_sized_new(FALSE, TRUE, sizeof(TrieNode), trie->nodes->len);
+   labels = g_byte_array_sized_new(trie->labels->len);
+
+   g_array_append_val(nodes, *NODE(trie, TRIE_ROOT));
+   g_array_index(nodes, TrieNode, 0).label = 0;
+
+   /*
+    * The new array doubles as the breadth-first queue. Each node dequeued
+    * still refers to its children by their old indices, which are copied
+    * to the end of the new array and then rewritten to point at the copies.
+    */
+   for (head = 0; head < nodes->len; head++) {
+      guint32 first = nodes->len;
+      guint32 old;
+
+      for (old = g_array_index(nodes, TrieNode, head).first_child;
+           old != TRIE_NONE;
+           old = NODE(trie, old)->next_sibling) {
+         TrieNode copy = *NODE(trie, old);
+
+         copy.label = labels->len;
+         g_byte_array_append(labels,
+                             &trie->labels->data[NODE(trie, old)->label],
+                             copy.label_len);
+         copy.next_sibling = TRIE_NONE;
+         g_array_append_val(nodes, copy);
+
+         if (nodes->len - 1 > first) {
+            g_array_index(nodes, TrieNode, nodes->len - 2).next_sibling = nodes->len - 1;
          }
       }
+
+      g_array_index(nodes, TrieNode, head).first_child =
+         (nodes->len > first) ? first : TRIE_NONE;
    }
 
-   return ret;
+   g_array_unref(trie->nodes);
+   g_byte_array_unref(trie->labels);
+
+   trie->nodes = nodes;
+   trie->labels = labels;
+   trie->free_list = TRIE_NONE;
 }
 
+typedef struct
+{
+   Trie             *trie;
+   GString          *str;
+   GTraverseFlags    flags;
+   TrieTraverseFunc  func;
+   gpointer          user_data;
+} TrieTraverse;
+
 /**
- * trie_traverse_node_post_order:
- * @trie: A #Trie.
- * @node: A #TrieNode.
- * @str: The prefix for this node.
- * @flags: The flags for which nodes to callback.
- * @max_depth: the maximum depth to process.
- * @func: The func to execute for each matching node.
- * @user_data: User data for @func.
+ * trie_traverse_visit:
+ * @state: The traversal state.
+ * @value: The value of the position, or %NULL.
  *
- * Traverses node and all of its children according to the parameters
- * provided. @func is called for each matching node.
+ * Calls the traversal function for the current position if it matches
+ * the traversal flags.
  *
- * This assumes that the order is %G_POST_ORDER, and therefore does not
- * have the conditionals to check pre-vs-post ordering.
+ * Returns: %TRUE if traversal was cancelled; otherwise %FALSE.
+ */
+static inline gboolean
+trie_traverse_visit (TrieTraverse *state,
+                     gpointer      value)
+{
+   if ((!value && (state->flags & G_TRAVERSE_NON_LEAVES)) ||
+       (value && (state->flags & G_TRAVERSE_LEAVES))) {
+      return state->func(state->trie, state->str->str, value, state->user_data);
+   }
+
+   return FALSE;
+}
+
+/**
+ * trie_traverse_node:
+ * @state: The traversal state.
+ * @idx: A node index.
+ * @offset: The number of bytes of the node label already in the key.
+ * @order: Either %G_PRE_ORDER or %G_POST_ORDER.
+ * @max_depth: the maximum depth to process.
+ *
+ * Traverses the position @offset bytes into the edge leading to @idx and
+ * everything beneath it. Positions in the middle of an edge are reported
+ * as valueless nodes, so the callbacks (and @max_depth) behave exactly as
+ * if there was one node per character.
  *
  * Returns: %TRUE if traversal was cancelled; otherwise %FALSE.
  */
 static gboolean
-trie_traverse_node_post_order (Trie             *trie,
-                               TrieNode         *node,
-                               GString          *str,
-                               GTraverseFlags    flags,
-                               gint              max_depth,
-                               TrieTraverseFunc  func,
-                               gpointer          user_data)
+trie_traverse_node (TrieTraverse  *state,
+                    guint32        idx,
+                    guint32        offset,
+                    GTraverseType  order,
+                    gint           max_depth)
 {
-   TrieNodeChunk *iter;
-   gboolean ret = FALSE;
-   guint i;
+   Trie *trie = state->trie;
+   TrieNode *node;
+   gpointer value;
+   guint32 child;
 
-   g_assert(trie);
-   g_assert(node);
-   g_assert(str);
-
-   if (max_depth) {
-      for (iter = &node->chunk; iter; iter = iter->next) {
-         for (i = 0; i < iter->count; i++) {
-            g_string_append_c(str, iter->keys[i]);
-            if (trie_traverse_node_post_order(trie,
-                                              iter->children[i],
-                                              str,
-                                              flags,
-                                              max_depth - 1,
-                                              func,
-                                              user_data)) {
-               return TRUE;
-            }
-            g_string_truncate(str, str->len - 1);
-         }
+   if (!max_depth) {
+      return FALSE;
+   }
+
+   node = NODE(trie, idx);
+
+   if (offset < node->label_len) {
+      /* Implicit position in the middle of an edge. */
+      if (order == G_PRE_ORDER && trie_traverse_visit(state, NULL)) {
+         return TRUE;
       }
-      if ((!node->value && (flags & G_TRAVERSE_NON_LEAVES)) ||
-          (node->value && (flags & G_TRAVERSE_LEAVES))) {
-         ret = func(trie, str->str, node->value, user_data);
+
+      g_string_append_c(state->str, LABEL(trie, node)[offset]);
+      if (trie_traverse_node(state, idx, offset + 1, order, max_depth - 1)) {
+         return TRUE;
+      }
+      g_string_truncate(state->str, state->str->len - 1);
+
+      if (order == G_POST_ORDER && trie_traverse_visit(state, NULL)) {
+         return TRUE;
+      }
+
+      return FALSE;
+   }
+
+   value = node->value;
+
+   if (order == G_PRE_ORDER && trie_traverse_visit(state, value)) {
+      return TRUE;
+   }
+
+   for (child = node->first_child;
+        child != TRIE_NONE;
+        child = NODE(trie, child)->next_sibling) {
+      g_string_append_c(state->str, LABEL(trie, NODE(trie, child))[0]);
+      if (trie_traverse_node(state, child, 1, order, max_depth - 1)) {
+         return TRUE;
       }
+      g_string_truncate(state->str, state->str->len - 1);
    }
 
-   return ret;
+   if (order == G_POST_ORDER) {
+      return trie_traverse_visit(state, value);
+   }
+
+   return FALSE;
 }
 
 /**
@@ -763,35 +820,35 @@ trie_traverse (Trie             *trie,
                TrieTraverseFunc  func,
                gpointer          user_data)
 {
-   TrieNode *node;
-   GString *str;
+   TrieTraverse state;
+   guint32 offset;
+   guint32 idx;
 
    g_return_if_fail(trie);
    g_return_if_fail(func);
 
-   node = trie->root;
    key = key ? key : "";
 
-   str = g_string_new(key);
-
-   while (*key && node) {
-      node = trie_find_node(trie, node, *key);
-      key++;
+   if (order != G_PRE_ORDER && order != G_POST_ORDER) {
+      g_warning(_("Traversal order %u is not supported on Trie."), order);
+      return;
    }
 
-   if (node) {
-      if (order == G_PRE_ORDER) {
-         trie_traverse_node_pre_order(trie, node, str, flags,
-                                      max_depth, func, user_data);
-      } else if (order == G_POST_ORDER) {
-         trie_traverse_node_post_order(trie, node, str, flags,
-                                       max_depth, func, user_data);
-      } else {
-         g_warning(_("Traversal order %u is not supported on Trie."), order);
-      }
+   idx = trie_find_position(trie, key, &offset, NULL);
+
+   if (idx == G_MAXUINT32) {
+      return;
    }
 
-   g_string_free(str, TRUE);
+   state.trie = trie;
+   state.str = g_string_new(key);
+   state.flags = flags;
+   state.func = func;
+   state.user_data = user_data;
+
+   trie_traverse_node(&state, idx, offset, order, max_depth);
+
+   g_string_free(state.str, TRUE);
 }
 
 /**
@@ -804,9 +861,9 @@ void
 trie_destroy (Trie *trie)
 {
    if (trie) {
-      trie_destroy_node(trie, trie->root, trie->value_destroy);
-      trie->root = NULL;
-      trie->value_destroy = NULL;
+      trie_destroy_values(trie);
+      g_array_unref(trie->nodes);
+      g_byte_array_unref(trie->labels);
       g_free(trie);
    }
 }
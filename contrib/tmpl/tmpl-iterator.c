@@ -31,7 +31,10 @@ string_move_next (TmplIterator *iter)
 {
   if (iter->instance)
     {
-      iter->instance = g_utf8_next_char ((gchar *)iter->instance);
+      /* The first call moves onto the first character */
+      if (iter->data1 != NULL)
+        iter->instance = g_utf8_next_char ((gchar *)iter->instance);
+      iter->data1 = GINT_TO_POINTER (TRUE);
       return (*(gchar *)iter->instance) != 0;
     }
 
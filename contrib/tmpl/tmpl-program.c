@@ -0,0 +1,728 @@
+/* tmpl-program.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This file is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define G_LOG_DOMAIN "tmpl-program"
+
+#include <string.h>
+
+#include "tmpl-branch-node.h"
+#include "tmpl-condition-node.h"
+#include "tmpl-debug.h"
+#include "tmpl-error.h"
+#include "tmpl-expr-node.h"
+#include "tmpl-expr-private.h"
+#include "tmpl-iter-node.h"
+#include "tmpl-iterator.h"
+#include "tmpl-program.h"
+#include "tmpl-symbol.h"
+#include "tmpl-text-node.h"
+#include "tmpl-util-private.h"
+
+/*
+ * A TmplProgram is a template flattened into an array of instructions so
+ * that expanding it does not need to walk the node tree again.
+ *
+ * While compiling, adjacent text nodes and expressions made only of
+ * literals are folded into a single text run, and branches with a
+ * literal condition (such as "else") are resolved. Expressions that are
+ * a plain symbol reference are bound to a slot: references to a loop
+ * identifier use the symbol of that loop frame directly, and everything
+ * else is looked up in the scope once per expansion and cached.
+ *
+ * A cached slot can only go stale when the scope it was found in goes
+ * away, since assignments reuse existing symbols rather than shadowing
+ * them. Loop scopes are the only scopes that go away during expansion,
+ * so the slots are dropped whenever a loop frame is popped.
+ */
+
+typedef enum
+{
+  TMPL_OP_TEXT,
+  TMPL_OP_OUTPUT,
+  TMPL_OP_BRANCH,
+  TMPL_OP_JUMP,
+  TMPL_OP_ITER_BEGIN,
+  TMPL_OP_ITER_NEXT,
+} TmplOpcode;
+
+typedef enum
+{
+  TMPL_OPERAND_NONE,
+  TMPL_OPERAND_EXPR,
+  TMPL_OPERAND_SLOT,
+  TMPL_OPERAND_LOOP,
+} TmplOperand;
+
+typedef struct
+{
+  TmplOpcode   opcode;
+  TmplOperand  operand;
+  guint        index;
+  guint        depth;
+  guint        jump;
+  TmplExpr    *expr;
+  gchar       *text;
+  gsize        len;
+} TmplInstruction;
+
+typedef struct
+{
+  TmplScope    *scope;
+  TmplScope    *parent;
+  TmplSymbol   *symbol;
+  const gchar  *identifier;
+  TmplIterator  iter;
+  GValue        value;
+} TmplFrame;
+
+struct _TmplProgram
+{
+  TmplInstruction  *insns;
+  guint             n_insns;
+  gchar           **slots;
+  guint             n_slots;
+  guint             max_depth;
+};
+
+typedef struct
+{
+  GArray     *insns;
+  GPtrArray  *slots;
+  GHashTable *slot_by_name;
+  GPtrArray  *loops;
+  GString    *text;
+  TmplScope  *empty_scope;
+  guint       max_depth;
+} TmplCompiler;
+
+static void tmpl_compiler_compile_node (TmplNode *node,
+                                        gpointer  user_data);
+
+static void
+tmpl_compiler_flush_text (TmplCompiler *compiler)
+{
+  TmplInstruction insn = { 0 };
+
+  if (compiler->text->len == 0)
+    return;
+
+  insn.opcode = TMPL_OP_TEXT;
+  insn.len = compiler->text->len;
+  insn.text = g_strndup (compiler->text->str, compiler->text->len);
+
+  g_array_append_val (compiler->insns, insn);
+  g_string_truncate (compiler->text, 0);
+}
+
+static guint
+tmpl_compiler_label (TmplCompiler *compiler)
+{
+  tmpl_compiler_flush_text (compiler);
+
+  return compiler->insns->len;
+}
+
+static guint
+tmpl_compiler_emit (TmplCompiler    *compiler,
+                    TmplInstruction *insn)
+{
+  guint pc = tmpl_compiler_label (compiler);
+
+  g_array_append_val (compiler->insns, *insn);
+
+  return pc;
+}
+
+static void
+tmpl_compiler_patch (TmplCompiler *compiler,
+                     guint         pc,
+                     guint         target)
+{
+  g_array_index (compiler->insns, TmplInstruction, pc).jump = target;
+}
+
+static void
+tmpl_compiler_set_operand (TmplCompiler    *compiler,
+                           TmplInstruction *insn,
+                           TmplExpr        *expr)
+{
+  const gchar *name;
+  gpointer slot;
+  guint i;
+
+  if (expr->any.type != TMPL_EXPR_SYMBOL_REF)
+    {
+      insn->operand = TMPL_OPERAND_EXPR;
+      insn->expr = tmpl_expr_ref (expr);
+      return;
+    }
+
+  name = expr->sym_ref.symbol;
+
+  /* The innermost loop wins, just like scope resolution would */
+  for (i = compiler->loops->len; i > 0; i--)
+    {
+      if (g_str_equal (g_ptr_array_index (compiler->loops, i - 1), name))
+        {
+          insn->operand = TMPL_OPERAND_LOOP;
+          insn->index = i - 1;
+          return;
+        }
+    }
+
+  if (!g_hash_table_lookup_extended (compiler->slot_by_name, name, NULL, &slot))
+    {
+      slot = GUINT_TO_POINTER (compiler->slots->len);
+      g_ptr_array_add (compiler->slots, g_strdup (name));
+      g_hash_table_insert (compiler->slot_by_name,
+                           g_ptr_array_index (compiler->slots, compiler->slots->len - 1),
+                           slot);
+    }
+
+  insn->operand = TMPL_OPERAND_SLOT;
+  insn->index = GPOINTER_TO_UINT (slot);
+}
+
+static gboolean
+expr_is_constant (TmplExpr *expr)
+{
+  if (expr == NULL)
+    return TRUE;
+
+  switch (expr->any.type)
+    {
+    case TMPL_EXPR_BOOLEAN:
+    case TMPL_EXPR_NUMBER:
+    case TMPL_EXPR_STRING:
+      return TRUE;
+
+    case TMPL_EXPR_ADD:
+    case TMPL_EXPR_SUB:
+    case TMPL_EXPR_MUL:
+    case TMPL_EXPR_DIV:
+    case TMPL_EXPR_GT:
+    case TMPL_EXPR_LT:
+    case TMPL_EXPR_NE:
+    case TMPL_EXPR_EQ:
+    case TMPL_EXPR_GTE:
+    case TMPL_EXPR_LTE:
+    case TMPL_EXPR_UNARY_MINUS:
+    case TMPL_EXPR_AND:
+    case TMPL_EXPR_OR:
+    case TMPL_EXPR_INVERT_BOOLEAN:
+      return expr_is_constant (expr->simple.left) &&
+             expr_is_constant (expr->simple.right);
+
+    case TMPL_EXPR_STMT_LIST:
+    case TMPL_EXPR_IF:
+    case TMPL_EXPR_WHILE:
+    case TMPL_EXPR_SYMBOL_REF:
+    case TMPL_EXPR_SYMBOL_ASSIGN:
+    case TMPL_EXPR_FN_CALL:
+    case TMPL_EXPR_USER_FN_CALL:
+    case TMPL_EXPR_GETATTR:
+    case TMPL_EXPR_SETATTR:
+    case TMPL_EXPR_GI_CALL:
+    case TMPL_EXPR_REQUIRE:
+    default:
+      return FALSE;
+    }
+}
+
+/*
+ * Evaluates @expr at compile time if it only consists of literals.
+ * Failures are left for expansion so they are reported as usual.
+ */
+static gboolean
+tmpl_compiler_fold (TmplCompiler *compiler,
+                    TmplExpr     *expr,
+                    GValue       *value)
+{
+  if (expr == NULL || !expr_is_constant (expr))
+    return FALSE;
+
+  if (!tmpl_expr_eval (expr, compiler->empty_scope, value, NULL))
+    {
+      TMPL_CLEAR_VALUE (value);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+collect_children (TmplNode *node,
+                  gpointer  user_data)
+{
+  g_ptr_array_add (user_data, node);
+}
+
+static void
+tmpl_compiler_compile_branch (TmplCompiler   *compiler,
+                              TmplBranchNode *node)
+{
+  g_autoptr(GPtrArray) conditions = g_ptr_array_new ();
+  g_autoptr(GArray) exits = g_array_new (FALSE, FALSE, sizeof (guint));
+  guint end;
+  guint i;
+
+  tmpl_node_visit_children (TMPL_NODE (node), collect_children, conditions);
+
+  for (i = 0; i < conditions->len; i++)
+    {
+      TmplNode *condition = g_ptr_array_index (conditions, i);
+      TmplInstruction insn = { 0 };
+      GValue value = G_VALUE_INIT;
+      TmplExpr *expr;
+      guint branch;
+      guint exit;
+
+      expr = tmpl_condition_node_get_condition (TMPL_CONDITION_NODE (condition));
+
+      if (expr == NULL)
+        continue;
+
+      if (tmpl_compiler_fold (compiler, expr, &value))
+        {
+          gboolean taken = tmpl_value_as_boolean (&value);
+
+          TMPL_CLEAR_VALUE (&value);
+
+          if (!taken)
+            continue;
+
+          /* Nothing after an unconditional branch is reachable */
+          tmpl_node_visit_children (condition, tmpl_compiler_compile_node, compiler);
+          break;
+        }
+
+      insn.opcode = TMPL_OP_BRANCH;
+      tmpl_compiler_set_operand (compiler, &insn, expr);
+      branch = tmpl_compiler_emit (compiler, &insn);
+
+      tmpl_node_visit_children (condition, tmpl_compiler_compile_node, compiler);
+
+      memset (&insn, 0, sizeof insn);
+      insn.opcode = TMPL_OP_JUMP;
+      exit = tmpl_compiler_emit (compiler, &insn);
+      g_array_append_val (exits, exit);
+
+      tmpl_compiler_patch (compiler, branch, tmpl_compiler_label (compiler));
+    }
+
+  end = tmpl_compiler_label (compiler);
+
+  for (i = 0; i < exits->len; i++)
+    tmpl_compiler_patch (compiler, g_array_index (exits, guint, i), end);
+}
+
+static void
+tmpl_compiler_compile_iter (TmplCompiler *compiler,
+                            TmplIterNode *node)
+{
+  TmplInstruction insn = { 0 };
+  const gchar *identifier;
+  guint begin;
+  guint next;
+  guint end;
+
+  identifier = tmpl_iter_node_get_identifier (node);
+
+  insn.opcode = TMPL_OP_ITER_BEGIN;
+  insn.depth = compiler->loops->len;
+  insn.text = g_strdup (identifier);
+  tmpl_compiler_set_operand (compiler, &insn, tmpl_iter_node_get_expr (node));
+  begin = tmpl_compiler_emit (compiler, &insn);
+
+  memset (&insn, 0, sizeof insn);
+  insn.opcode = TMPL_OP_ITER_NEXT;
+  insn.depth = compiler->loops->len;
+  next = tmpl_compiler_emit (compiler, &insn);
+
+  g_ptr_array_add (compiler->loops, (gchar *)identifier);
+  compiler->max_depth = MAX (compiler->max_depth, compiler->loops->len);
+
+  tmpl_node_visit_children (TMPL_NODE (node), tmpl_compiler_compile_node, compiler);
+
+  g_ptr_array_remove_index (compiler->loops, compiler->loops->len - 1);
+
+  memset (&insn, 0, sizeof insn);
+  insn.opcode = TMPL_OP_JUMP;
+  insn.jump = next;
+  tmpl_compiler_emit (compiler, &insn);
+
+  end = tmpl_compiler_label (compiler);
+  tmpl_compiler_patch (compiler, begin, end);
+  tmpl_compiler_patch (compiler, next, end);
+}
+
+static void
+tmpl_compiler_compile_node (TmplNode *node,
+                            gpointer  user_data)
+{
+  TmplCompiler *compiler = user_data;
+
+  g_assert (TMPL_IS_NODE (node));
+  g_assert (compiler != NULL);
+
+  if (TMPL_IS_TEXT_NODE (node))
+    {
+      g_string_append (compiler->text, tmpl_text_node_get_text (TMPL_TEXT_NODE (node)));
+    }
+  else if (TMPL_IS_EXPR_NODE (node))
+    {
+      TmplExpr *expr = tmpl_expr_node_get_expr (TMPL_EXPR_NODE (node));
+      GValue value = G_VALUE_INIT;
+
+      if (tmpl_compiler_fold (compiler, expr, &value))
+        {
+          tmpl_value_into_string (&value, compiler->text);
+          TMPL_CLEAR_VALUE (&value);
+        }
+      else
+        {
+          TmplInstruction insn = { 0 };
+
+          insn.opcode = TMPL_OP_OUTPUT;
+          tmpl_compiler_set_operand (compiler, &insn, expr);
+          tmpl_compiler_emit (compiler, &insn);
+        }
+    }
+  else if (TMPL_IS_BRANCH_NODE (node))
+    {
+      tmpl_compiler_compile_branch (compiler, TMPL_BRANCH_NODE (node));
+    }
+  else if (TMPL_IS_CONDITION_NODE (node))
+    {
+      TmplExpr *expr = tmpl_condition_node_get_condition (TMPL_CONDITION_NODE (node));
+      TmplInstruction insn = { 0 };
+      guint branch;
+
+      insn.opcode = TMPL_OP_BRANCH;
+      tmpl_compiler_set_operand (compiler, &insn, expr);
+      branch = tmpl_compiler_emit (compiler, &insn);
+
+      tmpl_node_visit_children (node, tmpl_compiler_compile_node, compiler);
+
+      tmpl_compiler_patch (compiler, branch, tmpl_compiler_label (compiler));
+    }
+  else if (TMPL_IS_ITER_NODE (node))
+    {
+      tmpl_compiler_compile_iter (compiler, TMPL_ITER_NODE (node));
+    }
+  else
+    {
+      g_warning ("Teach me how to compile %s", G_OBJECT_TYPE_NAME (node));
+    }
+}
+
+/**
+ * tmpl_program_new:
+ * @root: the root #TmplNode of a parsed template
+ *
+ * Compiles the tree starting at @root into a #TmplProgram. The program
+ * holds its own references to the expressions it needs, so it may outlive
+ * @root.
+ *
+ * Returns: (transfer full): A #TmplProgram.
+ */
+TmplProgram *
+tmpl_program_new (TmplNode *root)
+{
+  TmplCompiler compiler = { 0 };
+  TmplProgram *self;
+
+  TMPL_ENTRY;
+
+  g_return_val_if_fail (TMPL_IS_NODE (root), NULL);
+
+  compiler.insns = g_array_new (FALSE, FALSE, sizeof (TmplInstruction));
+  compiler.slots = g_ptr_array_new ();
+  compiler.slot_by_name = g_hash_table_new (g_str_hash, g_str_equal);
+  compiler.loops = g_ptr_array_new ();
+  compiler.text = g_string_new (NULL);
+  compiler.empty_scope = tmpl_scope_new ();
+
+  tmpl_node_visit_children (root, tmpl_compiler_compile_node, &compiler);
+  tmpl_compiler_flush_text (&compiler);
+
+  g_assert (compiler.loops->len == 0);
+
+  self = g_slice_new0 (TmplProgram);
+  self->n_insns = compiler.insns->len;
+  self->insns = (TmplInstruction *)(gpointer)g_array_free (compiler.insns, FALSE);
+  self->n_slots = compiler.slots->len;
+  g_ptr_array_add (compiler.slots, NULL);
+  self->slots = (gchar **)g_ptr_array_free (compiler.slots, FALSE);
+  self->max_depth = compiler.max_depth;
+
+  TMPL_TRACE_MSG ("Compiled template into %u instructions with %u slots",
+                  self->n_insns, self->n_slots);
+
+  g_hash_table_unref (compiler.slot_by_name);
+  g_ptr_array_unref (compiler.loops);
+  g_string_free (compiler.text, TRUE);
+  tmpl_scope_unref (compiler.empty_scope);
+
+  TMPL_RETURN (self);
+}
+
+void
+tmpl_program_free (TmplProgram *self)
+{
+  guint i;
+
+  if (self == NULL)
+    return;
+
+  for (i = 0; i < self->n_insns; i++)
+    {
+      TmplInstruction *insn = &self->insns [i];
+
+      g_clear_pointer (&insn->expr, tmpl_expr_unref);
+      g_clear_pointer (&insn->text, g_free);
+    }
+
+  g_free (self->insns);
+  g_strfreev (self->slots);
+  g_slice_free (TmplProgram, self);
+}
+
+static gboolean
+symbol_into_value (TmplSymbol   *symbol,
+                   const gchar  *name,
+                   GValue       *value,
+                   GError      **error)
+{
+  if (symbol == NULL)
+    {
+      g_set_error (error,
+                   TMPL_ERROR,
+                   TMPL_ERROR_MISSING_SYMBOL,
+                   "No such symbol \"%s\" in scope",
+                   name);
+      return FALSE;
+    }
+
+  if (tmpl_symbol_get_symbol_type (symbol) != TMPL_SYMBOL_VALUE)
+    {
+      g_set_error (error,
+                   TMPL_ERROR,
+                   TMPL_ERROR_NOT_A_VALUE,
+                   "The symbol \"%s\" is not a value",
+                   name);
+      return FALSE;
+    }
+
+  tmpl_symbol_get_value (symbol, value);
+
+  return TRUE;
+}
+
+static inline gboolean
+tmpl_program_load (TmplProgram            *self,
+                   const TmplInstruction  *insn,
+                   TmplScope              *scope,
+                   TmplSymbol            **slots,
+                   TmplFrame              *frames,
+                   GValue                 *value,
+                   GError                **error)
+{
+  switch (insn->operand)
+    {
+    case TMPL_OPERAND_EXPR:
+      return tmpl_expr_eval (insn->expr, scope, value, error);
+
+    case TMPL_OPERAND_SLOT:
+      if (slots [insn->index] == NULL)
+        slots [insn->index] = tmpl_scope_peek (scope, self->slots [insn->index]);
+      return symbol_into_value (slots [insn->index], self->slots [insn->index], value, error);
+
+    case TMPL_OPERAND_LOOP:
+      return symbol_into_value (frames [insn->index].symbol,
+                                frames [insn->index].identifier,
+                                value,
+                                error);
+
+    case TMPL_OPERAND_NONE:
+    default:
+      g_assert_not_reached ();
+      return FALSE;
+    }
+}
+
+static void
+tmpl_program_pop_frame (TmplProgram  *self,
+                        TmplFrame    *frames,
+                        guint        *depth,
+                        TmplScope   **scope,
+                        TmplSymbol  **slots)
+{
+  TmplFrame *frame;
+
+  g_assert (*depth > 0);
+
+  frame = &frames [--(*depth)];
+
+  *scope = frame->parent;
+
+  tmpl_iterator_destroy (&frame->iter);
+  TMPL_CLEAR_VALUE (&frame->value);
+  g_clear_pointer (&frame->scope, tmpl_scope_unref);
+  frame->symbol = NULL;
+
+  /* Symbols resolved through the loop scope may have been released */
+  if (self->n_slots > 0)
+    memset (slots, 0, sizeof (TmplSymbol *) * self->n_slots);
+}
+
+/**
+ * tmpl_program_execute:
+ * @self: A #TmplProgram
+ * @scope: the #TmplScope to expand within
+ * @output: a #GString to append the expansion to
+ * @error: A location for a #GError, or %NULL
+ *
+ * Runs the compiled template, appending the result to @output.
+ *
+ * The program itself is not modified, so it may be executed from
+ * multiple threads at once.
+ *
+ * Returns: %TRUE if successful; otherwise %FALSE and @error is set.
+ */
+gboolean
+tmpl_program_execute (TmplProgram  *self,
+                      TmplScope    *scope,
+                      GString      *output,
+                      GError      **error)
+{
+  TmplSymbol **slots;
+  TmplFrame *frames;
+  gboolean ret = FALSE;
+  guint depth = 0;
+  guint pc = 0;
+
+  g_return_val_if_fail (self != NULL, FALSE);
+  g_return_val_if_fail (scope != NULL, FALSE);
+  g_return_val_if_fail (output != NULL, FALSE);
+
+  slots = g_new0 (TmplSymbol *, self->n_slots);
+  frames = g_new0 (TmplFrame, self->max_depth);
+
+  while (pc < self->n_insns)
+    {
+      const TmplInstruction *insn = &self->insns [pc];
+      GValue value = G_VALUE_INIT;
+
+      switch (insn->opcode)
+        {
+        case TMPL_OP_TEXT:
+          g_string_append_len (output, insn->text, insn->len);
+          pc++;
+          break;
+
+        case TMPL_OP_OUTPUT:
+          if (!tmpl_program_load (self, insn, scope, slots, frames, &value, error))
+            goto failure;
+          tmpl_value_into_string (&value, output);
+          TMPL_CLEAR_VALUE (&value);
+          pc++;
+          break;
+
+        case TMPL_OP_BRANCH:
+          if (!tmpl_program_load (self, insn, scope, slots, frames, &value, error))
+            goto failure;
+          pc = tmpl_value_as_boolean (&value) ? pc + 1 : insn->jump;
+          TMPL_CLEAR_VALUE (&value);
+          break;
+
+        case TMPL_OP_JUMP:
+          pc = insn->jump;
+          break;
+
+        case TMPL_OP_ITER_BEGIN:
+          {
+            TmplFrame *frame = &frames [insn->depth];
+
+            g_assert (insn->depth == depth);
+
+            if (!tmpl_program_load (self, insn, scope, slots, frames, &frame->value, error))
+              {
+                TMPL_CLEAR_VALUE (&frame->value);
+                goto failure;
+              }
+
+            if (!tmpl_value_as_boolean (&frame->value))
+              {
+                TMPL_CLEAR_VALUE (&frame->value);
+                pc = insn->jump;
+                break;
+              }
+
+            frame->parent = scope;
+            frame->scope = tmpl_scope_new_with_parent (scope);
+            frame->symbol = tmpl_symbol_new ();
+            tmpl_scope_take (frame->scope, insn->text, frame->symbol);
+            frame->identifier = insn->text;
+            tmpl_iterator_init (&frame->iter, &frame->value);
+
+            scope = frame->scope;
+            depth++;
+            pc++;
+          }
+          break;
+
+        case TMPL_OP_ITER_NEXT:
+          {
+            TmplFrame *frame = &frames [insn->depth];
+
+            g_assert (insn->depth + 1 == depth);
+
+            if (tmpl_iterator_next (&frame->iter))
+              {
+                tmpl_iterator_get_value (&frame->iter, &value);
+                tmpl_symbol_assign_value (frame->symbol, &value);
+                TMPL_CLEAR_VALUE (&value);
+                pc++;
+              }
+            else
+              {
+                tmpl_program_pop_frame (self, frames, &depth, &scope, slots);
+                pc = insn->jump;
+              }
+          }
+          break;
+
+        default:
+          g_assert_not_reached ();
+        }
+    }
+
+  ret = TRUE;
+
+failure:
+  while (depth > 0)
+    tmpl_program_pop_frame (self, frames, &depth, &scope, slots);
+
+  g_free (frames);
+  g_free (slots);
+
+  g_assert (ret == TRUE || (error == NULL || *error != NULL));
+
+  return ret;
+}
@@ -0,0 +1,42 @@
+/* tmpl-program.h
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This file is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#if !defined (TMPL_GLIB_INSIDE) && !defined (TMPL_GLIB_COMPILATION)
+# error "Only <tmpl-glib.h> can be included directly."
+#endif
+
+#ifndef TMPL_PROGRAM_H
+#define TMPL_PROGRAM_H
+
+#include "tmpl-node.h"
+#include "tmpl-scope.h"
+
+G_BEGIN_DECLS
+
+typedef struct _TmplProgram TmplProgram;
+
+TmplProgram *tmpl_program_new     (TmplNode     *root);
+void         tmpl_program_free    (TmplProgram  *self);
+gboolean     tmpl_program_execute (TmplProgram  *self,
+                                   TmplScope    *scope,
+                                   GString      *output,
+                                   GError      **error);
+
+G_END_DECLS
+
+#endif /* TMPL_PROGRAM_H */
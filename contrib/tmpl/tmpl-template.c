@@ -28,6 +28,7 @@
 #include "tmpl-iter-node.h"
 #include "tmpl-iterator.h"
 #include "tmpl-parser.h"
+#include "tmpl-program.h"
 #include "tmpl-scope.h"
 #include "tmpl-symbol.h"
 #include "tmpl-template.h"
@@ -38,6 +39,7 @@ typedef struct
 {
   TmplParser          *parser;
   TmplTemplateLocator *locator;
+  TmplProgram         *program;
 } TmplTemplatePrivate;
 
 typedef struct
@@ -67,6 +69,7 @@ tmpl_template_finalize (GObject *object)
   TmplTemplatePrivate *priv = tmpl_template_get_instance_private (self);
 
   g_clear_object (&priv->parser);
+  g_clear_pointer (&priv->program, tmpl_program_free);
 
   G_OBJECT_CLASS (tmpl_template_parent_class)->finalize (object);
 }
@@ -264,6 +267,7 @@ tmpl_template_parse (TmplTemplate  *self,
   if (tmpl_parser_parse (parser, cancellable, error))
     {
       g_set_object (&priv->parser, parser);
+      g_clear_pointer (&priv->program, tmpl_program_free);
       ret = TRUE;
     }
 
@@ -272,25 +276,6 @@ tmpl_template_parse (TmplTemplate  *self,
   return ret;
 }
 
-static void
-value_into_string (const GValue *value,
-                   GString      *str)
-{
-  GValue transform = G_VALUE_INIT;
-
-  g_value_init (&transform, G_TYPE_STRING);
-
-  if (g_value_transform (value, &transform))
-    {
-      const gchar *tmp;
-
-      if (NULL != (tmp = g_value_get_string (&transform)))
-        g_string_append (str, tmp);
-    }
-
-  g_value_unset (&transform);
-}
-
 static void
 tmpl_template_expand_visitor (TmplNode *node,
                               gpointer  user_data)
@@ -321,7 +306,7 @@ tmpl_template_expand_visitor (TmplNode *node,
           return;
         }
 
-      value_into_string (&return_value, state->output);
+      tmpl_value_into_string (&return_value, state->output);
       g_value_unset (&return_value);
     }
   else if (TMPL_IS_BRANCH_NODE (node))
@@ -382,7 +367,9 @@ tmpl_template_expand_visitor (TmplNode *node,
 
           state->scope = new_scope;
 
-          symbol = tmpl_scope_get (new_scope, identifier);
+          /* The loop variable shadows any symbol of the same name */
+          symbol = tmpl_symbol_new ();
+          tmpl_scope_take (new_scope, identifier, symbol);
 
           tmpl_iterator_init (&iter, &return_value);
 
@@ -412,6 +399,43 @@ tmpl_template_expand_visitor (TmplNode *node,
     }
 }
 
+/**
+ * tmpl_template_compile:
+ * @self: A #TmplTemplate.
+ * @error: A location for a #GError, or %NULL.
+ *
+ * Compiles the parsed template into a flat instruction stream which is
+ * used by later calls to tmpl_template_expand() instead of walking the
+ * parsed tree. This is worthwhile when the same template is expanded
+ * many times.
+ *
+ * The compiled form is discarded if the template is parsed again.
+ *
+ * Returns: %TRUE if successful, otherwise %FALSE and @error is set.
+ */
+gboolean
+tmpl_template_compile (TmplTemplate  *self,
+                       GError       **error)
+{
+  TmplTemplatePrivate *priv = tmpl_template_get_instance_private (self);
+
+  g_return_val_if_fail (TMPL_IS_TEMPLATE (self), FALSE);
+
+  if (priv->parser == NULL)
+    {
+      g_set_error (error,
+                   TMPL_ERROR,
+                   TMPL_ERROR_INVALID_STATE,
+                   _("Must parse template before compiling"));
+      return FALSE;
+    }
+
+  if (priv->program == NULL)
+    priv->program = tmpl_program_new (tmpl_parser_get_root (priv->parser));
+
+  return TRUE;
+}
+
 /**
  * tmpl_template_expand:
  * @self: A TmplTemplate.
@@ -465,7 +489,10 @@ tmpl_template_expand (TmplTemplate  *self,
   state.error = error;
   state.scope = scope;
 
-  tmpl_node_visit_children (state.root, tmpl_template_expand_visitor, &state);
+  if (priv->program != NULL)
+    state.result = tmpl_program_execute (priv->program, scope, state.output, error);
+  else
+    tmpl_node_visit_children (state.root, tmpl_template_expand_visitor, &state);
 
   if (state.result != FALSE)
     state.result = g_output_stream_write_all (stream,
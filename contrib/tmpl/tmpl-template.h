@@ -62,6 +62,8 @@ gboolean             tmpl_template_parse          (TmplTemplate         *self,
                                                    GInputStream         *stream,
                                                    GCancellable         *cancellable,
                                                    GError              **error);
+gboolean             tmpl_template_compile        (TmplTemplate         *self,
+                                                   GError              **error);
 gboolean             tmpl_template_expand         (TmplTemplate         *self,
                                                    GOutputStream        *stream,
                                                    TmplScope            *scope,
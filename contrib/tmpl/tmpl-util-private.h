@@ -30,6 +30,8 @@ void      tmpl_destroy_in_main_context (GMainContext   *main_context,
                                         GDestroyNotify  destroy);
 gchar    *tmpl_value_repr              (const GValue   *value);
 gboolean  tmpl_value_as_boolean        (const GValue   *value);
+void      tmpl_value_into_string       (const GValue   *value,
+                                        GString        *str);
 
 G_END_DECLS
 
@@ -169,3 +169,22 @@ tmpl_value_as_boolean (const GValue *value)
 
   return ret;
 }
+
+void
+tmpl_value_into_string (const GValue *value,
+                        GString      *str)
+{
+  GValue transform = G_VALUE_INIT;
+
+  g_value_init (&transform, G_TYPE_STRING);
+
+  if (g_value_transform (value, &transform))
+    {
+      const gchar *tmp;
+
+      if (NULL != (tmp = g_value_get_string (&transform)))
+        g_string_append (str, tmp);
+    }
+
+  g_value_unset (&transform);
+}
@@ -20,15 +20,19 @@
 
 #include "config.h"
 
+#include <errno.h>
 #include <glib/gi18n.h>
+#include <unistd.h>
 
 #include "ide-debug.h"
+#include "ide-global.h"
 
 #include "application/ide-application.h"
 #include "application/ide-application-actions.h"
 #include "application/ide-application-credits.h"
 #include "application/ide-application-private.h"
 #include "keybindings/ide-shortcuts-window.h"
+#include "logging/ide-trace.h"
 #include "workbench/ide-workbench.h"
 #include "greeter/ide-greeter-perspective.h"
 
@@ -307,6 +311,50 @@ ide_application_actions_load_project (GSimpleAction *action,
     }
 }
 
+static void
+ide_application_actions_trace (GSimpleAction *action,
+                               GVariant      *state,
+                               gpointer       user_data)
+{
+  g_autofree gchar *dir = NULL;
+  g_autofree gchar *name = NULL;
+  g_autofree gchar *path = NULL;
+  g_autoptr(GError) error = NULL;
+
+  g_assert (G_IS_SIMPLE_ACTION (action));
+  g_assert (g_variant_is_of_type (state, G_VARIANT_TYPE_BOOLEAN));
+
+  g_simple_action_set_state (action, state);
+
+  if (g_variant_get_boolean (state))
+    {
+      ide_trace_clear ();
+      ide_trace_start ();
+      return;
+    }
+
+  ide_trace_stop ();
+
+  dir = g_build_filename (g_get_user_cache_dir (),
+                          ide_get_program_name (),
+                          "traces",
+                          NULL);
+  name = g_strdup_printf ("%d-%"G_GINT64_FORMAT".trace",
+                          (gint)getpid (),
+                          g_get_real_time () / G_USEC_PER_SEC);
+  path = g_build_filename (dir, name, NULL);
+
+  if (g_mkdir_with_parents (dir, 0750) != 0 ||
+      !ide_trace_write_to_file (path, &error))
+    {
+      g_warning ("Failed to write trace to %s: %s",
+                 path, error ? error->message : g_strerror (errno));
+      return;
+    }
+
+  g_message ("Trace written to %s", path);
+}
+
 static const GActionEntry IdeApplicationActions[] = {
   { "about",        ide_application_actions_about },
   { "dayhack",      ide_application_actions_dayhack },
@@ -318,6 +366,7 @@ static const GActionEntry IdeApplicationActions[] = {
   { "quit",         ide_application_actions_quit },
   { "shortcuts",    ide_application_actions_shortcuts },
   { "help",         ide_application_actions_help },
+  { "trace",        NULL, NULL, "false", ide_application_actions_trace },
 };
 
 void
@@ -42,6 +42,7 @@
 #include "application/ide-application-tool.h"
 #include "modelines/modeline-parser.h"
 #include "resources/ide-resources.h"
+#include "symbols/ide-gir-doc-index.h"
 #include "theming/ide-css-provider.h"
 #include "theming/ide-theme-manager.h"
 #include "workbench/ide-workbench.h"
@@ -395,7 +396,12 @@ ide_application_startup (GApplication *application)
   G_APPLICATION_CLASS (ide_application_parent_class)->startup (application);
 
   if (self->mode == IDE_APPLICATION_MODE_PRIMARY)
-    ide_application_register_menus (self);
+    {
+      ide_application_register_menus (self);
+
+      /* Worker processes only read the index, the UI process keeps it current */
+      ide_gir_doc_index_update_async (ide_gir_doc_index_get_default (), NULL, NULL, NULL);
+    }
 
   ide_application_load_addins (self);
 }
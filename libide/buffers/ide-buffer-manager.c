@@ -367,6 +367,10 @@ ide_buffer_manager_buffer_changed (IdeBufferManager *self,
   g_return_if_fail (IDE_IS_BUFFER_MANAGER (self));
   g_return_if_fail (IDE_IS_BUFFER (buffer));
 
+  /* The timeout is re-armed once the bulk edit has finished */
+  if (ide_buffer_get_in_bulk_edit (buffer))
+    return;
+
   if (self->auto_save)
     {
       unregister_auto_save (self, buffer);
@@ -374,6 +378,18 @@ ide_buffer_manager_buffer_changed (IdeBufferManager *self,
     }
 }
 
+static void
+ide_buffer_manager_buffer_bulk_edit_finished (IdeBufferManager  *self,
+                                              const GtkTextIter *begin,
+                                              const GtkTextIter *end,
+                                              IdeBuffer         *buffer)
+{
+  g_assert (IDE_IS_BUFFER_MANAGER (self));
+  g_assert (IDE_IS_BUFFER (buffer));
+
+  ide_buffer_manager_buffer_changed (self, buffer);
+}
+
 static void
 ide_buffer_manager_add_buffer (IdeBufferManager *self,
                                IdeBuffer        *buffer)
@@ -396,6 +412,12 @@ ide_buffer_manager_add_buffer (IdeBufferManager *self,
                            self,
                            (G_CONNECT_SWAPPED | G_CONNECT_AFTER));
 
+  g_signal_connect_object (buffer,
+                           "bulk-edit-finished",
+                           G_CALLBACK (ide_buffer_manager_buffer_bulk_edit_finished),
+                           self,
+                           G_CONNECT_SWAPPED);
+
   EGG_COUNTER_INC (registered);
 
   g_list_model_items_changed (G_LIST_MODEL (self), self->buffers->len - 1, 0, 1);
@@ -447,6 +469,9 @@ ide_buffer_manager_remove_buffer (IdeBufferManager *self,
   g_signal_handlers_disconnect_by_func (buffer,
                                         G_CALLBACK (ide_buffer_manager_buffer_changed),
                                         self);
+  g_signal_handlers_disconnect_by_func (buffer,
+                                        G_CALLBACK (ide_buffer_manager_buffer_bulk_edit_finished),
+                                        self);
 
   /*
    * Notify anything that needs a pointer to the buffer to cleanup,
@@ -636,6 +661,7 @@ ide_buffer_manager__load_file_query_info_cb (GObject      *object,
   GError *error = NULL;
   gsize size = 0;
   gboolean create_new_view;
+  gboolean large_file;
 
   IDE_ENTRY;
 
@@ -665,13 +691,18 @@ ide_buffer_manager__load_file_query_info_cb (GObject      *object,
       size = g_file_info_get_attribute_uint64 (file_info, G_FILE_ATTRIBUTE_STANDARD_SIZE);
     }
 
-  if ((self->max_file_size > 0) && (size > self->max_file_size))
+  /*
+   * Files over the size limit are still opened, but in large-file mode.
+   * The buffer disables the features that need to process the whole
+   * buffer, and we load at a lower priority so that the chunks inserted by
+   * the loader do not starve the rest of the main loop.
+   */
+  large_file = (self->max_file_size > 0) && (size > self->max_file_size);
+  _ide_buffer_set_large_file (state->buffer, large_file);
+
+  if (large_file)
     {
-      g_task_return_new_error (task,
-                               G_IO_ERROR,
-                               G_IO_ERROR_INVALID_DATA,
-                               _("File too large to be opened."));
-      IDE_EXIT;
+      IDE_TRACE_MSG ("Loading %"G_GSIZE_FORMAT" byte file in large-file mode", size);
     }
 
   if (file_info && g_file_info_has_attribute (file_info, G_FILE_ATTRIBUTE_ACCESS_CAN_WRITE))
@@ -695,7 +726,7 @@ ide_buffer_manager__load_file_query_info_cb (GObject      *object,
   g_signal_emit (self, signals [LOAD_BUFFER], 0, state->buffer, create_new_view);
 
   gtk_source_file_loader_load_async (state->loader,
-                                     G_PRIORITY_DEFAULT,
+                                     large_file ? G_PRIORITY_LOW : G_PRIORITY_DEFAULT,
                                      g_task_get_cancellable (task),
                                      ide_progress_file_progress_callback,
                                      g_object_ref (state->progress),
@@ -1699,9 +1730,10 @@ ide_buffer_manager_has_file (IdeBufferManager *self,
  * @self: An #IdeBufferManager.
  *
  * Gets the #IdeBufferManager:max-file-size property. This contains the maximum file size in bytes
- * that a file may be to be loaded by the #IdeBufferManager.
+ * that a file may be to be loaded normally by the #IdeBufferManager. Larger files are loaded in
+ * large-file mode, see #IdeBuffer:large-file.
  *
- * If zero, no size limits will be enforced.
+ * If zero, all files are loaded normally.
  *
  * Returns: A #gsize in bytes or zero.
  */
@@ -1718,7 +1750,8 @@ ide_buffer_manager_get_max_file_size (IdeBufferManager *self)
  * @self: An #IdeBufferManager.
  * @max_file_size: The maximum file size in bytes, or zero for no limit.
  *
- * Sets the maximum file size in bytes, that will be loaded by the #IdeBufferManager.
+ * Sets the maximum file size in bytes, that will be loaded normally by the #IdeBufferManager.
+ * Files larger than this are opened in large-file mode.
  */
 void
 ide_buffer_manager_set_max_file_size (IdeBufferManager *self,
@@ -1944,6 +1977,8 @@ ide_buffer_manager_do_apply_edits (IdeBufferManager *self,
           continue;
         }
 
+      /* Coalesce change notifications until every edit has been applied */
+      ide_buffer_begin_bulk_edit (buffer);
       gtk_text_buffer_begin_user_action (GTK_TEXT_BUFFER (buffer));
 
       _ide_project_edit_prepare (edit, buffer);
@@ -1989,6 +2024,7 @@ ide_buffer_manager_do_apply_edits (IdeBufferManager *self,
         }
 
       gtk_text_buffer_end_user_action (GTK_TEXT_BUFFER (buffer));
+      ide_buffer_end_bulk_edit (buffer);
     }
 
   IDE_EXIT;
@@ -96,8 +96,14 @@ typedef struct
 
   gsize                   change_count;
 
+  GtkTextMark            *bulk_edit_begin;
+  GtkTextMark            *bulk_edit_end;
+  guint                   bulk_edit_depth;
+
+  guint                   bulk_edit_dirty : 1;
   guint                   changed_on_volume : 1;
   guint                   highlight_diagnostics : 1;
+  guint                   large_file : 1;
   guint                   loading : 1;
   guint                   mtime_set : 1;
   guint                   read_only : 1;
@@ -115,6 +121,7 @@ enum {
   PROP_FILE,
   PROP_HAS_DIAGNOSTICS,
   PROP_HIGHLIGHT_DIAGNOSTICS,
+  PROP_LARGE_FILE,
   PROP_READ_ONLY,
   PROP_STYLE_SCHEME_NAME,
   PROP_TITLE,
@@ -122,6 +129,7 @@ enum {
 };
 
 enum {
+  BULK_EDIT_FINISHED,
   CURSOR_MOVED,
   DESTROY,
   LINE_FLAGS_CHANGED,
@@ -569,6 +577,13 @@ ide_buffer_reload_change_monitor (IdeBuffer *self)
       g_clear_object (&priv->change_monitor);
     }
 
+  /*
+   * Change monitors diff the entire buffer against the VCS contents on
+   * every change, which we cannot afford with large files.
+   */
+  if (priv->large_file)
+    return;
+
   if (priv->context && priv->file)
     {
       IdeVcs *vcs;
@@ -628,6 +643,50 @@ ide_buffer_do_modeline (IdeBuffer *self)
     _ide_file_set_content_type (ifile, content_type);
 }
 
+/*
+ * Grows the range modified by the current bulk edit to include @begin
+ * and @end. The marks have outward gravity so they keep covering the
+ * range as more edits happen around it.
+ */
+static void
+ide_buffer_bulk_edit_add_range (IdeBuffer         *self,
+                                const GtkTextIter *begin,
+                                const GtkTextIter *end)
+{
+  IdeBufferPrivate *priv = ide_buffer_get_instance_private (self);
+  GtkTextBuffer *buffer = (GtkTextBuffer *)self;
+  GtkTextIter dirty_begin;
+  GtkTextIter dirty_end;
+
+  g_assert (IDE_IS_BUFFER (self));
+  g_assert (priv->bulk_edit_depth > 0);
+
+  if (priv->bulk_edit_begin == NULL)
+    {
+      priv->bulk_edit_begin = gtk_text_buffer_create_mark (buffer, NULL, begin, TRUE);
+      priv->bulk_edit_end = gtk_text_buffer_create_mark (buffer, NULL, end, FALSE);
+      priv->bulk_edit_dirty = TRUE;
+      return;
+    }
+
+  if (!priv->bulk_edit_dirty)
+    {
+      gtk_text_buffer_move_mark (buffer, priv->bulk_edit_begin, begin);
+      gtk_text_buffer_move_mark (buffer, priv->bulk_edit_end, end);
+      priv->bulk_edit_dirty = TRUE;
+      return;
+    }
+
+  gtk_text_buffer_get_iter_at_mark (buffer, &dirty_begin, priv->bulk_edit_begin);
+  gtk_text_buffer_get_iter_at_mark (buffer, &dirty_end, priv->bulk_edit_end);
+
+  if (gtk_text_iter_compare (begin, &dirty_begin) < 0)
+    gtk_text_buffer_move_mark (buffer, priv->bulk_edit_begin, begin);
+
+  if (gtk_text_iter_compare (end, &dirty_end) > 0)
+    gtk_text_buffer_move_mark (buffer, priv->bulk_edit_end, end);
+}
+
 static void
 ide_buffer_changed (GtkTextBuffer *buffer)
 {
@@ -666,7 +725,10 @@ ide_buffer_delete_range (GtkTextBuffer *buffer,
 
   GTK_TEXT_BUFFER_CLASS (ide_buffer_parent_class)->delete_range (buffer, start, end);
 
-  ide_buffer_emit_cursor_moved (IDE_BUFFER (buffer));
+  if (ide_buffer_get_in_bulk_edit (IDE_BUFFER (buffer)))
+    ide_buffer_bulk_edit_add_range (IDE_BUFFER (buffer), start, start);
+  else
+    ide_buffer_emit_cursor_moved (IDE_BUFFER (buffer));
 
   IDE_EXIT;
 }
@@ -677,7 +739,9 @@ ide_buffer_insert_text (GtkTextBuffer *buffer,
                         const gchar   *text,
                         gint           len)
 {
+  IdeBufferPrivate *priv = ide_buffer_get_instance_private (IDE_BUFFER (buffer));
   gboolean check_modeline = FALSE;
+  gint offset = 0;
 
   g_assert (IDE_IS_BUFFER (buffer));
   g_assert (location);
@@ -693,9 +757,21 @@ ide_buffer_insert_text (GtkTextBuffer *buffer,
       ((text [0] == '\n') || ((len > 1) && (strchr (text, '\n') != NULL))))
     check_modeline = TRUE;
 
+  if (priv->bulk_edit_depth > 0)
+    offset = gtk_text_iter_get_offset (location);
+
   GTK_TEXT_BUFFER_CLASS (ide_buffer_parent_class)->insert_text (buffer, location, text, len);
 
-  ide_buffer_emit_cursor_moved (IDE_BUFFER (buffer));
+  /* @location now points at the end of the inserted text */
+  if (priv->bulk_edit_depth > 0)
+    {
+      GtkTextIter begin;
+
+      gtk_text_buffer_get_iter_at_offset (buffer, &begin, offset);
+      ide_buffer_bulk_edit_add_range (IDE_BUFFER (buffer), &begin, location);
+    }
+  else
+    ide_buffer_emit_cursor_moved (IDE_BUFFER (buffer));
 
   if (check_modeline)
     ide_buffer_do_modeline (IDE_BUFFER (buffer));
@@ -1298,6 +1374,10 @@ ide_buffer_get_property (GObject    *object,
       g_value_set_boolean (value, ide_buffer_get_highlight_diagnostics (self));
       break;
 
+    case PROP_LARGE_FILE:
+      g_value_set_boolean (value, ide_buffer_get_large_file (self));
+      break;
+
     case PROP_READ_ONLY:
       g_value_set_boolean (value, ide_buffer_get_read_only (self));
       break;
@@ -1407,6 +1487,23 @@ ide_buffer_class_init (IdeBufferClass *klass)
                           TRUE,
                           (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * IdeBuffer:large-file:
+   *
+   * If the buffer was loaded from a file larger than
+   * #IdeBufferManager:max-file-size. Features that scale with the size of
+   * the buffer, such as semantic highlighting, change monitoring and
+   * diagnostics are disabled for such buffers. Counting search occurrences
+   * is deferred until the search is activated, rather than done on every
+   * change to the search text.
+   */
+  properties [PROP_LARGE_FILE] =
+    g_param_spec_boolean ("large-file",
+                          "Large File",
+                          "If the buffer is in large-file mode.",
+                          FALSE,
+                          (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
   properties [PROP_READ_ONLY] =
     g_param_spec_boolean ("read-only",
                           "Read Only",
@@ -1430,6 +1527,32 @@ ide_buffer_class_init (IdeBufferClass *klass)
 
   g_object_class_install_properties (object_class, LAST_PROP, properties);
 
+  /**
+   * IdeBuffer::bulk-edit-finished:
+   * @self: An #IdeBuffer.
+   * @begin: the beginning of the modified range.
+   * @end: the end of the modified range.
+   *
+   * This signal is emitted when the outermost bulk edit has completed and
+   * the buffer was modified during it. @begin and @end cover every change
+   * that was made.
+   *
+   * Listeners that react to #GtkTextBuffer::insert-text,
+   * #GtkTextBuffer::delete-range or #GtkTextBuffer::changed should skip
+   * those while ide_buffer_get_in_bulk_edit() returns %TRUE and process the
+   * modified range once from this signal instead.
+   */
+  signals [BULK_EDIT_FINISHED] =
+    g_signal_new ("bulk-edit-finished",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0,
+                  NULL, NULL, NULL,
+                  G_TYPE_NONE,
+                  2,
+                  GTK_TYPE_TEXT_ITER | G_SIGNAL_TYPE_STATIC_SCOPE,
+                  GTK_TYPE_TEXT_ITER | G_SIGNAL_TYPE_STATIC_SCOPE);
+
   /**
    * IdeBuffer::cursor-moved:
    * @self: An #IdeBuffer.
@@ -2153,6 +2276,42 @@ _ide_buffer_set_read_only (IdeBuffer *self,
     }
 }
 
+/**
+ * ide_buffer_get_large_file:
+ * @self: A #IdeBuffer.
+ *
+ * Gets the #IdeBuffer:large-file property.
+ *
+ * Returns: %TRUE if the buffer was opened in large-file mode.
+ */
+gboolean
+ide_buffer_get_large_file (IdeBuffer *self)
+{
+  IdeBufferPrivate *priv = ide_buffer_get_instance_private (self);
+
+  g_return_val_if_fail (IDE_IS_BUFFER (self), FALSE);
+
+  return priv->large_file;
+}
+
+void
+_ide_buffer_set_large_file (IdeBuffer *self,
+                            gboolean   large_file)
+{
+  IdeBufferPrivate *priv = ide_buffer_get_instance_private (self);
+
+  g_return_if_fail (IDE_IS_BUFFER (self));
+
+  large_file = !!large_file;
+
+  if (large_file != priv->large_file)
+    {
+      priv->large_file = large_file;
+      ide_buffer_reload_change_monitor (self);
+      g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_LARGE_FILE]);
+    }
+}
+
 /**
  * ide_buffer_get_changed_on_volume:
  * @self: A #IdeBuffer.
@@ -2714,3 +2873,83 @@ ide_buffer_get_insert_location (IdeBuffer *self)
 
   return ide_buffer_get_iter_location (self, &iter);
 }
+
+/**
+ * ide_buffer_begin_bulk_edit:
+ * @self: An #IdeBuffer.
+ *
+ * Starts a bulk edit. Until the matching call to ide_buffer_end_bulk_edit(),
+ * the buffer only records the range that was modified, and listeners such
+ * as the highlight engine, change monitor and diagnostics skip their per
+ * edit work. They are notified once with #IdeBuffer::bulk-edit-finished
+ * when the outermost bulk edit completes.
+ *
+ * Use this when applying many small edits at once, such as replacing every
+ * match of a search. Bulk edits may be nested.
+ */
+void
+ide_buffer_begin_bulk_edit (IdeBuffer *self)
+{
+  IdeBufferPrivate *priv = ide_buffer_get_instance_private (self);
+
+  g_return_if_fail (IDE_IS_BUFFER (self));
+
+  priv->bulk_edit_depth++;
+}
+
+/**
+ * ide_buffer_end_bulk_edit:
+ * @self: An #IdeBuffer.
+ *
+ * Completes a bulk edit started with ide_buffer_begin_bulk_edit().
+ */
+void
+ide_buffer_end_bulk_edit (IdeBuffer *self)
+{
+  IdeBufferPrivate *priv = ide_buffer_get_instance_private (self);
+  GtkTextIter begin;
+  GtkTextIter end;
+
+  g_return_if_fail (IDE_IS_BUFFER (self));
+  g_return_if_fail (priv->bulk_edit_depth > 0);
+
+  IDE_ENTRY;
+
+  if (--priv->bulk_edit_depth > 0 || !priv->bulk_edit_dirty)
+    IDE_EXIT;
+
+  priv->bulk_edit_dirty = FALSE;
+
+  gtk_text_buffer_get_iter_at_mark (GTK_TEXT_BUFFER (self), &begin, priv->bulk_edit_begin);
+  gtk_text_buffer_get_iter_at_mark (GTK_TEXT_BUFFER (self), &end, priv->bulk_edit_end);
+
+  IDE_TRACE_MSG ("bulk-edit-finished (%d:%d, %d:%d)",
+                 gtk_text_iter_get_line (&begin),
+                 gtk_text_iter_get_line_offset (&begin),
+                 gtk_text_iter_get_line (&end),
+                 gtk_text_iter_get_line_offset (&end));
+
+  g_signal_emit (self, signals [BULK_EDIT_FINISHED], 0, &begin, &end);
+
+  ide_buffer_emit_cursor_moved (self);
+
+  IDE_EXIT;
+}
+
+/**
+ * ide_buffer_get_in_bulk_edit:
+ * @self: An #IdeBuffer.
+ *
+ * Checks if a bulk edit is in progress. See ide_buffer_begin_bulk_edit().
+ *
+ * Returns: %TRUE if changes to the buffer are part of a bulk edit.
+ */
+gboolean
+ide_buffer_get_in_bulk_edit (IdeBuffer *self)
+{
+  IdeBufferPrivate *priv = ide_buffer_get_instance_private (self);
+
+  g_return_val_if_fail (IDE_IS_BUFFER (self), FALSE);
+
+  return priv->bulk_edit_depth > 0;
+}
@@ -60,6 +60,9 @@ struct _IdeBufferClass
   gpointer _reserved8;
 };
 
+void                ide_buffer_begin_bulk_edit               (IdeBuffer            *self);
+void                ide_buffer_end_bulk_edit                 (IdeBuffer            *self);
+gboolean            ide_buffer_get_in_bulk_edit              (IdeBuffer            *self);
 gboolean            ide_buffer_get_busy                      (IdeBuffer            *self);
 gboolean            ide_buffer_get_changed_on_volume         (IdeBuffer            *self);
 gsize               ide_buffer_get_change_count              (IdeBuffer            *self);
@@ -70,6 +73,7 @@ IdeDiagnostic      *ide_buffer_get_diagnostic_at_iter        (IdeBuffer
 IdeFile            *ide_buffer_get_file                      (IdeBuffer            *self);
 IdeBufferLineFlags  ide_buffer_get_line_flags                (IdeBuffer            *self,
                                                               guint                 line);
+gboolean            ide_buffer_get_large_file                (IdeBuffer            *self);
 gboolean            ide_buffer_get_read_only                 (IdeBuffer            *self);
 gboolean            ide_buffer_get_highlight_diagnostics     (IdeBuffer            *self);
 const gchar        *ide_buffer_get_style_scheme_name         (IdeBuffer            *self);
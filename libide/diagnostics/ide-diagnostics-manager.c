@@ -835,12 +835,35 @@ ide_diagnostics_manager_buffer_changed (IdeDiagnosticsManager *self,
   g_assert (IDE_IS_DIAGNOSTICS_MANAGER (self));
   g_assert (IDE_IS_BUFFER (buffer));
 
+  /*
+   * Large files have no diagnostic providers, but queuing a diagnose would
+   * still copy the whole buffer into the unsaved files on every change.
+   */
+  if (ide_buffer_get_large_file (buffer))
+    IDE_EXIT;
+
+  /* Bulk edits queue a single diagnose when they complete. */
+  if (ide_buffer_get_in_bulk_edit (buffer))
+    IDE_EXIT;
+
   group = ide_diagnostics_manager_find_group_from_buffer (self, buffer);
   ide_diagnostics_group_queue_diagnose (group, self);
 
   IDE_EXIT;
 }
 
+static void
+ide_diagnostics_manager_buffer_bulk_edit_finished (IdeDiagnosticsManager *self,
+                                                   const GtkTextIter     *begin,
+                                                   const GtkTextIter     *end,
+                                                   IdeBuffer             *buffer)
+{
+  g_assert (IDE_IS_DIAGNOSTICS_MANAGER (self));
+  g_assert (IDE_IS_BUFFER (buffer));
+
+  ide_diagnostics_manager_buffer_changed (self, buffer);
+}
+
 static void
 ide_diagnostics_manager_buffer_notify_language (IdeDiagnosticsManager *self,
                                                 GParamSpec            *pspec,
@@ -865,7 +888,7 @@ ide_diagnostics_manager_buffer_notify_language (IdeDiagnosticsManager *self,
    */
 
   language = gtk_source_buffer_get_language (GTK_SOURCE_BUFFER (buffer));
-  if (language != NULL)
+  if (language != NULL && !ide_buffer_get_large_file (buffer))
     language_id = gtk_source_language_get_id (language);
   group = ide_diagnostics_manager_find_group_from_buffer (self, buffer);
 
@@ -974,6 +997,12 @@ ide_diagnostics_manager_buffer_loaded (IdeDiagnosticsManager *self,
                            self,
                            G_CONNECT_SWAPPED);
 
+  g_signal_connect_object (buffer,
+                           "bulk-edit-finished",
+                           G_CALLBACK (ide_diagnostics_manager_buffer_bulk_edit_finished),
+                           self,
+                           G_CONNECT_SWAPPED);
+
   g_signal_connect_object (buffer,
                            "notify::file",
                            G_CALLBACK (ide_diagnostics_manager_buffer_notify_file),
@@ -1001,7 +1030,11 @@ ide_diagnostics_manager_buffer_loaded (IdeDiagnosticsManager *self,
 
   language = gtk_source_buffer_get_language (GTK_SOURCE_BUFFER (buffer));
 
-  if (language != NULL)
+  /*
+   * Diagnostic providers need the full contents of the buffer, so a
+   * buffer in large-file mode does not match any of them.
+   */
+  if (language != NULL && !ide_buffer_get_large_file (buffer))
     language_id = gtk_source_language_get_id (language);
 
   group->diagnostics_by_provider = g_hash_table_new_full (NULL,
@@ -1031,7 +1064,8 @@ ide_diagnostics_manager_buffer_loaded (IdeDiagnosticsManager *self,
                                      ide_diagnostics_manager_extension_added,
                                      self);
 
-  ide_diagnostics_group_queue_diagnose (group, self);
+  if (!ide_buffer_get_large_file (buffer))
+    ide_diagnostics_group_queue_diagnose (group, self);
 
   IDE_EXIT;
 }
@@ -1089,6 +1123,10 @@ ide_diagnostics_manager_buffer_unloaded (IdeDiagnosticsManager *self,
                                         G_CALLBACK (ide_diagnostics_manager_buffer_changed),
                                         self);
 
+  g_signal_handlers_disconnect_by_func (buffer,
+                                        G_CALLBACK (ide_diagnostics_manager_buffer_bulk_edit_finished),
+                                        self);
+
   g_signal_handlers_disconnect_by_func (buffer,
                                         G_CALLBACK (ide_diagnostics_manager_buffer_notify_file),
                                         self);
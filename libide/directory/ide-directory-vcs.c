@@ -98,6 +98,42 @@ ide_directory_vcs_is_ignored (IdeVcs  *vcs,
   return FALSE;
 }
 
+static IdeVcsIgnoreMatcher *
+ide_directory_vcs_get_ignore_matcher (IdeVcs *vcs)
+{
+  static IdeVcsIgnoreMatcher *matcher;
+
+  g_assert (IDE_IS_VCS (vcs));
+
+  if (g_once_init_enter (&matcher))
+    {
+      IdeVcsIgnoreMatcher *instance;
+
+      /* Keep in sync with ide_directory_vcs_is_ignored() */
+      instance = ide_vcs_ignore_matcher_new ();
+      ide_vcs_ignore_matcher_add_patterns (instance, NULL,
+                                           "*~\n"
+                                           "*.la\n"
+                                           "*.lo\n"
+                                           "*.o\n"
+                                           "*.swp\n"
+                                           "*.deps\n"
+                                           "*.libs\n"
+                                           "*.pyc\n"
+                                           "*.pyo\n"
+                                           "*.gmo\n"
+                                           "*.git\n"
+                                           "*.bzr\n"
+                                           "*.svn\n"
+                                           "*.dirstamp\n"
+                                           "*.gch\n");
+
+      g_once_init_leave (&matcher, instance);
+    }
+
+  return ide_vcs_ignore_matcher_ref (matcher);
+}
+
 static void
 ide_directory_vcs_dispose (GObject *object)
 {
@@ -242,4 +278,5 @@ vcs_iface_init (IdeVcsInterface *iface)
   iface->is_ignored = ide_directory_vcs_is_ignored;
   iface->get_priority = ide_directory_vcs_get_priority;
   iface->get_branch_name = ide_directory_vcs_get_branch_name;
+  iface->get_ignore_matcher = ide_directory_vcs_get_ignore_matcher;
 }
@@ -419,11 +419,21 @@ search_text_transform_to (GBinding     *binding,
                           gpointer      user_data)
 {
   IdeEditorFrame *self = user_data;
+  IdeBuffer *buffer;
 
   g_assert (IDE_IS_EDITOR_FRAME (self));
   g_assert (from_value != NULL);
   g_assert (to_value != NULL);
 
+  /*
+   * Every change to the search text causes the search context to rescan
+   * the whole buffer to count occurrences. For large files, only update
+   * the search text when the search is activated.
+   */
+  buffer = ide_editor_frame_get_document (self);
+  if (buffer != NULL && ide_buffer_get_large_file (buffer) && !self->committing_search)
+    return FALSE;
+
   if (g_value_get_string (from_value) == NULL)
     {
       g_value_set_string (to_value, "");
@@ -777,6 +787,11 @@ ide_editor_frame__search_key_press_event (IdeEditorFrame *self,
       g_free (self->previous_search_string);
       g_object_get (self->search_entry, "text", &self->previous_search_string, NULL);
 
+      /* push the search text through the binding, see search_text_transform_to() */
+      self->committing_search = TRUE;
+      g_object_notify (G_OBJECT (self->search_entry), "text");
+      self->committing_search = FALSE;
+
       ide_widget_action (GTK_WIDGET (self), "frame", "next-search-result", NULL);
       gtk_widget_grab_focus (GTK_WIDGET (self->source_view));
       return GDK_EVENT_STOP;
@@ -17,9 +17,68 @@
  */
 
 #include <editorconfig/editorconfig.h>
+#include <string.h>
+
+#include "ec_glob.h"
+#include "ini.h"
 
 #include "editorconfig-glib.h"
 
+/*
+ * libeditorconfig reads and parses every .editorconfig from the directory
+ * of the file up to the root each time it is asked about a file. Opening a
+ * number of files from the same project (such as when restoring a session)
+ * would repeat that walk for every file.
+ *
+ * Instead, we use the ini parser and glob matcher from libeditorconfig
+ * directly and keep the parsed files around. The chain of files that
+ * applies to a directory is cached, and so are the resolved settings, keyed
+ * by the directory and the set of sections that matched the file.
+ *
+ * Rather than keeping a file monitor for every ancestor directory, a
+ * cached file is checked against its modification time and size when it
+ * is used, at most once per CHECK_INTERVAL. So a change (or a newly
+ * created .editorconfig) is noticed within that interval. Once the caches
+ * grow past their limits they are dropped and rebuilt on demand.
+ */
+
+#define CHECK_INTERVAL (G_USEC_PER_SEC)
+#define MAX_FILES      1024
+#define MAX_CHAINS     256
+#define MAX_RESOLVED   1024
+
+typedef struct
+{
+  gchar     *pattern;
+  GPtrArray *pairs;
+} EditorconfigSection;
+
+typedef struct
+{
+  volatile gint  ref_count;
+  gchar         *path;
+  GPtrArray     *sections;
+  gint64         mtime;
+  goffset        size;
+  gint64         checked_at;
+  gint           error_line;
+  guint          root : 1;
+} EditorconfigFile;
+
+typedef struct
+{
+  EditorconfigFile    *file;
+  const gchar         *dir;
+  EditorconfigSection *current;
+  gchar               *current_name;
+} ParseState;
+
+G_LOCK_DEFINE_STATIC (cache);
+static GHashTable *files;
+static GHashTable *chains;
+static GHashTable *resolved;
+static guint       generation;
+
 static void
 _g_value_free (gpointer data)
 {
@@ -29,17 +88,374 @@ _g_value_free (gpointer data)
   g_free (value);
 }
 
+static void
+editorconfig_section_free (gpointer data)
+{
+  EditorconfigSection *section = data;
+
+  g_free (section->pattern);
+  g_ptr_array_unref (section->pairs);
+  g_slice_free (EditorconfigSection, section);
+}
+
+static void
+editorconfig_file_unref (gpointer data)
+{
+  EditorconfigFile *file = data;
+
+  if (g_atomic_int_dec_and_test (&file->ref_count))
+    {
+      g_clear_pointer (&file->sections, g_ptr_array_unref);
+      g_free (file->path);
+      g_slice_free (EditorconfigFile, file);
+    }
+}
+
+static EditorconfigFile *
+editorconfig_file_ref (EditorconfigFile *file)
+{
+  g_atomic_int_inc (&file->ref_count);
+  return file;
+}
+
+/*
+ * Gets the modification time (in microseconds) and size of @path. Both
+ * are -1 if the file does not exist.
+ */
+static void
+editorconfig_file_stat (const gchar *path,
+                        gint64      *mtime,
+                        goffset     *size)
+{
+  g_autoptr(GFile) gfile = g_file_new_for_path (path);
+  g_autoptr(GFileInfo) info = NULL;
+
+  *mtime = -1;
+  *size = -1;
+
+  info = g_file_query_info (gfile,
+                            G_FILE_ATTRIBUTE_TIME_MODIFIED","
+                            G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC","
+                            G_FILE_ATTRIBUTE_STANDARD_SIZE,
+                            G_FILE_QUERY_INFO_NONE,
+                            NULL,
+                            NULL);
+
+  if (info != NULL)
+    {
+      *mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED) * G_USEC_PER_SEC +
+               g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+      *size = g_file_info_get_size (info);
+    }
+}
+
+/*
+ * Checks if @file changed on disk since it was parsed. This only touches
+ * the disk once per CHECK_INTERVAL for each file.
+ *
+ * Must be called with the cache lock held.
+ */
+static gboolean
+editorconfig_file_is_stale (EditorconfigFile *file,
+                            gint64            now)
+{
+  gint64 mtime;
+  goffset size;
+
+  if (now - file->checked_at < CHECK_INTERVAL)
+    return FALSE;
+
+  file->checked_at = now;
+
+  editorconfig_file_stat (file->path, &mtime, &size);
+
+  return mtime != file->mtime || size != file->size;
+}
+
+/*
+ * Drops everything that was resolved from the cached files. Changes are
+ * rare enough that dropping every resolved directory is simpler than
+ * tracking which ones used a given file.
+ *
+ * Must be called with the cache lock held.
+ */
+static void
+editorconfig_glib_flush (void)
+{
+  g_hash_table_remove_all (chains);
+  g_hash_table_remove_all (resolved);
+  generation++;
+}
+
+static int
+editorconfig_file_handler (void       *user_data,
+                           const char *section,
+                           const char *name,
+                           const char *value)
+{
+  ParseState *state = user_data;
+  gchar *name_lower;
+  gchar *value_copy;
+
+  if (*section == '\0' &&
+      g_ascii_strcasecmp (name, "root") == 0 &&
+      g_ascii_strcasecmp (value, "true") == 0)
+    {
+      state->file->root = TRUE;
+      return 1;
+    }
+
+  if (state->current == NULL || g_strcmp0 (state->current_name, section) != 0)
+    {
+      const gchar *separator;
+
+      /* This matches how libeditorconfig builds the glob for a section */
+      if (strchr (section, '/') == NULL)
+        separator = "**/";
+      else if (*section != '/')
+        separator = "/";
+      else
+        separator = "";
+
+      state->current = g_slice_new0 (EditorconfigSection);
+      state->current->pattern = g_strconcat (state->dir, separator, section, NULL);
+      state->current->pairs = g_ptr_array_new_with_free_func (g_free);
+      g_ptr_array_add (state->file->sections, state->current);
+
+      g_free (state->current_name);
+      state->current_name = g_strdup (section);
+    }
+
+  name_lower = g_ascii_strdown (name, -1);
+
+  if (g_str_equal (name_lower, "end_of_line") ||
+      g_str_equal (name_lower, "indent_style") ||
+      g_str_equal (name_lower, "indent_size") ||
+      g_str_equal (name_lower, "insert_final_newline") ||
+      g_str_equal (name_lower, "trim_trailing_whitespace") ||
+      g_str_equal (name_lower, "charset"))
+    value_copy = g_ascii_strdown (value, -1);
+  else
+    value_copy = g_strdup (value);
+
+  g_ptr_array_add (state->current->pairs, name_lower);
+  g_ptr_array_add (state->current->pairs, value_copy);
+
+  return 1;
+}
+
+/* Must be called with the cache lock held */
+static EditorconfigFile *
+editorconfig_file_get (const gchar *dir)
+{
+  g_autofree gchar *path = g_strconcat (dir, "/.editorconfig", NULL);
+  EditorconfigFile *file;
+  ParseState state = { 0 };
+  gint ret;
+
+  if ((file = g_hash_table_lookup (files, path)))
+    {
+      if (!editorconfig_file_is_stale (file, g_get_monotonic_time ()))
+        return file;
+
+      g_hash_table_remove (files, path);
+      editorconfig_glib_flush ();
+    }
+
+  if (g_hash_table_size (files) >= MAX_FILES)
+    g_hash_table_remove_all (files);
+
+  file = g_slice_new0 (EditorconfigFile);
+  file->ref_count = 1;
+  file->path = g_steal_pointer (&path);
+  file->sections = g_ptr_array_new_with_free_func (editorconfig_section_free);
+  file->checked_at = g_get_monotonic_time ();
+
+  /* Stat first, so that a change while parsing is noticed next time */
+  editorconfig_file_stat (file->path, &file->mtime, &file->size);
+
+  state.file = file;
+  state.dir = dir;
+
+  /* -1 means the file could not be opened, which is the common case */
+  ret = ini_parse (file->path, editorconfig_file_handler, &state);
+  if (ret > 0)
+    file->error_line = ret;
+
+  g_free (state.current_name);
+
+  g_hash_table_insert (files, file->path, file);
+
+  return file;
+}
+
+/*
+ * Gets the .editorconfig files that apply to @dir, outermost first,
+ * starting from the last one that declares "root = true".
+ *
+ * Must be called with the cache lock held.
+ */
+static GPtrArray *
+editorconfig_glib_get_chain (const gchar  *dir,
+                             GError      **error)
+{
+  g_autoptr(GPtrArray) chain = NULL;
+  g_autofree gchar *current = NULL;
+  GPtrArray *cached;
+  guint first = 0;
+
+  if ((cached = g_hash_table_lookup (chains, dir)))
+    {
+      gint64 now = g_get_monotonic_time ();
+      guint i;
+
+      for (i = 0; i < cached->len; i++)
+        {
+          EditorconfigFile *file = g_ptr_array_index (cached, i);
+
+          if (editorconfig_file_is_stale (file, now))
+            {
+              if (g_hash_table_lookup (files, file->path) == file)
+                g_hash_table_remove (files, file->path);
+              break;
+            }
+        }
+
+      if (i == cached->len)
+        return g_ptr_array_ref (cached);
+
+      editorconfig_glib_flush ();
+    }
+
+  if (g_hash_table_size (chains) >= MAX_CHAINS)
+    editorconfig_glib_flush ();
+
+  chain = g_ptr_array_new_with_free_func (editorconfig_file_unref);
+  current = g_strdup (dir);
+
+  while (TRUE)
+    {
+      EditorconfigFile *file = editorconfig_file_get (current);
+      gchar *slash;
+
+      if (file->error_line > 0)
+        {
+          g_set_error (error,
+                       G_IO_ERROR,
+                       G_IO_ERROR_FAILED,
+                       "Failed to parse editorconfig.");
+          return NULL;
+        }
+
+      g_ptr_array_insert (chain, 0, editorconfig_file_ref (file));
+
+      if (!(slash = strrchr (current, '/')))
+        break;
+
+      *slash = '\0';
+    }
+
+  for (guint i = 0; i < chain->len; i++)
+    {
+      EditorconfigFile *file = g_ptr_array_index (chain, i);
+
+      if (file->root)
+        first = i;
+    }
+
+  if (first > 0)
+    g_ptr_array_remove_range (chain, 0, first);
+
+  g_hash_table_insert (chains, g_strdup (dir), g_ptr_array_ref (chain));
+
+  return g_steal_pointer (&chain);
+}
+
+static GValue *
+editorconfig_glib_value_new (const gchar *key,
+                             const gchar *valuestr)
+{
+  GValue *value = g_new0 (GValue, 1);
+
+  if ((g_strcmp0 (key, "tab_width") == 0) ||
+      (g_strcmp0 (key, "max_line_length") == 0) ||
+      (g_strcmp0 (key, "indent_size") == 0))
+    {
+      g_value_init (value, G_TYPE_INT);
+      g_value_set_int (value, g_ascii_strtoll (valuestr, NULL, 10));
+    }
+  else if ((g_strcmp0 (key, "insert_final_newline") == 0) ||
+           (g_strcmp0 (key, "trim_trailing_whitespace") == 0))
+    {
+      g_value_init (value, G_TYPE_BOOLEAN);
+      g_value_set_boolean (value, g_str_equal (valuestr, "true"));
+    }
+  else
+    {
+      g_value_init (value, G_TYPE_STRING);
+      g_value_set_string (value, valuestr);
+    }
+
+  return value;
+}
+
+static GHashTable *
+editorconfig_glib_resolve (GPtrArray *matched)
+{
+  g_autoptr(GHashTable) values = NULL;
+  GHashTableIter iter;
+  GHashTable *ret;
+  gpointer k, v;
+
+  values = g_hash_table_new (g_str_hash, g_str_equal);
+
+  for (guint i = 0; i < matched->len; i++)
+    {
+      EditorconfigSection *section = g_ptr_array_index (matched, i);
+
+      for (guint j = 0; j + 1 < section->pairs->len; j += 2)
+        g_hash_table_insert (values,
+                             g_ptr_array_index (section->pairs, j),
+                             g_ptr_array_index (section->pairs, j + 1));
+    }
+
+  /* Same post-processing libeditorconfig does for versions before 0.9 */
+  if (g_hash_table_contains (values, "indent_size") &&
+      !g_hash_table_contains (values, "tab_width"))
+    g_hash_table_insert (values, (gchar *)"tab_width", g_hash_table_lookup (values, "indent_size"));
+
+  ret = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, _g_value_free);
+
+  g_hash_table_iter_init (&iter, values);
+
+  while (g_hash_table_iter_next (&iter, &k, &v))
+    g_hash_table_insert (ret, g_strdup (k), editorconfig_glib_value_new (k, v));
+
+  return ret;
+}
+
+/**
+ * editorconfig_glib_read:
+ *
+ * Resolves the editorconfig settings for @file.
+ *
+ * The resulting table is shared with other files that match the same
+ * sections and must not be modified.
+ *
+ * Returns: (transfer full): a #GHashTable of property names to #GValue.
+ */
 GHashTable *
 editorconfig_glib_read (GFile         *file,
                         GCancellable  *cancellable,
                         GError       **error)
 {
-  editorconfig_handle handle = { 0 };
+  g_autoptr(GPtrArray) chain = NULL;
+  g_autoptr(GPtrArray) matched = NULL;
+  g_autofree gchar *filename = NULL;
+  g_autofree gchar *dir = NULL;
   GHashTable *ret = NULL;
-  gchar *filename = NULL;
-  gint code;
-  gint count;
-  guint i;
+  GString *key;
+  guint gen;
 
   filename = g_file_get_path (file);
 
@@ -56,64 +472,75 @@ editorconfig_glib_read (GFile         *file,
       return NULL;
     }
 
-  handle = editorconfig_handle_init ();
-  code = editorconfig_parse (filename, handle);
-
-  switch (code)
+  if (!g_path_is_absolute (filename))
     {
-    case 0:
-      break;
-
-    case EDITORCONFIG_PARSE_NOT_FULL_PATH:
-    case EDITORCONFIG_PARSE_MEMORY_ERROR:
-    case EDITORCONFIG_PARSE_VERSION_TOO_NEW:
-    default:
       g_set_error (error,
                    G_IO_ERROR,
                    G_IO_ERROR_FAILED,
                    "Failed to parse editorconfig.");
-      goto cleanup;
+      return NULL;
     }
 
-  count = editorconfig_handle_get_name_value_count (handle);
+  dir = g_strndup (filename, strrchr (filename, '/') - filename);
 
-  ret = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, _g_value_free);
+  G_LOCK (cache);
 
-  for (i = 0; i < count; i++)
+  if (files == NULL)
     {
-      GValue *value;
-      const gchar *key = NULL;
-      const gchar *valuestr = NULL;
+      files = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, editorconfig_file_unref);
+      chains = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify)g_ptr_array_unref);
+      resolved = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify)g_hash_table_unref);
+    }
 
-      value = g_new0 (GValue, 1);
+  chain = editorconfig_glib_get_chain (dir, error);
+  gen = generation;
 
-      editorconfig_handle_get_name_value (handle, i, &key, &valuestr);
+  G_UNLOCK (cache);
 
-      if ((g_strcmp0 (key, "tab_width") == 0) ||
-          (g_strcmp0 (key, "max_line_length") == 0) ||
-          (g_strcmp0 (key, "indent_size") == 0))
-        {
-          g_value_init (value, G_TYPE_INT);
-          g_value_set_int (value, g_ascii_strtoll (valuestr, NULL, 10));
-        }
-      else if ((g_strcmp0 (key, "insert_final_newline") == 0) ||
-               (g_strcmp0 (key, "trim_trailing_whitespace") == 0))
-        {
-          g_value_init (value, G_TYPE_BOOLEAN);
-          g_value_set_boolean (value, g_str_equal (valuestr, "true"));
-        }
-      else
+  if (chain == NULL)
+    return NULL;
+
+  /* Parsed files are immutable, so the globs can run without the lock */
+  key = g_string_new (dir);
+  matched = g_ptr_array_new ();
+
+  for (guint i = 0; i < chain->len; i++)
+    {
+      EditorconfigFile *ecfile = g_ptr_array_index (chain, i);
+
+      for (guint j = 0; j < ecfile->sections->len; j++)
         {
-          g_value_init (value, G_TYPE_STRING);
-          g_value_set_string (value, valuestr);
+          EditorconfigSection *section = g_ptr_array_index (ecfile->sections, j);
+
+          if (ec_glob (section->pattern, filename) == 0)
+            {
+              g_string_append_printf (key, "\n%u:%u", i, j);
+              g_ptr_array_add (matched, section);
+            }
         }
+    }
+
+  G_LOCK (cache);
+
+  if ((ret = g_hash_table_lookup (resolved, key->str)))
+    {
+      g_hash_table_ref (ret);
+    }
+  else
+    {
+      ret = editorconfig_glib_resolve (matched);
 
-      g_hash_table_replace (ret, g_strdup (key), value);
+      if (g_hash_table_size (resolved) >= MAX_RESOLVED)
+        g_hash_table_remove_all (resolved);
+
+      /* Don't cache results from files that changed while matching */
+      if (gen == generation)
+        g_hash_table_insert (resolved, g_strdup (key->str), g_hash_table_ref (ret));
     }
 
-cleanup:
-  editorconfig_handle_destroy (handle);
-  g_free (filename);
+  G_UNLOCK (cache);
+
+  g_string_free (key, TRUE);
 
   return ret;
 }
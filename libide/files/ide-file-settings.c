@@ -54,6 +54,16 @@ typedef struct
 #define IDE_FILE_SETTINGS_PROPERTY(_1, name, field_type, _3, _pname, _4, _5, _6) \
   guint name##_set : 1;
 #include "ide-file-settings.defs"
+#undef IDE_FILE_SETTINGS_PROPERTY
+
+  /*
+   * The first child that has each property set, so that reading a
+   * property does not have to walk the children. Updated whenever a
+   * child is added or notifies.
+   */
+#define IDE_FILE_SETTINGS_PROPERTY(_1, name, field_type, _3, _pname, _4, _5, _6) \
+  IdeFileSettings *name##_source;
+#include "ide-file-settings.defs"
 #undef IDE_FILE_SETTINGS_PROPERTY
 } IdeFileSettingsPrivate;
 
@@ -77,17 +87,9 @@ static GParamSpec *properties [LAST_PROP];
 ret_type ide_file_settings_get_##name (IdeFileSettings *self) \
 { \
   IdeFileSettingsPrivate *priv = ide_file_settings_get_instance_private (self); \
-  gsize i; \
   g_return_val_if_fail (IDE_IS_FILE_SETTINGS (self), (ret_type)0); \
-  if (priv->children != NULL) \
-    { \
-      for (i = 0; i < priv->children->len; i++) \
-        { \
-          IdeFileSettings *child = g_ptr_array_index (priv->children, i); \
-          if (ide_file_settings_get_##name##_set (child)) \
-            return ide_file_settings_get_##name (child); \
-        } \
-    } \
+  if (priv->name##_source != NULL) \
+    return ide_file_settings_get_##name (priv->name##_source); \
   return priv->name; \
 }
 # include "ide-file-settings.defs"
@@ -336,6 +338,30 @@ ide_file_settings_init (IdeFileSettings *self)
   priv->trim_trailing_whitespace = TRUE;
 }
 
+static void
+ide_file_settings_update_sources (IdeFileSettings *self)
+{
+  IdeFileSettingsPrivate *priv = ide_file_settings_get_instance_private (self);
+  guint n_children = priv->children ? priv->children->len : 0;
+  guint i;
+
+  g_assert (IDE_IS_FILE_SETTINGS (self));
+
+#define IDE_FILE_SETTINGS_PROPERTY(_1, name, _2, _3, _pname, _4, _5, _6) \
+  priv->name##_source = NULL; \
+  for (i = 0; i < n_children; i++) \
+    { \
+      IdeFileSettings *child = g_ptr_array_index (priv->children, i); \
+      if (ide_file_settings_get_##name##_set (child)) \
+        { \
+          priv->name##_source = child; \
+          break; \
+        } \
+    }
+# include "ide-file-settings.defs"
+#undef IDE_FILE_SETTINGS_PROPERTY
+}
+
 static void
 ide_file_settings_child_notify (IdeFileSettings *self,
                                 GParamSpec      *pspec,
@@ -346,7 +372,10 @@ ide_file_settings_child_notify (IdeFileSettings *self,
   g_assert (IDE_IS_FILE_SETTINGS (child));
 
   if (pspec->owner_type == IDE_TYPE_FILE_SETTINGS)
-    g_object_notify_by_pspec (G_OBJECT (self), pspec);
+    {
+      ide_file_settings_update_sources (self);
+      g_object_notify_by_pspec (G_OBJECT (self), pspec);
+    }
 }
 
 static void
@@ -368,6 +397,8 @@ _ide_file_settings_append (IdeFileSettings *self,
     priv->children = g_ptr_array_new_with_free_func (g_object_unref);
 
   g_ptr_array_add (priv->children, g_object_ref (child));
+
+  ide_file_settings_update_sources (self);
 }
 
 static void
@@ -18,6 +18,7 @@
 
 #define G_LOG_DOMAIN "ide-highlight-engine"
 
+#include <egg-counter.h>
 #include <egg-signal-group.h>
 #include <glib/gi18n.h>
 #include <string.h>
@@ -32,6 +33,9 @@
 #define HIGHLIGHT_QUANTA_USEC 5000
 #define PRIVATE_TAG_PREFIX    "gb-private-tag"
 
+EGG_DEFINE_HISTOGRAM (quantum, "IdeHighlightEngine", "Quantum",
+                      "Time spent in the highlighter for each quantum")
+
 struct _IdeHighlightEngine
 {
   IdeObject            parent_instance;
@@ -302,6 +306,7 @@ ide_highlight_engine_tick (IdeHighlightEngine *self)
   GtkTextIter invalid_begin;
   GtkTextIter invalid_end;
   GSList *tags_iter;
+  gint64 begin_time;
 
   IDE_PROBE;
 
@@ -311,7 +316,8 @@ ide_highlight_engine_tick (IdeHighlightEngine *self)
   g_assert (self->invalid_begin != NULL);
   g_assert (self->invalid_end != NULL);
 
-  self->quanta_expiration = g_get_monotonic_time () + HIGHLIGHT_QUANTA_USEC;
+  begin_time = g_get_monotonic_time ();
+  self->quanta_expiration = begin_time + HIGHLIGHT_QUANTA_USEC;
 
   buffer = GTK_TEXT_BUFFER (self->buffer);
 
@@ -340,6 +346,8 @@ ide_highlight_engine_tick (IdeHighlightEngine *self)
   ide_highlighter_update (self->highlighter, ide_highlight_engine_apply_style,
                           &invalid_begin, &invalid_end, &iter);
 
+  EGG_HISTOGRAM_RECORD_SINCE (quantum, begin_time);
+
   if (gtk_text_iter_compare (&iter, &invalid_end) >= 0)
     IDE_GOTO (up_to_date);
 
@@ -521,7 +529,8 @@ ide_highlight_engine__buffer_insert_text_cb (IdeHighlightEngine *self,
   g_assert (text);
   g_assert (IDE_IS_BUFFER (buffer));
 
-  if (!self->enabled)
+  /* Bulk edits are handled once they complete */
+  if (!self->enabled || ide_buffer_get_in_bulk_edit (buffer))
     IDE_EXIT;
 
   /*
@@ -554,7 +563,7 @@ ide_highlight_engine__buffer_delete_range_cb (IdeHighlightEngine *self,
   g_assert (range_begin);
   g_assert (IDE_IS_BUFFER (buffer));
 
-  if (!self->enabled)
+  if (!self->enabled || ide_buffer_get_in_bulk_edit (buffer))
     IDE_EXIT;
 
   /*
@@ -569,6 +578,33 @@ ide_highlight_engine__buffer_delete_range_cb (IdeHighlightEngine *self,
   IDE_EXIT;
 }
 
+static void
+ide_highlight_engine__buffer_bulk_edit_finished_cb (IdeHighlightEngine *self,
+                                                    const GtkTextIter  *range_begin,
+                                                    const GtkTextIter  *range_end,
+                                                    IdeBuffer          *buffer)
+{
+  GtkTextIter begin;
+  GtkTextIter end;
+
+  IDE_ENTRY;
+
+  g_assert (IDE_IS_HIGHLIGHT_ENGINE (self));
+  g_assert (range_begin);
+  g_assert (range_end);
+  g_assert (IDE_IS_BUFFER (buffer));
+
+  if (!self->enabled)
+    IDE_EXIT;
+
+  begin = *range_begin;
+  end = *range_end;
+
+  invalidate_and_highlight (self, &begin, &end);
+
+  IDE_EXIT;
+}
+
 static void
 ide_highlight_engine__notify_language_cb (IdeHighlightEngine *self,
                                           GParamSpec         *pspec,
@@ -580,7 +616,12 @@ ide_highlight_engine__notify_language_cb (IdeHighlightEngine *self,
   g_assert (IDE_IS_HIGHLIGHT_ENGINE (self));
   g_assert (IDE_IS_BUFFER (buffer));
 
-  if ((language = gtk_source_buffer_get_language (GTK_SOURCE_BUFFER (buffer))))
+  /*
+   * Highlighters walk the whole buffer after it is loaded, so we leave
+   * large files without a highlighter at all.
+   */
+  if (!ide_buffer_get_large_file (buffer) &&
+      (language = gtk_source_buffer_get_language (GTK_SOURCE_BUFFER (buffer))))
     lang_id = gtk_source_language_get_id (language);
 
   ide_extension_adapter_set_value (self->extension, lang_id);
@@ -890,12 +931,24 @@ ide_highlight_engine_init (IdeHighlightEngine *self)
                                    self,
                                    G_CONNECT_SWAPPED | G_CONNECT_AFTER);
 
+  egg_signal_group_connect_object (self->signal_group,
+                                   "bulk-edit-finished",
+                                   G_CALLBACK (ide_highlight_engine__buffer_bulk_edit_finished_cb),
+                                   self,
+                                   G_CONNECT_SWAPPED);
+
   egg_signal_group_connect_object (self->signal_group,
                                    "notify::language",
                                    G_CALLBACK (ide_highlight_engine__notify_language_cb),
                                    self,
                                    G_CONNECT_SWAPPED);
 
+  egg_signal_group_connect_object (self->signal_group,
+                                   "notify::large-file",
+                                   G_CALLBACK (ide_highlight_engine__notify_language_cb),
+                                   self,
+                                   G_CONNECT_SWAPPED);
+
   egg_signal_group_connect_object (self->signal_group,
                                    "notify::style-scheme",
                                    G_CALLBACK (ide_highlight_engine__notify_style_scheme_cb),
@@ -1568,29 +1568,40 @@ ide_context_init_async (GAsyncInitable      *initable,
                         gpointer             user_data)
 {
   IdeContext *context = (IdeContext *)initable;
+  IdeAsyncGraph *graph;
 
   g_return_if_fail (G_IS_ASYNC_INITABLE (context));
   g_return_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable));
 
-  ide_async_helper_run (context,
-                        cancellable,
-                        callback,
-                        user_data,
-                        ide_context_init_build_system,
-                        ide_context_init_vcs,
-                        ide_context_init_services,
-                        ide_context_init_project_name,
-                        ide_context_init_back_forward_list,
-                        ide_context_init_snippets,
-                        ide_context_init_scripts,
-                        ide_context_init_unsaved_files,
-                        ide_context_init_add_recent,
-                        ide_context_init_search_engine,
-                        ide_context_init_runtimes,
-                        ide_context_init_configuration_manager,
-                        ide_context_init_diagnostics_manager,
-                        ide_context_init_loaded,
-                        NULL);
+  graph = ide_async_graph_new ("init");
+
+  /*
+   * Steps are started as soon as the steps they depend on have completed.
+   * The build system may override the project file, so nearly everything
+   * else waits for it. Anything that derives a path from the project name
+   * must wait for the doap to be loaded.
+   */
+  ide_async_graph_add_step (graph, "build-system", ide_context_init_build_system, NULL);
+  ide_async_graph_add_step (graph, "snippets", ide_context_init_snippets, NULL);
+  ide_async_graph_add_step (graph, "vcs", ide_context_init_vcs, "build-system", NULL);
+  ide_async_graph_add_step (graph, "services", ide_context_init_services, "build-system", "vcs", NULL);
+  ide_async_graph_add_step (graph, "project-name", ide_context_init_project_name, "build-system", "vcs", NULL);
+  ide_async_graph_add_step (graph, "back-forward-list", ide_context_init_back_forward_list, "project-name", NULL);
+  ide_async_graph_add_step (graph, "scripts", ide_context_init_scripts, "vcs", NULL);
+  ide_async_graph_add_step (graph, "unsaved-files", ide_context_init_unsaved_files, "project-name", NULL);
+  ide_async_graph_add_step (graph, "add-recent", ide_context_init_add_recent, "project-name", NULL);
+  ide_async_graph_add_step (graph, "search-engine", ide_context_init_search_engine, "vcs", NULL);
+  ide_async_graph_add_step (graph, "runtimes", ide_context_init_runtimes, "build-system", "vcs", NULL);
+  ide_async_graph_add_step (graph, "configuration-manager", ide_context_init_configuration_manager,
+                            "runtimes", "project-name", NULL);
+  ide_async_graph_add_step (graph, "diagnostics-manager", ide_context_init_diagnostics_manager,
+                            "services", NULL);
+  ide_async_graph_add_step (graph, "loaded", ide_context_init_loaded,
+                            "back-forward-list", "snippets", "scripts", "unsaved-files",
+                            "add-recent", "search-engine", "configuration-manager",
+                            "diagnostics-manager", NULL);
+
+  ide_async_graph_run (graph, context, cancellable, callback, user_data);
 }
 
 static gboolean
@@ -1885,6 +1896,7 @@ static void
 ide_context_do_unload_locked (IdeContext *self)
 {
   g_autoptr(GTask) task = NULL;
+  IdeAsyncGraph *graph;
 
   g_assert (IDE_IS_CONTEXT (self));
   g_assert (self->delayed_unload_task != NULL);
@@ -1895,16 +1907,24 @@ ide_context_do_unload_locked (IdeContext *self)
   g_clear_object (&self->device_manager);
   g_clear_object (&self->runtime_manager);
 
-  ide_async_helper_run (self,
-                        g_task_get_cancellable (task),
-                        ide_context_unload_cb,
-                        g_object_ref (task),
-                        ide_context_unload_configuration_manager,
-                        ide_context_unload_back_forward_list,
-                        ide_context_unload_buffer_manager,
-                        ide_context_unload_unsaved_files,
-                        ide_context_unload_services,
-                        NULL);
+  graph = ide_async_graph_new ("unload");
+
+  /*
+   * Buffers must be saved before the unsaved files are persisted, and the
+   * services must outlive everything else that may still be using them.
+   */
+  ide_async_graph_add_step (graph, "configuration-manager", ide_context_unload_configuration_manager, NULL);
+  ide_async_graph_add_step (graph, "back-forward-list", ide_context_unload_back_forward_list, NULL);
+  ide_async_graph_add_step (graph, "buffer-manager", ide_context_unload_buffer_manager, NULL);
+  ide_async_graph_add_step (graph, "unsaved-files", ide_context_unload_unsaved_files, "buffer-manager", NULL);
+  ide_async_graph_add_step (graph, "services", ide_context_unload_services,
+                            "configuration-manager", "back-forward-list", "unsaved-files", NULL);
+
+  ide_async_graph_run (graph,
+                       self,
+                       g_task_get_cancellable (task),
+                       ide_context_unload_cb,
+                       g_object_ref (task));
 }
 
 /**
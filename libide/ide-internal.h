@@ -42,6 +42,8 @@ void                _ide_buffer_set_loading                 (IdeBuffer
                                                              gboolean               loading);
 void                _ide_buffer_set_mtime                   (IdeBuffer             *self,
                                                              const GTimeVal        *mtime);
+void                _ide_buffer_set_large_file              (IdeBuffer             *buffer,
+                                                             gboolean               large_file);
 void                _ide_buffer_set_read_only               (IdeBuffer             *buffer,
                                                              gboolean               read_only);
 void                _ide_buffer_manager_reclaim             (IdeBufferManager      *self,
@@ -139,6 +139,8 @@ typedef struct _IdeUnsavedFile                 IdeUnsavedFile;
 
 typedef struct _IdeVcs                         IdeVcs;
 
+typedef struct _IdeVcsIgnoreMatcher            IdeVcsIgnoreMatcher;
+
 typedef struct _IdeHighlightEngine             IdeHighlightEngine;
 
 G_END_DECLS
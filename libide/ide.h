@@ -84,6 +84,7 @@ G_BEGIN_DECLS
 #include "langserv/ide-langserv-symbol-resolver.h"
 #include "local/ide-local-device.h"
 #include "logging/ide-log.h"
+#include "logging/ide-trace.h"
 #include "preferences/ide-preferences-addin.h"
 #include "preferences/ide-preferences.h"
 #include "projects/ide-project-edit.h"
@@ -125,6 +126,7 @@ G_BEGIN_DECLS
 #include "sourceview/ide-source-view.h"
 #include "subprocess/ide-subprocess.h"
 #include "subprocess/ide-subprocess-launcher.h"
+#include "symbols/ide-gir-doc-index.h"
 #include "symbols/ide-symbol-resolver.h"
 #include "symbols/ide-symbol.h"
 #include "symbols/ide-tags-builder.h"
@@ -148,6 +150,7 @@ G_BEGIN_DECLS
 #include "util/ide-ref-ptr.h"
 #include "util/ide-uri.h"
 #include "vcs/ide-vcs-config.h"
+#include "vcs/ide-vcs-ignore-matcher.h"
 #include "vcs/ide-vcs-initializer.h"
 #include "vcs/ide-vcs-uri.h"
 #include "vcs/ide-vcs.h"
@@ -36,6 +36,13 @@
 #include "projects/ide-project.h"
 #include "vcs/ide-vcs.h"
 
+/*
+ * Non-interactive requests are limited to this many outstanding requests
+ * to the language server. Interactive requests are always sent right away
+ * so they never queue up behind slower background work.
+ */
+#define MAX_IN_FLIGHT 4
+
 typedef struct
 {
   EggSignalGroup *buffer_manager_signals;
@@ -44,8 +51,72 @@ typedef struct
   GIOStream      *io_stream;
   GHashTable     *diagnostics_by_file;
   GPtrArray      *languages;
+
+  /*
+   * Requests that have not yet been sent to the peer, one queue for each
+   * IdeLangservCallPriority. Requests are sent in priority order.
+   */
+  GQueue          pending[IDE_LANGSERV_CALL_PRIORITY_BACKGROUND + 1];
+
+  /*
+   * Maps the (method, document, priority) key to the pending or in-flight
+   * call so that newer requests can supersede older ones.
+   */
+  GHashTable     *calls_by_key;
+
+  guint           n_in_flight;
 } IdeLangservClientPrivate;
 
+typedef enum
+{
+  CALL_KIND_COMPLETION,
+  CALL_KIND_DOCUMENT_SYMBOL,
+  CALL_KIND_DEFINITION,
+  CALL_KIND_RENAME,
+  CALL_KIND_OTHER,
+} CallKind;
+
+typedef struct
+{
+  volatile gint            ref_count;
+  IdeLangservClient       *self;
+  GTask                   *task;
+  GCancellable            *cancellable;
+  gchar                   *method;
+  gchar                   *key;
+  gchar                   *uri;
+  JsonNode                *params;
+  GList                    link;
+  gint64                   begin_time;
+  gulong                   cancelled_handler;
+  gint                     id;
+  IdeLangservCallPriority  priority : 3;
+  CallKind                 kind : 3;
+  guint                    in_flight : 1;
+  guint                    completed : 1;
+  guint                    has_position : 1;
+} Call;
+
+#define DEFINE_METHOD_COUNTERS(sym, Name)                                          \
+  EGG_DEFINE_COUNTER (sym##_in_flight, "Language Server", Name " In Flight",      \
+                      "Number of " Name " requests awaiting a reply")             \
+  EGG_DEFINE_COUNTER (sym##_replies, "Language Server", Name " Replies",          \
+                      "Number of " Name " replies received")                      \
+  EGG_DEFINE_COUNTER (sym##_latency, "Language Server", Name " Latency",          \
+                      "Total microseconds spent waiting for " Name " replies")   \
+  EGG_DEFINE_HISTOGRAM (sym##_round_trip, "Language Server", Name " Round Trip",  \
+                        "Time to receive " Name " replies")
+
+DEFINE_METHOD_COUNTERS (completion, "Completion")
+DEFINE_METHOD_COUNTERS (document_symbol, "Document Symbol")
+DEFINE_METHOD_COUNTERS (definition, "Definition")
+DEFINE_METHOD_COUNTERS (rename, "Rename")
+DEFINE_METHOD_COUNTERS (other, "Other")
+EGG_DEFINE_COUNTER (queued, "Language Server", "Queued", "Number of requests waiting to be sent")
+EGG_DEFINE_COUNTER (superseded, "Language Server", "Superseded", "Number of requests replaced by a newer request")
+EGG_DEFINE_COUNTER (cancelled, "Language Server", "Cancelled", "Number of requests cancelled with $/cancelRequest")
+EGG_DEFINE_COUNTER (stale, "Language Server", "Stale", "Number of queued requests dropped because their document changed")
+
 G_DEFINE_TYPE_WITH_PRIVATE (IdeLangservClient, ide_langserv_client, IDE_TYPE_OBJECT)
 
 enum {
@@ -77,6 +148,8 @@ enum {
 static GParamSpec *properties [N_PROPS];
 static guint signals [N_SIGNALS];
 
+static void ide_langserv_client_fail_calls (IdeLangservClient *self);
+
 static gboolean
 ide_langserv_client_supports_buffer (IdeLangservClient *self,
                                      IdeBuffer         *buffer)
@@ -174,6 +247,10 @@ ide_langserv_client_buffer_insert_text (IdeLangservClient *self,
   g_assert (location != NULL);
   g_assert (IDE_IS_BUFFER (buffer));
 
+  /* The whole document is sent once the bulk edit completes */
+  if (ide_buffer_get_in_bulk_edit (buffer))
+    IDE_EXIT;
+
   copy = g_strndup (new_text, len);
 
   uri = ide_buffer_get_uri (buffer);
@@ -234,6 +311,9 @@ ide_langserv_client_buffer_delete_range (IdeLangservClient *self,
   g_assert (end_iter != NULL);
   g_assert (IDE_IS_BUFFER (buffer));
 
+  if (ide_buffer_get_in_bulk_edit (buffer))
+    IDE_EXIT;
+
   uri = ide_buffer_get_uri (buffer);
   version = (gint)ide_buffer_get_change_count (buffer);
 
@@ -274,6 +354,54 @@ ide_langserv_client_buffer_delete_range (IdeLangservClient *self,
   IDE_EXIT;
 }
 
+static void
+ide_langserv_client_buffer_bulk_edit_finished (IdeLangservClient *self,
+                                               const GtkTextIter *begin_iter,
+                                               const GtkTextIter *end_iter,
+                                               IdeBuffer         *buffer)
+{
+  g_autoptr(JsonNode) params = NULL;
+  g_autofree gchar *uri = NULL;
+  g_autofree gchar *text = NULL;
+  GtkTextIter begin;
+  GtkTextIter end;
+  gint version;
+
+  IDE_ENTRY;
+
+  g_assert (IDE_IS_LANGSERV_CLIENT (self));
+  g_assert (IDE_IS_BUFFER (buffer));
+
+  /*
+   * Rather than replaying every edit of the transaction, send a single
+   * change containing the whole document. Ranges are omitted so that the
+   * server replaces its copy of the document.
+   */
+
+  uri = ide_buffer_get_uri (buffer);
+  version = (gint)ide_buffer_get_change_count (buffer);
+
+  gtk_text_buffer_get_bounds (GTK_TEXT_BUFFER (buffer), &begin, &end);
+  text = gtk_text_buffer_get_text (GTK_TEXT_BUFFER (buffer), &begin, &end, TRUE);
+
+  params = JCON_NEW (
+    "textDocument", "{",
+      "uri", JCON_STRING (uri),
+      "version", JCON_INT (version),
+    "}",
+    "contentChanges", "[",
+      "{",
+        "text", JCON_STRING (text),
+      "}",
+    "]");
+
+  ide_langserv_client_send_notification_async (self, "textDocument/didChange",
+                                               g_steal_pointer (&params),
+                                               NULL, NULL, NULL);
+
+  IDE_EXIT;
+}
+
 static void
 ide_langserv_client_buffer_loaded (IdeLangservClient *self,
                                    IdeBuffer         *buffer,
@@ -303,6 +431,12 @@ ide_langserv_client_buffer_loaded (IdeLangservClient *self,
                            self,
                            G_CONNECT_SWAPPED);
 
+  g_signal_connect_object (buffer,
+                           "bulk-edit-finished",
+                           G_CALLBACK (ide_langserv_client_buffer_bulk_edit_finished),
+                           self,
+                           G_CONNECT_SWAPPED);
+
   uri = ide_buffer_get_uri (buffer);
 
   params = JCON_NEW (
@@ -656,6 +790,7 @@ ide_langserv_client_finalize (GObject *object)
 
   g_clear_pointer (&priv->diagnostics_by_file, g_hash_table_unref);
   g_clear_pointer (&priv->languages, g_ptr_array_unref);
+  g_clear_pointer (&priv->calls_by_key, g_hash_table_unref);
   g_clear_object (&priv->rpc_client);
   g_clear_object (&priv->buffer_manager_signals);
   g_clear_object (&priv->project_signals);
@@ -786,6 +921,11 @@ ide_langserv_client_init (IdeLangservClient *self)
 
   priv->languages = g_ptr_array_new_with_free_func (g_free);
 
+  for (guint i = 0; i < G_N_ELEMENTS (priv->pending); i++)
+    g_queue_init (&priv->pending[i]);
+
+  priv->calls_by_key = g_hash_table_new (g_str_hash, g_str_equal);
+
   priv->diagnostics_by_file = g_hash_table_new_full ((GHashFunc)g_file_hash,
                                                      (GEqualFunc)g_file_equal,
                                                      g_object_unref,
@@ -991,9 +1131,327 @@ ide_langserv_client_stop (IdeLangservClient *self)
       g_clear_object (&priv->rpc_client);
     }
 
+  ide_langserv_client_fail_calls (self);
+
   IDE_EXIT;
 }
 
+static void ide_langserv_client_pump       (IdeLangservClient       *self);
+static void ide_langserv_client_queue_call (IdeLangservClient       *self,
+                                            const gchar             *method,
+                                            JsonNode                *params,
+                                            IdeLangservCallPriority  priority,
+                                            gboolean                 supersede,
+                                            GCancellable            *cancellable,
+                                            GAsyncReadyCallback      callback,
+                                            gpointer                 user_data);
+
+static CallKind
+call_kind_from_method (const gchar *method)
+{
+  if (g_str_equal (method, "textDocument/completion"))
+    return CALL_KIND_COMPLETION;
+  else if (g_str_equal (method, "textDocument/documentSymbol"))
+    return CALL_KIND_DOCUMENT_SYMBOL;
+  else if (g_str_equal (method, "textDocument/definition"))
+    return CALL_KIND_DEFINITION;
+  else if (g_str_equal (method, "textDocument/rename"))
+    return CALL_KIND_RENAME;
+  else
+    return CALL_KIND_OTHER;
+}
+
+/*
+ * Updates the counters for @kind. If @latency is negative, the request
+ * did not receive a reply (such as when cancelled).
+ */
+static void
+call_kind_account (CallKind kind,
+                   gint64   in_flight,
+                   gint64   latency)
+{
+#define ACCOUNT(sym)                               \
+  G_STMT_START {                                   \
+    EGG_COUNTER_ADD (sym##_in_flight, in_flight);  \
+    if (latency >= 0)                              \
+      {                                            \
+        EGG_COUNTER_INC (sym##_replies);           \
+        EGG_COUNTER_ADD (sym##_latency, latency);  \
+        EGG_HISTOGRAM_RECORD (sym##_round_trip,    \
+                              latency);            \
+      }                                            \
+  } G_STMT_END
+
+  switch (kind)
+    {
+    case CALL_KIND_COMPLETION:      ACCOUNT (completion);      break;
+    case CALL_KIND_DOCUMENT_SYMBOL: ACCOUNT (document_symbol); break;
+    case CALL_KIND_DEFINITION:      ACCOUNT (definition);      break;
+    case CALL_KIND_RENAME:          ACCOUNT (rename);          break;
+    case CALL_KIND_OTHER:
+    default:                        ACCOUNT (other);           break;
+    }
+
+#undef ACCOUNT
+}
+
+/*
+ * Gets the uri of the document a request or notification is about, and
+ * whether it refers to a position within that document.
+ */
+static const gchar *
+params_get_document (JsonNode *params,
+                     gboolean *has_position)
+{
+  JsonObject *obj;
+  JsonNode *text_document;
+
+  if (params == NULL ||
+      !JSON_NODE_HOLDS_OBJECT (params) ||
+      NULL == (obj = json_node_get_object (params)) ||
+      NULL == (text_document = json_object_get_member (obj, "textDocument")) ||
+      !JSON_NODE_HOLDS_OBJECT (text_document))
+    return NULL;
+
+  if (has_position != NULL)
+    *has_position = json_object_has_member (obj, "position");
+
+  return json_object_get_string_member (json_node_get_object (text_document), "uri");
+}
+
+/*
+ * Requests about a document are keyed by method, document, and priority.
+ * A newer request with the same key makes the older one useless, since
+ * the reply would describe text the user has already moved past.
+ */
+static gchar *
+call_make_key (const gchar             *method,
+               const gchar             *uri,
+               IdeLangservCallPriority  priority)
+{
+  g_assert (method != NULL);
+
+  if (uri == NULL)
+    return NULL;
+
+  return g_strdup_printf ("%s|%u|%s", method, priority, uri);
+}
+
+static Call *
+call_ref (Call *call)
+{
+  g_assert (call != NULL);
+  g_assert (call->ref_count > 0);
+
+  g_atomic_int_inc (&call->ref_count);
+
+  return call;
+}
+
+static void
+call_unref (Call *call)
+{
+  g_assert (call != NULL);
+  g_assert (call->ref_count > 0);
+
+  if (g_atomic_int_dec_and_test (&call->ref_count))
+    {
+      g_assert (call->task == NULL);
+      g_assert (call->cancelled_handler == 0);
+
+      g_clear_object (&call->self);
+      g_clear_object (&call->cancellable);
+      g_clear_pointer (&call->method, g_free);
+      g_clear_pointer (&call->key, g_free);
+      g_clear_pointer (&call->uri, g_free);
+      g_clear_pointer (&call->params, json_node_unref);
+      g_slice_free (Call, call);
+    }
+}
+
+/*
+ * Completes @call with either @reply or @error. If the call is still
+ * waiting on the peer, the peer is told to stop working on it.
+ */
+static void
+ide_langserv_client_complete_call (IdeLangservClient *self,
+                                   Call              *call,
+                                   JsonNode          *reply,
+                                   GError            *error)
+{
+  IdeLangservClientPrivate *priv = ide_langserv_client_get_instance_private (self);
+  g_autoptr(GTask) task = NULL;
+
+  g_assert (IDE_IS_LANGSERV_CLIENT (self));
+  g_assert (call != NULL);
+  g_assert (reply != NULL || error != NULL);
+
+  if (call->completed)
+    return;
+
+  call_ref (call);
+
+  call->completed = TRUE;
+  task = g_steal_pointer (&call->task);
+
+  if (call->key != NULL && g_hash_table_lookup (priv->calls_by_key, call->key) == call)
+    g_hash_table_remove (priv->calls_by_key, call->key);
+
+  if (call->link.data != NULL)
+    {
+      g_queue_unlink (&priv->pending[call->priority], &call->link);
+      call->link.data = NULL;
+      EGG_COUNTER_DEC (queued);
+      call_unref (call);
+    }
+
+  if (call->in_flight)
+    {
+      call->in_flight = FALSE;
+      priv->n_in_flight--;
+
+      if (reply != NULL)
+        {
+          call_kind_account (call->kind, -1, g_get_monotonic_time () - call->begin_time);
+        }
+      else
+        {
+          call_kind_account (call->kind, -1, -1);
+
+          if (priv->rpc_client != NULL &&
+              g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+            {
+              EGG_COUNTER_INC (cancelled);
+              jsonrpc_client_send_notification_async (priv->rpc_client,
+                                                      "$/cancelRequest",
+                                                      JCON_NEW ("id", JCON_INT (call->id)),
+                                                      NULL, NULL, NULL);
+            }
+        }
+    }
+
+  if (call->cancelled_handler != 0)
+    {
+      g_cancellable_disconnect (call->cancellable, call->cancelled_handler);
+      call->cancelled_handler = 0;
+    }
+
+  if (error != NULL)
+    g_task_return_error (task, g_error_copy (error));
+  else
+    g_task_return_pointer (task, json_node_ref (reply), (GDestroyNotify)json_node_unref);
+
+  call_unref (call);
+
+  ide_langserv_client_pump (self);
+}
+
+static void
+ide_langserv_client_cancel_call (IdeLangservClient *self,
+                                 Call              *call,
+                                 const gchar       *message)
+{
+  g_autoptr(GError) error = NULL;
+
+  g_assert (IDE_IS_LANGSERV_CLIENT (self));
+  g_assert (call != NULL);
+
+  error = g_error_new_literal (G_IO_ERROR, G_IO_ERROR_CANCELLED, message);
+  ide_langserv_client_complete_call (self, call, NULL, error);
+}
+
+static void
+ide_langserv_client_fail_calls (IdeLangservClient *self)
+{
+  IdeLangservClientPrivate *priv = ide_langserv_client_get_instance_private (self);
+  g_autoptr(GError) error = NULL;
+
+  g_assert (IDE_IS_LANGSERV_CLIENT (self));
+
+  error = g_error_new_literal (G_IO_ERROR,
+                               G_IO_ERROR_NOT_CONNECTED,
+                               "No connection to language server");
+
+  for (guint i = 0; i < G_N_ELEMENTS (priv->pending); i++)
+    {
+      while (priv->pending[i].head != NULL)
+        ide_langserv_client_complete_call (self, priv->pending[i].head->data, NULL, error);
+    }
+}
+
+/*
+ * Requests waiting to be sent that refer to a position within @uri were
+ * built against the previous contents of the document. The server applies
+ * the change before seeing them, so they could describe the wrong text and
+ * are cancelled instead.
+ */
+static void
+ide_langserv_client_drop_stale_calls (IdeLangservClient *self,
+                                      const gchar       *uri)
+{
+  IdeLangservClientPrivate *priv = ide_langserv_client_get_instance_private (self);
+  g_autoptr(GPtrArray) stale = NULL;
+
+  g_assert (IDE_IS_LANGSERV_CLIENT (self));
+  g_assert (uri != NULL);
+
+  for (guint i = 0; i < G_N_ELEMENTS (priv->pending); i++)
+    {
+      for (const GList *iter = priv->pending[i].head; iter != NULL; iter = iter->next)
+        {
+          Call *call = iter->data;
+
+          if (call->has_position && g_strcmp0 (call->uri, uri) == 0)
+            {
+              if (stale == NULL)
+                stale = g_ptr_array_new_with_free_func ((GDestroyNotify)call_unref);
+              g_ptr_array_add (stale, call_ref (call));
+            }
+        }
+    }
+
+  if (stale == NULL)
+    return;
+
+  for (guint i = 0; i < stale->len; i++)
+    {
+      EGG_COUNTER_INC (stale);
+      ide_langserv_client_cancel_call (self,
+                                       g_ptr_array_index (stale, i),
+                                       "The document changed before the request was sent");
+    }
+}
+
+static gboolean
+call_cancelled_idle (gpointer data)
+{
+  Call *call = data;
+
+  g_assert (call != NULL);
+
+  if (!call->completed)
+    ide_langserv_client_cancel_call (call->self, call, "The operation was cancelled");
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+call_cancelled_cb (GCancellable *cancellable,
+                   Call         *call)
+{
+  g_assert (G_IS_CANCELLABLE (cancellable));
+  g_assert (call != NULL);
+
+  /*
+   * We cannot disconnect from the cancellable from within this callback,
+   * so defer completing the call to the main loop.
+   */
+  g_idle_add_full (G_PRIORITY_HIGH,
+                   call_cancelled_idle,
+                   call_ref (call),
+                   (GDestroyNotify)call_unref);
+}
+
 static void
 ide_langserv_client_call_cb (GObject      *object,
                              GAsyncResult *result,
@@ -1002,24 +1460,84 @@ ide_langserv_client_call_cb (GObject      *object,
   JsonrpcClient *client = (JsonrpcClient *)object;
   g_autoptr(JsonNode) return_value = NULL;
   g_autoptr(GError) error = NULL;
-  g_autoptr(GTask) task = user_data;
+  Call *call = user_data;
 
   IDE_ENTRY;
 
   g_assert (JSONRPC_IS_CLIENT (client));
   g_assert (G_IS_ASYNC_RESULT (result));
+  g_assert (call != NULL);
 
-  if (!jsonrpc_client_call_finish (client, result, &return_value, &error))
-    {
-      g_task_return_error (task, g_steal_pointer (&error));
-      return;
-    }
+  jsonrpc_client_call_finish (client, result, &return_value, &error);
+
+  /* Replies to superseded or cancelled calls are simply dropped. */
+  if (!call->completed)
+    ide_langserv_client_complete_call (call->self, call, return_value, error);
 
-  g_task_return_pointer (task, g_steal_pointer (&return_value), (GDestroyNotify)json_node_unref);
+  call_unref (call);
 
   IDE_EXIT;
 }
 
+static void
+ide_langserv_client_dispatch (IdeLangservClient *self,
+                              Call              *call)
+{
+  IdeLangservClientPrivate *priv = ide_langserv_client_get_instance_private (self);
+
+  g_assert (IDE_IS_LANGSERV_CLIENT (self));
+  g_assert (call != NULL);
+  g_assert (!call->in_flight);
+  g_assert (!call->completed);
+  g_assert (priv->rpc_client != NULL);
+
+  IDE_TRACE_MSG ("Sending %s (priority %d)", call->method, call->priority);
+
+  call->in_flight = TRUE;
+  call->begin_time = g_get_monotonic_time ();
+  priv->n_in_flight++;
+  call_kind_account (call->kind, 1, -1);
+
+  jsonrpc_client_call_with_id_async (priv->rpc_client,
+                                     call->method,
+                                     g_steal_pointer (&call->params),
+                                     &call->id,
+                                     NULL,
+                                     ide_langserv_client_call_cb,
+                                     call_ref (call));
+}
+
+static void
+ide_langserv_client_pump (IdeLangservClient *self)
+{
+  IdeLangservClientPrivate *priv = ide_langserv_client_get_instance_private (self);
+
+  g_assert (IDE_IS_LANGSERV_CLIENT (self));
+
+  if (priv->rpc_client == NULL)
+    return;
+
+  for (guint i = 0; i < G_N_ELEMENTS (priv->pending); i++)
+    {
+      GQueue *queue = &priv->pending[i];
+
+      while (queue->head != NULL &&
+             (i == IDE_LANGSERV_CALL_PRIORITY_INTERACTIVE || priv->n_in_flight < MAX_IN_FLIGHT))
+        {
+          GList *link = g_queue_pop_head_link (queue);
+          Call *call = link->data;
+
+          link->data = NULL;
+          EGG_COUNTER_DEC (queued);
+
+          ide_langserv_client_dispatch (self, call);
+
+          /* Drop the reference owned by the pending queue */
+          call_unref (call);
+        }
+    }
+}
+
 /**
  * ide_langserv_client_call_async:
  * @self: An #IdeLangservClient
@@ -1030,6 +1548,10 @@ ide_langserv_client_call_cb (GObject      *object,
  * @user_data: user data for @callback
  *
  * Asynchronously queries the Language Server using the JSON-RPC protocol.
+ *
+ * The request is sent immediately and is never superseded by a later one.
+ * Use ide_langserv_client_call_with_priority_async() to have it scheduled
+ * with other requests instead.
  */
 void
 ide_langserv_client_call_async (IdeLangservClient   *self,
@@ -1038,17 +1560,93 @@ ide_langserv_client_call_async (IdeLangservClient   *self,
                                 GCancellable        *cancellable,
                                 GAsyncReadyCallback  callback,
                                 gpointer             user_data)
+{
+  g_return_if_fail (IDE_IS_LANGSERV_CLIENT (self));
+  g_return_if_fail (method != NULL);
+  g_return_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+  ide_langserv_client_queue_call (self,
+                                  method,
+                                  params,
+                                  IDE_LANGSERV_CALL_PRIORITY_INTERACTIVE,
+                                  FALSE,
+                                  cancellable,
+                                  callback,
+                                  user_data);
+}
+
+/**
+ * ide_langserv_client_call_with_priority_async:
+ * @self: An #IdeLangservClient
+ * @method: the method to call
+ * @params: (nullable) (transfer full): An #JsonNode or %NULL
+ * @priority: the priority of the request
+ * @cancellable: (nullable): A cancellable or %NULL
+ * @callback: the callback to receive the result, or %NULL
+ * @user_data: user data for @callback
+ *
+ * Asynchronously queries the Language Server using the JSON-RPC protocol.
+ *
+ * Requests are sent in @priority order. If a request for the same method
+ * and document is already pending or in flight at the same priority, it is
+ * superseded by this request and completes with %G_IO_ERROR_CANCELLED. The
+ * Language Server is notified of cancelled requests with "$/cancelRequest".
+ *
+ * A request that refers to a position within a document and has not been
+ * sent yet is also cancelled when the document changes.
+ */
+void
+ide_langserv_client_call_with_priority_async (IdeLangservClient       *self,
+                                              const gchar             *method,
+                                              JsonNode                *params,
+                                              IdeLangservCallPriority  priority,
+                                              GCancellable            *cancellable,
+                                              GAsyncReadyCallback      callback,
+                                              gpointer                 user_data)
+{
+  g_return_if_fail (IDE_IS_LANGSERV_CLIENT (self));
+  g_return_if_fail (method != NULL);
+  g_return_if_fail (priority <= IDE_LANGSERV_CALL_PRIORITY_BACKGROUND);
+  g_return_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+  ide_langserv_client_queue_call (self,
+                                  method,
+                                  params,
+                                  priority,
+                                  TRUE,
+                                  cancellable,
+                                  callback,
+                                  user_data);
+}
+
+static void
+ide_langserv_client_queue_call (IdeLangservClient       *self,
+                                const gchar             *method,
+                                JsonNode                *params,
+                                IdeLangservCallPriority  priority,
+                                gboolean                 supersede,
+                                GCancellable            *cancellable,
+                                GAsyncReadyCallback      callback,
+                                gpointer                 user_data)
 {
   IdeLangservClientPrivate *priv = ide_langserv_client_get_instance_private (self);
   g_autoptr(GTask) task = NULL;
+  gboolean has_position = FALSE;
+  const gchar *uri;
+  Call *previous;
+  Call *call;
 
   IDE_ENTRY;
 
+  g_assert (IDE_IS_LANGSERV_CLIENT (self));
+  g_assert (method != NULL);
+
   task = g_task_new (self, cancellable, callback, user_data);
   g_task_set_source_tag (task, ide_langserv_client_call_async);
 
   if (priv->rpc_client == NULL)
     {
+      g_clear_pointer (&params, json_node_unref);
       g_task_return_new_error (task,
                                G_IO_ERROR,
                                G_IO_ERROR_NOT_CONNECTED,
@@ -1056,12 +1654,51 @@ ide_langserv_client_call_async (IdeLangservClient   *self,
       IDE_EXIT;
     }
 
-  jsonrpc_client_call_async (priv->rpc_client,
-                             method,
-                             params,
-                             cancellable,
-                             ide_langserv_client_call_cb,
-                             g_steal_pointer (&task));
+  if (g_task_return_error_if_cancelled (task))
+    {
+      g_clear_pointer (&params, json_node_unref);
+      IDE_EXIT;
+    }
+
+  call = g_slice_new0 (Call);
+  call->ref_count = 1;
+  call->self = g_object_ref (self);
+  call->task = g_steal_pointer (&task);
+  call->method = g_strdup (method);
+  uri = params_get_document (params, &has_position);
+  call->uri = g_strdup (uri);
+  call->has_position = has_position;
+  call->key = supersede ? call_make_key (method, uri, priority) : NULL;
+  call->params = params;
+  call->priority = priority;
+  call->kind = call_kind_from_method (method);
+
+  if (call->key != NULL)
+    {
+      if (NULL != (previous = g_hash_table_lookup (priv->calls_by_key, call->key)))
+        {
+          EGG_COUNTER_INC (superseded);
+          ide_langserv_client_cancel_call (self, previous, "Superseded by a newer request");
+        }
+
+      g_hash_table_insert (priv->calls_by_key, call->key, call);
+    }
+
+  if (cancellable != NULL)
+    {
+      call->cancellable = g_object_ref (cancellable);
+      call->cancelled_handler = g_cancellable_connect (cancellable,
+                                                       G_CALLBACK (call_cancelled_cb),
+                                                       call,
+                                                       NULL);
+    }
+
+  /* The pending queue owns our initial reference */
+  call->link.data = call;
+  g_queue_push_tail_link (&priv->pending[priority], &call->link);
+  EGG_COUNTER_INC (queued);
+
+  ide_langserv_client_pump (self);
 
   IDE_EXIT;
 }
@@ -1118,6 +1755,9 @@ ide_langserv_client_send_notification_cb (GObject      *object,
  * @user_data: user data for @notificationback
  *
  * Asynchronously sends a notification to the Language Server.
+ *
+ * Sending "textDocument/didChange" cancels the requests about positions
+ * within the document that are still waiting to be sent.
  */
 void
 ide_langserv_client_send_notification_async (IdeLangservClient   *self,
@@ -1130,6 +1770,10 @@ ide_langserv_client_send_notification_async (IdeLangservClient   *self,
   IdeLangservClientPrivate *priv = ide_langserv_client_get_instance_private (self);
   g_autoptr(GTask) task = NULL;
 
+  g_return_if_fail (IDE_IS_LANGSERV_CLIENT (self));
+  g_return_if_fail (method != NULL);
+  g_return_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable));
+
   IDE_ENTRY;
 
   task = g_task_new (self, cancellable, notificationback, user_data);
@@ -1144,6 +1788,14 @@ ide_langserv_client_send_notification_async (IdeLangservClient   *self,
       IDE_EXIT;
     }
 
+  if (g_str_equal (method, "textDocument/didChange"))
+    {
+      const gchar *uri = params_get_document (params, NULL);
+
+      if (uri != NULL)
+        ide_langserv_client_drop_stale_calls (self, uri);
+    }
+
   jsonrpc_client_send_notification_async (priv->rpc_client,
                                           method,
                                           params,
@@ -27,6 +27,22 @@ G_BEGIN_DECLS
 
 #define IDE_TYPE_LANGSERV_CLIENT (ide_langserv_client_get_type())
 
+/**
+ * IdeLangservCallPriority:
+ * @IDE_LANGSERV_CALL_PRIORITY_INTERACTIVE: the user is waiting on the reply,
+ *   such as for completion results. These are sent immediately.
+ * @IDE_LANGSERV_CALL_PRIORITY_HIGHLIGHT: the reply affects what is visible,
+ *   such as highlighting of symbols.
+ * @IDE_LANGSERV_CALL_PRIORITY_BACKGROUND: background requests such as
+ *   populating the symbol tree.
+ */
+typedef enum
+{
+  IDE_LANGSERV_CALL_PRIORITY_INTERACTIVE,
+  IDE_LANGSERV_CALL_PRIORITY_HIGHLIGHT,
+  IDE_LANGSERV_CALL_PRIORITY_BACKGROUND,
+} IdeLangservCallPriority;
+
 G_DECLARE_DERIVABLE_TYPE (IdeLangservClient, ide_langserv_client, IDE, LANGSERV_CLIENT, IdeObject)
 
 struct _IdeLangservClientClass
@@ -64,6 +80,13 @@ void               ide_langserv_client_call_async             (IdeLangservClient
                                                                GCancellable         *cancellable,
                                                                GAsyncReadyCallback   callback,
                                                                gpointer              user_data);
+void               ide_langserv_client_call_with_priority_async (IdeLangservClient       *self,
+                                                                 const gchar             *method,
+                                                                 JsonNode                *params,
+                                                                 IdeLangservCallPriority  priority,
+                                                                 GCancellable            *cancellable,
+                                                                 GAsyncReadyCallback      callback,
+                                                                 gpointer                 user_data);
 gboolean           ide_langserv_client_call_finish            (IdeLangservClient    *self,
                                                                GAsyncResult         *result,
                                                                JsonNode            **return_value,
@@ -354,12 +354,13 @@ ide_langserv_completion_provider_populate (GtkSourceCompletionProvider *provider
 
   state = completion_state_new (self, context);
 
-  ide_langserv_client_call_async (priv->client,
-                                  "textDocument/completion",
-                                  g_steal_pointer (&params),
-                                  g_steal_pointer (&cancellable),
-                                  ide_langserv_completion_provider_complete_cb,
-                                  g_steal_pointer (&state));
+  ide_langserv_client_call_with_priority_async (priv->client,
+                                                "textDocument/completion",
+                                                g_steal_pointer (&params),
+                                                IDE_LANGSERV_CALL_PRIORITY_INTERACTIVE,
+                                                g_steal_pointer (&cancellable),
+                                                ide_langserv_completion_provider_complete_cb,
+                                                g_steal_pointer (&state));
 
   IDE_EXIT;
 }
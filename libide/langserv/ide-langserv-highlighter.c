@@ -113,7 +113,8 @@ ide_langserv_highlighter_document_symbol_cb (GObject      *object,
 
   if (!ide_langserv_client_call_finish (client, result, &return_value, &error))
     {
-      g_message ("%s", error->message);
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_message ("%s", error->message);
       IDE_EXIT;
     }
 
@@ -216,12 +217,13 @@ ide_langserv_highlighter_update_symbols (gpointer data)
       priv->active = TRUE;
       priv->dirty = FALSE;
 
-      ide_langserv_client_call_async (priv->client,
-                                      "textDocument/documentSymbol",
-                                      g_steal_pointer (&params),
-                                      NULL,
-                                      ide_langserv_highlighter_document_symbol_cb,
-                                      g_object_ref (self));
+      ide_langserv_client_call_with_priority_async (priv->client,
+                                                    "textDocument/documentSymbol",
+                                                    g_steal_pointer (&params),
+                                                    IDE_LANGSERV_CALL_PRIORITY_HIGHLIGHT,
+                                                    NULL,
+                                                    ide_langserv_highlighter_document_symbol_cb,
+                                                    g_object_ref (self));
     }
 
   return G_SOURCE_REMOVE;
@@ -276,12 +276,13 @@ ide_langserv_rename_provider_rename_async (IdeRenameProvider   *provider,
     "newName", JCON_STRING (new_name)
   );
 
-  ide_langserv_client_call_async (priv->client,
-                                  "textDocument/rename",
-                                  g_steal_pointer (&params),
-                                  cancellable,
-                                  ide_langserv_rename_provider_rename_cb,
-                                  g_steal_pointer (&task));
+  ide_langserv_client_call_with_priority_async (priv->client,
+                                                "textDocument/rename",
+                                                g_steal_pointer (&params),
+                                                IDE_LANGSERV_CALL_PRIORITY_INTERACTIVE,
+                                                cancellable,
+                                                ide_langserv_rename_provider_rename_cb,
+                                                g_steal_pointer (&task));
 
   IDE_EXIT;
 }
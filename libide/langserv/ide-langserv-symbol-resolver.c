@@ -317,12 +317,13 @@ ide_langserv_symbol_resolver_lookup_symbol_async (IdeSymbolResolver   *resolver,
     "}"
   );
 
-  ide_langserv_client_call_async (priv->client,
-                                  "textDocument/definition",
-                                  g_steal_pointer (&params),
-                                  cancellable,
-                                  ide_langserv_symbol_resolver_definition_cb,
-                                  g_steal_pointer (&task));
+  ide_langserv_client_call_with_priority_async (priv->client,
+                                                "textDocument/definition",
+                                                g_steal_pointer (&params),
+                                                IDE_LANGSERV_CALL_PRIORITY_INTERACTIVE,
+                                                cancellable,
+                                                ide_langserv_symbol_resolver_definition_cb,
+                                                g_steal_pointer (&task));
 
   IDE_EXIT;
 }
@@ -478,12 +479,13 @@ ide_langserv_symbol_resolver_get_symbol_tree_async (IdeSymbolResolver   *resolve
     "}"
   );
 
-  ide_langserv_client_call_async (priv->client,
-                                  "textDocument/documentSymbol",
-                                  g_steal_pointer (&params),
-                                  cancellable,
-                                  ide_langserv_symbol_resolver_document_symbol_cb,
-                                  g_steal_pointer (&task));
+  ide_langserv_client_call_with_priority_async (priv->client,
+                                                "textDocument/documentSymbol",
+                                                g_steal_pointer (&params),
+                                                IDE_LANGSERV_CALL_PRIORITY_BACKGROUND,
+                                                cancellable,
+                                                ide_langserv_symbol_resolver_document_symbol_cb,
+                                                g_steal_pointer (&task));
 
   IDE_EXIT;
 }
@@ -0,0 +1,283 @@
+/* ide-trace.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE
+#endif
+
+#ifdef __linux__
+# include <sys/types.h>
+# include <sys/syscall.h>
+#endif
+
+#include <unistd.h>
+
+#include "ide-debug.h"
+
+#include "logging/ide-trace.h"
+
+/*
+ * The tracer records the IDE_ENTRY, IDE_EXIT and IDE_PROBE macros into a
+ * ring buffer per thread. Only the owning thread writes to a ring, so
+ * recording takes no locks and allocates nothing once the ring exists. The
+ * function names are the static strings produced by G_STRFUNC, so we only
+ * need to store the pointer and resolve it when writing the trace.
+ *
+ * Each ring is 16384 records, so rings are freed when their thread exits
+ * rather than accumulating with every short-lived thread.
+ */
+
+#define RING_SIZE 16384
+
+typedef struct
+{
+  gint64       time;
+  const gchar *func;
+  guint        event;
+} IdeTraceRecord;
+
+typedef struct
+{
+  gint           thread;
+  volatile guint head;
+  IdeTraceRecord records[RING_SIZE];
+} IdeTraceRing;
+
+G_STATIC_ASSERT ((RING_SIZE & (RING_SIZE - 1)) == 0);
+
+volatile gint _ide_trace_active;
+
+static void ide_trace_ring_free (gpointer data);
+
+static GPrivate   current_ring = G_PRIVATE_INIT (ide_trace_ring_free);
+static GPtrArray *rings;
+static gint64     begin_time;
+
+G_LOCK_DEFINE_STATIC (rings);
+
+static inline gint
+ide_trace_get_thread (void)
+{
+#ifdef __linux__
+  return (gint) syscall (SYS_gettid);
+#else
+  return GPOINTER_TO_INT (g_thread_self ());
+#endif /* __linux__ */
+}
+
+static IdeTraceRing *
+ide_trace_ring_new (void)
+{
+  IdeTraceRing *ring;
+
+  ring = g_new0 (IdeTraceRing, 1);
+  ring->thread = ide_trace_get_thread ();
+
+  G_LOCK (rings);
+  if (rings == NULL)
+    rings = g_ptr_array_new_with_free_func (g_free);
+  g_ptr_array_add (rings, ring);
+  G_UNLOCK (rings);
+
+  g_private_set (&current_ring, ring);
+
+  return ring;
+}
+
+static void
+ide_trace_ring_free (gpointer data)
+{
+  IdeTraceRing *ring = data;
+
+  G_LOCK (rings);
+  g_ptr_array_remove_fast (rings, ring);
+  G_UNLOCK (rings);
+}
+
+void
+_ide_trace_record (const gchar   *func,
+                   IdeTraceEvent  event)
+{
+  IdeTraceRing *ring;
+  IdeTraceRecord *record;
+  guint head;
+
+  if (G_UNLIKELY (NULL == (ring = g_private_get (&current_ring))))
+    ring = ide_trace_ring_new ();
+
+  head = ring->head;
+
+  record = &ring->records [head & (RING_SIZE - 1)];
+  record->time = g_get_monotonic_time ();
+  record->func = func;
+  record->event = event;
+
+  g_atomic_int_set (&ring->head, head + 1);
+}
+
+/**
+ * ide_trace_get_active:
+ *
+ * Checks if the IDE_ENTRY, IDE_EXIT and IDE_PROBE macros are currently
+ * being recorded.
+ *
+ * Returns: %TRUE if tracing is active.
+ */
+gboolean
+ide_trace_get_active (void)
+{
+  return g_atomic_int_get (&_ide_trace_active);
+}
+
+/**
+ * ide_trace_start:
+ *
+ * Starts recording the IDE_ENTRY, IDE_EXIT and IDE_PROBE macros of every
+ * thread. Each thread keeps the last few thousand events until it exits.
+ */
+void
+ide_trace_start (void)
+{
+  if (!g_atomic_int_get (&_ide_trace_active))
+    {
+      if (begin_time == 0)
+        begin_time = g_get_monotonic_time ();
+      g_atomic_int_set (&_ide_trace_active, TRUE);
+    }
+}
+
+/**
+ * ide_trace_stop:
+ *
+ * Stops recording. The events recorded so far are kept until
+ * ide_trace_clear() is called.
+ */
+void
+ide_trace_stop (void)
+{
+  g_atomic_int_set (&_ide_trace_active, FALSE);
+}
+
+/**
+ * ide_trace_clear:
+ *
+ * Discards the events recorded so far.
+ */
+void
+ide_trace_clear (void)
+{
+  G_LOCK (rings);
+  if (rings != NULL)
+    {
+      for (guint i = 0; i < rings->len; i++)
+        {
+          IdeTraceRing *ring = g_ptr_array_index (rings, i);
+
+          g_atomic_int_set (&ring->head, 0);
+        }
+    }
+  begin_time = g_atomic_int_get (&_ide_trace_active) ? g_get_monotonic_time () : 0;
+  G_UNLOCK (rings);
+}
+
+static GVariant *
+ide_trace_build_variant (void)
+{
+  g_autoptr(GHashTable) funcs = NULL;
+  GVariantBuilder names;
+  GVariantBuilder threads;
+
+  funcs = g_hash_table_new (NULL, NULL);
+
+  g_variant_builder_init (&names, G_VARIANT_TYPE ("as"));
+  g_variant_builder_init (&threads, G_VARIANT_TYPE ("a(ia(xuu))"));
+
+  G_LOCK (rings);
+
+  for (guint i = 0; rings != NULL && i < rings->len; i++)
+    {
+      IdeTraceRing *ring = g_ptr_array_index (rings, i);
+      guint head = g_atomic_int_get (&ring->head);
+      guint first = head > RING_SIZE ? head - RING_SIZE : 0;
+
+      if (head == 0)
+        continue;
+
+      g_variant_builder_open (&threads, G_VARIANT_TYPE ("(ia(xuu))"));
+      g_variant_builder_add (&threads, "i", ring->thread);
+      g_variant_builder_open (&threads, G_VARIANT_TYPE ("a(xuu)"));
+
+      for (guint j = first; j < head; j++)
+        {
+          const IdeTraceRecord *record = &ring->records [j & (RING_SIZE - 1)];
+          gpointer index;
+
+          if (!g_hash_table_lookup_extended (funcs, record->func, NULL, &index))
+            {
+              index = GUINT_TO_POINTER (g_hash_table_size (funcs));
+              g_hash_table_insert (funcs, (gpointer)record->func, index);
+              g_variant_builder_add (&names, "s", record->func);
+            }
+
+          g_variant_builder_add (&threads, "(xuu)",
+                                 record->time,
+                                 GPOINTER_TO_UINT (index),
+                                 record->event);
+        }
+
+      g_variant_builder_close (&threads);
+      g_variant_builder_close (&threads);
+    }
+
+  G_UNLOCK (rings);
+
+  return g_variant_new ("(x@as@a(ia(xuu)))",
+                        begin_time,
+                        g_variant_builder_end (&names),
+                        g_variant_builder_end (&threads));
+}
+
+/**
+ * ide_trace_write_to_file:
+ * @filename: the file to write
+ * @error: a location for a #GError, or %NULL
+ *
+ * Writes the events recorded so far to @filename. The file contains a
+ * serialized #GVariant of type %IDE_TRACE_VARIANT_TYPE and can be read
+ * with the ide-dump-trace tool.
+ *
+ * Tracing should be stopped first, otherwise events recorded while the
+ * trace is written may be torn.
+ *
+ * Returns: %TRUE if successful; otherwise %FALSE and @error is set.
+ */
+gboolean
+ide_trace_write_to_file (const gchar  *filename,
+                         GError      **error)
+{
+  g_autoptr(GVariant) variant = NULL;
+
+  g_return_val_if_fail (filename != NULL, FALSE);
+
+  variant = g_variant_ref_sink (ide_trace_build_variant ());
+
+  return g_file_set_contents (filename,
+                              g_variant_get_data (variant),
+                              g_variant_get_size (variant),
+                              error);
+}
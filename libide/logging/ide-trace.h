@@ -0,0 +1,46 @@
+/* ide-trace.h
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IDE_TRACE_H
+#define IDE_TRACE_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/*
+ * The variant type of files written by ide_trace_write_to_file().
+ *
+ *   (
+ *     x             monotonic time at which tracing was started
+ *     as            function names, indexed by the records below
+ *     a(ia(xuu))    per-thread (thread id, [(monotonic time, function, event)])
+ *   )
+ */
+#define IDE_TRACE_VARIANT_TYPE "(xasa(ia(xuu)))"
+
+gboolean ide_trace_get_active    (void);
+void     ide_trace_start         (void);
+void     ide_trace_stop          (void);
+void     ide_trace_clear         (void);
+gboolean ide_trace_write_to_file (const gchar  *filename,
+                                  GError      **error);
+
+G_END_DECLS
+
+#endif /* IDE_TRACE_H */
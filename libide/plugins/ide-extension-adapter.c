@@ -109,7 +109,7 @@ ide_extension_adapter_set_extension (IdeExtensionAdapter *self,
 static void
 ide_extension_adapter_reload (IdeExtensionAdapter *self)
 {
-  const GList *plugins;
+  g_autoptr(GArray) providers = NULL;
   PeasPluginInfo *best_match = NULL;
   PeasExtension *extension = NULL;
   gint best_match_priority = G_MININT;
@@ -122,25 +122,20 @@ ide_extension_adapter_reload (IdeExtensionAdapter *self)
       return;
     }
 
-  plugins = peas_engine_get_plugin_list (self->engine);
+  providers = ide_extension_util_get_providers (self->engine,
+                                                self->interface_type,
+                                                self->key,
+                                                self->value);
 
-  for (; plugins; plugins = plugins->next)
+  for (guint i = 0; i < providers->len; i++)
     {
-      PeasPluginInfo *plugin_info = plugins->data;
-      gint priority = 0;
-
-      if (ide_extension_util_can_use_plugin (self->engine,
-                                             plugin_info,
-                                             self->interface_type,
-                                             self->key,
-                                             self->value,
-                                             &priority))
+      const IdeExtensionProvider *provider = &g_array_index (providers, IdeExtensionProvider, i);
+
+      if (provider->priority > best_match_priority &&
+          ide_extension_util_get_enabled (provider->plugin_info, self->interface_type))
         {
-          if (priority > best_match_priority)
-            {
-              best_match = plugin_info;
-              best_match_priority = priority;
-            }
+          best_match = provider->plugin_info;
+          best_match_priority = provider->priority;
         }
     }
 
@@ -110,16 +110,12 @@ watch_extension (IdeExtensionSetAdapter *self,
                  GType                   interface_type)
 {
   GSettings *settings;
-  gchar *path;
 
   g_assert (IDE_IS_EXTENSION_SET_ADAPTER (self));
   g_assert (plugin_info != NULL);
   g_assert (G_TYPE_IS_INTERFACE (interface_type));
 
-  path = g_strdup_printf ("/org/gnome/builder/extension-types/%s/%s/",
-                          peas_plugin_info_get_module_name (plugin_info),
-                          g_type_name (interface_type));
-  settings = g_settings_new_with_path ("org.gnome.builder.extension-type", path);
+  settings = ide_extension_util_get_settings (plugin_info, interface_type);
 
   g_ptr_array_add (self->settings, g_object_ref (settings));
 
@@ -128,16 +124,18 @@ watch_extension (IdeExtensionSetAdapter *self,
                            G_CALLBACK (ide_extension_set_adapter_enabled_changed),
                            self,
                            G_CONNECT_SWAPPED);
-
-  g_object_unref (settings);
-  g_free (path);
 }
 
 static void
 ide_extension_set_adapter_reload (IdeExtensionSetAdapter *self)
 {
+  g_autoptr(GArray) providers = NULL;
+  g_autoptr(GArray) matches = NULL;
+  g_autoptr(GHashTable) usable = NULL;
+  g_autoptr(GPtrArray) stale = NULL;
   IdeContext *context;
-  const GList *plugins;
+  GHashTableIter iter;
+  gpointer key;
 
   g_assert (IDE_IS_EXTENSION_SET_ADAPTER (self));
 
@@ -153,43 +151,64 @@ ide_extension_set_adapter_reload (IdeExtensionSetAdapter *self)
     }
 
   context = ide_object_get_context (IDE_OBJECT (self));
-  plugins = peas_engine_get_plugin_list (self->engine);
 
   g_assert (IDE_IS_CONTEXT (context));
 
-  for (; plugins; plugins = plugins->next)
+  /*
+   * Only plugins providing our interface type are considered, which comes
+   * from the engine-wide index rather than walking every plugin.
+   */
+  providers = ide_extension_util_get_providers (self->engine, self->interface_type, NULL, NULL);
+
+  for (guint i = 0; i < providers->len; i++)
     {
-      PeasPluginInfo *plugin_info = plugins->data;
-      gint priority;
-
-      if (peas_engine_provides_extension (self->engine, plugin_info, self->interface_type))
-        watch_extension (self, plugin_info, self->interface_type);
-
-      if (ide_extension_util_can_use_plugin (self->engine,
-                                             plugin_info,
-                                             self->interface_type,
-                                             self->key,
-                                             self->value,
-                                             &priority))
-        {
-          if (!g_hash_table_lookup (self->extensions, plugin_info))
-            {
-              PeasExtension *exten;
-
-              exten = peas_engine_create_extension (self->engine,
-                                                    plugin_info,
-                                                    self->interface_type,
-                                                    "context", context,
-                                                    NULL);
-              add_extension (self, plugin_info, exten);
-            }
-        }
-      else
+      const IdeExtensionProvider *provider = &g_array_index (providers, IdeExtensionProvider, i);
+
+      watch_extension (self, provider->plugin_info, self->interface_type);
+    }
+
+  matches = ide_extension_util_get_providers (self->engine, self->interface_type, self->key, self->value);
+  usable = g_hash_table_new (NULL, NULL);
+
+  for (guint i = 0; i < matches->len; i++)
+    {
+      const IdeExtensionProvider *provider = &g_array_index (matches, IdeExtensionProvider, i);
+
+      if (ide_extension_util_get_enabled (provider->plugin_info, self->interface_type))
+        g_hash_table_add (usable, provider->plugin_info);
+    }
+
+  stale = g_ptr_array_new ();
+  g_hash_table_iter_init (&iter, self->extensions);
+
+  while (g_hash_table_iter_next (&iter, &key, NULL))
+    {
+      if (!g_hash_table_contains (usable, key))
+        g_ptr_array_add (stale, key);
+    }
+
+  for (guint i = 0; i < stale->len; i++)
+    {
+      PeasPluginInfo *plugin_info = g_ptr_array_index (stale, i);
+
+      remove_extension (self, plugin_info, g_hash_table_lookup (self->extensions, plugin_info));
+    }
+
+  for (guint i = 0; i < matches->len; i++)
+    {
+      PeasPluginInfo *plugin_info = g_array_index (matches, IdeExtensionProvider, i).plugin_info;
+
+      if (g_hash_table_contains (usable, plugin_info) &&
+          !g_hash_table_lookup (self->extensions, plugin_info))
         {
           PeasExtension *exten;
 
-          if ((exten = g_hash_table_lookup (self->extensions, plugin_info)))
-            remove_extension (self, plugin_info, exten);
+          exten = peas_engine_create_extension (self->engine,
+                                                plugin_info,
+                                                self->interface_type,
+                                                "context", context,
+                                                NULL);
+          add_extension (self, plugin_info, exten);
         }
     }
 }
@@ -22,73 +22,279 @@
 
 #include "ide-extension-util.h"
 
-gboolean
-ide_extension_util_can_use_plugin (PeasEngine     *engine,
-                                   PeasPluginInfo *plugin_info,
-                                   GType           interface_type,
-                                   const gchar    *key,
-                                   const gchar    *value,
-                                   gint           *priority)
+/*
+ * Every buffer creates a number of extension adapters, and each of them
+ * needs to know which plugins provide a given interface and match a given
+ * "X-*-Languages" style key. Rather than walking every plugin (and parsing
+ * their external data) for each adapter, we keep an index per PeasEngine
+ * mapping (interface type, key, value) to the matching plugins. The index
+ * is dropped whenever plugins are loaded or unloaded.
+ */
+
+typedef struct
 {
-  g_autofree gchar *path = NULL;
-  g_autoptr(GSettings) settings = NULL;
+  PeasEngine *engine;
+  GHashTable *providers;
+} ExtensionIndex;
 
-  g_return_val_if_fail (plugin_info != NULL, FALSE);
-  g_return_val_if_fail (g_type_is_a (interface_type, G_TYPE_INTERFACE), FALSE);
-  g_return_val_if_fail (priority != NULL, FALSE);
+static GQuark      extension_index_quark;
+static GHashTable *settings_cache;
 
-  *priority = 0;
+static void
+extension_index_invalidate (ExtensionIndex *index)
+{
+  g_assert (index != NULL);
+
+  g_hash_table_remove_all (index->providers);
+}
+
+static void
+extension_index_free (gpointer data)
+{
+  ExtensionIndex *index = data;
+
+  g_hash_table_unref (index->providers);
+  g_slice_free (ExtensionIndex, index);
+}
+
+static ExtensionIndex *
+extension_index_get (PeasEngine *engine)
+{
+  ExtensionIndex *index;
+
+  g_assert (PEAS_IS_ENGINE (engine));
+
+  if G_UNLIKELY (extension_index_quark == 0)
+    extension_index_quark = g_quark_from_static_string ("IDE_EXTENSION_INDEX");
+
+  index = g_object_get_qdata (G_OBJECT (engine), extension_index_quark);
+
+  if G_UNLIKELY (index == NULL)
+    {
+      index = g_slice_new0 (ExtensionIndex);
+      index->engine = engine;
+      index->providers = g_hash_table_new_full (g_str_hash,
+                                                g_str_equal,
+                                                g_free,
+                                                (GDestroyNotify)g_array_unref);
+
+      g_signal_connect_swapped (engine,
+                                "notify::plugin-list",
+                                G_CALLBACK (extension_index_invalidate),
+                                index);
+      g_signal_connect_data (engine,
+                             "load-plugin",
+                             G_CALLBACK (extension_index_invalidate),
+                             index,
+                             NULL,
+                             G_CONNECT_SWAPPED | G_CONNECT_AFTER);
+      g_signal_connect_data (engine,
+                             "unload-plugin",
+                             G_CALLBACK (extension_index_invalidate),
+                             index,
+                             NULL,
+                             G_CONNECT_SWAPPED | G_CONNECT_AFTER);
+
+      g_object_set_qdata_full (G_OBJECT (engine),
+                               extension_index_quark,
+                               index,
+                               extension_index_free);
+    }
+
+  return index;
+}
+
+static GArray *
+extension_index_build (ExtensionIndex *index,
+                       GType           interface_type,
+                       const gchar    *key,
+                       const gchar    *value)
+{
+  g_autofree gchar *priority_name = NULL;
+  const GList *plugins;
+  GArray *ar;
+
+  g_assert (index != NULL);
+
+  ar = g_array_new (FALSE, FALSE, sizeof (IdeExtensionProvider));
+
+  if (key != NULL)
+    priority_name = g_strdup_printf ("%s-Priority", key);
+
+  plugins = peas_engine_get_plugin_list (index->engine);
+
+  for (; plugins != NULL; plugins = plugins->next)
+    {
+      PeasPluginInfo *plugin_info = plugins->data;
+      IdeExtensionProvider provider = { plugin_info, 0 };
+
+      if (!peas_plugin_info_is_loaded (plugin_info) ||
+          !peas_engine_provides_extension (index->engine, plugin_info, interface_type))
+        continue;
+
+      /*
+       * Check that the plugin provides the match value we are looking for.
+       * If key is NULL, then we aren't restricting by matching.
+       */
+      if (key != NULL)
+        {
+          g_auto(GStrv) values_array = NULL;
+          const gchar *values;
+          const gchar *priority_value;
+
+          values = peas_plugin_info_get_external_data (plugin_info, key);
+          values_array = g_strsplit (values ? values : "", ",", 0);
+          if (!g_strv_contains ((const gchar * const *)values_array, value))
+            continue;
+
+          priority_value = peas_plugin_info_get_external_data (plugin_info, priority_name);
+          if (priority_value != NULL)
+            provider.priority = atoi (priority_value);
+        }
+
+      g_array_append_val (ar, provider);
+    }
+
+  return ar;
+}
+
+/**
+ * ide_extension_util_get_providers:
+ * @engine: a #PeasEngine
+ * @interface_type: the interface the plugins must provide
+ * @key: (nullable): an external data key to match, or %NULL
+ * @value: (nullable): the value that must be listed in @key
+ *
+ * Gets the loaded plugins that provide @interface_type, optionally
+ * restricted to those listing @value within the comma separated
+ * external data @key.
+ *
+ * This does not check whether the extension type has been disabled
+ * by the user; see ide_extension_util_get_enabled().
+ *
+ * Returns: (transfer full): a #GArray of #IdeExtensionProvider.
+ */
+GArray *
+ide_extension_util_get_providers (PeasEngine  *engine,
+                                  GType        interface_type,
+                                  const gchar *key,
+                                  const gchar *value)
+{
+  ExtensionIndex *index;
+  g_autofree gchar *lookup_key = NULL;
+  GArray *ar;
+
+  g_return_val_if_fail (PEAS_IS_ENGINE (engine), NULL);
+  g_return_val_if_fail (g_type_is_a (interface_type, G_TYPE_INTERFACE), NULL);
 
   /*
    * If we are restricting by plugin info keyword, ensure we have enough
    * information to do so.
    */
   if ((key != NULL) && (value == NULL))
-    return FALSE;
+    return g_array_new (FALSE, FALSE, sizeof (IdeExtensionProvider));
 
-  /*
-   * If the plugin isn't loaded, then we shouldn't use it.
-   */
-  if (!peas_plugin_info_is_loaded (plugin_info))
-    return FALSE;
-
-  /*
-   * If this plugin doesn't provide this type, we can't use it either.
-   */
-  if (!peas_engine_provides_extension (engine, plugin_info, interface_type))
-    return FALSE;
+  index = extension_index_get (engine);
+  lookup_key = g_strdup_printf ("%s\n%s\n%s",
+                                g_type_name (interface_type),
+                                key ? key : "",
+                                value ? value : "");
 
-  /*
-   * Check that the plugin provides the match value we are looking for.
-   * If key is NULL, then we aren't restricting by matching.
-   */
-  if (key != NULL)
+  if (NULL == (ar = g_hash_table_lookup (index->providers, lookup_key)))
     {
-      g_autofree gchar *priority_name = NULL;
-      g_auto(GStrv) values_array = NULL;
-      const gchar *values;
-      const gchar *priority_value;
-
-      values = peas_plugin_info_get_external_data (plugin_info, key);
-      values_array = g_strsplit (values ? values : "", ",", 0);
-      if (!g_strv_contains ((const gchar * const *)values_array, value))
-        return FALSE;
-
-      priority_name = g_strdup_printf ("%s-Priority", key);
-      priority_value = peas_plugin_info_get_external_data (plugin_info, priority_name);
-      if (priority_value != NULL)
-        *priority = atoi (priority_value);
+      ar = extension_index_build (index, interface_type, key, value);
+      g_hash_table_insert (index->providers, g_steal_pointer (&lookup_key), ar);
     }
 
+  return g_array_ref (ar);
+}
+
+/**
+ * ide_extension_util_get_settings:
+ * @plugin_info: a #PeasPluginInfo
+ * @interface_type: an interface #GType
+ *
+ * Gets the shared #GSettings used to enable or disable @interface_type
+ * extensions from @plugin_info. The settings are cached for the lifetime
+ * of the process.
+ *
+ * Returns: (transfer none): a #GSettings
+ */
+GSettings *
+ide_extension_util_get_settings (PeasPluginInfo *plugin_info,
+                                 GType           interface_type)
+{
+  g_autofree gchar *path = NULL;
+  GSettings *settings;
+
+  g_return_val_if_fail (plugin_info != NULL, NULL);
+
   /*
-   * Ensure the plugin type isn't disabled by checking our GSettings
-   * for the plugin type. There is an implicit plugin issue here, in that
-   * two modules using different plugin loaders could have the same module
-   * name. But we can enforce this issue socially.
+   * There is an implicit plugin issue here, in that two modules using
+   * different plugin loaders could have the same module name. But we can
+   * enforce this issue socially.
    */
   path = g_strdup_printf ("/org/gnome/builder/extension-types/%s/%s/",
                           peas_plugin_info_get_module_name (plugin_info),
                           g_type_name (interface_type));
-  settings = g_settings_new_with_path ("org.gnome.builder.extension-type", path);
+
+  if G_UNLIKELY (settings_cache == NULL)
+    settings_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
+
+  if (NULL == (settings = g_hash_table_lookup (settings_cache, path)))
+    {
+      settings = g_settings_new_with_path ("org.gnome.builder.extension-type", path);
+      g_hash_table_insert (settings_cache, g_steal_pointer (&path), settings);
+    }
+
+  return settings;
+}
+
+gboolean
+ide_extension_util_get_enabled (PeasPluginInfo *plugin_info,
+                                GType           interface_type)
+{
+  GSettings *settings = ide_extension_util_get_settings (plugin_info, interface_type);
+
   return g_settings_get_boolean (settings, "enabled");
 }
+
+gboolean
+ide_extension_util_can_use_plugin (PeasEngine     *engine,
+                                   PeasPluginInfo *plugin_info,
+                                   GType           interface_type,
+                                   const gchar    *key,
+                                   const gchar    *value,
+                                   gint           *priority)
+{
+  g_autoptr(GArray) providers = NULL;
+
+  g_return_val_if_fail (plugin_info != NULL, FALSE);
+  g_return_val_if_fail (g_type_is_a (interface_type, G_TYPE_INTERFACE), FALSE);
+  g_return_val_if_fail (priority != NULL, FALSE);
+
+  *priority = 0;
+
+  providers = ide_extension_util_get_providers (engine, interface_type, key, value);
+
+  for (guint i = 0; i < providers->len; i++)
+    {
+      const IdeExtensionProvider *provider = &g_array_index (providers, IdeExtensionProvider, i);
+
+      if (provider->plugin_info == plugin_info)
+        {
+          /*
+           * Ensure the plugin type isn't disabled by checking our GSettings
+           * for the plugin type.
+           */
+          if (!ide_extension_util_get_enabled (plugin_info, interface_type))
+            return FALSE;
+
+          *priority = provider->priority;
+
+          return TRUE;
+        }
+    }
+
+  return FALSE;
+}
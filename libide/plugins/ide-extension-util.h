@@ -19,16 +19,31 @@
 #ifndef IDE_EXTENSION_UTIL_H
 #define IDE_EXTENSION_UTIL_H
 
+#include <gio/gio.h>
 #include <libpeas/peas.h>
 
 G_BEGIN_DECLS
 
-gboolean ide_extension_util_can_use_plugin (PeasEngine     *engine,
-                                            PeasPluginInfo *plugin_info,
-                                            GType           interface_type,
-                                            const gchar    *key,
-                                            const gchar    *value,
-                                            gint           *priority);
+typedef struct
+{
+  PeasPluginInfo *plugin_info;
+  gint            priority;
+} IdeExtensionProvider;
+
+gboolean   ide_extension_util_can_use_plugin (PeasEngine     *engine,
+                                              PeasPluginInfo *plugin_info,
+                                              GType           interface_type,
+                                              const gchar    *key,
+                                              const gchar    *value,
+                                              gint           *priority);
+GArray    *ide_extension_util_get_providers  (PeasEngine     *engine,
+                                              GType           interface_type,
+                                              const gchar    *key,
+                                              const gchar    *value);
+GSettings *ide_extension_util_get_settings   (PeasPluginInfo *plugin_info,
+                                              GType           interface_type);
+gboolean   ide_extension_util_get_enabled    (PeasPluginInfo *plugin_info,
+                                              GType           interface_type);
 
 G_END_DECLS
 
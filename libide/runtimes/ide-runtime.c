@@ -28,10 +28,26 @@
 
 typedef struct
 {
-  gchar *id;
-  gchar *display_name;
+  gchar      *id;
+  gchar      *display_name;
+
+  /*
+   * Cache of program name to the path of the program within the runtime.
+   * Programs that could not be found map to %NULL. Protected by
+   * programs_mutex since builders query it from worker threads.
+   */
+  GMutex      programs_mutex;
+  GHashTable *programs;
+  guint       programs_generation;
 } IdeRuntimePrivate;
 
+typedef struct
+{
+  GHashTable *found;
+  GPtrArray  *missing;
+  guint       generation;
+} ResolvePrograms;
+
 G_DEFINE_TYPE_WITH_PRIVATE (IdeRuntime, ide_runtime, IDE_TYPE_OBJECT)
 
 enum {
@@ -43,6 +59,16 @@ enum {
 
 static GParamSpec *properties [N_PROPS];
 
+static void
+resolve_programs_free (gpointer data)
+{
+  ResolvePrograms *state = data;
+
+  g_clear_pointer (&state->found, g_hash_table_unref);
+  g_clear_pointer (&state->missing, g_ptr_array_unref);
+  g_slice_free (ResolvePrograms, state);
+}
+
 static void
 ide_runtime_real_prebuild_async (IdeRuntime          *self,
                                  IdeBuildResult      *build_result,
@@ -176,13 +202,276 @@ ide_runtime_contains_program_in_path (IdeRuntime   *self,
                                       const gchar  *program,
                                       GCancellable *cancellable)
 {
+  IdeRuntimePrivate *priv = ide_runtime_get_instance_private (self);
+  gpointer path = NULL;
+  gboolean cached;
+
   g_return_val_if_fail (IDE_IS_RUNTIME (self), FALSE);
   g_return_val_if_fail (program != NULL, FALSE);
   g_return_val_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable), FALSE);
 
+  /* Avoid asking the runtime again if the program was already resolved. */
+  g_mutex_lock (&priv->programs_mutex);
+  cached = g_hash_table_lookup_extended (priv->programs, program, NULL, &path);
+  g_mutex_unlock (&priv->programs_mutex);
+
+  if (cached)
+    return path != NULL;
+
   return IDE_RUNTIME_GET_CLASS (self)->contains_program_in_path (self, program, cancellable);
 }
 
+static void
+ide_runtime_real_resolve_programs_worker (GTask        *task,
+                                          gpointer      source_object,
+                                          gpointer      task_data,
+                                          GCancellable *cancellable)
+{
+  IdeRuntime *self = source_object;
+  IdeRuntimeClass *klass = IDE_RUNTIME_GET_CLASS (self);
+  const gchar * const *programs = task_data;
+  g_autoptr(GHashTable) found = NULL;
+
+  g_assert (G_IS_TASK (task));
+  g_assert (IDE_IS_RUNTIME (self));
+  g_assert (programs != NULL);
+
+  found = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+  for (guint i = 0; programs [i] != NULL; i++)
+    {
+      gchar *path = NULL;
+
+      /*
+       * The host runtime can give us the real path, but subclasses that only
+       * implement contains_program_in_path() cannot. Use the program name in
+       * that case so it can still be passed to a launcher.
+       */
+      if (klass->contains_program_in_path == ide_runtime_real_contains_program_in_path)
+        path = g_find_program_in_path (programs [i]);
+      else if (klass->contains_program_in_path (self, programs [i], cancellable))
+        path = g_strdup (programs [i]);
+
+      if (path != NULL)
+        g_hash_table_insert (found, g_strdup (programs [i]), path);
+    }
+
+  g_task_return_pointer (task, g_steal_pointer (&found), (GDestroyNotify)g_hash_table_unref);
+}
+
+static void
+ide_runtime_real_resolve_programs_async (IdeRuntime          *self,
+                                         const gchar * const *programs,
+                                         GCancellable        *cancellable,
+                                         GAsyncReadyCallback  callback,
+                                         gpointer             user_data)
+{
+  g_autoptr(GTask) task = NULL;
+
+  g_assert (IDE_IS_RUNTIME (self));
+  g_assert (programs != NULL);
+  g_assert (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_source_tag (task, ide_runtime_real_resolve_programs_async);
+  g_task_set_task_data (task, g_strdupv ((gchar **)programs), (GDestroyNotify)g_strfreev);
+  g_task_run_in_thread (task, ide_runtime_real_resolve_programs_worker);
+}
+
+static GHashTable *
+ide_runtime_real_resolve_programs_finish (IdeRuntime    *self,
+                                          GAsyncResult  *result,
+                                          GError       **error)
+{
+  g_assert (IDE_IS_RUNTIME (self));
+  g_assert (G_IS_TASK (result));
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+static void
+ide_runtime_resolve_programs_cb (GObject      *object,
+                                 GAsyncResult *result,
+                                 gpointer      user_data)
+{
+  IdeRuntime *self = (IdeRuntime *)object;
+  IdeRuntimePrivate *priv = ide_runtime_get_instance_private (self);
+  g_autoptr(GTask) task = user_data;
+  g_autoptr(GHashTable) resolved = NULL;
+  GError *error = NULL;
+  ResolvePrograms *state;
+
+  IDE_ENTRY;
+
+  g_assert (IDE_IS_RUNTIME (self));
+  g_assert (G_IS_ASYNC_RESULT (result));
+  g_assert (G_IS_TASK (task));
+
+  state = g_task_get_task_data (task);
+
+  resolved = IDE_RUNTIME_GET_CLASS (self)->resolve_programs_finish (self, result, &error);
+
+  if (resolved == NULL)
+    {
+      g_task_return_error (task, error);
+      IDE_EXIT;
+    }
+
+  g_mutex_lock (&priv->programs_mutex);
+
+  for (guint i = 0; i < state->missing->len; i++)
+    {
+      const gchar *program = g_ptr_array_index (state->missing, i);
+      const gchar *path;
+
+      if (program == NULL)
+        continue;
+
+      path = g_hash_table_lookup (resolved, program);
+
+      /* Drop the results if the runtime changed while we were resolving. */
+      if (state->generation == priv->programs_generation)
+        g_hash_table_insert (priv->programs, g_strdup (program), g_strdup (path));
+
+      if (path != NULL)
+        g_hash_table_insert (state->found, g_strdup (program), g_strdup (path));
+    }
+
+  g_mutex_unlock (&priv->programs_mutex);
+
+  g_task_return_pointer (task,
+                         g_hash_table_ref (state->found),
+                         (GDestroyNotify)g_hash_table_unref);
+
+  IDE_EXIT;
+}
+
+/**
+ * ide_runtime_resolve_programs_async:
+ * @self: An #IdeRuntime.
+ * @programs: (array zero-terminated=1): the names of programs to locate.
+ * @cancellable: (nullable): A #GCancellable or %NULL.
+ * @callback: A callback to execute upon completion.
+ * @user_data: User data for @callback.
+ *
+ * Asynchronously locates @programs within the runtime's search path.
+ *
+ * Runtimes resolve all of the programs at once, and the results are cached
+ * until ide_runtime_invalidate_programs() is called. Requests that are fully
+ * satisfied by the cache complete without performing any I/O.
+ */
+void
+ide_runtime_resolve_programs_async (IdeRuntime          *self,
+                                    const gchar * const *programs,
+                                    GCancellable        *cancellable,
+                                    GAsyncReadyCallback  callback,
+                                    gpointer             user_data)
+{
+  IdeRuntimePrivate *priv = ide_runtime_get_instance_private (self);
+  g_autoptr(GTask) task = NULL;
+  ResolvePrograms *state;
+
+  IDE_ENTRY;
+
+  g_return_if_fail (IDE_IS_RUNTIME (self));
+  g_return_if_fail (programs != NULL);
+  g_return_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_source_tag (task, ide_runtime_resolve_programs_async);
+
+  state = g_slice_new0 (ResolvePrograms);
+  state->found = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+  state->missing = g_ptr_array_new_with_free_func (g_free);
+  g_task_set_task_data (task, state, resolve_programs_free);
+
+  g_mutex_lock (&priv->programs_mutex);
+
+  state->generation = priv->programs_generation;
+
+  for (guint i = 0; programs [i] != NULL; i++)
+    {
+      gpointer path = NULL;
+
+      if (g_hash_table_lookup_extended (priv->programs, programs [i], NULL, &path))
+        {
+          if (path != NULL)
+            g_hash_table_insert (state->found, g_strdup (programs [i]), g_strdup (path));
+        }
+      else
+        {
+          g_ptr_array_add (state->missing, g_strdup (programs [i]));
+        }
+    }
+
+  g_mutex_unlock (&priv->programs_mutex);
+
+  if (state->missing->len == 0)
+    {
+      g_task_return_pointer (task,
+                             g_hash_table_ref (state->found),
+                             (GDestroyNotify)g_hash_table_unref);
+      IDE_EXIT;
+    }
+
+  g_ptr_array_add (state->missing, NULL);
+
+  IDE_RUNTIME_GET_CLASS (self)->resolve_programs_async (self,
+                                                        (const gchar * const *)state->missing->pdata,
+                                                        cancellable,
+                                                        ide_runtime_resolve_programs_cb,
+                                                        g_steal_pointer (&task));
+
+  IDE_EXIT;
+}
+
+/**
+ * ide_runtime_resolve_programs_finish:
+ * @self: An #IdeRuntime.
+ * @result: A #GAsyncResult provided to the callback.
+ * @error: A location for a #GError, or %NULL.
+ *
+ * Completes a request to ide_runtime_resolve_programs_async().
+ *
+ * The resulting hash table contains an entry for each program that was
+ * found, mapping the program name to its path within the runtime. Programs
+ * that could not be found are not present.
+ *
+ * Returns: (transfer container) (element-type utf8 utf8): A #GHashTable
+ *   or %NULL upon failure and @error is set.
+ */
+GHashTable *
+ide_runtime_resolve_programs_finish (IdeRuntime    *self,
+                                     GAsyncResult  *result,
+                                     GError       **error)
+{
+  g_return_val_if_fail (IDE_IS_RUNTIME (self), NULL);
+  g_return_val_if_fail (G_IS_TASK (result), NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+/**
+ * ide_runtime_invalidate_programs:
+ * @self: An #IdeRuntime.
+ *
+ * Clears the cache used by ide_runtime_resolve_programs_async(). Runtimes
+ * should call this when the contents of the runtime may have changed, such
+ * as after it was updated or reconfigured.
+ */
+void
+ide_runtime_invalidate_programs (IdeRuntime *self)
+{
+  IdeRuntimePrivate *priv = ide_runtime_get_instance_private (self);
+
+  g_return_if_fail (IDE_IS_RUNTIME (self));
+
+  g_mutex_lock (&priv->programs_mutex);
+  g_hash_table_remove_all (priv->programs);
+  priv->programs_generation++;
+  g_mutex_unlock (&priv->programs_mutex);
+}
+
 static void
 ide_runtime_real_prepare_configuration (IdeRuntime       *self,
                                         IdeConfiguration *configuration)
@@ -278,6 +567,8 @@ ide_runtime_finalize (GObject *object)
 
   g_clear_pointer (&priv->id, g_free);
   g_clear_pointer (&priv->display_name, g_free);
+  g_clear_pointer (&priv->programs, g_hash_table_unref);
+  g_mutex_clear (&priv->programs_mutex);
 
   G_OBJECT_CLASS (ide_runtime_parent_class)->finalize (object);
 }
@@ -346,6 +637,8 @@ ide_runtime_class_init (IdeRuntimeClass *klass)
   klass->create_launcher = ide_runtime_real_create_launcher;
   klass->create_runner = ide_runtime_real_create_runner;
   klass->contains_program_in_path = ide_runtime_real_contains_program_in_path;
+  klass->resolve_programs_async = ide_runtime_real_resolve_programs_async;
+  klass->resolve_programs_finish = ide_runtime_real_resolve_programs_finish;
   klass->prepare_configuration = ide_runtime_real_prepare_configuration;
 
   properties [PROP_ID] =
@@ -368,6 +661,10 @@ ide_runtime_class_init (IdeRuntimeClass *klass)
 static void
 ide_runtime_init (IdeRuntime *self)
 {
+  IdeRuntimePrivate *priv = ide_runtime_get_instance_private (self);
+
+  g_mutex_init (&priv->programs_mutex);
+  priv->programs = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
 }
 
 const gchar *
@@ -393,6 +690,7 @@ ide_runtime_set_id (IdeRuntime  *self,
     {
       g_free (priv->id);
       priv->id = g_strdup (id);
+      ide_runtime_invalidate_programs (self);
       g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_ID]);
     }
 }
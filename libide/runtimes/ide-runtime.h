@@ -76,9 +76,15 @@ struct _IdeRuntimeClass
   gboolean               (*postinstall_finish)       (IdeRuntime           *self,
                                                       GAsyncResult         *result,
                                                       GError              **error);
+  void                   (*resolve_programs_async)   (IdeRuntime           *self,
+                                                      const gchar * const  *programs,
+                                                      GCancellable         *cancellable,
+                                                      GAsyncReadyCallback   callback,
+                                                      gpointer              user_data);
+  GHashTable            *(*resolve_programs_finish)  (IdeRuntime           *self,
+                                                      GAsyncResult         *result,
+                                                      GError              **error);
 
-  gpointer _reserved3;
-  gpointer _reserved4;
   gpointer _reserved5;
   gpointer _reserved6;
   gpointer _reserved7;
@@ -121,6 +127,15 @@ gboolean               ide_runtime_postinstall_finish       (IdeRuntime
 gboolean               ide_runtime_contains_program_in_path (IdeRuntime           *self,
                                                              const gchar          *program,
                                                              GCancellable         *cancellable);
+void                   ide_runtime_resolve_programs_async   (IdeRuntime           *self,
+                                                             const gchar * const  *programs,
+                                                             GCancellable         *cancellable,
+                                                             GAsyncReadyCallback   callback,
+                                                             gpointer              user_data);
+GHashTable            *ide_runtime_resolve_programs_finish  (IdeRuntime           *self,
+                                                             GAsyncResult         *result,
+                                                             GError              **error);
+void                   ide_runtime_invalidate_programs      (IdeRuntime           *self);
 IdeSubprocessLauncher *ide_runtime_create_launcher          (IdeRuntime           *self,
                                                              GError              **error);
 IdeRunner             *ide_runtime_create_runner            (IdeRuntime           *self,
@@ -19,102 +19,307 @@
 #define G_LOG_DOMAIN "ide-source-snippets-manager"
 
 #include <glib/gi18n.h>
+#include <glib/gstdio.h>
 
+#include "config.h"
+
+#include "ide-debug.h"
 #include "ide-global.h"
 #include "ide-source-snippets-manager.h"
+#include "ide-source-snippet-chunk.h"
 #include "ide-source-snippet-parser.h"
 #include "ide-source-snippets.h"
 #include "ide-source-snippet.h"
 
+/*
+ * Parsing every .snippets file is too slow to do at startup, so the parsed
+ * snippets are kept in a single GVariant catalog in the user cache
+ * directory, which is mapped into memory on the next run. Each source file
+ * has its own entry, keyed by URI, modification time and size, so only
+ * files that changed since the catalog was written are parsed again.
+ *
+ * IdeSourceSnippets are only built from the catalog the first time a
+ * language is requested.
+ */
+
+#define SNIPPETS_DIRECTORY    "/org/gnome/builder/snippets/"
+#define CATALOG_VERSION       1
+#define CATALOG_SNIPPETS_TYPE "a(sssa(si))"
+#define CATALOG_SOURCE_TYPE   "(stta{s" CATALOG_SNIPPETS_TYPE "})"
+#define CATALOG_TYPE          "(usa" CATALOG_SOURCE_TYPE ")"
+
 struct _IdeSourceSnippetsManager
 {
   GObject     parent_instance;
+  GVariant   *catalog;
   GHashTable *by_language_id;
 };
 
+typedef struct
+{
+  gchar   *uri;
+  guint64  mtime;
+  guint64  size;
+} SnippetsSource;
+
 G_DEFINE_TYPE (IdeSourceSnippetsManager, ide_source_snippets_manager, G_TYPE_OBJECT)
 
-#define SNIPPETS_DIRECTORY "/org/gnome/builder/snippets/"
+static void
+snippets_source_free (gpointer data)
+{
+  SnippetsSource *source = data;
+
+  g_free (source->uri);
+  g_slice_free (SnippetsSource, source);
+}
+
+static void
+snippets_unref (gpointer data)
+{
+  if (data != NULL)
+    g_object_unref (data);
+}
 
-static gboolean
-ide_source_snippets_manager_load_file (IdeSourceSnippetsManager  *self,
-                                       GFile                     *file,
-                                       GError                   **error)
+static gchar *
+get_catalog_path (void)
 {
-  IdeSourceSnippetParser *parser;
-  GList *iter;
+  return g_build_filename (g_get_user_cache_dir (),
+                           ide_get_program_name (),
+                           "snippets",
+                           "catalog.gvariant",
+                           NULL);
+}
 
-  g_return_val_if_fail (IDE_IS_SOURCE_SNIPPETS_MANAGER (self), FALSE);
-  g_return_val_if_fail (G_IS_FILE (file), FALSE);
+static GVariant *
+snippet_to_variant (IdeSourceSnippet *snippet)
+{
+  GVariantBuilder chunks;
+  const gchar *description;
+  const gchar *text;
+  guint n_chunks;
 
-  parser = ide_source_snippet_parser_new ();
+  g_assert (IDE_IS_SOURCE_SNIPPET (snippet));
+
+  description = ide_source_snippet_get_description (snippet);
+  text = ide_source_snippet_get_snippet_text (snippet);
+  n_chunks = ide_source_snippet_get_n_chunks (snippet);
+
+  g_variant_builder_init (&chunks, G_VARIANT_TYPE ("a(si)"));
 
-  if (!ide_source_snippet_parser_load_from_file (parser, file, error))
+  for (guint i = 0; i < n_chunks; i++)
     {
-      g_object_unref (parser);
-      return FALSE;
+      IdeSourceSnippetChunk *chunk = ide_source_snippet_get_nth_chunk (snippet, i);
+      const gchar *spec = ide_source_snippet_chunk_get_spec (chunk);
+
+      g_variant_builder_add (&chunks, "(si)",
+                             spec ? spec : "",
+                             ide_source_snippet_chunk_get_tab_stop (chunk));
     }
 
-  for (iter = ide_source_snippet_parser_get_snippets (parser); iter; iter = iter->next)
+  return g_variant_new ("(sssa(si))",
+                        ide_source_snippet_get_trigger (snippet),
+                        description ? description : "",
+                        text ? text : "",
+                        &chunks);
+}
+
+static IdeSourceSnippet *
+snippet_from_variant (GVariant    *variant,
+                      const gchar *language)
+{
+  g_autoptr(GVariantIter) chunks = NULL;
+  IdeSourceSnippet *snippet;
+  const gchar *trigger;
+  const gchar *description;
+  const gchar *text;
+  const gchar *spec;
+  gint tab_stop;
+
+  g_assert (variant != NULL);
+  g_assert (language != NULL);
+
+  g_variant_get (variant, "(&s&s&sa(si))", &trigger, &description, &text, &chunks);
+
+  snippet = ide_source_snippet_new (trigger, language);
+
+  if (*description)
+    ide_source_snippet_set_description (snippet, description);
+
+  if (*text)
+    ide_source_snippet_set_snippet_text (snippet, text);
+
+  while (g_variant_iter_next (chunks, "(&si)", &spec, &tab_stop))
     {
-      IdeSourceSnippets *snippets;
-      IdeSourceSnippet *snippet;
-      const gchar *language;
+      g_autoptr(IdeSourceSnippetChunk) chunk = ide_source_snippet_chunk_new ();
+
+      ide_source_snippet_chunk_set_spec (chunk, spec);
+      ide_source_snippet_chunk_set_tab_stop (chunk, tab_stop);
+      ide_source_snippet_add_chunk (snippet, chunk);
+    }
+
+  return snippet;
+}
+
+/*
+ * Parses @source and returns its catalog entry, which groups the snippets
+ * found in the file by language.
+ */
+static GVariant *
+ide_source_snippets_manager_parse_source (const SnippetsSource *source)
+{
+  g_autoptr(IdeSourceSnippetParser) parser = NULL;
+  g_autoptr(GHashTable) by_language = NULL;
+  g_autoptr(GFile) file = NULL;
+  g_autoptr(GError) error = NULL;
+  GVariantBuilder languages;
+  GHashTableIter iter;
+  gpointer key;
+  gpointer value;
+
+  g_assert (source != NULL);
+
+  file = g_file_new_for_uri (source->uri);
+  parser = ide_source_snippet_parser_new ();
+  by_language = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, (GDestroyNotify)g_ptr_array_unref);
 
-      snippet  = iter->data;
-      language = ide_source_snippet_get_language (snippet);
-      snippets = g_hash_table_lookup (self->by_language_id, language);
+  if (!ide_source_snippet_parser_load_from_file (parser, file, &error))
+    g_warning (_("Failed to load file: %s: %s"), source->uri, error->message);
 
-      if (!snippets)
+  for (const GList *list = ide_source_snippet_parser_get_snippets (parser); list; list = list->next)
+    {
+      IdeSourceSnippet *snippet = list->data;
+      const gchar *language = ide_source_snippet_get_language (snippet);
+      GPtrArray *ar;
+
+      if (!(ar = g_hash_table_lookup (by_language, language)))
         {
-          snippets = ide_source_snippets_new ();
-          g_hash_table_insert (self->by_language_id, g_strdup (language), snippets);
+          ar = g_ptr_array_new ();
+          g_hash_table_insert (by_language, (gchar *)language, ar);
         }
 
-      ide_source_snippets_add (snippets, snippet);
+      g_ptr_array_add (ar, snippet_to_variant (snippet));
     }
 
-  g_object_unref (parser);
+  g_variant_builder_init (&languages, G_VARIANT_TYPE ("a{s" CATALOG_SNIPPETS_TYPE "}"));
+
+  g_hash_table_iter_init (&iter, by_language);
 
-  return TRUE;
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      GPtrArray *ar = value;
+
+      g_variant_builder_add (&languages, "{s@" CATALOG_SNIPPETS_TYPE "}",
+                             key,
+                             g_variant_new_array (G_VARIANT_TYPE ("(sssa(si))"),
+                                                  (GVariant **)ar->pdata,
+                                                  ar->len));
+    }
+
+  return g_variant_new ("(stt@a{s" CATALOG_SNIPPETS_TYPE "})",
+                        source->uri,
+                        source->mtime,
+                        source->size,
+                        g_variant_builder_end (&languages));
 }
 
-static void
-ide_source_snippets_manager_load_directory (IdeSourceSnippetsManager *manager,
-                                           const gchar             *path)
+/*
+ * Lists every snippets file along with the information used to decide if
+ * its catalog entry is still valid. Bundled snippets cannot change without
+ * the program changing, which is covered by the version in the catalog.
+ */
+static GPtrArray *
+ide_source_snippets_manager_list_sources (void)
 {
+  g_auto(GStrv) names = NULL;
+  g_autofree gchar *path = NULL;
+  g_autoptr(GError) error = NULL;
+  GPtrArray *sources;
   const gchar *name;
-  GError *error = NULL;
-  gchar *filename;
-  GFile *file;
   GDir *dir;
 
-  dir = g_dir_open (path, 0, &error);
+  sources = g_ptr_array_new_with_free_func (snippets_source_free);
+
+  if (!(names = g_resources_enumerate_children (SNIPPETS_DIRECTORY, G_RESOURCE_LOOKUP_FLAGS_NONE, &error)))
+    {
+      g_message ("%s", error->message);
+      g_clear_error (&error);
+    }
+
+  for (guint i = 0; names != NULL && names[i]; i++)
+    {
+      g_autofree gchar *resource_path = g_strdup_printf (SNIPPETS_DIRECTORY"%s", names[i]);
+      SnippetsSource *source;
+      gsize size = 0;
+
+      g_resources_get_info (resource_path, G_RESOURCE_LOOKUP_FLAGS_NONE, &size, NULL, NULL);
+
+      source = g_slice_new0 (SnippetsSource);
+      source->uri = g_strdup_printf ("resource://%s", resource_path);
+      source->size = size;
+      g_ptr_array_add (sources, source);
+    }
 
-  if (!dir)
+  path = g_build_filename (g_get_user_config_dir (), ide_get_program_name (), "snippets", NULL);
+  g_mkdir_with_parents (path, 0700);
+
+  if (!(dir = g_dir_open (path, 0, &error)))
     {
       g_warning (_("Failed to open directory: %s"), error->message);
-      g_error_free (error);
-      return;
+      return sources;
     }
 
   while ((name = g_dir_read_name (dir)))
     {
-      if (g_str_has_suffix (name, ".snippets"))
-        {
-          filename = g_build_filename (path, name, NULL);
-          file = g_file_new_for_path (filename);
-          if (!ide_source_snippets_manager_load_file (manager, file, &error))
-            {
-              g_warning (_("Failed to load file: %s: %s"), filename, error->message);
-              g_clear_error (&error);
-            }
-          g_object_unref (file);
-          g_free (filename);
-        }
+      g_autofree gchar *filename = NULL;
+      SnippetsSource *source;
+      GStatBuf st;
+
+      if (!g_str_has_suffix (name, ".snippets"))
+        continue;
+
+      filename = g_build_filename (path, name, NULL);
+
+      if (g_stat (filename, &st) != 0)
+        continue;
+
+      source = g_slice_new0 (SnippetsSource);
+      source->uri = g_filename_to_uri (filename, NULL, NULL);
+      source->mtime = st.st_mtime;
+      source->size = st.st_size;
+      g_ptr_array_add (sources, source);
     }
 
   g_dir_close (dir);
+
+  return sources;
+}
+
+static GVariant *
+ide_source_snippets_manager_load_catalog (const gchar *path)
+{
+  g_autoptr(GMappedFile) mapped = NULL;
+  g_autoptr(GVariant) catalog = NULL;
+  g_autoptr(GBytes) bytes = NULL;
+  const gchar *program_version = NULL;
+  guint32 version = 0;
+
+  g_assert (path != NULL);
+
+  if (!(mapped = g_mapped_file_new (path, FALSE, NULL)))
+    return NULL;
+
+  bytes = g_mapped_file_get_bytes (mapped);
+  catalog = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (CATALOG_TYPE), bytes, FALSE));
+
+  if (!g_variant_is_normal_form (catalog))
+    return NULL;
+
+  g_variant_get (catalog, "(u&s@a" CATALOG_SOURCE_TYPE ")", &version, &program_version, NULL);
+
+  if (version != CATALOG_VERSION || g_strcmp0 (program_version, PACKAGE_VERSION) != 0)
+    return NULL;
+
+  return g_steal_pointer (&catalog);
 }
 
 static void
@@ -123,15 +328,109 @@ ide_source_snippets_manager_load_worker (GTask        *task,
                                          gpointer      task_data,
                                          GCancellable *cancellable)
 {
+  g_autoptr(GHashTable) previous = NULL;
+  g_autoptr(GPtrArray) sources = NULL;
+  g_autoptr(GVariant) old_catalog = NULL;
+  g_autoptr(GVariant) catalog = NULL;
   g_autofree gchar *path = NULL;
+  GVariantBuilder builder;
+  guint n_parsed = 0;
 
   g_assert (G_IS_TASK (task));
   g_assert (IDE_IS_SOURCE_SNIPPETS_MANAGER (source_object));
 
-  /* Load internal snippets */
-  path = g_build_filename (g_get_user_config_dir (), ide_get_program_name (), "snippets", NULL);
-  g_mkdir_with_parents (path, 0700);
-  ide_source_snippets_manager_load_directory (source_object, path);
+  path = get_catalog_path ();
+  sources = ide_source_snippets_manager_list_sources ();
+  previous = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, (GDestroyNotify)g_variant_unref);
+
+  if ((old_catalog = ide_source_snippets_manager_load_catalog (path)))
+    {
+      g_autoptr(GVariant) entries = g_variant_get_child_value (old_catalog, 2);
+      GVariantIter iter;
+      GVariant *entry;
+
+      g_variant_iter_init (&iter, entries);
+
+      while ((entry = g_variant_iter_next_value (&iter)))
+        {
+          const gchar *uri = NULL;
+
+          g_variant_get_child (entry, 0, "&s", &uri);
+          g_hash_table_insert (previous, (gchar *)uri, entry);
+        }
+    }
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a" CATALOG_SOURCE_TYPE));
+
+  for (guint i = 0; i < sources->len; i++)
+    {
+      const SnippetsSource *source = g_ptr_array_index (sources, i);
+      GVariant *entry = g_hash_table_lookup (previous, source->uri);
+      guint64 mtime = 0;
+      guint64 size = 0;
+
+      if (entry != NULL)
+        g_variant_get (entry, "(&stt@a{s" CATALOG_SNIPPETS_TYPE "})", NULL, &mtime, &size, NULL);
+
+      if (entry != NULL && mtime == source->mtime && size == source->size)
+        {
+          g_variant_builder_add_value (&builder, entry);
+          continue;
+        }
+
+      g_variant_builder_add_value (&builder, ide_source_snippets_manager_parse_source (source));
+      n_parsed++;
+    }
+
+  catalog = g_variant_ref_sink (g_variant_new ("(us@a" CATALOG_SOURCE_TYPE ")",
+                                               CATALOG_VERSION,
+                                               PACKAGE_VERSION,
+                                               g_variant_builder_end (&builder)));
+
+  IDE_TRACE_MSG ("Parsed %u of %u snippets files", n_parsed, sources->len);
+
+  /* Only rewrite the catalog when an entry was added, removed or changed */
+  if (n_parsed > 0 || old_catalog == NULL ||
+      g_hash_table_size (previous) != sources->len)
+    {
+      g_autoptr(GError) error = NULL;
+      g_autofree gchar *dir = g_path_get_dirname (path);
+
+      g_mkdir_with_parents (dir, 0750);
+
+      if (!g_file_set_contents (path,
+                                g_variant_get_data (catalog),
+                                g_variant_get_size (catalog),
+                                &error))
+        g_warning ("Failed to write snippets catalog: %s", error->message);
+    }
+
+  g_task_return_pointer (task, g_steal_pointer (&catalog), (GDestroyNotify)g_variant_unref);
+}
+
+static void
+ide_source_snippets_manager_load_cb (GObject      *object,
+                                     GAsyncResult *result,
+                                     gpointer      user_data)
+{
+  IdeSourceSnippetsManager *self = (IdeSourceSnippetsManager *)object;
+  g_autoptr(GTask) task = user_data;
+  GError *error = NULL;
+  GVariant *catalog;
+
+  g_assert (IDE_IS_SOURCE_SNIPPETS_MANAGER (self));
+  g_assert (G_IS_TASK (task));
+
+  if (!(catalog = g_task_propagate_pointer (G_TASK (result), &error)))
+    {
+      g_task_return_error (task, error);
+      return;
+    }
+
+  /* Anything built from a previous catalog is stale now */
+  g_clear_pointer (&self->catalog, g_variant_unref);
+  self->catalog = catalog;
+  g_hash_table_remove_all (self->by_language_id);
 
   g_task_return_boolean (task, TRUE);
 }
@@ -143,12 +442,15 @@ ide_source_snippets_manager_load_async (IdeSourceSnippetsManager *self,
                                         gpointer                  user_data)
 {
   g_autoptr(GTask) task = NULL;
+  g_autoptr(GTask) worker = NULL;
 
   g_return_if_fail (IDE_IS_SOURCE_SNIPPETS_MANAGER (self));
   g_return_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable));
 
   task = g_task_new (self, cancellable, callback, user_data);
-  g_task_run_in_thread (task, ide_source_snippets_manager_load_worker);
+
+  worker = g_task_new (self, cancellable, ide_source_snippets_manager_load_cb, g_object_ref (task));
+  g_task_run_in_thread (worker, ide_source_snippets_manager_load_worker);
 }
 
 gboolean
@@ -163,6 +465,53 @@ ide_source_snippets_manager_load_finish (IdeSourceSnippetsManager  *self,
   return g_task_propagate_boolean (task, error);
 }
 
+/*
+ * Builds the snippets for @language_id from every catalog entry. Later
+ * files take precedence, so user snippets override bundled ones.
+ */
+static IdeSourceSnippets *
+ide_source_snippets_manager_build (IdeSourceSnippetsManager *self,
+                                   const gchar              *language_id)
+{
+  IdeSourceSnippets *snippets = NULL;
+  g_autoptr(GVariant) entries = NULL;
+  GVariantIter iter;
+  GVariant *entry;
+
+  g_assert (IDE_IS_SOURCE_SNIPPETS_MANAGER (self));
+  g_assert (self->catalog != NULL);
+  g_assert (language_id != NULL);
+
+  entries = g_variant_get_child_value (self->catalog, 2);
+  g_variant_iter_init (&iter, entries);
+
+  while ((entry = g_variant_iter_next_value (&iter)))
+    {
+      g_autoptr(GVariant) languages = g_variant_get_child_value (entry, 3);
+      g_autoptr(GVariant) list = NULL;
+
+      g_variant_unref (entry);
+
+      list = g_variant_lookup_value (languages, language_id, G_VARIANT_TYPE (CATALOG_SNIPPETS_TYPE));
+
+      if (list == NULL)
+        continue;
+
+      if (snippets == NULL)
+        snippets = ide_source_snippets_new ();
+
+      for (gsize i = 0, n = g_variant_n_children (list); i < n; i++)
+        {
+          g_autoptr(GVariant) item = g_variant_get_child_value (list, i);
+          g_autoptr(IdeSourceSnippet) snippet = snippet_from_variant (item, language_id);
+
+          ide_source_snippets_add (snippets, snippet);
+        }
+    }
+
+  return snippets;
+}
+
 /**
  * ide_source_snippets_manager_get_for_language_id:
  *
@@ -174,10 +523,22 @@ IdeSourceSnippets *
 ide_source_snippets_manager_get_for_language_id (IdeSourceSnippetsManager *self,
                                                  const gchar              *language_id)
 {
+  IdeSourceSnippets *snippets;
+
   g_return_val_if_fail (IDE_IS_SOURCE_SNIPPETS_MANAGER (self), NULL);
   g_return_val_if_fail (language_id != NULL, NULL);
 
-  return g_hash_table_lookup (self->by_language_id, language_id);
+  if (g_hash_table_lookup_extended (self->by_language_id, language_id, NULL, (gpointer *)&snippets))
+    return snippets;
+
+  if (self->catalog == NULL)
+    return NULL;
+
+  /* Languages without snippets are remembered as %NULL */
+  snippets = ide_source_snippets_manager_build (self, language_id);
+  g_hash_table_insert (self->by_language_id, g_strdup (language_id), snippets);
+
+  return snippets;
 }
 
 /**
@@ -191,53 +552,14 @@ IdeSourceSnippets *
 ide_source_snippets_manager_get_for_language (IdeSourceSnippetsManager *self,
                                               GtkSourceLanguage        *language)
 {
-  IdeSourceSnippets *snippets;
   const char *language_id;
 
   g_return_val_if_fail (IDE_IS_SOURCE_SNIPPETS_MANAGER (self), NULL);
   g_return_val_if_fail (GTK_SOURCE_IS_LANGUAGE (language), NULL);
 
   language_id = gtk_source_language_get_id (language);
-  snippets = g_hash_table_lookup (self->by_language_id, language_id);
-
-  return snippets;
-}
-
-static void
-ide_source_snippets_manager_constructed (GObject *object)
-{
-  IdeSourceSnippetsManager *self = (IdeSourceSnippetsManager *)object;
-  GError *error = NULL;
-  gchar **names;
-  guint i;
-
-  g_assert (IDE_IS_SOURCE_SNIPPETS_MANAGER (self));
-
-  names = g_resources_enumerate_children (SNIPPETS_DIRECTORY, G_RESOURCE_LOOKUP_FLAGS_NONE, &error);
-
-  if (!names)
-    {
-      g_message ("%s", error->message);
-      g_clear_error (&error);
-      return;
-    }
-
-  for (i = 0; names[i]; i++)
-    {
-      g_autofree gchar *path = NULL;
-      g_autoptr(GFile) file = NULL;
-
-      path = g_strdup_printf ("resource://"SNIPPETS_DIRECTORY"%s", names[i]);
-      file = g_file_new_for_uri (path);
-
-      if (!ide_source_snippets_manager_load_file (self, file, &error))
-        {
-          g_message ("%s", error->message);
-          g_clear_error (&error);
-        }
-    }
 
-  g_strfreev (names);
+  return ide_source_snippets_manager_get_for_language_id (self, language_id);
 }
 
 static void
@@ -246,6 +568,7 @@ ide_source_snippets_manager_finalize (GObject *object)
   IdeSourceSnippetsManager *self = (IdeSourceSnippetsManager *)object;
 
   g_clear_pointer (&self->by_language_id, g_hash_table_unref);
+  g_clear_pointer (&self->catalog, g_variant_unref);
 
   G_OBJECT_CLASS (ide_source_snippets_manager_parent_class)->finalize (object);
 }
@@ -255,12 +578,11 @@ ide_source_snippets_manager_class_init (IdeSourceSnippetsManagerClass *klass)
 {
   GObjectClass *object_class = G_OBJECT_CLASS (klass);
 
-  object_class->constructed = ide_source_snippets_manager_constructed;
   object_class->finalize = ide_source_snippets_manager_finalize;
 }
 
 static void
 ide_source_snippets_manager_init (IdeSourceSnippetsManager *self)
 {
-  self->by_language_id = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
+  self->by_language_id = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, snippets_unref);
 }
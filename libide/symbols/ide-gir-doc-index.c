@@ -0,0 +1,950 @@
+/* ide-gir-doc-index.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define G_LOG_DOMAIN "ide-gir-doc-index"
+
+#include <egg-counter.h>
+#include <girepository.h>
+#include <glib/gstdio.h>
+#include <string.h>
+
+#include "ide-debug.h"
+#include "ide-global.h"
+
+#include "symbols/ide-gir-doc-index.h"
+#include "threading/ide-thread-pool.h"
+
+/**
+ * SECTION:ide-gir-doc-index
+ * @title: IdeGirDocIndex
+ * @short_description: Documentation of introspected symbols
+ *
+ * #IdeGirDocIndex contains the documentation found in the .gir files of
+ * the system, keyed by the C symbol of functions and methods and by the
+ * type name of classes, interfaces, records and enumerations.
+ *
+ * The index is a single GVariant in the user cache directory which is
+ * mapped into memory for lookups. Each .gir file has its own entry, keyed
+ * by path, modification time and size, holding a sorted table of symbols.
+ * ide_gir_doc_index_update_async() parses the .gir files which changed
+ * since the index was written on the indexer thread pool.
+ *
+ * Lookups must be performed from the main thread.
+ */
+
+#define INDEX_VERSION      1
+#define INDEX_FILE_TYPE    "(sstta(ss))"
+#define INDEX_TYPE         "(ua" INDEX_FILE_TYPE ")"
+#define RELOAD_INTERVAL    (G_USEC_PER_SEC * 5)
+
+struct _IdeGirDocIndex
+{
+  GObject     parent_instance;
+
+  gchar      *cache_path;
+  gchar     **gir_dirs;
+
+  /* The index and the symbol table of each of its files */
+  GVariant   *index;
+  GArray     *tables;
+  gint64      index_mtime;
+  gint64      last_check;
+
+  /* Tasks waiting for the update in progress */
+  GPtrArray  *waiting;
+};
+
+typedef struct
+{
+  const gchar *version;
+  GVariant    *docs;
+} Table;
+
+typedef struct
+{
+  gchar   *path;
+  guint64  mtime;
+  guint64  size;
+} GirFile;
+
+typedef struct
+{
+  gchar *symbol;
+  gchar *doc;
+} DocEntry;
+
+typedef struct
+{
+  gchar     *version;
+  /* The symbol of each open element, or NULL */
+  GPtrArray *stack;
+  GPtrArray *docs;
+  GString   *text;
+  guint      in_doc : 1;
+} GirParser;
+
+enum {
+  PROP_0,
+  PROP_CACHE_PATH,
+  PROP_GIR_DIRS,
+  N_PROPS
+};
+
+G_DEFINE_TYPE (IdeGirDocIndex, ide_gir_doc_index, G_TYPE_OBJECT)
+
+EGG_DEFINE_COUNTER (files_parsed, "IdeGirDocIndex", "Files Parsed", "Number of .gir files parsed")
+EGG_DEFINE_COUNTER (symbols, "IdeGirDocIndex", "Symbols", "Number of documented symbols in the index")
+
+static GParamSpec *properties [N_PROPS];
+
+static void
+table_clear (gpointer data)
+{
+  Table *table = data;
+
+  g_clear_pointer (&table->docs, g_variant_unref);
+}
+
+static void
+gir_file_free (gpointer data)
+{
+  GirFile *file = data;
+
+  g_free (file->path);
+  g_slice_free (GirFile, file);
+}
+
+static void
+doc_entry_free (gpointer data)
+{
+  DocEntry *entry = data;
+
+  g_free (entry->symbol);
+  g_free (entry->doc);
+  g_slice_free (DocEntry, entry);
+}
+
+static gint
+doc_entry_compare (gconstpointer a,
+                   gconstpointer b)
+{
+  const DocEntry *entry_a = *(const DocEntry **)a;
+  const DocEntry *entry_b = *(const DocEntry **)b;
+
+  return strcmp (entry_a->symbol, entry_b->symbol);
+}
+
+static const gchar *
+find_attribute (const gchar **attribute_names,
+                const gchar **attribute_values,
+                const gchar  *name)
+{
+  for (guint i = 0; attribute_names [i] != NULL; i++)
+    {
+      if (g_str_equal (attribute_names [i], name))
+        return attribute_values [i];
+    }
+
+  return NULL;
+}
+
+static void
+gir_parser_start_element (GMarkupParseContext  *context,
+                          const gchar          *element_name,
+                          const gchar         **attribute_names,
+                          const gchar         **attribute_values,
+                          gpointer              user_data,
+                          GError              **error)
+{
+  GirParser *parser = user_data;
+  const gchar *symbol = NULL;
+
+  if (g_str_equal (element_name, "doc"))
+    {
+      /* Only the documentation of the element itself, not its parameters */
+      if (parser->stack->len > 0 &&
+          g_ptr_array_index (parser->stack, parser->stack->len - 1) != NULL)
+        {
+          parser->in_doc = TRUE;
+          g_string_truncate (parser->text, 0);
+        }
+    }
+  else if (g_str_equal (element_name, "class") ||
+           g_str_equal (element_name, "interface") ||
+           g_str_equal (element_name, "record") ||
+           g_str_equal (element_name, "enumeration") ||
+           g_str_equal (element_name, "bitfield"))
+    symbol = find_attribute (attribute_names, attribute_values, "glib:type-name");
+  else if (g_str_equal (element_name, "function") ||
+           g_str_equal (element_name, "method") ||
+           g_str_equal (element_name, "constructor"))
+    symbol = find_attribute (attribute_names, attribute_values, "c:identifier");
+  else if (g_str_equal (element_name, "namespace") && parser->version == NULL)
+    parser->version = g_strdup (find_attribute (attribute_names, attribute_values, "version"));
+
+  g_ptr_array_add (parser->stack, g_strdup (symbol));
+}
+
+static void
+gir_parser_end_element (GMarkupParseContext  *context,
+                        const gchar          *element_name,
+                        gpointer              user_data,
+                        GError              **error)
+{
+  GirParser *parser = user_data;
+
+  g_assert (parser->stack->len > 0);
+
+  if (parser->in_doc && g_str_equal (element_name, "doc"))
+    {
+      DocEntry *entry;
+
+      g_assert (parser->stack->len > 1);
+
+      entry = g_slice_new (DocEntry);
+      entry->symbol = g_strdup (g_ptr_array_index (parser->stack, parser->stack->len - 2));
+      entry->doc = g_strndup (parser->text->str, parser->text->len);
+      g_ptr_array_add (parser->docs, entry);
+
+      parser->in_doc = FALSE;
+    }
+
+  g_ptr_array_remove_index (parser->stack, parser->stack->len - 1);
+}
+
+static void
+gir_parser_text (GMarkupParseContext  *context,
+                 const gchar          *text,
+                 gsize                 text_len,
+                 gpointer              user_data,
+                 GError              **error)
+{
+  GirParser *parser = user_data;
+
+  if (parser->in_doc)
+    g_string_append_len (parser->text, text, text_len);
+}
+
+static const GMarkupParser gir_parser = {
+  gir_parser_start_element,
+  gir_parser_end_element,
+  gir_parser_text,
+  NULL,
+  NULL,
+};
+
+/*
+ * Parses @file and returns its index entry. Only the documentation is
+ * kept, so the file is parsed as a stream of elements rather than being
+ * loaded into a tree.
+ */
+static GVariant *
+ide_gir_doc_index_parse_file (const GirFile *file)
+{
+  g_autoptr(GMappedFile) mapped = NULL;
+  g_autoptr(GError) error = NULL;
+  GVariantBuilder builder;
+  GirParser parser = { 0 };
+  const gchar *last_symbol = NULL;
+  GVariant *ret;
+
+  g_assert (file != NULL);
+
+  parser.stack = g_ptr_array_new_with_free_func (g_free);
+  parser.docs = g_ptr_array_new_with_free_func (doc_entry_free);
+  parser.text = g_string_new (NULL);
+
+  if ((mapped = g_mapped_file_new (file->path, FALSE, &error)))
+    {
+      g_autoptr(GMarkupParseContext) context = NULL;
+
+      context = g_markup_parse_context_new (&gir_parser, 0, &parser, NULL);
+
+      /* Keep whatever was found before an error, as some .gir files
+       * contain characters that are not valid in XML. */
+      if (!g_markup_parse_context_parse (context,
+                                         g_mapped_file_get_contents (mapped),
+                                         g_mapped_file_get_length (mapped),
+                                         &error) ||
+          !g_markup_parse_context_end_parse (context, &error))
+        g_debug ("Failed to parse %s: %s", file->path, error->message);
+    }
+  else
+    g_debug ("Failed to open %s: %s", file->path, error->message);
+
+  EGG_COUNTER_INC (files_parsed);
+
+  g_ptr_array_sort (parser.docs, doc_entry_compare);
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(ss)"));
+
+  for (guint i = 0; i < parser.docs->len; i++)
+    {
+      const DocEntry *entry = g_ptr_array_index (parser.docs, i);
+
+      if (g_strcmp0 (entry->symbol, last_symbol) == 0)
+        continue;
+
+      g_variant_builder_add (&builder, "(ss)", entry->symbol, entry->doc);
+      last_symbol = entry->symbol;
+    }
+
+  ret = g_variant_new ("(sstt@a(ss))",
+                       file->path,
+                       parser.version ? parser.version : "",
+                       file->mtime,
+                       file->size,
+                       g_variant_builder_end (&builder));
+
+  g_free (parser.version);
+  g_ptr_array_unref (parser.stack);
+  g_ptr_array_unref (parser.docs);
+  g_string_free (parser.text, TRUE);
+
+  return ret;
+}
+
+/*
+ * Lists the .gir files found in @gir_dirs. When two directories contain a
+ * file of the same name, the one from the earlier directory is used.
+ */
+static GPtrArray *
+ide_gir_doc_index_list_files (const gchar * const *gir_dirs)
+{
+  g_autoptr(GHashTable) seen = NULL;
+  GPtrArray *files;
+
+  files = g_ptr_array_new_with_free_func (gir_file_free);
+  seen = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  for (guint i = 0; gir_dirs [i] != NULL; i++)
+    {
+      GDir *dir;
+      const gchar *name;
+
+      if (!(dir = g_dir_open (gir_dirs [i], 0, NULL)))
+        continue;
+
+      while ((name = g_dir_read_name (dir)))
+        {
+          g_autofree gchar *path = NULL;
+          GStatBuf stbuf;
+          GirFile *file;
+
+          if (!g_str_has_suffix (name, ".gir") || g_hash_table_contains (seen, name))
+            continue;
+
+          path = g_build_filename (gir_dirs [i], name, NULL);
+
+          if (g_stat (path, &stbuf) != 0 || !S_ISREG (stbuf.st_mode))
+            continue;
+
+          g_hash_table_add (seen, g_strdup (name));
+
+          file = g_slice_new (GirFile);
+          file->path = g_steal_pointer (&path);
+          file->mtime = stbuf.st_mtime;
+          file->size = stbuf.st_size;
+          g_ptr_array_add (files, file);
+        }
+
+      g_dir_close (dir);
+    }
+
+  return files;
+}
+
+static GVariant *
+ide_gir_doc_index_load_index (const gchar *path)
+{
+  g_autoptr(GMappedFile) mapped = NULL;
+  g_autoptr(GVariant) index = NULL;
+  g_autoptr(GBytes) bytes = NULL;
+  guint32 version = 0;
+
+  g_assert (path != NULL);
+
+  if (!(mapped = g_mapped_file_new (path, FALSE, NULL)))
+    return NULL;
+
+  /* Not trusted, so GVariant checks the data as it is accessed instead of
+   * us walking the whole file up front. */
+  bytes = g_mapped_file_get_bytes (mapped);
+  index = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (INDEX_TYPE), bytes, FALSE));
+
+  g_variant_get_child (index, 0, "u", &version);
+
+  if (version != INDEX_VERSION)
+    return NULL;
+
+  return g_steal_pointer (&index);
+}
+
+static void
+ide_gir_doc_index_update_worker (GTask        *task,
+                                 gpointer      source_object,
+                                 gpointer      task_data,
+                                 GCancellable *cancellable)
+{
+  IdeGirDocIndex *self = source_object;
+  const gchar * const *gir_dirs = task_data;
+  g_autoptr(GHashTable) previous = NULL;
+  g_autoptr(GPtrArray) files = NULL;
+  g_autoptr(GVariant) old_index = NULL;
+  g_autoptr(GVariant) index = NULL;
+  GVariantBuilder builder;
+  guint n_parsed = 0;
+
+  IDE_ENTRY;
+
+  g_assert (G_IS_TASK (task));
+  g_assert (IDE_IS_GIR_DOC_INDEX (self));
+  g_assert (gir_dirs != NULL);
+
+  files = ide_gir_doc_index_list_files (gir_dirs);
+  previous = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, (GDestroyNotify)g_variant_unref);
+
+  if ((old_index = ide_gir_doc_index_load_index (self->cache_path)))
+    {
+      g_autoptr(GVariant) entries = g_variant_get_child_value (old_index, 1);
+      GVariantIter iter;
+      GVariant *entry;
+
+      g_variant_iter_init (&iter, entries);
+
+      while ((entry = g_variant_iter_next_value (&iter)))
+        {
+          const gchar *path = NULL;
+
+          g_variant_get_child (entry, 0, "&s", &path);
+          g_hash_table_insert (previous, (gchar *)path, entry);
+        }
+    }
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a" INDEX_FILE_TYPE));
+
+  for (guint i = 0; i < files->len; i++)
+    {
+      const GirFile *file = g_ptr_array_index (files, i);
+      GVariant *entry = g_hash_table_lookup (previous, file->path);
+      guint64 mtime = 0;
+      guint64 size = 0;
+
+      if (entry != NULL)
+        g_variant_get (entry, "(&s&stt@a(ss))", NULL, NULL, &mtime, &size, NULL);
+
+      if (entry != NULL && mtime == file->mtime && size == file->size)
+        {
+          g_variant_builder_add_value (&builder, entry);
+          continue;
+        }
+
+      g_variant_builder_add_value (&builder, ide_gir_doc_index_parse_file (file));
+      n_parsed++;
+    }
+
+  index = g_variant_ref_sink (g_variant_new ("(u@a" INDEX_FILE_TYPE ")",
+                                             INDEX_VERSION,
+                                             g_variant_builder_end (&builder)));
+
+  IDE_TRACE_MSG ("Parsed %u of %u .gir files", n_parsed, files->len);
+
+  /* Only rewrite the index when a file was added, removed or changed */
+  if (n_parsed > 0 || old_index == NULL ||
+      g_hash_table_size (previous) != files->len)
+    {
+      g_autoptr(GError) error = NULL;
+      g_autofree gchar *dir = g_path_get_dirname (self->cache_path);
+
+      g_mkdir_with_parents (dir, 0750);
+
+      if (!g_file_set_contents (self->cache_path,
+                                g_variant_get_data (index),
+                                g_variant_get_size (index),
+                                &error))
+        g_warning ("Failed to write documentation index: %s", error->message);
+    }
+
+  g_task_return_pointer (task, g_steal_pointer (&index), (GDestroyNotify)g_variant_unref);
+
+  IDE_EXIT;
+}
+
+static void
+ide_gir_doc_index_set_index (IdeGirDocIndex *self,
+                             GVariant       *index,
+                             gint64          mtime)
+{
+  g_autoptr(GVariant) entries = NULL;
+  GVariantIter iter;
+  GVariant *entry;
+
+  g_assert (IDE_IS_GIR_DOC_INDEX (self));
+  g_assert (index != NULL);
+
+  for (guint i = 0; i < self->tables->len; i++)
+    EGG_COUNTER_SUB (symbols, (gint64)g_variant_n_children (g_array_index (self->tables, Table, i).docs));
+
+  g_array_set_size (self->tables, 0);
+  g_clear_pointer (&self->index, g_variant_unref);
+
+  self->index = index;
+  self->index_mtime = mtime;
+
+  entries = g_variant_get_child_value (index, 1);
+  g_variant_iter_init (&iter, entries);
+
+  while ((entry = g_variant_iter_next_value (&iter)))
+    {
+      Table table;
+
+      g_variant_get (entry, "(&s&stt@a(ss))", NULL, &table.version, NULL, NULL, &table.docs);
+      g_array_append_val (self->tables, table);
+      g_variant_unref (entry);
+
+      EGG_COUNTER_ADD (symbols, (gint64)g_variant_n_children (table.docs));
+    }
+}
+
+static void
+ide_gir_doc_index_ensure_loaded (IdeGirDocIndex *self)
+{
+  GVariant *index;
+  GStatBuf stbuf;
+  gint64 now;
+
+  g_assert (IDE_IS_GIR_DOC_INDEX (self));
+
+  /*
+   * The index may be rewritten by another process, such as the UI process
+   * while we are in a worker process, so check for a new version of it
+   * every few seconds.
+   */
+  now = g_get_monotonic_time ();
+  if (self->last_check != 0 && now - self->last_check < RELOAD_INTERVAL)
+    return;
+  self->last_check = now;
+
+  if (g_stat (self->cache_path, &stbuf) != 0)
+    return;
+
+  if (self->index != NULL && self->index_mtime == stbuf.st_mtime)
+    return;
+
+  if ((index = ide_gir_doc_index_load_index (self->cache_path)))
+    ide_gir_doc_index_set_index (self, index, stbuf.st_mtime);
+}
+
+static gchar *
+ide_gir_doc_index_lookup_table (const Table *table,
+                                const gchar *symbol)
+{
+  gsize lo = 0;
+  gsize hi;
+
+  g_assert (table != NULL);
+  g_assert (symbol != NULL);
+
+  hi = g_variant_n_children (table->docs);
+
+  while (lo < hi)
+    {
+      g_autoptr(GVariant) child = NULL;
+      const gchar *key = NULL;
+      const gchar *doc = NULL;
+      gsize mid = lo + (hi - lo) / 2;
+      gint cmp;
+
+      child = g_variant_get_child_value (table->docs, mid);
+      g_variant_get (child, "(&s&s)", &key, &doc);
+
+      cmp = strcmp (symbol, key);
+
+      if (cmp == 0)
+        return g_strdup (doc);
+      else if (cmp < 0)
+        hi = mid;
+      else
+        lo = mid + 1;
+    }
+
+  return NULL;
+}
+
+/**
+ * ide_gir_doc_index_lookup:
+ * @self: An #IdeGirDocIndex
+ * @symbol: the C identifier or type name of the symbol
+ * @version: (nullable): the version of the namespace, or %NULL
+ *
+ * Looks up the documentation for @symbol. Only exact matches of the C
+ * identifier of a function or the C type name of a type are found; no
+ * prefix or fuzzy matching is performed. If @version is %NULL, the first
+ * documentation found for @symbol in any namespace version is used.
+ *
+ * This uses the index written by the last update, which may have been
+ * performed by another process.
+ *
+ * Returns: (transfer full) (nullable): the documentation, or %NULL.
+ */
+gchar *
+ide_gir_doc_index_lookup (IdeGirDocIndex *self,
+                          const gchar    *symbol,
+                          const gchar    *version)
+{
+  g_return_val_if_fail (IDE_IS_GIR_DOC_INDEX (self), NULL);
+  g_return_val_if_fail (symbol != NULL, NULL);
+
+  ide_gir_doc_index_ensure_loaded (self);
+
+  for (guint i = 0; i < self->tables->len; i++)
+    {
+      const Table *table = &g_array_index (self->tables, Table, i);
+      gchar *doc;
+
+      if (version != NULL && g_strcmp0 (version, table->version) != 0)
+        continue;
+
+      if ((doc = ide_gir_doc_index_lookup_table (table, symbol)))
+        return doc;
+    }
+
+  return NULL;
+}
+
+/*
+ * .gir files are usually installed in the same prefix as the typelibs, so
+ * <prefix>/lib*\/.../girepository-1.0 in the typelib search path maps to
+ * <prefix>/share/gir-1.0. The system data directories are used as well.
+ */
+static gchar **
+ide_gir_doc_index_discover_dirs (void)
+{
+  g_autoptr(GPtrArray) dirs = NULL;
+  const gchar * const *data_dirs;
+  GSList *search_path;
+
+  dirs = g_ptr_array_new_with_free_func (g_free);
+
+  search_path = g_irepository_get_search_path ();
+
+  for (const GSList *iter = search_path; iter != NULL; iter = iter->next)
+    {
+      g_autofree gchar *typelib_dir = NULL;
+      g_autofree gchar *basename = NULL;
+      gsize len;
+      gchar *dir;
+
+      if (!g_path_is_absolute (iter->data))
+        continue;
+
+      typelib_dir = g_strdup (iter->data);
+      len = strlen (typelib_dir);
+      while (len > 1 && typelib_dir [len - 1] == G_DIR_SEPARATOR)
+        typelib_dir [--len] = '\0';
+
+      basename = g_path_get_basename (typelib_dir);
+
+      if (!g_str_equal (basename, "girepository-1.0"))
+        continue;
+
+      dir = g_path_get_dirname (typelib_dir);
+
+      while (!g_str_equal (dir, G_DIR_SEPARATOR_S))
+        {
+          g_autofree gchar *name = g_path_get_basename (dir);
+          gchar *parent = g_path_get_dirname (dir);
+
+          g_free (dir);
+          dir = parent;
+
+          if (g_str_has_prefix (name, "lib"))
+            {
+              g_ptr_array_add (dirs, g_build_filename (dir, "share", "gir-1.0", NULL));
+              break;
+            }
+        }
+
+      g_free (dir);
+    }
+
+  data_dirs = g_get_system_data_dirs ();
+
+  for (guint i = 0; data_dirs [i] != NULL; i++)
+    g_ptr_array_add (dirs, g_build_filename (data_dirs [i], "gir-1.0", NULL));
+
+  g_ptr_array_add (dirs, NULL);
+
+  return (gchar **)g_ptr_array_free (g_steal_pointer (&dirs), FALSE);
+}
+
+static void
+ide_gir_doc_index_update_cb (GObject      *object,
+                             GAsyncResult *result,
+                             gpointer      user_data)
+{
+  IdeGirDocIndex *self = (IdeGirDocIndex *)object;
+  g_autoptr(GPtrArray) waiting = NULL;
+  g_autoptr(GError) error = NULL;
+  GVariant *index;
+
+  IDE_ENTRY;
+
+  g_assert (IDE_IS_GIR_DOC_INDEX (self));
+  g_assert (G_IS_TASK (result));
+
+  if ((index = g_task_propagate_pointer (G_TASK (result), &error)))
+    {
+      GStatBuf stbuf;
+      gint64 mtime = 0;
+
+      if (g_stat (self->cache_path, &stbuf) == 0)
+        mtime = stbuf.st_mtime;
+
+      ide_gir_doc_index_set_index (self, index, mtime);
+      self->last_check = g_get_monotonic_time ();
+    }
+
+  waiting = g_steal_pointer (&self->waiting);
+  self->waiting = g_ptr_array_new_with_free_func (g_object_unref);
+
+  for (guint i = 0; i < waiting->len; i++)
+    {
+      GTask *task = g_ptr_array_index (waiting, i);
+
+      if (error != NULL)
+        g_task_return_error (task, g_error_copy (error));
+      else
+        g_task_return_boolean (task, TRUE);
+    }
+
+  IDE_EXIT;
+}
+
+/**
+ * ide_gir_doc_index_update_async:
+ * @self: An #IdeGirDocIndex
+ * @cancellable: (nullable): A #GCancellable or %NULL
+ * @callback: (nullable): A callback to execute upon completion
+ * @user_data: user data for @callback
+ *
+ * Parses the .gir files that were added or changed since the index was
+ * last written and writes the new index. The work is performed on the
+ * indexer thread pool. If an update is already in progress, @callback is
+ * executed once it completes.
+ */
+void
+ide_gir_doc_index_update_async (IdeGirDocIndex      *self,
+                                GCancellable        *cancellable,
+                                GAsyncReadyCallback  callback,
+                                gpointer             user_data)
+{
+  g_autoptr(GTask) task = NULL;
+  g_autoptr(GTask) update = NULL;
+  gchar **gir_dirs;
+
+  IDE_ENTRY;
+
+  g_return_if_fail (IDE_IS_GIR_DOC_INDEX (self));
+  g_return_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_source_tag (task, ide_gir_doc_index_update_async);
+
+  g_ptr_array_add (self->waiting, g_steal_pointer (&task));
+
+  if (self->waiting->len > 1)
+    IDE_EXIT;
+
+  if (self->gir_dirs != NULL)
+    gir_dirs = g_strdupv (self->gir_dirs);
+  else
+    gir_dirs = ide_gir_doc_index_discover_dirs ();
+
+  /* Shared by every waiting task, so not cancelled by any of them */
+  update = g_task_new (self, NULL, ide_gir_doc_index_update_cb, NULL);
+  g_task_set_source_tag (update, ide_gir_doc_index_update_worker);
+  g_task_set_task_data (update, gir_dirs, (GDestroyNotify)g_strfreev);
+  ide_thread_pool_push_task (IDE_THREAD_POOL_INDEXER, update, ide_gir_doc_index_update_worker);
+
+  IDE_EXIT;
+}
+
+gboolean
+ide_gir_doc_index_update_finish (IdeGirDocIndex  *self,
+                                 GAsyncResult    *result,
+                                 GError         **error)
+{
+  g_return_val_if_fail (IDE_IS_GIR_DOC_INDEX (self), FALSE);
+  g_return_val_if_fail (G_IS_TASK (result), FALSE);
+
+  return g_task_propagate_boolean (G_TASK (result), error);
+}
+
+static void
+ide_gir_doc_index_constructed (GObject *object)
+{
+  IdeGirDocIndex *self = (IdeGirDocIndex *)object;
+
+  G_OBJECT_CLASS (ide_gir_doc_index_parent_class)->constructed (object);
+
+  if (self->cache_path == NULL)
+    self->cache_path = g_build_filename (g_get_user_cache_dir (),
+                                         ide_get_program_name (),
+                                         "gir-docs",
+                                         "index.gvariant",
+                                         NULL);
+}
+
+static void
+ide_gir_doc_index_finalize (GObject *object)
+{
+  IdeGirDocIndex *self = (IdeGirDocIndex *)object;
+
+  for (guint i = 0; i < self->tables->len; i++)
+    EGG_COUNTER_SUB (symbols, (gint64)g_variant_n_children (g_array_index (self->tables, Table, i).docs));
+
+  g_clear_pointer (&self->tables, g_array_unref);
+  g_clear_pointer (&self->index, g_variant_unref);
+  g_clear_pointer (&self->waiting, g_ptr_array_unref);
+  g_clear_pointer (&self->cache_path, g_free);
+  g_clear_pointer (&self->gir_dirs, g_strfreev);
+
+  G_OBJECT_CLASS (ide_gir_doc_index_parent_class)->finalize (object);
+}
+
+static void
+ide_gir_doc_index_get_property (GObject    *object,
+                                guint       prop_id,
+                                GValue     *value,
+                                GParamSpec *pspec)
+{
+  IdeGirDocIndex *self = IDE_GIR_DOC_INDEX (object);
+
+  switch (prop_id)
+    {
+    case PROP_CACHE_PATH:
+      g_value_set_string (value, self->cache_path);
+      break;
+
+    case PROP_GIR_DIRS:
+      g_value_set_boxed (value, self->gir_dirs);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+ide_gir_doc_index_set_property (GObject      *object,
+                                guint         prop_id,
+                                const GValue *value,
+                                GParamSpec   *pspec)
+{
+  IdeGirDocIndex *self = IDE_GIR_DOC_INDEX (object);
+
+  switch (prop_id)
+    {
+    case PROP_CACHE_PATH:
+      self->cache_path = g_value_dup_string (value);
+      break;
+
+    case PROP_GIR_DIRS:
+      self->gir_dirs = g_value_dup_boxed (value);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+ide_gir_doc_index_class_init (IdeGirDocIndexClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->constructed = ide_gir_doc_index_constructed;
+  object_class->finalize = ide_gir_doc_index_finalize;
+  object_class->get_property = ide_gir_doc_index_get_property;
+  object_class->set_property = ide_gir_doc_index_set_property;
+
+  properties [PROP_CACHE_PATH] =
+    g_param_spec_string ("cache-path",
+                         "Cache Path",
+                         "The path of the index file",
+                         NULL,
+                         (G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS));
+
+  properties [PROP_GIR_DIRS] =
+    g_param_spec_boxed ("gir-dirs",
+                        "Gir Dirs",
+                        "The directories containing .gir files, or NULL to discover them",
+                        G_TYPE_STRV,
+                        (G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_properties (object_class, N_PROPS, properties);
+}
+
+static void
+ide_gir_doc_index_init (IdeGirDocIndex *self)
+{
+  self->tables = g_array_new (FALSE, FALSE, sizeof (Table));
+  g_array_set_clear_func (self->tables, table_clear);
+  self->waiting = g_ptr_array_new_with_free_func (g_object_unref);
+}
+
+/**
+ * ide_gir_doc_index_new:
+ * @cache_path: (nullable): the path of the index file, or %NULL
+ * @gir_dirs: (nullable) (array zero-terminated=1): the directories to
+ *   index, or %NULL to use those of the system
+ *
+ * Creates a new #IdeGirDocIndex. Most callers want the index shared by the
+ * process from ide_gir_doc_index_get_default() instead.
+ *
+ * Returns: (transfer full): A new #IdeGirDocIndex.
+ */
+IdeGirDocIndex *
+ide_gir_doc_index_new (const gchar         *cache_path,
+                       const gchar * const *gir_dirs)
+{
+  return g_object_new (IDE_TYPE_GIR_DOC_INDEX,
+                       "cache-path", cache_path,
+                       "gir-dirs", gir_dirs,
+                       NULL);
+}
+
+/**
+ * ide_gir_doc_index_get_default:
+ *
+ * Gets the index shared by the process, stored in the user cache
+ * directory and covering the .gir files of the system.
+ *
+ * Returns: (transfer none): An #IdeGirDocIndex.
+ */
+IdeGirDocIndex *
+ide_gir_doc_index_get_default (void)
+{
+  static IdeGirDocIndex *instance;
+
+  if (g_once_init_enter (&instance))
+    g_once_init_leave (&instance, ide_gir_doc_index_new (NULL, NULL));
+
+  return instance;
+}
@@ -23,13 +23,49 @@
 #include "ide-debug.h"
 
 #include "threading/ide-thread-pool.h"
+#include "util/ide-battery-monitor.h"
+
+/*
+ * All kinds share a single set of worker threads, sized from the CPUs we are
+ * allowed to use. Each kind has a queue per priority, and every worker has a
+ * home kind whose queues it services first. When there is nothing to do for
+ * its home kind, a worker steals from the other kinds rather than sitting
+ * idle, so a burst of compiler work can use the whole machine.
+ *
+ * The number of running items is bounded per kind and for background items,
+ * so indexing cannot starve interactive requests. The background bound is
+ * lowered while the battery monitor asks us to conserve power.
+ *
+ * Work items are coarse (parsing a translation unit, building an index), so
+ * a single lock protecting all of the queues is not a source of contention.
+ */
+
+#define CONSERVE_CHECK_INTERVAL (G_USEC_PER_SEC * 5)
+
+enum {
+  TYPE_TASK,
+  TYPE_FUNC,
+};
 
-#define COMPILER_MAX_THREADS 4
-#define INDEXER_MAX_THREADS  1
+typedef enum
+{
+  STATE_NEW,
+  STATE_QUEUED,
+  STATE_RUNNING,
+  STATE_CANCELLED,
+} WorkItemState;
 
 typedef struct
 {
-  int type;
+  volatile gint          ref_count;
+  int                    type;
+  WorkItemState          state;
+  IdeThreadPoolKind      kind;
+  IdeThreadPoolPriority  priority;
+  gint64                 queued_at;
+  GList                  link;
+  GCancellable          *cancellable;
+  gulong                 cancelled_handler;
   union {
     struct {
       GTask           *task;
@@ -44,177 +80,558 @@ typedef struct
 
 EGG_DEFINE_COUNTER (TotalTasks, "ThreadPool", "Total Tasks", "Total number of tasks processed.")
 EGG_DEFINE_COUNTER (QueuedTasks, "ThreadPool", "Queued Tasks", "Current number of pending tasks.")
+EGG_DEFINE_COUNTER (RunningTasks, "ThreadPool", "Running Tasks", "Current number of running tasks.")
+EGG_DEFINE_COUNTER (StolenTasks, "ThreadPool", "Stolen Tasks", "Tasks run by a worker of another kind.")
+EGG_DEFINE_COUNTER (CancelledTasks, "ThreadPool", "Cancelled Tasks", "Tasks cancelled before they ran.")
+EGG_DEFINE_HISTOGRAM (WaitTime, "ThreadPool", "Wait Time", "Time tasks spent queued before running")
+
+static GMutex   pool_mutex;
+static GCond    pool_cond;
+static GQueue   queues [IDE_THREAD_POOL_LAST][IDE_THREAD_POOL_PRIORITY_LAST];
+static guint    n_running [IDE_THREAD_POOL_LAST];
+static guint    max_running [IDE_THREAD_POOL_LAST];
+static guint    n_running_background;
+static guint    max_running_background;
+static guint    n_threads;
+static gboolean is_worker_pool;
+static gboolean conserve;
+static gint64   conserve_checked_at;
+
+static WorkItem *
+work_item_new (IdeThreadPoolKind     kind,
+               IdeThreadPoolPriority priority)
+{
+  WorkItem *work_item;
 
-static GThreadPool *thread_pools [IDE_THREAD_POOL_LAST];
+  work_item = g_slice_new0 (WorkItem);
+  work_item->ref_count = 1;
+  work_item->kind = kind;
+  work_item->priority = priority;
+  work_item->link.data = work_item;
 
-enum {
-  TYPE_TASK,
-  TYPE_FUNC,
-};
+  return work_item;
+}
+
+static WorkItem *
+work_item_ref (WorkItem *work_item)
+{
+  g_atomic_int_inc (&work_item->ref_count);
+
+  return work_item;
+}
+
+static void
+work_item_unref (WorkItem *work_item)
+{
+  if (g_atomic_int_dec_and_test (&work_item->ref_count))
+    {
+      if (work_item->type == TYPE_TASK)
+        g_clear_object (&work_item->task.task);
+      g_slice_free (WorkItem, work_item);
+    }
+}
+
+/*
+ * Returns the number of CPUs allowed by the cgroup quota, or 0 if there is
+ * no quota. Only the cgroup we see at the root of /sys/fs/cgroup is checked,
+ * which is the one applied to us when running inside a container.
+ */
+static guint
+ide_thread_pool_get_cgroup_cpus (void)
+{
+  g_autofree gchar *contents = NULL;
+  g_autofree gchar *period_contents = NULL;
+  gint64 quota = 0;
+  gint64 period = 0;
+
+  if (g_file_get_contents ("/sys/fs/cgroup/cpu.max", &contents, NULL, NULL))
+    {
+      gchar *endptr = NULL;
+
+      /* cgroup v2, "$MAX $PERIOD" where $MAX may be "max" */
+      quota = g_ascii_strtoll (contents, &endptr, 10);
+      if (endptr != contents && *endptr == ' ')
+        period = g_ascii_strtoll (endptr + 1, NULL, 10);
+    }
+  else if (g_file_get_contents ("/sys/fs/cgroup/cpu/cpu.cfs_quota_us", &contents, NULL, NULL) &&
+           g_file_get_contents ("/sys/fs/cgroup/cpu/cpu.cfs_period_us", &period_contents, NULL, NULL))
+    {
+      /* cgroup v1, a quota of -1 means there is no limit */
+      quota = g_ascii_strtoll (contents, NULL, 10);
+      period = g_ascii_strtoll (period_contents, NULL, 10);
+    }
+
+  if (quota <= 0 || period <= 0)
+    return 0;
+
+  return MAX (1, (quota + period - 1) / period);
+}
+
+static guint
+ide_thread_pool_get_n_cpus (void)
+{
+  guint n_cpus;
+  guint quota;
+
+  /* This already honors the scheduler affinity mask */
+  n_cpus = g_get_num_processors ();
+
+  if ((quota = ide_thread_pool_get_cgroup_cpus ()) > 0)
+    n_cpus = MIN (n_cpus, quota);
+
+  return MAX (1, n_cpus);
+}
+
+static void
+ide_thread_pool_update_limits_locked (void)
+{
+  if (is_worker_pool)
+    {
+      max_running [IDE_THREAD_POOL_COMPILER] = 1;
+      max_running [IDE_THREAD_POOL_INDEXER] = 1;
+      max_running_background = 1;
+      return;
+    }
+
+  max_running [IDE_THREAD_POOL_COMPILER] = n_threads;
+
+  if (conserve)
+    {
+      max_running [IDE_THREAD_POOL_INDEXER] = 1;
+      max_running_background = 1;
+    }
+  else
+    {
+      max_running [IDE_THREAD_POOL_INDEXER] = MAX (1, n_threads / 4);
+      max_running_background = MAX (1, n_threads / 2);
+    }
+}
+
+/*
+ * Querying the battery monitor may block on D-Bus the first time, so this
+ * is only done when pushing work (usually from the main thread) and at most
+ * every few seconds, never from the workers.
+ */
+static void
+ide_thread_pool_update_conserve (void)
+{
+  gint64 now = g_get_monotonic_time ();
+  gboolean should_conserve;
+
+  if (is_worker_pool)
+    return;
+
+  g_mutex_lock (&pool_mutex);
+  if (now - conserve_checked_at < CONSERVE_CHECK_INTERVAL)
+    {
+      g_mutex_unlock (&pool_mutex);
+      return;
+    }
+  conserve_checked_at = now;
+  g_mutex_unlock (&pool_mutex);
+
+  should_conserve = ide_battery_monitor_get_should_conserve ();
+
+  g_mutex_lock (&pool_mutex);
+  if (should_conserve != conserve)
+    {
+      IDE_TRACE_MSG ("Thread pool %s conserving power", should_conserve ? "is" : "stopped");
+      conserve = should_conserve;
+      ide_thread_pool_update_limits_locked ();
+      g_cond_broadcast (&pool_cond);
+    }
+  g_mutex_unlock (&pool_mutex);
+}
+
+static inline gboolean
+ide_thread_pool_can_run_locked (IdeThreadPoolKind     kind,
+                                IdeThreadPoolPriority priority)
+{
+  if (n_running [kind] >= max_running [kind])
+    return FALSE;
+
+  if (priority == IDE_THREAD_POOL_PRIORITY_BACKGROUND &&
+      n_running_background >= max_running_background)
+    return FALSE;
+
+  return TRUE;
+}
+
+static WorkItem *
+ide_thread_pool_pop_locked (IdeThreadPoolKind  home,
+                            gboolean          *stolen)
+{
+  *stolen = FALSE;
+
+  for (guint priority = 0; priority < IDE_THREAD_POOL_PRIORITY_LAST; priority++)
+    {
+      GList *link = NULL;
+
+      if (ide_thread_pool_can_run_locked (home, priority))
+        link = g_queue_pop_head_link (&queues [home][priority]);
+
+      for (guint kind = 0; link == NULL && kind < IDE_THREAD_POOL_LAST; kind++)
+        {
+          if (kind == home || !ide_thread_pool_can_run_locked (kind, priority))
+            continue;
 
-static inline GThreadPool *
-ide_thread_pool_get_pool (IdeThreadPoolKind kind)
+          if ((link = g_queue_pop_head_link (&queues [kind][priority])))
+            *stolen = TRUE;
+        }
+
+      if (link != NULL)
+        return link->data;
+    }
+
+  return NULL;
+}
+
+static void
+ide_thread_pool_cancelled_cb (GCancellable *cancellable,
+                              WorkItem     *work_item)
 {
-  return thread_pools [kind];
+  gboolean was_queued = FALSE;
+  gboolean cancelled = FALSE;
+
+  g_assert (G_IS_CANCELLABLE (cancellable));
+  g_assert (work_item != NULL);
+  g_assert (work_item->type == TYPE_TASK);
+
+  g_mutex_lock (&pool_mutex);
+  if (work_item->state == STATE_QUEUED)
+    {
+      g_queue_unlink (&queues [work_item->kind][work_item->priority], &work_item->link);
+      was_queued = TRUE;
+    }
+  if (work_item->state == STATE_NEW || was_queued)
+    {
+      work_item->state = STATE_CANCELLED;
+      cancelled = TRUE;
+    }
+  g_mutex_unlock (&pool_mutex);
+
+  if (cancelled)
+    {
+      EGG_COUNTER_INC (CancelledTasks);
+
+      g_task_return_error_if_cancelled (work_item->task.task);
+
+      /*
+       * The task holds the cancellable, which holds this handler, so drop
+       * the task now to break the cycle.
+       */
+      g_clear_object (&work_item->task.task);
+
+      if (was_queued)
+        {
+          EGG_COUNTER_DEC (QueuedTasks);
+          work_item_unref (work_item);
+        }
+    }
+}
+
+static void
+ide_thread_pool_push_work_item (WorkItem *work_item)
+{
+  g_assert (work_item != NULL);
+  g_assert (work_item->state == STATE_NEW);
+
+  EGG_COUNTER_INC (TotalTasks);
+
+  ide_thread_pool_update_conserve ();
+
+  /*
+   * Track cancellation so the task is completed and dropped from the queue
+   * as soon as it is cancelled, rather than when a worker reaches it. If the
+   * cancellable is already cancelled, the handler runs immediately.
+   */
+  if (work_item->cancellable != NULL)
+    work_item->cancelled_handler =
+      g_cancellable_connect (work_item->cancellable,
+                             G_CALLBACK (ide_thread_pool_cancelled_cb),
+                             work_item_ref (work_item),
+                             (GDestroyNotify)work_item_unref);
+
+  g_mutex_lock (&pool_mutex);
+  if (work_item->state == STATE_NEW)
+    {
+      work_item->state = STATE_QUEUED;
+      work_item->queued_at = g_get_monotonic_time ();
+      g_queue_push_tail_link (&queues [work_item->kind][work_item->priority],
+                              &work_item_ref (work_item)->link);
+      EGG_COUNTER_INC (QueuedTasks);
+      g_cond_signal (&pool_cond);
+    }
+  g_mutex_unlock (&pool_mutex);
+
+  work_item_unref (work_item);
+}
+
+static IdeThreadPoolPriority
+ide_thread_pool_get_default_priority (IdeThreadPoolKind kind)
+{
+  return kind == IDE_THREAD_POOL_INDEXER ? IDE_THREAD_POOL_PRIORITY_BACKGROUND
+                                         : IDE_THREAD_POOL_PRIORITY_VISIBLE;
 }
 
 /**
- * ide_thread_pool_push_task:
+ * ide_thread_pool_push_task_with_priority:
  * @kind: The task kind.
+ * @priority: The priority of the task within the thread pool.
  * @task: A #GTask to execute.
  * @func: (scope async): The thread worker to execute for @task.
  *
- * This pushes a task to be executed on a worker thread based on the task kind as denoted by
- * @kind. Some tasks will be placed on special work queues or throttled based on priority.
+ * Like ide_thread_pool_push_task() but allows specifying the priority of
+ * the task. Use %IDE_THREAD_POOL_PRIORITY_INTERACTIVE for work the user is
+ * waiting on, such as completion results.
+ *
+ * If the cancellable of @task is cancelled before a worker picks it up,
+ * @func is not called and @task completes with %G_IO_ERROR_CANCELLED.
  */
 void
-ide_thread_pool_push_task (IdeThreadPoolKind  kind,
-                           GTask             *task,
-                           GTaskThreadFunc    func)
+ide_thread_pool_push_task_with_priority (IdeThreadPoolKind      kind,
+                                         IdeThreadPoolPriority  priority,
+                                         GTask                 *task,
+                                         GTaskThreadFunc        func)
 {
-  GThreadPool *pool;
+  WorkItem *work_item;
 
   IDE_ENTRY;
 
   g_return_if_fail (kind >= 0);
   g_return_if_fail (kind < IDE_THREAD_POOL_LAST);
+  g_return_if_fail (priority >= 0);
+  g_return_if_fail (priority < IDE_THREAD_POOL_PRIORITY_LAST);
   g_return_if_fail (G_IS_TASK (task));
   g_return_if_fail (func != NULL);
 
-  EGG_COUNTER_INC (TotalTasks);
-
-  pool = ide_thread_pool_get_pool (kind);
-
-  if (pool != NULL)
-    {
-      WorkItem *work_item;
-
-      work_item = g_slice_new0 (WorkItem);
-      work_item->type = TYPE_TASK;
-      work_item->task.task = g_object_ref (task);
-      work_item->task.func = func;
-
-      EGG_COUNTER_INC (QueuedTasks);
-
-      g_thread_pool_push (pool, work_item, NULL);
-    }
-  else
+  if (n_threads == 0)
     {
+      EGG_COUNTER_INC (TotalTasks);
       g_task_run_in_thread (task, func);
+      IDE_EXIT;
     }
 
+  work_item = work_item_new (kind, priority);
+  work_item->type = TYPE_TASK;
+  work_item->task.task = g_object_ref (task);
+  work_item->task.func = func;
+  work_item->cancellable = g_task_get_cancellable (task);
+
+  ide_thread_pool_push_work_item (work_item);
+
   IDE_EXIT;
 }
 
 /**
- * ide_thread_pool_push:
+ * ide_thread_pool_push_task:
+ * @kind: The task kind.
+ * @task: A #GTask to execute.
+ * @func: (scope async): The thread worker to execute for @task.
+ *
+ * This pushes a task to be executed on a worker thread based on the task kind as denoted by
+ * @kind. Some tasks will be placed on special work queues or throttled based on priority.
+ *
+ * Indexer tasks are run with %IDE_THREAD_POOL_PRIORITY_BACKGROUND and all other
+ * tasks with %IDE_THREAD_POOL_PRIORITY_VISIBLE.
+ */
+void
+ide_thread_pool_push_task (IdeThreadPoolKind  kind,
+                           GTask             *task,
+                           GTaskThreadFunc    func)
+{
+  ide_thread_pool_push_task_with_priority (kind,
+                                           ide_thread_pool_get_default_priority (kind),
+                                           task,
+                                           func);
+}
+
+/**
+ * ide_thread_pool_push_with_priority:
  * @kind: the threadpool kind to use.
+ * @priority: The priority of the callback within the thread pool.
  * @func: (scope async) (closure func_data): A function to call in the worker thread.
  * @func_data: user data for @func.
  *
- * Runs the callback on the thread pool thread.
+ * Like ide_thread_pool_push() but allows specifying the priority of the callback.
  */
 void
-ide_thread_pool_push (IdeThreadPoolKind kind,
-                      IdeThreadFunc     func,
-                      gpointer          func_data)
+ide_thread_pool_push_with_priority (IdeThreadPoolKind      kind,
+                                    IdeThreadPoolPriority  priority,
+                                    IdeThreadFunc          func,
+                                    gpointer               func_data)
 {
-  GThreadPool *pool;
+  WorkItem *work_item;
 
   IDE_ENTRY;
 
   g_return_if_fail (kind >= 0);
   g_return_if_fail (kind < IDE_THREAD_POOL_LAST);
+  g_return_if_fail (priority >= 0);
+  g_return_if_fail (priority < IDE_THREAD_POOL_PRIORITY_LAST);
   g_return_if_fail (func != NULL);
 
-  EGG_COUNTER_INC (TotalTasks);
-
-  pool = ide_thread_pool_get_pool (kind);
-
-  if (pool != NULL)
-    {
-      WorkItem *work_item;
-
-      work_item = g_slice_new0 (WorkItem);
-      work_item->type = TYPE_FUNC;
-      work_item->func.callback = func;
-      work_item->func.data = func_data;
-
-      EGG_COUNTER_INC (QueuedTasks);
-
-      g_thread_pool_push (pool, work_item, NULL);
-    }
-  else
+  if (n_threads == 0)
     {
       g_critical ("No such thread pool %02x", kind);
+      IDE_EXIT;
     }
 
+  work_item = work_item_new (kind, priority);
+  work_item->type = TYPE_FUNC;
+  work_item->func.callback = func;
+  work_item->func.data = func_data;
+
+  ide_thread_pool_push_work_item (work_item);
+
   IDE_EXIT;
 }
 
-static void
-ide_thread_pool_worker (gpointer data,
-                        gpointer user_data)
+/**
+ * ide_thread_pool_push:
+ * @kind: the threadpool kind to use.
+ * @func: (scope async) (closure func_data): A function to call in the worker thread.
+ * @func_data: user data for @func.
+ *
+ * Runs the callback on the thread pool thread.
+ */
+void
+ide_thread_pool_push (IdeThreadPoolKind kind,
+                      IdeThreadFunc     func,
+                      gpointer          func_data)
 {
-  WorkItem *work_item = data;
-  gpointer source_object;
-  gpointer task_data;
-  GCancellable *cancellable;
+  ide_thread_pool_push_with_priority (kind,
+                                      ide_thread_pool_get_default_priority (kind),
+                                      func,
+                                      func_data);
+}
 
-  g_assert (work_item != NULL);
+/**
+ * ide_thread_pool_get_n_threads:
+ *
+ * Gets the number of worker threads shared by all of the thread pool kinds.
+ * This is based on the number of CPUs available to the process, including
+ * any cgroup CPU quota.
+ *
+ * Returns: the number of worker threads, or 0 if the pool is not initialized.
+ */
+guint
+ide_thread_pool_get_n_threads (void)
+{
+  return n_threads;
+}
 
-  EGG_COUNTER_DEC (QueuedTasks);
+static void
+ide_thread_pool_run (WorkItem *work_item)
+{
+  g_assert (work_item != NULL);
 
   if (work_item->type == TYPE_TASK)
     {
-      source_object = g_task_get_source_object (work_item->task.task);
-      task_data = g_task_get_task_data (work_item->task.task);
-      cancellable = g_task_get_cancellable (work_item->task.task);
+      GTask *task = work_item->task.task;
+      gpointer source_object = g_task_get_source_object (task);
+      gpointer task_data = g_task_get_task_data (task);
+      GCancellable *cancellable = g_task_get_cancellable (task);
 
-      work_item->task.func (work_item->task.task, source_object, task_data, cancellable);
+      /* Cancelled after we dequeued it, but before we disconnected */
+      if (g_task_return_error_if_cancelled (task))
+        return;
 
-      g_object_unref (work_item->task.task);
+      work_item->task.func (task, source_object, task_data, cancellable);
     }
   else if (work_item->type == TYPE_FUNC)
     {
       work_item->func.callback (work_item->func.data);
     }
-
-  g_slice_free (WorkItem, work_item);
 }
 
-void
-_ide_thread_pool_init (gboolean is_worker)
+static gpointer
+ide_thread_pool_worker (gpointer data)
 {
-  gint compiler = COMPILER_MAX_THREADS;
-  gint indexer = INDEXER_MAX_THREADS;
-  gboolean exclusive = FALSE;
+  IdeThreadPoolKind home = GPOINTER_TO_INT (data);
 
-  if (is_worker)
+  for (;;)
     {
-      compiler = 1;
-      indexer = 1;
-      exclusive = TRUE;
+      WorkItem *work_item;
+      gboolean stolen;
+
+      g_mutex_lock (&pool_mutex);
+      while (NULL == (work_item = ide_thread_pool_pop_locked (home, &stolen)))
+        g_cond_wait (&pool_cond, &pool_mutex);
+      work_item->state = STATE_RUNNING;
+      n_running [work_item->kind]++;
+      if (work_item->priority == IDE_THREAD_POOL_PRIORITY_BACKGROUND)
+        n_running_background++;
+      g_mutex_unlock (&pool_mutex);
+
+      EGG_COUNTER_DEC (QueuedTasks);
+      EGG_COUNTER_INC (RunningTasks);
+      EGG_HISTOGRAM_RECORD_SINCE (WaitTime, work_item->queued_at);
+      if (stolen)
+        EGG_COUNTER_INC (StolenTasks);
+
+      /*
+       * This must happen without holding the pool lock, as it waits for the
+       * handler to complete if it is running in another thread.
+       */
+      if (work_item->cancelled_handler != 0)
+        g_cancellable_disconnect (work_item->cancellable, work_item->cancelled_handler);
+
+      ide_thread_pool_run (work_item);
+
+      g_mutex_lock (&pool_mutex);
+      n_running [work_item->kind]--;
+      if (work_item->priority == IDE_THREAD_POOL_PRIORITY_BACKGROUND)
+        n_running_background--;
+      /* Items held back by the limits may be runnable now */
+      g_cond_signal (&pool_cond);
+      g_mutex_unlock (&pool_mutex);
+
+      EGG_COUNTER_DEC (RunningTasks);
+
+      work_item_unref (work_item);
     }
 
+  return NULL;
+}
+
+void
+_ide_thread_pool_init (gboolean is_worker)
+{
+  g_return_if_fail (n_threads == 0);
+
   /*
-   * Create our thread pool exclusive to compiler tasks (such as those from Clang).
-   * We don't want to consume threads from other GTask's such as those regarding IO so we manage
-   * these work items exclusively.
+   * Worker processes get a single thread for each kind, and run a single
+   * item of each kind at a time, so that they never compete with the UI
+   * process for the CPU.
    */
-  thread_pools [IDE_THREAD_POOL_COMPILER] = g_thread_pool_new (ide_thread_pool_worker,
-                                                               NULL,
-                                                               compiler,
-                                                               exclusive,
-                                                               NULL);
+  if (is_worker)
+    n_threads = IDE_THREAD_POOL_LAST;
+  else
+    n_threads = MAX (IDE_THREAD_POOL_LAST, ide_thread_pool_get_n_cpus ());
+
+  is_worker_pool = is_worker;
+
+  g_mutex_lock (&pool_mutex);
+  ide_thread_pool_update_limits_locked ();
+  g_mutex_unlock (&pool_mutex);
 
   /*
-   * Create our pool exclusive to things like indexing. Such examples including building of
-   * ctags indexes or highlight indexes.
+   * Give the indexer as many home workers as it may run concurrently, and
+   * the rest to the compiler. Any of them will steal work when idle.
    */
-  thread_pools [IDE_THREAD_POOL_INDEXER] = g_thread_pool_new (ide_thread_pool_worker,
-                                                              NULL,
-                                                              indexer,
-                                                              exclusive,
-                                                              NULL);
+  for (guint i = 0; i < n_threads; i++)
+    {
+      IdeThreadPoolKind home;
+      GThread *thread;
+
+      home = (i < max_running [IDE_THREAD_POOL_INDEXER]) ? IDE_THREAD_POOL_INDEXER
+                                                         : IDE_THREAD_POOL_COMPILER;
+      thread = g_thread_new ("ide-thread-pool",
+                             ide_thread_pool_worker,
+                             GINT_TO_POINTER (home));
+      g_thread_unref (thread);
+    }
+
+  IDE_TRACE_MSG ("Thread pool started with %u threads", n_threads);
 }
@@ -32,6 +32,14 @@ typedef enum
   IDE_THREAD_POOL_LAST
 } IdeThreadPoolKind;
 
+typedef enum
+{
+  IDE_THREAD_POOL_PRIORITY_INTERACTIVE,
+  IDE_THREAD_POOL_PRIORITY_VISIBLE,
+  IDE_THREAD_POOL_PRIORITY_BACKGROUND,
+  IDE_THREAD_POOL_PRIORITY_LAST
+} IdeThreadPoolPriority;
+
 /**
  * IdeThreadFunc:
  * @user_data: (closure) (transfer full): The closure for the callback.
@@ -39,12 +47,21 @@ typedef enum
  */
 typedef void (*IdeThreadFunc) (gpointer user_data);
 
-void     ide_thread_pool_push      (IdeThreadPoolKind     kind,
-                                    IdeThreadFunc         func,
-                                    gpointer              func_data);
-void     ide_thread_pool_push_task (IdeThreadPoolKind     kind,
-                                    GTask                *task,
-                                    GTaskThreadFunc       func);
+void     ide_thread_pool_push                    (IdeThreadPoolKind      kind,
+                                                  IdeThreadFunc          func,
+                                                  gpointer               func_data);
+void     ide_thread_pool_push_with_priority      (IdeThreadPoolKind      kind,
+                                                  IdeThreadPoolPriority  priority,
+                                                  IdeThreadFunc          func,
+                                                  gpointer               func_data);
+void     ide_thread_pool_push_task               (IdeThreadPoolKind      kind,
+                                                  GTask                 *task,
+                                                  GTaskThreadFunc        func);
+void     ide_thread_pool_push_task_with_priority (IdeThreadPoolKind      kind,
+                                                  IdeThreadPoolPriority  priority,
+                                                  GTask                 *task,
+                                                  GTaskThreadFunc        func);
+guint    ide_thread_pool_get_n_threads           (void);
 
 G_END_DECLS
 
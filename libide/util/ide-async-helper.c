@@ -83,3 +83,316 @@ ide_async_helper_run (gpointer             source_object,
          ide_async_helper_cb,
          g_object_ref (task));
 }
+
+/*
+ * IdeAsyncGraph is like ide_async_helper_run() except that each step declares
+ * the steps it depends upon. Every step whose dependencies have completed is
+ * started immediately, so independent steps overlap and the total time is
+ * bounded by the longest chain of dependencies rather than the sum of all
+ * steps. The time each step spent waiting and running is logged when the
+ * graph completes.
+ */
+
+typedef struct
+{
+  gchar        *name;
+  IdeAsyncStep  func;
+  GArray       *dependents;
+  guint         n_pending;
+  gint64        begin_time;
+  gint64        end_time;
+  guint         started : 1;
+  guint         completed : 1;
+} IdeAsyncGraphStep;
+
+struct _IdeAsyncGraph
+{
+  gchar  *name;
+  GArray *steps;
+  gint64  begin_time;
+  guint   n_completed;
+  guint   n_running;
+  guint   failed : 1;
+};
+
+typedef struct
+{
+  GTask *task;
+  guint  index;
+} IdeAsyncGraphClosure;
+
+static void ide_async_graph_start_step (GTask *task,
+                                        guint  index);
+
+static void
+ide_async_graph_step_clear (gpointer data)
+{
+  IdeAsyncGraphStep *step = data;
+
+  g_clear_pointer (&step->name, g_free);
+  g_clear_pointer (&step->dependents, g_array_unref);
+}
+
+IdeAsyncGraph *
+ide_async_graph_new (const gchar *name)
+{
+  IdeAsyncGraph *self;
+
+  self = g_slice_new0 (IdeAsyncGraph);
+  self->name = g_strdup (name);
+  self->steps = g_array_new (FALSE, TRUE, sizeof (IdeAsyncGraphStep));
+  g_array_set_clear_func (self->steps, ide_async_graph_step_clear);
+
+  return self;
+}
+
+void
+ide_async_graph_free (IdeAsyncGraph *self)
+{
+  if (self != NULL)
+    {
+      g_clear_pointer (&self->name, g_free);
+      g_clear_pointer (&self->steps, g_array_unref);
+      g_slice_free (IdeAsyncGraph, self);
+    }
+}
+
+/**
+ * ide_async_graph_add_step:
+ * @graph: An #IdeAsyncGraph
+ * @name: the name of the step, used for dependencies and timings
+ * @step: the function to run
+ * @first_dependency: the name of a previously added step, or %NULL
+ *
+ * Adds @step to the graph. @step will not be started until every step
+ * named in the %NULL terminated list of dependencies has completed.
+ * Dependencies must be added before the steps that depend on them, which
+ * also guarantees that the graph cannot contain cycles.
+ */
+void
+ide_async_graph_add_step (IdeAsyncGraph *self,
+                          const gchar   *name,
+                          IdeAsyncStep   step,
+                          const gchar   *first_dependency,
+                          ...)
+{
+  IdeAsyncGraphStep item = { 0 };
+  const gchar *dependency;
+  guint index;
+  va_list args;
+
+  g_return_if_fail (self != NULL);
+  g_return_if_fail (name != NULL);
+  g_return_if_fail (step != NULL);
+
+  index = self->steps->len;
+
+  item.name = g_strdup (name);
+  item.func = step;
+  item.dependents = g_array_new (FALSE, FALSE, sizeof (guint));
+
+  va_start (args, first_dependency);
+
+  for (dependency = first_dependency;
+       dependency != NULL;
+       dependency = va_arg (args, const gchar *))
+    {
+      gboolean found = FALSE;
+
+      for (guint i = 0; i < index; i++)
+        {
+          IdeAsyncGraphStep *other = &g_array_index (self->steps, IdeAsyncGraphStep, i);
+
+          if (g_strcmp0 (other->name, dependency) == 0)
+            {
+              g_array_append_val (other->dependents, index);
+              item.n_pending++;
+              found = TRUE;
+              break;
+            }
+        }
+
+      if (!found)
+        g_critical ("%s: step \"%s\" depends on unknown step \"%s\"",
+                    self->name, name, dependency);
+    }
+
+  va_end (args);
+
+  g_array_append_val (self->steps, item);
+}
+
+static void
+ide_async_graph_log_timings (IdeAsyncGraph *self)
+{
+  gint64 now = g_get_monotonic_time ();
+
+  g_assert (self != NULL);
+
+  for (guint i = 0; i < self->steps->len; i++)
+    {
+      const IdeAsyncGraphStep *step = &g_array_index (self->steps, IdeAsyncGraphStep, i);
+
+      if (!step->completed)
+        continue;
+
+      g_debug ("%s: %s waited %.3lf msec, ran %.3lf msec",
+               self->name,
+               step->name,
+               (step->begin_time - self->begin_time) / 1000.0,
+               (step->end_time - step->begin_time) / 1000.0);
+    }
+
+  g_debug ("%s: %u of %u steps completed in %.3lf msec",
+           self->name,
+           self->n_completed,
+           self->steps->len,
+           (now - self->begin_time) / 1000.0);
+}
+
+static void
+ide_async_graph_step_cb (GObject      *object,
+                         GAsyncResult *result,
+                         gpointer      user_data)
+{
+  IdeAsyncGraphClosure *closure = user_data;
+  g_autoptr(GTask) task = closure->task;
+  IdeAsyncGraphStep *step;
+  IdeAsyncGraph *self;
+  GError *error = NULL;
+  guint index = closure->index;
+
+  g_slice_free (IdeAsyncGraphClosure, closure);
+
+  g_assert (G_IS_TASK (task));
+  g_assert (G_IS_TASK (result));
+
+  self = g_task_get_task_data (task);
+  step = &g_array_index (self->steps, IdeAsyncGraphStep, index);
+
+  step->end_time = g_get_monotonic_time ();
+  self->n_running--;
+
+  if (!g_task_propagate_boolean (G_TASK (result), &error))
+    {
+      /*
+       * Only the first failure is reported. Steps that are already running
+       * are allowed to finish, but nothing new is started.
+       */
+      if (!self->failed)
+        {
+          self->failed = TRUE;
+          ide_async_graph_log_timings (self);
+          g_task_return_error (task, error);
+        }
+      else
+        g_clear_error (&error);
+
+      return;
+    }
+
+  step->completed = TRUE;
+  self->n_completed++;
+
+  if (self->failed)
+    return;
+
+  for (guint i = 0; i < step->dependents->len; i++)
+    {
+      guint dependent = g_array_index (step->dependents, guint, i);
+      IdeAsyncGraphStep *other = &g_array_index (self->steps, IdeAsyncGraphStep, dependent);
+
+      g_assert (other->n_pending > 0);
+
+      if (--other->n_pending == 0)
+        ide_async_graph_start_step (task, dependent);
+    }
+
+  if (self->n_completed == self->steps->len)
+    {
+      ide_async_graph_log_timings (self);
+      g_task_return_boolean (task, TRUE);
+    }
+}
+
+static void
+ide_async_graph_start_step (GTask *task,
+                            guint  index)
+{
+  IdeAsyncGraphClosure *closure;
+  IdeAsyncGraphStep *step;
+  IdeAsyncGraph *self;
+
+  g_assert (G_IS_TASK (task));
+
+  self = g_task_get_task_data (task);
+  step = &g_array_index (self->steps, IdeAsyncGraphStep, index);
+
+  g_assert (!step->started);
+  g_assert (step->n_pending == 0);
+
+  step->started = TRUE;
+  step->begin_time = g_get_monotonic_time ();
+  self->n_running++;
+
+  closure = g_slice_new0 (IdeAsyncGraphClosure);
+  closure->task = g_object_ref (task);
+  closure->index = index;
+
+  step->func (g_task_get_source_object (task),
+              g_task_get_cancellable (task),
+              ide_async_graph_step_cb,
+              closure);
+}
+
+/**
+ * ide_async_graph_run:
+ * @graph: (transfer full): An #IdeAsyncGraph
+ *
+ * Runs every step in @graph, starting each one as soon as its dependencies
+ * have completed. @callback is executed once all steps have completed or
+ * after the first step fails. Use g_task_propagate_boolean() to get the
+ * result. This function takes ownership of @graph.
+ */
+void
+ide_async_graph_run (IdeAsyncGraph       *self,
+                     gpointer             source_object,
+                     GCancellable        *cancellable,
+                     GAsyncReadyCallback  callback,
+                     gpointer             user_data)
+{
+  g_autoptr(GTask) task = NULL;
+  g_autoptr(GArray) ready = NULL;
+
+  g_return_if_fail (self != NULL);
+  g_return_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+  task = g_task_new (source_object, cancellable, callback, user_data);
+  g_task_set_source_tag (task, ide_async_graph_run);
+  g_task_set_task_data (task, self, (GDestroyNotify)ide_async_graph_free);
+
+  self->begin_time = g_get_monotonic_time ();
+
+  if (self->steps->len == 0)
+    {
+      g_task_return_boolean (task, TRUE);
+      return;
+    }
+
+  /*
+   * Collect the roots before starting any of them, since a step may
+   * complete synchronously and start its dependents underneath us.
+   */
+  ready = g_array_new (FALSE, FALSE, sizeof (guint));
+
+  for (guint i = 0; i < self->steps->len; i++)
+    {
+      const IdeAsyncGraphStep *step = &g_array_index (self->steps, IdeAsyncGraphStep, i);
+
+      if (step->n_pending == 0)
+        g_array_append_val (ready, i);
+    }
+
+  for (guint i = 0; i < ready->len && !self->failed; i++)
+    ide_async_graph_start_step (task, g_array_index (ready, guint, i));
+}
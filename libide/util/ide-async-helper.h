@@ -35,6 +35,21 @@ void ide_async_helper_run (gpointer             source_object,
                            IdeAsyncStep         step1,
                            ...);
 
+typedef struct _IdeAsyncGraph IdeAsyncGraph;
+
+IdeAsyncGraph *ide_async_graph_new      (const gchar          *name);
+void           ide_async_graph_free     (IdeAsyncGraph        *graph);
+void           ide_async_graph_add_step (IdeAsyncGraph        *graph,
+                                         const gchar          *name,
+                                         IdeAsyncStep          step,
+                                         const gchar          *first_dependency,
+                                         ...) G_GNUC_NULL_TERMINATED;
+void           ide_async_graph_run      (IdeAsyncGraph        *graph,
+                                         gpointer              source_object,
+                                         GCancellable         *cancellable,
+                                         GAsyncReadyCallback   callback,
+                                         gpointer              user_data);
+
 G_END_DECLS
 
 #endif /* IDE_ASYNC_HELPER_H */
@@ -0,0 +1,889 @@
+/* ide-vcs-ignore-matcher.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define G_LOG_DOMAIN "ide-vcs-ignore-matcher"
+
+#include <egg-counter.h>
+#include <string.h>
+
+#include "vcs/ide-vcs.h"
+#include "vcs/ide-vcs-ignore-matcher.h"
+
+/**
+ * SECTION:ide-vcs-ignore-matcher
+ * @title: IdeVcsIgnoreMatcher
+ * @short_description: Compiled ignore rules
+ *
+ * #IdeVcsIgnoreMatcher contains ignore rules using the syntax of gitignore
+ * files, compiled so that paths can be checked without touching the VCS.
+ *
+ * The rules of each directory are kept in their own set. Rules without any
+ * wildcard are looked up in a hashtable, and rules such as "*.o" are checked
+ * by comparing the suffix of the file name. Only the remaining rules need
+ * to be matched as a glob.
+ *
+ * A matcher is built once with ide_vcs_ignore_matcher_add_patterns() and
+ * must not be modified afterwards. Once built, it may be queried from any
+ * number of threads at the same time. Use ide_vcs_get_ignore_matcher() to
+ * get the current snapshot for a project.
+ *
+ * When only some ignore files changed, use ide_vcs_ignore_matcher_new_without()
+ * to start a new matcher from the previous one. It shares the rules of the
+ * other directories, so only the changed directories need to be read again.
+ */
+
+G_DEFINE_BOXED_TYPE (IdeVcsIgnoreMatcher, ide_vcs_ignore_matcher,
+                     ide_vcs_ignore_matcher_ref, ide_vcs_ignore_matcher_unref)
+
+typedef enum
+{
+  RULE_LITERAL,
+  RULE_SUFFIX,
+  RULE_GLOB,
+} RuleKind;
+
+typedef enum
+{
+  RESULT_NONE,
+  RESULT_IGNORED,
+  RESULT_INCLUDED,
+} MatchResult;
+
+typedef struct
+{
+  /* For RULE_SUFFIX, this is the pattern without the leading "*" */
+  gchar    *pattern;
+  gsize     len;
+  /* The previous literal rule with the same pattern, or -1 */
+  gint      prev;
+  guint     kind : 2;
+  guint     negate : 1;
+  guint     dir_only : 1;
+  guint     anchored : 1;
+} Rule;
+
+typedef struct
+{
+  volatile gint  ref_count;
+  /* The patterns the rules were compiled from, to copy the set on write */
+  GString       *source;
+  GArray        *rules;
+  GHashTable    *literals;
+  GArray        *suffixes;
+  GArray        *globs;
+} RuleSet;
+
+struct _IdeVcsIgnoreMatcher
+{
+  volatile gint  ref_count;
+  GHashTable    *directories;
+  GPtrArray     *global;
+  guint          n_rules;
+};
+
+EGG_DEFINE_COUNTER (instances, "IdeVcsIgnoreMatcher", "Instances", "Number of IdeVcsIgnoreMatcher instances")
+
+static void
+rule_clear (gpointer data)
+{
+  Rule *rule = data;
+
+  g_clear_pointer (&rule->pattern, g_free);
+}
+
+static RuleSet *
+rule_set_new (void)
+{
+  RuleSet *set;
+
+  set = g_slice_new0 (RuleSet);
+  set->ref_count = 1;
+  set->source = g_string_new (NULL);
+  set->rules = g_array_new (FALSE, FALSE, sizeof (Rule));
+  g_array_set_clear_func (set->rules, rule_clear);
+  set->literals = g_hash_table_new (g_str_hash, g_str_equal);
+  set->suffixes = g_array_new (FALSE, FALSE, sizeof (gint));
+  set->globs = g_array_new (FALSE, FALSE, sizeof (gint));
+
+  return set;
+}
+
+static RuleSet *
+rule_set_ref (RuleSet *set)
+{
+  g_atomic_int_inc (&set->ref_count);
+  return set;
+}
+
+static void
+rule_set_unref (gpointer data)
+{
+  RuleSet *set = data;
+
+  if (g_atomic_int_dec_and_test (&set->ref_count))
+    {
+      /* Keys of literals are owned by the rules */
+      g_clear_pointer (&set->literals, g_hash_table_unref);
+      g_clear_pointer (&set->rules, g_array_unref);
+      g_clear_pointer (&set->suffixes, g_array_unref);
+      g_clear_pointer (&set->globs, g_array_unref);
+      g_string_free (set->source, TRUE);
+      g_slice_free (RuleSet, set);
+    }
+}
+
+static inline gboolean
+has_wildcard (const gchar *pattern)
+{
+  return strpbrk (pattern, "*?[\\") != NULL;
+}
+
+static gboolean
+rule_set_add_line (RuleSet *set,
+                   gchar   *line)
+{
+  Rule rule = { 0 };
+  gchar *pattern = line;
+  gsize len;
+  gint index;
+
+  len = strlen (line);
+
+  if (len > 0 && line [len - 1] == '\r')
+    len--;
+
+  /* Trailing spaces are ignored unless they are escaped */
+  while (len > 0 && line [len - 1] == ' ' && !(len > 1 && line [len - 2] == '\\'))
+    len--;
+
+  line [len] = '\0';
+
+  if (len == 0 || line [0] == '#')
+    return FALSE;
+
+  if (line [0] == '!')
+    {
+      rule.negate = TRUE;
+      pattern++;
+    }
+  else if (line [0] == '\\' && (line [1] == '!' || line [1] == '#'))
+    {
+      pattern++;
+    }
+
+  len = strlen (pattern);
+
+  if (len > 0 && pattern [len - 1] == '/')
+    {
+      rule.dir_only = TRUE;
+      pattern [--len] = '\0';
+    }
+
+  /*
+   * A pattern is relative to the directory of the ignore file if it contains
+   * a slash. A leading "**" followed by a file name is the same as the file
+   * name alone, which lets us use the fast paths for it.
+   */
+  if (strncmp (pattern, "**/", 3) == 0 && strchr (pattern + 3, '/') == NULL)
+    pattern += 3;
+  else if (strchr (pattern, '/') != NULL)
+    {
+      rule.anchored = TRUE;
+      if (*pattern == '/')
+        pattern++;
+    }
+
+  if (*pattern == '\0')
+    return FALSE;
+
+  if (!has_wildcard (pattern))
+    rule.kind = RULE_LITERAL;
+  else if (!rule.anchored && pattern [0] == '*' && !has_wildcard (pattern + 1))
+    {
+      rule.kind = RULE_SUFFIX;
+      pattern++;
+    }
+  else
+    rule.kind = RULE_GLOB;
+
+  rule.pattern = g_strdup (pattern);
+  rule.len = strlen (pattern);
+  rule.prev = -1;
+
+  index = set->rules->len;
+
+  switch (rule.kind)
+    {
+    case RULE_LITERAL:
+      rule.prev = GPOINTER_TO_INT (g_hash_table_lookup (set->literals, rule.pattern)) - 1;
+      g_hash_table_insert (set->literals, rule.pattern, GINT_TO_POINTER (index + 1));
+      break;
+
+    case RULE_SUFFIX:
+      g_array_append_val (set->suffixes, index);
+      break;
+
+    case RULE_GLOB:
+    default:
+      g_array_append_val (set->globs, index);
+      break;
+    }
+
+  g_array_append_val (set->rules, rule);
+
+  return TRUE;
+}
+
+static guint
+rule_set_add_patterns (RuleSet     *set,
+                       const gchar *patterns)
+{
+  g_auto(GStrv) lines = NULL;
+  guint count = 0;
+
+  g_string_append (set->source, patterns);
+  if (set->source->len > 0 && set->source->str [set->source->len - 1] != '\n')
+    g_string_append_c (set->source, '\n');
+
+  lines = g_strsplit (patterns, "\n", 0);
+
+  for (guint i = 0; lines [i] != NULL; i++)
+    count += rule_set_add_line (set, lines [i]);
+
+  return count;
+}
+
+static gboolean
+glob_match_class (const gchar **pattern,
+                  gchar         ch)
+{
+  const gchar *p = *pattern + 1;
+  gboolean negate = FALSE;
+  gboolean matched = FALSE;
+
+  if (*p == '!' || *p == '^')
+    {
+      negate = TRUE;
+      p++;
+    }
+
+  /* A "]" right after the "[" is part of the class */
+  do
+    {
+      gchar lo = *p;
+
+      if (lo == '\0')
+        return FALSE;
+
+      if (lo == '\\' && p [1] != '\0')
+        lo = *++p;
+
+      p++;
+
+      if (p [0] == '-' && p [1] != ']' && p [1] != '\0')
+        {
+          gchar hi;
+
+          p++;
+          if (*p == '\\' && p [1] != '\0')
+            p++;
+          hi = *p++;
+
+          if (ch >= lo && ch <= hi)
+            matched = TRUE;
+        }
+      else if (ch == lo)
+        {
+          matched = TRUE;
+        }
+    }
+  while (*p != ']');
+
+  *pattern = p + 1;
+
+  return matched != negate;
+}
+
+/*
+ * Matches @string against the glob @pattern. "*", "?" and classes do not
+ * match "/", while "**" matches any number of directories.
+ */
+static gboolean
+glob_match (const gchar *pattern,
+            const gchar *string)
+{
+  const gchar *p = pattern;
+  const gchar *s = string;
+
+  for (;;)
+    {
+      switch (*p)
+        {
+        case '\0':
+          return *s == '\0';
+
+        case '*':
+          if (p [1] == '*')
+            {
+              p += 2;
+
+              /* "**" followed by a slash matches zero or more directories */
+              if (*p == '/')
+                {
+                  p++;
+
+                  for (;;)
+                    {
+                      if (glob_match (p, s))
+                        return TRUE;
+                      if (!(s = strchr (s, '/')))
+                        return FALSE;
+                      s++;
+                    }
+                }
+
+              for (;;)
+                {
+                  if (glob_match (p, s))
+                    return TRUE;
+                  if (*s++ == '\0')
+                    return FALSE;
+                }
+            }
+
+          p++;
+
+          for (;;)
+            {
+              if (glob_match (p, s))
+                return TRUE;
+              if (*s == '\0' || *s == '/')
+                return FALSE;
+              s++;
+            }
+
+        case '?':
+          if (*s == '\0' || *s == '/')
+            return FALSE;
+          p++;
+          s++;
+          break;
+
+        case '[':
+          if (*s == '\0' || *s == '/' || !glob_match_class (&p, *s))
+            return FALSE;
+          s++;
+          break;
+
+        case '\\':
+          if (p [1] != '\0')
+            p++;
+          /* fall through */
+
+        default:
+          if (*p != *s)
+            return FALSE;
+          p++;
+          s++;
+          break;
+        }
+    }
+}
+
+static inline gboolean
+rule_applies (const Rule *rule,
+              gboolean    is_directory)
+{
+  return !rule->dir_only || is_directory;
+}
+
+/*
+ * Finds the last rule of @set matching the file. @path is relative to the
+ * directory of @set and @basename points at the last component of @path.
+ */
+static const Rule *
+rule_set_match (const RuleSet *set,
+                const gchar   *path,
+                const gchar   *basename,
+                gsize          basename_len,
+                gboolean       is_directory)
+{
+  const Rule *rules = (const Rule *)(gpointer)set->rules->data;
+  gpointer value;
+  gint best = -1;
+
+  if ((value = g_hash_table_lookup (set->literals, basename)))
+    {
+      for (gint i = GPOINTER_TO_INT (value) - 1; i > best; i = rules [i].prev)
+        {
+          if (rule_applies (&rules [i], is_directory) &&
+              (!rules [i].anchored || path == basename))
+            {
+              best = i;
+              break;
+            }
+        }
+    }
+
+  if (path != basename && (value = g_hash_table_lookup (set->literals, path)))
+    {
+      for (gint i = GPOINTER_TO_INT (value) - 1; i > best; i = rules [i].prev)
+        {
+          if (rules [i].anchored && rule_applies (&rules [i], is_directory))
+            {
+              best = i;
+              break;
+            }
+        }
+    }
+
+  for (guint j = set->suffixes->len; j > 0; j--)
+    {
+      gint i = g_array_index (set->suffixes, gint, j - 1);
+      const Rule *rule = &rules [i];
+
+      if (i <= best)
+        break;
+
+      if (rule_applies (rule, is_directory) &&
+          rule->len <= basename_len &&
+          memcmp (basename + basename_len - rule->len, rule->pattern, rule->len) == 0)
+        {
+          best = i;
+          break;
+        }
+    }
+
+  for (guint j = set->globs->len; j > 0; j--)
+    {
+      gint i = g_array_index (set->globs, gint, j - 1);
+      const Rule *rule = &rules [i];
+
+      if (i <= best)
+        break;
+
+      if (rule_applies (rule, is_directory) &&
+          glob_match (rule->pattern, rule->anchored ? path : basename))
+        {
+          best = i;
+          break;
+        }
+    }
+
+  return best >= 0 ? &rules [best] : NULL;
+}
+
+static gchar *
+normalize_directory (const gchar *directory)
+{
+  gsize len;
+
+  if (directory == NULL)
+    return g_strdup ("");
+
+  while (directory [0] == '.' && directory [1] == '/')
+    directory += 2;
+
+  while (directory [0] == '/')
+    directory++;
+
+  if (directory [0] == '.' && directory [1] == '\0')
+    return g_strdup ("");
+
+  len = strlen (directory);
+  while (len > 0 && directory [len - 1] == '/')
+    len--;
+
+  return g_strndup (directory, len);
+}
+
+/**
+ * ide_vcs_ignore_matcher_new:
+ *
+ * Creates a new #IdeVcsIgnoreMatcher without any rules.
+ *
+ * Returns: (transfer full): An #IdeVcsIgnoreMatcher.
+ */
+IdeVcsIgnoreMatcher *
+ide_vcs_ignore_matcher_new (void)
+{
+  IdeVcsIgnoreMatcher *self;
+
+  self = g_slice_new0 (IdeVcsIgnoreMatcher);
+  self->ref_count = 1;
+  self->directories = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, rule_set_unref);
+  self->global = g_ptr_array_new_with_free_func (rule_set_unref);
+
+  EGG_COUNTER_INC (instances);
+
+  return self;
+}
+
+/**
+ * ide_vcs_ignore_matcher_new_without:
+ * @self: An #IdeVcsIgnoreMatcher
+ * @directory: (nullable): a directory relative to the working directory,
+ *   or %NULL for the working directory.
+ *
+ * Creates a new #IdeVcsIgnoreMatcher with the rules of @self, except those
+ * of the ignore files in @directory and below. This is useful to reload the
+ * ignore files of @directory without reading every other ignore file again.
+ *
+ * The rules are shared with @self rather than copied, and @self is not
+ * modified.
+ *
+ * Returns: (transfer full): An #IdeVcsIgnoreMatcher.
+ */
+IdeVcsIgnoreMatcher *
+ide_vcs_ignore_matcher_new_without (IdeVcsIgnoreMatcher *self,
+                                    const gchar         *directory)
+{
+  g_autofree gchar *prefix = NULL;
+  IdeVcsIgnoreMatcher *ret;
+  GHashTableIter iter;
+  gpointer key;
+  gpointer value;
+  gsize prefix_len;
+
+  g_return_val_if_fail (self != NULL, NULL);
+
+  prefix = normalize_directory (directory);
+  prefix_len = strlen (prefix);
+
+  ret = ide_vcs_ignore_matcher_new ();
+
+  for (guint i = 0; i < self->global->len; i++)
+    {
+      RuleSet *set = g_ptr_array_index (self->global, i);
+
+      g_ptr_array_add (ret->global, rule_set_ref (set));
+      ret->n_rules += set->rules->len;
+    }
+
+  g_hash_table_iter_init (&iter, self->directories);
+
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      const gchar *path = key;
+      RuleSet *set = value;
+
+      if (prefix_len == 0 ||
+          (strncmp (path, prefix, prefix_len) == 0 &&
+           (path [prefix_len] == '\0' || path [prefix_len] == '/')))
+        continue;
+
+      g_hash_table_insert (ret->directories, g_strdup (path), rule_set_ref (set));
+      ret->n_rules += set->rules->len;
+    }
+
+  return ret;
+}
+
+/**
+ * ide_vcs_ignore_matcher_ref:
+ *
+ * Increments the reference count of @self by one.
+ *
+ * Returns: (transfer full): @self
+ */
+IdeVcsIgnoreMatcher *
+ide_vcs_ignore_matcher_ref (IdeVcsIgnoreMatcher *self)
+{
+  g_return_val_if_fail (self != NULL, NULL);
+  g_return_val_if_fail (self->ref_count > 0, NULL);
+
+  g_atomic_int_inc (&self->ref_count);
+
+  return self;
+}
+
+/**
+ * ide_vcs_ignore_matcher_unref:
+ *
+ * Decrements the reference count of @self by one. If the reference count
+ * reaches zero, then the structure is freed.
+ */
+void
+ide_vcs_ignore_matcher_unref (IdeVcsIgnoreMatcher *self)
+{
+  g_return_if_fail (self != NULL);
+  g_return_if_fail (self->ref_count > 0);
+
+  if (g_atomic_int_dec_and_test (&self->ref_count))
+    {
+      g_clear_pointer (&self->directories, g_hash_table_unref);
+      g_clear_pointer (&self->global, g_ptr_array_unref);
+      g_slice_free (IdeVcsIgnoreMatcher, self);
+
+      EGG_COUNTER_DEC (instances);
+    }
+}
+
+/**
+ * ide_vcs_ignore_matcher_add_patterns:
+ * @self: An #IdeVcsIgnoreMatcher
+ * @directory: (nullable): the directory containing the ignore file,
+ *   relative to the working directory, or %NULL for the working directory.
+ * @patterns: the contents of the ignore file
+ *
+ * Adds the rules of an ignore file such as .gitignore. Rules of files in
+ * deeper directories take precedence over the rules of their parents, and
+ * later rules take precedence over earlier rules of the same directory.
+ */
+void
+ide_vcs_ignore_matcher_add_patterns (IdeVcsIgnoreMatcher *self,
+                                     const gchar         *directory,
+                                     const gchar         *patterns)
+{
+  g_autofree gchar *key = NULL;
+  RuleSet *set;
+
+  g_return_if_fail (self != NULL);
+  g_return_if_fail (patterns != NULL);
+
+  key = normalize_directory (directory);
+
+  if (!(set = g_hash_table_lookup (self->directories, key)))
+    {
+      set = rule_set_new ();
+      g_hash_table_insert (self->directories, g_steal_pointer (&key), set);
+    }
+  else if (g_atomic_int_get (&set->ref_count) > 1)
+    {
+      RuleSet *copy;
+
+      /* Shared with another matcher by ide_vcs_ignore_matcher_new_without() */
+      copy = rule_set_new ();
+      rule_set_add_patterns (copy, set->source->str);
+      g_hash_table_insert (self->directories, g_steal_pointer (&key), copy);
+      set = copy;
+    }
+
+  self->n_rules += rule_set_add_patterns (set, patterns);
+}
+
+/**
+ * ide_vcs_ignore_matcher_add_global_patterns:
+ * @self: An #IdeVcsIgnoreMatcher
+ * @patterns: the contents of the ignore file
+ *
+ * Adds rules that apply to the whole working directory, such as those of
+ * .git/info/exclude or core.excludesFile. These have less precedence than
+ * any of the rules added with ide_vcs_ignore_matcher_add_patterns(), and
+ * each call has less precedence than the previous one.
+ */
+void
+ide_vcs_ignore_matcher_add_global_patterns (IdeVcsIgnoreMatcher *self,
+                                            const gchar         *patterns)
+{
+  RuleSet *set;
+
+  g_return_if_fail (self != NULL);
+  g_return_if_fail (patterns != NULL);
+
+  set = rule_set_new ();
+  g_ptr_array_add (self->global, set);
+
+  self->n_rules += rule_set_add_patterns (set, patterns);
+}
+
+/*
+ * Checks a single path, ignoring whether its parents are excluded. @path
+ * must be writable as parent directories are looked up in place.
+ */
+static MatchResult
+ide_vcs_ignore_matcher_match (IdeVcsIgnoreMatcher *self,
+                              gchar               *path,
+                              gsize                len,
+                              gboolean             is_directory)
+{
+  const gchar *basename;
+  gsize basename_len;
+  gsize dir_end;
+
+  basename = path + len;
+  while (basename > path && basename [-1] != '/')
+    basename--;
+  basename_len = path + len - basename;
+  dir_end = basename - path;
+
+  /* Start from the deepest directory, which has precedence */
+  while (g_hash_table_size (self->directories) > 0)
+    {
+      const RuleSet *set;
+      const Rule *rule;
+
+      if (dir_end == 0)
+        {
+          set = g_hash_table_lookup (self->directories, "");
+        }
+      else
+        {
+          path [dir_end - 1] = '\0';
+          set = g_hash_table_lookup (self->directories, path);
+          path [dir_end - 1] = '/';
+        }
+
+      if (set != NULL &&
+          (rule = rule_set_match (set, path + dir_end, basename, basename_len, is_directory)))
+        return rule->negate ? RESULT_INCLUDED : RESULT_IGNORED;
+
+      if (dir_end == 0)
+        break;
+
+      dir_end--;
+      while (dir_end > 0 && path [dir_end - 1] != '/')
+        dir_end--;
+    }
+
+  for (guint i = 0; i < self->global->len; i++)
+    {
+      const RuleSet *set = g_ptr_array_index (self->global, i);
+      const Rule *rule;
+
+      if ((rule = rule_set_match (set, path, basename, basename_len, is_directory)))
+        return rule->negate ? RESULT_INCLUDED : RESULT_IGNORED;
+    }
+
+  return RESULT_NONE;
+}
+
+/**
+ * ide_vcs_ignore_matcher_is_ignored:
+ * @self: An #IdeVcsIgnoreMatcher
+ * @relative_path: a path relative to the working directory
+ * @is_directory: if @relative_path is a directory
+ *
+ * Checks if @relative_path is ignored. Like git, a file within an ignored
+ * directory is ignored even if a rule would include it again.
+ *
+ * This function is thread-safe.
+ *
+ * Returns: %TRUE if @relative_path is ignored.
+ */
+gboolean
+ide_vcs_ignore_matcher_is_ignored (IdeVcsIgnoreMatcher *self,
+                                   const gchar         *relative_path,
+                                   gboolean             is_directory)
+{
+  g_autofree gchar *heap_path = NULL;
+  gchar stack_path [256];
+  gchar *path;
+  gsize len;
+
+  g_return_val_if_fail (self != NULL, FALSE);
+  g_return_val_if_fail (relative_path != NULL, FALSE);
+
+  if (self->n_rules == 0)
+    return FALSE;
+
+  while (*relative_path == '/')
+    relative_path++;
+
+  len = strlen (relative_path);
+
+  while (len > 0 && relative_path [len - 1] == '/')
+    {
+      is_directory = TRUE;
+      len--;
+    }
+
+  if (len == 0)
+    return FALSE;
+
+  if (len < sizeof stack_path)
+    path = stack_path;
+  else
+    path = heap_path = g_malloc (len + 1);
+
+  memcpy (path, relative_path, len);
+  path [len] = '\0';
+
+  for (gsize i = 0; i <= len; i++)
+    {
+      if (i == len || path [i] == '/')
+        {
+          MatchResult result;
+
+          path [i] = '\0';
+          result = ide_vcs_ignore_matcher_match (self, path, i, is_directory || i < len);
+          if (i < len)
+            path [i] = '/';
+
+          if (result == RESULT_IGNORED)
+            return TRUE;
+        }
+    }
+
+  return FALSE;
+}
+
+/**
+ * ide_vcs_ignore_matcher_is_file_ignored:
+ * @self: (nullable): An #IdeVcsIgnoreMatcher or %NULL
+ * @vcs: An #IdeVcs
+ * @relative_path: (nullable): the path of @file relative to the working
+ *   directory, or %NULL if unknown.
+ * @file: a #GFile
+ * @is_directory: if @file is a directory
+ *
+ * Checks if @file is ignored. This is meant for code crawling the project
+ * tree, which already knows the type of each file. When both @self and
+ * @relative_path are available, the VCS is not involved at all. Otherwise
+ * this falls back to ide_vcs_is_ignored().
+ *
+ * Returns: %TRUE if @file is ignored.
+ */
+gboolean
+ide_vcs_ignore_matcher_is_file_ignored (IdeVcsIgnoreMatcher *self,
+                                        IdeVcs              *vcs,
+                                        const gchar         *relative_path,
+                                        GFile               *file,
+                                        gboolean             is_directory)
+{
+  g_return_val_if_fail (IDE_IS_VCS (vcs), FALSE);
+  g_return_val_if_fail (G_IS_FILE (file), FALSE);
+
+  if (self != NULL && relative_path != NULL)
+    return ide_vcs_ignore_matcher_is_ignored (self, relative_path, is_directory);
+
+  return ide_vcs_is_ignored (vcs, file, NULL);
+}
+
+/**
+ * ide_vcs_ignore_matcher_build_path:
+ * @relative_path: (nullable): a directory relative to the working directory,
+ *   or %NULL or "" for the working directory.
+ * @name: the name of a child of @relative_path
+ *
+ * Builds the relative path of the child @name of @relative_path, to be used
+ * with ide_vcs_ignore_matcher_is_file_ignored() while crawling a tree.
+ *
+ * Returns: (transfer full): A newly allocated string.
+ */
+gchar *
+ide_vcs_ignore_matcher_build_path (const gchar *relative_path,
+                                   const gchar *name)
+{
+  g_return_val_if_fail (name != NULL, NULL);
+
+  if (relative_path == NULL || *relative_path == '\0')
+    return g_strdup (name);
+
+  return g_build_filename (relative_path, name, NULL);
+}
@@ -0,0 +1,56 @@
+/* ide-vcs-ignore-matcher.h
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IDE_VCS_IGNORE_MATCHER_H
+#define IDE_VCS_IGNORE_MATCHER_H
+
+#include <gio/gio.h>
+
+#include "ide-types.h"
+
+G_BEGIN_DECLS
+
+#define IDE_TYPE_VCS_IGNORE_MATCHER (ide_vcs_ignore_matcher_get_type())
+
+GType                ide_vcs_ignore_matcher_get_type            (void);
+IdeVcsIgnoreMatcher *ide_vcs_ignore_matcher_new                 (void);
+IdeVcsIgnoreMatcher *ide_vcs_ignore_matcher_new_without         (IdeVcsIgnoreMatcher *self,
+                                                                 const gchar         *directory);
+IdeVcsIgnoreMatcher *ide_vcs_ignore_matcher_ref                 (IdeVcsIgnoreMatcher *self);
+void                 ide_vcs_ignore_matcher_unref               (IdeVcsIgnoreMatcher *self);
+void                 ide_vcs_ignore_matcher_add_patterns        (IdeVcsIgnoreMatcher *self,
+                                                                 const gchar         *directory,
+                                                                 const gchar         *patterns);
+void                 ide_vcs_ignore_matcher_add_global_patterns (IdeVcsIgnoreMatcher *self,
+                                                                 const gchar         *patterns);
+gboolean             ide_vcs_ignore_matcher_is_ignored          (IdeVcsIgnoreMatcher *self,
+                                                                 const gchar         *relative_path,
+                                                                 gboolean             is_directory);
+gboolean             ide_vcs_ignore_matcher_is_file_ignored     (IdeVcsIgnoreMatcher *self,
+                                                                 IdeVcs              *vcs,
+                                                                 const gchar         *relative_path,
+                                                                 GFile               *file,
+                                                                 gboolean             is_directory);
+gchar               *ide_vcs_ignore_matcher_build_path          (const gchar         *relative_path,
+                                                                 const gchar         *name);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (IdeVcsIgnoreMatcher, ide_vcs_ignore_matcher_unref)
+
+G_END_DECLS
+
+#endif /* IDE_VCS_IGNORE_MATCHER_H */
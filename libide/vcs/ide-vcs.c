@@ -240,3 +240,28 @@ ide_vcs_get_branch_name (IdeVcs *self)
 
   return g_strdup ("primary");
 }
+
+/**
+ * ide_vcs_get_ignore_matcher:
+ * @self: An #IdeVcs
+ *
+ * Gets a snapshot of the ignore rules of the VCS. Unlike ide_vcs_is_ignored(),
+ * the snapshot may be used from any thread, and is cheap enough to check every
+ * file while walking the whole working directory.
+ *
+ * The snapshot does not change. Use the #IdeVcs::changed signal to know when
+ * to get a new one.
+ *
+ * Returns: (transfer full) (nullable): An #IdeVcsIgnoreMatcher, or %NULL if
+ *   the VCS does not support it. In that case, use ide_vcs_is_ignored().
+ */
+IdeVcsIgnoreMatcher *
+ide_vcs_get_ignore_matcher (IdeVcs *self)
+{
+  g_return_val_if_fail (IDE_IS_VCS (self), NULL);
+
+  if (IDE_VCS_GET_IFACE (self)->get_ignore_matcher)
+    return IDE_VCS_GET_IFACE (self)->get_ignore_matcher (self);
+
+  return NULL;
+}
@@ -23,6 +23,7 @@
 
 #include "ide-object.h"
 #include "ide-vcs-config.h"
+#include "ide-vcs-ignore-matcher.h"
 
 G_BEGIN_DECLS
 
@@ -44,6 +45,7 @@ struct _IdeVcsInterface
   void                    (*changed)                   (IdeVcs     *self);
   IdeVcsConfig           *(*get_config)                (IdeVcs     *self);
   gchar                  *(*get_branch_name)           (IdeVcs     *self);
+  IdeVcsIgnoreMatcher    *(*get_ignore_matcher)        (IdeVcs     *self);
 };
 
 IdeBufferChangeMonitor *ide_vcs_get_buffer_change_monitor (IdeVcs               *self,
@@ -63,6 +65,7 @@ gint                    ide_vcs_get_priority              (IdeVcs
 void                    ide_vcs_emit_changed              (IdeVcs               *self);
 IdeVcsConfig           *ide_vcs_get_config                (IdeVcs               *self);
 gchar                  *ide_vcs_get_branch_name           (IdeVcs               *self);
+IdeVcsIgnoreMatcher    *ide_vcs_get_ignore_matcher        (IdeVcs               *self);
 
 G_END_DECLS
 
@@ -986,17 +986,84 @@ simple_make_command_cb (GObject      *object,
     g_task_return_boolean (task, TRUE);
 }
 
+typedef struct
+{
+  IdeSubprocessLauncher *launcher;
+  gchar                 *target;
+} SimpleMake;
+
+static void
+simple_make_free (gpointer data)
+{
+  SimpleMake *state = data;
+
+  g_clear_object (&state->launcher);
+  g_clear_pointer (&state->target, g_free);
+  g_slice_free (SimpleMake, state);
+}
+
+static void
+simple_make_resolve_cb (GObject      *object,
+                        GAsyncResult *result,
+                        gpointer      user_data)
+{
+  IdeRuntime *runtime = (IdeRuntime *)object;
+  g_autoptr(GTask) task = user_data;
+  g_autoptr(GHashTable) programs = NULL;
+  g_autoptr(IdeSubprocess) subprocess = NULL;
+  GCancellable *cancellable;
+  SimpleMake *state;
+  GError *error = NULL;
+
+  g_assert (IDE_IS_RUNTIME (runtime));
+  g_assert (G_IS_ASYNC_RESULT (result));
+  g_assert (G_IS_TASK (task));
+
+  if (NULL == (programs = ide_runtime_resolve_programs_finish (runtime, result, &error)))
+    {
+      g_task_return_error (task, error);
+      return;
+    }
+
+  state = g_task_get_task_data (task);
+  cancellable = g_task_get_cancellable (task);
+
+  if (g_hash_table_contains (programs, "gmake"))
+    ide_subprocess_launcher_push_argv (state->launcher, "gmake");
+  else
+    ide_subprocess_launcher_push_argv (state->launcher, "make");
+
+  ide_subprocess_launcher_push_argv (state->launcher, state->target);
+
+  g_task_set_return_on_cancel (task, FALSE);
+
+  if (g_task_return_error_if_cancelled (task))
+    return;
+
+  if (NULL == (subprocess = ide_subprocess_launcher_spawn (state->launcher, cancellable, &error)))
+    {
+      g_task_return_error (task, error);
+      return;
+    }
+
+  ide_subprocess_wait_check_async (subprocess,
+                                   cancellable,
+                                   simple_make_command_cb,
+                                   g_steal_pointer (&task));
+}
+
 static void
 simple_make_command (GFile            *directory,
                      const gchar      *target,
                      GTask            *task,
                      IdeConfiguration *configuration)
 {
+  static const gchar * const programs [] = { "gmake", "make", NULL };
   g_autoptr(IdeSubprocessLauncher) launcher = NULL;
-  g_autoptr(IdeSubprocess) subprocess = NULL;
   g_autofree gchar *cwd = NULL;
   GCancellable *cancellable;
   IdeRuntime *runtime;
+  SimpleMake *state;
   GError *error = NULL;
 
   g_assert (G_IS_FILE (directory));
@@ -1033,28 +1100,17 @@ simple_make_command (GFile            *directory,
   cwd = g_file_get_path (directory);
   ide_subprocess_launcher_set_cwd (launcher, cwd);
 
-  if (ide_runtime_contains_program_in_path (runtime, "gmake", cancellable))
-    ide_subprocess_launcher_push_argv (launcher, "gmake");
-  else
-    ide_subprocess_launcher_push_argv (launcher, "make");
-
-  ide_subprocess_launcher_push_argv (launcher, target);
-
-  g_task_set_return_on_cancel (task, FALSE);
-
-  if (g_task_return_error_if_cancelled (task))
-    return;
+  state = g_slice_new0 (SimpleMake);
+  state->launcher = g_steal_pointer (&launcher);
+  state->target = g_strdup (target);
+  g_task_set_task_data (task, state, simple_make_free);
 
-  if (NULL == (subprocess = ide_subprocess_launcher_spawn (launcher, cancellable, &error)))
-    {
-      g_task_return_error (task, error);
-      return;
-    }
-
-  ide_subprocess_wait_check_async (subprocess,
-                                   cancellable,
-                                   simple_make_command_cb,
-                                   g_object_ref (task));
+  /* Resolving make is cached by the runtime, so this rarely spawns. */
+  ide_runtime_resolve_programs_async (runtime,
+                                      programs,
+                                      cancellable,
+                                      simple_make_resolve_cb,
+                                      g_object_ref (task));
 }
 
 static void
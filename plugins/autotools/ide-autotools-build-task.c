@@ -51,6 +51,7 @@ typedef struct
   gchar                 *project_path;
   gchar                 *parallel;
   gchar                 *system_type;
+  gchar                 *make;
   gchar                **configure_argv;
   gchar                **make_targets;
   IdeRuntime            *runtime;
@@ -112,6 +113,7 @@ static WorkStep workSteps [] = {
   step_make_all,
   NULL
 };
+static const gchar * const make_programs [] = { "gmake", "make", NULL };
 
 gboolean
 ide_autotools_build_task_get_require_autogen (IdeAutotoolsBuildTask *self)
@@ -558,6 +560,7 @@ worker_state_free (void *data)
   g_free (state->project_path);
   g_free (state->system_type);
   g_free (state->parallel);
+  g_free (state->make);
   g_strfreev (state->configure_argv);
   g_strfreev (state->make_targets);
   g_clear_object (&state->runtime);
@@ -603,6 +606,42 @@ ide_autotools_build_task_execute_worker (GTask        *task,
   g_task_return_boolean (task, TRUE);
 }
 
+static void
+ide_autotools_build_task_resolve_make_cb (GObject      *object,
+                                          GAsyncResult *result,
+                                          gpointer      user_data)
+{
+  IdeRuntime *runtime = (IdeRuntime *)object;
+  g_autoptr(GTask) task = user_data;
+  g_autoptr(GHashTable) programs = NULL;
+  WorkerState *state;
+  GError *error = NULL;
+
+  IDE_ENTRY;
+
+  g_assert (IDE_IS_RUNTIME (runtime));
+  g_assert (G_IS_ASYNC_RESULT (result));
+  g_assert (G_IS_TASK (task));
+
+  if (NULL == (programs = ide_runtime_resolve_programs_finish (runtime, result, &error)))
+    {
+      g_task_return_error (task, error);
+      IDE_EXIT;
+    }
+
+  state = g_task_get_task_data (task);
+
+  /* Prefer GNU make when the runtime provides both. */
+  if (g_hash_table_contains (programs, "gmake"))
+    state->make = g_strdup ("gmake");
+  else if (g_hash_table_contains (programs, "make"))
+    state->make = g_strdup ("make");
+
+  g_task_run_in_thread (task, ide_autotools_build_task_execute_worker);
+
+  IDE_EXIT;
+}
+
 static void
 ide_autotools_build_task_configuration_prebuild_cb (GObject      *object,
                                                     GAsyncResult *result,
@@ -611,6 +650,7 @@ ide_autotools_build_task_configuration_prebuild_cb (GObject      *object,
   IdeBuildCommandQueue *cmdq = (IdeBuildCommandQueue *)object;
   g_autoptr(GTask) task = user_data;
   IdeAutotoolsBuildTask *self;
+  WorkerState *state;
   GError *error = NULL;
 
   IDE_ENTRY;
@@ -628,7 +668,17 @@ ide_autotools_build_task_configuration_prebuild_cb (GObject      *object,
       IDE_EXIT;
     }
 
-  g_task_run_in_thread (task, ide_autotools_build_task_execute_worker);
+  /*
+   * Locate make before entering the worker so that the runtime can resolve
+   * (and cache) it without blocking the build thread on a subprocess.
+   */
+  state = g_task_get_task_data (task);
+
+  ide_runtime_resolve_programs_async (state->runtime,
+                                      make_programs,
+                                      g_task_get_cancellable (task),
+                                      ide_autotools_build_task_resolve_make_cb,
+                                      g_steal_pointer (&task));
 
   IDE_EXIT;
 }
@@ -1178,12 +1228,10 @@ step_make_all  (GTask                 *task,
   ide_subprocess_launcher_setenv (launcher, "LANG", "C", TRUE);
 
   /*
-   * Try to locate GNU make within the runtime.
+   * GNU make was located within the runtime before the worker started.
    */
-  if (ide_runtime_contains_program_in_path (state->runtime, "gmake", cancellable))
-    make = "gmake";
-  else if (ide_runtime_contains_program_in_path (state->runtime, "make", cancellable))
-    make = "make";
+  if (state->make != NULL)
+    make = state->make;
   else
     {
       g_task_return_new_error (task,
@@ -328,6 +328,69 @@ ide_clang_completion_item_get_icon_name (GtkSourceCompletionProposal *proposal)
   return self->icon_name;
 }
 
+/*
+ * The .gir documentation is keyed by the C identifier of functions and by
+ * the C type name of types. Anything else, such as locals, fields or C++
+ * members, could only match an unrelated symbol with the same name.
+ */
+static gboolean
+is_gir_documented (IdeClangCompletionItem *self,
+                   const gchar            *typed_text)
+{
+  CXCompletionResult *result;
+
+  g_assert (IDE_IS_CLANG_COMPLETION_ITEM (self));
+
+  if (typed_text == NULL || !(g_ascii_isalpha (*typed_text) || *typed_text == '_'))
+    return FALSE;
+
+  for (const gchar *iter = typed_text; *iter; iter++)
+    {
+      if (!g_ascii_isalnum (*iter) && *iter != '_')
+        return FALSE;
+    }
+
+  result = ide_clang_completion_item_get_result (self);
+
+  switch ((int)result->CursorKind)
+    {
+    case CXCursor_FunctionDecl:
+    case CXCursor_StructDecl:
+    case CXCursor_UnionDecl:
+    case CXCursor_TypedefDecl:
+    case CXCursor_EnumDecl:
+      return TRUE;
+
+    default:
+      return FALSE;
+    }
+}
+
+static gchar *
+ide_clang_completion_item_get_info (GtkSourceCompletionProposal *proposal)
+{
+  IdeClangCompletionItem *self = (IdeClangCompletionItem *)proposal;
+  const gchar *brief_comment;
+  const gchar *typed_text;
+
+  g_assert (IDE_IS_CLANG_COMPLETION_ITEM (self));
+
+  brief_comment = ide_clang_completion_item_get_brief_comment (self);
+  if (!ide_str_empty0 (brief_comment))
+    return g_strdup (brief_comment);
+
+  /*
+   * Fallback to the documentation of introspected libraries. We don't know
+   * which namespace version the project uses, so only exact C identifiers
+   * of functions and types are looked up.
+   */
+  typed_text = ide_clang_completion_item_get_typed_text (self);
+  if (is_gir_documented (self, typed_text))
+    return ide_gir_doc_index_lookup (ide_gir_doc_index_get_default (), typed_text, NULL);
+
+  return NULL;
+}
+
 static void
 ide_clang_completion_item_finalize (GObject *object)
 {
@@ -394,6 +457,7 @@ completion_proposal_iface_init (GtkSourceCompletionProposalIface *iface)
 {
   iface->get_icon_name = ide_clang_completion_item_get_icon_name;
   iface->get_markup = ide_clang_completion_item_get_markup;
+  iface->get_info = ide_clang_completion_item_get_info;
 }
 
 static void
@@ -66,6 +66,10 @@ EGG_DEFINE_COUNTER (ParseAttempts,
                     "Clang",
                     "Total Parse Attempts",
                     "Total number of attempts to create a translation unit.")
+EGG_DEFINE_HISTOGRAM (ParseTime,
+                      "Clang",
+                      "Parse Time",
+                      "Time to create a translation unit.")
 
 static void
 parse_request_free (gpointer data)
@@ -263,6 +267,7 @@ ide_clang_service_parse_worker (GTask        *task,
   const gchar *llvm_flags;
   enum CXErrorCode code;
   GArray *ar = NULL;
+  gint64 begin_time;
   gsize i;
 
   g_assert (G_IS_TASK (task));
@@ -304,6 +309,7 @@ ide_clang_service_parse_worker (GTask        *task,
   g_ptr_array_add (built_argv, NULL);
 
   EGG_COUNTER_INC (ParseAttempts);
+  begin_time = g_get_monotonic_time ();
   code = clang_parseTranslationUnit2 (request->index,
                                       request->source_filename,
                                       (const gchar * const *)built_argv->pdata,
@@ -312,6 +318,7 @@ ide_clang_service_parse_worker (GTask        *task,
                                       ar->len,
                                       request->options,
                                       &tu);
+  EGG_HISTOGRAM_RECORD_SINCE (ParseTime, begin_time);
 
   switch (code)
     {
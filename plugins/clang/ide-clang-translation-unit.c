@@ -741,9 +741,10 @@ ide_clang_translation_unit_code_complete_async (IdeClangTranslationUnit *self,
 
   g_task_set_task_data (task, state, code_complete_state_free);
 
-  ide_thread_pool_push_task (IDE_THREAD_POOL_COMPILER,
-                             task,
-                             ide_clang_translation_unit_code_complete_worker);
+  ide_thread_pool_push_task_with_priority (IDE_THREAD_POOL_COMPILER,
+                                           IDE_THREAD_POOL_PRIORITY_INTERACTIVE,
+                                           task,
+                                           ide_clang_translation_unit_code_complete_worker);
 
   IDE_EXIT;
 }
@@ -257,6 +257,9 @@ text_inserted_cb (GbColorPickerDocumentMonitor *self,
   g_assert (GTK_IS_TEXT_BUFFER (buffer));
   g_assert (cursor != NULL);
 
+  if (ide_buffer_get_in_bulk_edit (IDE_BUFFER (buffer)))
+    return;
+
   tag = gb_color_picker_helper_get_tag_at_iter (cursor, &color, &begin, &end);
   if (tag != NULL )
     {
@@ -282,6 +285,9 @@ text_inserted_after_cb (GbColorPickerDocumentMonitor *self,
   g_assert (GTK_IS_TEXT_BUFFER (buffer));
   g_assert (iter != NULL);
 
+  if (ide_buffer_get_in_bulk_edit (IDE_BUFFER (buffer)))
+    return;
+
   begin = *iter;
   offset = gtk_text_iter_get_offset (&begin);
   gtk_text_iter_set_offset (&begin, offset - len);
@@ -331,6 +337,9 @@ text_deleted_cb (GbColorPickerDocumentMonitor *self,
   g_assert (GB_IS_COLOR_PICKER_DOCUMENT_MONITOR (self));
   g_assert (GTK_IS_TEXT_BUFFER (buffer));
 
+  if (ide_buffer_get_in_bulk_edit (IDE_BUFFER (buffer)))
+    return;
+
   self->remove_tag_handler_id = g_signal_connect_object (GTK_TEXT_BUFFER (self->buffer),
                                                          "remove-tag",
                                                          G_CALLBACK (remove_tag_cb),
@@ -363,6 +372,34 @@ text_deleted_after_cb (GbColorPickerDocumentMonitor *self,
   g_assert (begin != NULL);
   g_assert (end != NULL);
 
+  if (ide_buffer_get_in_bulk_edit (IDE_BUFFER (buffer)))
+    return;
+
+  recolor_begin = *begin;
+  gtk_text_iter_set_line_offset (&recolor_begin, 0);
+
+  recolor_end = *end;
+  if (!gtk_text_iter_ends_line (&recolor_end))
+    gtk_text_iter_forward_to_line_end (&recolor_end);
+
+  gb_color_picker_document_monitor_colorize (self, &recolor_begin, &recolor_end);
+}
+
+static void
+bulk_edit_finished_cb (GbColorPickerDocumentMonitor *self,
+                       const GtkTextIter            *begin,
+                       const GtkTextIter            *end,
+                       IdeBuffer                    *buffer)
+{
+  GtkTextIter recolor_begin;
+  GtkTextIter recolor_end;
+
+  g_assert (GB_IS_COLOR_PICKER_DOCUMENT_MONITOR (self));
+  g_assert (IDE_IS_BUFFER (buffer));
+  g_assert (begin != NULL);
+  g_assert (end != NULL);
+
+  /* Recolor the whole lines touched by the bulk edit in a single pass */
   recolor_begin = *begin;
   gtk_text_iter_set_line_offset (&recolor_begin, 0);
 
@@ -370,6 +407,7 @@ text_deleted_after_cb (GbColorPickerDocumentMonitor *self,
   if (!gtk_text_iter_ends_line (&recolor_end))
     gtk_text_iter_forward_to_line_end (&recolor_end);
 
+  gb_color_picker_document_monitor_uncolorize (self, &recolor_begin, &recolor_end);
   gb_color_picker_document_monitor_colorize (self, &recolor_begin, &recolor_end);
 }
 
@@ -431,6 +469,12 @@ start_monitor (GbColorPickerDocumentMonitor *self)
                                                            self,
                                                            G_CONNECT_SWAPPED | G_CONNECT_AFTER);
 
+  g_signal_connect_object (self->buffer,
+                           "bulk-edit-finished",
+                           G_CALLBACK (bulk_edit_finished_cb),
+                           self,
+                           G_CONNECT_SWAPPED);
+
   self->cursor_notify_handler_id = g_signal_connect_object (GTK_TEXT_BUFFER (self->buffer),
                                                             "notify::cursor-position",
                                                             G_CALLBACK (cursor_moved_cb),
@@ -447,6 +491,7 @@ stop_monitor (GbColorPickerDocumentMonitor *self)
   g_signal_handlers_disconnect_by_func (self->buffer, text_inserted_after_cb, self);
   g_signal_handlers_disconnect_by_func (self->buffer, text_deleted_cb, self);
   g_signal_handlers_disconnect_by_func (self->buffer, text_deleted_after_cb, self);
+  g_signal_handlers_disconnect_by_func (self->buffer, bulk_edit_finished_cb, self);
   g_signal_handlers_disconnect_by_func (self->buffer, cursor_moved_cb, self);
 }
 
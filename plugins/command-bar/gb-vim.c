@@ -973,6 +973,10 @@ gb_vim_do_search_and_replace (GtkTextBuffer *buffer,
   gtk_source_search_settings_set_search_text (search_settings, search_text);
   gtk_source_search_settings_set_case_sensitive (search_settings, TRUE);
 
+  /* Let buffer listeners process all of the replacements at once */
+  if (IDE_IS_BUFFER (buffer))
+    ide_buffer_begin_bulk_edit (IDE_BUFFER (buffer));
+
   while (gtk_source_search_context_forward2 (search_context,
                                              begin,
                                              &match_begin,
@@ -995,6 +999,9 @@ gb_vim_do_search_and_replace (GtkTextBuffer *buffer,
       gtk_text_buffer_get_iter_at_mark (buffer, end, mark);
     }
 
+  if (IDE_IS_BUFFER (buffer))
+    ide_buffer_end_bulk_edit (IDE_BUFFER (buffer));
+
   gtk_text_buffer_delete_mark (buffer, mark);
 
   g_clear_object (&search_settings);
@@ -0,0 +1,1088 @@
+/* gbp-devhelp-book-index.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define G_LOG_DOMAIN "gbp-devhelp-book-index"
+
+#include <egg-counter.h>
+#include <errno.h>
+#include <fuzzy.h>
+#include <glib/gstdio.h>
+#include <string.h>
+
+#include "gbp-devhelp-book-index.h"
+#include "gbp-devhelp-search-result.h"
+
+/*
+ * The keyword cache contains one entry per book file. Each entry stores
+ * the path and mtime of the book so that we only need to parse books that
+ * were installed or changed since the cache was written.
+ *
+ *   (version, [(path, mtime, title, base, [(name, link)])])
+ */
+#define CACHE_VERSION 1
+#define CACHE_FORMAT  "(ua(sxssa(ss)))"
+#define BOOK_FORMAT   "(sxssa(ss))"
+
+typedef struct
+{
+  const gchar *title;
+  const gchar *base;
+} Book;
+
+typedef struct
+{
+  const gchar *link;
+  guint        book;
+} Keyword;
+
+typedef struct
+{
+  Fuzzy         *fuzzy;
+  GStringChunk  *strings;
+  GArray        *book_info;
+  GArray        *keywords;
+  guint          needs_refresh : 1;
+} LoadState;
+
+typedef struct
+{
+  gchar           *title;
+  gchar           *base;
+  GVariantBuilder  keywords;
+} ParseState;
+
+struct _GbpDevhelpBookIndex
+{
+  GObject        parent_instance;
+
+  /* Only created once a sidebar needs it, see load_books_async() */
+  DhBookManager *books;
+  GPtrArray     *books_waiting;
+
+  /* Keyword name to GUINT_TO_POINTER (index + 1) within keywords */
+  Fuzzy         *fuzzy;
+  GStringChunk  *strings;
+  GArray        *book_info;
+  GArray        *keywords;
+
+  /* Tasks waiting for the initial load to complete */
+  GPtrArray     *waiting;
+
+  guint          loading : 1;
+  guint          loaded : 1;
+  guint          refreshing : 1;
+  guint          loading_books : 1;
+};
+
+G_DEFINE_TYPE (GbpDevhelpBookIndex, gbp_devhelp_book_index, G_TYPE_OBJECT)
+
+EGG_DEFINE_COUNTER (keywords_count, "Devhelp", "Keywords", "Number of keywords in the book index")
+EGG_DEFINE_COUNTER (books_parsed, "Devhelp", "Books Parsed", "Number of books parsed instead of loaded from cache")
+
+static void
+load_state_free (gpointer data)
+{
+  LoadState *state = data;
+
+  g_clear_pointer (&state->fuzzy, fuzzy_unref);
+  g_clear_pointer (&state->strings, g_string_chunk_free);
+  g_clear_pointer (&state->book_info, g_array_unref);
+  g_clear_pointer (&state->keywords, g_array_unref);
+  g_slice_free (LoadState, state);
+}
+
+static gchar *
+get_cache_path (void)
+{
+  return g_build_filename (g_get_user_cache_dir (),
+                           ide_get_program_name (),
+                           "devhelp",
+                           "keywords.gvariant",
+                           NULL);
+}
+
+static void
+find_books_in_dir (const gchar *path,
+                   GHashTable  *seen,
+                   GPtrArray   *book_files)
+{
+  static const gchar *suffixes[] = { ".devhelp2", ".devhelp2.gz", ".devhelp", ".devhelp.gz", NULL };
+  g_autoptr(GDir) dir = NULL;
+  const gchar *name;
+
+  g_assert (path != NULL);
+  g_assert (seen != NULL);
+  g_assert (book_files != NULL);
+
+  if (NULL == (dir = g_dir_open (path, 0, NULL)))
+    return;
+
+  while (NULL != (name = g_dir_read_name (dir)))
+    {
+      /* Books in earlier directories take precedence, like devhelp. */
+      if (g_hash_table_contains (seen, name))
+        continue;
+
+      for (guint i = 0; suffixes [i]; i++)
+        {
+          g_autofree gchar *filename = g_strconcat (name, suffixes [i], NULL);
+          g_autofree gchar *book_path = g_build_filename (path, name, filename, NULL);
+
+          if (g_file_test (book_path, G_FILE_TEST_IS_REGULAR))
+            {
+              g_hash_table_add (seen, g_strdup (name));
+              g_ptr_array_add (book_files, g_steal_pointer (&book_path));
+              break;
+            }
+        }
+    }
+}
+
+static GPtrArray *
+find_books (void)
+{
+  g_autoptr(GHashTable) seen = NULL;
+  const gchar * const *data_dirs;
+  GPtrArray *book_files;
+
+  seen = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  book_files = g_ptr_array_new_with_free_func (g_free);
+  data_dirs = g_get_system_data_dirs ();
+
+  {
+    g_autofree gchar *gtkdoc = g_build_filename (g_get_user_data_dir (), "gtk-doc", "html", NULL);
+    g_autofree gchar *books = g_build_filename (g_get_user_data_dir (), "devhelp", "books", NULL);
+
+    find_books_in_dir (gtkdoc, seen, book_files);
+    find_books_in_dir (books, seen, book_files);
+  }
+
+  for (guint i = 0; data_dirs [i]; i++)
+    {
+      g_autofree gchar *gtkdoc = g_build_filename (data_dirs [i], "gtk-doc", "html", NULL);
+      g_autofree gchar *books = g_build_filename (data_dirs [i], "devhelp", "books", NULL);
+
+      find_books_in_dir (gtkdoc, seen, book_files);
+      find_books_in_dir (books, seen, book_files);
+    }
+
+  return book_files;
+}
+
+static gboolean
+read_book_contents (const gchar  *path,
+                    GBytes      **contents,
+                    GError      **error)
+{
+  g_autoptr(GFile) file = NULL;
+  g_autoptr(GInputStream) stream = NULL;
+  g_autoptr(GOutputStream) memory = NULL;
+
+  g_assert (path != NULL);
+  g_assert (contents != NULL);
+
+  file = g_file_new_for_path (path);
+
+  if (NULL == (stream = G_INPUT_STREAM (g_file_read (file, NULL, error))))
+    return FALSE;
+
+  if (g_str_has_suffix (path, ".gz"))
+    {
+      g_autoptr(GZlibDecompressor) decompressor = NULL;
+      GInputStream *converter;
+
+      decompressor = g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_GZIP);
+      converter = g_converter_input_stream_new (stream, G_CONVERTER (decompressor));
+      g_object_unref (stream);
+      stream = converter;
+    }
+
+  memory = g_memory_output_stream_new_resizable ();
+
+  if (g_output_stream_splice (memory,
+                              stream,
+                              (G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE |
+                               G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET),
+                              NULL,
+                              error) < 0)
+    return FALSE;
+
+  *contents = g_memory_output_stream_steal_as_bytes (G_MEMORY_OUTPUT_STREAM (memory));
+
+  return TRUE;
+}
+
+static gchar *
+normalize_keyword (const gchar *name)
+{
+  static const gchar *prefixes[] = { "struct ", "union ", "enum ", NULL };
+  gchar *ret;
+  gsize len;
+
+  g_assert (name != NULL);
+
+  for (guint i = 0; prefixes [i]; i++)
+    {
+      if (g_str_has_prefix (name, prefixes [i]))
+        {
+          name += strlen (prefixes [i]);
+          break;
+        }
+    }
+
+  ret = g_strdup (name);
+  len = strlen (ret);
+
+  /* Functions are listed as "g_list_append ()" */
+  if (len > 3 && strcmp (ret + len - 3, " ()") == 0)
+    ret [len - 3] = '\0';
+
+  return g_strstrip (ret);
+}
+
+static void
+parse_start_element (GMarkupParseContext  *context,
+                     const gchar          *element_name,
+                     const gchar         **attribute_names,
+                     const gchar         **attribute_values,
+                     gpointer              user_data,
+                     GError              **error)
+{
+  ParseState *state = user_data;
+  const gchar *name = NULL;
+  const gchar *link = NULL;
+
+  g_assert (state != NULL);
+
+  if (g_str_equal (element_name, "book"))
+    {
+      for (guint i = 0; attribute_names [i]; i++)
+        {
+          if (g_str_equal (attribute_names [i], "title"))
+            {
+              g_free (state->title);
+              state->title = g_strdup (attribute_values [i]);
+            }
+          else if (g_str_equal (attribute_names [i], "base"))
+            {
+              g_free (state->base);
+              state->base = g_strdup (attribute_values [i]);
+            }
+        }
+
+      return;
+    }
+
+  /* "keyword" is used by .devhelp2 and "function" by .devhelp files */
+  if (!g_str_equal (element_name, "keyword") && !g_str_equal (element_name, "function"))
+    return;
+
+  for (guint i = 0; attribute_names [i]; i++)
+    {
+      if (g_str_equal (attribute_names [i], "name"))
+        name = attribute_values [i];
+      else if (g_str_equal (attribute_names [i], "link"))
+        link = attribute_values [i];
+    }
+
+  if (name != NULL && link != NULL && *link != '\0')
+    {
+      g_autofree gchar *normalized = normalize_keyword (name);
+
+      if (*normalized != '\0')
+        g_variant_builder_add (&state->keywords, "(ss)", normalized, link);
+    }
+}
+
+static const GMarkupParser book_parser = {
+  parse_start_element,
+};
+
+static GVariant *
+parse_book (const gchar  *path,
+            gint64        mtime,
+            GError      **error)
+{
+  g_autoptr(GMarkupParseContext) context = NULL;
+  g_autoptr(GBytes) contents = NULL;
+  g_autofree gchar *dirname = NULL;
+  ParseState state = { 0 };
+  GVariant *ret;
+
+  g_assert (path != NULL);
+
+  if (!read_book_contents (path, &contents, error))
+    return NULL;
+
+  g_variant_builder_init (&state.keywords, G_VARIANT_TYPE ("a(ss)"));
+
+  context = g_markup_parse_context_new (&book_parser, 0, &state, NULL);
+
+  if (!g_markup_parse_context_parse (context,
+                                     g_bytes_get_data (contents, NULL),
+                                     g_bytes_get_size (contents),
+                                     error) ||
+      !g_markup_parse_context_end_parse (context, error))
+    {
+      g_variant_builder_clear (&state.keywords);
+      g_free (state.title);
+      g_free (state.base);
+      return NULL;
+    }
+
+  /* Links are relative to the book directory unless a base is provided */
+  dirname = g_path_get_dirname (path);
+
+  ret = g_variant_new ("(sxss@a(ss))",
+                       path,
+                       mtime,
+                       state.title ? state.title : "",
+                       state.base ? state.base : dirname,
+                       g_variant_builder_end (&state.keywords));
+
+  g_free (state.title);
+  g_free (state.base);
+
+  return g_variant_ref_sink (ret);
+}
+
+static GHashTable *
+load_cache (const gchar *cache_path)
+{
+  g_autoptr(GVariant) variant = NULL;
+  g_autoptr(GVariant) books = NULL;
+  g_autoptr(GMappedFile) mapped = NULL;
+  g_autoptr(GBytes) bytes = NULL;
+  GHashTable *ret;
+  GVariantIter iter;
+  GVariant *book;
+  guint32 version = 0;
+
+  g_assert (cache_path != NULL);
+
+  ret = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, (GDestroyNotify)g_variant_unref);
+
+  if (NULL == (mapped = g_mapped_file_new (cache_path, FALSE, NULL)))
+    return ret;
+
+  bytes = g_mapped_file_get_bytes (mapped);
+  variant = g_variant_new_from_bytes (G_VARIANT_TYPE (CACHE_FORMAT), bytes, FALSE);
+  g_variant_ref_sink (variant);
+
+  /* Don't trust a truncated or otherwise corrupt cache */
+  if (!g_variant_is_normal_form (variant))
+    return ret;
+
+  g_variant_get (variant, "(u@a" BOOK_FORMAT ")", &version, &books);
+
+  if (version != CACHE_VERSION)
+    return ret;
+
+  g_variant_iter_init (&iter, books);
+
+  /* The path is the first member of the tuple and lives as long as @book */
+  while ((book = g_variant_iter_next_value (&iter)))
+    {
+      const gchar *path = NULL;
+
+      g_variant_get_child (book, 0, "&s", &path);
+      g_hash_table_insert (ret, (gchar *)path, book);
+    }
+
+  return ret;
+}
+
+static void
+save_cache (const gchar *cache_path,
+            GPtrArray   *books)
+{
+  g_autoptr(GVariant) variant = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *dirname = NULL;
+  GVariantBuilder builder;
+
+  g_assert (cache_path != NULL);
+  g_assert (books != NULL);
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a" BOOK_FORMAT));
+  for (guint i = 0; i < books->len; i++)
+    g_variant_builder_add_value (&builder, g_ptr_array_index (books, i));
+
+  variant = g_variant_new ("(u@a" BOOK_FORMAT ")",
+                           CACHE_VERSION,
+                           g_variant_builder_end (&builder));
+  g_variant_ref_sink (variant);
+
+  dirname = g_path_get_dirname (cache_path);
+
+  if (g_mkdir_with_parents (dirname, 0750) != 0 ||
+      !g_file_set_contents (cache_path,
+                            g_variant_get_data (variant),
+                            g_variant_get_size (variant),
+                            &error))
+    g_warning ("Failed to save devhelp keyword cache: %s",
+               error ? error->message : g_strerror (errno));
+}
+
+/*
+ * Finds the installed books and returns their keywords, parsing only the
+ * books that are not in @cached or changed since. Updates the cache file
+ * and sets @changed if the result differs from @cached.
+ */
+static GPtrArray *
+scan_books (const gchar *cache_path,
+            GHashTable  *cached,
+            gboolean    *changed)
+{
+  g_autoptr(GPtrArray) book_files = NULL;
+  GPtrArray *books;
+  gboolean dirty = FALSE;
+  guint n_cached;
+
+  g_assert (cache_path != NULL);
+  g_assert (cached != NULL);
+  g_assert (changed != NULL);
+
+  n_cached = g_hash_table_size (cached);
+  book_files = find_books ();
+  books = g_ptr_array_new_with_free_func ((GDestroyNotify)g_variant_unref);
+
+  for (guint i = 0; i < book_files->len; i++)
+    {
+      const gchar *path = g_ptr_array_index (book_files, i);
+      g_autoptr(GError) error = NULL;
+      GVariant *book;
+      GStatBuf st;
+      gint64 mtime = 0;
+
+      if (g_stat (path, &st) == 0)
+        mtime = st.st_mtime;
+
+      book = g_hash_table_lookup (cached, path);
+
+      if (book != NULL)
+        {
+          gint64 cached_mtime = 0;
+
+          g_variant_get_child (book, 1, "x", &cached_mtime);
+
+          if (cached_mtime == mtime)
+            {
+              g_ptr_array_add (books, g_variant_ref (book));
+              continue;
+            }
+        }
+
+      dirty = TRUE;
+
+      EGG_COUNTER_INC (books_parsed);
+
+      if (NULL == (book = parse_book (path, mtime, &error)))
+        {
+          g_debug ("Failed to parse %s: %s", path, error->message);
+          continue;
+        }
+
+      g_ptr_array_add (books, book);
+    }
+
+  /* Books were removed since the cache was written */
+  if (books->len != n_cached)
+    dirty = TRUE;
+
+  if (dirty)
+    save_cache (cache_path, books);
+
+  *changed = dirty;
+
+  return books;
+}
+
+static LoadState *
+load_state_new (GPtrArray *books)
+{
+  LoadState *state;
+
+  g_assert (books != NULL);
+
+  state = g_slice_new0 (LoadState);
+  state->strings = g_string_chunk_new (4096 * 4);
+  state->book_info = g_array_new (FALSE, FALSE, sizeof (Book));
+  state->keywords = g_array_new (FALSE, FALSE, sizeof (Keyword));
+  state->fuzzy = fuzzy_new (FALSE);
+
+  fuzzy_begin_bulk_insert (state->fuzzy);
+
+  for (guint i = 0; i < books->len; i++)
+    {
+      GVariant *book = g_ptr_array_index (books, i);
+      g_autoptr(GVariant) keywords = NULL;
+      const gchar *title = NULL;
+      const gchar *base = NULL;
+      const gchar *name = NULL;
+      const gchar *link = NULL;
+      GVariantIter iter;
+      Book info;
+
+      g_variant_get (book, "(&sx&s&s@a(ss))", NULL, NULL, &title, &base, &keywords);
+
+      info.title = g_string_chunk_insert_const (state->strings, title);
+      info.base = g_string_chunk_insert_const (state->strings, base);
+      g_array_append_val (state->book_info, info);
+
+      g_variant_iter_init (&iter, keywords);
+
+      while (g_variant_iter_next (&iter, "(&s&s)", &name, &link))
+        {
+          Keyword keyword;
+
+          keyword.link = g_string_chunk_insert (state->strings, link);
+          keyword.book = state->book_info->len - 1;
+          g_array_append_val (state->keywords, keyword);
+
+          fuzzy_insert (state->fuzzy, name, GUINT_TO_POINTER (state->keywords->len));
+        }
+    }
+
+  fuzzy_end_bulk_insert (state->fuzzy);
+
+  return state;
+}
+
+/*
+ * Builds the index from the keyword cache alone, so searching does not
+ * have to wait for the book directories to be crawled. Only when there is
+ * no cache yet are the books scanned right away.
+ */
+static void
+gbp_devhelp_book_index_load_worker (GTask        *task,
+                                    gpointer      source_object,
+                                    gpointer      task_data,
+                                    GCancellable *cancellable)
+{
+  g_autoptr(GPtrArray) books = NULL;
+  g_autoptr(GHashTable) cached = NULL;
+  g_autofree gchar *cache_path = NULL;
+  LoadState *state;
+
+  IDE_ENTRY;
+
+  g_assert (G_IS_TASK (task));
+  g_assert (GBP_IS_DEVHELP_BOOK_INDEX (source_object));
+
+  cache_path = get_cache_path ();
+  cached = load_cache (cache_path);
+
+  if (g_hash_table_size (cached) > 0)
+    {
+      GHashTableIter iter;
+      gpointer value;
+
+      books = g_ptr_array_new_with_free_func ((GDestroyNotify)g_variant_unref);
+
+      g_hash_table_iter_init (&iter, cached);
+      while (g_hash_table_iter_next (&iter, NULL, &value))
+        g_ptr_array_add (books, g_variant_ref (value));
+
+      state = load_state_new (books);
+      state->needs_refresh = TRUE;
+    }
+  else
+    {
+      gboolean changed;
+
+      books = scan_books (cache_path, cached, &changed);
+      state = load_state_new (books);
+    }
+
+  g_task_return_pointer (task, state, load_state_free);
+
+  IDE_EXIT;
+}
+
+/*
+ * Checks the cached keywords against the installed books. Returns a new
+ * index if some books were installed, changed or removed, or %NULL if the
+ * cache was up to date.
+ */
+static void
+gbp_devhelp_book_index_refresh_worker (GTask        *task,
+                                       gpointer      source_object,
+                                       gpointer      task_data,
+                                       GCancellable *cancellable)
+{
+  g_autoptr(GPtrArray) books = NULL;
+  g_autoptr(GHashTable) cached = NULL;
+  g_autofree gchar *cache_path = NULL;
+  gboolean changed = FALSE;
+
+  IDE_ENTRY;
+
+  g_assert (G_IS_TASK (task));
+  g_assert (GBP_IS_DEVHELP_BOOK_INDEX (source_object));
+
+  cache_path = get_cache_path ();
+  cached = load_cache (cache_path);
+  books = scan_books (cache_path, cached, &changed);
+
+  if (changed)
+    g_task_return_pointer (task, load_state_new (books), load_state_free);
+  else
+    g_task_return_pointer (task, NULL, NULL);
+
+  IDE_EXIT;
+}
+
+static void
+gbp_devhelp_book_index_apply (GbpDevhelpBookIndex *self,
+                              LoadState           *state)
+{
+  g_assert (GBP_IS_DEVHELP_BOOK_INDEX (self));
+  g_assert (state != NULL);
+
+  if (self->keywords != NULL)
+    EGG_COUNTER_SUB (keywords_count, self->keywords->len);
+
+  g_clear_pointer (&self->fuzzy, fuzzy_unref);
+  g_clear_pointer (&self->strings, g_string_chunk_free);
+  g_clear_pointer (&self->book_info, g_array_unref);
+  g_clear_pointer (&self->keywords, g_array_unref);
+
+  self->fuzzy = g_steal_pointer (&state->fuzzy);
+  self->strings = g_steal_pointer (&state->strings);
+  self->book_info = g_steal_pointer (&state->book_info);
+  self->keywords = g_steal_pointer (&state->keywords);
+
+  EGG_COUNTER_ADD (keywords_count, self->keywords->len);
+}
+
+static void
+gbp_devhelp_book_index_refresh_cb (GObject      *object,
+                                   GAsyncResult *result,
+                                   gpointer      user_data)
+{
+  GbpDevhelpBookIndex *self = (GbpDevhelpBookIndex *)object;
+  g_autoptr(GError) error = NULL;
+  LoadState *state;
+
+  IDE_ENTRY;
+
+  g_assert (GBP_IS_DEVHELP_BOOK_INDEX (self));
+  g_assert (G_IS_TASK (result));
+
+  self->refreshing = FALSE;
+
+  if (NULL != (state = g_task_propagate_pointer (G_TASK (result), &error)))
+    {
+      gbp_devhelp_book_index_apply (self, state);
+      load_state_free (state);
+    }
+
+  IDE_EXIT;
+}
+
+static void
+gbp_devhelp_book_index_refresh (GbpDevhelpBookIndex *self)
+{
+  g_autoptr(GTask) task = NULL;
+
+  g_assert (GBP_IS_DEVHELP_BOOK_INDEX (self));
+
+  if (self->refreshing)
+    return;
+
+  self->refreshing = TRUE;
+
+  task = g_task_new (self, NULL, gbp_devhelp_book_index_refresh_cb, NULL);
+  g_task_set_source_tag (task, gbp_devhelp_book_index_refresh);
+  ide_thread_pool_push_task_with_priority (IDE_THREAD_POOL_INDEXER,
+                                           IDE_THREAD_POOL_PRIORITY_BACKGROUND,
+                                           task,
+                                           gbp_devhelp_book_index_refresh_worker);
+}
+
+static void
+gbp_devhelp_book_index_load_cb (GObject      *object,
+                                GAsyncResult *result,
+                                gpointer      user_data)
+{
+  GbpDevhelpBookIndex *self = (GbpDevhelpBookIndex *)object;
+  g_autoptr(GPtrArray) waiting = NULL;
+  g_autoptr(GError) error = NULL;
+  LoadState *state;
+
+  IDE_ENTRY;
+
+  g_assert (GBP_IS_DEVHELP_BOOK_INDEX (self));
+  g_assert (G_IS_TASK (result));
+
+  self->loading = FALSE;
+  waiting = g_steal_pointer (&self->waiting);
+
+  if (NULL != (state = g_task_propagate_pointer (G_TASK (result), &error)))
+    {
+      gbp_devhelp_book_index_apply (self, state);
+      self->loaded = TRUE;
+
+      if (state->needs_refresh)
+        gbp_devhelp_book_index_refresh (self);
+
+      load_state_free (state);
+    }
+
+  for (guint i = 0; i < waiting->len; i++)
+    {
+      GTask *task = g_ptr_array_index (waiting, i);
+
+      if (error != NULL)
+        g_task_return_error (task, g_error_copy (error));
+      else
+        g_task_return_boolean (task, TRUE);
+    }
+
+  IDE_EXIT;
+}
+
+/**
+ * gbp_devhelp_book_index_load_async:
+ *
+ * Loads the book index on a worker thread. The index is only loaded once
+ * per process; subsequent calls complete as soon as the first load has.
+ *
+ * The index is first loaded from the keyword cache and then updated in
+ * the background with books that were installed, changed or removed.
+ */
+void
+gbp_devhelp_book_index_load_async (GbpDevhelpBookIndex *self,
+                                   GCancellable        *cancellable,
+                                   GAsyncReadyCallback  callback,
+                                   gpointer             user_data)
+{
+  g_autoptr(GTask) task = NULL;
+
+  g_return_if_fail (GBP_IS_DEVHELP_BOOK_INDEX (self));
+  g_return_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_source_tag (task, gbp_devhelp_book_index_load_async);
+
+  if (self->loaded)
+    {
+      g_task_return_boolean (task, TRUE);
+      return;
+    }
+
+  if (self->waiting == NULL)
+    self->waiting = g_ptr_array_new_with_free_func (g_object_unref);
+  g_ptr_array_add (self->waiting, g_steal_pointer (&task));
+
+  if (!self->loading)
+    {
+      g_autoptr(GTask) load = NULL;
+
+      self->loading = TRUE;
+
+      load = g_task_new (self, NULL, gbp_devhelp_book_index_load_cb, NULL);
+      g_task_set_source_tag (load, gbp_devhelp_book_index_load_worker);
+      ide_thread_pool_push_task_with_priority (IDE_THREAD_POOL_INDEXER,
+                                               IDE_THREAD_POOL_PRIORITY_BACKGROUND,
+                                               load,
+                                               gbp_devhelp_book_index_load_worker);
+    }
+}
+
+gboolean
+gbp_devhelp_book_index_load_finish (GbpDevhelpBookIndex  *self,
+                                    GAsyncResult         *result,
+                                    GError              **error)
+{
+  g_return_val_if_fail (GBP_IS_DEVHELP_BOOK_INDEX (self), FALSE);
+  g_return_val_if_fail (G_IS_TASK (result), FALSE);
+
+  return g_task_propagate_boolean (G_TASK (result), error);
+}
+
+gboolean
+gbp_devhelp_book_index_get_loaded (GbpDevhelpBookIndex *self)
+{
+  g_return_val_if_fail (GBP_IS_DEVHELP_BOOK_INDEX (self), FALSE);
+
+  return self->loaded;
+}
+
+/**
+ * gbp_devhelp_book_index_get_book_manager:
+ *
+ * Gets the book manager used by the sidebars, once it has been loaded with
+ * gbp_devhelp_book_index_load_books_async(). Searching uses the keyword
+ * index instead.
+ *
+ * Returns: (transfer none) (nullable): A #DhBookManager or %NULL.
+ */
+DhBookManager *
+gbp_devhelp_book_index_get_book_manager (GbpDevhelpBookIndex *self)
+{
+  g_return_val_if_fail (GBP_IS_DEVHELP_BOOK_INDEX (self), NULL);
+
+  return self->books;
+}
+
+static void
+gbp_devhelp_book_index_load_books_worker (GTask        *task,
+                                          gpointer      source_object,
+                                          gpointer      task_data,
+                                          GCancellable *cancellable)
+{
+  DhBookManager *books;
+
+  IDE_ENTRY;
+
+  g_assert (G_IS_TASK (task));
+  g_assert (GBP_IS_DEVHELP_BOOK_INDEX (source_object));
+
+  /*
+   * This thread has no thread-default main context, so the directory
+   * monitors created while populating dispatch to the default main context
+   * and the manager can be used from the main thread afterwards.
+   */
+  books = dh_book_manager_new ();
+  dh_book_manager_populate (books);
+
+  g_task_return_pointer (task, books, g_object_unref);
+
+  IDE_EXIT;
+}
+
+static void
+gbp_devhelp_book_index_load_books_cb (GObject      *object,
+                                      GAsyncResult *result,
+                                      gpointer      user_data)
+{
+  GbpDevhelpBookIndex *self = (GbpDevhelpBookIndex *)object;
+  g_autoptr(GPtrArray) waiting = NULL;
+
+  IDE_ENTRY;
+
+  g_assert (GBP_IS_DEVHELP_BOOK_INDEX (self));
+  g_assert (G_IS_TASK (result));
+
+  self->loading_books = FALSE;
+  waiting = g_steal_pointer (&self->books_waiting);
+
+  g_clear_object (&self->books);
+  self->books = g_task_propagate_pointer (G_TASK (result), NULL);
+
+  g_assert (DH_IS_BOOK_MANAGER (self->books));
+
+  for (guint i = 0; i < waiting->len; i++)
+    g_task_return_boolean (g_ptr_array_index (waiting, i), TRUE);
+
+  IDE_EXIT;
+}
+
+/**
+ * gbp_devhelp_book_index_load_books_async:
+ *
+ * Creates the book manager used by the sidebars on a worker thread, since
+ * it parses every installed book. The manager is only created once per
+ * process; subsequent calls complete as soon as it is available from
+ * gbp_devhelp_book_index_get_book_manager().
+ */
+void
+gbp_devhelp_book_index_load_books_async (GbpDevhelpBookIndex *self,
+                                         GCancellable        *cancellable,
+                                         GAsyncReadyCallback  callback,
+                                         gpointer             user_data)
+{
+  g_autoptr(GTask) task = NULL;
+
+  g_return_if_fail (GBP_IS_DEVHELP_BOOK_INDEX (self));
+  g_return_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_source_tag (task, gbp_devhelp_book_index_load_books_async);
+
+  if (self->books != NULL)
+    {
+      g_task_return_boolean (task, TRUE);
+      return;
+    }
+
+  if (self->books_waiting == NULL)
+    self->books_waiting = g_ptr_array_new_with_free_func (g_object_unref);
+  g_ptr_array_add (self->books_waiting, g_steal_pointer (&task));
+
+  if (!self->loading_books)
+    {
+      g_autoptr(GTask) load = NULL;
+
+      self->loading_books = TRUE;
+
+      /*
+       * The user is waiting on the panel, so don't queue this behind
+       * background work on the indexer pool.
+       */
+      load = g_task_new (self, NULL, gbp_devhelp_book_index_load_books_cb, NULL);
+      g_task_set_source_tag (load, gbp_devhelp_book_index_load_books_worker);
+      g_task_run_in_thread (load, gbp_devhelp_book_index_load_books_worker);
+    }
+}
+
+gboolean
+gbp_devhelp_book_index_load_books_finish (GbpDevhelpBookIndex  *self,
+                                          GAsyncResult         *result,
+                                          GError              **error)
+{
+  g_return_val_if_fail (GBP_IS_DEVHELP_BOOK_INDEX (self), FALSE);
+  g_return_val_if_fail (G_IS_TASK (result), FALSE);
+
+  return g_task_propagate_boolean (G_TASK (result), error);
+}
+
+static gchar *
+create_uri (const Book    *book,
+            const Keyword *keyword)
+{
+  g_autofree gchar *path = NULL;
+  g_autofree gchar *uri = NULL;
+  const gchar *fragment;
+
+  g_assert (book != NULL);
+  g_assert (keyword != NULL);
+
+  if (NULL != (fragment = strchr (keyword->link, '#')))
+    {
+      g_autofree gchar *relative = g_strndup (keyword->link, fragment - keyword->link);
+      path = g_build_filename (book->base, relative, NULL);
+    }
+  else
+    path = g_build_filename (book->base, keyword->link, NULL);
+
+  if (NULL == (uri = g_filename_to_uri (path, NULL, NULL)))
+    return NULL;
+
+  if (fragment != NULL)
+    return g_strconcat (uri, fragment, NULL);
+
+  return g_steal_pointer (&uri);
+}
+
+void
+gbp_devhelp_book_index_populate (GbpDevhelpBookIndex *self,
+                                 IdeSearchContext    *context,
+                                 IdeSearchProvider   *provider,
+                                 const gchar         *query)
+{
+  g_autoptr(GArray) ar = NULL;
+  g_auto(IdeSearchReducer) reducer = { 0 };
+  IdeContext *icontext;
+  gsize max_matches;
+
+  g_return_if_fail (GBP_IS_DEVHELP_BOOK_INDEX (self));
+  g_return_if_fail (IDE_IS_SEARCH_CONTEXT (context));
+  g_return_if_fail (IDE_IS_SEARCH_PROVIDER (provider));
+  g_return_if_fail (query != NULL);
+
+  if (self->fuzzy == NULL)
+    return;
+
+  icontext = ide_object_get_context (IDE_OBJECT (provider));
+  max_matches = ide_search_context_get_max_results (context);
+  ide_search_reducer_init (&reducer, context, provider, max_matches);
+
+  ar = fuzzy_match (self->fuzzy, query, max_matches);
+
+  for (guint i = 0; i < ar->len; i++)
+    {
+      const FuzzyMatch *match = &g_array_index (ar, FuzzyMatch, i);
+
+      if (ide_search_reducer_accepts (&reducer, match->score))
+        {
+          g_autoptr(GbpDevhelpSearchResult) result = NULL;
+          g_autofree gchar *markup = NULL;
+          g_autofree gchar *uri = NULL;
+          const Keyword *keyword;
+          const Book *book;
+
+          keyword = &g_array_index (self->keywords, Keyword, GPOINTER_TO_UINT (match->value) - 1);
+          book = &g_array_index (self->book_info, Book, keyword->book);
+
+          if (NULL == (uri = create_uri (book, keyword)))
+            continue;
+
+          markup = ide_completion_item_fuzzy_highlight (match->key, query);
+          result = g_object_new (GBP_TYPE_DEVHELP_SEARCH_RESULT,
+                                 "context", icontext,
+                                 "provider", provider,
+                                 "score", match->score,
+                                 "title", markup,
+                                 "subtitle", book->title,
+                                 "uri", uri,
+                                 NULL);
+          ide_search_reducer_push (&reducer, IDE_SEARCH_RESULT (result));
+        }
+    }
+}
+
+static void
+gbp_devhelp_book_index_finalize (GObject *object)
+{
+  GbpDevhelpBookIndex *self = (GbpDevhelpBookIndex *)object;
+
+  g_clear_object (&self->books);
+  g_clear_pointer (&self->fuzzy, fuzzy_unref);
+  g_clear_pointer (&self->strings, g_string_chunk_free);
+  g_clear_pointer (&self->book_info, g_array_unref);
+  g_clear_pointer (&self->keywords, g_array_unref);
+  g_clear_pointer (&self->waiting, g_ptr_array_unref);
+  g_clear_pointer (&self->books_waiting, g_ptr_array_unref);
+
+  G_OBJECT_CLASS (gbp_devhelp_book_index_parent_class)->finalize (object);
+}
+
+static void
+gbp_devhelp_book_index_class_init (GbpDevhelpBookIndexClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = gbp_devhelp_book_index_finalize;
+}
+
+static void
+gbp_devhelp_book_index_init (GbpDevhelpBookIndex *self)
+{
+}
+
+/**
+ * gbp_devhelp_book_index_get_default:
+ *
+ * Gets the book index shared by every workbench and search provider in
+ * the process.
+ *
+ * Returns: (transfer none): A #GbpDevhelpBookIndex.
+ */
+GbpDevhelpBookIndex *
+gbp_devhelp_book_index_get_default (void)
+{
+  static GbpDevhelpBookIndex *instance;
+
+  if (instance == NULL)
+    instance = g_object_new (GBP_TYPE_DEVHELP_BOOK_INDEX, NULL);
+
+  return instance;
+}
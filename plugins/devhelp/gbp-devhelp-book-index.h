@@ -0,0 +1,55 @@
+/* gbp-devhelp-book-index.h
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GBP_DEVHELP_BOOK_INDEX_H
+#define GBP_DEVHELP_BOOK_INDEX_H
+
+#include <devhelp/devhelp.h>
+#include <ide.h>
+
+G_BEGIN_DECLS
+
+#define GBP_TYPE_DEVHELP_BOOK_INDEX (gbp_devhelp_book_index_get_type())
+
+G_DECLARE_FINAL_TYPE (GbpDevhelpBookIndex, gbp_devhelp_book_index, GBP, DEVHELP_BOOK_INDEX, GObject)
+
+GbpDevhelpBookIndex *gbp_devhelp_book_index_get_default       (void);
+gboolean             gbp_devhelp_book_index_get_loaded        (GbpDevhelpBookIndex  *self);
+DhBookManager       *gbp_devhelp_book_index_get_book_manager  (GbpDevhelpBookIndex  *self);
+void                 gbp_devhelp_book_index_load_async        (GbpDevhelpBookIndex  *self,
+                                                               GCancellable         *cancellable,
+                                                               GAsyncReadyCallback   callback,
+                                                               gpointer              user_data);
+gboolean             gbp_devhelp_book_index_load_finish       (GbpDevhelpBookIndex  *self,
+                                                               GAsyncResult         *result,
+                                                               GError              **error);
+void                 gbp_devhelp_book_index_load_books_async  (GbpDevhelpBookIndex  *self,
+                                                               GCancellable         *cancellable,
+                                                               GAsyncReadyCallback   callback,
+                                                               gpointer              user_data);
+gboolean             gbp_devhelp_book_index_load_books_finish (GbpDevhelpBookIndex  *self,
+                                                               GAsyncResult         *result,
+                                                               GError              **error);
+void                 gbp_devhelp_book_index_populate          (GbpDevhelpBookIndex  *self,
+                                                               IdeSearchContext     *context,
+                                                               IdeSearchProvider    *provider,
+                                                               const gchar          *query);
+
+G_END_DECLS
+
+#endif /* GBP_DEVHELP_BOOK_INDEX_H */
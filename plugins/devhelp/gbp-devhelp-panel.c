@@ -22,6 +22,7 @@
 #include <glib/gi18n.h>
 #include <ide.h>
 
+#include "gbp-devhelp-book-index.h"
 #include "gbp-devhelp-panel.h"
 #include "gbp-devhelp-view.h"
 
@@ -29,40 +30,22 @@ struct _GbpDevhelpPanel
 {
   PnlDockWidget  parent_instance;
 
-  DhBookManager *books;
   DhSidebar     *sidebar;
-};
-
-G_DEFINE_TYPE (GbpDevhelpPanel, gbp_devhelp_panel, PNL_TYPE_DOCK_WIDGET)
+  GtkWidget     *spinner;
 
-enum {
-  PROP_0,
-  PROP_BOOK_MANAGER,
-  LAST_PROP
+  /* Requests made while the books were loading */
+  gchar         *pending_uri;
+  gchar         *pending_keyword;
+  guint          pending_focus : 1;
 };
 
-static GParamSpec *properties [LAST_PROP];
-
-static void
-gbp_devhelp_panel_find_view (GtkWidget *widget,
-                             gpointer   user_data)
-{
-  GbpDevhelpView **view = user_data;
-
-  if (*view != NULL)
-    return;
-
-  if (GBP_IS_DEVHELP_VIEW (widget))
-    *view = GBP_DEVHELP_VIEW (widget);
-}
+G_DEFINE_TYPE (GbpDevhelpPanel, gbp_devhelp_panel, PNL_TYPE_DOCK_WIDGET)
 
 static void
 gbp_devhelp_panel_link_selected (GbpDevhelpPanel *self,
                                  DhLink          *link,
                                  DhSidebar       *sidebar)
 {
-  GbpDevhelpView *view = NULL;
-  IdePerspective *perspective;
   IdeWorkbench *workbench;
   gchar *uri;
 
@@ -75,50 +58,31 @@ gbp_devhelp_panel_link_selected (GbpDevhelpPanel *self,
   workbench = ide_widget_get_workbench (GTK_WIDGET (self));
   g_assert (IDE_IS_WORKBENCH (workbench));
 
-  perspective = ide_workbench_get_perspective_by_name (workbench, "editor");
-  g_assert (IDE_IS_LAYOUT (perspective));
-
-  ide_perspective_views_foreach (perspective, gbp_devhelp_panel_find_view, &view);
-
-  if (view == NULL)
-    {
-      view = g_object_new (GBP_TYPE_DEVHELP_VIEW,
-                           "visible", TRUE,
-                           NULL);
-      gtk_container_add (GTK_CONTAINER (perspective), GTK_WIDGET (view));
-    }
-
   uri = dh_link_get_uri (link);
   IDE_TRACE_MSG ("User selected %s", uri);
-  gbp_devhelp_view_set_uri (view, uri);
+  gbp_devhelp_view_show_uri (workbench, uri);
   g_free (uri);
 
-  ide_workbench_focus (workbench, GTK_WIDGET (view));
-
   IDE_EXIT;
 }
 
-void
-gbp_devhelp_panel_set_uri (GbpDevhelpPanel *self,
-                           const gchar     *uri)
-{
-  g_return_if_fail (GBP_IS_DEVHELP_PANEL (self));
-  g_return_if_fail (uri != NULL);
-
-  dh_sidebar_select_uri (self->sidebar, uri);
-}
-
 static void
-gbp_devhelp_panel_constructed (GObject *object)
+gbp_devhelp_panel_create_sidebar (GbpDevhelpPanel *self,
+                                  DhBookManager   *books)
 {
-  GbpDevhelpPanel *self = (GbpDevhelpPanel *)object;
   GtkWidget *entry;
 
-  G_OBJECT_CLASS (gbp_devhelp_panel_parent_class)->constructed (object);
+  g_assert (GBP_IS_DEVHELP_PANEL (self));
+  g_assert (DH_IS_BOOK_MANAGER (books));
+  g_assert (self->sidebar == NULL);
 
-  g_assert (self->books != NULL);
+  if (self->spinner != NULL)
+    {
+      gtk_widget_destroy (self->spinner);
+      self->spinner = NULL;
+    }
 
-  self->sidebar = DH_SIDEBAR (dh_sidebar_new (self->books));
+  self->sidebar = DH_SIDEBAR (dh_sidebar_new (books));
 
   entry = ide_widget_find_child_typed (GTK_WIDGET (self->sidebar), GTK_TYPE_ENTRY);
   if (entry != NULL)
@@ -135,35 +99,129 @@ gbp_devhelp_panel_constructed (GObject *object)
                            G_CALLBACK (gbp_devhelp_panel_link_selected),
                            self,
                            G_CONNECT_SWAPPED);
+
+  if (self->pending_uri != NULL)
+    {
+      dh_sidebar_select_uri (self->sidebar, self->pending_uri);
+      g_clear_pointer (&self->pending_uri, g_free);
+    }
+
+  if (self->pending_focus)
+    {
+      dh_sidebar_set_search_focus (self->sidebar);
+      if (self->pending_keyword != NULL)
+        dh_sidebar_set_search_string (self->sidebar, self->pending_keyword);
+      g_clear_pointer (&self->pending_keyword, g_free);
+      self->pending_focus = FALSE;
+    }
 }
 
 static void
-gbp_devhelp_panel_finalize (GObject *object)
+gbp_devhelp_panel_load_books_cb (GObject      *object,
+                                 GAsyncResult *result,
+                                 gpointer      user_data)
 {
-  GbpDevhelpPanel *self = (GbpDevhelpPanel *)object;
+  GbpDevhelpBookIndex *index = (GbpDevhelpBookIndex *)object;
+  g_autoptr(GbpDevhelpPanel) self = user_data;
+  g_autoptr(GError) error = NULL;
 
-  g_clear_object (&self->books);
+  IDE_ENTRY;
 
-  G_OBJECT_CLASS (gbp_devhelp_panel_parent_class)->finalize (object);
+  g_assert (GBP_IS_DEVHELP_BOOK_INDEX (index));
+  g_assert (GBP_IS_DEVHELP_PANEL (self));
+
+  if (!gbp_devhelp_book_index_load_books_finish (index, result, &error))
+    {
+      g_warning ("Failed to load documentation: %s", error->message);
+      IDE_EXIT;
+    }
+
+  if (self->sidebar == NULL && !gtk_widget_in_destruction (GTK_WIDGET (self)))
+    gbp_devhelp_panel_create_sidebar (self, gbp_devhelp_book_index_get_book_manager (index));
+
+  IDE_EXIT;
 }
 
+/*
+ * The sidebar needs every book to be parsed, which is slow with many books
+ * installed, so it is only created once the panel is shown. The books are
+ * parsed on a worker thread while a spinner is shown in its place.
+ */
 static void
-gbp_devhelp_panel_set_property (GObject      *object,
-                                guint         prop_id,
-                                const GValue *value,
-                                GParamSpec   *pspec)
+gbp_devhelp_panel_ensure_sidebar (GbpDevhelpPanel *self)
 {
-  GbpDevhelpPanel *self = GBP_DEVHELP_PANEL(object);
+  GbpDevhelpBookIndex *index;
+  DhBookManager *books;
+
+  g_assert (GBP_IS_DEVHELP_PANEL (self));
 
-  switch (prop_id)
+  if (self->sidebar != NULL || self->spinner != NULL)
+    return;
+
+  index = gbp_devhelp_book_index_get_default ();
+
+  if (NULL != (books = gbp_devhelp_book_index_get_book_manager (index)))
     {
-    case PROP_BOOK_MANAGER:
-      self->books = g_value_dup_object (value);
-      break;
+      gbp_devhelp_panel_create_sidebar (self, books);
+      return;
+    }
+
+  self->spinner = g_object_new (GTK_TYPE_SPINNER,
+                                "active", TRUE,
+                                "halign", GTK_ALIGN_CENTER,
+                                "valign", GTK_ALIGN_CENTER,
+                                "height-request", 32,
+                                "width-request", 32,
+                                "visible", TRUE,
+                                NULL);
+  gtk_container_add (GTK_CONTAINER (self), self->spinner);
+
+  gbp_devhelp_book_index_load_books_async (index,
+                                           NULL,
+                                           gbp_devhelp_panel_load_books_cb,
+                                           g_object_ref (self));
+}
 
-    default:
-      G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+void
+gbp_devhelp_panel_set_uri (GbpDevhelpPanel *self,
+                           const gchar     *uri)
+{
+  g_return_if_fail (GBP_IS_DEVHELP_PANEL (self));
+  g_return_if_fail (uri != NULL);
+
+  gbp_devhelp_panel_ensure_sidebar (self);
+
+  if (self->sidebar == NULL)
+    {
+      g_free (self->pending_uri);
+      self->pending_uri = g_strdup (uri);
+      return;
     }
+
+  dh_sidebar_select_uri (self->sidebar, uri);
+}
+
+static void
+gbp_devhelp_panel_map (GtkWidget *widget)
+{
+  GbpDevhelpPanel *self = (GbpDevhelpPanel *)widget;
+
+  g_assert (GBP_IS_DEVHELP_PANEL (self));
+
+  gbp_devhelp_panel_ensure_sidebar (self);
+
+  GTK_WIDGET_CLASS (gbp_devhelp_panel_parent_class)->map (widget);
+}
+
+static void
+gbp_devhelp_panel_finalize (GObject *object)
+{
+  GbpDevhelpPanel *self = (GbpDevhelpPanel *)object;
+
+  g_clear_pointer (&self->pending_uri, g_free);
+  g_clear_pointer (&self->pending_keyword, g_free);
+
+  G_OBJECT_CLASS (gbp_devhelp_panel_parent_class)->finalize (object);
 }
 
 static void
@@ -172,20 +230,11 @@ gbp_devhelp_panel_class_init (GbpDevhelpPanelClass *klass)
   GObjectClass *object_class = G_OBJECT_CLASS (klass);
   GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
 
-  object_class->constructed = gbp_devhelp_panel_constructed;
   object_class->finalize = gbp_devhelp_panel_finalize;
-  object_class->set_property = gbp_devhelp_panel_set_property;
-
-  gtk_widget_class_set_css_name (widget_class, "devhelppanel");
 
-  properties [PROP_BOOK_MANAGER] =
-    g_param_spec_object ("book-manager",
-                         "Book Manager",
-                         "Book Manager",
-                         DH_TYPE_BOOK_MANAGER,
-                         (G_PARAM_WRITABLE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS));
+  widget_class->map = gbp_devhelp_panel_map;
 
-  g_object_class_install_properties (object_class, LAST_PROP, properties);
+  gtk_widget_class_set_css_name (widget_class, "devhelppanel");
 }
 
 static void
@@ -200,6 +249,16 @@ gbp_devhelp_panel_focus_search (GbpDevhelpPanel *self,
 {
   g_return_if_fail (GBP_IS_DEVHELP_PANEL (self));
 
+  gbp_devhelp_panel_ensure_sidebar (self);
+
+  if (self->sidebar == NULL)
+    {
+      g_free (self->pending_keyword);
+      self->pending_keyword = g_strdup (keyword);
+      self->pending_focus = TRUE;
+      return;
+    }
+
   dh_sidebar_set_search_focus (self->sidebar);
 
   if (keyword)
@@ -0,0 +1,129 @@
+/* gbp-devhelp-search-provider.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define G_LOG_DOMAIN "gbp-devhelp-search-provider"
+
+#include <glib/gi18n.h>
+#include <string.h>
+
+#include "gbp-devhelp-book-index.h"
+#include "gbp-devhelp-search-provider.h"
+#include "gbp-devhelp-search-result.h"
+#include "gbp-devhelp-view.h"
+
+struct _GbpDevhelpSearchProvider
+{
+  IdeObject parent_instance;
+};
+
+static void search_provider_iface_init (IdeSearchProviderInterface *iface);
+
+G_DEFINE_TYPE_EXTENDED (GbpDevhelpSearchProvider, gbp_devhelp_search_provider, IDE_TYPE_OBJECT, 0,
+                        G_IMPLEMENT_INTERFACE (IDE_TYPE_SEARCH_PROVIDER, search_provider_iface_init))
+
+static void
+gbp_devhelp_search_provider_populate (IdeSearchProvider *provider,
+                                      IdeSearchContext  *context,
+                                      const gchar       *search_terms,
+                                      gsize              max_results,
+                                      GCancellable      *cancellable)
+{
+  GbpDevhelpBookIndex *index;
+
+  g_assert (GBP_IS_DEVHELP_SEARCH_PROVIDER (provider));
+  g_assert (IDE_IS_SEARCH_CONTEXT (context));
+  g_assert (search_terms != NULL);
+  g_assert (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+  index = gbp_devhelp_book_index_get_default ();
+
+  /*
+   * Never wait for the index. It is loaded from the keyword cache, so
+   * results are available for the next query almost right away.
+   */
+  if (!gbp_devhelp_book_index_get_loaded (index))
+    gbp_devhelp_book_index_load_async (index, NULL, NULL, NULL);
+  else if (strlen (search_terms) >= 2)
+    gbp_devhelp_book_index_populate (index, context, provider, search_terms);
+
+  ide_search_context_provider_completed (context, provider);
+}
+
+static const gchar *
+gbp_devhelp_search_provider_get_verb (IdeSearchProvider *provider)
+{
+  return _("Documentation");
+}
+
+static gint
+gbp_devhelp_search_provider_get_priority (IdeSearchProvider *provider)
+{
+  return 200;
+}
+
+static GtkWidget *
+gbp_devhelp_search_provider_create_row (IdeSearchProvider *provider,
+                                        IdeSearchResult   *result)
+{
+  g_assert (IDE_IS_SEARCH_PROVIDER (provider));
+  g_assert (IDE_IS_SEARCH_RESULT (result));
+
+  return g_object_new (IDE_TYPE_OMNI_SEARCH_ROW,
+                       "icon-name", "help-contents-symbolic",
+                       "result", result,
+                       "visible", TRUE,
+                       NULL);
+}
+
+static void
+gbp_devhelp_search_provider_activate (IdeSearchProvider *provider,
+                                      GtkWidget         *row,
+                                      IdeSearchResult   *result)
+{
+  GbpDevhelpSearchResult *item = (GbpDevhelpSearchResult *)result;
+  IdeWorkbench *workbench;
+
+  g_assert (IDE_IS_SEARCH_PROVIDER (provider));
+  g_assert (GTK_IS_WIDGET (row));
+  g_assert (GBP_IS_DEVHELP_SEARCH_RESULT (item));
+
+  if (!(workbench = ide_widget_get_workbench (row)))
+    return;
+
+  gbp_devhelp_view_show_uri (workbench, gbp_devhelp_search_result_get_uri (item));
+}
+
+static void
+gbp_devhelp_search_provider_class_init (GbpDevhelpSearchProviderClass *klass)
+{
+}
+
+static void
+gbp_devhelp_search_provider_init (GbpDevhelpSearchProvider *self)
+{
+}
+
+static void
+search_provider_iface_init (IdeSearchProviderInterface *iface)
+{
+  iface->populate = gbp_devhelp_search_provider_populate;
+  iface->get_verb = gbp_devhelp_search_provider_get_verb;
+  iface->create_row = gbp_devhelp_search_provider_create_row;
+  iface->activate = gbp_devhelp_search_provider_activate;
+  iface->get_priority = gbp_devhelp_search_provider_get_priority;
+}
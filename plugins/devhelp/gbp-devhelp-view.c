@@ -50,6 +50,58 @@ gbp_devhelp_view_set_uri (GbpDevhelpView *self,
   webkit_web_view_load_uri (self->web_view1, uri);
 }
 
+static void
+gbp_devhelp_view_find_view (GtkWidget *widget,
+                            gpointer   user_data)
+{
+  GbpDevhelpView **view = user_data;
+
+  if (*view != NULL)
+    return;
+
+  if (GBP_IS_DEVHELP_VIEW (widget))
+    *view = GBP_DEVHELP_VIEW (widget);
+}
+
+/**
+ * gbp_devhelp_view_show_uri:
+ *
+ * Loads @uri in the documentation view of the editor perspective, creating
+ * the view if necessary, and focuses it.
+ */
+void
+gbp_devhelp_view_show_uri (IdeWorkbench *workbench,
+                           const gchar  *uri)
+{
+  GbpDevhelpView *view = NULL;
+  IdePerspective *perspective;
+
+  IDE_ENTRY;
+
+  g_return_if_fail (IDE_IS_WORKBENCH (workbench));
+  g_return_if_fail (uri != NULL);
+
+  perspective = ide_workbench_get_perspective_by_name (workbench, "editor");
+  g_assert (IDE_IS_LAYOUT (perspective));
+
+  ide_perspective_views_foreach (perspective, gbp_devhelp_view_find_view, &view);
+
+  if (view == NULL)
+    {
+      view = g_object_new (GBP_TYPE_DEVHELP_VIEW,
+                           "visible", TRUE,
+                           NULL);
+      gtk_container_add (GTK_CONTAINER (perspective), GTK_WIDGET (view));
+    }
+
+  IDE_TRACE_MSG ("Showing %s", uri);
+  gbp_devhelp_view_set_uri (view, uri);
+
+  ide_workbench_focus (workbench, GTK_WIDGET (view));
+
+  IDE_EXIT;
+}
+
 static gchar *
 gbp_devhelp_view_get_title (IdeLayoutView *view)
 {
@@ -27,8 +27,10 @@ G_BEGIN_DECLS
 
 G_DECLARE_FINAL_TYPE (GbpDevhelpView, gbp_devhelp_view, GBP, DEVHELP_VIEW, IdeLayoutView)
 
-void gbp_devhelp_view_set_uri (GbpDevhelpView *self,
-                               const gchar    *uri);
+void gbp_devhelp_view_set_uri  (GbpDevhelpView *self,
+                                const gchar    *uri);
+void gbp_devhelp_view_show_uri (IdeWorkbench   *workbench,
+                                const gchar    *uri);
 
 G_END_DECLS
 
@@ -22,6 +22,7 @@
 #include <glib/gi18n.h>
 #include <ide.h>
 
+#include "gbp-devhelp-book-index.h"
 #include "gbp-devhelp-panel.h"
 #include "gbp-devhelp-workbench-addin.h"
 
@@ -29,7 +30,6 @@ struct _GbpDevhelpWorkbenchAddin
 {
   GObject          parent_instance;
   GbpDevhelpPanel *panel;
-  DhBookManager   *books;
 };
 
 static void gbp_devhelp_workbench_addin_init_iface (IdeWorkbenchAddinInterface *iface);
@@ -57,7 +57,8 @@ focus_devhelp_search (GSimpleAction *action,
 
   g_assert (GBP_IS_DEVHELP_WORKBENCH_ADDIN (self));
 
-  gbp_devhelp_panel_focus_search (self->panel, NULL);
+  if (self->panel != NULL)
+    gbp_devhelp_panel_focus_search (self->panel, NULL);
 }
 
 static void
@@ -73,8 +74,12 @@ gbp_devhelp_workbench_addin_load (IdeWorkbenchAddin *addin,
   g_assert (IDE_IS_WORKBENCH_ADDIN (self));
   g_assert (IDE_IS_WORKBENCH (workbench));
 
-  self->books = dh_book_manager_new ();
-  dh_book_manager_populate (self->books);
+  /*
+   * The keyword index is shared by every workbench in the process and
+   * loaded on a worker thread, so it is ready by the time we search. The
+   * panel loads the books for its sidebar once it is shown.
+   */
+  gbp_devhelp_book_index_load_async (gbp_devhelp_book_index_get_default (), NULL, NULL, NULL);
 
   perspective = ide_workbench_get_perspective_by_name (workbench, "editor");
   g_assert (IDE_IS_LAYOUT (perspective));
@@ -83,10 +88,13 @@ gbp_devhelp_workbench_addin_load (IdeWorkbenchAddin *addin,
   g_assert (IDE_IS_LAYOUT_PANE (pane));
 
   self->panel = g_object_new (GBP_TYPE_DEVHELP_PANEL,
-                              "book-manager", self->books,
                               "expand", TRUE,
                               "visible", TRUE,
                               NULL);
+  g_signal_connect (self->panel,
+                    "destroy",
+                    G_CALLBACK (gtk_widget_destroyed),
+                    &self->panel);
   gtk_container_add (GTK_CONTAINER (pane), GTK_WIDGET (self->panel));
 
   action = g_simple_action_new ("focus-devhelp-search", NULL);
@@ -102,23 +110,13 @@ gbp_devhelp_workbench_addin_unload (IdeWorkbenchAddin *addin,
                                     IdeWorkbench      *workbench)
 {
   GbpDevhelpWorkbenchAddin *self = (GbpDevhelpWorkbenchAddin *)addin;
-  IdePerspective *perspective;
-  GtkWidget *pane;
   const gchar *empty_accels[1] = { NULL };
 
   g_assert (IDE_IS_WORKBENCH_ADDIN (self));
   g_assert (IDE_IS_WORKBENCH (workbench));
 
-  g_clear_object (&self->books);
-
-  perspective = ide_workbench_get_perspective_by_name (workbench, "editor");
-  g_assert (IDE_IS_LAYOUT (perspective));
-
-  pane = pnl_dock_bin_get_right_edge (PNL_DOCK_BIN (perspective));
-  g_assert (IDE_IS_LAYOUT_PANE (pane));
-
-  gtk_widget_destroy (GTK_WIDGET (self->panel));
-  self->panel = NULL;
+  if (self->panel != NULL)
+    gtk_widget_destroy (GTK_WIDGET (self->panel));
 
   g_action_map_remove_action (G_ACTION_MAP (workbench), "focus-devhelp-search");
 
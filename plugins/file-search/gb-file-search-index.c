@@ -18,6 +18,7 @@
 
 #define G_LOG_DOMAIN "gb-file-search-index"
 
+#include <egg-counter.h>
 #include <fuzzy.h>
 #include <glib/gi18n.h>
 #include <ide.h>
@@ -35,6 +36,11 @@ struct _GbFileSearchIndex
 
 G_DEFINE_TYPE (GbFileSearchIndex, gb_file_search_index, IDE_TYPE_OBJECT)
 
+EGG_DEFINE_HISTOGRAM (fuzzy_query,
+                      "File Search",
+                      "Fuzzy Query",
+                      "Time to match a query against the file index")
+
 enum {
   PROP_0,
   PROP_ROOT_DIRECTORY,
@@ -132,11 +138,13 @@ gb_file_search_index_init (GbFileSearchIndex *self)
 }
 
 static void
-populate_from_dir (Fuzzy        *fuzzy,
-                   IdeVcs       *vcs,
-                   const gchar  *relpath,
-                   GFile        *directory,
-                   GCancellable *cancellable)
+populate_from_dir (Fuzzy               *fuzzy,
+                   IdeVcs              *vcs,
+                   IdeVcsIgnoreMatcher *matcher,
+                   const gchar         *vcs_relpath,
+                   const gchar         *relpath,
+                   GFile               *directory,
+                   GCancellable        *cancellable)
 {
   GFileEnumerator *enumerator;
   GPtrArray *children = NULL;
@@ -146,7 +154,7 @@ populate_from_dir (Fuzzy        *fuzzy,
   g_assert (G_IS_FILE (directory));
   g_assert (!cancellable || G_IS_CANCELLABLE (cancellable));
 
-  if (ide_vcs_is_ignored (vcs, directory, NULL))
+  if (ide_vcs_ignore_matcher_is_file_ignored (matcher, vcs, vcs_relpath, directory, TRUE))
     return;
 
   enumerator = g_file_enumerate_children (directory,
@@ -163,6 +171,7 @@ populate_from_dir (Fuzzy        *fuzzy,
     {
       g_autoptr(GFileInfo) file_info = file_info_ptr;
       g_autofree gchar *path = NULL;
+      g_autofree gchar *vcs_path = NULL;
       g_autoptr(GFile) file = NULL;
       const gchar *name;
 
@@ -177,7 +186,10 @@ populate_from_dir (Fuzzy        *fuzzy,
           continue;
         }
 
-      if (ide_vcs_is_ignored (vcs, file, NULL))
+      if (vcs_relpath != NULL)
+        vcs_path = ide_vcs_ignore_matcher_build_path (vcs_relpath, name);
+
+      if (ide_vcs_ignore_matcher_is_file_ignored (matcher, vcs, vcs_path, file, FALSE))
         continue;
 
       if (relpath != NULL)
@@ -195,6 +207,7 @@ populate_from_dir (Fuzzy        *fuzzy,
       for (i = 0; i < children->len; i++)
         {
           g_autofree gchar *path = NULL;
+          g_autofree gchar *vcs_path = NULL;
           g_autofree gchar *name = NULL;
           GFile *child;
 
@@ -204,7 +217,10 @@ populate_from_dir (Fuzzy        *fuzzy,
           if (relpath != NULL)
             path = g_build_filename (relpath, name, NULL);
 
-          populate_from_dir (fuzzy, vcs, path ? path : name, child, cancellable);
+          if (vcs_relpath != NULL)
+            vcs_path = ide_vcs_ignore_matcher_build_path (vcs_relpath, name);
+
+          populate_from_dir (fuzzy, vcs, matcher, vcs_path, path ? path : name, child, cancellable);
         }
     }
 
@@ -218,9 +234,12 @@ gb_file_search_index_builder (GTask        *task,
                               GCancellable *cancellable)
 {
   GbFileSearchIndex *self = source_object;
+  g_autoptr(IdeVcsIgnoreMatcher) matcher = NULL;
   g_autoptr(GTimer) timer = NULL;
+  g_autofree gchar *vcs_relpath = NULL;
   GFile *directory = task_data;
   IdeContext *context;
+  GFile *workdir;
   IdeVcs *vcs;
   Fuzzy *fuzzy;
   gdouble elapsed;
@@ -232,12 +251,22 @@ gb_file_search_index_builder (GTask        *task,
 
   context = ide_object_get_context (IDE_OBJECT (self));
   vcs = ide_context_get_vcs (context);
+  workdir = ide_vcs_get_working_directory (vcs);
+
+  /* The matcher wants paths relative to the working directory */
+  if ((matcher = ide_vcs_get_ignore_matcher (vcs)) && workdir != NULL)
+    {
+      if (g_file_equal (workdir, directory))
+        vcs_relpath = g_strdup ("");
+      else
+        vcs_relpath = g_file_get_relative_path (workdir, directory);
+    }
 
   timer = g_timer_new ();
 
   fuzzy = fuzzy_new (FALSE);
   fuzzy_begin_bulk_insert (fuzzy);
-  populate_from_dir (fuzzy, vcs, NULL, directory, cancellable);
+  populate_from_dir (fuzzy, vcs, matcher, vcs_relpath, NULL, directory, cancellable);
   fuzzy_end_bulk_insert (fuzzy);
 
   self->fuzzy = fuzzy;
@@ -299,6 +328,7 @@ gb_file_search_index_populate (GbFileSearchIndex *self,
   g_autoptr(GArray) ar = NULL;
   g_auto(IdeSearchReducer) reducer = { 0 };
   IdeContext *icontext;
+  gint64 begin_time;
   gsize max_matches;
   gsize i;
 
@@ -314,7 +344,9 @@ gb_file_search_index_populate (GbFileSearchIndex *self,
   max_matches = ide_search_context_get_max_results (context);
   ide_search_reducer_init (&reducer, context, provider, max_matches);
 
+  begin_time = g_get_monotonic_time ();
   ar = fuzzy_match (self->fuzzy, query, max_matches);
+  EGG_HISTOGRAM_RECORD_SINCE (fuzzy_query, begin_time);
 
   for (i = 0; i < ar->len; i++)
     {
@@ -0,0 +1,131 @@
+/* gbp-flatpak-programs.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define G_LOG_DOMAIN "gbp-flatpak-programs"
+
+#include <string.h>
+#include <glib/gstdio.h>
+
+#include "gbp-flatpak-programs.h"
+
+static gboolean
+directory_contains_program (const gchar *directory,
+                            const gchar *program)
+{
+  g_autofree gchar *path = NULL;
+  GStatBuf st;
+
+  g_assert (directory != NULL);
+  g_assert (program != NULL);
+
+  path = g_build_filename (directory, program, NULL);
+
+  /*
+   * Use lstat() since symlinks within the runtime are relative to the
+   * sandbox and would be resolved against the host.
+   */
+  if (g_lstat (path, &st) != 0)
+    return FALSE;
+
+  return S_ISLNK (st.st_mode) || (S_ISREG (st.st_mode) && (st.st_mode & 0111) != 0);
+}
+
+/**
+ * gbp_flatpak_programs_resolve_on_disk:
+ * @programs: (array zero-terminated=1): the programs to locate
+ * @app_bin: the host directory mounted at /app/bin
+ * @sdk_bin: (nullable): the host directory mounted at /usr/bin, if known
+ * @found: a table to insert the program name and sandbox path into
+ *
+ * The build environment uses a PATH of /app/bin:/usr/bin. When the SDK
+ * deployment is known, programs are looked up in both directories on the
+ * host and anything not found there is missing.
+ *
+ * Returns: (transfer container) (element-type utf8): the programs which
+ *   must be resolved from within the sandbox. The strings belong to
+ *   @programs.
+ */
+GPtrArray *
+gbp_flatpak_programs_resolve_on_disk (const gchar * const *programs,
+                                      const gchar         *app_bin,
+                                      const gchar         *sdk_bin,
+                                      GHashTable          *found)
+{
+  GPtrArray *remaining;
+
+  g_return_val_if_fail (programs != NULL, NULL);
+  g_return_val_if_fail (app_bin != NULL, NULL);
+  g_return_val_if_fail (found != NULL, NULL);
+
+  remaining = g_ptr_array_new ();
+
+  for (guint i = 0; programs [i] != NULL; i++)
+    {
+      const gchar *program = programs [i];
+
+      if (sdk_bin == NULL || strchr (program, G_DIR_SEPARATOR) != NULL)
+        g_ptr_array_add (remaining, (gchar *)program);
+      else if (directory_contains_program (app_bin, program))
+        g_hash_table_insert (found, g_strdup (program), g_build_filename ("/app", "bin", program, NULL));
+      else if (directory_contains_program (sdk_bin, program))
+        g_hash_table_insert (found, g_strdup (program), g_build_filename ("/usr", "bin", program, NULL));
+    }
+
+  return remaining;
+}
+
+/**
+ * gbp_flatpak_programs_parse_which:
+ * @output: the standard output of `which` run with all of @remaining
+ * @remaining: (element-type utf8): the programs passed to `which`
+ * @found: a table to insert the program name and sandbox path into
+ *
+ * `which` prints one path per program that was found, so match each line
+ * back to the program by its full path or basename.
+ */
+void
+gbp_flatpak_programs_parse_which (const gchar *output,
+                                  GPtrArray   *remaining,
+                                  GHashTable  *found)
+{
+  g_auto(GStrv) lines = NULL;
+
+  g_return_if_fail (remaining != NULL);
+  g_return_if_fail (found != NULL);
+
+  lines = g_strsplit (output ?: "", "\n", 0);
+
+  for (guint i = 0; lines [i] != NULL; i++)
+    {
+      g_autofree gchar *name = NULL;
+      gchar *line = g_strstrip (lines [i]);
+
+      if (*line == '\0')
+        continue;
+
+      name = g_path_get_basename (line);
+
+      for (guint j = 0; j < remaining->len; j++)
+        {
+          const gchar *program = g_ptr_array_index (remaining, j);
+
+          if (g_str_equal (program, line) || g_str_equal (program, name))
+            g_hash_table_insert (found, g_strdup (program), g_strdup (line));
+        }
+    }
+}
@@ -0,0 +1,36 @@
+/* gbp-flatpak-programs.h
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GBP_FLATPAK_PROGRAMS_H
+#define GBP_FLATPAK_PROGRAMS_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+GPtrArray *gbp_flatpak_programs_resolve_on_disk (const gchar * const *programs,
+                                                 const gchar         *app_bin,
+                                                 const gchar         *sdk_bin,
+                                                 GHashTable          *found);
+void       gbp_flatpak_programs_parse_which     (const gchar         *output,
+                                                 GPtrArray           *remaining,
+                                                 GHashTable          *found);
+
+G_END_DECLS
+
+#endif /* GBP_FLATPAK_PROGRAMS_H */
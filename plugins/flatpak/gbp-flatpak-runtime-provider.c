@@ -444,8 +444,6 @@ gbp_flatpak_runtime_provider_load_worker (GTask        *task,
 {
   GbpFlatpakRuntimeProvider *self = source_object;
   g_autoptr(GPtrArray) ret = NULL;
-  g_autoptr(GFile) file = NULL;
-  g_autofree gchar *path = NULL;
   GError *error = NULL;
 
   IDE_ENTRY;
@@ -464,11 +462,8 @@ gbp_flatpak_runtime_provider_load_worker (GTask        *task,
       g_clear_error (&error);
     }
 
-  /* Load user flatpak runtimes */
-  path = g_build_filename (g_get_home_dir (), ".local", "share", "flatpak", NULL);
-  file = g_file_new_for_path (path);
-
-  if (NULL == (self->user_installation = flatpak_installation_new_for_path (file, TRUE, cancellable, &error)) ||
+  /* Load user flatpak runtimes, which honors $FLATPAK_USER_DIR */
+  if (NULL == (self->user_installation = flatpak_installation_new_user (cancellable, &error)) ||
       !gbp_flatpak_runtime_provider_load_refs (self, self->user_installation, ret, cancellable, &error))
     {
       g_warning ("%s", error->message);
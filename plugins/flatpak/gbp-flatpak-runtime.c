@@ -18,8 +18,12 @@
 
 #define G_LOG_DOMAIN "gbp-flatpak-runtime"
 
+#include <string.h>
+#include <flatpak.h>
+#include <glib/gstdio.h>
 #include <json-glib/json-glib.h>
 
+#include "gbp-flatpak-programs.h"
 #include "gbp-flatpak-runtime.h"
 #include "gbp-flatpak-subprocess-launcher.h"
 #include "gbp-flatpak-runner.h"
@@ -93,6 +97,176 @@ gbp_flatpak_runtime_contains_program_in_path (IdeRuntime   *runtime,
   return (subprocess != NULL) && ide_subprocess_wait_check (subprocess, cancellable, NULL);
 }
 
+/*
+ * Locates the SDK deployment in the user installation, which honors
+ * $FLATPAK_USER_DIR, or one of the system installations so that the
+ * programs it contains can be found without entering the sandbox.
+ */
+static gchar *
+get_sdk_bin_directory (GbpFlatpakRuntime *self,
+                       GCancellable      *cancellable)
+{
+  g_autoptr(GPtrArray) installations = NULL;
+  FlatpakInstallation *installation;
+  const gchar *arch;
+
+  g_assert (GBP_IS_FLATPAK_RUNTIME (self));
+
+  if (self->sdk == NULL || self->branch == NULL)
+    return NULL;
+
+  arch = flatpak_get_default_arch ();
+  installations = g_ptr_array_new_with_free_func (g_object_unref);
+
+  if (NULL != (installation = flatpak_installation_new_user (cancellable, NULL)))
+    g_ptr_array_add (installations, installation);
+
+#if FLATPAK_CHECK_VERSION(0, 8, 0)
+  {
+    g_autoptr(GPtrArray) system = NULL;
+
+    /* Includes the default installation and any in installations.d */
+    if (NULL != (system = flatpak_get_system_installations (cancellable, NULL)))
+      {
+        for (guint i = 0; i < system->len; i++)
+          g_ptr_array_add (installations, g_object_ref (g_ptr_array_index (system, i)));
+      }
+  }
+#else
+  if (NULL != (installation = flatpak_installation_new_system (cancellable, NULL)))
+    g_ptr_array_add (installations, installation);
+#endif
+
+  for (guint i = 0; i < installations->len; i++)
+    {
+      FlatpakInstalledRef *ref;
+      g_autofree gchar *bin_dir = NULL;
+      const gchar *deploy_dir;
+
+      installation = g_ptr_array_index (installations, i);
+      ref = flatpak_installation_get_installed_ref (installation,
+                                                    FLATPAK_REF_KIND_RUNTIME,
+                                                    self->sdk,
+                                                    arch,
+                                                    self->branch,
+                                                    cancellable,
+                                                    NULL);
+
+      if (ref == NULL)
+        continue;
+
+      if (NULL != (deploy_dir = flatpak_installed_ref_get_deploy_dir (ref)))
+        bin_dir = g_build_filename (deploy_dir, "files", "bin", NULL);
+
+      g_object_unref (ref);
+
+      if (bin_dir != NULL && g_file_test (bin_dir, G_FILE_TEST_IS_DIR))
+        return g_steal_pointer (&bin_dir);
+    }
+
+  return NULL;
+}
+
+static void
+gbp_flatpak_runtime_resolve_programs_worker (GTask        *task,
+                                             gpointer      source_object,
+                                             gpointer      task_data,
+                                             GCancellable *cancellable)
+{
+  GbpFlatpakRuntime *self = source_object;
+  const gchar * const *programs = task_data;
+  g_autoptr(GHashTable) found = NULL;
+  g_autoptr(GPtrArray) remaining = NULL;
+  g_autoptr(IdeSubprocessLauncher) launcher = NULL;
+  g_autoptr(IdeSubprocess) subprocess = NULL;
+  g_autofree gchar *build_path = NULL;
+  g_autofree gchar *app_bin = NULL;
+  g_autofree gchar *sdk_bin = NULL;
+  g_autofree gchar *stdout_buf = NULL;
+  GError *error = NULL;
+
+  g_assert (G_IS_TASK (task));
+  g_assert (GBP_IS_FLATPAK_RUNTIME (self));
+  g_assert (programs != NULL);
+  g_assert (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+  found = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+  /*
+   * The build environment uses a PATH of /app/bin:/usr/bin, which map to
+   * the build directory and the SDK deployment. When both are available on
+   * disk we can answer without spawning anything inside the sandbox.
+   */
+  build_path = get_build_directory (self);
+  app_bin = g_build_filename (build_path, "files", "bin", NULL);
+  sdk_bin = get_sdk_bin_directory (self, cancellable);
+  remaining = gbp_flatpak_programs_resolve_on_disk (programs, app_bin, sdk_bin, found);
+
+  if (remaining->len == 0)
+    {
+      g_task_return_pointer (task, g_steal_pointer (&found), (GDestroyNotify)g_hash_table_unref);
+      return;
+    }
+
+  /* Otherwise resolve the rest of the programs with a single spawn. */
+  launcher = ide_runtime_create_launcher (IDE_RUNTIME (self), &error);
+
+  if (launcher == NULL)
+    {
+      g_task_return_error (task, error);
+      return;
+    }
+
+  ide_subprocess_launcher_push_argv (launcher, "which");
+  for (guint i = 0; i < remaining->len; i++)
+    ide_subprocess_launcher_push_argv (launcher, g_ptr_array_index (remaining, i));
+
+  subprocess = ide_subprocess_launcher_spawn (launcher, cancellable, &error);
+
+  /* which exits non-zero when any program is missing, so ignore the status */
+  if (subprocess == NULL ||
+      !ide_subprocess_communicate_utf8 (subprocess, NULL, cancellable, &stdout_buf, NULL, &error))
+    {
+      g_task_return_error (task, error);
+      return;
+    }
+
+  gbp_flatpak_programs_parse_which (stdout_buf, remaining, found);
+
+  g_task_return_pointer (task, g_steal_pointer (&found), (GDestroyNotify)g_hash_table_unref);
+}
+
+static void
+gbp_flatpak_runtime_resolve_programs_async (IdeRuntime          *runtime,
+                                            const gchar * const *programs,
+                                            GCancellable        *cancellable,
+                                            GAsyncReadyCallback  callback,
+                                            gpointer             user_data)
+{
+  GbpFlatpakRuntime *self = (GbpFlatpakRuntime *)runtime;
+  g_autoptr(GTask) task = NULL;
+
+  g_assert (GBP_IS_FLATPAK_RUNTIME (self));
+  g_assert (programs != NULL);
+  g_assert (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_source_tag (task, gbp_flatpak_runtime_resolve_programs_async);
+  g_task_set_task_data (task, g_strdupv ((gchar **)programs), (GDestroyNotify)g_strfreev);
+  g_task_run_in_thread (task, gbp_flatpak_runtime_resolve_programs_worker);
+}
+
+static GHashTable *
+gbp_flatpak_runtime_resolve_programs_finish (IdeRuntime    *runtime,
+                                             GAsyncResult  *result,
+                                             GError       **error)
+{
+  g_assert (GBP_IS_FLATPAK_RUNTIME (runtime));
+  g_assert (G_IS_TASK (result));
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
 static void
 gbp_flatpak_runtime_prebuild_worker (GTask        *task,
                                      gpointer      source_object,
@@ -535,6 +709,9 @@ gbp_flatpak_runtime_postinstall_worker (GTask        *task,
       return;
     }
 
+  /* The installed application may provide programs we did not find before */
+  ide_runtime_invalidate_programs (IDE_RUNTIME (self));
+
   g_task_return_boolean (task, TRUE);
 }
 
@@ -806,7 +983,9 @@ gbp_flatpak_runtime_set_property (GObject      *object,
   switch (prop_id)
     {
     case PROP_BRANCH:
+      g_free (self->branch);
       self->branch = g_value_dup_string (value);
+      ide_runtime_invalidate_programs (IDE_RUNTIME (self));
       break;
 
     case PROP_PLATFORM:
@@ -814,7 +993,9 @@ gbp_flatpak_runtime_set_property (GObject      *object,
       break;
 
     case PROP_SDK:
+      g_free (self->sdk);
       self->sdk = g_value_dup_string (value);
+      ide_runtime_invalidate_programs (IDE_RUNTIME (self));
       break;
 
     case PROP_PRIMARY_MODULE:
@@ -866,6 +1047,8 @@ gbp_flatpak_runtime_class_init (GbpFlatpakRuntimeClass *klass)
   runtime_class->create_launcher = gbp_flatpak_runtime_create_launcher;
   runtime_class->create_runner = gbp_flatpak_runtime_create_runner;
   runtime_class->contains_program_in_path = gbp_flatpak_runtime_contains_program_in_path;
+  runtime_class->resolve_programs_async = gbp_flatpak_runtime_resolve_programs_async;
+  runtime_class->resolve_programs_finish = gbp_flatpak_runtime_resolve_programs_finish;
   runtime_class->prepare_configuration = gbp_flatpak_runtime_prepare_configuration;
 
   properties [PROP_BRANCH] =
@@ -18,11 +18,11 @@
 
 #define G_LOG_DOMAIN "ide-gettext-diagnostic-provider"
 
-#include <egg-task-cache.h>
 #include <glib/gi18n.h>
-#include <stdlib.h>
+#include <string.h>
 
 #include "ide-gettext-diagnostic-provider.h"
+#include "ide-gettext-regions.h"
 
 struct _IdeGettextDiagnostics
 {
@@ -31,17 +31,72 @@ struct _IdeGettextDiagnostics
   guint64         sequence;
 };
 
+/*
+ * The provider checks the contents of a file by feeding them to xgettext.
+ * Requests for a file are coalesced into a single run, and a request for a
+ * newer sequence cancels the run in flight. Runs from every buffer share a
+ * small number of xgettext processes.
+ *
+ * For C-like languages the contents are split into top-level regions,
+ * which are usually functions. Regions that did not change since the last
+ * run keep their results and are blanked out of the input, so only the
+ * edited regions are checked again.
+ *
+ * xgettext merges the occurrences of a msgid and checks the message once,
+ * so the results of a region depend on the other regions using the same
+ * msgid. Unchanged regions sharing a msgid with a changed region, or with
+ * a region which is gone, are checked again as well.
+ */
+
+#define MAX_RUNNING         2
+#define STATE_MAX_IDLE_USEC (5 * 60 * G_USEC_PER_SEC)
+#define GC_INTERVAL_SECONDS 60
+
 struct _IdeGettextDiagnosticProvider
 {
-  IdeObject     parent_instance;
-  EggTaskCache *diagnostics_cache;
+  IdeObject   parent_instance;
+
+  /* IdeFile → FileState */
+  GHashTable *files;
+
+  guint       gc_handler;
 };
 
 typedef struct
 {
-  IdeFile *file;
-  IdeUnsavedFile *unsaved_file;
-} TranslationUnit;
+  guint  line;
+  gchar *message;
+} Result;
+
+typedef struct
+{
+  IdeFile               *file;
+  IdeGettextDiagnostics *cached;
+  /* Region contents → GArray of Result, from the last completed run */
+  GHashTable            *regions;
+  /* msgid → number of occurrences in the regions of the last completed run */
+  GHashTable            *msgids;
+  /* Tasks waiting for the run in flight */
+  GPtrArray             *waiting;
+  /* The run in flight, if any */
+  GCancellable          *cancellable;
+  gint64                 sequence;
+  gint64                 last_used;
+} FileState;
+
+typedef struct
+{
+  IdeGettextDiagnosticProvider *self;
+  IdeFile                      *file;
+  GBytes                       *content;
+  GArray                       *regions;
+  GCancellable                 *cancellable;
+  const gchar                  *language;
+  gint64                        sequence;
+} Run;
+
+static GQueue pending_runs;
+static guint  n_running;
 
 static void diagnostic_provider_iface_init (IdeDiagnosticProviderInterface *iface);
 
@@ -129,287 +184,685 @@ ide_gettext_diagnostics_init (IdeGettextDiagnostics *self)
 }
 
 static void
-translation_unit_free (TranslationUnit *unit)
+result_clear (Result *result)
+{
+  g_clear_pointer (&result->message, g_free);
+}
+
+static GArray *
+result_array_new (void)
+{
+  GArray *ar;
+
+  ar = g_array_new (FALSE, FALSE, sizeof (Result));
+  g_array_set_clear_func (ar, (GDestroyNotify)result_clear);
+
+  return ar;
+}
+
+static FileState *
+file_state_new (IdeFile *file)
+{
+  FileState *state;
+
+  state = g_slice_new0 (FileState);
+  state->file = g_object_ref (file);
+  state->regions = g_hash_table_new_full (g_bytes_hash,
+                                          g_bytes_equal,
+                                          (GDestroyNotify)g_bytes_unref,
+                                          (GDestroyNotify)g_array_unref);
+  state->msgids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  state->waiting = g_ptr_array_new_with_free_func (g_object_unref);
+
+  return state;
+}
+
+static void
+file_state_free (FileState *state)
 {
-  if (unit != NULL)
+  if (state != NULL)
     {
-      g_clear_object (&unit->file);
-      g_clear_pointer (&unit->unsaved_file, ide_unsaved_file_unref);
-      g_slice_free (TranslationUnit, unit);
+      if (state->cancellable != NULL)
+        g_cancellable_cancel (state->cancellable);
+
+      g_clear_object (&state->file);
+      g_clear_object (&state->cached);
+      g_clear_object (&state->cancellable);
+      g_clear_pointer (&state->regions, g_hash_table_unref);
+      g_clear_pointer (&state->msgids, g_hash_table_unref);
+      g_clear_pointer (&state->waiting, g_ptr_array_unref);
+      g_slice_free (FileState, state);
     }
 }
 
-static IdeUnsavedFile *
-get_unsaved_file (IdeGettextDiagnosticProvider *self,
-                  IdeFile                      *file)
+static void
+run_free (Run *run)
 {
-  g_autoptr(GPtrArray) array = NULL;
-  IdeUnsavedFiles *unsaved_files;
-  IdeContext *context;
+  if (run != NULL)
+    {
+      g_clear_object (&run->self);
+      g_clear_object (&run->file);
+      g_clear_object (&run->cancellable);
+      g_clear_pointer (&run->content, g_bytes_unref);
+      g_clear_pointer (&run->regions, g_array_unref);
+      g_slice_free (Run, run);
+    }
+}
+
+static const gchar *
+id_to_xgettext_language (const gchar *id,
+                         gboolean    *split)
+{
+  static const struct {
+    const gchar *id;
+    const gchar *lang;
+    gboolean     split;
+  } id_to_lang[] = {
+    { "awk", "awk", FALSE },
+    { "c", "C", TRUE },
+    { "chdr", "C", TRUE },
+    { "cpp", "C++", TRUE },
+    { "js", "JavaScript", FALSE },
+    { "lisp", "Lisp", FALSE },
+    { "objc", "ObjectiveC", TRUE },
+    { "perl", "Perl", FALSE },
+    { "php", "PHP", FALSE },
+    { "python", "Python", FALSE },
+    { "sh", "Shell", FALSE },
+    { "tcl", "Tcl", FALSE },
+    { "vala", "Vala", TRUE }
+  };
+  gsize i;
+
+  if (id != NULL)
+    {
+      for (i = 0; i < G_N_ELEMENTS (id_to_lang); i++)
+        {
+          if (strcmp (id, id_to_lang[i].id) == 0)
+            {
+              *split = id_to_lang[i].split;
+              return id_to_lang[i].lang;
+            }
+        }
+    }
+
+  return NULL;
+}
+
+/*
+ * Builds the input for xgettext, with the regions which are not checked
+ * replaced by as many empty lines so the line numbers stay the same.
+ */
+static GBytes *
+run_build_input (Run *run)
+{
+  const gchar *data;
+  GString *str;
+  gsize len;
   guint i;
 
-  g_assert (IDE_IS_GETTEXT_DIAGNOSTIC_PROVIDER (self));
-  g_assert (IDE_IS_FILE (file));
+  g_assert (run != NULL);
 
-  context = ide_object_get_context (IDE_OBJECT (self));
-  unsaved_files = ide_context_get_unsaved_files (context);
-  array = ide_unsaved_files_to_array (unsaved_files);
+  data = g_bytes_get_data (run->content, &len);
+  str = g_string_sized_new (len);
 
-  for (i = 0; i < array->len; i++)
+  for (i = 0; i < run->regions->len; i++)
     {
-      IdeUnsavedFile *unsaved_file = g_ptr_array_index (array, i);
-      GFile *ufile = ide_unsaved_file_get_file (unsaved_file);
-      GFile *ifile = ide_file_get_file (file);
+      const IdeGettextRegion *region = &g_array_index (run->regions, IdeGettextRegion, i);
+      gsize j;
 
-      g_assert (G_IS_FILE (ufile));
-      g_assert (G_IS_FILE (ifile));
+      if (region->checked)
+        {
+          g_string_append_len (str, data + region->begin, region->end - region->begin);
+          continue;
+        }
 
-      if (g_file_equal (ufile, ifile))
-        return ide_unsaved_file_ref (unsaved_file);
+      for (j = region->begin; j < region->end; j++)
+        {
+          if (data [j] == '\n')
+            g_string_append_c (str, '\n');
+        }
     }
 
-  return NULL;
+  len = str->len;
+
+  return g_bytes_new_take (g_string_free (str, FALSE), len);
 }
 
-static void
-get_diagnostics_cb (GObject      *source_object,
-                    GAsyncResult *res,
-                    gpointer      user_data)
+static IdeGettextRegion *
+run_find_region (Run   *run,
+                 guint  line)
 {
-  EggTaskCache *cache = EGG_TASK_CACHE (source_object);
-  g_autoptr(GTask) task = user_data;
-  g_autoptr(IdeGettextDiagnostics) diags = NULL;
-  GError *error = NULL;
+  guint lo = 0;
+  guint hi = run->regions->len;
 
-  g_assert (EGG_IS_TASK_CACHE (cache));
-  g_assert (G_IS_TASK (task));
+  /* Find the last region starting at or before @line */
+  while (lo < hi)
+    {
+      guint mid = lo + (hi - lo) / 2;
 
-  diags = egg_task_cache_get_finish (cache, res, &error);
+      if (g_array_index (run->regions, IdeGettextRegion, mid).line <= line)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
 
-  if (diags == NULL)
-    g_task_return_error (task, error);
-  else
-    g_task_return_pointer (task, g_steal_pointer (&diags), g_object_unref);
+  return lo > 0 ? &g_array_index (run->regions, IdeGettextRegion, lo - 1) : NULL;
 }
 
-static void
-ide_gettext_diagnostic_provider_diagnose_async (IdeDiagnosticProvider *provider,
-                                                IdeFile               *file,
-                                                GCancellable          *cancellable,
-                                                GAsyncReadyCallback    callback,
-                                                gpointer               user_data)
+/*
+ * Parses the warnings of xgettext into the results of the checked regions.
+ * Returns %TRUE if every line of @stderr_buf was a located warning, which
+ * @n_located is set to the number of.
+ */
+static gboolean
+run_parse_output (Run    *run,
+                  GBytes *stderr_buf,
+                  guint  *n_located)
 {
-  IdeGettextDiagnosticProvider *self = (IdeGettextDiagnosticProvider *)provider;
-  g_autoptr(IdeUnsavedFile) unsaved_file = NULL;
-  IdeGettextDiagnostics *cached;
-  g_autoptr(GTask) task = NULL;
+  g_autofree gchar *str = NULL;
+  g_auto(GStrv) lines = NULL;
+  gboolean all_located = TRUE;
+  const gchar *data;
+  gsize len;
+  guint i;
 
-  g_return_if_fail (IDE_IS_GETTEXT_DIAGNOSTIC_PROVIDER (self));
-  g_return_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable));
+  g_assert (run != NULL);
+  g_assert (n_located != NULL);
 
-  task = g_task_new (self, cancellable, callback, user_data);
-  g_task_set_source_tag (task, ide_gettext_diagnostic_provider_diagnose_async);
+  *n_located = 0;
+
+  for (i = 0; i < run->regions->len; i++)
+    {
+      IdeGettextRegion *region = &g_array_index (run->regions, IdeGettextRegion, i);
+
+      if (region->checked)
+        region->results = result_array_new ();
+    }
+
+  if (stderr_buf == NULL)
+    return TRUE;
+
+  data = g_bytes_get_data (stderr_buf, &len);
+  str = g_strndup (data, len);
+  lines = g_strsplit (str, "\n", 0);
 
-  if (NULL != (cached = egg_task_cache_peek (self->diagnostics_cache, file)))
+  for (i = 0; lines [i] != NULL; i++)
     {
-      unsaved_file = get_unsaved_file (self, file);
+      const gchar *message;
+      IdeGettextRegion *region;
+      Result result;
+      guint lineno;
 
-      if (unsaved_file == NULL || (cached->sequence >= ide_unsaved_file_get_sequence (unsaved_file)))
+      if (!ide_gettext_parse_location (lines [i], &lineno, &message))
         {
-          g_task_return_pointer (task, g_object_ref (cached), g_object_unref);
-          return;
+          if (*g_strstrip (lines [i]) != '\0')
+            all_located = FALSE;
+          continue;
         }
+
+      (*n_located)++;
+
+      if (NULL == (region = run_find_region (run, lineno)) || !region->checked)
+        continue;
+
+      result.line = lineno - region->line;
+      result.message = g_strstrip (g_strdup (message));
+      g_array_append_val (region->results, result);
     }
 
-  egg_task_cache_get_async (self->diagnostics_cache,
-                            file,
-                            TRUE,
-                            cancellable,
-                            get_diagnostics_cb,
-                            g_steal_pointer (&task));
+  return all_located;
 }
 
-static IdeDiagnostics *
-ide_gettext_diagnostic_provider_diagnose_finish (IdeDiagnosticProvider  *provider,
-                                                 GAsyncResult           *result,
-                                                 GError                **error)
+static IdeGettextDiagnostics *
+run_create_diagnostics (Run *run)
 {
-  GTask *task = (GTask *)result;
-  g_autoptr(IdeGettextDiagnostics) object = NULL;
+  g_autoptr(GPtrArray) array = NULL;
+  g_autoptr(IdeDiagnostics) diagnostics = NULL;
+  guint i;
 
-  g_return_val_if_fail (IDE_IS_GETTEXT_DIAGNOSTIC_PROVIDER (provider), NULL);
-  g_return_val_if_fail (G_IS_TASK (task), NULL);
+  g_assert (run != NULL);
 
-  if (NULL == (object = g_task_propagate_pointer (task, error)))
-    return NULL;
+  array = g_ptr_array_new_with_free_func ((GDestroyNotify)ide_diagnostic_unref);
 
-  return ide_diagnostics_ref (object->diagnostics);
-}
+  for (i = 0; i < run->regions->len; i++)
+    {
+      const IdeGettextRegion *region = &g_array_index (run->regions, IdeGettextRegion, i);
+      guint j;
 
-static void
-diagnostic_provider_iface_init (IdeDiagnosticProviderInterface *iface)
-{
-  iface->diagnose_async = ide_gettext_diagnostic_provider_diagnose_async;
-  iface->diagnose_finish = ide_gettext_diagnostic_provider_diagnose_finish;
+      for (j = 0; j < region->results->len; j++)
+        {
+          const Result *result = &g_array_index (region->results, Result, j);
+          g_autoptr(IdeSourceLocation) loc = NULL;
+
+          loc = ide_source_location_new (run->file, region->line + result->line, 0, 0);
+          g_ptr_array_add (array, ide_diagnostic_new (IDE_DIAGNOSTIC_WARNING,
+                                                      result->message,
+                                                      loc));
+        }
+    }
+
+  diagnostics = ide_diagnostics_new (g_steal_pointer (&array));
+
+  return g_object_new (IDE_TYPE_GETTEXT_DIAGNOSTICS,
+                       "diagnostics", diagnostics,
+                       "sequence", run->sequence,
+                       NULL);
 }
 
+/*
+ * Remembers the results and the msgids of the regions of a completed run,
+ * for the next runs to skip the regions which did not change.
+ */
 static void
-ide_gettext_diagnostic_provider_finalize (GObject *object)
+file_state_update_regions (FileState *state,
+                           Run       *run)
 {
-  IdeGettextDiagnosticProvider *self = IDE_GETTEXT_DIAGNOSTIC_PROVIDER (object);
+  GHashTable *regions;
+  GHashTable *msgids;
+  guint i;
 
-  g_clear_object (&self->diagnostics_cache);
+  g_assert (state != NULL);
+  g_assert (run != NULL);
 
-  G_OBJECT_CLASS (ide_gettext_diagnostic_provider_parent_class)->finalize (object);
+  regions = g_hash_table_new_full (g_bytes_hash,
+                                   g_bytes_equal,
+                                   (GDestroyNotify)g_bytes_unref,
+                                   (GDestroyNotify)g_array_unref);
+  msgids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  for (i = 0; i < run->regions->len; i++)
+    {
+      const IdeGettextRegion *region = &g_array_index (run->regions, IdeGettextRegion, i);
+      guint j;
+
+      g_hash_table_insert (regions,
+                           g_bytes_new_from_bytes (run->content,
+                                                   region->begin,
+                                                   region->end - region->begin),
+                           g_array_ref (region->results));
+
+      for (j = 0; region->msgids != NULL && j < region->msgids->len; j++)
+        {
+          const gchar *msgid = g_ptr_array_index (region->msgids, j);
+          guint count = GPOINTER_TO_UINT (g_hash_table_lookup (msgids, msgid));
+
+          g_hash_table_insert (msgids, g_strdup (msgid), GUINT_TO_POINTER (count + 1));
+        }
+    }
+
+  g_clear_pointer (&state->regions, g_hash_table_unref);
+  state->regions = regions;
+
+  g_clear_pointer (&state->msgids, g_hash_table_unref);
+  state->msgids = msgids;
 }
 
 static void
-ide_gettext_diagnostic_provider_class_init (IdeGettextDiagnosticProviderClass *klass)
+run_complete (Run         *run,
+              GSubprocess *subprocess,
+              GBytes      *stderr_buf,
+              GError      *error)
 {
-  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  g_autoptr(IdeGettextDiagnostics) diagnostics = NULL;
+  g_autoptr(GPtrArray) waiting = NULL;
+  FileState *state;
+  guint i;
 
-  object_class->finalize = ide_gettext_diagnostic_provider_finalize;
+  g_assert (run != NULL);
+  g_assert (!subprocess || G_IS_SUBPROCESS (subprocess));
+
+  state = g_hash_table_lookup (run->self->files, run->file);
+
+  /* A newer run replaced this one and took over the waiting tasks */
+  if (state == NULL || state->cancellable != run->cancellable)
+    goto cleanup;
+
+  g_clear_object (&state->cancellable);
+
+  waiting = state->waiting;
+  state->waiting = g_ptr_array_new_with_free_func (g_object_unref);
+
+  if (error == NULL)
+    {
+      gboolean all_located;
+      guint n_located;
+
+      all_located = run_parse_output (run, stderr_buf, &n_located);
+
+      /*
+       * xgettext exits with an error status when a check fails, so that
+       * alone does not make the run incomplete. A run is only remembered
+       * when xgettext succeeded or had nothing but located warnings to
+       * report. Otherwise, the warnings it found are still returned, but
+       * the regions are checked again by the next run.
+       */
+      if (subprocess == NULL ||
+          g_subprocess_get_successful (subprocess) ||
+          (g_subprocess_get_if_exited (subprocess) && all_located))
+        {
+          diagnostics = run_create_diagnostics (run);
+          file_state_update_regions (state, run);
+          g_clear_object (&state->cached);
+          state->cached = g_object_ref (diagnostics);
+        }
+      else if (n_located > 0)
+        {
+          diagnostics = run_create_diagnostics (run);
+        }
+      else
+        {
+          error = g_error_new (G_IO_ERROR,
+                               G_IO_ERROR_FAILED,
+                               "xgettext failed to check the file");
+        }
+    }
+
+  for (i = 0; i < waiting->len; i++)
+    {
+      GTask *task = g_ptr_array_index (waiting, i);
+
+      if (g_task_return_error_if_cancelled (task))
+        continue;
+
+      if (error != NULL)
+        g_task_return_error (task, g_error_copy (error));
+      else
+        g_task_return_pointer (task, g_object_ref (diagnostics), g_object_unref);
+    }
+
+cleanup:
+  g_clear_error (&error);
+  run_free (run);
 }
 
+static void pump_runs (void);
+
 static void
-subprocess_wait_cb (GObject      *object,
-                    GAsyncResult *res,
-                    gpointer      user_data)
+communicate_cb (GObject      *object,
+                GAsyncResult *result,
+                gpointer      user_data)
 {
   GSubprocess *subprocess = (GSubprocess *)object;
-  g_autofree gchar *input_prefix = NULL;
-  g_autoptr(IdeDiagnostics) local_diags = NULL;
-  g_autoptr(GTask) task = user_data;
-  g_autoptr(GPtrArray) array = NULL;
-  g_autoptr(GDataInputStream) stderr_data_input = NULL;
-  GInputStream *stderr_input = NULL;
-  g_autoptr(IdeGettextDiagnostics) diags = NULL;
-  TranslationUnit *unit;
+  g_autoptr(GBytes) stderr_buf = NULL;
+  Run *run = user_data;
   GError *error = NULL;
 
   g_assert (G_IS_SUBPROCESS (subprocess));
-  g_assert (G_IS_TASK (task));
+  g_assert (run != NULL);
+
+  n_running--;
 
-  unit = g_task_get_task_data (task);
+  if (!g_subprocess_communicate_finish (subprocess, result, NULL, &stderr_buf, &error))
+    g_subprocess_force_exit (subprocess);
 
-  g_assert (unit != NULL);
+  run_complete (run, subprocess, stderr_buf, error);
 
-  if (!g_subprocess_wait_finish (subprocess, res, &error))
+  pump_runs ();
+}
+
+static void
+pump_runs (void)
+{
+  while (n_running < MAX_RUNNING && !g_queue_is_empty (&pending_runs))
     {
-      g_task_return_error (task, error);
-      return;
+      g_autoptr(GSubprocess) subprocess = NULL;
+      g_autoptr(GBytes) input = NULL;
+      Run *run = g_queue_pop_head (&pending_runs);
+      GError *error = NULL;
+      const gchar *args[] = {
+        "xgettext",
+        "--check=ellipsis-unicode",
+        "--check=quote-unicode",
+        "--check=space-ellipsis",
+        "-k_",
+        "-kN_",
+        "-L", run->language,
+        "-o", "-",
+        "-",
+        NULL
+      };
+
+      if (g_cancellable_set_error_if_cancelled (run->cancellable, &error))
+        {
+          run_complete (run, NULL, NULL, error);
+          continue;
+        }
+
+#ifdef IDE_ENABLE_TRACE
+      {
+        g_autofree gchar *str = NULL;
+        str = g_strjoinv (" ", (gchar **)args);
+        IDE_TRACE_MSG ("Launching '%s'", str);
+      }
+#endif
+
+      subprocess = g_subprocess_newv ((const gchar * const *)args,
+                                      G_SUBPROCESS_FLAGS_STDIN_PIPE
+                                      | G_SUBPROCESS_FLAGS_STDOUT_PIPE
+                                      | G_SUBPROCESS_FLAGS_STDERR_PIPE,
+                                      &error);
+
+      if (subprocess == NULL)
+        {
+          run_complete (run, NULL, NULL, error);
+          continue;
+        }
+
+      input = run_build_input (run);
+
+      n_running++;
+
+      g_subprocess_communicate_async (subprocess,
+                                      input,
+                                      run->cancellable,
+                                      communicate_cb,
+                                      run);
     }
+}
 
-  array = g_ptr_array_new_with_free_func ((GDestroyNotify)ide_diagnostic_unref);
-  if (g_subprocess_get_exit_status (subprocess) == 0)
-    goto out;
+static gboolean
+region_uses_msgid (const IdeGettextRegion *region,
+                   GHashTable             *msgids)
+{
+  guint i;
+
+  for (i = 0; region->msgids != NULL && i < region->msgids->len; i++)
+    {
+      if (g_hash_table_contains (msgids, g_ptr_array_index (region->msgids, i)))
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+static void
+region_add_msgids (const IdeGettextRegion *region,
+                   GHashTable             *msgids)
+{
+  guint i;
 
-  stderr_input = g_subprocess_get_stderr_pipe (subprocess);
-  stderr_data_input = g_data_input_stream_new (stderr_input);
-  input_prefix = g_strdup_printf ("%s:", ide_unsaved_file_get_temp_path (unit->unsaved_file));
+  for (i = 0; region->msgids != NULL && i < region->msgids->len; i++)
+    g_hash_table_add (msgids, g_ptr_array_index (region->msgids, i));
+}
+
+static void
+region_count_msgids (const IdeGettextRegion *region,
+                     GHashTable             *msgids)
+{
+  guint i;
 
-  for (;;)
+  for (i = 0; region->msgids != NULL && i < region->msgids->len; i++)
     {
-      g_autofree gchar *line = NULL;
-      gsize length;
+      gpointer msgid = g_ptr_array_index (region->msgids, i);
+      guint count = GPOINTER_TO_UINT (g_hash_table_lookup (msgids, msgid));
 
-      line = g_data_input_stream_read_line (stderr_data_input,
-                                            &length,
-                                            g_task_get_cancellable (task),
-                                            &error);
-      if (line == NULL)
-        break;
+      g_hash_table_insert (msgids, msgid, GUINT_TO_POINTER (count + 1));
+    }
+}
+
+/*
+ * Reuses the results of the last run for the regions which did not change
+ * and marks the other regions to be checked. Unchanged regions are checked
+ * as well when a msgid they use is used by a checked region, or was used
+ * by a different number of regions in the last run.
+ *
+ * Returns: %TRUE if any region is to be checked.
+ */
+static gboolean
+run_select_regions (Run       *run,
+                    FileState *state)
+{
+  g_autoptr(GHashTable) unchanged = NULL;
+  g_autoptr(GHashTable) recheck = NULL;
+  GHashTableIter iter;
+  gpointer key;
+  gpointer value;
+  const gchar *data;
+  gboolean check = FALSE;
+  gboolean changed;
+  guint i;
+
+  g_assert (run != NULL);
+  g_assert (state != NULL);
+
+  /* msgid → occurrences in the unchanged regions */
+  unchanged = g_hash_table_new (g_str_hash, g_str_equal);
+  /* msgids whose occurrences need to be checked again */
+  recheck = g_hash_table_new (g_str_hash, g_str_equal);
+
+  data = g_bytes_get_data (run->content, NULL);
 
-      if (g_str_has_prefix (line, input_prefix))
+  for (i = 0; i < run->regions->len; i++)
+    {
+      IdeGettextRegion *region = &g_array_index (run->regions, IdeGettextRegion, i);
+      g_autoptr(GBytes) contents = NULL;
+      GArray *results;
+
+      contents = g_bytes_new_static (data + region->begin, region->end - region->begin);
+
+      if (NULL != (results = g_hash_table_lookup (state->regions, contents)))
+        {
+          region->results = g_array_ref (results);
+          region_count_msgids (region, unchanged);
+        }
+      else
         {
-          gchar *p = line + strlen (input_prefix);
+          check = region->checked = TRUE;
+          region_add_msgids (region, recheck);
+        }
+    }
+
+  g_hash_table_iter_init (&iter, state->msgids);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      if (value != g_hash_table_lookup (unchanged, key))
+        g_hash_table_add (recheck, key);
+    }
 
-          if (g_ascii_isdigit (*p))
+  g_hash_table_iter_init (&iter, unchanged);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      if (value != g_hash_table_lookup (state->msgids, key))
+        g_hash_table_add (recheck, key);
+    }
+
+  /* Checking a region again can change the results of others in turn */
+  do
+    {
+      changed = FALSE;
+
+      for (i = 0; i < run->regions->len; i++)
+        {
+          IdeGettextRegion *region = &g_array_index (run->regions, IdeGettextRegion, i);
+
+          if (!region->checked && region_uses_msgid (region, recheck))
             {
-              gulong line_number = strtoul (p, &p, 10);
-              IdeSourceLocation *loc;
-              IdeDiagnostic *diag;
-
-              loc = ide_source_location_new (unit->file,
-                                             line_number - 1,
-                                             0,
-                                             0);
-              diag = ide_diagnostic_new (IDE_DIAGNOSTIC_WARNING,
-                                         g_strstrip (p + 1),
-                                         loc);
-              g_ptr_array_add (array, diag);
+              g_clear_pointer (&region->results, g_array_unref);
+              check = changed = region->checked = TRUE;
+              region_add_msgids (region, recheck);
             }
         }
     }
+  while (changed);
 
- out:
-  local_diags = ide_diagnostics_new (g_steal_pointer (&array));
-  diags = g_object_new (IDE_TYPE_GETTEXT_DIAGNOSTICS,
-                        "diagnostics", local_diags,
-                        "sequence", ide_unsaved_file_get_sequence (unit->unsaved_file),
-                        NULL);
-  g_task_return_pointer (task, g_steal_pointer (&diags), g_object_unref);
+  return check;
 }
 
-static const gchar *
-id_to_xgettext_language (const gchar *id)
+static void
+ide_gettext_diagnostic_provider_start_run (IdeGettextDiagnosticProvider *self,
+                                           FileState                    *state,
+                                           IdeUnsavedFile               *unsaved_file,
+                                           const gchar                  *language,
+                                           gboolean                      split)
 {
-  static const struct {
-    const gchar *id;
-    const gchar *lang;
-  } id_to_lang[] = {
-    { "awk", "awk" },
-    { "c", "C" },
-    { "chdr", "C" },
-    { "cpp", "C++" },
-    { "js", "JavaScript" },
-    { "lisp", "Lisp" },
-    { "objc", "ObjectiveC" },
-    { "perl", "Perl" },
-    { "php", "PHP" },
-    { "python", "Python" },
-    { "sh", "Shell" },
-    { "tcl", "Tcl" },
-    { "vala", "Vala" }
-  };
-  gsize i;
+  const gchar *data;
+  gboolean check;
+  gsize len;
+  Run *run;
 
-  if (id != NULL)
+  g_assert (IDE_IS_GETTEXT_DIAGNOSTIC_PROVIDER (self));
+  g_assert (state != NULL);
+  g_assert (state->cancellable == NULL);
+  g_assert (unsaved_file != NULL);
+  g_assert (language != NULL);
+
+  run = g_slice_new0 (Run);
+  run->self = g_object_ref (self);
+  run->file = g_object_ref (state->file);
+  run->content = g_bytes_ref (ide_unsaved_file_get_content (unsaved_file));
+  run->cancellable = g_cancellable_new ();
+  run->language = language;
+  run->sequence = ide_unsaved_file_get_sequence (unsaved_file);
+
+  data = g_bytes_get_data (run->content, &len);
+  run->regions = ide_gettext_split_regions (data, len, split, g_str_equal (language, "Vala"));
+  check = run_select_regions (run, state);
+
+  state->cancellable = g_object_ref (run->cancellable);
+  state->sequence = run->sequence;
+
+  if (!check)
     {
-      for (i = 0; i < G_N_ELEMENTS (id_to_lang); i++)
-        if (strcmp (id, id_to_lang[i].id) == 0)
-          return id_to_lang[i].lang;
+      run_complete (run, NULL, NULL, NULL);
+      return;
     }
 
-  return NULL;
+  g_queue_push_tail (&pending_runs, run);
+  pump_runs ();
 }
 
 static void
-populate_cache (EggTaskCache  *cache,
-                gconstpointer  key,
-                GTask         *task,
-                gpointer       user_data)
+ide_gettext_diagnostic_provider_diagnose_async (IdeDiagnosticProvider *provider,
+                                                IdeFile               *file,
+                                                GCancellable          *cancellable,
+                                                GAsyncReadyCallback    callback,
+                                                gpointer               user_data)
 {
-  IdeGettextDiagnosticProvider *self = user_data;
+  IdeGettextDiagnosticProvider *self = (IdeGettextDiagnosticProvider *)provider;
   g_autoptr(IdeUnsavedFile) unsaved_file = NULL;
-  g_autoptr(GSubprocess) subprocess = NULL;
+  g_autoptr(GTask) task = NULL;
   GtkSourceLanguage *language;
+  IdeUnsavedFiles *unsaved_files;
+  IdeContext *context;
   const gchar *language_id;
   const gchar *xgettext_lang;
-  const gchar *temp_path;
-  TranslationUnit *unit;
-  IdeFile *file = (IdeFile *)key;
-  GCancellable *cancellable;
-  GError *error = NULL;
-  GPtrArray *args;
+  FileState *state;
+  gboolean split = FALSE;
+  gint64 sequence;
 
-  g_assert (EGG_IS_TASK_CACHE (cache));
-  g_assert (IDE_IS_FILE (file));
-  g_assert (IDE_IS_GETTEXT_DIAGNOSTIC_PROVIDER (self));
+  g_return_if_fail (IDE_IS_GETTEXT_DIAGNOSTIC_PROVIDER (self));
+  g_return_if_fail (IDE_IS_FILE (file));
+  g_return_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable));
 
-  cancellable = g_task_get_cancellable (task);
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_source_tag (task, ide_gettext_diagnostic_provider_diagnose_async);
+
+  context = ide_object_get_context (IDE_OBJECT (self));
+  unsaved_files = ide_context_get_unsaved_files (context);
 
-  if (NULL == (unsaved_file = get_unsaved_file (self, file)))
+  if (NULL == (unsaved_file = ide_unsaved_files_get_unsaved_file (unsaved_files,
+                                                                  ide_file_get_file (file))))
     {
       g_task_return_new_error (task,
                                G_IO_ERROR,
@@ -420,7 +873,7 @@ populate_cache (EggTaskCache  *cache,
 
   if (NULL == (language = ide_file_get_language (file)) ||
       NULL == (language_id = gtk_source_language_get_id (language)) ||
-      NULL == (xgettext_lang = id_to_xgettext_language (language_id)))
+      NULL == (xgettext_lang = id_to_xgettext_language (language_id, &split)))
     {
       g_task_return_new_error (task,
                                G_IO_ERROR,
@@ -429,76 +882,111 @@ populate_cache (EggTaskCache  *cache,
       return;
     }
 
-  if (!ide_unsaved_file_persist (unsaved_file, cancellable, &error))
+  if (NULL == (state = g_hash_table_lookup (self->files, file)))
     {
-      g_task_return_error (task, error);
+      state = file_state_new (file);
+      g_hash_table_insert (self->files, g_object_ref (file), state);
+    }
+
+  state->last_used = g_get_monotonic_time ();
+  sequence = ide_unsaved_file_get_sequence (unsaved_file);
+
+  if (state->cached != NULL && state->cached->sequence >= sequence)
+    {
+      g_task_return_pointer (task, g_object_ref (state->cached), g_object_unref);
       return;
     }
 
-  temp_path = ide_unsaved_file_get_temp_path (unsaved_file);
+  g_ptr_array_add (state->waiting, g_steal_pointer (&task));
 
-  g_assert (temp_path != NULL);
+  if (state->cancellable != NULL)
+    {
+      /* Wait for the run in flight if it checks these contents already */
+      if (state->sequence >= sequence)
+        return;
 
-  args = g_ptr_array_new ();
-  g_ptr_array_add (args, "xgettext");
-  g_ptr_array_add (args, "--check=ellipsis-unicode");
-  g_ptr_array_add (args, "--check=quote-unicode");
-  g_ptr_array_add (args, "--check=space-ellipsis");
-  g_ptr_array_add (args, "-k_");
-  g_ptr_array_add (args, "-kN_");
-  g_ptr_array_add (args, "-L");
-  g_ptr_array_add (args, (gchar *)xgettext_lang);
-  g_ptr_array_add (args, "-o");
-  g_ptr_array_add (args, "-");
-  g_ptr_array_add (args, (gchar *)temp_path);
-  g_ptr_array_add (args, NULL);
+      g_cancellable_cancel (state->cancellable);
+      g_clear_object (&state->cancellable);
+    }
 
-#ifdef IDE_ENABLE_TRACE
-  {
-    g_autofree gchar *str = NULL;
-    str = g_strjoinv (" ", (gchar **)args->pdata);
-    IDE_TRACE_MSG ("Launching '%s'", str);
-  }
-#endif
+  ide_gettext_diagnostic_provider_start_run (self, state, unsaved_file, xgettext_lang, split);
+}
 
-  subprocess = g_subprocess_newv ((const gchar * const *)args->pdata,
-                                  G_SUBPROCESS_FLAGS_STDIN_PIPE
-                                  | G_SUBPROCESS_FLAGS_STDOUT_PIPE
-                                  | G_SUBPROCESS_FLAGS_STDERR_PIPE,
-                                  &error);
+static IdeDiagnostics *
+ide_gettext_diagnostic_provider_diagnose_finish (IdeDiagnosticProvider  *provider,
+                                                 GAsyncResult           *result,
+                                                 GError                **error)
+{
+  GTask *task = (GTask *)result;
+  g_autoptr(IdeGettextDiagnostics) object = NULL;
 
-  g_ptr_array_free (args, TRUE);
+  g_return_val_if_fail (IDE_IS_GETTEXT_DIAGNOSTIC_PROVIDER (provider), NULL);
+  g_return_val_if_fail (G_IS_TASK (task), NULL);
 
-  if (subprocess == NULL)
-    {
-      g_task_return_error (task, error);
-      return;
-    }
+  if (NULL == (object = g_task_propagate_pointer (task, error)))
+    return NULL;
+
+  return ide_diagnostics_ref (object->diagnostics);
+}
+
+static void
+diagnostic_provider_iface_init (IdeDiagnosticProviderInterface *iface)
+{
+  iface->diagnose_async = ide_gettext_diagnostic_provider_diagnose_async;
+  iface->diagnose_finish = ide_gettext_diagnostic_provider_diagnose_finish;
+}
+
+static gboolean
+remove_idle_state (gpointer key,
+                   gpointer value,
+                   gpointer user_data)
+{
+  FileState *state = value;
+  gint64 *now = user_data;
 
-  unit = g_slice_new0 (TranslationUnit);
-  unit->file = g_object_ref (file);
-  unit->unsaved_file = ide_unsaved_file_ref (unsaved_file);
-  g_task_set_task_data (task, unit, (GDestroyNotify)translation_unit_free);
+  return state->cancellable == NULL && (*now - state->last_used) > STATE_MAX_IDLE_USEC;
+}
 
-  g_subprocess_wait_async (subprocess,
-                           cancellable,
-                           subprocess_wait_cb,
-                           g_object_ref (task));
+static gboolean
+ide_gettext_diagnostic_provider_gc (gpointer user_data)
+{
+  IdeGettextDiagnosticProvider *self = user_data;
+  gint64 now = g_get_monotonic_time ();
+
+  g_assert (IDE_IS_GETTEXT_DIAGNOSTIC_PROVIDER (self));
+
+  g_hash_table_foreach_remove (self->files, remove_idle_state, &now);
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+ide_gettext_diagnostic_provider_finalize (GObject *object)
+{
+  IdeGettextDiagnosticProvider *self = IDE_GETTEXT_DIAGNOSTIC_PROVIDER (object);
+
+  ide_clear_source (&self->gc_handler);
+  g_clear_pointer (&self->files, g_hash_table_unref);
+
+  G_OBJECT_CLASS (ide_gettext_diagnostic_provider_parent_class)->finalize (object);
+}
+
+static void
+ide_gettext_diagnostic_provider_class_init (IdeGettextDiagnosticProviderClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = ide_gettext_diagnostic_provider_finalize;
 }
 
 static void
 ide_gettext_diagnostic_provider_init (IdeGettextDiagnosticProvider *self)
 {
-  self->diagnostics_cache = egg_task_cache_new ((GHashFunc)ide_file_hash,
-                                                (GEqualFunc)ide_file_equal,
-                                                g_object_ref,
-                                                g_object_unref,
-                                                g_object_ref,
-                                                g_object_unref,
-                                                20 * 1000L,
-                                                populate_cache,
-                                                self,
-                                                NULL);
-
-  egg_task_cache_set_name (self->diagnostics_cache, "gettext diagnostic cache");
+  self->files = g_hash_table_new_full ((GHashFunc)ide_file_hash,
+                                       (GEqualFunc)ide_file_equal,
+                                       g_object_unref,
+                                       (GDestroyNotify)file_state_free);
+  self->gc_handler = g_timeout_add_seconds (GC_INTERVAL_SECONDS,
+                                            ide_gettext_diagnostic_provider_gc,
+                                            self);
 }
@@ -0,0 +1,453 @@
+/* ide-gettext-regions.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "ide-gettext-regions.h"
+
+/* Nesting deeper than this is tracked, but never treated specially */
+#define MAX_TRACKED_DEPTH 64
+
+#define DEPTH_BIT(n) (G_GUINT64_CONSTANT (1) << (n))
+
+static void
+region_clear (IdeGettextRegion *region)
+{
+  g_clear_pointer (&region->results, g_array_unref);
+  g_clear_pointer (&region->msgids, g_ptr_array_unref);
+}
+
+static gboolean
+token_equal (const gchar *token,
+             gsize        len,
+             const gchar *str)
+{
+  return strlen (str) == len && strncmp (token, str, len) == 0;
+}
+
+static gboolean
+token_has_suffix (const gchar *token,
+                  gsize        len,
+                  const gchar *suffix)
+{
+  gsize suffix_len = strlen (suffix);
+
+  return suffix_len <= len && strncmp (token + len - suffix_len, suffix, suffix_len) == 0;
+}
+
+/*
+ * The keywords xgettext extracts messages from, either because of the
+ * "-k" options of the provider or because they are the defaults for C,
+ * such as gettext(), g_dngettext() or gettext_noop(). Matching a few more
+ * than xgettext does only causes more regions to be checked again.
+ */
+static gboolean
+is_gettext_keyword (const gchar *token,
+                    gsize        len)
+{
+  return token_equal (token, len, "_") ||
+         token_equal (token, len, "N_") ||
+         token_equal (token, len, "C_") ||
+         token_equal (token, len, "NC_") ||
+         token_equal (token, len, "Q_") ||
+         token_has_suffix (token, len, "gettext") ||
+         token_has_suffix (token, len, "gettext2") ||
+         token_has_suffix (token, len, "gettext_noop");
+}
+
+/*
+ * Keywords starting a declaration whose body contains other top-level
+ * declarations, such as the methods of a class or the extern "C" block
+ * of a header.
+ */
+static gboolean
+is_container_keyword (const gchar *token,
+                      gsize        len)
+{
+  return token_equal (token, len, "namespace") ||
+         token_equal (token, len, "class") ||
+         token_equal (token, len, "interface") ||
+         token_equal (token, len, "extern");
+}
+
+/*
+ * Appends the string literal @text with its escape sequences replaced by
+ * the bytes they stand for, so that "\x41" and "A" are the same msgid.
+ */
+static void
+append_unescaped (GString     *str,
+                  const gchar *text,
+                  gsize        len)
+{
+  gsize i = 0;
+
+  while (i < len)
+    {
+      gchar ch = text [i++];
+      gunichar uc;
+      guint n_digits;
+      guint n;
+
+      if (ch != '\\' || i == len)
+        {
+          g_string_append_c (str, ch);
+          continue;
+        }
+
+      ch = text [i++];
+
+      switch (ch)
+        {
+        case 'a': g_string_append_c (str, '\a'); break;
+        case 'b': g_string_append_c (str, '\b'); break;
+        case 'f': g_string_append_c (str, '\f'); break;
+        case 'n': g_string_append_c (str, '\n'); break;
+        case 'r': g_string_append_c (str, '\r'); break;
+        case 't': g_string_append_c (str, '\t'); break;
+        case 'v': g_string_append_c (str, '\v'); break;
+
+        case '0': case '1': case '2': case '3':
+        case '4': case '5': case '6': case '7':
+          n = ch - '0';
+          for (n_digits = 1; n_digits < 3 && i < len && text [i] >= '0' && text [i] <= '7'; n_digits++)
+            n = n * 8 + (text [i++] - '0');
+          g_string_append_c (str, (gchar)n);
+          break;
+
+        case 'x':
+          n = 0;
+          while (i < len && g_ascii_isxdigit (text [i]))
+            n = n * 16 + g_ascii_xdigit_value (text [i++]);
+          g_string_append_c (str, (gchar)n);
+          break;
+
+        case 'u':
+        case 'U':
+          uc = 0;
+          for (n_digits = 0; n_digits < (ch == 'u' ? 4 : 8) && i < len && g_ascii_isxdigit (text [i]); n_digits++)
+            uc = uc * 16 + g_ascii_xdigit_value (text [i++]);
+          g_string_append_unichar (str, uc);
+          break;
+
+        case '\n':
+          /* A line continuation */
+          break;
+
+        default:
+          /* Quotes, backslashes, question marks and unknown escapes */
+          g_string_append_c (str, ch);
+          break;
+        }
+    }
+}
+
+static void
+region_add_msgid (IdeGettextRegion *region,
+                  GString          *msgid)
+{
+  if (msgid->len == 0)
+    return;
+
+  if (region->msgids == NULL)
+    region->msgids = g_ptr_array_new_with_free_func (g_free);
+
+  g_ptr_array_add (region->msgids, g_strndup (msgid->str, msgid->len));
+  g_string_truncate (msgid, 0);
+}
+
+/**
+ * ide_gettext_split_regions:
+ * @text: the contents of the file
+ * @len: the length of @text
+ * @split: whether to split @text at all
+ * @verbatim_strings: whether @text may contain Vala """verbatim strings"""
+ *
+ * Splits @text into regions ending on a line which is blank or ends with a
+ * "}" or a ";", outside of comments, strings and parentheses. The line must
+ * be at the top level of the file, or directly within the body of a
+ * namespace, a class, an interface or an extern "C" block. This is enough
+ * of a C lexer to find the end of functions and of other declarations.
+ *
+ * The strings passed to gettext keywords are collected into the msgids of
+ * each region. Adjacent string literals are concatenated and their escape
+ * sequences are replaced, as xgettext does. Vala verbatim strings are
+ * taken as they are.
+ *
+ * If @split is %FALSE, all of @text is a single region.
+ *
+ * Returns: (transfer full): a #GArray of #IdeGettextRegion.
+ */
+GArray *
+ide_gettext_split_regions (const gchar *text,
+                           gsize        len,
+                           gboolean     split,
+                           gboolean     verbatim_strings)
+{
+  g_autoptr(GString) msgid = NULL;
+  IdeGettextRegion region = { 0 };
+  GArray *regions;
+  gboolean in_comment = FALSE;
+  gboolean in_verbatim = FALSE;
+  gboolean escaped = FALSE;
+  gboolean container = FALSE;
+  gboolean after_keyword = FALSE;
+  gchar quote = 0;
+  gchar last = 0;
+  /* Bit n is set when brace n + 1 opens the body of a container */
+  guint64 containers = 0;
+  /* Bit n is set when parenthesis n + 1 opens a call to a gettext keyword */
+  guint64 calls = 0;
+  guint n_containers = 0;
+  guint depth = 0;
+  guint parens = 0;
+  guint line = 0;
+  gsize literal = 0;
+  gsize i;
+
+  g_return_val_if_fail (text != NULL || len == 0, NULL);
+
+  regions = g_array_new (FALSE, FALSE, sizeof (IdeGettextRegion));
+  g_array_set_clear_func (regions, (GDestroyNotify)region_clear);
+
+  msgid = g_string_new (NULL);
+
+#define IN_GETTEXT_CALL() \
+  (parens > 0 && parens <= MAX_TRACKED_DEPTH && (calls & DEPTH_BIT (parens - 1)) != 0)
+
+  for (i = 0; split && i < len; i++)
+    {
+      gchar ch = text [i];
+
+      if (ch == '\n')
+        {
+          line++;
+
+          /* Unterminated character and string literals end with the line */
+          if (!escaped)
+            quote = 0;
+          escaped = FALSE;
+
+          if (depth == n_containers && parens == 0 &&
+              !in_comment && !in_verbatim && quote == 0 &&
+              (last == 0 || last == ';' || last == '}'))
+            {
+              region.end = i + 1;
+              g_array_append_val (regions, region);
+
+              region.begin = i + 1;
+              region.line = line;
+              region.msgids = NULL;
+            }
+
+          last = 0;
+        }
+      else if (in_comment)
+        {
+          if (ch == '*' && i + 1 < len && text [i + 1] == '/')
+            {
+              in_comment = FALSE;
+              i++;
+            }
+        }
+      else if (in_verbatim)
+        {
+          if (ch == '"' && i + 2 < len && text [i + 1] == '"' && text [i + 2] == '"')
+            {
+              if (IN_GETTEXT_CALL ())
+                g_string_append_len (msgid, text + literal, i - literal);
+              in_verbatim = FALSE;
+              i += 2;
+            }
+        }
+      else if (quote != 0)
+        {
+          if (escaped)
+            escaped = FALSE;
+          else if (ch == '\\')
+            escaped = TRUE;
+          else if (ch == quote)
+            {
+              if (quote == '"' && IN_GETTEXT_CALL ())
+                append_unescaped (msgid, text + literal, i - literal);
+              quote = 0;
+            }
+        }
+      else if (ch == '/' && i + 1 < len && text [i + 1] == '/')
+        {
+          /* Leave the newline to the next iteration */
+          while (i + 1 < len && text [i + 1] != '\n')
+            i++;
+        }
+      else if (ch == '/' && i + 1 < len && text [i + 1] == '*')
+        {
+          in_comment = TRUE;
+          i++;
+        }
+      else if (verbatim_strings && ch == '"' && i + 2 < len && text [i + 1] == '"' && text [i + 2] == '"')
+        {
+          in_verbatim = TRUE;
+          after_keyword = FALSE;
+          literal = i + 3;
+          last = ch;
+          i += 2;
+        }
+      else if (ch == '"' || ch == '\'')
+        {
+          quote = ch;
+          after_keyword = FALSE;
+          literal = i + 1;
+          last = ch;
+        }
+      else if (g_ascii_isalpha (ch) || ch == '_')
+        {
+          gsize begin = i;
+
+          while (i + 1 < len && (g_ascii_isalnum (text [i + 1]) || text [i + 1] == '_'))
+            i++;
+
+          after_keyword = is_gettext_keyword (text + begin, i + 1 - begin);
+          if (is_container_keyword (text + begin, i + 1 - begin))
+            container = TRUE;
+
+          last = text [i];
+        }
+      else if (!g_ascii_isspace (ch))
+        {
+          switch (ch)
+            {
+            case '{':
+              if (container && depth < MAX_TRACKED_DEPTH)
+                {
+                  containers |= DEPTH_BIT (depth);
+                  n_containers++;
+                }
+              depth++;
+              container = FALSE;
+              break;
+
+            case '}':
+              if (depth > 0)
+                {
+                  depth--;
+                  if (depth < MAX_TRACKED_DEPTH && (containers & DEPTH_BIT (depth)) != 0)
+                    {
+                      containers &= ~DEPTH_BIT (depth);
+                      n_containers--;
+                    }
+                }
+              container = FALSE;
+              break;
+
+            case '(':
+              if (parens < MAX_TRACKED_DEPTH)
+                {
+                  if (after_keyword)
+                    calls |= DEPTH_BIT (parens);
+                  else
+                    calls &= ~DEPTH_BIT (parens);
+                }
+              parens++;
+              container = FALSE;
+              break;
+
+            case ')':
+              if (IN_GETTEXT_CALL ())
+                region_add_msgid (&region, msgid);
+              if (parens > 0)
+                parens--;
+              container = FALSE;
+              break;
+
+            case ',':
+              if (IN_GETTEXT_CALL ())
+                region_add_msgid (&region, msgid);
+              break;
+
+            case ';':
+              container = FALSE;
+              break;
+
+            default:
+              break;
+            }
+
+          after_keyword = FALSE;
+          last = ch;
+        }
+    }
+
+#undef IN_GETTEXT_CALL
+
+  /* A call left open at the end of the file */
+  region_add_msgid (&region, msgid);
+
+  if (region.begin < len)
+    {
+      region.end = len;
+      g_array_append_val (regions, region);
+    }
+  else
+    {
+      region_clear (&region);
+    }
+
+  return regions;
+}
+
+/**
+ * ide_gettext_parse_location:
+ * @line: a line written by xgettext
+ * @lineno: (out): a location for the line, starting from 0
+ * @message: (out): a location for the message following the line number
+ *
+ * Parses a line such as "standard input:12: message". The name of the
+ * input is translated, so only the line number is looked for.
+ *
+ * Returns: %TRUE if @line starts with a location.
+ */
+gboolean
+ide_gettext_parse_location (const gchar  *line,
+                            guint        *lineno,
+                            const gchar **message)
+{
+  const gchar *p;
+
+  g_return_val_if_fail (line != NULL, FALSE);
+  g_return_val_if_fail (lineno != NULL, FALSE);
+  g_return_val_if_fail (message != NULL, FALSE);
+
+  for (p = strchr (line, ':'); p != NULL; p = strchr (p + 1, ':'))
+    {
+      if (g_ascii_isdigit (p [1]))
+        {
+          gchar *end = NULL;
+          guint64 n;
+
+          n = g_ascii_strtoull (p + 1, &end, 10);
+
+          if (*end == ':' && n > 0 && n <= G_MAXUINT)
+            {
+              *lineno = n - 1;
+              *message = end + 1;
+              return TRUE;
+            }
+        }
+    }
+
+  return FALSE;
+}
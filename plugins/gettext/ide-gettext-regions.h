@@ -0,0 +1,49 @@
+/* ide-gettext-regions.h
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IDE_GETTEXT_REGIONS_H
+#define IDE_GETTEXT_REGIONS_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct
+{
+  gsize      begin;
+  gsize      end;
+  guint      line;
+  /* Whether the region is checked by the run, otherwise it is unchanged */
+  guint      checked : 1;
+  /* Results of the diagnostic provider, with lines relative to the region */
+  GArray    *results;
+  /* The strings passed to gettext keywords, or %NULL if there are none */
+  GPtrArray *msgids;
+} IdeGettextRegion;
+
+GArray   *ide_gettext_split_regions  (const gchar  *text,
+                                      gsize         len,
+                                      gboolean      split,
+                                      gboolean      verbatim_strings);
+gboolean  ide_gettext_parse_location (const gchar  *line,
+                                      guint        *lineno,
+                                      const gchar **message);
+
+G_END_DECLS
+
+#endif /* IDE_GETTEXT_REGIONS_H */
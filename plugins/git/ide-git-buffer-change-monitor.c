@@ -305,6 +305,10 @@ ide_git_buffer_change_monitor__buffer_delete_range_cb (IdeGitBufferChangeMonitor
   g_assert (end);
   g_assert (IDE_IS_BUFFER (buffer));
 
+  /* Bulk edits recalculate once when they complete */
+  if (ide_buffer_get_in_bulk_edit (buffer))
+    IDE_EXIT;
+
   /*
    * We need to recalculate the diff when text is deleted if:
    *
@@ -351,6 +355,9 @@ ide_git_buffer_change_monitor__buffer_insert_text_after_cb (IdeGitBufferChangeMo
   g_assert (text);
   g_assert (IDE_IS_BUFFER (buffer));
 
+  if (ide_buffer_get_in_bulk_edit (buffer))
+    IDE_EXIT;
+
   /*
    * We need to recalculate the diff when text is inserted if:
    *
@@ -401,7 +408,7 @@ ide_git_buffer_change_monitor__buffer_changed_after_cb (IdeGitBufferChangeMonito
 
   self->state_dirty = TRUE;
 
-  if (self->in_calculation)
+  if (self->in_calculation || ide_buffer_get_in_bulk_edit (buffer))
     IDE_EXIT;
 
   if (self->changed_timeout)
@@ -414,6 +421,28 @@ ide_git_buffer_change_monitor__buffer_changed_after_cb (IdeGitBufferChangeMonito
   IDE_EXIT;
 }
 
+static void
+ide_git_buffer_change_monitor__buffer_bulk_edit_finished_cb (IdeGitBufferChangeMonitor *self,
+                                                             const GtkTextIter         *begin,
+                                                             const GtkTextIter         *end,
+                                                             IdeBuffer                 *buffer)
+{
+  IDE_ENTRY;
+
+  g_assert (IDE_IS_GIT_BUFFER_CHANGE_MONITOR (self));
+  g_assert (IDE_IS_BUFFER (buffer));
+
+  if (self->changed_timeout != 0)
+    {
+      g_source_remove (self->changed_timeout);
+      self->changed_timeout = 0;
+    }
+
+  ide_git_buffer_change_monitor_recalculate (self);
+
+  IDE_EXIT;
+}
+
 static void
 ide_git_buffer_change_monitor_reload (IdeBufferChangeMonitor *monitor)
 {
@@ -786,6 +815,11 @@ ide_git_buffer_change_monitor_init (IdeGitBufferChangeMonitor *self)
                                    G_CALLBACK (ide_git_buffer_change_monitor__buffer_changed_after_cb),
                                    self,
                                    G_CONNECT_SWAPPED | G_CONNECT_AFTER);
+  egg_signal_group_connect_object (self->signal_group,
+                                   "bulk-edit-finished",
+                                   G_CALLBACK (ide_git_buffer_change_monitor__buffer_bulk_edit_finished_cb),
+                                   self,
+                                   G_CONNECT_SWAPPED);
 
   self->vcs_signal_group = egg_signal_group_new (IDE_TYPE_GIT_VCS);
   egg_signal_group_connect_object (self->vcs_signal_group,
@@ -38,10 +38,29 @@ struct _IdeGitVcs
   GFile          *working_directory;
   GFileMonitor   *monitor;
 
+  /*
+   * The ignore matcher is rebuilt by the reload worker, so it is protected
+   * by ignore_mutex. ignore_dirty requests a full rebuild, while
+   * ignore_dirty_dirs contains the directories (relative to the working
+   * directory) whose ignore files changed. ignore_sources contains every
+   * file the matcher was built from, and ignore_files is a copy of it
+   * waiting to be monitored from the main thread, which happens in
+   * ignore_monitors. ignore_head_tree is the tree of HEAD at that time.
+   */
+  GMutex               ignore_mutex;
+  IdeVcsIgnoreMatcher *ignore_matcher;
+  GPtrArray           *ignore_dirty_dirs;
+  GPtrArray           *ignore_sources;
+  GPtrArray           *ignore_files;
+  GPtrArray           *ignore_monitors;
+  GgitOId             *ignore_head_tree;
+
   guint           changed_timeout;
 
   guint           reloading : 1;
   guint           loaded_files : 1;
+  guint           ignore_dirty : 1;
+  guint           ignore_head_changed : 1;
 };
 
 static void     g_async_initable_init_interface (GAsyncInitableIface  *iface);
@@ -259,6 +278,61 @@ ide_git_vcs__changed_timeout_cb (gpointer user_data)
   IDE_RETURN (G_SOURCE_REMOVE);
 }
 
+static void
+ide_git_vcs_queue_reload (IdeGitVcs *self)
+{
+  g_assert (IDE_IS_GIT_VCS (self));
+
+  if (self->changed_timeout != 0)
+    g_source_remove (self->changed_timeout);
+
+  self->changed_timeout = g_timeout_add_seconds (DEFAULT_CHANGED_TIMEOUT_SECS,
+                                                 ide_git_vcs__changed_timeout_cb,
+                                                 self);
+}
+
+/*
+ * Marks the ignore rules read from @file as stale. For a .gitignore of the
+ * working directory, only the subtree of its directory is read again on the
+ * next reload. Other files (such as .git/info/exclude) apply everywhere and
+ * require a full rebuild.
+ */
+static void
+ide_git_vcs_invalidate_ignore_file (IdeGitVcs *self,
+                                    GFile     *file)
+{
+  g_autoptr(GFile) parent = NULL;
+  g_autofree gchar *name = NULL;
+  gchar *relative_path = NULL;
+
+  g_assert (IDE_IS_GIT_VCS (self));
+  g_assert (G_IS_FILE (file));
+
+  name = g_file_get_basename (file);
+  parent = g_file_get_parent (file);
+
+  if (g_strcmp0 (name, ".gitignore") == 0 && parent != NULL)
+    {
+      if (g_file_equal (parent, self->working_directory))
+        relative_path = g_strdup ("");
+      else
+        relative_path = g_file_get_relative_path (self->working_directory, parent);
+    }
+
+  g_mutex_lock (&self->ignore_mutex);
+  if (relative_path == NULL)
+    {
+      self->ignore_dirty = TRUE;
+    }
+  else
+    {
+      if (self->ignore_dirty_dirs == NULL)
+        self->ignore_dirty_dirs = g_ptr_array_new_with_free_func (g_free);
+      g_ptr_array_add (self->ignore_dirty_dirs, relative_path);
+    }
+  g_mutex_unlock (&self->ignore_mutex);
+}
+
 static void
 ide_git_vcs__monitor_changed_cb (IdeGitVcs         *self,
                                  GFile             *file,
@@ -270,16 +344,98 @@ ide_git_vcs__monitor_changed_cb (IdeGitVcs         *self,
 
   g_assert (IDE_IS_GIT_VCS (self));
 
-  if (self->changed_timeout != 0)
-    g_source_remove (self->changed_timeout);
+  /*
+   * A checkout can add, change or remove ignore files. The reload worker
+   * compares the trees of the old and new HEAD to find them.
+   */
+  g_mutex_lock (&self->ignore_mutex);
+  self->ignore_head_changed = TRUE;
+  g_mutex_unlock (&self->ignore_mutex);
 
-  self->changed_timeout = g_timeout_add_seconds (DEFAULT_CHANGED_TIMEOUT_SECS,
-                                                 ide_git_vcs__changed_timeout_cb,
-                                                 self);
+  ide_git_vcs_queue_reload (self);
 
   IDE_EXIT;
 }
 
+static void
+ide_git_vcs__ignore_file_changed_cb (IdeGitVcs         *self,
+                                     GFile             *file,
+                                     GFile             *other_file,
+                                     GFileMonitorEvent  event_type,
+                                     GFileMonitor      *monitor)
+{
+  IDE_ENTRY;
+
+  g_assert (IDE_IS_GIT_VCS (self));
+  g_assert (G_IS_FILE (file));
+
+  ide_git_vcs_invalidate_ignore_file (self, file);
+  ide_git_vcs_queue_reload (self);
+
+  IDE_EXIT;
+}
+
+static void
+ide_git_vcs__buffer_saved_cb (IdeGitVcs        *self,
+                              IdeBuffer        *buffer,
+                              IdeBufferManager *buffer_manager)
+{
+  g_autofree gchar *name = NULL;
+  IdeFile *file;
+
+  g_assert (IDE_IS_GIT_VCS (self));
+  g_assert (IDE_IS_BUFFER (buffer));
+  g_assert (IDE_IS_BUFFER_MANAGER (buffer_manager));
+
+  /* Existing ignore files are monitored, but new ones are not */
+  file = ide_buffer_get_file (buffer);
+  name = g_file_get_basename (ide_file_get_file (file));
+
+  if (g_strcmp0 (name, ".gitignore") == 0)
+    {
+      ide_git_vcs_invalidate_ignore_file (self, ide_file_get_file (file));
+      ide_git_vcs_queue_reload (self);
+    }
+}
+
+static void
+ide_git_vcs_monitor_ignore_files (IdeGitVcs *self)
+{
+  g_autoptr(GPtrArray) files = NULL;
+
+  g_assert (IDE_IS_GIT_VCS (self));
+
+  g_mutex_lock (&self->ignore_mutex);
+  files = g_steal_pointer (&self->ignore_files);
+  g_mutex_unlock (&self->ignore_mutex);
+
+  /* The matcher was not rebuilt during this reload */
+  if (files == NULL)
+    return;
+
+  for (guint i = 0; i < self->ignore_monitors->len; i++)
+    g_file_monitor_cancel (g_ptr_array_index (self->ignore_monitors, i));
+  g_ptr_array_set_size (self->ignore_monitors, 0);
+
+  for (guint i = 0; i < files->len; i++)
+    {
+      GFile *file = g_ptr_array_index (files, i);
+      GFileMonitor *monitor;
+
+      if (!(monitor = g_file_monitor_file (file, G_FILE_MONITOR_NONE, NULL, NULL)))
+        continue;
+
+      g_signal_connect_object (monitor,
+                               "changed",
+                               G_CALLBACK (ide_git_vcs__ignore_file_changed_cb),
+                               self,
+                               G_CONNECT_SWAPPED);
+      g_ptr_array_add (self->ignore_monitors, monitor);
+    }
+
+  IDE_TRACE_MSG ("Monitoring %u ignore files", self->ignore_monitors->len);
+}
+
 static gboolean
 ide_git_vcs_load_monitor (IdeGitVcs  *self,
                           GError    **error)
@@ -320,6 +476,307 @@ ide_git_vcs_load_monitor (IdeGitVcs  *self,
   return ret;
 }
 
+static void
+ide_git_vcs_load_ignore_directory (IdeVcsIgnoreMatcher *matcher,
+                                   GFile               *directory,
+                                   const gchar         *relative_path,
+                                   GPtrArray           *ignore_files,
+                                   GCancellable        *cancellable)
+{
+  g_autoptr(GFileEnumerator) enumerator = NULL;
+  g_autoptr(GFile) ignore_file = NULL;
+  g_autofree gchar *contents = NULL;
+  gpointer infoptr;
+
+  g_assert (matcher != NULL);
+  g_assert (G_IS_FILE (directory));
+  g_assert (ignore_files != NULL);
+
+  if (g_cancellable_is_cancelled (cancellable))
+    return;
+
+  ignore_file = g_file_get_child (directory, ".gitignore");
+
+  if (g_file_load_contents (ignore_file, cancellable, &contents, NULL, NULL, NULL))
+    {
+      ide_vcs_ignore_matcher_add_patterns (matcher, relative_path, contents);
+      g_ptr_array_add (ignore_files, g_steal_pointer (&ignore_file));
+    }
+
+  enumerator = g_file_enumerate_children (directory,
+                                          G_FILE_ATTRIBUTE_STANDARD_NAME","
+                                          G_FILE_ATTRIBUTE_STANDARD_TYPE,
+                                          G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                          cancellable,
+                                          NULL);
+
+  if (enumerator == NULL)
+    return;
+
+  while ((infoptr = g_file_enumerator_next_file (enumerator, cancellable, NULL)))
+    {
+      g_autoptr(GFileInfo) info = infoptr;
+      g_autofree gchar *child_path = NULL;
+      g_autoptr(GFile) child = NULL;
+      const gchar *name;
+
+      if (g_file_info_get_file_type (info) != G_FILE_TYPE_DIRECTORY)
+        continue;
+
+      name = g_file_info_get_name (info);
+
+      if (relative_path != NULL)
+        child_path = g_build_filename (relative_path, name, NULL);
+      else
+        child_path = g_strdup (name);
+
+      /* Like git, don't look for ignore files within ignored directories */
+      if (ide_vcs_ignore_matcher_is_ignored (matcher, child_path, TRUE))
+        continue;
+
+      child = g_file_get_child (directory, name);
+
+      ide_git_vcs_load_ignore_directory (matcher, child, child_path, ignore_files, cancellable);
+    }
+}
+
+static void
+ide_git_vcs_load_global_ignore_file (IdeVcsIgnoreMatcher *matcher,
+                                     GFile               *file,
+                                     GPtrArray           *ignore_files,
+                                     GCancellable        *cancellable)
+{
+  g_autofree gchar *contents = NULL;
+
+  g_assert (matcher != NULL);
+  g_assert (G_IS_FILE (file));
+  g_assert (ignore_files != NULL);
+
+  if (g_file_load_contents (file, cancellable, &contents, NULL, NULL, NULL))
+    {
+      ide_vcs_ignore_matcher_add_global_patterns (matcher, contents);
+      g_ptr_array_add (ignore_files, g_object_ref (file));
+    }
+}
+
+/*
+ * Compiles the rules of .git/info/exclude, core.excludesFile and every
+ * .gitignore of the working directory into an IdeVcsIgnoreMatcher, so that
+ * checking whether a file is ignored does not need to go through libgit2.
+ */
+static IdeVcsIgnoreMatcher *
+ide_git_vcs_build_ignore_matcher (GgitRepository *repository,
+                                  GPtrArray      *ignore_files,
+                                  GCancellable   *cancellable)
+{
+  g_autoptr(IdeVcsIgnoreMatcher) matcher = NULL;
+  g_autoptr(GgitConfig) config = NULL;
+  g_autoptr(GgitConfig) snapshot = NULL;
+  g_autoptr(GFile) location = NULL;
+  g_autoptr(GFile) exclude = NULL;
+  g_autoptr(GFile) excludes_file = NULL;
+  g_autoptr(GFile) workdir = NULL;
+  g_autofree gchar *default_excludes_path = NULL;
+  g_autofree gchar *home_excludes_path = NULL;
+  const gchar *excludes_path = NULL;
+
+  IDE_ENTRY;
+
+  g_assert (GGIT_IS_REPOSITORY (repository));
+  g_assert (ignore_files != NULL);
+
+  matcher = ide_vcs_ignore_matcher_new ();
+
+  /* Never look inside of the repository itself */
+  ide_vcs_ignore_matcher_add_global_patterns (matcher, ".git\n");
+
+  location = ggit_repository_get_location (repository);
+  exclude = g_file_resolve_relative_path (location, "info/exclude");
+  ide_git_vcs_load_global_ignore_file (matcher, exclude, ignore_files, cancellable);
+
+  if ((config = ggit_repository_get_config (repository, NULL)) &&
+      (snapshot = ggit_config_snapshot (config, NULL)))
+    excludes_path = ggit_config_get_string (snapshot, "core.excludesfile", NULL);
+
+  if (excludes_path == NULL)
+    excludes_path = default_excludes_path = g_build_filename (g_get_user_config_dir (), "git", "ignore", NULL);
+  else if (g_str_has_prefix (excludes_path, "~/"))
+    excludes_path = home_excludes_path = g_build_filename (g_get_home_dir (), excludes_path + 2, NULL);
+
+  excludes_file = g_file_new_for_path (excludes_path);
+
+  ide_git_vcs_load_global_ignore_file (matcher, excludes_file, ignore_files, cancellable);
+
+  if ((workdir = ggit_repository_get_workdir (repository)))
+    ide_git_vcs_load_ignore_directory (matcher, workdir, NULL, ignore_files, cancellable);
+
+  IDE_TRACE_MSG ("Loaded %u ignore files", ignore_files->len);
+
+  IDE_RETURN (g_steal_pointer (&matcher));
+}
+
+static GgitOId *
+ide_git_vcs_get_head_tree_id (GgitRepository *repository)
+{
+  g_autoptr(GgitRef) head = NULL;
+  g_autoptr(GgitObject) commit = NULL;
+  g_autoptr(GgitTree) tree = NULL;
+  GgitOId *oid;
+
+  g_assert (GGIT_IS_REPOSITORY (repository));
+
+  if (!(head = ggit_repository_get_head (repository, NULL)) ||
+      !(oid = ggit_ref_get_target (head)))
+    return NULL;
+
+  commit = ggit_repository_lookup (repository, oid, GGIT_TYPE_COMMIT, NULL);
+  ggit_oid_free (oid);
+
+  if (commit == NULL || !(tree = ggit_commit_get_tree (GGIT_COMMIT (commit))))
+    return NULL;
+
+  return ggit_object_get_id (GGIT_OBJECT (tree));
+}
+
+static gint
+collect_ignore_dirs_cb (GgitDiffDelta *delta,
+                        gfloat         progress,
+                        gpointer       user_data)
+{
+  GPtrArray *dirs = user_data;
+  GgitDiffFile *files[] = {
+    ggit_diff_delta_get_old_file (delta),
+    ggit_diff_delta_get_new_file (delta),
+  };
+
+  for (guint i = 0; i < G_N_ELEMENTS (files); i++)
+    {
+      g_autofree gchar *name = NULL;
+      const gchar *path;
+
+      if (files [i] == NULL || !(path = ggit_diff_file_get_path (files [i])))
+        continue;
+
+      name = g_path_get_basename (path);
+
+      if (g_strcmp0 (name, ".gitignore") == 0)
+        {
+          gchar *dir = g_path_get_dirname (path);
+
+          if (g_strcmp0 (dir, ".") == 0)
+            dir [0] = '\0';
+
+          g_ptr_array_add (dirs, dir);
+        }
+    }
+
+  return 0;
+}
+
+/*
+ * Adds the directories of the .gitignore files that differ between the
+ * trees @old_id and @new_id to @dirs.
+ */
+static gboolean
+ide_git_vcs_collect_changed_ignore_dirs (GgitRepository  *repository,
+                                         GgitOId         *old_id,
+                                         GgitOId         *new_id,
+                                         GPtrArray       *dirs,
+                                         GError         **error)
+{
+  g_autoptr(GgitTree) old_tree = NULL;
+  g_autoptr(GgitTree) new_tree = NULL;
+  g_autoptr(GgitDiff) diff = NULL;
+
+  g_assert (GGIT_IS_REPOSITORY (repository));
+  g_assert (old_id != NULL);
+  g_assert (new_id != NULL);
+  g_assert (dirs != NULL);
+
+  if (!(old_tree = ggit_repository_lookup_tree (repository, old_id, error)) ||
+      !(new_tree = ggit_repository_lookup_tree (repository, new_id, error)) ||
+      !(diff = ggit_diff_new_tree_to_tree (repository, old_tree, new_tree, NULL, error)))
+    return FALSE;
+
+  return ggit_diff_foreach (diff, collect_ignore_dirs_cb, NULL, NULL, NULL, dirs, error);
+}
+
+/*
+ * Creates a new matcher from @base, reading the ignore files below each of
+ * @dirs again instead of walking the whole working directory. @sources is
+ * updated to contain the files of the new matcher.
+ */
+static IdeVcsIgnoreMatcher *
+ide_git_vcs_update_ignore_matcher (GgitRepository       *repository,
+                                   IdeVcsIgnoreMatcher  *base,
+                                   GPtrArray            *dirs,
+                                   GPtrArray           **sources,
+                                   GCancellable         *cancellable)
+{
+  g_autoptr(IdeVcsIgnoreMatcher) matcher = NULL;
+  g_autoptr(GFile) workdir = NULL;
+
+  IDE_ENTRY;
+
+  g_assert (GGIT_IS_REPOSITORY (repository));
+  g_assert (base != NULL);
+  g_assert (dirs != NULL);
+  g_assert (sources != NULL && *sources != NULL);
+
+  matcher = ide_vcs_ignore_matcher_ref (base);
+
+  if (!(workdir = ggit_repository_get_workdir (repository)))
+    IDE_RETURN (g_steal_pointer (&matcher));
+
+  for (guint i = 0; i < dirs->len; i++)
+    {
+      const gchar *relative_path = g_ptr_array_index (dirs, i);
+      g_autoptr(IdeVcsIgnoreMatcher) next = NULL;
+      g_autoptr(GPtrArray) kept = NULL;
+      g_autoptr(GFile) directory = NULL;
+
+      if (*relative_path == '\0')
+        directory = g_object_ref (workdir);
+      else
+        directory = g_file_resolve_relative_path (workdir, relative_path);
+
+      /* Drop the .gitignore files of the subtree, keep everything else */
+      kept = g_ptr_array_new_with_free_func (g_object_unref);
+
+      for (guint j = 0; j < (*sources)->len; j++)
+        {
+          GFile *file = g_ptr_array_index (*sources, j);
+          g_autofree gchar *name = g_file_get_basename (file);
+
+          if (g_strcmp0 (name, ".gitignore") == 0 && g_file_has_prefix (file, directory))
+            continue;
+
+          g_ptr_array_add (kept, g_object_ref (file));
+        }
+
+      g_ptr_array_unref (*sources);
+      *sources = g_steal_pointer (&kept);
+
+      next = ide_vcs_ignore_matcher_new_without (matcher, relative_path);
+      g_clear_pointer (&matcher, ide_vcs_ignore_matcher_unref);
+      matcher = g_steal_pointer (&next);
+
+      /* Like git, don't look for ignore files within ignored directories */
+      if (*relative_path != '\0' && ide_vcs_ignore_matcher_is_ignored (matcher, relative_path, TRUE))
+        continue;
+
+      ide_git_vcs_load_ignore_directory (matcher,
+                                         directory,
+                                         *relative_path ? relative_path : NULL,
+                                         *sources,
+                                         cancellable);
+    }
+
+  IDE_TRACE_MSG ("Reloaded ignore files of %u directories", dirs->len);
+
+  IDE_RETURN (g_steal_pointer (&matcher));
+}
+
 static void
 ide_git_vcs_reload_worker (GTask        *task,
                            gpointer      source_object,
@@ -329,6 +786,14 @@ ide_git_vcs_reload_worker (GTask        *task,
   IdeGitVcs *self = source_object;
   g_autoptr(GgitRepository) repository1 = NULL;
   g_autoptr(GgitRepository) repository2 = NULL;
+  g_autoptr(IdeVcsIgnoreMatcher) old_matcher = NULL;
+  g_autoptr(IdeVcsIgnoreMatcher) matcher = NULL;
+  g_autoptr(GPtrArray) dirty_dirs = NULL;
+  g_autoptr(GPtrArray) sources = NULL;
+  GgitOId *old_head_tree = NULL;
+  GgitOId *head_tree = NULL;
+  gboolean head_changed;
+  gboolean rebuild;
   GError *error = NULL;
 
   IDE_ENTRY;
@@ -348,6 +813,94 @@ ide_git_vcs_reload_worker (GTask        *task,
   g_set_object (&self->repository, repository1);
   g_set_object (&self->change_monitor_repository, repository2);
 
+  g_mutex_lock (&self->ignore_mutex);
+  rebuild = (self->ignore_matcher == NULL || self->ignore_dirty);
+  head_changed = self->ignore_head_changed;
+  dirty_dirs = g_steal_pointer (&self->ignore_dirty_dirs);
+  if (self->ignore_matcher != NULL)
+    old_matcher = ide_vcs_ignore_matcher_ref (self->ignore_matcher);
+  if (self->ignore_sources != NULL)
+    sources = g_ptr_array_ref (self->ignore_sources);
+  if (self->ignore_head_tree != NULL)
+    old_head_tree = ggit_oid_copy (self->ignore_head_tree);
+  self->ignore_dirty = FALSE;
+  self->ignore_head_changed = FALSE;
+  g_mutex_unlock (&self->ignore_mutex);
+
+  if (head_changed || rebuild)
+    head_tree = ide_git_vcs_get_head_tree_id (repository1);
+  else if (old_head_tree != NULL)
+    head_tree = ggit_oid_copy (old_head_tree);
+
+  if (!rebuild && head_changed)
+    {
+      if (old_head_tree == NULL || head_tree == NULL)
+        {
+          rebuild = TRUE;
+        }
+      else if (!ggit_oid_equal (old_head_tree, head_tree))
+        {
+          g_autoptr(GError) diff_error = NULL;
+
+          if (dirty_dirs == NULL)
+            dirty_dirs = g_ptr_array_new_with_free_func (g_free);
+
+          if (!ide_git_vcs_collect_changed_ignore_dirs (repository1, old_head_tree, head_tree,
+                                                        dirty_dirs, &diff_error))
+            {
+              g_debug ("%s", diff_error->message);
+              rebuild = TRUE;
+            }
+        }
+    }
+
+  if (rebuild)
+    {
+      g_clear_pointer (&sources, g_ptr_array_unref);
+      sources = g_ptr_array_new_with_free_func (g_object_unref);
+      matcher = ide_git_vcs_build_ignore_matcher (repository1, sources, cancellable);
+    }
+  else if (dirty_dirs != NULL && dirty_dirs->len > 0 && sources != NULL)
+    {
+      /* Don't let ide_git_vcs_update_ignore_matcher() modify the shared array */
+      GPtrArray *copy = g_ptr_array_new_with_free_func (g_object_unref);
+
+      for (guint i = 0; i < sources->len; i++)
+        g_ptr_array_add (copy, g_object_ref (g_ptr_array_index (sources, i)));
+      g_ptr_array_unref (sources);
+      sources = copy;
+
+      matcher = ide_git_vcs_update_ignore_matcher (repository1, old_matcher, dirty_dirs,
+                                                   &sources, cancellable);
+    }
+
+  if (matcher != NULL)
+    {
+      g_mutex_lock (&self->ignore_mutex);
+      if (g_cancellable_is_cancelled (cancellable))
+        {
+          /* The matcher may be incomplete, try again on the next reload */
+          self->ignore_dirty = TRUE;
+        }
+      else
+        {
+          g_clear_pointer (&self->ignore_matcher, ide_vcs_ignore_matcher_unref);
+          self->ignore_matcher = g_steal_pointer (&matcher);
+          g_clear_pointer (&self->ignore_sources, g_ptr_array_unref);
+          self->ignore_sources = g_ptr_array_ref (sources);
+          g_clear_pointer (&self->ignore_files, g_ptr_array_unref);
+          self->ignore_files = g_ptr_array_ref (sources);
+        }
+      g_mutex_unlock (&self->ignore_mutex);
+    }
+
+  g_mutex_lock (&self->ignore_mutex);
+  g_clear_pointer (&self->ignore_head_tree, ggit_oid_free);
+  self->ignore_head_tree = g_steal_pointer (&head_tree);
+  g_mutex_unlock (&self->ignore_mutex);
+
+  g_clear_pointer (&old_head_tree, ggit_oid_free);
+
   if (!ide_git_vcs_load_monitor (self, &error))
     {
       g_task_return_error (task, error);
@@ -394,6 +947,7 @@ ide_git_vcs_reload_finish (IdeGitVcs     *self,
 
   if (ret)
     {
+      ide_git_vcs_monitor_ignore_files (self);
       g_signal_emit (self, signals [RELOADED], 0, self->change_monitor_repository);
       ide_vcs_emit_changed (IDE_VCS (self));
     }
@@ -401,11 +955,28 @@ ide_git_vcs_reload_finish (IdeGitVcs     *self,
   IDE_RETURN (ret);
 }
 
+static IdeVcsIgnoreMatcher *
+ide_git_vcs_get_ignore_matcher (IdeVcs *vcs)
+{
+  IdeGitVcs *self = (IdeGitVcs *)vcs;
+  IdeVcsIgnoreMatcher *ret = NULL;
+
+  g_assert (IDE_IS_GIT_VCS (self));
+
+  g_mutex_lock (&self->ignore_mutex);
+  if (self->ignore_matcher != NULL)
+    ret = ide_vcs_ignore_matcher_ref (self->ignore_matcher);
+  g_mutex_unlock (&self->ignore_mutex);
+
+  return ret;
+}
+
 static gboolean
 ide_git_vcs_is_ignored (IdeVcs  *vcs,
                         GFile   *file,
                         GError **error)
 {
+  g_autoptr(IdeVcsIgnoreMatcher) matcher = NULL;
   g_autofree gchar *name = NULL;
   IdeGitVcs *self = (IdeGitVcs *)vcs;
   gboolean ret = FALSE;
@@ -417,10 +988,31 @@ ide_git_vcs_is_ignored (IdeVcs  *vcs,
   if (g_strcmp0 (name, ".git") == 0)
     return TRUE;
 
-  if (name != NULL)
-    return ggit_repository_path_is_ignored (self->repository, name, error);
+  if (name == NULL)
+    return ret;
 
-  return ret;
+  if ((matcher = ide_git_vcs_get_ignore_matcher (vcs)))
+    {
+      gboolean as_file;
+      gboolean as_directory;
+
+      /*
+       * Only rules ending in "/" depend on the type of the file, so we only
+       * need to ask the file system when the answer depends on it. Callers
+       * crawling the tree should use ide_vcs_ignore_matcher_is_file_ignored()
+       * since they already know the type.
+       */
+      as_file = ide_vcs_ignore_matcher_is_ignored (matcher, name, FALSE);
+      as_directory = ide_vcs_ignore_matcher_is_ignored (matcher, name, TRUE);
+
+      if (as_file == as_directory)
+        return as_file;
+
+      return (g_file_query_file_type (file, G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS, NULL) ==
+              G_FILE_TYPE_DIRECTORY) ? as_directory : as_file;
+    }
+
+  return ggit_repository_path_is_ignored (self->repository, name, error);
 }
 
 static gchar *
@@ -478,6 +1070,13 @@ ide_git_vcs_dispose (GObject *object)
       g_clear_object (&self->monitor);
     }
 
+  if (self->ignore_monitors)
+    {
+      for (guint i = 0; i < self->ignore_monitors->len; i++)
+        g_file_monitor_cancel (g_ptr_array_index (self->ignore_monitors, i));
+      g_ptr_array_set_size (self->ignore_monitors, 0);
+    }
+
   g_clear_object (&self->change_monitor_repository);
   g_clear_object (&self->repository);
   g_clear_object (&self->working_directory);
@@ -487,6 +1086,22 @@ ide_git_vcs_dispose (GObject *object)
   IDE_EXIT;
 }
 
+static void
+ide_git_vcs_finalize (GObject *object)
+{
+  IdeGitVcs *self = (IdeGitVcs *)object;
+
+  g_clear_pointer (&self->ignore_matcher, ide_vcs_ignore_matcher_unref);
+  g_clear_pointer (&self->ignore_dirty_dirs, g_ptr_array_unref);
+  g_clear_pointer (&self->ignore_sources, g_ptr_array_unref);
+  g_clear_pointer (&self->ignore_files, g_ptr_array_unref);
+  g_clear_pointer (&self->ignore_head_tree, ggit_oid_free);
+  g_clear_pointer (&self->ignore_monitors, g_ptr_array_unref);
+  g_mutex_clear (&self->ignore_mutex);
+
+  G_OBJECT_CLASS (ide_git_vcs_parent_class)->finalize (object);
+}
+
 static void
 ide_git_vcs_get_property (GObject    *object,
                           guint       prop_id,
@@ -522,6 +1137,7 @@ ide_git_vcs_init_iface (IdeVcsInterface *iface)
   iface->is_ignored = ide_git_vcs_is_ignored;
   iface->get_config = ide_git_vcs_get_config;
   iface->get_branch_name = ide_git_vcs_get_branch_name;
+  iface->get_ignore_matcher = ide_git_vcs_get_ignore_matcher;
 }
 
 static void
@@ -530,6 +1146,7 @@ ide_git_vcs_class_init (IdeGitVcsClass *klass)
   GObjectClass *object_class = G_OBJECT_CLASS (klass);
 
   object_class->dispose = ide_git_vcs_dispose;
+  object_class->finalize = ide_git_vcs_finalize;
   object_class->get_property = ide_git_vcs_get_property;
 
   g_object_class_override_property (object_class, PROP_BRANCH_NAME, "branch-name");
@@ -579,6 +1196,8 @@ ide_git_vcs_class_init (IdeGitVcsClass *klass)
 static void
 ide_git_vcs_init (IdeGitVcs *self)
 {
+  g_mutex_init (&self->ignore_mutex);
+  self->ignore_monitors = g_ptr_array_new_with_free_func (g_object_unref);
 }
 
 static void
@@ -608,9 +1227,20 @@ ide_git_vcs_init_async (GAsyncInitable      *initable,
 {
   IdeGitVcs *self = (IdeGitVcs *)initable;
   g_autoptr(GTask) task = NULL;
+  IdeBufferManager *buffer_manager;
+  IdeContext *context;
 
   g_return_if_fail (IDE_IS_GIT_VCS (self));
 
+  context = ide_object_get_context (IDE_OBJECT (self));
+  buffer_manager = ide_context_get_buffer_manager (context);
+
+  g_signal_connect_object (buffer_manager,
+                           "buffer-saved",
+                           G_CALLBACK (ide_git_vcs__buffer_saved_cb),
+                           self,
+                           G_CONNECT_SWAPPED);
+
   task = g_task_new (self, cancellable, callback, user_data);
   ide_git_vcs_reload_async (self,
                             cancellable,
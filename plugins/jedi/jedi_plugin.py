@@ -21,21 +21,8 @@
 #
 
 import gi
-# lxml is faster than the Python standard library xml, and can ignore invalid
-# characters (which occur in some .gir files).
-# gnome-code-assistance also needs lxml, so I think it's okay to use it here.
-try:
-    import lxml.etree
-    HAS_LXML = True
-except ImportError:
-    HAS_LXML = False
-    print('Warning: python3-lxml is not installed, no documentation will be available in Python auto-completion')
-import os
-import os.path
-import sqlite3
-import threading
-
-gi.require_version('GIRepository', '2.0')
+import re
+
 gi.require_version('Gtk', '3.0')
 gi.require_version('GtkSource', '3.0')
 gi.require_version('Ide', '1.0')
@@ -46,7 +33,6 @@ from gi.importer import DynamicImporter
 from gi.module import IntrospectionModule
 from gi.module import FunctionInfo
 
-from gi.repository import GIRepository
 from gi.repository import Gio
 from gi.repository import GLib
 from gi.repository import GObject
@@ -177,153 +163,68 @@ except ImportError:
     print("jedi not found, python auto-completion not possible.")
     HAS_JEDI = False
 
-GIR_PATH_LIST = []
-
-def init_gir_path_list():
-    global GIR_PATH_LIST
-    paths = OrderedDict()
-
-    # Use GI_TYPELIB_PATH and the search path used by gobject-introspection
-    # to guess the correct path of gir files. It is likely that gir files and
-    # typelib files are installed in the same prefix.
-    search_path = GIRepository.Repository.get_default().get_search_path()
-    if 'GI_TYPELIB_PATH' in os.environ:
-        search_path = os.environ['GI_TYPELIB_PATH'].split(':') + search_path
-
-    for typelib_path in search_path:
-        # Check whether the path is end with lib*/girepository-1.0. If
-        # not, it is likely to be a custom path used for testing that
-        # we should not use.
-        typelib_path = os.path.normpath(typelib_path)
-        typelib_basename = os.path.basename(typelib_path)
-        if typelib_basename != 'girepository-1.0':
-            continue
-
-        path_has_lib = False
-        gir_path, gir_basename = typelib_path, typelib_basename
-        while gir_basename != '':
-            gir_path = os.path.normpath(os.path.join(gir_path, os.path.pardir))
-            gir_basename = os.path.basename(gir_path)
-            if gir_basename.startswith('lib'):
-                path_has_lib = True
-                break
-
-        if not path_has_lib:
-            continue
-        # Replace lib component with share.
-        gir_path = os.path.normpath(os.path.join(gir_path, os.path.pardir,
-            'share', os.path.relpath(typelib_path, gir_path)))
-        # Replace girepository-1.0 component with gir-1.0.
-        gir_path = os.path.normpath(os.path.join(gir_path, os.path.pardir,
-            'gir-1.0'))
-        paths[gir_path] = None
-
-    # It is also possible for XDG_DATA_DIRS to contain a list of prefixes.
-    if 'XDG_DATA_DIRS' in os.environ:
-        for xdg_data_path in os.environ['XDG_DATA_DIRS'].split(':'):
-            gir_path = os.path.normpath(os.path.join(
-                xdg_data_path, 'gir-1.0'))
-            paths[gir_path] = None
-
-    # Ignore non-existent directories to prevent exceptions.
-    GIR_PATH_LIST = list(filter(os.path.isdir, paths.keys()))
-
-init_gir_path_list()
-
-class DocumentationDB(object):
-    def __init__(self):
-        self.db = None
-        self.cursor = None
-
-    def close(self):
-        "Close the DB if open"
-        if self.db is not None:
-            self.cursor.close()
-            self.db.close()
-            self.cursor = None
-            self.db = None
-
-    def open(self):
-        "Open the DB (if needed)"
-        if self.db is None:
-            doc_db_path = os.path.join(GLib.get_user_cache_dir(), 'gnome-builder', 'jedi', 'girdoc.db')
-            try:
-                os.makedirs(os.path.dirname(doc_db_path))
-            except:
-                pass
-            self.db = sqlite3.connect(doc_db_path)
-            self.cursor = self.db.cursor()
-            # Create the tables if they don't exist to prevent exceptions later on
-            self.cursor.execute('CREATE TABLE IF NOT EXISTS doc (symbol text, library_version text, doc text, gir_file text)')
-            self.cursor.execute('CREATE TABLE IF NOT EXISTS girfiles (file text, last_modified integer)')
-
-    def query(self, symbol, version):
-        "Query the documentation DB"
-        self.open()
-        self.cursor.execute('SELECT doc FROM doc WHERE symbol=? AND library_version=?', (symbol, version))
-        result = self.cursor.fetchone()
-        if result is not None:
-            return result[0]
-        else:
-            return None
-
-    def update(self, close_when_done=False):
-        "Build the documentation DB and ensure it's up to date"
-        if not HAS_LXML:
-            return  # Can't process the gir files without lxml
-        ns = {'core': 'http://www.gtk.org/introspection/core/1.0',
-              'c': 'http://www.gtk.org/introspection/c/1.0'}
-        self.open()
-        cursor = self.cursor
-        processed_gir_files = {}
-
-        # I would use scandir for better performance, but it requires newer Python
-        for gir_path in GIR_PATH_LIST:
-            for gir_file in os.listdir(gir_path):
-                if gir_file in processed_gir_files:
-                    continue
-                processed_gir_files[gir_file] = None
-                filename = os.path.join(gir_path, gir_file)
-                mtime = os.stat(filename).st_mtime
-                cursor.execute('SELECT * from girfiles WHERE file=?', (filename,))
-                result = cursor.fetchone()
-                if result is None:
-                    cursor.execute('INSERT INTO girfiles VALUES (?, ?)', (filename, mtime))
-                else:
-                    if result[1] >= mtime:
-                        continue
-                    else:
-                        # updated
-                        cursor.execute('DELETE FROM doc WHERE gir_file=?', (filename,))
-                        cursor.execute('UPDATE girfiles SET last_modified=? WHERE file=?', (mtime, filename))
-                parser = lxml.etree.XMLParser(recover=True)
-                tree = lxml.etree.parse(filename, parser=parser)
-                namespace = tree.find('core:namespace', namespaces=ns)
-                library_version = namespace.attrib['version']
-                for node in namespace.findall('core:class', namespaces=ns):
-                    doc = node.find('core:doc', namespaces=ns)
-                    if doc is not None:
-                        symbol = node.attrib['{http://www.gtk.org/introspection/glib/1.0}type-name']
-                        cursor.execute("INSERT INTO doc VALUES (?, ?, ?, ?)",
-                                       (symbol, library_version, doc.text, filename))
-                for method in namespace.findall('core:method', namespaces=ns) + \
-                              namespace.findall('core:constructor', namespaces=ns) + \
-                              namespace.findall('core:function', namespaces=ns):
-                    doc = method.find('core:doc', namespaces=ns)
-                    if doc is not None:
-                        symbol = method.attrib['{http://www.gtk.org/introspection/c/1.0}identifier']
-                        cursor.execute("INSERT INTO doc VALUES (?, ?, ?, ?)",
-                                       (symbol, library_version, doc.text, filename))
-        self.db.commit()
-        if close_when_done:
-            self.close()
-
-
-def update_doc_db_on_startup():
-    db = DocumentationDB()
-    threading.Thread(target=db.update, args={'close_when_done': True}).start()
-
-update_doc_db_on_startup()
+# Filenames mapped to the buffer change count last sent to the worker
+# for pre-warming, so that opening more views does not resend them. Only
+# as many as the worker keeps documents for are remembered.
+_warmed_buffers = OrderedDict()
+
+
+class JediDocumentState:
+    """
+    Tracks the span of a buffer that has changed since it was last
+    synchronized with the jedi worker, so that only that span needs to
+    be sent along with the next completion request.
+    """
+
+    def __init__(self, buffer):
+        self.buffer = buffer
+        self.sequence = None
+        self.length = 0
+        self.begin = 0
+        self.suffix = 0
+        self.handlers = [
+            buffer.connect('insert-text', self.on_insert_text),
+            buffer.connect('delete-range', self.on_delete_range),
+        ]
+
+    def release(self):
+        for handler in self.handlers:
+            self.buffer.disconnect(handler)
+        self.handlers = []
+        self.buffer = None
+
+    def on_insert_text(self, buffer, location, text, length):
+        # Runs before the default handler, so the char count is still
+        # that of the text the location refers to.
+        offset = location.get_offset()
+        self.begin = min(self.begin, offset)
+        self.suffix = min(self.suffix, buffer.get_char_count() - offset)
+
+    def on_delete_range(self, buffer, begin, end):
+        self.begin = min(self.begin, begin.get_offset())
+        self.suffix = min(self.suffix, buffer.get_char_count() - end.get_offset())
+
+    def invalidate(self):
+        self.sequence = None
+
+    def reset(self, sequence):
+        self.sequence = sequence
+        self.length = self.buffer.get_char_count()
+        self.begin = self.length
+        self.suffix = self.length
+
+    def get_delta(self):
+        """
+        Returns a tuple of (offset, length, text) which, when applied to
+        the text last synchronized, produces the current buffer contents.
+        """
+        count = self.buffer.get_char_count()
+        begin = self.begin
+        suffix = min(self.suffix, self.length - begin, count - begin)
+        text = self.buffer.get_slice(self.buffer.get_iter_at_offset(begin),
+                                     self.buffer.get_iter_at_offset(count - suffix),
+                                     True)
+        return (begin, self.length - begin - suffix, text)
 
 
 class JediCompletionProvider(Ide.Object, GtkSource.CompletionProvider, Ide.CompletionProvider):
@@ -335,6 +236,7 @@ class JediCompletionProvider(Ide.Object, GtkSource.CompletionProvider, Ide.Compl
     line = -1
     line_offset = -1
     loading_proxy = False
+    document = None
 
     proxy = None
 
@@ -344,6 +246,52 @@ class JediCompletionProvider(Ide.Object, GtkSource.CompletionProvider, Ide.Compl
     def do_get_icon(self):
         return None
 
+    def do_load(self):
+        if HAS_JEDI:
+            self.ensure_proxy(self.warm_buffers)
+
+    def ensure_proxy(self, callback=None):
+        if self.proxy or self.loading_proxy:
+            return
+
+        def get_worker_cb(app, result):
+            self.loading_proxy = False
+            self.proxy = app.get_worker_finish(result)
+            if callback is not None:
+                callback()
+
+        self.loading_proxy = True
+        app = Gio.Application.get_default()
+        app.get_worker_async('jedi_plugin', None, get_worker_cb)
+
+    def warm_buffers(self):
+        # Hand the worker the contents of open Python buffers so it can
+        # load their imports in the background, before the first
+        # completion request arrives.
+        context = self.get_context()
+        if context is None:
+            return
+
+        for buffer in context.get_buffer_manager().get_buffers():
+            language = buffer.get_language()
+            if language is None or language.get_id() not in ('python', 'python3'):
+                continue
+
+            filename = buffer.get_file().get_file().get_path()
+            sequence = buffer.get_change_count()
+            if filename is None or _warmed_buffers.get(filename) == sequence:
+                continue
+            _warmed_buffers[filename] = sequence
+            _warmed_buffers.move_to_end(filename)
+            while len(_warmed_buffers) > JediService.MAX_DOCUMENTS:
+                _warmed_buffers.popitem(last=False)
+
+            begin, end = buffer.get_bounds()
+            text = buffer.get_text(begin, end, True)
+            self.proxy.call('OpenDocument',
+                            GLib.Variant('(sts)', (filename, sequence, text)),
+                            0, 10000, None, None, None)
+
     def invalidates(self, line_str):
         if not line_str.startswith(self.line_str):
             return True
@@ -380,15 +328,10 @@ class JediCompletionProvider(Ide.Object, GtkSource.CompletionProvider, Ide.Compl
 
         buffer = iter.get_buffer()
 
-        begin, end = buffer.get_bounds()
-        filename = (iter.get_buffer()
-                        .get_file()
-                        .get_file()
-                        .get_path())
-
-        text = buffer.get_text(begin, end, True)
-        line = iter.get_line() + 1
-        column = iter.get_line_offset()
+        if self.document is None or self.document.buffer != buffer:
+            if self.document is not None:
+                self.document.release()
+            self.document = JediDocumentState(buffer)
 
         self.line = iter.get_line()
         self.line_offset = iter.get_line_offset()
@@ -398,6 +341,30 @@ class JediCompletionProvider(Ide.Object, GtkSource.CompletionProvider, Ide.Compl
         self.cancellable = cancellable = Gio.Cancellable()
         context.connect('cancelled', lambda *_: cancellable.cancel())
 
+        self.request_completions(buffer, results, context, cancellable, True)
+
+    def request_completions(self, buffer, results, context, cancellable, may_retry):
+        filename = buffer.get_file().get_file().get_path()
+        sequence = buffer.get_change_count()
+        document = self.document
+
+        # Only the span changed since the last request is sent. The worker
+        # applies it on top of the text it has for base_sequence, or fails
+        # with G_IO_ERROR_NOT_FOUND if it does not have that text.
+        if document.sequence is None:
+            begin, end = buffer.get_bounds()
+            text = buffer.get_text(begin, end, True)
+            self.proxy.call('OpenDocument',
+                            GLib.Variant('(sts)', (filename, sequence, text)),
+                            0, 10000, None, None, None)
+            base_sequence = sequence
+            offset, length, text = (0, 0, '')
+        else:
+            base_sequence = document.sequence
+            offset, length, text = document.get_delta()
+
+        document.reset(sequence)
+
         def async_handler(proxy, result, user_data):
             (self, results, context) = user_data
 
@@ -413,24 +380,28 @@ class JediCompletionProvider(Ide.Object, GtkSource.CompletionProvider, Ide.Compl
                 if isinstance(ex, GLib.Error) and \
                    ex.matches(Gio.io_error_quark(), Gio.IOErrorEnum.CANCELLED):
                     return
+                # Make sure the next request carries the whole buffer.
+                if document is self.document:
+                    document.invalidate()
+                if may_retry and isinstance(ex, GLib.Error) and \
+                   ex.matches(Gio.io_error_quark(), Gio.IOErrorEnum.NOT_FOUND) and \
+                   document is self.document and not cancellable.is_cancelled():
+                    self.request_completions(buffer, results, context, cancellable, False)
+                    return
                 print(repr(ex))
                 context.add_proposals(self, [], True)
 
-        self.proxy.call('CodeComplete',
-                        GLib.Variant('(siis)', (filename, self.line, self.line_offset, text)),
+        self.proxy.call('CodeCompleteDelta',
+                        GLib.Variant('(siittiis)', (filename, self.line, self.line_offset,
+                                                    base_sequence, sequence,
+                                                    offset, length, text)),
                         0, 10000, cancellable, async_handler, (self, results, context))
 
     def do_match(self, context):
         if not HAS_JEDI:
             return False
 
-        if not self.proxy and not self.loading_proxy:
-            def get_worker_cb(app, result):
-                self.loading_proxy = False
-                self.proxy = app.get_worker_finish(result)
-            self.loading_proxy = True
-            app = Gio.Application.get_default()
-            app.get_worker_async('jedi_plugin', None, get_worker_cb)
+        self.ensure_proxy()
 
         if not self.proxy:
             return False
@@ -593,7 +564,7 @@ class JediCompletionRequest:
         # Jedi uses 1-based line indexes, we use 0 throughout Builder.
         script = jedi.Script(self.content, self.line + 1, self.column, self.filename)
 
-        db = DocumentationDB()
+        doc_index = Ide.GirDocIndex.get_default()
         for info in script.completions():
             if self.cancelled:
                 return
@@ -644,14 +615,12 @@ class JediCompletionRequest:
                         else:
                             parent = new_parent
                     version = parent.obj._version
-                    result = db.query(symbol, version)
+                    result = doc_index.lookup(symbol, version)
                     if result is not None:
                         doc = result
 
             results.append((_TYPES.get(info.real_type, 0), info.name, info.complete, params, doc))
 
-        db.close()
-
         self.invocation.return_value(GLib.Variant('(a(issass))', (results,)))
 
     def cancel(self):
@@ -659,21 +628,119 @@ class JediCompletionRequest:
             self.cancelled = True
             self.invocation.return_error_literal(Gio.io_error_quark(), Gio.IOErrorEnum.CANCELLED, "Operation was cancelled")
 
+_IMPORT_RE = re.compile(r'^\s*(?:from\s+([\w.]+)\s+import\s+([\w., ]+)|import\s+([\w., ]+))', re.MULTILINE)
+
+def find_imported_modules(text):
+    """
+    Returns the names of the modules imported by @text. This is a cheap scan
+    rather than a parse so that it works on code that is being edited.
+    """
+    modules = []
+    for match in _IMPORT_RE.finditer(text):
+        if match.group(1):
+            module = match.group(1)
+            if module.startswith('.'):
+                continue
+            modules.append(module)
+            # Namespaces of gi.repository are only loaded on access
+            if module == 'gi.repository':
+                for name in match.group(2).split(','):
+                    name = name.strip().split(' ')[0]
+                    if name:
+                        modules.append('gi.repository.' + name)
+        else:
+            for name in match.group(3).split(','):
+                name = name.strip().split(' ')[0]
+                if name:
+                    modules.append(name)
+    return modules
+
+
+class JediDocument:
+    """
+    The worker side copy of a buffer, tagged with the change count of the
+    buffer it was last synchronized with.
+    """
+
+    def __init__(self, sequence, content):
+        self.sequence = sequence
+        self.content = content
+
+    def apply(self, sequence, offset, length, text):
+        """
+        Replaces @length characters at @offset with @text and returns the
+        lines touched by the change.
+        """
+        content = self.content
+        self.content = content[:offset] + text + content[offset + length:]
+        self.sequence = sequence
+
+        begin = self.content.rfind('\n', 0, offset) + 1
+        end = self.content.find('\n', offset + len(text))
+        if end == -1:
+            end = len(self.content)
+        return self.content[begin:end]
+
+
 class JediService(Ide.DBusService):
+    # Bounds the number of documents whose text is kept in the worker
+    MAX_DOCUMENTS = 32
+
     queue = None
     handler_id = None
+    documents = None
+    warm_queue = None
+    warm_handler_id = None
+    warmed = None
 
     def __init__(self):
         super().__init__()
         self.queue = {}
         self.handler_id = 0
+        self.documents = OrderedDict()
+        self.warm_queue = []
+        self.warm_handler_id = 0
+        self.warmed = set()
+
+    @Ide.DBusMethod('org.gnome.builder.plugins.jedi', in_signature='sts', out_signature='b')
+    def OpenDocument(self, filename, sequence, content):
+        document = self.documents.get(filename)
+        if document is not None and document.sequence == sequence:
+            self.documents.move_to_end(filename)
+            return True
+
+        self.documents[filename] = JediDocument(sequence, content)
+        self.documents.move_to_end(filename)
+        while len(self.documents) > self.MAX_DOCUMENTS:
+            self.documents.popitem(last=False)
+
+        self.queue_warm(find_imported_modules(content))
+        self.queue_warm_document(filename)
+
+        return True
+
+    @Ide.DBusMethod('org.gnome.builder.plugins.jedi', in_signature='siittiis', out_signature='a(issass)', async=True)
+    def CodeCompleteDelta(self, invocation, filename, line, column, base_sequence, sequence, offset, length, text):
+        document = self.documents.get(filename)
+        if document is None or document.sequence != base_sequence or \
+           offset < 0 or length < 0 or offset + length > len(document.content):
+            invocation.return_error_literal(Gio.io_error_quark(), Gio.IOErrorEnum.NOT_FOUND,
+                                            "No document at sequence %u" % base_sequence)
+            return
+
+        self.documents.move_to_end(filename)
+
+        if length or text:
+            changed = document.apply(sequence, offset, length, text)
+            if 'import' in changed:
+                self.queue_warm(find_imported_modules(changed))
+        else:
+            document.sequence = sequence
 
-    @Ide.DBusMethod('org.gnome.builder.plugins.jedi', in_signature='siis', out_signature='a(issass)', async=True)
-    def CodeComplete(self, invocation, filename, line, column, content):
         if filename in self.queue:
             request = self.queue.pop(filename)
             request.cancel()
-        self.queue[filename] = JediCompletionRequest(invocation, filename, line, column, content)
+        self.queue[filename] = JediCompletionRequest(invocation, filename, line, column, document.content)
         if not self.handler_id:
             self.handler_id = GLib.timeout_add(5, self.process)
 
@@ -684,6 +751,42 @@ class JediService(Ide.DBusService):
             request.run()
         return False
 
+    def queue_warm(self, modules):
+        for module in modules:
+            if module not in self.warmed:
+                self.warmed.add(module)
+                self.warm_queue.append((jedi.preload_module, (module,)))
+        self.schedule_warm()
+
+    def queue_warm_document(self, filename):
+        self.warm_queue.append((self.warm_document, (filename,)))
+        self.schedule_warm()
+
+    def schedule_warm(self):
+        if self.warm_queue and not self.warm_handler_id:
+            self.warm_handler_id = GLib.idle_add(self.warm_next, priority=GLib.PRIORITY_LOW)
+
+    def warm_document(self, filename):
+        # Parsing the module once fills jedi's parser cache for @filename,
+        # which later requests for the same path reuse.
+        document = self.documents.get(filename)
+        if document is not None:
+            jedi.Script(document.content, 1, 0, filename).completions()
+
+    def warm_next(self):
+        # One item per iteration so that completion requests, which are
+        # dispatched at a higher priority, are never stuck behind warming.
+        func, args = self.warm_queue.pop(0)
+        try:
+            func(*args)
+        except Exception:
+            pass
+
+        if not self.warm_queue:
+            self.warm_handler_id = 0
+            return False
+        return True
+
 class JediWorker(GObject.Object, Ide.Worker):
     _service = None
 
@@ -15,6 +15,7 @@
 # You should have received a copy of the GNU General Public License
 # along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
+import os
 from os import path
 import subprocess
 import threading
@@ -36,6 +37,91 @@ _ = Ide.gettext
 ninja = None
 
 
+def _get_mtime(filename):
+    try:
+        return os.stat(filename).st_mtime_ns
+    except OSError:
+        return None
+
+
+class _MtimeCache:
+    """
+    Caches data derived from a file in the build directory until the
+    file's modification time changes. Loading happens in a worker thread
+    while lookups may happen from the main thread.
+    """
+
+    def __init__(self):
+        self._lock = threading.Lock()
+        self._entries = {}
+
+    def lookup(self, filename):
+        mtime = _get_mtime(filename)
+        with self._lock:
+            entry = self._entries.get(filename)
+        if entry is not None and mtime is not None and entry[0] == mtime:
+            return entry[1]
+        return None
+
+    def load(self, filename, loader):
+        mtime = _get_mtime(filename)
+        with self._lock:
+            entry = self._entries.get(filename)
+            if entry is not None and mtime is not None and entry[0] == mtime:
+                return entry[1]
+        # Parse outside of the lock, a concurrent load of the same file just
+        # does redundant work and the last one wins.
+        data = loader(filename)
+        with self._lock:
+            self._entries[filename] = (mtime, data)
+        return data
+
+
+_compile_commands = _MtimeCache()
+_introspect_targets = _MtimeCache()
+
+
+def _extract_flags(command: str):
+    flags = GLib.shell_parse_argv(command)[1] # Raises on failure
+    return [flag for flag in flags if flag.startswith(('-I', '-isystem', '-W', '-D'))]
+
+
+def _load_compile_commands(commands_file):
+    """
+    Builds an index of absolute source path to compiler flags so that
+    each lookup is a single dict access.
+    """
+    try:
+        with open(commands_file, encoding='utf-8') as f:
+            commands = json.load(f)
+    except (json.JSONDecodeError, FileNotFoundError, UnicodeDecodeError) as e:
+        raise GLib.Error('Failed to decode meson json: {}'.format(e))
+
+    index = {}
+    for c in commands:
+        filepath = path.normpath(path.join(c['directory'], c['file']))
+        # A single unparsable command must not hide the flags of every
+        # other file in the project, so just skip that entry.
+        try:
+            index[filepath] = _extract_flags(c['command'])
+        except GLib.Error as e:
+            print('Meson: Warning: Failed to parse command for {}: {}'.format(filepath, e.message))
+    return index
+
+
+def _load_introspect_targets(builddir):
+    # TODO: Ide.Subprocess.communicate_utf8(None, cancellable) doesn't work?
+    try:
+        ret = subprocess.check_output(['mesonintrospect', '--targets', builddir])
+    except (subprocess.CalledProcessError, FileNotFoundError) as e:
+        raise GLib.Error('Failed to run mesonintrospect: {}'.format(e))
+
+    try:
+        return json.loads(ret.decode('utf-8'))
+    except (json.JSONDecodeError, UnicodeDecodeError) as e:
+        raise GLib.Error('Failed to decode mesonintrospect json: {}'.format(e))
+
+
 class MesonBuildSystem(Ide.Object, Ide.BuildSystem, Gio.AsyncInitable):
     project_file = GObject.Property(type=Gio.File)
 
@@ -83,33 +169,30 @@ class MesonBuildSystem(Ide.Object, Ide.BuildSystem, Gio.AsyncInitable):
             task.return_error(GLib.Error('Meson: Project must be built before we can get flags'))
             return
 
-        def extract_flags(command: str):
-            flags = GLib.shell_parse_argv(command)[1] # Raises on failure
-            return [flag for flag in flags if flag.startswith(('-I', '-isystem', '-W', '-D'))]
+        commands_file = path.join(builder._get_build_dir().get_path(), 'compile_commands.json')
+        infile = ifile.get_path()
+
+        def lookup(index):
+            flags = index.get(infile)
+            if flags is None:
+                print('Meson: Warning: No flags found')
+            else:
+                task.build_flags = flags
+            task.return_boolean(True)
+
+        # Avoid a thread entirely when the index is already up to date
+        index = _compile_commands.lookup(commands_file)
+        if index is not None:
+            lookup(index)
+            return
 
         def build_flags_thread():
-            commands_file = path.join(builder._get_build_dir().get_path(), 'compile_commands.json')
             try:
-                with open(commands_file) as f:
-                    commands = json.loads(f.read(), encoding='utf-8')
-            except (json.JSONDecodeError, FileNotFoundError, UnicodeDecodeError) as e:
-                task.return_error(GLib.Error('Failed to decode meson json: {}'.format(e)))
+                index = _compile_commands.load(commands_file, _load_compile_commands)
+            except GLib.Error as e:
+                task.return_error(e)
                 return
-
-            infile = ifile.get_path()
-            for c in commands:
-                filepath = path.normpath(path.join(c['directory'], c['file']))
-                if filepath == infile:
-                    try:
-                        task.build_flags = extract_flags(c['command'])
-                    except GLib.Error as e:
-                        task.return_error(e)
-                        return
-                    break
-            else:
-                print('Meson: Warning: No flags found')
-
-            task.return_boolean(True)
+            lookup(index)
 
         thread = threading.Thread(target=build_flags_thread)
         thread.start()
@@ -126,23 +209,11 @@ class MesonBuildSystem(Ide.Object, Ide.BuildSystem, Gio.AsyncInitable):
         config = self._cached_config
         builder = self._cached_builder
 
-        def build_targets_thread():
-            # TODO: Ide.Subprocess.communicate_utf8(None, cancellable) doesn't work?
-            try:
-                ret = subprocess.check_output(['mesonintrospect', '--targets',
-                                               builder._get_build_dir().get_path()])
-            except (subprocess.CalledProcessError, FileNotFoundError) as e:
-                task.return_error(GLib.Error('Failed to run mesonintrospect: {}'.format(e)))
-                return
+        builddir = builder._get_build_dir().get_path()
+        bindir = path.join(config.get_prefix(), 'bin')
 
+        def build_targets(meson_targets):
             targets = []
-            try:
-                meson_targets = json.loads(ret.decode('utf-8'))
-            except (json.JSONDecodeError, UnicodeDecodeError) as e:
-                task.return_error(GLib.Error('Failed to decode mesonintrospect json: {}'.format(e)))
-                return
-
-            bindir = path.join(config.get_prefix(), 'bin')
             for t in meson_targets:
                 # TODO: Ideally BuildTargets understand filename != name
                 name = t['filename']
@@ -165,6 +236,22 @@ class MesonBuildSystem(Ide.Object, Ide.BuildSystem, Gio.AsyncInitable):
             task.build_targets = targets
             task.return_boolean(True)
 
+        # The introspection data only changes when meson regenerates build.ninja
+        ninja_file = path.join(builddir, 'build.ninja')
+        meson_targets = _introspect_targets.lookup(ninja_file)
+        if meson_targets is not None:
+            build_targets(meson_targets)
+            return
+
+        def build_targets_thread():
+            try:
+                meson_targets = _introspect_targets.load(ninja_file,
+                                                         lambda _: _load_introspect_targets(builddir))
+            except GLib.Error as e:
+                task.return_error(e)
+                return
+            build_targets(meson_targets)
+
         thread = threading.Thread(target=build_targets_thread)
         thread.start()
 
@@ -118,8 +118,11 @@ build_file (GbProjectTreeBuilder *self,
             IdeTreeNode          *node)
 {
   g_autoptr(GFileEnumerator) enumerator = NULL;
+  g_autoptr(IdeVcsIgnoreMatcher) matcher = NULL;
+  g_autofree gchar *relpath = NULL;
   GbProjectFile *project_file;
   gpointer file_info_ptr;
+  GFile *workdir;
   IdeVcs *vcs;
   GFile *file;
   IdeTree *tree;
@@ -145,6 +148,16 @@ build_file (GbProjectTreeBuilder *self,
 
   file = gb_project_file_get_file (project_file);
 
+  /* Check the children against the matcher rather than the VCS when possible */
+  workdir = ide_vcs_get_working_directory (vcs);
+  if ((matcher = ide_vcs_get_ignore_matcher (vcs)) && workdir != NULL)
+    {
+      if (g_file_equal (workdir, file))
+        relpath = g_strdup ("");
+      else
+        relpath = g_file_get_relative_path (workdir, file);
+    }
+
   enumerator = g_file_enumerate_children (file,
                                           G_FILE_ATTRIBUTE_STANDARD_NAME","
                                           G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME","
@@ -170,7 +183,19 @@ build_file (GbProjectTreeBuilder *self,
       name = g_file_info_get_name (item_file_info);
       item_file = g_file_get_child (file, name);
 
-      ignored = ide_vcs_is_ignored (vcs, item_file, NULL);
+      if (matcher != NULL && relpath != NULL)
+        {
+          g_autofree gchar *item_relpath = NULL;
+          gboolean is_directory;
+
+          item_relpath = *relpath ? g_build_filename (relpath, name, NULL) : g_strdup (name);
+          is_directory = g_file_info_get_file_type (item_file_info) == G_FILE_TYPE_DIRECTORY;
+          ignored = ide_vcs_ignore_matcher_is_ignored (matcher, item_relpath, is_directory);
+        }
+      else
+        {
+          ignored = ide_vcs_is_ignored (vcs, item_file, NULL);
+        }
       if (ignored && !show_ignored_files)
         continue;
 
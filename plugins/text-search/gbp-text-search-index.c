@@ -0,0 +1,889 @@
+/* gbp-text-search-index.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define G_LOG_DOMAIN "gbp-text-search-index"
+
+#include <string.h>
+
+#include "gbp-text-search-index.h"
+#include "gbp-text-search-trigrams.h"
+
+/*
+ * The trigram index itself lives in gbp-text-search-trigrams.c. This object
+ * keeps it in sync with the project tree, persists it to the cache directory
+ * and confirms the candidates it returns against the real file contents.
+ */
+
+#define MAX_FILE_SIZE      (1024 * 1024)
+#define BINARY_PROBE_SIZE  8000
+#define SAVE_DELAY_SECONDS 10
+
+struct _GbpTextSearchIndex
+{
+  IdeObject              parent_instance;
+
+  GFile                 *root_directory;
+  gchar                 *cache_path;
+
+  /*
+   * Everything below is protected by @mutex since the index is updated
+   * from the indexer thread pool while queries run on other threads.
+   */
+  GMutex                 mutex;
+  GbpTextSearchTrigrams *trigrams;
+  guint                  loaded : 1;
+
+  guint                  save_source;
+};
+
+typedef struct
+{
+  gchar     *query;
+  GFile     *root_directory;
+  GPtrArray *unsaved_files;
+  gsize      max_results;
+} QueryState;
+
+G_DEFINE_TYPE (GbpTextSearchIndex, gbp_text_search_index, IDE_TYPE_OBJECT)
+
+enum {
+  PROP_0,
+  PROP_ROOT_DIRECTORY,
+  N_PROPS
+};
+
+static GParamSpec *properties [N_PROPS];
+
+static void
+query_state_free (gpointer data)
+{
+  QueryState *state = data;
+
+  g_free (state->query);
+  g_clear_object (&state->root_directory);
+  g_clear_pointer (&state->unsaved_files, g_ptr_array_unref);
+  g_slice_free (QueryState, state);
+}
+
+void
+gbp_text_search_match_free (GbpTextSearchMatch *match)
+{
+  if (match != NULL)
+    {
+      g_free (match->path);
+      g_free (match->line);
+      g_slice_free (GbpTextSearchMatch, match);
+    }
+}
+
+static gboolean
+is_binary (const gchar *data,
+           gsize        len)
+{
+  return memchr (data, '\0', MIN (len, BINARY_PROBE_SIZE)) != NULL;
+}
+
+static void
+gbp_text_search_index_load_locked (GbpTextSearchIndex *self)
+{
+  g_autofree gchar *root_path = NULL;
+
+  g_assert (GBP_IS_TEXT_SEARCH_INDEX (self));
+
+  if (self->cache_path == NULL)
+    return;
+
+  root_path = g_file_get_path (self->root_directory);
+  gbp_text_search_trigrams_load (self->trigrams, self->cache_path, root_path);
+}
+
+static void
+gbp_text_search_index_save_locked (GbpTextSearchIndex *self)
+{
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *root_path = NULL;
+
+  g_assert (GBP_IS_TEXT_SEARCH_INDEX (self));
+
+  if (self->cache_path == NULL)
+    return;
+
+  root_path = g_file_get_path (self->root_directory);
+
+  if (!gbp_text_search_trigrams_save (self->trigrams, self->cache_path, root_path, &error))
+    g_warning ("Failed to save text search index: %s", error->message);
+}
+
+/*
+ * Reads @file and indexes it under @path unless the index already has an
+ * entry with the same modification time and size. Must be called without
+ * the lock held, since reading the file may take a while.
+ */
+static void
+gbp_text_search_index_index_file (GbpTextSearchIndex *self,
+                                  GFile              *file,
+                                  const gchar        *path,
+                                  guint64             mtime,
+                                  guint64             size,
+                                  GCancellable       *cancellable)
+{
+  g_autoptr(GArray) trigrams = NULL;
+  g_autofree gchar *contents = NULL;
+  gboolean up_to_date;
+  gsize len = 0;
+
+  g_assert (GBP_IS_TEXT_SEARCH_INDEX (self));
+  g_assert (G_IS_FILE (file));
+  g_assert (path != NULL);
+
+  g_mutex_lock (&self->mutex);
+  up_to_date = gbp_text_search_trigrams_is_current (self->trigrams, path, mtime, size);
+  g_mutex_unlock (&self->mutex);
+
+  if (up_to_date)
+    return;
+
+  if (size > MAX_FILE_SIZE ||
+      !g_file_load_contents (file, cancellable, &contents, &len, NULL, NULL) ||
+      is_binary (contents, len))
+    {
+      g_mutex_lock (&self->mutex);
+      gbp_text_search_trigrams_remove (self->trigrams, path);
+      g_mutex_unlock (&self->mutex);
+      return;
+    }
+
+  trigrams = gbp_text_search_collect_trigrams (contents, len);
+
+  g_mutex_lock (&self->mutex);
+  gbp_text_search_trigrams_insert (self->trigrams, path, mtime, size, trigrams);
+  g_mutex_unlock (&self->mutex);
+}
+
+static void
+populate_from_dir (GbpTextSearchIndex  *self,
+                   IdeVcs              *vcs,
+                   IdeVcsIgnoreMatcher *matcher,
+                   const gchar         *vcs_relpath,
+                   GHashTable          *seen,
+                   const gchar         *relpath,
+                   GFile               *directory,
+                   GCancellable        *cancellable)
+{
+  g_autoptr(GFileEnumerator) enumerator = NULL;
+  g_autoptr(GPtrArray) children = NULL;
+  gpointer file_info_ptr;
+
+  g_assert (GBP_IS_TEXT_SEARCH_INDEX (self));
+  g_assert (G_IS_FILE (directory));
+
+  if (g_cancellable_is_cancelled (cancellable))
+    return;
+
+  if (ide_vcs_ignore_matcher_is_file_ignored (matcher, vcs, vcs_relpath, directory, TRUE))
+    return;
+
+  enumerator = g_file_enumerate_children (directory,
+                                          G_FILE_ATTRIBUTE_STANDARD_NAME","
+                                          G_FILE_ATTRIBUTE_STANDARD_TYPE","
+                                          G_FILE_ATTRIBUTE_STANDARD_SIZE","
+                                          G_FILE_ATTRIBUTE_TIME_MODIFIED,
+                                          G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                          cancellable,
+                                          NULL);
+
+  if (enumerator == NULL)
+    return;
+
+  while ((file_info_ptr = g_file_enumerator_next_file (enumerator, cancellable, NULL)))
+    {
+      g_autoptr(GFileInfo) file_info = file_info_ptr;
+      g_autoptr(GFile) file = NULL;
+      g_autofree gchar *path = NULL;
+      g_autofree gchar *vcs_path = NULL;
+      const gchar *name;
+      GFileType file_type;
+
+      name = g_file_info_get_name (file_info);
+      file = g_file_get_child (directory, name);
+      file_type = g_file_info_get_file_type (file_info);
+
+      if (file_type == G_FILE_TYPE_DIRECTORY)
+        {
+          if (children == NULL)
+            children = g_ptr_array_new_with_free_func (g_object_unref);
+          g_ptr_array_add (children, g_steal_pointer (&file));
+          continue;
+        }
+
+      if (file_type != G_FILE_TYPE_REGULAR)
+        continue;
+
+      if (vcs_relpath != NULL)
+        vcs_path = ide_vcs_ignore_matcher_build_path (vcs_relpath, name);
+
+      if (ide_vcs_ignore_matcher_is_file_ignored (matcher, vcs, vcs_path, file, FALSE))
+        continue;
+
+      path = relpath ? g_build_filename (relpath, name, NULL) : g_strdup (name);
+
+      gbp_text_search_index_index_file (self,
+                                        file,
+                                        path,
+                                        g_file_info_get_attribute_uint64 (file_info, G_FILE_ATTRIBUTE_TIME_MODIFIED),
+                                        g_file_info_get_size (file_info),
+                                        cancellable);
+
+      g_hash_table_add (seen, g_steal_pointer (&path));
+    }
+
+  if (children != NULL)
+    {
+      for (guint i = 0; i < children->len; i++)
+        {
+          GFile *child = g_ptr_array_index (children, i);
+          g_autofree gchar *name = g_file_get_basename (child);
+          g_autofree gchar *path = NULL;
+          g_autofree gchar *vcs_path = NULL;
+
+          path = relpath ? g_build_filename (relpath, name, NULL) : g_strdup (name);
+          if (vcs_relpath != NULL)
+            vcs_path = ide_vcs_ignore_matcher_build_path (vcs_relpath, name);
+          populate_from_dir (self, vcs, matcher, vcs_path, seen, path, child, cancellable);
+        }
+    }
+}
+
+static void
+gbp_text_search_index_build_worker (GTask        *task,
+                                    gpointer      source_object,
+                                    gpointer      task_data,
+                                    GCancellable *cancellable)
+{
+  GbpTextSearchIndex *self = source_object;
+  g_autoptr(IdeVcsIgnoreMatcher) matcher = NULL;
+  g_autoptr(GHashTable) seen = NULL;
+  g_autoptr(GTimer) timer = NULL;
+  g_autofree gchar *vcs_relpath = NULL;
+  IdeContext *context;
+  GFile *workdir;
+  IdeVcs *vcs;
+
+  g_assert (G_IS_TASK (task));
+  g_assert (GBP_IS_TEXT_SEARCH_INDEX (self));
+
+  context = ide_object_get_context (IDE_OBJECT (self));
+  vcs = ide_context_get_vcs (context);
+  workdir = ide_vcs_get_working_directory (vcs);
+
+  /* The matcher wants paths relative to the working directory */
+  if ((matcher = ide_vcs_get_ignore_matcher (vcs)) && workdir != NULL)
+    {
+      if (g_file_equal (workdir, self->root_directory))
+        vcs_relpath = g_strdup ("");
+      else
+        vcs_relpath = g_file_get_relative_path (workdir, self->root_directory);
+    }
+
+  timer = g_timer_new ();
+
+  g_mutex_lock (&self->mutex);
+  if (!self->loaded)
+    {
+      gbp_text_search_index_load_locked (self);
+      self->loaded = TRUE;
+    }
+  g_mutex_unlock (&self->mutex);
+
+  /*
+   * Walk the tree and only re-read files whose modification time or size
+   * differs from what was recorded in the index.
+   */
+  seen = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  populate_from_dir (self, vcs, matcher, vcs_relpath, seen, NULL, self->root_directory, cancellable);
+
+  if (g_task_return_error_if_cancelled (task))
+    return;
+
+  g_mutex_lock (&self->mutex);
+
+  gbp_text_search_trigrams_remove_unseen (self->trigrams, seen);
+  gbp_text_search_index_save_locked (self);
+
+  g_debug ("Text search index of %u files built in %lf seconds",
+           gbp_text_search_trigrams_get_n_files (self->trigrams),
+           g_timer_elapsed (timer, NULL));
+
+  g_mutex_unlock (&self->mutex);
+
+  g_task_return_boolean (task, TRUE);
+}
+
+void
+gbp_text_search_index_build_async (GbpTextSearchIndex  *self,
+                                   GCancellable        *cancellable,
+                                   GAsyncReadyCallback  callback,
+                                   gpointer             user_data)
+{
+  g_autoptr(GTask) task = NULL;
+
+  g_return_if_fail (GBP_IS_TEXT_SEARCH_INDEX (self));
+  g_return_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_source_tag (task, gbp_text_search_index_build_async);
+
+  if (self->root_directory == NULL)
+    {
+      g_task_return_new_error (task,
+                               G_IO_ERROR,
+                               G_IO_ERROR_INVALID_FILENAME,
+                               "Root directory has not been set.");
+      return;
+    }
+
+  ide_thread_pool_push_task (IDE_THREAD_POOL_INDEXER, task, gbp_text_search_index_build_worker);
+}
+
+gboolean
+gbp_text_search_index_build_finish (GbpTextSearchIndex  *self,
+                                    GAsyncResult        *result,
+                                    GError             **error)
+{
+  g_return_val_if_fail (GBP_IS_TEXT_SEARCH_INDEX (self), FALSE);
+  g_return_val_if_fail (G_IS_TASK (result), FALSE);
+
+  return g_task_propagate_boolean (G_TASK (result), error);
+}
+
+static void
+gbp_text_search_index_save_worker (GTask        *task,
+                                   gpointer      source_object,
+                                   gpointer      task_data,
+                                   GCancellable *cancellable)
+{
+  GbpTextSearchIndex *self = source_object;
+
+  g_assert (GBP_IS_TEXT_SEARCH_INDEX (self));
+
+  g_mutex_lock (&self->mutex);
+  gbp_text_search_index_save_locked (self);
+  g_mutex_unlock (&self->mutex);
+
+  g_task_return_boolean (task, TRUE);
+}
+
+static gboolean
+gbp_text_search_index_save_timeout (gpointer user_data)
+{
+  GbpTextSearchIndex *self = user_data;
+  g_autoptr(GTask) task = NULL;
+
+  g_assert (GBP_IS_TEXT_SEARCH_INDEX (self));
+
+  self->save_source = 0;
+
+  task = g_task_new (self, NULL, NULL, NULL);
+  g_task_set_source_tag (task, gbp_text_search_index_save_timeout);
+  ide_thread_pool_push_task (IDE_THREAD_POOL_INDEXER, task, gbp_text_search_index_save_worker);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+gbp_text_search_index_queue_save (GbpTextSearchIndex *self)
+{
+  g_assert (GBP_IS_TEXT_SEARCH_INDEX (self));
+
+  if (self->save_source == 0)
+    self->save_source = g_timeout_add_seconds (SAVE_DELAY_SECONDS,
+                                               gbp_text_search_index_save_timeout,
+                                               self);
+}
+
+static void
+gbp_text_search_index_update_worker (GTask        *task,
+                                     gpointer      source_object,
+                                     gpointer      task_data,
+                                     GCancellable *cancellable)
+{
+  GbpTextSearchIndex *self = source_object;
+  GFile *file = task_data;
+  g_autoptr(GFileInfo) info = NULL;
+  g_autofree gchar *path = NULL;
+
+  g_assert (GBP_IS_TEXT_SEARCH_INDEX (self));
+  g_assert (G_IS_FILE (file));
+
+  path = g_file_get_relative_path (self->root_directory, file);
+
+  info = g_file_query_info (file,
+                            G_FILE_ATTRIBUTE_STANDARD_TYPE","
+                            G_FILE_ATTRIBUTE_STANDARD_SIZE","
+                            G_FILE_ATTRIBUTE_TIME_MODIFIED,
+                            G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                            cancellable,
+                            NULL);
+
+  if (info == NULL || g_file_info_get_file_type (info) != G_FILE_TYPE_REGULAR)
+    {
+      g_mutex_lock (&self->mutex);
+      gbp_text_search_trigrams_remove (self->trigrams, path);
+      g_mutex_unlock (&self->mutex);
+    }
+  else
+    {
+      gbp_text_search_index_index_file (self,
+                                        file,
+                                        path,
+                                        g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED),
+                                        g_file_info_get_size (info),
+                                        cancellable);
+    }
+
+  g_task_return_boolean (task, TRUE);
+}
+
+/**
+ * gbp_text_search_index_update_file:
+ *
+ * Re-indexes @file in the background. This is cheap when the file has not
+ * changed since it was last indexed.
+ */
+void
+gbp_text_search_index_update_file (GbpTextSearchIndex *self,
+                                   GFile              *file)
+{
+  g_autoptr(GTask) task = NULL;
+  IdeContext *context;
+  IdeVcs *vcs;
+
+  g_return_if_fail (GBP_IS_TEXT_SEARCH_INDEX (self));
+  g_return_if_fail (G_IS_FILE (file));
+
+  if (!g_file_has_prefix (file, self->root_directory))
+    return;
+
+  context = ide_object_get_context (IDE_OBJECT (self));
+  vcs = ide_context_get_vcs (context);
+
+  if (ide_vcs_is_ignored (vcs, file, NULL))
+    {
+      gbp_text_search_index_remove_file (self, file);
+      return;
+    }
+
+  task = g_task_new (self, NULL, NULL, NULL);
+  g_task_set_source_tag (task, gbp_text_search_index_update_file);
+  g_task_set_task_data (task, g_object_ref (file), g_object_unref);
+  ide_thread_pool_push_task (IDE_THREAD_POOL_INDEXER, task, gbp_text_search_index_update_worker);
+
+  gbp_text_search_index_queue_save (self);
+}
+
+void
+gbp_text_search_index_remove_file (GbpTextSearchIndex *self,
+                                   GFile              *file)
+{
+  g_autofree gchar *path = NULL;
+
+  g_return_if_fail (GBP_IS_TEXT_SEARCH_INDEX (self));
+  g_return_if_fail (G_IS_FILE (file));
+
+  if (!(path = g_file_get_relative_path (self->root_directory, file)))
+    return;
+
+  g_mutex_lock (&self->mutex);
+  gbp_text_search_trigrams_remove (self->trigrams, path);
+  g_mutex_unlock (&self->mutex);
+
+  gbp_text_search_index_queue_save (self);
+}
+
+/*
+ * Returns the relative paths of every indexed file that contains all of
+ * the trigrams in @query. This is a superset of the files that actually
+ * contain @query.
+ */
+static GPtrArray *
+gbp_text_search_index_get_candidates (GbpTextSearchIndex *self,
+                                      const gchar        *query)
+{
+  GPtrArray *ret;
+
+  g_assert (GBP_IS_TEXT_SEARCH_INDEX (self));
+  g_assert (query != NULL);
+
+  g_mutex_lock (&self->mutex);
+  ret = gbp_text_search_trigrams_get_candidates (self->trigrams, query);
+  g_mutex_unlock (&self->mutex);
+
+  return ret;
+}
+
+static const gchar *
+find_ascii_casefold (const gchar *haystack,
+                     gsize        haystack_len,
+                     const gchar *needle,
+                     gsize        needle_len)
+{
+  gchar first = g_ascii_tolower (needle[0]);
+
+  if (needle_len > haystack_len)
+    return NULL;
+
+  for (gsize i = 0; i <= haystack_len - needle_len; i++)
+    {
+      if (g_ascii_tolower (haystack[i]) == first &&
+          g_ascii_strncasecmp (&haystack[i], needle, needle_len) == 0)
+        return &haystack[i];
+    }
+
+  return NULL;
+}
+
+static gchar *
+make_valid_line (const gchar *data,
+                 gsize        len)
+{
+  gchar *line = g_strndup (data, len);
+  const gchar *end;
+  gchar *pos = line;
+
+  while (!g_utf8_validate (pos, -1, &end))
+    {
+      pos = (gchar *)end;
+      *pos = '?';
+    }
+
+  return line;
+}
+
+static void
+collect_matches (GPtrArray   *matches,
+                 const gchar *path,
+                 const gchar *data,
+                 gsize        len,
+                 const gchar *query,
+                 gsize        max_results)
+{
+  const gchar *end = data + len;
+  const gchar *line_start = data;
+  const gchar *pos = data;
+  gsize query_len = strlen (query);
+  guint line_number = 0;
+
+  while (matches->len < max_results &&
+         (pos = find_ascii_casefold (pos, end - pos, query, query_len)))
+    {
+      GbpTextSearchMatch *match;
+      const gchar *line_end;
+
+      for (const gchar *iter = line_start; iter < pos; iter++)
+        {
+          if (*iter == '\n')
+            {
+              line_number++;
+              line_start = iter + 1;
+            }
+        }
+
+      if (!(line_end = memchr (pos, '\n', end - pos)))
+        line_end = end;
+
+      match = g_slice_new0 (GbpTextSearchMatch);
+      match->path = g_strdup (path);
+      match->line = make_valid_line (line_start, line_end - line_start);
+      match->line_number = line_number;
+      match->line_offset = pos - line_start;
+      g_ptr_array_add (matches, match);
+
+      /* Only report the first match on each line */
+      pos = line_end;
+    }
+}
+
+static void
+gbp_text_search_index_query_worker (GTask        *task,
+                                    gpointer      source_object,
+                                    gpointer      task_data,
+                                    GCancellable *cancellable)
+{
+  GbpTextSearchIndex *self = source_object;
+  QueryState *state = task_data;
+  g_autoptr(GPtrArray) candidates = NULL;
+  g_autoptr(GHashTable) candidate_paths = NULL;
+  g_autoptr(GHashTable) unsaved = NULL;
+  GPtrArray *matches;
+
+  g_assert (GBP_IS_TEXT_SEARCH_INDEX (self));
+  g_assert (state != NULL);
+
+  matches = g_ptr_array_new_with_free_func ((GDestroyNotify)gbp_text_search_match_free);
+  candidates = gbp_text_search_index_get_candidates (self, state->query);
+
+  /*
+   * Unsaved buffers win over the contents on disk. They are also checked
+   * even when the index does not list them, since the edits may have added
+   * the text being searched for.
+   */
+  unsaved = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  candidate_paths = g_hash_table_new (g_str_hash, g_str_equal);
+
+  for (guint i = 0; i < candidates->len; i++)
+    g_hash_table_add (candidate_paths, g_ptr_array_index (candidates, i));
+
+  for (guint i = 0; i < state->unsaved_files->len; i++)
+    {
+      IdeUnsavedFile *uf = g_ptr_array_index (state->unsaved_files, i);
+      gchar *path = g_file_get_relative_path (state->root_directory, ide_unsaved_file_get_file (uf));
+
+      if (path == NULL)
+        continue;
+
+      if (!g_hash_table_contains (candidate_paths, path))
+        {
+          gchar *copy = g_strdup (path);
+
+          g_ptr_array_add (candidates, copy);
+          g_hash_table_add (candidate_paths, copy);
+        }
+
+      g_hash_table_insert (unsaved, path, uf);
+    }
+
+  for (guint i = 0; i < candidates->len && matches->len < state->max_results; i++)
+    {
+      const gchar *path = g_ptr_array_index (candidates, i);
+      IdeUnsavedFile *uf;
+
+      if (g_task_return_error_if_cancelled (task))
+        {
+          g_ptr_array_unref (matches);
+          return;
+        }
+
+      if ((uf = g_hash_table_lookup (unsaved, path)))
+        {
+          GBytes *content = ide_unsaved_file_get_content (uf);
+          gsize len = 0;
+          const gchar *data = g_bytes_get_data (content, &len);
+
+          collect_matches (matches, path, data, len, state->query, state->max_results);
+        }
+      else
+        {
+          g_autoptr(GFile) file = g_file_get_child (state->root_directory, path);
+          g_autofree gchar *contents = NULL;
+          gsize len = 0;
+
+          if (g_file_load_contents (file, cancellable, &contents, &len, NULL, NULL))
+            collect_matches (matches, path, contents, len, state->query, state->max_results);
+        }
+    }
+
+  g_task_return_pointer (task, matches, (GDestroyNotify)g_ptr_array_unref);
+}
+
+/**
+ * gbp_text_search_index_query_async:
+ *
+ * Looks for lines containing @query, ignoring ASCII case. Queries shorter
+ * than three bytes cannot use the index and produce no results. Unsaved
+ * buffers are searched instead of the file on disk.
+ */
+void
+gbp_text_search_index_query_async (GbpTextSearchIndex  *self,
+                                   const gchar         *query,
+                                   gsize                max_results,
+                                   GCancellable        *cancellable,
+                                   GAsyncReadyCallback  callback,
+                                   gpointer             user_data)
+{
+  g_autoptr(GTask) task = NULL;
+  IdeUnsavedFiles *unsaved_files;
+  IdeContext *context;
+  QueryState *state;
+
+  g_return_if_fail (GBP_IS_TEXT_SEARCH_INDEX (self));
+  g_return_if_fail (query != NULL);
+  g_return_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_source_tag (task, gbp_text_search_index_query_async);
+
+  if (strlen (query) < 3 || max_results == 0)
+    {
+      g_task_return_pointer (task,
+                             g_ptr_array_new_with_free_func ((GDestroyNotify)gbp_text_search_match_free),
+                             (GDestroyNotify)g_ptr_array_unref);
+      return;
+    }
+
+  context = ide_object_get_context (IDE_OBJECT (self));
+  unsaved_files = ide_context_get_unsaved_files (context);
+
+  state = g_slice_new0 (QueryState);
+  state->query = g_strdup (query);
+  state->root_directory = g_object_ref (self->root_directory);
+  state->unsaved_files = ide_unsaved_files_to_array (unsaved_files);
+  state->max_results = max_results;
+
+  g_task_set_task_data (task, state, query_state_free);
+
+  /*
+   * Queries are interactive, so don't queue them behind indexing work on
+   * the indexer pool.
+   */
+  g_task_run_in_thread (task, gbp_text_search_index_query_worker);
+}
+
+/**
+ * gbp_text_search_index_query_finish:
+ *
+ * Returns: (transfer container) (element-type GbpTextSearchMatch): the matches.
+ */
+GPtrArray *
+gbp_text_search_index_query_finish (GbpTextSearchIndex  *self,
+                                    GAsyncResult        *result,
+                                    GError             **error)
+{
+  g_return_val_if_fail (GBP_IS_TEXT_SEARCH_INDEX (self), NULL);
+  g_return_val_if_fail (G_IS_TASK (result), NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+static void
+gbp_text_search_index_constructed (GObject *object)
+{
+  GbpTextSearchIndex *self = (GbpTextSearchIndex *)object;
+  IdeContext *context;
+  IdeProject *project;
+  g_autofree gchar *name = NULL;
+
+  G_OBJECT_CLASS (gbp_text_search_index_parent_class)->constructed (object);
+
+  context = ide_object_get_context (IDE_OBJECT (self));
+  project = ide_context_get_project (context);
+
+  name = g_strdup_printf ("%s.trigrams", ide_project_get_id (project));
+  self->cache_path = g_build_filename (g_get_user_cache_dir (),
+                                       ide_get_program_name (),
+                                       "text-search",
+                                       name,
+                                       NULL);
+}
+
+static void
+gbp_text_search_index_dispose (GObject *object)
+{
+  GbpTextSearchIndex *self = (GbpTextSearchIndex *)object;
+
+  /*
+   * Pending changes are not flushed here. The next build compares
+   * modification times with the cache and picks them up again.
+   */
+  if (self->save_source != 0)
+    {
+      g_source_remove (self->save_source);
+      self->save_source = 0;
+    }
+
+  G_OBJECT_CLASS (gbp_text_search_index_parent_class)->dispose (object);
+}
+
+static void
+gbp_text_search_index_finalize (GObject *object)
+{
+  GbpTextSearchIndex *self = (GbpTextSearchIndex *)object;
+
+  g_clear_object (&self->root_directory);
+  g_clear_pointer (&self->cache_path, g_free);
+  g_clear_pointer (&self->trigrams, gbp_text_search_trigrams_free);
+  g_mutex_clear (&self->mutex);
+
+  G_OBJECT_CLASS (gbp_text_search_index_parent_class)->finalize (object);
+}
+
+static void
+gbp_text_search_index_get_property (GObject    *object,
+                                    guint       prop_id,
+                                    GValue     *value,
+                                    GParamSpec *pspec)
+{
+  GbpTextSearchIndex *self = GBP_TEXT_SEARCH_INDEX (object);
+
+  switch (prop_id)
+    {
+    case PROP_ROOT_DIRECTORY:
+      g_value_set_object (value, self->root_directory);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+gbp_text_search_index_set_property (GObject      *object,
+                                    guint         prop_id,
+                                    const GValue *value,
+                                    GParamSpec   *pspec)
+{
+  GbpTextSearchIndex *self = GBP_TEXT_SEARCH_INDEX (object);
+
+  switch (prop_id)
+    {
+    case PROP_ROOT_DIRECTORY:
+      self->root_directory = g_value_dup_object (value);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+gbp_text_search_index_class_init (GbpTextSearchIndexClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->constructed = gbp_text_search_index_constructed;
+  object_class->dispose = gbp_text_search_index_dispose;
+  object_class->finalize = gbp_text_search_index_finalize;
+  object_class->get_property = gbp_text_search_index_get_property;
+  object_class->set_property = gbp_text_search_index_set_property;
+
+  properties [PROP_ROOT_DIRECTORY] =
+    g_param_spec_object ("root-directory",
+                         "Root Directory",
+                         "The directory containing the indexed files",
+                         G_TYPE_FILE,
+                         (G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_properties (object_class, N_PROPS, properties);
+}
+
+static void
+gbp_text_search_index_init (GbpTextSearchIndex *self)
+{
+  g_mutex_init (&self->mutex);
+
+  self->trigrams = gbp_text_search_trigrams_new ();
+}
@@ -0,0 +1,64 @@
+/* gbp-text-search-index.h
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GBP_TEXT_SEARCH_INDEX_H
+#define GBP_TEXT_SEARCH_INDEX_H
+
+#include <ide.h>
+
+G_BEGIN_DECLS
+
+#define GBP_TYPE_TEXT_SEARCH_INDEX (gbp_text_search_index_get_type())
+
+G_DECLARE_FINAL_TYPE (GbpTextSearchIndex, gbp_text_search_index, GBP, TEXT_SEARCH_INDEX, IdeObject)
+
+typedef struct
+{
+  gchar *path;
+  gchar *line;
+  guint  line_number;
+  guint  line_offset;
+} GbpTextSearchMatch;
+
+void       gbp_text_search_match_free         (GbpTextSearchMatch   *match);
+void       gbp_text_search_index_build_async  (GbpTextSearchIndex   *self,
+                                               GCancellable         *cancellable,
+                                               GAsyncReadyCallback   callback,
+                                               gpointer              user_data);
+gboolean   gbp_text_search_index_build_finish (GbpTextSearchIndex   *self,
+                                               GAsyncResult         *result,
+                                               GError              **error);
+void       gbp_text_search_index_update_file  (GbpTextSearchIndex   *self,
+                                               GFile                *file);
+void       gbp_text_search_index_remove_file  (GbpTextSearchIndex   *self,
+                                               GFile                *file);
+void       gbp_text_search_index_query_async  (GbpTextSearchIndex   *self,
+                                               const gchar          *query,
+                                               gsize                 max_results,
+                                               GCancellable         *cancellable,
+                                               GAsyncReadyCallback   callback,
+                                               gpointer              user_data);
+GPtrArray *gbp_text_search_index_query_finish (GbpTextSearchIndex   *self,
+                                               GAsyncResult         *result,
+                                               GError              **error);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (GbpTextSearchMatch, gbp_text_search_match_free)
+
+G_END_DECLS
+
+#endif /* GBP_TEXT_SEARCH_INDEX_H */
@@ -0,0 +1,423 @@
+/* gbp-text-search-provider.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define G_LOG_DOMAIN "gbp-text-search-provider"
+
+#include <glib/gi18n.h>
+#include <string.h>
+
+#include "gbp-text-search-index.h"
+#include "gbp-text-search-provider.h"
+#include "gbp-text-search-result.h"
+
+#define MAX_LINE_CHARS 120
+
+struct _GbpTextSearchProvider
+{
+  IdeObject           parent_instance;
+  GbpTextSearchIndex *index;
+};
+
+static void search_provider_iface_init (IdeSearchProviderInterface *iface);
+
+G_DEFINE_TYPE_EXTENDED (GbpTextSearchProvider, gbp_text_search_provider, IDE_TYPE_OBJECT, 0,
+                        G_IMPLEMENT_INTERFACE (IDE_TYPE_SEARCH_PROVIDER, search_provider_iface_init))
+
+typedef struct
+{
+  IdeSearchContext *context;
+  gchar            *query;
+} Populate;
+
+static void
+populate_free (Populate *p)
+{
+  g_clear_object (&p->context);
+  g_clear_pointer (&p->query, g_free);
+  g_slice_free (Populate, p);
+}
+
+static gchar *
+create_title (const GbpTextSearchMatch *match,
+              gsize                     query_len)
+{
+  g_autofree gchar *path = NULL;
+  g_autofree gchar *before = NULL;
+  g_autofree gchar *matched = NULL;
+  g_autofree gchar *after = NULL;
+  const gchar *line = match->line;
+  const gchar *begin = line;
+  const gchar *hit = line + match->line_offset;
+  const gchar *end;
+
+  while (begin < hit && g_ascii_isspace (*begin))
+    begin++;
+
+  end = hit + MIN (query_len, strlen (hit));
+
+  path = g_markup_escape_text (match->path, -1);
+  before = g_markup_escape_text (begin, hit - begin);
+  matched = g_markup_escape_text (hit, end - hit);
+
+  if (g_utf8_strlen (end, -1) > MAX_LINE_CHARS)
+    {
+      g_autofree gchar *truncated = g_utf8_substring (end, 0, MAX_LINE_CHARS);
+      after = g_markup_printf_escaped ("%s…", truncated);
+    }
+  else
+    after = g_markup_escape_text (end, -1);
+
+  return g_strdup_printf ("<span fgalpha='55%%'>%s:%u:</span> %s<b>%s</b>%s",
+                          path, match->line_number + 1,
+                          before, matched, after);
+}
+
+static void
+gbp_text_search_provider_query_cb (GObject      *object,
+                                   GAsyncResult *result,
+                                   gpointer      user_data)
+{
+  GbpTextSearchIndex *index = (GbpTextSearchIndex *)object;
+  g_autoptr(GTask) task = user_data;
+  g_autoptr(GPtrArray) matches = NULL;
+  g_autoptr(GError) error = NULL;
+  GbpTextSearchProvider *self;
+  IdeContext *icontext;
+  Populate *p;
+
+  g_assert (GBP_IS_TEXT_SEARCH_INDEX (index));
+  g_assert (G_IS_TASK (task));
+
+  self = g_task_get_source_object (task);
+  p = g_task_get_task_data (task);
+  icontext = ide_object_get_context (IDE_OBJECT (self));
+
+  matches = gbp_text_search_index_query_finish (index, result, &error);
+
+  if (matches == NULL)
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("%s", error->message);
+      goto completed;
+    }
+
+  for (guint i = 0; i < matches->len; i++)
+    {
+      const GbpTextSearchMatch *match = g_ptr_array_index (matches, i);
+      g_autoptr(GbpTextSearchResult) item = NULL;
+      g_autofree gchar *title = NULL;
+
+      title = create_title (match, strlen (p->query));
+      item = g_object_new (GBP_TYPE_TEXT_SEARCH_RESULT,
+                           "context", icontext,
+                           "provider", self,
+                           "score", 1.0 - ((gfloat)i / (gfloat)matches->len),
+                           "title", title,
+                           "path", match->path,
+                           "line", match->line_number,
+                           "line-offset", (guint)g_utf8_strlen (match->line, match->line_offset),
+                           NULL);
+
+      ide_search_context_add_result (p->context, IDE_SEARCH_PROVIDER (self), IDE_SEARCH_RESULT (item));
+    }
+
+completed:
+  ide_search_context_provider_completed (p->context, IDE_SEARCH_PROVIDER (self));
+  g_task_return_boolean (task, TRUE);
+}
+
+static void
+gbp_text_search_provider_populate (IdeSearchProvider *provider,
+                                   IdeSearchContext  *context,
+                                   const gchar       *search_terms,
+                                   gsize              max_results,
+                                   GCancellable      *cancellable)
+{
+  GbpTextSearchProvider *self = (GbpTextSearchProvider *)provider;
+  g_autoptr(GTask) task = NULL;
+  Populate *p;
+
+  g_assert (GBP_IS_TEXT_SEARCH_PROVIDER (self));
+  g_assert (IDE_IS_SEARCH_CONTEXT (context));
+  g_assert (search_terms != NULL);
+  g_assert (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+  if (self->index == NULL || strlen (search_terms) < 3)
+    {
+      ide_search_context_provider_completed (context, provider);
+      return;
+    }
+
+  p = g_slice_new0 (Populate);
+  p->context = g_object_ref (context);
+  p->query = g_strdup (search_terms);
+
+  task = g_task_new (self, cancellable, NULL, NULL);
+  g_task_set_source_tag (task, gbp_text_search_provider_populate);
+  g_task_set_task_data (task, p, (GDestroyNotify)populate_free);
+
+  gbp_text_search_index_query_async (self->index,
+                                     search_terms,
+                                     max_results,
+                                     cancellable,
+                                     gbp_text_search_provider_query_cb,
+                                     g_steal_pointer (&task));
+}
+
+static const gchar *
+gbp_text_search_provider_get_verb (IdeSearchProvider *provider)
+{
+  return _("Find in Project");
+}
+
+static GtkWidget *
+gbp_text_search_provider_create_row (IdeSearchProvider *provider,
+                                     IdeSearchResult   *result)
+{
+  g_assert (IDE_IS_SEARCH_PROVIDER (provider));
+  g_assert (IDE_IS_SEARCH_RESULT (result));
+
+  return g_object_new (IDE_TYPE_OMNI_SEARCH_ROW,
+                       "icon-name", "edit-find-symbolic",
+                       "result", result,
+                       "visible", TRUE,
+                       NULL);
+}
+
+static void
+gbp_text_search_provider_activate (IdeSearchProvider *provider,
+                                   GtkWidget         *row,
+                                   IdeSearchResult   *result)
+{
+  GbpTextSearchResult *item = (GbpTextSearchResult *)result;
+  g_autoptr(IdeUri) uri = NULL;
+  g_autoptr(GFile) file = NULL;
+  g_autofree gchar *fragment = NULL;
+  IdeWorkbench *workbench;
+  IdeContext *context;
+  IdeVcs *vcs;
+  GFile *workdir;
+
+  g_assert (IDE_IS_SEARCH_PROVIDER (provider));
+  g_assert (GTK_IS_WIDGET (row));
+  g_assert (GBP_IS_TEXT_SEARCH_RESULT (item));
+
+  if (!(workbench = ide_widget_get_workbench (row)))
+    return;
+
+  context = ide_workbench_get_context (workbench);
+  vcs = ide_context_get_vcs (context);
+  workdir = ide_vcs_get_working_directory (vcs);
+  file = g_file_get_child (workdir, gbp_text_search_result_get_path (item));
+
+  uri = ide_uri_new_from_file (file);
+  fragment = g_strdup_printf ("L%u_%u",
+                              gbp_text_search_result_get_line (item),
+                              gbp_text_search_result_get_line_offset (item));
+  ide_uri_set_fragment (uri, fragment);
+
+  ide_workbench_open_uri_async (workbench,
+                                uri,
+                                "editor",
+                                IDE_WORKBENCH_OPEN_FLAGS_NONE,
+                                NULL,
+                                NULL,
+                                NULL);
+}
+
+static gint
+gbp_text_search_provider_get_priority (IdeSearchProvider *provider)
+{
+  return 100;
+}
+
+static void
+gbp_text_search_provider_build_cb (GObject      *object,
+                                   GAsyncResult *result,
+                                   gpointer      user_data)
+{
+  GbpTextSearchIndex *index = (GbpTextSearchIndex *)object;
+  g_autoptr(GbpTextSearchProvider) self = user_data;
+  g_autoptr(GError) error = NULL;
+
+  g_assert (GBP_IS_TEXT_SEARCH_INDEX (index));
+  g_assert (GBP_IS_TEXT_SEARCH_PROVIDER (self));
+
+  if (!gbp_text_search_index_build_finish (index, result, &error))
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("%s", error->message);
+      return;
+    }
+
+  g_set_object (&self->index, index);
+}
+
+static void
+gbp_text_search_provider_vcs_changed_cb (GbpTextSearchProvider *self,
+                                         IdeVcs                *vcs)
+{
+  g_autoptr(GbpTextSearchIndex) index = NULL;
+  IdeContext *context;
+  GFile *workdir;
+
+  g_assert (GBP_IS_TEXT_SEARCH_PROVIDER (self));
+  g_assert (IDE_IS_VCS (vcs));
+
+  context = ide_object_get_context (IDE_OBJECT (self));
+  workdir = ide_vcs_get_working_directory (vcs);
+
+  /*
+   * Rescan the existing index when possible. Files whose modification
+   * time and size are unchanged are not read again.
+   */
+  if (self->index != NULL)
+    index = g_object_ref (self->index);
+  else
+    index = g_object_new (GBP_TYPE_TEXT_SEARCH_INDEX,
+                          "context", context,
+                          "root-directory", workdir,
+                          NULL);
+
+  gbp_text_search_index_build_async (index,
+                                     NULL,
+                                     gbp_text_search_provider_build_cb,
+                                     g_object_ref (self));
+}
+
+static void
+gbp_text_search_provider_buffer_saved_cb (GbpTextSearchProvider *self,
+                                          IdeBuffer             *buffer,
+                                          IdeBufferManager      *bufmgr)
+{
+  g_assert (GBP_IS_TEXT_SEARCH_PROVIDER (self));
+  g_assert (IDE_IS_BUFFER (buffer));
+  g_assert (IDE_IS_BUFFER_MANAGER (bufmgr));
+
+  if (self->index != NULL)
+    gbp_text_search_index_update_file (self->index,
+                                       ide_file_get_file (ide_buffer_get_file (buffer)));
+}
+
+static void
+gbp_text_search_provider_file_renamed_cb (GbpTextSearchProvider *self,
+                                          GFile                 *src_file,
+                                          GFile                 *dst_file,
+                                          IdeProject            *project)
+{
+  g_assert (GBP_IS_TEXT_SEARCH_PROVIDER (self));
+  g_assert (G_IS_FILE (src_file));
+  g_assert (G_IS_FILE (dst_file));
+  g_assert (IDE_IS_PROJECT (project));
+
+  if (self->index != NULL)
+    {
+      gbp_text_search_index_remove_file (self->index, src_file);
+      gbp_text_search_index_update_file (self->index, dst_file);
+    }
+}
+
+static void
+gbp_text_search_provider_file_trashed_cb (GbpTextSearchProvider *self,
+                                          GFile                 *file,
+                                          IdeProject            *project)
+{
+  g_assert (GBP_IS_TEXT_SEARCH_PROVIDER (self));
+  g_assert (G_IS_FILE (file));
+  g_assert (IDE_IS_PROJECT (project));
+
+  if (self->index != NULL)
+    gbp_text_search_index_remove_file (self->index, file);
+}
+
+static void
+gbp_text_search_provider_constructed (GObject *object)
+{
+  GbpTextSearchProvider *self = (GbpTextSearchProvider *)object;
+  IdeBufferManager *bufmgr;
+  IdeContext *context;
+  IdeProject *project;
+  IdeVcs *vcs;
+
+  G_OBJECT_CLASS (gbp_text_search_provider_parent_class)->constructed (object);
+
+  context = ide_object_get_context (IDE_OBJECT (self));
+  bufmgr = ide_context_get_buffer_manager (context);
+  project = ide_context_get_project (context);
+  vcs = ide_context_get_vcs (context);
+
+  g_signal_connect_object (vcs,
+                           "changed",
+                           G_CALLBACK (gbp_text_search_provider_vcs_changed_cb),
+                           self,
+                           G_CONNECT_SWAPPED);
+
+  g_signal_connect_object (bufmgr,
+                           "buffer-saved",
+                           G_CALLBACK (gbp_text_search_provider_buffer_saved_cb),
+                           self,
+                           G_CONNECT_SWAPPED);
+
+  g_signal_connect_object (project,
+                           "file-renamed",
+                           G_CALLBACK (gbp_text_search_provider_file_renamed_cb),
+                           self,
+                           G_CONNECT_SWAPPED);
+
+  g_signal_connect_object (project,
+                           "file-trashed",
+                           G_CALLBACK (gbp_text_search_provider_file_trashed_cb),
+                           self,
+                           G_CONNECT_SWAPPED);
+
+  gbp_text_search_provider_vcs_changed_cb (self, vcs);
+}
+
+static void
+gbp_text_search_provider_finalize (GObject *object)
+{
+  GbpTextSearchProvider *self = (GbpTextSearchProvider *)object;
+
+  g_clear_object (&self->index);
+
+  G_OBJECT_CLASS (gbp_text_search_provider_parent_class)->finalize (object);
+}
+
+static void
+gbp_text_search_provider_class_init (GbpTextSearchProviderClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->constructed = gbp_text_search_provider_constructed;
+  object_class->finalize = gbp_text_search_provider_finalize;
+}
+
+static void
+gbp_text_search_provider_init (GbpTextSearchProvider *self)
+{
+}
+
+static void
+search_provider_iface_init (IdeSearchProviderInterface *iface)
+{
+  iface->populate = gbp_text_search_provider_populate;
+  iface->get_verb = gbp_text_search_provider_get_verb;
+  iface->create_row = gbp_text_search_provider_create_row;
+  iface->activate = gbp_text_search_provider_activate;
+  iface->get_priority = gbp_text_search_provider_get_priority;
+}
@@ -0,0 +1,32 @@
+/* gbp-text-search-provider.h
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GBP_TEXT_SEARCH_PROVIDER_H
+#define GBP_TEXT_SEARCH_PROVIDER_H
+
+#include <ide.h>
+
+G_BEGIN_DECLS
+
+#define GBP_TYPE_TEXT_SEARCH_PROVIDER (gbp_text_search_provider_get_type())
+
+G_DECLARE_FINAL_TYPE (GbpTextSearchProvider, gbp_text_search_provider, GBP, TEXT_SEARCH_PROVIDER, IdeObject)
+
+G_END_DECLS
+
+#endif /* GBP_TEXT_SEARCH_PROVIDER_H */
@@ -0,0 +1,167 @@
+/* gbp-text-search-result.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define G_LOG_DOMAIN "gbp-text-search-result"
+
+#include "gbp-text-search-result.h"
+
+struct _GbpTextSearchResult
+{
+  IdeSearchResult  parent_instance;
+  gchar           *path;
+  guint            line;
+  guint            line_offset;
+};
+
+G_DEFINE_TYPE (GbpTextSearchResult, gbp_text_search_result, IDE_TYPE_SEARCH_RESULT)
+
+enum {
+  PROP_0,
+  PROP_LINE,
+  PROP_LINE_OFFSET,
+  PROP_PATH,
+  N_PROPS
+};
+
+static GParamSpec *properties [N_PROPS];
+
+const gchar *
+gbp_text_search_result_get_path (GbpTextSearchResult *self)
+{
+  g_return_val_if_fail (GBP_IS_TEXT_SEARCH_RESULT (self), NULL);
+
+  return self->path;
+}
+
+guint
+gbp_text_search_result_get_line (GbpTextSearchResult *self)
+{
+  g_return_val_if_fail (GBP_IS_TEXT_SEARCH_RESULT (self), 0);
+
+  return self->line;
+}
+
+guint
+gbp_text_search_result_get_line_offset (GbpTextSearchResult *self)
+{
+  g_return_val_if_fail (GBP_IS_TEXT_SEARCH_RESULT (self), 0);
+
+  return self->line_offset;
+}
+
+static void
+gbp_text_search_result_finalize (GObject *object)
+{
+  GbpTextSearchResult *self = (GbpTextSearchResult *)object;
+
+  g_clear_pointer (&self->path, g_free);
+
+  G_OBJECT_CLASS (gbp_text_search_result_parent_class)->finalize (object);
+}
+
+static void
+gbp_text_search_result_get_property (GObject    *object,
+                                     guint       prop_id,
+                                     GValue     *value,
+                                     GParamSpec *pspec)
+{
+  GbpTextSearchResult *self = (GbpTextSearchResult *)object;
+
+  switch (prop_id)
+    {
+    case PROP_LINE:
+      g_value_set_uint (value, self->line);
+      break;
+
+    case PROP_LINE_OFFSET:
+      g_value_set_uint (value, self->line_offset);
+      break;
+
+    case PROP_PATH:
+      g_value_set_string (value, self->path);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+gbp_text_search_result_set_property (GObject      *object,
+                                     guint         prop_id,
+                                     const GValue *value,
+                                     GParamSpec   *pspec)
+{
+  GbpTextSearchResult *self = (GbpTextSearchResult *)object;
+
+  switch (prop_id)
+    {
+    case PROP_LINE:
+      self->line = g_value_get_uint (value);
+      break;
+
+    case PROP_LINE_OFFSET:
+      self->line_offset = g_value_get_uint (value);
+      break;
+
+    case PROP_PATH:
+      self->path = g_value_dup_string (value);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+gbp_text_search_result_class_init (GbpTextSearchResultClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = gbp_text_search_result_finalize;
+  object_class->get_property = gbp_text_search_result_get_property;
+  object_class->set_property = gbp_text_search_result_set_property;
+
+  properties [PROP_LINE] =
+    g_param_spec_uint ("line",
+                       "Line",
+                       "The zero-based line containing the match.",
+                       0, G_MAXUINT, 0,
+                       (G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS));
+
+  properties [PROP_LINE_OFFSET] =
+    g_param_spec_uint ("line-offset",
+                       "Line Offset",
+                       "The byte offset of the match within the line.",
+                       0, G_MAXUINT, 0,
+                       (G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS));
+
+  properties [PROP_PATH] =
+    g_param_spec_string ("path",
+                         "Path",
+                         "The relative path to the file.",
+                         NULL,
+                         (G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_properties (object_class, N_PROPS, properties);
+}
+
+static void
+gbp_text_search_result_init (GbpTextSearchResult *self)
+{
+}
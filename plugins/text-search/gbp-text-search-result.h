@@ -0,0 +1,36 @@
+/* gbp-text-search-result.h
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GBP_TEXT_SEARCH_RESULT_H
+#define GBP_TEXT_SEARCH_RESULT_H
+
+#include <ide.h>
+
+G_BEGIN_DECLS
+
+#define GBP_TYPE_TEXT_SEARCH_RESULT (gbp_text_search_result_get_type())
+
+G_DECLARE_FINAL_TYPE (GbpTextSearchResult, gbp_text_search_result, GBP, TEXT_SEARCH_RESULT, IdeSearchResult)
+
+const gchar *gbp_text_search_result_get_path        (GbpTextSearchResult *self);
+guint        gbp_text_search_result_get_line        (GbpTextSearchResult *self);
+guint        gbp_text_search_result_get_line_offset (GbpTextSearchResult *self);
+
+G_END_DECLS
+
+#endif /* GBP_TEXT_SEARCH_RESULT_H */
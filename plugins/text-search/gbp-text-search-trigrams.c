@@ -0,0 +1,628 @@
+/* gbp-text-search-trigrams.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define G_LOG_DOMAIN "gbp-text-search-trigrams"
+
+#include <string.h>
+
+#include "gbp-text-search-trigrams.h"
+
+/*
+ * The index maps every trigram (three consecutive bytes, ASCII case folded)
+ * found in a project file to a sorted list of file identifiers containing
+ * it. A query is answered by intersecting the posting lists for each of
+ * its trigrams, which yields a small set of candidate files that are then
+ * confirmed against their real contents.
+ *
+ * File identifiers are only ever appended, so posting lists stay sorted
+ * without any extra work. When a file changes, its old identifier becomes
+ * a tombstone and a new one is allocated. Tombstones are compacted away
+ * the next time the index is saved.
+ *
+ * This structure is not thread-safe, GbpTextSearchIndex serializes access.
+ */
+
+#define CACHE_VERSION      1
+#define CACHE_VARIANT_TYPE "(usa(stt)a(uau))"
+
+typedef struct
+{
+  gchar   *path;
+  guint64  mtime;
+  guint64  size;
+} FileEntry;
+
+struct _GbpTextSearchTrigrams
+{
+  GPtrArray  *files;
+  GHashTable *files_by_path;
+  GHashTable *postings;
+  guint       n_tombstones;
+};
+
+static void
+file_entry_free (gpointer data)
+{
+  FileEntry *entry = data;
+
+  if (entry != NULL)
+    {
+      g_free (entry->path);
+      g_slice_free (FileEntry, entry);
+    }
+}
+
+static inline guint32
+make_trigram (const guint8 *str)
+{
+  return ((guint32)g_ascii_tolower (str[0]) << 16) |
+         ((guint32)g_ascii_tolower (str[1]) << 8) |
+         (guint32)g_ascii_tolower (str[2]);
+}
+
+static gint
+compare_guint32 (gconstpointer a,
+                 gconstpointer b)
+{
+  guint32 ua = *(const guint32 *)a;
+  guint32 ub = *(const guint32 *)b;
+
+  return ua < ub ? -1 : ua > ub ? 1 : 0;
+}
+
+/**
+ * gbp_text_search_collect_trigrams:
+ *
+ * Returns: (transfer full): a sorted array of the unique trigrams found
+ *   in @data, as guint32.
+ */
+GArray *
+gbp_text_search_collect_trigrams (const gchar *data,
+                                  gsize        len)
+{
+  GArray *ar;
+  guint i, j;
+
+  ar = g_array_sized_new (FALSE, FALSE, sizeof (guint32), len > 2 ? len - 2 : 0);
+
+  for (gsize pos = 0; pos + 2 < len; pos++)
+    {
+      guint32 trigram = make_trigram ((const guint8 *)&data[pos]);
+      g_array_append_val (ar, trigram);
+    }
+
+  if (ar->len == 0)
+    return ar;
+
+  g_array_sort (ar, compare_guint32);
+
+  for (i = 1, j = 0; i < ar->len; i++)
+    {
+      if (g_array_index (ar, guint32, i) != g_array_index (ar, guint32, j))
+        g_array_index (ar, guint32, ++j) = g_array_index (ar, guint32, i);
+    }
+
+  g_array_set_size (ar, j + 1);
+
+  return ar;
+}
+
+GbpTextSearchTrigrams *
+gbp_text_search_trigrams_new (void)
+{
+  GbpTextSearchTrigrams *self;
+
+  self = g_slice_new0 (GbpTextSearchTrigrams);
+  self->files = g_ptr_array_new_with_free_func (file_entry_free);
+  self->files_by_path = g_hash_table_new (g_str_hash, g_str_equal);
+  self->postings = g_hash_table_new_full (NULL, NULL, NULL, (GDestroyNotify)g_array_unref);
+
+  return self;
+}
+
+void
+gbp_text_search_trigrams_free (GbpTextSearchTrigrams *self)
+{
+  if (self != NULL)
+    {
+      g_clear_pointer (&self->files_by_path, g_hash_table_unref);
+      g_clear_pointer (&self->files, g_ptr_array_unref);
+      g_clear_pointer (&self->postings, g_hash_table_unref);
+      g_slice_free (GbpTextSearchTrigrams, self);
+    }
+}
+
+/**
+ * gbp_text_search_trigrams_get_n_files:
+ *
+ * Returns: the number of files in the index, excluding removed ones.
+ */
+guint
+gbp_text_search_trigrams_get_n_files (GbpTextSearchTrigrams *self)
+{
+  g_return_val_if_fail (self != NULL, 0);
+
+  return g_hash_table_size (self->files_by_path);
+}
+
+/**
+ * gbp_text_search_trigrams_is_current:
+ *
+ * Checks if @path is indexed with the same modification time and size,
+ * in which case it does not need to be read again.
+ */
+gboolean
+gbp_text_search_trigrams_is_current (GbpTextSearchTrigrams *self,
+                                     const gchar           *path,
+                                     guint64                mtime,
+                                     guint64                size)
+{
+  const FileEntry *entry;
+  gpointer value;
+
+  g_return_val_if_fail (self != NULL, FALSE);
+  g_return_val_if_fail (path != NULL, FALSE);
+
+  if (NULL == (value = g_hash_table_lookup (self->files_by_path, path)))
+    return FALSE;
+
+  entry = g_ptr_array_index (self->files, GPOINTER_TO_UINT (value) - 1);
+
+  return entry->mtime == mtime && entry->size == size;
+}
+
+void
+gbp_text_search_trigrams_remove (GbpTextSearchTrigrams *self,
+                                 const gchar           *path)
+{
+  gpointer value;
+
+  g_return_if_fail (self != NULL);
+  g_return_if_fail (path != NULL);
+
+  if (g_hash_table_lookup_extended (self->files_by_path, path, NULL, &value))
+    {
+      guint id = GPOINTER_TO_UINT (value) - 1;
+
+      g_hash_table_remove (self->files_by_path, path);
+      file_entry_free (g_ptr_array_index (self->files, id));
+      g_ptr_array_index (self->files, id) = NULL;
+      self->n_tombstones++;
+    }
+}
+
+/**
+ * gbp_text_search_trigrams_insert:
+ * @trigrams: the result of gbp_text_search_collect_trigrams()
+ *
+ * Indexes @path, replacing any previous entry for it.
+ */
+void
+gbp_text_search_trigrams_insert (GbpTextSearchTrigrams *self,
+                                 const gchar           *path,
+                                 guint64                mtime,
+                                 guint64                size,
+                                 GArray                *trigrams)
+{
+  FileEntry *entry;
+  guint32 id;
+
+  g_return_if_fail (self != NULL);
+  g_return_if_fail (path != NULL);
+  g_return_if_fail (trigrams != NULL);
+
+  gbp_text_search_trigrams_remove (self, path);
+
+  id = self->files->len;
+
+  entry = g_slice_new0 (FileEntry);
+  entry->path = g_strdup (path);
+  entry->mtime = mtime;
+  entry->size = size;
+
+  g_ptr_array_add (self->files, entry);
+  g_hash_table_insert (self->files_by_path, entry->path, GUINT_TO_POINTER (id + 1));
+
+  for (guint i = 0; i < trigrams->len; i++)
+    {
+      guint32 trigram = g_array_index (trigrams, guint32, i);
+      GArray *posting;
+
+      posting = g_hash_table_lookup (self->postings, GUINT_TO_POINTER (trigram));
+
+      if (posting == NULL)
+        {
+          posting = g_array_new (FALSE, FALSE, sizeof (guint32));
+          g_hash_table_insert (self->postings, GUINT_TO_POINTER (trigram), posting);
+        }
+
+      g_array_append_val (posting, id);
+    }
+}
+
+/**
+ * gbp_text_search_trigrams_remove_unseen:
+ * @seen: a set of paths
+ *
+ * Removes every file whose path is not in @seen, such as files that were
+ * deleted while the project was closed.
+ */
+void
+gbp_text_search_trigrams_remove_unseen (GbpTextSearchTrigrams *self,
+                                        GHashTable            *seen)
+{
+  g_autoptr(GPtrArray) stale = NULL;
+  GHashTableIter iter;
+  gpointer key;
+
+  g_return_if_fail (self != NULL);
+  g_return_if_fail (seen != NULL);
+
+  stale = g_ptr_array_new_with_free_func (g_free);
+
+  g_hash_table_iter_init (&iter, self->files_by_path);
+  while (g_hash_table_iter_next (&iter, &key, NULL))
+    {
+      if (!g_hash_table_contains (seen, key))
+        g_ptr_array_add (stale, g_strdup (key));
+    }
+
+  for (guint i = 0; i < stale->len; i++)
+    gbp_text_search_trigrams_remove (self, g_ptr_array_index (stale, i));
+}
+
+/*
+ * Renumbers the live files so that tombstoned identifiers are dropped from
+ * every posting list. Relative order is preserved, so the posting lists
+ * remain sorted.
+ */
+static void
+gbp_text_search_trigrams_compact (GbpTextSearchTrigrams *self)
+{
+  g_autofree guint32 *remap = NULL;
+  g_autoptr(GPtrArray) files = NULL;
+  GHashTableIter iter;
+  gpointer key;
+  gpointer value;
+
+  g_assert (self != NULL);
+
+  if (self->n_tombstones == 0)
+    return;
+
+  remap = g_new (guint32, self->files->len);
+  files = g_ptr_array_new_with_free_func (file_entry_free);
+
+  for (guint i = 0; i < self->files->len; i++)
+    {
+      FileEntry *entry = g_ptr_array_index (self->files, i);
+
+      if (entry == NULL)
+        {
+          remap[i] = G_MAXUINT32;
+          continue;
+        }
+
+      remap[i] = files->len;
+      g_ptr_array_index (self->files, i) = NULL;
+      g_ptr_array_add (files, entry);
+      g_hash_table_insert (self->files_by_path, entry->path, GUINT_TO_POINTER (remap[i] + 1));
+    }
+
+  g_hash_table_iter_init (&iter, self->postings);
+
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      GArray *posting = value;
+      guint j = 0;
+
+      for (guint i = 0; i < posting->len; i++)
+        {
+          guint32 id = remap[g_array_index (posting, guint32, i)];
+
+          if (id != G_MAXUINT32)
+            g_array_index (posting, guint32, j++) = id;
+        }
+
+      if (j == 0)
+        g_hash_table_iter_remove (&iter);
+      else
+        g_array_set_size (posting, j);
+    }
+
+  g_ptr_array_unref (self->files);
+  self->files = g_steal_pointer (&files);
+  self->n_tombstones = 0;
+}
+
+static void
+gbp_text_search_trigrams_clear (GbpTextSearchTrigrams *self)
+{
+  g_assert (self != NULL);
+
+  g_hash_table_remove_all (self->postings);
+  g_hash_table_remove_all (self->files_by_path);
+  g_ptr_array_set_size (self->files, 0);
+  self->n_tombstones = 0;
+}
+
+/**
+ * gbp_text_search_trigrams_load:
+ * @cache_path: the file written by gbp_text_search_trigrams_save()
+ * @root_path: the directory the indexed paths are relative to
+ *
+ * Replaces the contents of the index with the cache at @cache_path. The
+ * index is left empty if the cache is missing, was written for another
+ * root directory or is corrupt.
+ */
+void
+gbp_text_search_trigrams_load (GbpTextSearchTrigrams *self,
+                               const gchar           *cache_path,
+                               const gchar           *root_path)
+{
+  g_autoptr(GMappedFile) mapped = NULL;
+  g_autoptr(GVariant) variant = NULL;
+  g_autoptr(GVariantIter) files_iter = NULL;
+  g_autoptr(GVariantIter) postings_iter = NULL;
+  g_autoptr(GBytes) bytes = NULL;
+  const gchar *stored_root = NULL;
+  const gchar *path;
+  GVariant *ids;
+  guint64 mtime;
+  guint64 size;
+  guint32 version = 0;
+  guint32 trigram;
+
+  g_return_if_fail (self != NULL);
+  g_return_if_fail (cache_path != NULL);
+
+  gbp_text_search_trigrams_clear (self);
+
+  if (!(mapped = g_mapped_file_new (cache_path, FALSE, NULL)))
+    return;
+
+  bytes = g_mapped_file_get_bytes (mapped);
+  variant = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (CACHE_VARIANT_TYPE), bytes, FALSE));
+
+  if (!g_variant_is_normal_form (variant))
+    return;
+
+  g_variant_get (variant, "(u&sa(stt)a(uau))", &version, &stored_root, &files_iter, &postings_iter);
+
+  if (version != CACHE_VERSION || g_strcmp0 (root_path, stored_root) != 0)
+    return;
+
+  while (g_variant_iter_next (files_iter, "(&stt)", &path, &mtime, &size))
+    {
+      FileEntry *entry;
+
+      entry = g_slice_new0 (FileEntry);
+      entry->path = g_strdup (path);
+      entry->mtime = mtime;
+      entry->size = size;
+
+      g_hash_table_insert (self->files_by_path, entry->path, GUINT_TO_POINTER (self->files->len + 1));
+      g_ptr_array_add (self->files, entry);
+    }
+
+  while (g_variant_iter_next (postings_iter, "(u@au)", &trigram, &ids))
+    {
+      const guint32 *data;
+      GArray *posting;
+      gsize n_ids = 0;
+
+      data = g_variant_get_fixed_array (ids, &n_ids, sizeof (guint32));
+
+      /*
+       * Posting lists must be sorted and refer to known files, otherwise
+       * the cache is corrupt. Drop it and let the crawler rebuild.
+       */
+      for (gsize i = 0; i < n_ids; i++)
+        {
+          if (data[i] >= self->files->len || (i > 0 && data[i] <= data[i - 1]))
+            {
+              g_warning ("Text search index cache is corrupt, rebuilding");
+              g_variant_unref (ids);
+              gbp_text_search_trigrams_clear (self);
+              return;
+            }
+        }
+
+      posting = g_array_sized_new (FALSE, FALSE, sizeof (guint32), n_ids);
+      g_array_append_vals (posting, data, n_ids);
+      g_hash_table_insert (self->postings, GUINT_TO_POINTER (trigram), posting);
+
+      g_variant_unref (ids);
+    }
+
+  g_debug ("Loaded text search index with %u files and %u trigrams",
+           self->files->len, g_hash_table_size (self->postings));
+}
+
+/**
+ * gbp_text_search_trigrams_save:
+ * @cache_path: the file to write
+ * @root_path: the directory the indexed paths are relative to
+ *
+ * Compacts the index and writes it to @cache_path, creating the parent
+ * directory if necessary.
+ *
+ * Returns: %TRUE if successful, otherwise %FALSE and @error is set.
+ */
+gboolean
+gbp_text_search_trigrams_save (GbpTextSearchTrigrams  *self,
+                               const gchar            *cache_path,
+                               const gchar            *root_path,
+                               GError                **error)
+{
+  g_autoptr(GVariant) variant = NULL;
+  g_autofree gchar *dir = NULL;
+  GVariantBuilder files_builder;
+  GVariantBuilder postings_builder;
+  GHashTableIter iter;
+  gpointer key;
+  gpointer value;
+
+  g_return_val_if_fail (self != NULL, FALSE);
+  g_return_val_if_fail (cache_path != NULL, FALSE);
+
+  gbp_text_search_trigrams_compact (self);
+
+  g_variant_builder_init (&files_builder, G_VARIANT_TYPE ("a(stt)"));
+
+  for (guint i = 0; i < self->files->len; i++)
+    {
+      const FileEntry *entry = g_ptr_array_index (self->files, i);
+
+      g_variant_builder_add (&files_builder, "(stt)", entry->path, entry->mtime, entry->size);
+    }
+
+  g_variant_builder_init (&postings_builder, G_VARIANT_TYPE ("a(uau)"));
+
+  g_hash_table_iter_init (&iter, self->postings);
+
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      GArray *posting = value;
+
+      g_variant_builder_add (&postings_builder, "(u@au)",
+                             GPOINTER_TO_UINT (key),
+                             g_variant_new_fixed_array (G_VARIANT_TYPE_UINT32,
+                                                        posting->data,
+                                                        posting->len,
+                                                        sizeof (guint32)));
+    }
+
+  variant = g_variant_ref_sink (g_variant_new ("(usa(stt)a(uau))",
+                                               CACHE_VERSION,
+                                               root_path ? root_path : "",
+                                               &files_builder,
+                                               &postings_builder));
+
+  dir = g_path_get_dirname (cache_path);
+  g_mkdir_with_parents (dir, 0750);
+
+  return g_file_set_contents (cache_path,
+                              g_variant_get_data (variant),
+                              g_variant_get_size (variant),
+                              error);
+}
+
+/*
+ * Intersects two sorted posting lists in place, leaving the result in @a.
+ */
+static void
+intersect_postings (GArray       *a,
+                    const GArray *b)
+{
+  guint i = 0;
+  guint j = 0;
+  guint n = 0;
+
+  while (i < a->len && j < b->len)
+    {
+      guint32 ai = g_array_index (a, guint32, i);
+      guint32 bj = g_array_index (b, guint32, j);
+
+      if (ai < bj)
+        i++;
+      else if (ai > bj)
+        j++;
+      else
+        {
+          g_array_index (a, guint32, n++) = ai;
+          i++;
+          j++;
+        }
+    }
+
+  g_array_set_size (a, n);
+}
+
+static gint
+compare_posting_len (gconstpointer a,
+                     gconstpointer b)
+{
+  const GArray *pa = *(const GArray * const *)a;
+  const GArray *pb = *(const GArray * const *)b;
+
+  return (gint)pa->len - (gint)pb->len;
+}
+
+/**
+ * gbp_text_search_trigrams_get_candidates:
+ *
+ * Returns the paths of every indexed file that contains all of the
+ * trigrams in @query. This is a superset of the files that actually
+ * contain @query, ignoring ASCII case.
+ *
+ * Returns: (transfer container) (element-type utf8): the paths
+ */
+GPtrArray *
+gbp_text_search_trigrams_get_candidates (GbpTextSearchTrigrams *self,
+                                         const gchar           *query)
+{
+  g_autoptr(GPtrArray) lists = NULL;
+  g_autoptr(GArray) trigrams = NULL;
+  g_autoptr(GArray) ids = NULL;
+  GPtrArray *ret;
+
+  g_return_val_if_fail (self != NULL, NULL);
+  g_return_val_if_fail (query != NULL, NULL);
+
+  ret = g_ptr_array_new_with_free_func (g_free);
+  trigrams = gbp_text_search_collect_trigrams (query, strlen (query));
+  lists = g_ptr_array_sized_new (trigrams->len);
+
+  for (guint i = 0; i < trigrams->len; i++)
+    {
+      guint32 trigram = g_array_index (trigrams, guint32, i);
+      GArray *posting = g_hash_table_lookup (self->postings, GUINT_TO_POINTER (trigram));
+
+      if (posting == NULL)
+        return ret;
+
+      g_ptr_array_add (lists, posting);
+    }
+
+  if (lists->len == 0)
+    return ret;
+
+  /* Start from the most selective trigram to keep the working set small */
+  g_ptr_array_sort (lists, compare_posting_len);
+
+  {
+    const GArray *first = g_ptr_array_index (lists, 0);
+
+    ids = g_array_sized_new (FALSE, FALSE, sizeof (guint32), first->len);
+    g_array_append_vals (ids, first->data, first->len);
+  }
+
+  for (guint i = 1; i < lists->len && ids->len > 0; i++)
+    intersect_postings (ids, g_ptr_array_index (lists, i));
+
+  for (guint i = 0; i < ids->len; i++)
+    {
+      const FileEntry *entry = g_ptr_array_index (self->files, g_array_index (ids, guint32, i));
+
+      if (entry != NULL)
+        g_ptr_array_add (ret, g_strdup (entry->path));
+    }
+
+  return ret;
+}
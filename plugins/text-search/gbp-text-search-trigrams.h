@@ -0,0 +1,60 @@
+/* gbp-text-search-trigrams.h
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GBP_TEXT_SEARCH_TRIGRAMS_H
+#define GBP_TEXT_SEARCH_TRIGRAMS_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GbpTextSearchTrigrams GbpTextSearchTrigrams;
+
+GArray                *gbp_text_search_collect_trigrams        (const gchar            *data,
+                                                                gsize                   len);
+GbpTextSearchTrigrams *gbp_text_search_trigrams_new            (void);
+void                   gbp_text_search_trigrams_free           (GbpTextSearchTrigrams  *self);
+guint                  gbp_text_search_trigrams_get_n_files    (GbpTextSearchTrigrams  *self);
+gboolean               gbp_text_search_trigrams_is_current     (GbpTextSearchTrigrams  *self,
+                                                                const gchar            *path,
+                                                                guint64                 mtime,
+                                                                guint64                 size);
+void                   gbp_text_search_trigrams_insert         (GbpTextSearchTrigrams  *self,
+                                                                const gchar            *path,
+                                                                guint64                 mtime,
+                                                                guint64                 size,
+                                                                GArray                 *trigrams);
+void                   gbp_text_search_trigrams_remove         (GbpTextSearchTrigrams  *self,
+                                                                const gchar            *path);
+void                   gbp_text_search_trigrams_remove_unseen  (GbpTextSearchTrigrams  *self,
+                                                                GHashTable             *seen);
+GPtrArray             *gbp_text_search_trigrams_get_candidates (GbpTextSearchTrigrams  *self,
+                                                                const gchar            *query);
+void                   gbp_text_search_trigrams_load           (GbpTextSearchTrigrams  *self,
+                                                                const gchar            *cache_path,
+                                                                const gchar            *root_path);
+gboolean               gbp_text_search_trigrams_save           (GbpTextSearchTrigrams  *self,
+                                                                const gchar            *cache_path,
+                                                                const gchar            *root_path,
+                                                                GError                **error);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (GbpTextSearchTrigrams, gbp_text_search_trigrams_free)
+
+G_END_DECLS
+
+#endif /* GBP_TEXT_SEARCH_TRIGRAMS_H */
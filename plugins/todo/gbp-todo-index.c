@@ -0,0 +1,959 @@
+/* gbp-todo-index.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define G_LOG_DOMAIN "gbp-todo-index"
+
+#include "gbp-todo-index.h"
+#include "gbp-todo-item.h"
+#include "gbp-todo-miner.h"
+
+/*
+ * The index remembers the todo items found in every project file along
+ * with the modification time and size the file had when it was mined. It
+ * is persisted to the cache directory, so re-opening a project only reads
+ * the files that changed in the mean time.
+ *
+ * Mining walks the tree with the VCS ignore matcher, then splits the files
+ * that need to be read among several indexer threads. IdeVcs cannot list the
+ * files it tracks, so untracked files that are not ignored are mined too,
+ * which is also what makes todo items show up in files not yet added. Results are handed
+ * to the main thread in batches and delivered with the
+ * GbpTodoIndex::file-mined signal.
+ *
+ * The index is a service so that every workbench of a context shares the
+ * same instance, and with it the cache file it writes.
+ */
+
+#define BATCH_SIZE         64
+#define BATCH_DELAY_USEC   (G_USEC_PER_SEC / 20)
+#define FILES_PER_THREAD   32
+#define SAVE_DELAY_SECONDS 10
+
+typedef struct
+{
+  GFile   *file;
+  gchar   *path;
+  guint64  mtime;
+  guint64  size;
+} ScanJob;
+
+typedef struct
+{
+  GFile     *file;
+  GPtrArray *items;
+} MinedFile;
+
+typedef struct
+{
+  GbpTodoIndex *self;
+  GPtrArray    *batch;
+} Flush;
+
+typedef struct
+{
+  volatile gint  ref_count;
+  volatile gint  next_job;
+  volatile gint  n_active;
+  GTask         *task;
+  GPtrArray     *jobs;
+
+  /* Protects @batch and @last_flush */
+  GMutex         mutex;
+  GPtrArray     *batch;
+  gint64         last_flush;
+} MineState;
+
+struct _GbpTodoIndex
+{
+  IdeObject   parent_instance;
+
+  GFile      *root_directory;
+  gchar      *cache_path;
+
+  /*
+   * Everything below is protected by @mutex since the index is updated
+   * from several miner threads at once.
+   */
+  GMutex      mutex;
+  GHashTable *files;
+  guint       loaded : 1;
+
+  guint       save_source;
+};
+
+static void service_iface_init (IdeServiceInterface *iface);
+
+G_DEFINE_TYPE_EXTENDED (GbpTodoIndex, gbp_todo_index, IDE_TYPE_OBJECT, 0,
+                        G_IMPLEMENT_INTERFACE (IDE_TYPE_SERVICE, service_iface_init))
+
+enum {
+  PROP_0,
+  PROP_ROOT_DIRECTORY,
+  N_PROPS
+};
+
+enum {
+  FILE_MINED,
+  N_SIGNALS
+};
+
+static GParamSpec *properties [N_PROPS];
+static guint signals [N_SIGNALS];
+
+static void
+scan_job_free (gpointer data)
+{
+  ScanJob *job = data;
+
+  g_clear_object (&job->file);
+  g_free (job->path);
+  g_slice_free (ScanJob, job);
+}
+
+static void
+mined_file_free (gpointer data)
+{
+  MinedFile *mined = data;
+
+  g_clear_object (&mined->file);
+  g_clear_pointer (&mined->items, g_ptr_array_unref);
+  g_slice_free (MinedFile, mined);
+}
+
+static void
+flush_free (gpointer data)
+{
+  Flush *flush = data;
+
+  g_clear_object (&flush->self);
+  g_clear_pointer (&flush->batch, g_ptr_array_unref);
+  g_slice_free (Flush, flush);
+}
+
+static MineState *
+mine_state_new (GTask *task)
+{
+  MineState *state;
+
+  state = g_slice_new0 (MineState);
+  state->ref_count = 1;
+  state->task = g_object_ref (task);
+  state->jobs = g_ptr_array_new_with_free_func (scan_job_free);
+  state->batch = g_ptr_array_new_with_free_func (mined_file_free);
+  state->last_flush = g_get_monotonic_time ();
+  g_mutex_init (&state->mutex);
+
+  return state;
+}
+
+static MineState *
+mine_state_ref (MineState *state)
+{
+  g_atomic_int_inc (&state->ref_count);
+
+  return state;
+}
+
+static void
+mine_state_unref (MineState *state)
+{
+  if (g_atomic_int_dec_and_test (&state->ref_count))
+    {
+      g_clear_object (&state->task);
+      g_clear_pointer (&state->jobs, g_ptr_array_unref);
+      g_clear_pointer (&state->batch, g_ptr_array_unref);
+      g_mutex_clear (&state->mutex);
+      g_slice_free (MineState, state);
+    }
+}
+
+static GPtrArray *
+new_item_array (void)
+{
+  return g_ptr_array_new_with_free_func ((GDestroyNotify)gbp_todo_item_unref);
+}
+
+static void
+gbp_todo_index_insert_locked (GbpTodoIndex *self,
+                              const gchar  *path,
+                              guint64       mtime,
+                              guint64       size,
+                              GPtrArray    *items)
+{
+  g_assert (GBP_IS_TODO_INDEX (self));
+  g_assert (path != NULL);
+  g_assert (items != NULL);
+
+  g_hash_table_insert (self->files,
+                       g_strdup (path),
+                       gbp_todo_file_entry_new (mtime, size, items));
+}
+
+static void
+gbp_todo_index_ensure_loaded_locked (GbpTodoIndex *self)
+{
+  g_assert (GBP_IS_TODO_INDEX (self));
+
+  if (self->loaded)
+    return;
+
+  self->loaded = TRUE;
+
+  if (self->cache_path == NULL)
+    return;
+
+  g_clear_pointer (&self->files, g_hash_table_unref);
+  self->files = gbp_todo_miner_load_cache (self->cache_path, self->root_directory);
+
+  g_debug ("Loaded todo index with %u files", g_hash_table_size (self->files));
+}
+
+static void
+gbp_todo_index_save_locked (GbpTodoIndex *self)
+{
+  g_autoptr(GError) error = NULL;
+
+  g_assert (GBP_IS_TODO_INDEX (self));
+
+  if (self->cache_path == NULL)
+    return;
+
+  if (!gbp_todo_miner_save_cache (self->cache_path, self->root_directory, self->files, &error))
+    g_warning ("Failed to save todo index: %s", error->message);
+}
+
+/*
+ * Services may be created before the project name has been loaded, so the
+ * cache path is resolved when the index is first used.
+ */
+static void
+gbp_todo_index_ensure_cache_path (GbpTodoIndex *self)
+{
+  g_autofree gchar *name = NULL;
+  IdeContext *context;
+  IdeProject *project;
+
+  g_assert (GBP_IS_TODO_INDEX (self));
+
+  if (self->cache_path != NULL)
+    return;
+
+  context = ide_object_get_context (IDE_OBJECT (self));
+  project = ide_context_get_project (context);
+
+  name = g_strdup_printf ("%s.todo", ide_project_get_id (project));
+  self->cache_path = g_build_filename (g_get_user_cache_dir (),
+                                       ide_get_program_name (),
+                                       "todo",
+                                       name,
+                                       NULL);
+}
+
+static gboolean
+gbp_todo_index_flush_cb (gpointer user_data)
+{
+  Flush *flush = user_data;
+
+  g_assert (flush != NULL);
+  g_assert (GBP_IS_TODO_INDEX (flush->self));
+
+  for (guint i = 0; i < flush->batch->len; i++)
+    {
+      MinedFile *mined = g_ptr_array_index (flush->batch, i);
+
+      g_signal_emit (flush->self, signals [FILE_MINED], 0, mined->file, mined->items);
+    }
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+mine_state_flush_locked (MineState *state)
+{
+  Flush *flush;
+
+  g_assert (state != NULL);
+
+  state->last_flush = g_get_monotonic_time ();
+
+  if (state->batch->len == 0)
+    return;
+
+  flush = g_slice_new0 (Flush);
+  flush->self = g_object_ref (g_task_get_source_object (state->task));
+  flush->batch = state->batch;
+
+  state->batch = g_ptr_array_new_with_free_func (mined_file_free);
+
+  /* Same priority as the task completion so the last batch arrives first */
+  g_idle_add_full (G_PRIORITY_DEFAULT, gbp_todo_index_flush_cb, flush, flush_free);
+}
+
+static void
+mine_state_post (MineState *state,
+                 GFile     *file,
+                 GPtrArray *items)
+{
+  MinedFile *mined;
+
+  g_assert (state != NULL);
+  g_assert (G_IS_FILE (file));
+  g_assert (items != NULL);
+
+  mined = g_slice_new0 (MinedFile);
+  mined->file = g_object_ref (file);
+  mined->items = g_ptr_array_ref (items);
+
+  g_mutex_lock (&state->mutex);
+  g_ptr_array_add (state->batch, mined);
+  if (state->batch->len >= BATCH_SIZE ||
+      g_get_monotonic_time () - state->last_flush >= BATCH_DELAY_USEC)
+    mine_state_flush_locked (state);
+  g_mutex_unlock (&state->mutex);
+}
+
+/*
+ * Collects the files of @directory that changed since they were last mined
+ * into @state, and posts the cached items of those that did not.
+ */
+static void
+gbp_todo_index_walk (GbpTodoIndex        *self,
+                     MineState           *state,
+                     IdeVcs              *vcs,
+                     IdeVcsIgnoreMatcher *matcher,
+                     const gchar         *vcs_relpath,
+                     GHashTable          *seen,
+                     const gchar         *relpath,
+                     GFile               *directory,
+                     GCancellable        *cancellable)
+{
+  g_autoptr(GFileEnumerator) enumerator = NULL;
+  g_autoptr(GPtrArray) children = NULL;
+  gpointer file_info_ptr;
+
+  g_assert (GBP_IS_TODO_INDEX (self));
+  g_assert (state != NULL);
+  g_assert (G_IS_FILE (directory));
+
+  if (g_cancellable_is_cancelled (cancellable))
+    return;
+
+  if (ide_vcs_ignore_matcher_is_file_ignored (matcher, vcs, vcs_relpath, directory, TRUE))
+    return;
+
+  enumerator = g_file_enumerate_children (directory,
+                                          G_FILE_ATTRIBUTE_STANDARD_NAME","
+                                          G_FILE_ATTRIBUTE_STANDARD_TYPE","
+                                          G_FILE_ATTRIBUTE_STANDARD_SIZE","
+                                          G_FILE_ATTRIBUTE_TIME_MODIFIED","
+                                          G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+                                          G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                          cancellable,
+                                          NULL);
+
+  if (enumerator == NULL)
+    return;
+
+  while ((file_info_ptr = g_file_enumerator_next_file (enumerator, cancellable, NULL)))
+    {
+      g_autoptr(GFileInfo) file_info = file_info_ptr;
+      g_autoptr(GFile) file = NULL;
+      g_autoptr(GPtrArray) cached = NULL;
+      g_autofree gchar *path = NULL;
+      g_autofree gchar *vcs_path = NULL;
+      const GbpTodoFileEntry *entry;
+      const gchar *name;
+      GFileType file_type;
+      guint64 mtime;
+      guint64 size;
+
+      name = g_file_info_get_name (file_info);
+      file = g_file_get_child (directory, name);
+      file_type = g_file_info_get_file_type (file_info);
+
+      if (file_type == G_FILE_TYPE_DIRECTORY)
+        {
+          if (children == NULL)
+            children = g_ptr_array_new_with_free_func (g_object_unref);
+          g_ptr_array_add (children, g_steal_pointer (&file));
+          continue;
+        }
+
+      if (file_type != G_FILE_TYPE_REGULAR)
+        continue;
+
+      if (vcs_relpath != NULL)
+        vcs_path = ide_vcs_ignore_matcher_build_path (vcs_relpath, name);
+
+      if (ide_vcs_ignore_matcher_is_file_ignored (matcher, vcs, vcs_path, file, FALSE))
+        continue;
+
+      path = ide_vcs_ignore_matcher_build_path (relpath, name);
+      mtime = gbp_todo_miner_get_mtime (file_info);
+      size = g_file_info_get_size (file_info);
+
+      g_mutex_lock (&self->mutex);
+      entry = g_hash_table_lookup (self->files, path);
+      if (entry != NULL && entry->mtime == mtime && entry->size == size)
+        cached = g_ptr_array_ref (entry->items);
+      g_mutex_unlock (&self->mutex);
+
+      if (cached != NULL)
+        {
+          if (cached->len > 0)
+            mine_state_post (state, file, cached);
+        }
+      else
+        {
+          ScanJob *job;
+
+          job = g_slice_new0 (ScanJob);
+          job->file = g_object_ref (file);
+          job->path = g_strdup (path);
+          job->mtime = mtime;
+          job->size = size;
+
+          g_ptr_array_add (state->jobs, job);
+        }
+
+      g_hash_table_add (seen, g_steal_pointer (&path));
+    }
+
+  if (children != NULL)
+    {
+      for (guint i = 0; i < children->len; i++)
+        {
+          GFile *child = g_ptr_array_index (children, i);
+          g_autofree gchar *name = g_file_get_basename (child);
+          g_autofree gchar *path = NULL;
+          g_autofree gchar *vcs_path = NULL;
+
+          path = ide_vcs_ignore_matcher_build_path (relpath, name);
+          if (vcs_relpath != NULL)
+            vcs_path = ide_vcs_ignore_matcher_build_path (vcs_relpath, name);
+          gbp_todo_index_walk (self, state, vcs, matcher, vcs_path, seen, path, child, cancellable);
+        }
+    }
+}
+
+static void
+gbp_todo_index_mine_complete (MineState *state)
+{
+  GbpTodoIndex *self;
+
+  g_assert (state != NULL);
+
+  self = g_task_get_source_object (state->task);
+
+  g_mutex_lock (&state->mutex);
+  mine_state_flush_locked (state);
+  g_mutex_unlock (&state->mutex);
+
+  if (g_task_return_error_if_cancelled (state->task))
+    return;
+
+  g_mutex_lock (&self->mutex);
+  gbp_todo_index_save_locked (self);
+  g_mutex_unlock (&self->mutex);
+
+  g_task_return_boolean (state->task, TRUE);
+}
+
+/*
+ * Runs on each of the miner threads, pulling files from the shared job
+ * list until it is exhausted. The last thread to finish completes the
+ * task. Takes ownership of the reference to @data.
+ */
+static void
+gbp_todo_index_scan_worker (gpointer data)
+{
+  MineState *state = data;
+  GbpTodoIndex *self;
+  GCancellable *cancellable;
+  gint i;
+
+  g_assert (state != NULL);
+
+  self = g_task_get_source_object (state->task);
+  cancellable = g_task_get_cancellable (state->task);
+
+  while (!g_cancellable_is_cancelled (cancellable) &&
+         (i = g_atomic_int_add (&state->next_job, 1)) < (gint)state->jobs->len)
+    {
+      const ScanJob *job = g_ptr_array_index (state->jobs, i);
+      g_autoptr(GPtrArray) items = NULL;
+
+      items = gbp_todo_miner_scan_file (job->file, job->path, job->size, cancellable);
+
+      g_mutex_lock (&self->mutex);
+      if (items != NULL)
+        gbp_todo_index_insert_locked (self, job->path, job->mtime, job->size, items);
+      else
+        g_hash_table_remove (self->files, job->path);
+      g_mutex_unlock (&self->mutex);
+
+      if (items != NULL && items->len > 0)
+        mine_state_post (state, job->file, items);
+    }
+
+  if (g_atomic_int_dec_and_test (&state->n_active))
+    gbp_todo_index_mine_complete (state);
+
+  mine_state_unref (state);
+}
+
+static void
+gbp_todo_index_mine_worker (GTask        *task,
+                            gpointer      source_object,
+                            gpointer      task_data,
+                            GCancellable *cancellable)
+{
+  GbpTodoIndex *self = source_object;
+  g_autoptr(IdeVcsIgnoreMatcher) matcher = NULL;
+  g_autoptr(GHashTable) seen = NULL;
+  g_autofree gchar *vcs_relpath = NULL;
+  GHashTableIter iter;
+  MineState *state;
+  IdeContext *context;
+  GFile *workdir;
+  gpointer key;
+  IdeVcs *vcs;
+  guint n_threads;
+
+  g_assert (G_IS_TASK (task));
+  g_assert (GBP_IS_TODO_INDEX (self));
+
+  context = ide_object_get_context (IDE_OBJECT (self));
+  vcs = ide_context_get_vcs (context);
+  workdir = ide_vcs_get_working_directory (vcs);
+
+  /* The matcher wants paths relative to the working directory */
+  if ((matcher = ide_vcs_get_ignore_matcher (vcs)) && workdir != NULL)
+    {
+      if (g_file_equal (workdir, self->root_directory))
+        vcs_relpath = g_strdup ("");
+      else
+        vcs_relpath = g_file_get_relative_path (workdir, self->root_directory);
+    }
+
+  g_mutex_lock (&self->mutex);
+  gbp_todo_index_ensure_loaded_locked (self);
+  g_mutex_unlock (&self->mutex);
+
+  state = mine_state_new (task);
+  seen = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  gbp_todo_index_walk (self, state, vcs, matcher, vcs_relpath, seen, NULL, self->root_directory, cancellable);
+
+  if (g_task_return_error_if_cancelled (task))
+    {
+      mine_state_unref (state);
+      return;
+    }
+
+  /* Forget about files that were removed or are ignored now */
+  g_mutex_lock (&self->mutex);
+  g_hash_table_iter_init (&iter, self->files);
+  while (g_hash_table_iter_next (&iter, &key, NULL))
+    {
+      if (!g_hash_table_contains (seen, key))
+        g_hash_table_iter_remove (&iter);
+    }
+  g_mutex_unlock (&self->mutex);
+
+  g_debug ("%u files need to be mined for todo items", state->jobs->len);
+
+  /*
+   * This thread takes part in mining too, so the task completes even if
+   * the thread pool does not get to the helpers until we are done.
+   */
+  n_threads = CLAMP (state->jobs->len / FILES_PER_THREAD, 1, MAX (1, ide_thread_pool_get_n_threads ()));
+  state->n_active = n_threads;
+
+  for (guint i = 1; i < n_threads; i++)
+    ide_thread_pool_push (IDE_THREAD_POOL_INDEXER,
+                          gbp_todo_index_scan_worker,
+                          mine_state_ref (state));
+
+  gbp_todo_index_scan_worker (state);
+}
+
+/**
+ * gbp_todo_index_mine_async:
+ *
+ * Mines the whole project for todo items. Items are delivered with the
+ * GbpTodoIndex::file-mined signal as they are found, @callback is called
+ * once all of them have been delivered.
+ */
+void
+gbp_todo_index_mine_async (GbpTodoIndex        *self,
+                           GCancellable        *cancellable,
+                           GAsyncReadyCallback  callback,
+                           gpointer             user_data)
+{
+  g_autoptr(GTask) task = NULL;
+
+  g_return_if_fail (GBP_IS_TODO_INDEX (self));
+  g_return_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_source_tag (task, gbp_todo_index_mine_async);
+
+  if (self->root_directory == NULL)
+    {
+      g_task_return_new_error (task,
+                               G_IO_ERROR,
+                               G_IO_ERROR_INVALID_FILENAME,
+                               "Root directory has not been set.");
+      return;
+    }
+
+  gbp_todo_index_ensure_cache_path (self);
+
+  ide_thread_pool_push_task (IDE_THREAD_POOL_INDEXER, task, gbp_todo_index_mine_worker);
+}
+
+gboolean
+gbp_todo_index_mine_finish (GbpTodoIndex  *self,
+                            GAsyncResult  *result,
+                            GError       **error)
+{
+  g_return_val_if_fail (GBP_IS_TODO_INDEX (self), FALSE);
+  g_return_val_if_fail (G_IS_TASK (result), FALSE);
+
+  return g_task_propagate_boolean (G_TASK (result), error);
+}
+
+static void
+gbp_todo_index_save_worker (GTask        *task,
+                            gpointer      source_object,
+                            gpointer      task_data,
+                            GCancellable *cancellable)
+{
+  GbpTodoIndex *self = source_object;
+
+  g_assert (GBP_IS_TODO_INDEX (self));
+
+  g_mutex_lock (&self->mutex);
+  gbp_todo_index_save_locked (self);
+  g_mutex_unlock (&self->mutex);
+
+  g_task_return_boolean (task, TRUE);
+}
+
+static gboolean
+gbp_todo_index_save_timeout (gpointer user_data)
+{
+  GbpTodoIndex *self = user_data;
+  g_autoptr(GTask) task = NULL;
+
+  g_assert (GBP_IS_TODO_INDEX (self));
+
+  self->save_source = 0;
+
+  task = g_task_new (self, NULL, NULL, NULL);
+  g_task_set_source_tag (task, gbp_todo_index_save_timeout);
+  ide_thread_pool_push_task (IDE_THREAD_POOL_INDEXER, task, gbp_todo_index_save_worker);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+gbp_todo_index_queue_save (GbpTodoIndex *self)
+{
+  g_assert (GBP_IS_TODO_INDEX (self));
+
+  if (self->save_source == 0)
+    self->save_source = g_timeout_add_seconds (SAVE_DELAY_SECONDS,
+                                               gbp_todo_index_save_timeout,
+                                               self);
+}
+
+static void
+gbp_todo_index_mine_file_worker (GTask        *task,
+                                 gpointer      source_object,
+                                 gpointer      task_data,
+                                 GCancellable *cancellable)
+{
+  GbpTodoIndex *self = source_object;
+  GFile *file = task_data;
+  g_autoptr(IdeVcsIgnoreMatcher) matcher = NULL;
+  g_autoptr(GFileInfo) info = NULL;
+  g_autoptr(GPtrArray) items = NULL;
+  g_autofree gchar *path = NULL;
+  g_autofree gchar *vcs_path = NULL;
+  IdeContext *context;
+  GFile *workdir;
+  IdeVcs *vcs;
+
+  g_assert (GBP_IS_TODO_INDEX (self));
+  g_assert (G_IS_FILE (file));
+
+  context = ide_object_get_context (IDE_OBJECT (self));
+  vcs = ide_context_get_vcs (context);
+  workdir = ide_vcs_get_working_directory (vcs);
+
+  path = g_file_get_relative_path (self->root_directory, file);
+
+  info = g_file_query_info (file,
+                            G_FILE_ATTRIBUTE_STANDARD_TYPE","
+                            G_FILE_ATTRIBUTE_STANDARD_SIZE","
+                            G_FILE_ATTRIBUTE_TIME_MODIFIED","
+                            G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+                            G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                            cancellable,
+                            NULL);
+
+  if ((matcher = ide_vcs_get_ignore_matcher (vcs)) && workdir != NULL)
+    vcs_path = g_file_get_relative_path (workdir, file);
+
+  /* Ignored files are dropped from the index, like a full mining would */
+  if (info != NULL &&
+      g_file_info_get_file_type (info) == G_FILE_TYPE_REGULAR &&
+      !ide_vcs_ignore_matcher_is_file_ignored (matcher, vcs, vcs_path, file, FALSE))
+    items = gbp_todo_miner_scan_file (file, path, g_file_info_get_size (info), cancellable);
+
+  g_mutex_lock (&self->mutex);
+  gbp_todo_index_ensure_loaded_locked (self);
+  if (items != NULL)
+    gbp_todo_index_insert_locked (self,
+                                  path,
+                                  gbp_todo_miner_get_mtime (info),
+                                  g_file_info_get_size (info),
+                                  items);
+  else
+    g_hash_table_remove (self->files, path);
+  g_mutex_unlock (&self->mutex);
+
+  if (items == NULL)
+    items = new_item_array ();
+
+  g_task_return_pointer (task, g_steal_pointer (&items), (GDestroyNotify)g_ptr_array_unref);
+}
+
+/**
+ * gbp_todo_index_mine_file_async:
+ *
+ * Mines a single file again, such as after it has been saved. The index
+ * is updated and the new items for @file are returned.
+ */
+void
+gbp_todo_index_mine_file_async (GbpTodoIndex        *self,
+                                GFile               *file,
+                                GCancellable        *cancellable,
+                                GAsyncReadyCallback  callback,
+                                gpointer             user_data)
+{
+  g_autoptr(GTask) task = NULL;
+
+  g_return_if_fail (GBP_IS_TODO_INDEX (self));
+  g_return_if_fail (G_IS_FILE (file));
+  g_return_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_source_tag (task, gbp_todo_index_mine_file_async);
+  g_task_set_task_data (task, g_object_ref (file), g_object_unref);
+
+  if (self->root_directory == NULL || !g_file_has_prefix (file, self->root_directory))
+    {
+      g_task_return_pointer (task, new_item_array (), (GDestroyNotify)g_ptr_array_unref);
+      return;
+    }
+
+  gbp_todo_index_ensure_cache_path (self);
+
+  ide_thread_pool_push_task_with_priority (IDE_THREAD_POOL_INDEXER,
+                                           IDE_THREAD_POOL_PRIORITY_VISIBLE,
+                                           task,
+                                           gbp_todo_index_mine_file_worker);
+
+  gbp_todo_index_queue_save (self);
+}
+
+/**
+ * gbp_todo_index_mine_file_finish:
+ *
+ * Returns: (transfer container) (element-type GbpTodoItem): the todo items.
+ */
+GPtrArray *
+gbp_todo_index_mine_file_finish (GbpTodoIndex  *self,
+                                 GAsyncResult  *result,
+                                 GError       **error)
+{
+  g_return_val_if_fail (GBP_IS_TODO_INDEX (self), NULL);
+  g_return_val_if_fail (G_IS_TASK (result), NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+static void
+gbp_todo_index_constructed (GObject *object)
+{
+  GbpTodoIndex *self = (GbpTodoIndex *)object;
+  IdeContext *context;
+  GFile *workdir;
+  IdeVcs *vcs;
+
+  G_OBJECT_CLASS (gbp_todo_index_parent_class)->constructed (object);
+
+  /* The service instance mines the working directory */
+  if (self->root_directory == NULL)
+    {
+      context = ide_object_get_context (IDE_OBJECT (self));
+      vcs = ide_context_get_vcs (context);
+
+      if ((workdir = ide_vcs_get_working_directory (vcs)))
+        self->root_directory = g_object_ref (workdir);
+    }
+}
+
+static void
+gbp_todo_index_stop (IdeService *service)
+{
+  GbpTodoIndex *self = (GbpTodoIndex *)service;
+
+  g_assert (GBP_IS_TODO_INDEX (self));
+
+  ide_clear_source (&self->save_source);
+}
+
+static void
+gbp_todo_index_dispose (GObject *object)
+{
+  GbpTodoIndex *self = (GbpTodoIndex *)object;
+
+  /*
+   * Pending changes are not flushed here. The next mining compares
+   * modification times with the cache and picks them up again.
+   */
+  if (self->save_source != 0)
+    {
+      g_source_remove (self->save_source);
+      self->save_source = 0;
+    }
+
+  G_OBJECT_CLASS (gbp_todo_index_parent_class)->dispose (object);
+}
+
+static void
+gbp_todo_index_finalize (GObject *object)
+{
+  GbpTodoIndex *self = (GbpTodoIndex *)object;
+
+  g_clear_object (&self->root_directory);
+  g_clear_pointer (&self->cache_path, g_free);
+  g_clear_pointer (&self->files, g_hash_table_unref);
+  g_mutex_clear (&self->mutex);
+
+  G_OBJECT_CLASS (gbp_todo_index_parent_class)->finalize (object);
+}
+
+static void
+gbp_todo_index_get_property (GObject    *object,
+                             guint       prop_id,
+                             GValue     *value,
+                             GParamSpec *pspec)
+{
+  GbpTodoIndex *self = GBP_TODO_INDEX (object);
+
+  switch (prop_id)
+    {
+    case PROP_ROOT_DIRECTORY:
+      g_value_set_object (value, self->root_directory);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+gbp_todo_index_set_property (GObject      *object,
+                             guint         prop_id,
+                             const GValue *value,
+                             GParamSpec   *pspec)
+{
+  GbpTodoIndex *self = GBP_TODO_INDEX (object);
+
+  switch (prop_id)
+    {
+    case PROP_ROOT_DIRECTORY:
+      self->root_directory = g_value_dup_object (value);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+gbp_todo_index_class_init (GbpTodoIndexClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->constructed = gbp_todo_index_constructed;
+  object_class->dispose = gbp_todo_index_dispose;
+  object_class->finalize = gbp_todo_index_finalize;
+  object_class->get_property = gbp_todo_index_get_property;
+  object_class->set_property = gbp_todo_index_set_property;
+
+  properties [PROP_ROOT_DIRECTORY] =
+    g_param_spec_object ("root-directory",
+                         "Root Directory",
+                         "The root directory of the project to mine",
+                         G_TYPE_FILE,
+                         (G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_properties (object_class, N_PROPS, properties);
+
+  /**
+   * GbpTodoIndex::file-mined:
+   * @self: A #GbpTodoIndex
+   * @file: the #GFile that was mined
+   * @items: (element-type GbpTodoItem): the todo items found in @file
+   *
+   * Emitted on the main thread for every file containing todo items while
+   * the project is being mined.
+   */
+  signals [FILE_MINED] =
+    g_signal_new ("file-mined",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0,
+                  NULL, NULL, NULL,
+                  G_TYPE_NONE,
+                  2,
+                  G_TYPE_FILE,
+                  G_TYPE_PTR_ARRAY);
+}
+
+static void
+service_iface_init (IdeServiceInterface *iface)
+{
+  iface->stop = gbp_todo_index_stop;
+}
+
+static void
+gbp_todo_index_init (GbpTodoIndex *self)
+{
+  g_mutex_init (&self->mutex);
+  self->files = g_hash_table_new_full (g_str_hash,
+                                       g_str_equal,
+                                       g_free,
+                                       (GDestroyNotify)gbp_todo_file_entry_free);
+}
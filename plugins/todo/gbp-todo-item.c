@@ -0,0 +1,123 @@
+/* gbp-todo-item.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define G_LOG_DOMAIN "gbp-todo-item"
+
+#include <string.h>
+
+#include "gbp-todo-item.h"
+
+/*
+ * Todo items are created from the miner threads by the thousands, so they
+ * are a plain refcounted structure rather than a GObject.
+ */
+struct _GbpTodoItem
+{
+  volatile gint  ref_count;
+  guint          line;
+  GFile         *file;
+  gchar         *message;
+};
+
+G_DEFINE_BOXED_TYPE (GbpTodoItem, gbp_todo_item, gbp_todo_item_ref, gbp_todo_item_unref)
+
+GbpTodoItem *
+gbp_todo_item_new (GFile       *file,
+                   guint        line,
+                   const gchar *message)
+{
+  GbpTodoItem *self;
+
+  g_return_val_if_fail (G_IS_FILE (file), NULL);
+  g_return_val_if_fail (message != NULL, NULL);
+
+  self = g_slice_new0 (GbpTodoItem);
+  self->ref_count = 1;
+  self->file = g_object_ref (file);
+  self->line = line;
+  self->message = g_strdup (message);
+
+  return self;
+}
+
+GbpTodoItem *
+gbp_todo_item_ref (GbpTodoItem *self)
+{
+  g_return_val_if_fail (self != NULL, NULL);
+  g_return_val_if_fail (self->ref_count > 0, NULL);
+
+  g_atomic_int_inc (&self->ref_count);
+
+  return self;
+}
+
+void
+gbp_todo_item_unref (GbpTodoItem *self)
+{
+  g_return_if_fail (self != NULL);
+  g_return_if_fail (self->ref_count > 0);
+
+  if (g_atomic_int_dec_and_test (&self->ref_count))
+    {
+      g_clear_object (&self->file);
+      g_clear_pointer (&self->message, g_free);
+      g_slice_free (GbpTodoItem, self);
+    }
+}
+
+GFile *
+gbp_todo_item_get_file (GbpTodoItem *self)
+{
+  g_return_val_if_fail (self != NULL, NULL);
+
+  return self->file;
+}
+
+guint
+gbp_todo_item_get_line (GbpTodoItem *self)
+{
+  g_return_val_if_fail (self != NULL, 0);
+
+  return self->line;
+}
+
+const gchar *
+gbp_todo_item_get_message (GbpTodoItem *self)
+{
+  g_return_val_if_fail (self != NULL, NULL);
+
+  return self->message;
+}
+
+/**
+ * gbp_todo_item_dup_shortdesc:
+ *
+ * Gets the first line of the message, without surrounding whitespace.
+ */
+gchar *
+gbp_todo_item_dup_shortdesc (GbpTodoItem *self)
+{
+  const gchar *endptr;
+
+  g_return_val_if_fail (self != NULL, NULL);
+
+  if (!(endptr = strchr (self->message, '\n')))
+    endptr = self->message + strlen (self->message);
+
+  return g_strstrip (g_strndup (self->message, endptr - self->message));
+}
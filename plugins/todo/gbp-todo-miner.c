@@ -0,0 +1,413 @@
+/* gbp-todo-miner.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define G_LOG_DOMAIN "gbp-todo-miner"
+
+#include <string.h>
+
+#include "gbp-todo-item.h"
+#include "gbp-todo-miner.h"
+
+/*
+ * The parts of the todo index that do not need a project: finding the
+ * items of a single file, and reading and writing the cache file. They
+ * are kept apart from GbpTodoIndex so they can be unit tested.
+ */
+
+#define CACHE_VERSION      2
+#define CACHE_VARIANT_TYPE "(usa(stta(us)))"
+#define MAX_FILE_SIZE      (1024 * 1024)
+#define MAX_LINE_LENGTH    1024
+#define BINARY_PROBE_SIZE  8000
+#define N_CONTEXT_LINES    5
+
+static const struct {
+  const gchar *word;
+  gsize        len;
+} keywords[] = {
+  { "FIXME", 5 },
+  { "XXX", 3 },
+  { "TODO", 4 },
+};
+
+static GPtrArray *
+new_item_array (void)
+{
+  return g_ptr_array_new_with_free_func ((GDestroyNotify)gbp_todo_item_unref);
+}
+
+GbpTodoFileEntry *
+gbp_todo_file_entry_new (guint64    mtime,
+                         guint64    size,
+                         GPtrArray *items)
+{
+  GbpTodoFileEntry *entry;
+
+  g_return_val_if_fail (items != NULL, NULL);
+
+  entry = g_slice_new0 (GbpTodoFileEntry);
+  entry->mtime = mtime;
+  entry->size = size;
+  entry->items = g_ptr_array_ref (items);
+
+  return entry;
+}
+
+void
+gbp_todo_file_entry_free (GbpTodoFileEntry *entry)
+{
+  if (entry != NULL)
+    {
+      g_clear_pointer (&entry->items, g_ptr_array_unref);
+      g_slice_free (GbpTodoFileEntry, entry);
+    }
+}
+
+/**
+ * gbp_todo_miner_get_mtime:
+ *
+ * Gets the modification time of @file_info in microseconds, so that a file
+ * saved twice within the same second is still noticed. @file_info must
+ * contain both G_FILE_ATTRIBUTE_TIME_MODIFIED and
+ * G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC.
+ */
+guint64
+gbp_todo_miner_get_mtime (GFileInfo *file_info)
+{
+  g_return_val_if_fail (G_IS_FILE_INFO (file_info), 0);
+
+  return g_file_info_get_attribute_uint64 (file_info, G_FILE_ATTRIBUTE_TIME_MODIFIED) * G_USEC_PER_SEC +
+         g_file_info_get_attribute_uint32 (file_info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+}
+
+static gboolean
+should_skip (const gchar *path)
+{
+  /* Autotools macros and translations are full of upstream todo items */
+  return g_str_has_suffix (path, ".m4") || g_str_has_suffix (path, ".po");
+}
+
+static gboolean
+is_blank (const gchar *line,
+          gsize        len)
+{
+  for (gsize i = 0; i < len; i++)
+    {
+      if (!g_ascii_isspace (line[i]))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+/*
+ * Every keyword is followed by a colon, so we only compare the keywords
+ * against the text that precedes each colon of the line.
+ */
+static gboolean
+line_has_keyword (const gchar *line,
+                  gsize        len)
+{
+  const gchar *end = line + len;
+  const gchar *iter = line;
+
+  while ((iter = memchr (iter, ':', end - iter)))
+    {
+      gsize offset = iter - line;
+
+      for (guint i = 0; i < G_N_ELEMENTS (keywords); i++)
+        {
+          if (offset >= keywords[i].len &&
+              memcmp (iter - keywords[i].len, keywords[i].word, keywords[i].len) == 0)
+            return TRUE;
+        }
+
+      iter++;
+    }
+
+  return FALSE;
+}
+
+static const gchar *
+next_line (const gchar  *line,
+           const gchar  *end,
+           gsize        *line_len)
+{
+  const gchar *eol;
+  gsize len;
+
+  if (!(eol = memchr (line, '\n', end - line)))
+    eol = end;
+
+  len = eol - line;
+  if (len > 0 && line[len - 1] == '\r')
+    len--;
+
+  *line_len = len;
+
+  return eol < end ? eol + 1 : end;
+}
+
+static gboolean
+is_usable_line (const gchar *line,
+                gsize        len)
+{
+  return len <= MAX_LINE_LENGTH && g_utf8_validate (line, len, NULL);
+}
+
+/**
+ * gbp_todo_miner_scan_contents:
+ *
+ * Creates an item for every line containing a keyword. The message holds
+ * the matching line followed by the next few non-blank lines, since todo
+ * comments often span several lines.
+ *
+ * Returns: (transfer container) (element-type GbpTodoItem): the todo items.
+ */
+GPtrArray *
+gbp_todo_miner_scan_contents (GFile       *file,
+                              const gchar *contents,
+                              gsize        len)
+{
+  const gchar *end = contents + len;
+  const gchar *line = contents;
+  GPtrArray *items;
+  guint lineno = 0;
+
+  g_return_val_if_fail (G_IS_FILE (file), NULL);
+  g_return_val_if_fail (contents != NULL || len == 0, NULL);
+
+  items = new_item_array ();
+
+  while (line < end)
+    {
+      const gchar *next;
+      gsize line_len;
+
+      next = next_line (line, end, &line_len);
+      lineno++;
+
+      if (line_has_keyword (line, line_len) && is_usable_line (line, line_len))
+        {
+          g_autoptr(GString) message = g_string_new_len (line, line_len);
+          const gchar *context = next;
+
+          for (guint i = 0; i < N_CONTEXT_LINES && context < end; i++)
+            {
+              const gchar *context_next;
+              gsize context_len;
+
+              context_next = next_line (context, end, &context_len);
+
+              if (!is_blank (context, context_len) && is_usable_line (context, context_len))
+                {
+                  g_string_append_c (message, '\n');
+                  g_string_append_len (message, context, context_len);
+                }
+
+              context = context_next;
+            }
+
+          g_ptr_array_add (items, gbp_todo_item_new (file, lineno, message->str));
+        }
+
+      line = next;
+    }
+
+  return items;
+}
+
+/**
+ * gbp_todo_miner_scan_file:
+ * @path: the path of @file relative to the project
+ * @size: the size of @file
+ *
+ * Reads @file and finds its todo items. Binary files, files that are too
+ * large and files that are known to only contain upstream items yield an
+ * empty array.
+ *
+ * Returns: (transfer container) (nullable) (element-type GbpTodoItem): the
+ *   todo items, or %NULL if @file could not be read.
+ */
+GPtrArray *
+gbp_todo_miner_scan_file (GFile        *file,
+                          const gchar  *path,
+                          guint64       size,
+                          GCancellable *cancellable)
+{
+  g_autofree gchar *contents = NULL;
+  gsize len = 0;
+
+  g_return_val_if_fail (G_IS_FILE (file), NULL);
+  g_return_val_if_fail (path != NULL, NULL);
+
+  if (should_skip (path) || size > MAX_FILE_SIZE)
+    return new_item_array ();
+
+  if (!g_file_load_contents (file, cancellable, &contents, &len, NULL, NULL))
+    return NULL;
+
+  if (memchr (contents, '\0', MIN (len, BINARY_PROBE_SIZE)) != NULL)
+    return new_item_array ();
+
+  return gbp_todo_miner_scan_contents (file, contents, len);
+}
+
+/**
+ * gbp_todo_miner_load_cache:
+ * @cache_path: the path of the cache file
+ * @root_directory: the directory the cached paths are relative to
+ *
+ * Loads the entries saved with gbp_todo_miner_save_cache(). A missing,
+ * corrupt or outdated cache, or one saved for another directory, results
+ * in an empty table.
+ *
+ * Returns: (transfer full): a #GHashTable of relative paths to
+ *   #GbpTodoFileEntry.
+ */
+GHashTable *
+gbp_todo_miner_load_cache (const gchar *cache_path,
+                           GFile       *root_directory)
+{
+  g_autoptr(GMappedFile) mapped = NULL;
+  g_autoptr(GVariant) variant = NULL;
+  g_autoptr(GVariantIter) files_iter = NULL;
+  g_autoptr(GBytes) bytes = NULL;
+  g_autofree gchar *root_path = NULL;
+  GHashTable *files;
+  const gchar *stored_root = NULL;
+  const gchar *path;
+  GVariantIter *items_iter;
+  guint64 mtime;
+  guint64 size;
+  guint32 version = 0;
+
+  g_return_val_if_fail (cache_path != NULL, NULL);
+  g_return_val_if_fail (G_IS_FILE (root_directory), NULL);
+
+  files = g_hash_table_new_full (g_str_hash,
+                                 g_str_equal,
+                                 g_free,
+                                 (GDestroyNotify)gbp_todo_file_entry_free);
+
+  if (!(mapped = g_mapped_file_new (cache_path, FALSE, NULL)))
+    return files;
+
+  bytes = g_mapped_file_get_bytes (mapped);
+  variant = g_variant_new_from_bytes (G_VARIANT_TYPE (CACHE_VARIANT_TYPE), bytes, FALSE);
+
+  if (variant == NULL || !g_variant_is_normal_form (variant))
+    return files;
+
+  root_path = g_file_get_path (root_directory);
+
+  g_variant_get (variant, "(u&sa(stta(us)))", &version, &stored_root, &files_iter);
+
+  if (version != CACHE_VERSION || g_strcmp0 (root_path, stored_root) != 0)
+    return files;
+
+  while (g_variant_iter_next (files_iter, "(&stta(us))", &path, &mtime, &size, &items_iter))
+    {
+      g_autoptr(GPtrArray) items = new_item_array ();
+      g_autoptr(GFile) file = g_file_resolve_relative_path (root_directory, path);
+      const gchar *message;
+      guint32 line;
+
+      while (g_variant_iter_next (items_iter, "(u&s)", &line, &message))
+        g_ptr_array_add (items, gbp_todo_item_new (file, line, message));
+
+      g_variant_iter_free (items_iter);
+
+      g_hash_table_insert (files, g_strdup (path), gbp_todo_file_entry_new (mtime, size, items));
+    }
+
+  return files;
+}
+
+/**
+ * gbp_todo_miner_save_cache:
+ * @cache_path: the path of the cache file
+ * @root_directory: the directory the paths of @files are relative to
+ * @files: a #GHashTable of relative paths to #GbpTodoFileEntry
+ *
+ * Saves @files so they can be loaded with gbp_todo_miner_load_cache(). The
+ * file is replaced atomically, so concurrent readers never see a partial
+ * cache.
+ *
+ * Returns: %TRUE if successful; otherwise %FALSE and @error is set.
+ */
+gboolean
+gbp_todo_miner_save_cache (const gchar  *cache_path,
+                           GFile        *root_directory,
+                           GHashTable   *files,
+                           GError      **error)
+{
+  g_autoptr(GVariant) variant = NULL;
+  g_autofree gchar *root_path = NULL;
+  g_autofree gchar *dir = NULL;
+  GVariantBuilder builder;
+  GHashTableIter iter;
+  gpointer key;
+  gpointer value;
+
+  g_return_val_if_fail (cache_path != NULL, FALSE);
+  g_return_val_if_fail (G_IS_FILE (root_directory), FALSE);
+  g_return_val_if_fail (files != NULL, FALSE);
+
+  root_path = g_file_get_path (root_directory);
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(stta(us))"));
+
+  g_hash_table_iter_init (&iter, files);
+
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      const GbpTodoFileEntry *entry = value;
+
+      g_variant_builder_open (&builder, G_VARIANT_TYPE ("(stta(us))"));
+      g_variant_builder_add (&builder, "s", key);
+      g_variant_builder_add (&builder, "t", entry->mtime);
+      g_variant_builder_add (&builder, "t", entry->size);
+      g_variant_builder_open (&builder, G_VARIANT_TYPE ("a(us)"));
+
+      for (guint i = 0; i < entry->items->len; i++)
+        {
+          GbpTodoItem *item = g_ptr_array_index (entry->items, i);
+
+          g_variant_builder_add (&builder, "(us)",
+                                 gbp_todo_item_get_line (item),
+                                 gbp_todo_item_get_message (item));
+        }
+
+      g_variant_builder_close (&builder);
+      g_variant_builder_close (&builder);
+    }
+
+  variant = g_variant_ref_sink (g_variant_new ("(usa(stta(us)))",
+                                               CACHE_VERSION,
+                                               root_path ? root_path : "",
+                                               &builder));
+
+  dir = g_path_get_dirname (cache_path);
+  g_mkdir_with_parents (dir, 0750);
+
+  return g_file_set_contents (cache_path,
+                              g_variant_get_data (variant),
+                              g_variant_get_size (variant),
+                              error);
+}
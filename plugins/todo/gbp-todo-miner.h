@@ -0,0 +1,54 @@
+/* gbp-todo-miner.h
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GBP_TODO_MINER_H
+#define GBP_TODO_MINER_H
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+typedef struct
+{
+  guint64    mtime;
+  guint64    size;
+  GPtrArray *items;
+} GbpTodoFileEntry;
+
+GbpTodoFileEntry *gbp_todo_file_entry_new       (guint64        mtime,
+                                                 guint64        size,
+                                                 GPtrArray     *items);
+void              gbp_todo_file_entry_free      (GbpTodoFileEntry *entry);
+guint64           gbp_todo_miner_get_mtime      (GFileInfo     *file_info);
+GPtrArray        *gbp_todo_miner_scan_contents  (GFile         *file,
+                                                 const gchar   *contents,
+                                                 gsize          len);
+GPtrArray        *gbp_todo_miner_scan_file      (GFile         *file,
+                                                 const gchar   *path,
+                                                 guint64        size,
+                                                 GCancellable  *cancellable);
+GHashTable       *gbp_todo_miner_load_cache     (const gchar   *cache_path,
+                                                 GFile         *root_directory);
+gboolean          gbp_todo_miner_save_cache     (const gchar   *cache_path,
+                                                 GFile         *root_directory,
+                                                 GHashTable    *files,
+                                                 GError       **error);
+
+G_END_DECLS
+
+#endif /* GBP_TODO_MINER_H */
@@ -0,0 +1,383 @@
+/* gbp-todo-panel.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define G_LOG_DOMAIN "gbp-todo-panel"
+
+#include <glib/gi18n.h>
+#include <ide.h>
+
+#include "gbp-todo-item.h"
+#include "gbp-todo-panel.h"
+
+struct _GbpTodoPanel
+{
+  PnlDockWidget  parent_instance;
+
+  GFile         *root_directory;
+  GtkListStore  *model;
+  GtkTreeView   *tree_view;
+
+  /*
+   * Maps each GFile to a GArray of the GtkTreeIter for its rows. List store
+   * iters persist, so replacing the items of a file does not need to scan
+   * the whole model.
+   */
+  GHashTable    *rows_by_file;
+};
+
+G_DEFINE_TYPE (GbpTodoPanel, gbp_todo_panel, PNL_TYPE_DOCK_WIDGET)
+
+enum {
+  PROP_0,
+  PROP_ROOT_DIRECTORY,
+  N_PROPS
+};
+
+static GParamSpec *properties [N_PROPS];
+
+static void
+gbp_todo_panel_remove_file (GbpTodoPanel *self,
+                            GFile        *file)
+{
+  GArray *rows;
+
+  g_assert (GBP_IS_TODO_PANEL (self));
+  g_assert (G_IS_FILE (file));
+
+  if (!(rows = g_hash_table_lookup (self->rows_by_file, file)))
+    return;
+
+  for (guint i = 0; i < rows->len; i++)
+    {
+      /* gtk_list_store_remove() advances the iter, so work on a copy */
+      GtkTreeIter iter = g_array_index (rows, GtkTreeIter, i);
+
+      gtk_list_store_remove (self->model, &iter);
+    }
+
+  g_hash_table_remove (self->rows_by_file, file);
+}
+
+/**
+ * gbp_todo_panel_set_file_items:
+ * @items: (element-type GbpTodoItem): the new items for @file
+ * @prepend: if the items should be placed and selected at the top
+ *
+ * Replaces the rows for @file with @items.
+ */
+void
+gbp_todo_panel_set_file_items (GbpTodoPanel *self,
+                               GFile        *file,
+                               GPtrArray    *items,
+                               gboolean      prepend)
+{
+  GArray *rows;
+
+  g_return_if_fail (GBP_IS_TODO_PANEL (self));
+  g_return_if_fail (G_IS_FILE (file));
+  g_return_if_fail (items != NULL);
+
+  gbp_todo_panel_remove_file (self, file);
+
+  if (items->len == 0)
+    return;
+
+  rows = g_array_sized_new (FALSE, FALSE, sizeof (GtkTreeIter), items->len);
+
+  for (guint i = 0; i < items->len; i++)
+    {
+      GbpTodoItem *item = g_ptr_array_index (items, i);
+      GtkTreeIter iter;
+
+      if (prepend)
+        gtk_list_store_insert_with_values (self->model, &iter, i, 0, item, -1);
+      else
+        gtk_list_store_insert_with_values (self->model, &iter, -1, 0, item, -1);
+
+      g_array_append_val (rows, iter);
+    }
+
+  g_hash_table_insert (self->rows_by_file, g_object_ref (file), rows);
+
+  /* Recently saved files go first so they can be navigated to quickly */
+  if (prepend)
+    {
+      GtkTreeIter *first = &g_array_index (rows, GtkTreeIter, 0);
+      g_autoptr(GtkTreePath) path = NULL;
+
+      gtk_tree_selection_select_iter (gtk_tree_view_get_selection (self->tree_view), first);
+      path = gtk_tree_model_get_path (GTK_TREE_MODEL (self->model), first);
+      gtk_tree_view_scroll_to_cell (self->tree_view, path, NULL, TRUE, 0.0, 0.0);
+    }
+}
+
+static void
+gbp_todo_panel_file_data_func (GtkCellLayout   *layout,
+                               GtkCellRenderer *cell,
+                               GtkTreeModel    *model,
+                               GtkTreeIter     *iter,
+                               gpointer         user_data)
+{
+  GbpTodoPanel *self = user_data;
+  g_autoptr(GbpTodoItem) item = NULL;
+  g_autofree gchar *relpath = NULL;
+  g_autofree gchar *text = NULL;
+  GFile *file;
+
+  gtk_tree_model_get (model, iter, 0, &item, -1);
+
+  if (item == NULL)
+    return;
+
+  file = gbp_todo_item_get_file (item);
+
+  if (self->root_directory == NULL ||
+      !(relpath = g_file_get_relative_path (self->root_directory, file)))
+    relpath = g_file_get_path (file);
+
+  text = g_strdup_printf ("%s:%u", relpath, gbp_todo_item_get_line (item));
+  g_object_set (cell, "text", text, NULL);
+}
+
+static void
+gbp_todo_panel_message_data_func (GtkCellLayout   *layout,
+                                  GtkCellRenderer *cell,
+                                  GtkTreeModel    *model,
+                                  GtkTreeIter     *iter,
+                                  gpointer         user_data)
+{
+  g_autoptr(GbpTodoItem) item = NULL;
+  g_autofree gchar *shortdesc = NULL;
+
+  gtk_tree_model_get (model, iter, 0, &item, -1);
+
+  if (item == NULL)
+    return;
+
+  shortdesc = gbp_todo_item_dup_shortdesc (item);
+  g_object_set (cell, "text", shortdesc, NULL);
+}
+
+static gboolean
+gbp_todo_panel_query_tooltip (GbpTodoPanel *self,
+                              gint          x,
+                              gint          y,
+                              gboolean      keyboard_mode,
+                              GtkTooltip   *tooltip,
+                              GtkTreeView  *tree_view)
+{
+  g_autoptr(GbpTodoItem) item = NULL;
+  g_autoptr(GtkTreePath) path = NULL;
+  g_autofree gchar *escaped = NULL;
+  g_autofree gchar *markup = NULL;
+  GtkTreeModel *model;
+  GtkTreeIter iter;
+
+  g_assert (GBP_IS_TODO_PANEL (self));
+  g_assert (GTK_IS_TREE_VIEW (tree_view));
+
+  if (!gtk_tree_view_get_tooltip_context (tree_view, &x, &y, keyboard_mode, &model, &path, &iter))
+    return FALSE;
+
+  gtk_tree_model_get (model, &iter, 0, &item, -1);
+
+  if (item == NULL)
+    return FALSE;
+
+  escaped = g_markup_escape_text (gbp_todo_item_get_message (item), -1);
+  markup = g_strdup_printf ("<tt>%s</tt>", escaped);
+  gtk_tooltip_set_markup (tooltip, markup);
+  gtk_tree_view_set_tooltip_row (tree_view, tooltip, path);
+
+  return TRUE;
+}
+
+static void
+gbp_todo_panel_row_activated (GbpTodoPanel      *self,
+                              GtkTreePath       *path,
+                              GtkTreeViewColumn *column,
+                              GtkTreeView       *tree_view)
+{
+  g_autoptr(GbpTodoItem) item = NULL;
+  g_autoptr(IdeUri) uri = NULL;
+  g_autofree gchar *fragment = NULL;
+  IdeWorkbench *workbench;
+  GtkTreeIter iter;
+  guint line;
+
+  g_assert (GBP_IS_TODO_PANEL (self));
+  g_assert (path != NULL);
+  g_assert (GTK_IS_TREE_VIEW (tree_view));
+
+  if (!gtk_tree_model_get_iter (GTK_TREE_MODEL (self->model), &iter, path))
+    return;
+
+  gtk_tree_model_get (GTK_TREE_MODEL (self->model), &iter, 0, &item, -1);
+
+  if (item == NULL)
+    return;
+
+  uri = ide_uri_new_from_file (gbp_todo_item_get_file (item));
+  line = gbp_todo_item_get_line (item);
+  fragment = g_strdup_printf ("L%u", line > 1 ? line - 1 : 1);
+  ide_uri_set_fragment (uri, fragment);
+
+  workbench = ide_widget_get_workbench (GTK_WIDGET (self));
+  ide_workbench_open_uri_async (workbench, uri, "editor", 0, NULL, NULL, NULL);
+}
+
+static void
+gbp_todo_panel_constructed (GObject *object)
+{
+  GbpTodoPanel *self = (GbpTodoPanel *)object;
+  GtkTreeViewColumn *column;
+  GtkCellRenderer *cell;
+  GtkWidget *scroller;
+
+  G_OBJECT_CLASS (gbp_todo_panel_parent_class)->constructed (object);
+
+  scroller = g_object_new (GTK_TYPE_SCROLLED_WINDOW,
+                           "visible", TRUE,
+                           NULL);
+  gtk_container_add (GTK_CONTAINER (self), scroller);
+
+  self->tree_view = g_object_new (GTK_TYPE_TREE_VIEW,
+                                  "has-tooltip", TRUE,
+                                  "model", self->model,
+                                  "visible", TRUE,
+                                  NULL);
+  g_signal_connect_object (self->tree_view,
+                           "query-tooltip",
+                           G_CALLBACK (gbp_todo_panel_query_tooltip),
+                           self,
+                           G_CONNECT_SWAPPED);
+  g_signal_connect_object (self->tree_view,
+                           "row-activated",
+                           G_CALLBACK (gbp_todo_panel_row_activated),
+                           self,
+                           G_CONNECT_SWAPPED);
+  gtk_container_add (GTK_CONTAINER (scroller), GTK_WIDGET (self->tree_view));
+
+  column = g_object_new (GTK_TYPE_TREE_VIEW_COLUMN,
+                         "title", _("File"),
+                         NULL);
+  cell = g_object_new (GTK_TYPE_CELL_RENDERER_TEXT,
+                       "xalign", 0.0f,
+                       NULL);
+  gtk_cell_layout_pack_start (GTK_CELL_LAYOUT (column), cell, TRUE);
+  gtk_cell_layout_set_cell_data_func (GTK_CELL_LAYOUT (column), cell,
+                                      gbp_todo_panel_file_data_func,
+                                      self, NULL);
+  gtk_tree_view_append_column (self->tree_view, column);
+
+  column = g_object_new (GTK_TYPE_TREE_VIEW_COLUMN,
+                         "title", _("Message"),
+                         NULL);
+  cell = g_object_new (GTK_TYPE_CELL_RENDERER_TEXT,
+                       "xalign", 0.0f,
+                       NULL);
+  gtk_cell_layout_pack_start (GTK_CELL_LAYOUT (column), cell, TRUE);
+  gtk_cell_layout_set_cell_data_func (GTK_CELL_LAYOUT (column), cell,
+                                      gbp_todo_panel_message_data_func,
+                                      NULL, NULL);
+  gtk_tree_view_append_column (self->tree_view, column);
+}
+
+static void
+gbp_todo_panel_finalize (GObject *object)
+{
+  GbpTodoPanel *self = (GbpTodoPanel *)object;
+
+  g_clear_object (&self->root_directory);
+  g_clear_object (&self->model);
+  g_clear_pointer (&self->rows_by_file, g_hash_table_unref);
+
+  G_OBJECT_CLASS (gbp_todo_panel_parent_class)->finalize (object);
+}
+
+static void
+gbp_todo_panel_get_property (GObject    *object,
+                             guint       prop_id,
+                             GValue     *value,
+                             GParamSpec *pspec)
+{
+  GbpTodoPanel *self = GBP_TODO_PANEL (object);
+
+  switch (prop_id)
+    {
+    case PROP_ROOT_DIRECTORY:
+      g_value_set_object (value, self->root_directory);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+gbp_todo_panel_set_property (GObject      *object,
+                             guint         prop_id,
+                             const GValue *value,
+                             GParamSpec   *pspec)
+{
+  GbpTodoPanel *self = GBP_TODO_PANEL (object);
+
+  switch (prop_id)
+    {
+    case PROP_ROOT_DIRECTORY:
+      self->root_directory = g_value_dup_object (value);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+gbp_todo_panel_class_init (GbpTodoPanelClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->constructed = gbp_todo_panel_constructed;
+  object_class->finalize = gbp_todo_panel_finalize;
+  object_class->get_property = gbp_todo_panel_get_property;
+  object_class->set_property = gbp_todo_panel_set_property;
+
+  properties [PROP_ROOT_DIRECTORY] =
+    g_param_spec_object ("root-directory",
+                         "Root Directory",
+                         "The directory file names are displayed relative to",
+                         G_TYPE_FILE,
+                         (G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_properties (object_class, N_PROPS, properties);
+}
+
+static void
+gbp_todo_panel_init (GbpTodoPanel *self)
+{
+  gtk_widget_set_hexpand (GTK_WIDGET (self), TRUE);
+  gtk_widget_set_vexpand (GTK_WIDGET (self), TRUE);
+  pnl_dock_widget_set_title (PNL_DOCK_WIDGET (self), _("Todo"));
+
+  self->model = gtk_list_store_new (1, GBP_TYPE_TODO_ITEM);
+  self->rows_by_file = g_hash_table_new_full (g_file_hash,
+                                              (GEqualFunc)g_file_equal,
+                                              g_object_unref,
+                                              (GDestroyNotify)g_array_unref);
+}
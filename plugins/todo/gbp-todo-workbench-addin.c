@@ -0,0 +1,223 @@
+/* gbp-todo-workbench-addin.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define G_LOG_DOMAIN "gbp-todo-workbench-addin"
+
+#include "gbp-todo-index.h"
+#include "gbp-todo-panel.h"
+#include "gbp-todo-workbench-addin.h"
+
+struct _GbpTodoWorkbenchAddin
+{
+  GObject       parent_instance;
+
+  GbpTodoPanel *panel;
+  GbpTodoIndex *index;
+  GCancellable *cancellable;
+};
+
+static void workbench_addin_iface_init (IdeWorkbenchAddinInterface *iface);
+
+G_DEFINE_TYPE_EXTENDED (GbpTodoWorkbenchAddin, gbp_todo_workbench_addin, G_TYPE_OBJECT, 0,
+                        G_IMPLEMENT_INTERFACE (IDE_TYPE_WORKBENCH_ADDIN, workbench_addin_iface_init))
+
+static void
+gbp_todo_workbench_addin_file_mined (GbpTodoWorkbenchAddin *self,
+                                     GFile                 *file,
+                                     GPtrArray             *items,
+                                     GbpTodoIndex          *index)
+{
+  g_assert (GBP_IS_TODO_WORKBENCH_ADDIN (self));
+  g_assert (G_IS_FILE (file));
+  g_assert (items != NULL);
+  g_assert (GBP_IS_TODO_INDEX (index));
+
+  if (self->panel != NULL)
+    gbp_todo_panel_set_file_items (self->panel, file, items, FALSE);
+}
+
+static void
+gbp_todo_workbench_addin_mine_cb (GObject      *object,
+                                  GAsyncResult *result,
+                                  gpointer      user_data)
+{
+  GbpTodoIndex *index = (GbpTodoIndex *)object;
+  g_autoptr(GError) error = NULL;
+
+  g_assert (GBP_IS_TODO_INDEX (index));
+
+  if (!gbp_todo_index_mine_finish (index, result, &error))
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("Failed to mine todo items: %s", error->message);
+    }
+}
+
+static void
+gbp_todo_workbench_addin_mine_file_cb (GObject      *object,
+                                       GAsyncResult *result,
+                                       gpointer      user_data)
+{
+  GbpTodoIndex *index = (GbpTodoIndex *)object;
+  g_autoptr(GbpTodoWorkbenchAddin) self = user_data;
+  g_autoptr(GPtrArray) items = NULL;
+  g_autoptr(GError) error = NULL;
+  GFile *file;
+
+  g_assert (GBP_IS_TODO_INDEX (index));
+  g_assert (GBP_IS_TODO_WORKBENCH_ADDIN (self));
+
+  if (!(items = gbp_todo_index_mine_file_finish (index, result, &error)))
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("Failed to mine todo items: %s", error->message);
+      return;
+    }
+
+  file = g_task_get_task_data (G_TASK (result));
+
+  /* Saved files go to the top of the panel */
+  if (self->panel != NULL)
+    gbp_todo_panel_set_file_items (self->panel, file, items, TRUE);
+}
+
+static void
+gbp_todo_workbench_addin_buffer_saved (GbpTodoWorkbenchAddin *self,
+                                       IdeBuffer             *buffer,
+                                       IdeBufferManager      *bufmgr)
+{
+  IdeFile *file;
+
+  g_assert (GBP_IS_TODO_WORKBENCH_ADDIN (self));
+  g_assert (IDE_IS_BUFFER (buffer));
+  g_assert (IDE_IS_BUFFER_MANAGER (bufmgr));
+
+  file = ide_buffer_get_file (buffer);
+
+  gbp_todo_index_mine_file_async (self->index,
+                                  ide_file_get_file (file),
+                                  self->cancellable,
+                                  gbp_todo_workbench_addin_mine_file_cb,
+                                  g_object_ref (self));
+}
+
+static void
+gbp_todo_workbench_addin_load (IdeWorkbenchAddin *addin,
+                               IdeWorkbench      *workbench)
+{
+  GbpTodoWorkbenchAddin *self = (GbpTodoWorkbenchAddin *)addin;
+  IdeBufferManager *bufmgr;
+  IdePerspective *editor;
+  IdeContext *context;
+  GtkWidget *pane;
+  GFile *workdir;
+  IdeVcs *vcs;
+
+  g_assert (GBP_IS_TODO_WORKBENCH_ADDIN (self));
+  g_assert (IDE_IS_WORKBENCH (workbench));
+
+  context = ide_workbench_get_context (workbench);
+  vcs = ide_context_get_vcs (context);
+  workdir = ide_vcs_get_working_directory (vcs);
+  bufmgr = ide_context_get_buffer_manager (context);
+
+  editor = ide_workbench_get_perspective_by_name (workbench, "editor");
+  g_assert (IDE_IS_LAYOUT (editor));
+
+  pane = pnl_dock_bin_get_bottom_edge (PNL_DOCK_BIN (editor));
+  self->panel = g_object_new (GBP_TYPE_TODO_PANEL,
+                              "root-directory", workdir,
+                              "visible", TRUE,
+                              NULL);
+  g_signal_connect (self->panel,
+                    "destroy",
+                    G_CALLBACK (gtk_widget_destroyed),
+                    &self->panel);
+  gtk_container_add (GTK_CONTAINER (pane), GTK_WIDGET (self->panel));
+
+  self->cancellable = g_cancellable_new ();
+  /* Shared by every workbench of the context so only one writes the cache */
+  self->index = g_object_ref (ide_context_get_service_typed (context, GBP_TYPE_TODO_INDEX));
+
+  g_signal_connect_object (self->index,
+                           "file-mined",
+                           G_CALLBACK (gbp_todo_workbench_addin_file_mined),
+                           self,
+                           G_CONNECT_SWAPPED);
+
+  g_signal_connect_object (bufmgr,
+                           "buffer-saved",
+                           G_CALLBACK (gbp_todo_workbench_addin_buffer_saved),
+                           self,
+                           G_CONNECT_SWAPPED);
+
+  gbp_todo_index_mine_async (self->index,
+                             self->cancellable,
+                             gbp_todo_workbench_addin_mine_cb,
+                             NULL);
+}
+
+static void
+gbp_todo_workbench_addin_unload (IdeWorkbenchAddin *addin,
+                                 IdeWorkbench      *workbench)
+{
+  GbpTodoWorkbenchAddin *self = (GbpTodoWorkbenchAddin *)addin;
+  IdeBufferManager *bufmgr;
+  IdeContext *context;
+
+  g_assert (GBP_IS_TODO_WORKBENCH_ADDIN (self));
+  g_assert (IDE_IS_WORKBENCH (workbench));
+
+  context = ide_workbench_get_context (workbench);
+  bufmgr = ide_context_get_buffer_manager (context);
+
+  g_signal_handlers_disconnect_by_func (bufmgr,
+                                        G_CALLBACK (gbp_todo_workbench_addin_buffer_saved),
+                                        self);
+
+  g_cancellable_cancel (self->cancellable);
+  g_clear_object (&self->cancellable);
+
+  if (self->index != NULL)
+    {
+      g_signal_handlers_disconnect_by_func (self->index,
+                                            G_CALLBACK (gbp_todo_workbench_addin_file_mined),
+                                            self);
+      g_clear_object (&self->index);
+    }
+
+  if (self->panel != NULL)
+    gtk_widget_destroy (GTK_WIDGET (self->panel));
+}
+
+static void
+workbench_addin_iface_init (IdeWorkbenchAddinInterface *iface)
+{
+  iface->load = gbp_todo_workbench_addin_load;
+  iface->unload = gbp_todo_workbench_addin_unload;
+}
+
+static void
+gbp_todo_workbench_addin_class_init (GbpTodoWorkbenchAddinClass *klass)
+{
+}
+
+static void
+gbp_todo_workbench_addin_init (GbpTodoWorkbenchAddin *self)
+{
+}
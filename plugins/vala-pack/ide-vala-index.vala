@@ -22,6 +22,18 @@
  * files for a particular context. Typically, you would have one index
  * per project. Therefore, we use the singleton-per-project nature of
  * Ide.Service (via Ide.ValaService) to keep an index-per-project.
+ *
+ * Parsing and semantic analysis is incremental. Only files that have been
+ * reset (because their contents changed) are re-parsed, along with the
+ * files mentioning a name declared in them, since those still refer to
+ * the old symbols. The semantic analyzer is only run when something was
+ * re-parsed. Since vala skips nodes that have already been checked,
+ * packages (.vapi) and unrelated sources are not analyzed again.
+ *
+ * Read-only queries such as the symbol tree and diagnostics are answered
+ * from per-file snapshots taken after analysis. Those are protected by
+ * their own lock so they do not need to wait for background analysis
+ * holding the code_context lock.
  */
 
 using GLib;
@@ -38,6 +50,14 @@ namespace Ide
 		Vala.Parser parser;
 		HashMap<GLib.File,Ide.ValaSourceFile> source_files;
 		Ide.ValaDiagnostics report;
+		HashSet<GLib.File> build_flags_loaded;
+		HashMap<GLib.File,HashSet<string>> declared_names;
+		Ide.Configuration? configuration;
+		bool needs_check;
+
+		/* Snapshots are protected by lock (this.symbol_trees) */
+		HashMap<GLib.File,Ide.SymbolTree> symbol_trees;
+		HashMap<GLib.File,Ide.Diagnostics> diagnostics;
 
 		public ValaIndex (Ide.Context context)
 		{
@@ -45,6 +65,10 @@ namespace Ide
 			var workdir = vcs.get_working_directory();
 
 			this.source_files = new HashMap<GLib.File,Ide.ValaSourceFile> (GLib.File.hash, (GLib.EqualFunc)GLib.File.equal);
+			this.build_flags_loaded = new HashSet<GLib.File> (GLib.File.hash, (GLib.EqualFunc)GLib.File.equal);
+			this.declared_names = new HashMap<GLib.File,HashSet<string>> (GLib.File.hash, (GLib.EqualFunc)GLib.File.equal);
+			this.symbol_trees = new HashMap<GLib.File,Ide.SymbolTree> (GLib.File.hash, (GLib.EqualFunc)GLib.File.equal);
+			this.diagnostics = new HashMap<GLib.File,Ide.Diagnostics> (GLib.File.hash, (GLib.EqualFunc)GLib.File.equal);
 
 			this.context = context;
 			this.code_context = new Vala.CodeContext ();
@@ -126,6 +150,40 @@ namespace Ide
 			this.code_context.check ();
 
 			Vala.CodeContext.pop ();
+
+			var config_manager = context.get_configuration_manager ();
+			config_manager.notify["current"].connect (this.notify_current_configuration);
+			this.track_configuration (config_manager.get_current ());
+		}
+
+		void track_configuration (Ide.Configuration? configuration)
+		{
+			if (this.configuration != null)
+				this.configuration.changed.disconnect (this.invalidate_build_flags);
+
+			this.configuration = configuration;
+
+			if (this.configuration != null)
+				this.configuration.changed.connect (this.invalidate_build_flags);
+		}
+
+		void notify_current_configuration (GLib.Object object,
+		                                   GLib.ParamSpec pspec)
+		{
+			var config_manager = (Ide.ConfigurationManager)object;
+
+			this.track_configuration (config_manager.get_current ());
+			this.invalidate_build_flags ();
+		}
+
+		/*
+		 * The build configuration changed, so query the build system again
+		 * the next time each file is parsed. Packages and vapidirs already
+		 * loaded stay in the code context.
+		 */
+		void invalidate_build_flags ()
+		{
+			this.build_flags_loaded.clear ();
 		}
 
 		void add_file (GLib.File file)
@@ -146,6 +204,7 @@ namespace Ide
 			this.code_context.add_source_file (source_file);
 
 			this.source_files [file] = source_file;
+			this.needs_check = true;
 		}
 
 		public async void add_files (ArrayList<GLib.File> files,
@@ -276,12 +335,21 @@ namespace Ide
 		async void update_build_flags (GLib.File file,
 		                               GLib.Cancellable? cancellable)
 		{
+			/*
+			 * Packages and vapidirs only ever accumulate in the code context,
+			 * so there is no need to query the build system for the same file
+			 * on every parse.
+			 */
+			if (this.build_flags_loaded.contains (file))
+				return;
+
 			var ifile = new Ide.File (this.context, file);
 			var build_system = this.context.get_build_system ();
 
 			try {
 				var flags = yield build_system.get_build_flags_async (ifile, cancellable);
 				load_build_flags (flags);
+				this.build_flags_loaded.add (file);
 			} catch (GLib.Error err) {
 				warning ("%s", err.message);
 			}
@@ -313,12 +381,7 @@ namespace Ide
 						source_file.get_mapped_contents ();
 
 						this.apply_unsaved_files (unsaved_files_copy);
-						this.report.clear ();
-						this.reparse ();
-						if (this.report.get_errors () == 0 &&
-						        (cancellable == null || !cancellable.is_cancelled ())) {
-						    this.code_context.check ();
-						}
+						this.analyze_locked (cancellable);
 
 						GLib.Idle.add(this.parse_file.callback);
 
@@ -350,12 +413,7 @@ namespace Ide
 					Vala.CodeContext.push (this.code_context);
 
 					this.apply_unsaved_files (unsaved_files_copy);
-					this.report.clear ();
-					this.reparse ();
-					if (this.report.get_errors () == 0 &&
-					        (cancellable == null || !cancellable.is_cancelled ())) {
-					    this.code_context.check ();
-					}
+					this.analyze_locked (cancellable);
 
 					if (this.source_files.contains (file)) {
 						var source_file = this.source_files [file];
@@ -381,12 +439,22 @@ namespace Ide
 		{
 			Ide.Diagnostics? diagnostics = null;
 
+			lock (this.symbol_trees) {
+				diagnostics = this.diagnostics [file];
+			}
+
+			if (diagnostics != null)
+				return diagnostics;
+
 			Ide.ThreadPool.push (Ide.ThreadPoolKind.COMPILER, () => {
 				if ((cancellable == null) || !cancellable.is_cancelled ()) {
 					lock (this.code_context) {
 						Vala.CodeContext.push (this.code_context);
 						if (this.source_files.contains (file)) {
 							diagnostics = this.source_files[file].diagnose ();
+							lock (this.symbol_trees) {
+								this.diagnostics [file] = diagnostics;
+							}
 						}
 						Vala.CodeContext.pop ();
 					}
@@ -409,8 +477,11 @@ namespace Ide
 			}
 		}
 
-		void reparse ()
+		/* Caller is expected to hold code_context lock */
+		ArrayList<GLib.File> reparse ()
 		{
+			var reparsed = new ArrayList<GLib.File> ();
+
 			this.report.clear ();
 
 			foreach (var source_file in this.code_context.get_source_files ()) {
@@ -418,9 +489,151 @@ namespace Ide
 					this.parser.visit_source_file (source_file);
 					if (source_file is Ide.ValaSourceFile) {
 						(source_file as Ide.ValaSourceFile).dirty = false;
+						reparsed.add ((source_file as Ide.ValaSourceFile).get_file ());
 					}
 				}
 			}
+
+			if (reparsed.size > 0)
+				this.needs_check = true;
+
+			return reparsed;
+		}
+
+		/* Caller is expected to hold code_context lock */
+		void collect_symbol_names (Vala.Symbol symbol,
+		                           Vala.SourceFile source_file,
+		                           HashSet<string> names)
+		{
+			/* Namespaces are shared by every file declaring into them */
+			if (!(symbol is Vala.Namespace)) {
+				if (symbol.source_reference == null ||
+				    symbol.source_reference.file != source_file)
+					return;
+
+				if (symbol.name != null)
+					names.add (symbol.name);
+
+				/* Only look into containers, not into the locals of methods */
+				if (!(symbol is Vala.TypeSymbol) || symbol is Vala.Delegate)
+					return;
+			}
+
+			var table = symbol.scope.get_symbol_table ();
+			if (table == null)
+				return;
+
+			foreach (var child in table.get_values ())
+				this.collect_symbol_names (child, source_file, names);
+		}
+
+		/* Caller is expected to hold code_context lock */
+		HashSet<string> collect_declared_names (Vala.SourceFile source_file)
+		{
+			var names = new HashSet<string> (GLib.str_hash, GLib.str_equal);
+
+			foreach (var node in source_file.get_nodes ()) {
+				if (node is Vala.Symbol)
+					this.collect_symbol_names ((Vala.Symbol)node, source_file, names);
+			}
+
+			return names;
+		}
+
+		/*
+		 * Files referring to symbols of a re-parsed file still point at the
+		 * old symbols, so they need to be re-parsed too. A file is taken to
+		 * depend on another if it mentions one of the names declared there,
+		 * either before or after the change. This repeats for the dependents
+		 * of dependents.
+		 *
+		 * Caller is expected to hold code_context lock.
+		 */
+		void reparse_dependents (ArrayList<GLib.File> reparsed)
+		{
+			var done = new HashSet<GLib.File> (GLib.File.hash, (GLib.EqualFunc)GLib.File.equal);
+			var pending = new ArrayList<GLib.File> ();
+
+			foreach (var file in reparsed) {
+				done.add (file);
+				pending.add (file);
+			}
+
+			while (pending.size > 0) {
+				var names = new HashSet<string> (GLib.str_hash, GLib.str_equal);
+
+				foreach (var file in pending) {
+					if (this.declared_names.contains (file)) {
+						foreach (var name in this.declared_names [file])
+							names.add (name);
+					}
+
+					if (!this.source_files.contains (file))
+						continue;
+
+					var new_names = this.collect_declared_names (this.source_files [file]);
+					this.declared_names [file] = new_names;
+
+					foreach (var name in new_names)
+						names.add (name);
+				}
+
+				pending.clear ();
+
+				if (names.size == 0)
+					break;
+
+				foreach (var file in this.source_files.get_keys ()) {
+					var source_file = this.source_files [file];
+
+					if (source_file.file_type != Vala.SourceFileType.SOURCE ||
+					    done.contains (file) ||
+					    !source_file.mentions_any (names))
+						continue;
+
+					source_file.reset ();
+					this.parser.visit_source_file (source_file);
+					source_file.dirty = false;
+
+					done.add (file);
+					pending.add (file);
+					reparsed.add (file);
+				}
+			}
+		}
+
+		/*
+		 * Re-parses the files that changed, and those depending on them, and
+		 * runs the semantic analyzer if anything is new since the last run.
+		 * Snapshots of the re-parsed files are dropped so they are rebuilt on
+		 * the next query.
+		 *
+		 * Caller is expected to hold code_context lock.
+		 */
+		void analyze_locked (GLib.Cancellable? cancellable)
+		{
+			var reparsed = this.reparse ();
+			var checked = false;
+
+			if (reparsed.size > 0)
+				this.reparse_dependents (reparsed);
+
+			if (this.needs_check &&
+			    this.report.get_errors () == 0 &&
+			    (cancellable == null || !cancellable.is_cancelled ())) {
+				this.code_context.check ();
+				this.needs_check = false;
+				checked = true;
+			}
+
+			lock (this.symbol_trees) {
+				foreach (var file in reparsed)
+					this.symbol_trees.unset (file);
+
+				/* Analysis may report diagnostics in any file */
+				if (checked || reparsed.size > 0)
+					this.diagnostics.clear ();
+			}
 		}
 
 		void add_completions (Ide.ValaSourceFile source_file,
@@ -491,6 +704,14 @@ namespace Ide
 		{
 			Ide.SymbolTree? ret = null;
 
+			/* The symbol tree is immutable once built, so share it */
+			lock (this.symbol_trees) {
+				ret = this.symbol_trees [file];
+			}
+
+			if (ret != null)
+				return ret;
+
 			Ide.ThreadPool.push (Ide.ThreadPoolKind.COMPILER, () => {
 				lock (this.code_context) {
 					Vala.CodeContext.push (this.code_context);
@@ -509,6 +730,10 @@ namespace Ide
 					source_file.accept_children (tree_builder);
 					ret = tree_builder.build_tree ();
 
+					lock (this.symbol_trees) {
+						this.symbol_trees [file] = ret;
+					}
+
 					Vala.CodeContext.pop ();
 
 					GLib.Idle.add (this.get_symbol_tree.callback);
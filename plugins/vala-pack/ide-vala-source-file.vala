@@ -45,6 +45,7 @@ namespace Ide
 	public class ValaSourceFile: Vala.SourceFile
 	{
 		ArrayList<Ide.Diagnostic> diagnostics;
+		HashSet<string>? identifiers;
 		internal Ide.File file;
 
 		public ValaSourceFile (Vala.CodeContext context,
@@ -72,6 +73,7 @@ namespace Ide
 		public void reset ()
 		{
 			this.diagnostics.clear ();
+			this.identifiers = null;
 
 			/* Copy the node list since we will be mutating while iterating */
 			var copy = new ArrayList<Vala.CodeNode> ();
@@ -115,6 +117,46 @@ namespace Ide
 			});
 		}
 
+		/* Checks if any of @names appears as an identifier in the contents */
+		public bool mentions_any (HashSet<string> names)
+		{
+			if (this.identifiers == null)
+				this.identifiers = this.scan_identifiers ();
+
+			foreach (var name in names) {
+				if (this.identifiers.contains (name))
+					return true;
+			}
+
+			return false;
+		}
+
+		HashSet<string> scan_identifiers ()
+		{
+			var ret = new HashSet<string> (GLib.str_hash, GLib.str_equal);
+			var contents = (string)this.get_mapped_contents ();
+			var len = (int)this.get_mapped_length ();
+			var begin = -1;
+
+			if (contents == null)
+				return ret;
+
+			for (var i = 0; i <= len; i++) {
+				var ch = (i < len) ? contents[i] : '\0';
+				var is_ident = (ch == '_' || ch.isalnum ());
+
+				if (is_ident && begin < 0) {
+					begin = i;
+				} else if (!is_ident && begin >= 0) {
+					if (!contents[begin].isdigit ())
+						ret.add (contents.substring (begin, i - begin));
+					begin = -1;
+				}
+			}
+
+			return ret;
+		}
+
 		public void report (Vala.SourceReference source_reference,
 		                    string message,
 		                    Ide.DiagnosticSeverity severity)
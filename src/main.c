@@ -87,10 +87,15 @@ main (int   argc,
       char *argv[])
 {
   IdeApplication *app;
+  const gchar *trace_file;
   int ret;
 
   ide_log_init (TRUE, NULL);
 
+  /* Record IDE_ENTRY/IDE_EXIT for the whole session if requested */
+  if (NULL != (trace_file = g_getenv ("IDE_TRACE_FILE")))
+    ide_trace_start ();
+
   early_verbose_check (&argc, &argv);
 
   g_message ("Initializing with Gtk+ version %d.%d.%d.",
@@ -104,6 +109,16 @@ main (int   argc,
   ret = g_application_run (G_APPLICATION (app), argc, argv);
   g_clear_object (&app);
 
+  if (trace_file != NULL)
+    {
+      g_autoptr(GError) error = NULL;
+
+      ide_trace_stop ();
+
+      if (!ide_trace_write_to_file (trace_file, &error))
+        g_warning ("Failed to write trace: %s", error->message);
+    }
+
   ide_log_shutdown ();
 
   return ret;
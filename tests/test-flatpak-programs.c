@@ -0,0 +1,366 @@
+/* test-flatpak-programs.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <ide.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+
+#include "gbp-flatpak-programs.h"
+
+/*
+ * A runtime which resolves programs the way the flatpak runtime does, but
+ * answers the `which` spawn with canned output so that the number of
+ * spawns and their arguments can be checked.
+ */
+struct _TestRuntime
+{
+  IdeRuntime  parent_instance;
+
+  gchar      *app_bin;
+  gchar      *sdk_bin;
+  gchar      *which_output;
+  GPtrArray  *which_argv;
+  GPtrArray  *requested;
+  guint       n_resolves;
+  guint       n_spawns;
+};
+
+#define TEST_TYPE_RUNTIME (test_runtime_get_type())
+G_DECLARE_FINAL_TYPE (TestRuntime, test_runtime, TEST, RUNTIME, IdeRuntime)
+G_DEFINE_TYPE (TestRuntime, test_runtime, IDE_TYPE_RUNTIME)
+
+static void
+test_runtime_resolve_programs_async (IdeRuntime          *runtime,
+                                     const gchar * const *programs,
+                                     GCancellable        *cancellable,
+                                     GAsyncReadyCallback  callback,
+                                     gpointer             user_data)
+{
+  TestRuntime *self = (TestRuntime *)runtime;
+  g_autoptr(GTask) task = NULL;
+  g_autoptr(GPtrArray) remaining = NULL;
+  GHashTable *found;
+
+  task = g_task_new (self, cancellable, callback, user_data);
+
+  self->n_resolves++;
+
+  g_ptr_array_set_size (self->requested, 0);
+  for (guint i = 0; programs [i] != NULL; i++)
+    g_ptr_array_add (self->requested, g_strdup (programs [i]));
+
+  found = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+  remaining = gbp_flatpak_programs_resolve_on_disk (programs, self->app_bin, self->sdk_bin, found);
+
+  if (remaining->len > 0)
+    {
+      self->n_spawns++;
+
+      g_ptr_array_set_size (self->which_argv, 0);
+      g_ptr_array_add (self->which_argv, g_strdup ("which"));
+      for (guint i = 0; i < remaining->len; i++)
+        g_ptr_array_add (self->which_argv, g_strdup (g_ptr_array_index (remaining, i)));
+
+      gbp_flatpak_programs_parse_which (self->which_output, remaining, found);
+    }
+
+  g_task_return_pointer (task, found, (GDestroyNotify)g_hash_table_unref);
+}
+
+static GHashTable *
+test_runtime_resolve_programs_finish (IdeRuntime    *runtime,
+                                      GAsyncResult  *result,
+                                      GError       **error)
+{
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+static void
+test_runtime_finalize (GObject *object)
+{
+  TestRuntime *self = (TestRuntime *)object;
+
+  g_clear_pointer (&self->app_bin, g_free);
+  g_clear_pointer (&self->sdk_bin, g_free);
+  g_clear_pointer (&self->which_output, g_free);
+  g_clear_pointer (&self->which_argv, g_ptr_array_unref);
+  g_clear_pointer (&self->requested, g_ptr_array_unref);
+
+  G_OBJECT_CLASS (test_runtime_parent_class)->finalize (object);
+}
+
+static void
+test_runtime_class_init (TestRuntimeClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  IdeRuntimeClass *runtime_class = IDE_RUNTIME_CLASS (klass);
+
+  object_class->finalize = test_runtime_finalize;
+
+  runtime_class->resolve_programs_async = test_runtime_resolve_programs_async;
+  runtime_class->resolve_programs_finish = test_runtime_resolve_programs_finish;
+}
+
+static void
+test_runtime_init (TestRuntime *self)
+{
+  self->which_argv = g_ptr_array_new_with_free_func (g_free);
+  self->requested = g_ptr_array_new_with_free_func (g_free);
+}
+
+typedef struct
+{
+  gchar *tmpdir;
+  gchar *app_bin;
+  gchar *sdk_bin;
+} Fixture;
+
+static void
+write_program (const gchar *directory,
+               const gchar *name,
+               gint         mode)
+{
+  g_autofree gchar *path = g_build_filename (directory, name, NULL);
+  g_autoptr(GError) error = NULL;
+
+  g_file_set_contents (path, "#!/bin/sh\n", -1, &error);
+  g_assert_no_error (error);
+  g_assert_cmpint (g_chmod (path, mode), ==, 0);
+}
+
+/*
+ * Creates a build directory and SDK deployment containing:
+ *
+ *   app/bin/meson  executable
+ *   sdk/bin/gcc    executable
+ *   sdk/bin/cc     symlink into the sandbox
+ *   sdk/bin/README not executable
+ */
+static void
+fixture_setup (Fixture       *fixture,
+               gconstpointer  data)
+{
+  g_autofree gchar *cc = NULL;
+  g_autoptr(GError) error = NULL;
+
+  fixture->tmpdir = g_dir_make_tmp ("test-flatpak-programs-XXXXXX", &error);
+  g_assert_no_error (error);
+
+  fixture->app_bin = g_build_filename (fixture->tmpdir, "app", "bin", NULL);
+  fixture->sdk_bin = g_build_filename (fixture->tmpdir, "sdk", "bin", NULL);
+  g_assert_cmpint (g_mkdir_with_parents (fixture->app_bin, 0750), ==, 0);
+  g_assert_cmpint (g_mkdir_with_parents (fixture->sdk_bin, 0750), ==, 0);
+
+  write_program (fixture->app_bin, "meson", 0755);
+  write_program (fixture->sdk_bin, "gcc", 0755);
+  write_program (fixture->sdk_bin, "README", 0644);
+
+  /* The target only exists within the sandbox */
+  cc = g_build_filename (fixture->sdk_bin, "cc", NULL);
+  g_assert_cmpint (symlink ("/usr/lib/sdk/gcc/bin/gcc", cc), ==, 0);
+}
+
+static void
+fixture_teardown (Fixture       *fixture,
+                  gconstpointer  data)
+{
+  static const gchar *files[] = { "app/bin/meson", "app/bin/ninja", "sdk/bin/gcc", "sdk/bin/README",
+                                  "sdk/bin/cc", "app/bin", "sdk/bin", "app", "sdk" };
+
+  for (guint i = 0; i < G_N_ELEMENTS (files); i++)
+    {
+      g_autofree gchar *path = g_build_filename (fixture->tmpdir, files[i], NULL);
+      g_remove (path);
+    }
+
+  g_rmdir (fixture->tmpdir);
+
+  g_clear_pointer (&fixture->tmpdir, g_free);
+  g_clear_pointer (&fixture->app_bin, g_free);
+  g_clear_pointer (&fixture->sdk_bin, g_free);
+}
+
+static gchar *
+join_array (GPtrArray *ar)
+{
+  GString *str = g_string_new (NULL);
+
+  for (guint i = 0; i < ar->len; i++)
+    {
+      if (i > 0)
+        g_string_append_c (str, ' ');
+      g_string_append (str, g_ptr_array_index (ar, i));
+    }
+
+  return g_string_free (str, FALSE);
+}
+
+static void
+resolve_cb (GObject      *object,
+            GAsyncResult *result,
+            gpointer      user_data)
+{
+  GHashTable **ret = user_data;
+  g_autoptr(GError) error = NULL;
+
+  *ret = ide_runtime_resolve_programs_finish (IDE_RUNTIME (object), result, &error);
+  g_assert_no_error (error);
+  g_assert (*ret != NULL);
+}
+
+static GHashTable *
+resolve (IdeRuntime          *runtime,
+         const gchar * const *programs)
+{
+  GHashTable *ret = NULL;
+
+  ide_runtime_resolve_programs_async (runtime, programs, NULL, resolve_cb, &ret);
+
+  while (ret == NULL)
+    g_main_context_iteration (NULL, TRUE);
+
+  return ret;
+}
+
+static void
+test_on_disk (Fixture       *fixture,
+              gconstpointer  data)
+{
+  static const gchar *programs[] = { "meson", "gcc", "cc", "README", "ninja", "/usr/bin/env", NULL };
+  g_autoptr(GHashTable) found = NULL;
+  g_autoptr(GPtrArray) remaining = NULL;
+
+  found = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+  remaining = gbp_flatpak_programs_resolve_on_disk (programs, fixture->app_bin, fixture->sdk_bin, found);
+
+  g_assert_cmpint (g_hash_table_size (found), ==, 3);
+  g_assert_cmpstr (g_hash_table_lookup (found, "meson"), ==, "/app/bin/meson");
+  g_assert_cmpstr (g_hash_table_lookup (found, "gcc"), ==, "/usr/bin/gcc");
+  g_assert_cmpstr (g_hash_table_lookup (found, "cc"), ==, "/usr/bin/cc");
+
+  /* Only paths need the sandbox, anything else is known to be missing */
+  g_assert_cmpint (remaining->len, ==, 1);
+  g_assert_cmpstr (g_ptr_array_index (remaining, 0), ==, "/usr/bin/env");
+  g_clear_pointer (&remaining, g_ptr_array_unref);
+  g_hash_table_remove_all (found);
+
+  /* Without an SDK deployment everything needs the sandbox */
+  remaining = gbp_flatpak_programs_resolve_on_disk (programs, fixture->app_bin, NULL, found);
+  g_assert_cmpint (g_hash_table_size (found), ==, 0);
+  g_assert_cmpint (remaining->len, ==, G_N_ELEMENTS (programs) - 1);
+}
+
+static void
+test_parse_which (void)
+{
+  g_autoptr(GHashTable) found = NULL;
+  g_autoptr(GPtrArray) remaining = NULL;
+
+  found = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+  remaining = g_ptr_array_new ();
+  g_ptr_array_add (remaining, "gcc");
+  g_ptr_array_add (remaining, "ninja");
+  g_ptr_array_add (remaining, "/usr/bin/env");
+
+  gbp_flatpak_programs_parse_which ("/usr/bin/gcc\n\n  /usr/bin/env  \n", remaining, found);
+
+  g_assert_cmpint (g_hash_table_size (found), ==, 2);
+  g_assert_cmpstr (g_hash_table_lookup (found, "gcc"), ==, "/usr/bin/gcc");
+  g_assert_cmpstr (g_hash_table_lookup (found, "/usr/bin/env"), ==, "/usr/bin/env");
+
+  g_hash_table_remove_all (found);
+  gbp_flatpak_programs_parse_which (NULL, remaining, found);
+  g_assert_cmpint (g_hash_table_size (found), ==, 0);
+}
+
+static void
+test_cache (Fixture       *fixture,
+            gconstpointer  data)
+{
+  static const gchar *programs[] = { "meson", "gcc", "ninja", "/usr/bin/env", "/usr/bin/true", NULL };
+  static const gchar *more[] = { "gcc", "cc", NULL };
+  g_autoptr(TestRuntime) runtime = NULL;
+  g_autoptr(GHashTable) found = NULL;
+  g_autofree gchar *str = NULL;
+
+  runtime = g_object_new (TEST_TYPE_RUNTIME, "id", "test", NULL);
+  runtime->app_bin = g_strdup (fixture->app_bin);
+  runtime->sdk_bin = g_strdup (fixture->sdk_bin);
+  runtime->which_output = g_strdup ("/usr/bin/env\n");
+
+  /* Programs on disk are found directly, the rest with a single spawn */
+  found = resolve (IDE_RUNTIME (runtime), programs);
+  g_assert_cmpint (runtime->n_resolves, ==, 1);
+  g_assert_cmpint (runtime->n_spawns, ==, 1);
+  str = join_array (runtime->which_argv);
+  g_assert_cmpstr (str, ==, "which /usr/bin/env /usr/bin/true");
+  g_clear_pointer (&str, g_free);
+
+  g_assert_cmpint (g_hash_table_size (found), ==, 3);
+  g_assert_cmpstr (g_hash_table_lookup (found, "meson"), ==, "/app/bin/meson");
+  g_assert_cmpstr (g_hash_table_lookup (found, "gcc"), ==, "/usr/bin/gcc");
+  g_assert_cmpstr (g_hash_table_lookup (found, "/usr/bin/env"), ==, "/usr/bin/env");
+  g_clear_pointer (&found, g_hash_table_unref);
+
+  /* Found and missing programs are both answered from the cache */
+  found = resolve (IDE_RUNTIME (runtime), programs);
+  g_assert_cmpint (runtime->n_resolves, ==, 1);
+  g_assert_cmpint (runtime->n_spawns, ==, 1);
+  g_assert_cmpint (g_hash_table_size (found), ==, 3);
+  g_assert_false (g_hash_table_contains (found, "ninja"));
+  g_clear_pointer (&found, g_hash_table_unref);
+
+  /* Only the programs missing from the cache reach the runtime */
+  found = resolve (IDE_RUNTIME (runtime), more);
+  g_assert_cmpint (runtime->n_resolves, ==, 2);
+  g_assert_cmpint (runtime->n_spawns, ==, 1);
+  str = join_array (runtime->requested);
+  g_assert_cmpstr (str, ==, "cc");
+  g_clear_pointer (&str, g_free);
+  g_assert_cmpstr (g_hash_table_lookup (found, "gcc"), ==, "/usr/bin/gcc");
+  g_assert_cmpstr (g_hash_table_lookup (found, "cc"), ==, "/usr/bin/cc");
+  g_clear_pointer (&found, g_hash_table_unref);
+
+  /* Invalidating drops the cache, including the missing programs */
+  ide_runtime_invalidate_programs (IDE_RUNTIME (runtime));
+  g_free (runtime->which_output);
+  runtime->which_output = g_strdup ("/usr/bin/env\n/usr/bin/true\n");
+  write_program (fixture->app_bin, "ninja", 0755);
+
+  found = resolve (IDE_RUNTIME (runtime), programs);
+  g_assert_cmpint (runtime->n_resolves, ==, 3);
+  g_assert_cmpint (runtime->n_spawns, ==, 2);
+  str = join_array (runtime->requested);
+  g_assert_cmpstr (str, ==, "meson gcc ninja /usr/bin/env /usr/bin/true");
+  g_clear_pointer (&str, g_free);
+
+  g_assert_cmpint (g_hash_table_size (found), ==, 5);
+  g_assert_cmpstr (g_hash_table_lookup (found, "ninja"), ==, "/app/bin/ninja");
+  g_assert_cmpstr (g_hash_table_lookup (found, "/usr/bin/true"), ==, "/usr/bin/true");
+}
+
+gint
+main (gint   argc,
+      gchar *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+  g_test_add ("/Flatpak/Programs/on_disk", Fixture, NULL, fixture_setup, test_on_disk, fixture_teardown);
+  g_test_add_func ("/Flatpak/Programs/parse_which", test_parse_which);
+  g_test_add ("/Flatpak/Programs/cache", Fixture, NULL, fixture_setup, test_cache, fixture_teardown);
+  return g_test_run ();
+}
@@ -0,0 +1,291 @@
+/* test-gettext-regions.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "ide-gettext-regions.h"
+
+/*
+ * Returns the contents of the regions separated by "|", after checking
+ * that they cover @text and start on the right line.
+ */
+static gchar *
+describe_regions (const gchar *text,
+                  GArray      *regions)
+{
+  GString *str = g_string_new (NULL);
+  gsize begin = 0;
+  guint line = 0;
+
+  for (guint i = 0; i < regions->len; i++)
+    {
+      const IdeGettextRegion *region = &g_array_index (regions, IdeGettextRegion, i);
+
+      g_assert_cmpuint (region->begin, ==, begin);
+      g_assert_cmpuint (region->line, ==, line);
+      g_assert_cmpuint (region->end, >, region->begin);
+
+      for (gsize j = region->begin; j < region->end; j++)
+        {
+          if (text [j] == '\n')
+            line++;
+        }
+
+      if (i > 0)
+        g_string_append_c (str, '|');
+      g_string_append_len (str, text + region->begin, region->end - region->begin);
+
+      begin = region->end;
+    }
+
+  g_assert_cmpuint (begin, ==, strlen (text));
+
+  return g_string_free (str, FALSE);
+}
+
+static gchar *
+split (const gchar *text,
+       gboolean     verbatim_strings)
+{
+  g_autoptr(GArray) regions = NULL;
+
+  regions = ide_gettext_split_regions (text, strlen (text), TRUE, verbatim_strings);
+
+  return describe_regions (text, regions);
+}
+
+static gchar *
+join_msgids (const IdeGettextRegion *region)
+{
+  GString *str;
+
+  if (region->msgids == NULL)
+    return NULL;
+
+  str = g_string_new (NULL);
+
+  for (guint i = 0; i < region->msgids->len; i++)
+    {
+      if (i > 0)
+        g_string_append_c (str, '|');
+      g_string_append (str, g_ptr_array_index (region->msgids, i));
+    }
+
+  return g_string_free (str, FALSE);
+}
+
+static void
+test_regions_split (void)
+{
+  static const gchar text[] =
+    "#include <glib.h>\n"
+    "\n"
+    "static void\n"
+    "foo (void)\n"
+    "{\n"
+    "  const gchar *s = \"}\";\n"
+    "\n"
+    "  /* } */\n"
+    "}\n"
+    "G_DEFINE_TYPE (Foo, foo,\n"
+    "\n"
+    "               G_TYPE_OBJECT)\n"
+    "\n"
+    "int x;";
+  g_autofree gchar *str = NULL;
+
+  /* Blank lines within functions and calls do not end a region */
+  str = split (text, FALSE);
+  g_assert_cmpstr (str, ==,
+                   "#include <glib.h>\n\n"
+                   "|static void\nfoo (void)\n{\n  const gchar *s = \"}\";\n\n  /* } */\n}\n"
+                   "|G_DEFINE_TYPE (Foo, foo,\n\n               G_TYPE_OBJECT)\n\n"
+                   "|int x;");
+}
+
+static void
+test_regions_nesting (void)
+{
+  static const gchar cplusplus[] =
+    "namespace foo {\n"
+    "\n"
+    "class Bar : public Baz {\n"
+    "  void f () {\n"
+    "\n"
+    "  }\n"
+    "\n"
+    "  int b;\n"
+    "};\n"
+    "}\n";
+  static const gchar c[] =
+    "struct s {\n"
+    "\n"
+    "  int a;\n"
+    "};\n"
+    "void f (class Bar *b) {\n"
+    "\n"
+    "}\n";
+  g_autofree gchar *str = NULL;
+
+  /* The bodies of namespaces and classes are split like the top level */
+  str = split (cplusplus, FALSE);
+  g_assert_cmpstr (str, ==,
+                   "namespace foo {\n\n"
+                   "|class Bar : public Baz {\n  void f () {\n\n  }\n"
+                   "|\n"
+                   "|  int b;\n"
+                   "|};\n"
+                   "|}\n");
+  g_clear_pointer (&str, g_free);
+
+  /* But not the bodies of structures or functions */
+  str = split (c, FALSE);
+  g_assert_cmpstr (str, ==,
+                   "struct s {\n\n  int a;\n};\n"
+                   "|void f (class Bar *b) {\n\n}\n");
+}
+
+static void
+test_regions_vala (void)
+{
+  static const gchar text[] =
+    "public class Foo : Object {\n"
+    "  string s = \"\"\"\n"
+    "}\n"
+    "\n"
+    "\"\"\";\n"
+    "  void f () {\n"
+    "  }\n"
+    "}\n";
+  g_autofree gchar *str = NULL;
+
+  str = split (text, TRUE);
+  g_assert_cmpstr (str, ==,
+                   "public class Foo : Object {\n  string s = \"\"\"\n}\n\n\"\"\";\n"
+                   "|  void f () {\n  }\n"
+                   "|}\n");
+}
+
+static void
+test_regions_msgids (void)
+{
+  static const gchar text[] =
+    "static const gchar *names[] = {\n"
+    "  N_(\"One\"),\n"
+    "  N_ (\"Two\" \" words\"),\n"
+    "};\n"
+    "\n"
+    "void\n"
+    "f (void)\n"
+    "{\n"
+    "  g_print (\"%s\", _(\"Hello\"));\n"
+    "  g_print (\"%s\", g_dngettext (NULL, \"an item\", \"%d items\", n));\n"
+    "  g_print (\"not a msgid\");\n"
+    "}\n";
+  g_autoptr(GArray) regions = NULL;
+  g_autofree gchar *str = NULL;
+  g_autofree gchar *msgids = NULL;
+
+  regions = ide_gettext_split_regions (text, strlen (text), TRUE, FALSE);
+  g_assert_cmpint (regions->len, ==, 3);
+
+  str = join_msgids (&g_array_index (regions, IdeGettextRegion, 0));
+  g_assert_cmpstr (str, ==, "One|Two words");
+  g_clear_pointer (&str, g_free);
+
+  g_assert (g_array_index (regions, IdeGettextRegion, 1).msgids == NULL);
+
+  str = join_msgids (&g_array_index (regions, IdeGettextRegion, 2));
+  g_assert_cmpstr (str, ==, "Hello|an item|%d items");
+}
+
+static void
+test_regions_escapes (void)
+{
+  static const gchar text[] =
+    "_(\"\\x41\\102\\u00e9\\\"\\n\" \"C\");\n"
+    "_(\"AB\u00e9\\\"\\n\" \"\\\n"
+    "C\");\n";
+  g_autoptr(GArray) regions = NULL;
+
+  /* Escape sequences are replaced, so both spellings are the same msgid */
+  regions = ide_gettext_split_regions (text, strlen (text), TRUE, FALSE);
+  g_assert_cmpint (regions->len, ==, 2);
+
+  for (guint i = 0; i < regions->len; i++)
+    {
+      const IdeGettextRegion *region = &g_array_index (regions, IdeGettextRegion, i);
+
+      g_assert (region->msgids != NULL);
+      g_assert_cmpint (region->msgids->len, ==, 1);
+      g_assert_cmpstr (g_ptr_array_index (region->msgids, 0), ==, "AB\u00e9\"\nC");
+    }
+}
+
+static void
+test_regions_no_split (void)
+{
+  static const gchar text[] = "int a;\n\nint b = N_(\"b\");\n";
+  g_autoptr(GArray) regions = NULL;
+  g_autofree gchar *str = NULL;
+
+  regions = ide_gettext_split_regions (text, strlen (text), FALSE, FALSE);
+  str = describe_regions (text, regions);
+  g_assert_cmpstr (str, ==, text);
+  g_assert (g_array_index (regions, IdeGettextRegion, 0).msgids == NULL);
+  g_clear_pointer (&regions, g_array_unref);
+
+  regions = ide_gettext_split_regions ("", 0, TRUE, FALSE);
+  g_assert_cmpint (regions->len, ==, 0);
+}
+
+static void
+test_parse_location (void)
+{
+  const gchar *message = NULL;
+  guint lineno = 0;
+
+  g_assert_true (ide_gettext_parse_location ("standard input:12: message", &lineno, &message));
+  g_assert_cmpint (lineno, ==, 11);
+  g_assert_cmpstr (message, ==, " message");
+
+  /* The name of the input is translated and may contain colons */
+  g_assert_true (ide_gettext_parse_location ("entrée: standard:5: ASCII", &lineno, &message));
+  g_assert_cmpint (lineno, ==, 4);
+  g_assert_cmpstr (message, ==, " ASCII");
+
+  g_assert_false (ide_gettext_parse_location ("xgettext: warning: message", &lineno, &message));
+  g_assert_false (ide_gettext_parse_location ("standard input:0: message", &lineno, &message));
+  g_assert_false (ide_gettext_parse_location ("standard input:12 message", &lineno, &message));
+  g_assert_false (ide_gettext_parse_location ("", &lineno, &message));
+}
+
+gint
+main (gint   argc,
+      gchar *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+  g_test_add_func ("/Gettext/Regions/split", test_regions_split);
+  g_test_add_func ("/Gettext/Regions/nesting", test_regions_nesting);
+  g_test_add_func ("/Gettext/Regions/vala", test_regions_vala);
+  g_test_add_func ("/Gettext/Regions/msgids", test_regions_msgids);
+  g_test_add_func ("/Gettext/Regions/escapes", test_regions_escapes);
+  g_test_add_func ("/Gettext/Regions/no_split", test_regions_no_split);
+  g_test_add_func ("/Gettext/Regions/parse_location", test_parse_location);
+  return g_test_run ();
+}
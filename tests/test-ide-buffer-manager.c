@@ -21,6 +21,8 @@
 #include <ide.h>
 
 #include "application/ide-application-tests.h"
+#include "editor/ide-editor-frame.h"
+#include "util/ide-gdk.h"
 
 static gint   save_count;
 static gint   load_count;
@@ -169,6 +171,155 @@ test_buffer_manager_basic (GCancellable        *cancellable,
                          g_object_ref (task));
 }
 
+/*
+ * In large-file mode, typing in the search entry must not make the search
+ * context count occurrences. That only happens once the search is
+ * activated.
+ */
+static void
+assert_search_deferred (IdeBuffer *buffer)
+{
+  GtkSourceSearchSettings *search_settings;
+  GtkSourceSearchContext *search_context;
+  IdeSourceView *source_view;
+  GdkEventKey *event;
+  GtkWidget *search_entry;
+  GtkWidget *window;
+  GtkWidget *frame;
+  gboolean ret = FALSE;
+
+  window = gtk_offscreen_window_new ();
+  frame = g_object_new (IDE_TYPE_EDITOR_FRAME,
+                        "document", buffer,
+                        "visible", TRUE,
+                        NULL);
+  gtk_container_add (GTK_CONTAINER (window), frame);
+  gtk_window_present (GTK_WINDOW (window));
+
+  source_view = ide_editor_frame_get_source_view (IDE_EDITOR_FRAME (frame));
+  search_context = ide_source_view_get_search_context (source_view);
+  search_settings = gtk_source_search_context_get_settings (search_context);
+  search_entry = GTK_WIDGET (gtk_widget_get_template_child (frame, IDE_TYPE_EDITOR_FRAME, "search_entry"));
+
+  gtk_entry_set_text (GTK_ENTRY (search_entry), "lazy dog");
+
+  while (gtk_events_pending ())
+    gtk_main_iteration ();
+
+  g_assert (gtk_source_search_settings_get_search_text (search_settings) == NULL);
+
+  event = ide_gdk_synthesize_event_keyval (gtk_widget_get_window (window), GDK_KEY_Return);
+  g_signal_emit_by_name (search_entry, "key-press-event", event, &ret);
+  gdk_event_free ((GdkEvent *)event);
+
+  g_assert (ret == GDK_EVENT_STOP);
+  g_assert_cmpstr (gtk_source_search_settings_get_search_text (search_settings), ==, "lazy dog");
+
+  /* The single scan still counts every occurrence */
+  while (gtk_source_search_context_get_occurrences_count (search_context) < 0)
+    gtk_main_iteration ();
+
+  g_assert_cmpint (gtk_source_search_context_get_occurrences_count (search_context), ==, 10000);
+
+  gtk_widget_destroy (window);
+}
+
+static void
+test_buffer_manager_large_file_cb2 (GObject      *object,
+                                    GAsyncResult *result,
+                                    gpointer      user_data)
+{
+  IdeBufferManager *buffer_manager = (IdeBufferManager *)object;
+  g_autoptr(IdeBuffer) buffer = NULL;
+  g_autoptr(GTask) task = user_data;
+  gchar *path = g_task_get_task_data (task);
+  GError *error = NULL;
+
+  buffer = ide_buffer_manager_load_file_finish (buffer_manager, result, &error);
+  g_assert_no_error (error);
+  g_assert (IDE_IS_BUFFER (buffer));
+
+  g_assert (ide_buffer_get_large_file (buffer));
+  g_assert_cmpint (gtk_text_buffer_get_line_count (GTK_TEXT_BUFFER (buffer)), >=, 10000);
+
+  assert_search_deferred (buffer);
+
+  g_unlink (path);
+
+  g_task_return_boolean (task, TRUE);
+}
+
+static void
+test_buffer_manager_large_file_cb1 (GObject      *object,
+                                    GAsyncResult *result,
+                                    gpointer      user_data)
+{
+  g_autoptr(IdeFile) file = NULL;
+  g_autoptr(GTask) task = user_data;
+  g_autoptr(IdeProgress) progress = NULL;
+  g_autoptr(IdeContext) context = NULL;
+  g_autoptr(GString) str = NULL;
+  IdeBufferManager *buffer_manager;
+  IdeProject *project;
+  gchar *path = NULL;
+  GError *error = NULL;
+  gint fd;
+
+  context = ide_context_new_finish (result, &error);
+  g_assert_no_error (error);
+  g_assert (context != NULL);
+
+  /* Generate a log file well over the (lowered) size limit */
+  str = g_string_new (NULL);
+  for (guint i = 0; i < 10000; i++)
+    g_string_append_printf (str, "%05u: The quick brown fox jumps over the lazy dog.\n", i);
+
+  fd = g_file_open_tmp ("large-file-XXXXXX.log", &path, &error);
+  g_assert_no_error (error);
+  close (fd);
+
+  g_file_set_contents (path, str->str, str->len, &error);
+  g_assert_no_error (error);
+
+  g_task_set_task_data (task, path, g_free);
+
+  buffer_manager = ide_context_get_buffer_manager (context);
+  ide_buffer_manager_set_max_file_size (buffer_manager, str->len / 4);
+
+  project = ide_context_get_project (context);
+  file = ide_project_get_file_for_path (project, path);
+
+  ide_buffer_manager_load_file_async (buffer_manager,
+                                      file,
+                                      FALSE,
+                                      IDE_WORKBENCH_OPEN_FLAGS_NONE,
+                                      &progress,
+                                      g_task_get_cancellable (task),
+                                      test_buffer_manager_large_file_cb2,
+                                      g_object_ref (task));
+}
+
+static void
+test_buffer_manager_large_file (GCancellable        *cancellable,
+                                GAsyncReadyCallback  callback,
+                                gpointer             user_data)
+{
+  g_autoptr(GFile) project_file = NULL;
+  g_autofree gchar *path = NULL;
+  const gchar *srcdir = g_getenv ("G_TEST_SRCDIR");
+  g_autoptr(GTask) task = NULL;
+
+  task = g_task_new (NULL, cancellable, callback, user_data);
+
+  path = g_build_filename (srcdir, "data", "project1", "configure.ac", NULL);
+  project_file = g_file_new_for_path (path);
+
+  ide_context_new_async (project_file,
+                         cancellable,
+                         test_buffer_manager_large_file_cb1,
+                         g_object_ref (task));
+}
+
 gint
 main (gint   argc,
       gchar *argv[])
@@ -183,6 +334,7 @@ main (gint   argc,
 
   app = ide_application_new ();
   ide_application_add_test (app, "/Ide/BufferManager/basic", test_buffer_manager_basic, NULL);
+  ide_application_add_test (app, "/Ide/BufferManager/large-file", test_buffer_manager_large_file, NULL);
   ret = g_application_run (G_APPLICATION (app), argc, argv);
   g_object_unref (app);
 
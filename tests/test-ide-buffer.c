@@ -129,6 +129,149 @@ test_buffer_basic (GCancellable        *cancellable,
   IDE_EXIT;
 }
 
+typedef struct
+{
+  guint n_finished;
+  gint  begin;
+  gint  end;
+} BulkEditState;
+
+static void
+bulk_edit_finished_cb (IdeBuffer     *buffer,
+                       GtkTextIter   *begin,
+                       GtkTextIter   *end,
+                       BulkEditState *state)
+{
+  g_assert (IDE_IS_BUFFER (buffer));
+  g_assert (!ide_buffer_get_in_bulk_edit (buffer));
+
+  state->n_finished++;
+  state->begin = gtk_text_iter_get_offset (begin);
+  state->end = gtk_text_iter_get_offset (end);
+}
+
+static void
+test_buffer_bulk_edit_cb2 (GObject      *object,
+                           GAsyncResult *result,
+                           gpointer      user_data)
+{
+  IdeBufferManager *manager = (IdeBufferManager *)object;
+  g_autoptr(IdeBuffer) buffer = NULL;
+  g_autoptr(GTask) task = user_data;
+  g_autofree gchar *str = NULL;
+  BulkEditState state = { 0 };
+  GtkTextBuffer *text_buffer;
+  GtkTextIter begin;
+  GtkTextIter end;
+  GError *error = NULL;
+
+  IDE_ENTRY;
+
+  buffer = ide_buffer_manager_load_file_finish (manager, result, &error);
+  g_assert_no_error (error);
+  g_assert (IDE_IS_BUFFER (buffer));
+
+  text_buffer = GTK_TEXT_BUFFER (buffer);
+  gtk_text_buffer_set_text (text_buffer, "one two three\nfour five six\nseven\n", -1);
+
+  g_signal_connect (buffer, "bulk-edit-finished", G_CALLBACK (bulk_edit_finished_cb), &state);
+
+  ide_buffer_begin_bulk_edit (buffer);
+  g_assert (ide_buffer_get_in_bulk_edit (buffer));
+
+  gtk_text_buffer_get_iter_at_offset (text_buffer, &begin, 4);
+  gtk_text_buffer_insert (text_buffer, &begin, "X", -1);
+
+  /* Nested bulk edits are folded into the outermost one */
+  ide_buffer_begin_bulk_edit (buffer);
+  gtk_text_buffer_get_iter_at_offset (text_buffer, &begin, 20);
+  gtk_text_buffer_get_iter_at_offset (text_buffer, &end, 25);
+  gtk_text_buffer_delete (text_buffer, &begin, &end);
+  ide_buffer_end_bulk_edit (buffer);
+
+  g_assert (ide_buffer_get_in_bulk_edit (buffer));
+  g_assert_cmpint (state.n_finished, ==, 0);
+
+  /* An edit before the modified range grows it */
+  gtk_text_buffer_get_start_iter (text_buffer, &begin);
+  gtk_text_buffer_insert (text_buffer, &begin, "Y", -1);
+
+  ide_buffer_end_bulk_edit (buffer);
+
+  g_assert (!ide_buffer_get_in_bulk_edit (buffer));
+  g_assert_cmpint (state.n_finished, ==, 1);
+  g_assert_cmpint (state.begin, ==, 0);
+  g_assert_cmpint (state.end, ==, 21);
+
+  gtk_text_buffer_get_bounds (text_buffer, &begin, &end);
+  str = gtk_text_buffer_get_text (text_buffer, &begin, &end, TRUE);
+  g_assert_cmpstr (str, ==, "Yone Xtwo three\nfour six\nseven\n");
+
+  /* A bulk edit without changes is not reported */
+  ide_buffer_begin_bulk_edit (buffer);
+  ide_buffer_end_bulk_edit (buffer);
+  g_assert_cmpint (state.n_finished, ==, 1);
+
+  g_signal_handlers_disconnect_by_func (buffer, G_CALLBACK (bulk_edit_finished_cb), &state);
+
+  g_task_return_boolean (task, TRUE);
+
+  IDE_EXIT;
+}
+
+static void
+test_buffer_bulk_edit_cb1 (GObject      *object,
+                           GAsyncResult *result,
+                           gpointer      user_data)
+{
+  g_autoptr(GTask) task = user_data;
+  g_autoptr(IdeFile) file = NULL;
+  g_autoptr(IdeContext) context = NULL;
+  IdeBufferManager *manager;
+  IdeProject *project;
+  GError *error = NULL;
+
+  IDE_ENTRY;
+
+  context = ide_context_new_finish (result, &error);
+  g_assert_no_error (error);
+  g_assert (IDE_IS_CONTEXT (context));
+
+  manager = ide_context_get_buffer_manager (context);
+  project = ide_context_get_project (context);
+  file = ide_project_get_file_for_path (project, "test-ide-buffer-bulk.tmp");
+
+  ide_buffer_manager_load_file_async (manager,
+                                      file,
+                                      FALSE,
+                                      IDE_WORKBENCH_OPEN_FLAGS_NONE,
+                                      NULL,
+                                      g_task_get_cancellable (task),
+                                      test_buffer_bulk_edit_cb2,
+                                      g_object_ref (task));
+
+  IDE_EXIT;
+}
+
+static void
+test_buffer_bulk_edit (GCancellable        *cancellable,
+                       GAsyncReadyCallback  callback,
+                       gpointer             user_data)
+{
+  g_autoptr(GFile) project_file = NULL;
+  g_autofree gchar *path = NULL;
+  GTask *task;
+
+  IDE_ENTRY;
+
+  task = g_task_new (NULL, cancellable, callback, user_data);
+  path = g_build_filename (TEST_DATA_DIR, "project1", "configure.ac", NULL);
+  project_file = g_file_new_for_path (path);
+  ide_context_new_async (project_file, cancellable, test_buffer_bulk_edit_cb1, task);
+
+  IDE_EXIT;
+}
+
 gint
 main (gint   argc,
       gchar *argv[])
@@ -143,6 +286,7 @@ main (gint   argc,
 
   app = ide_application_new ();
   ide_application_add_test (app, "/Ide/Buffer/basic", test_buffer_basic, NULL);
+  ide_application_add_test (app, "/Ide/Buffer/bulk_edit", test_buffer_bulk_edit, NULL);
   ret = g_application_run (G_APPLICATION (app), argc, argv);
   g_object_unref (app);
 
@@ -16,6 +16,7 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <glib/gstdio.h>
 #include <ide.h>
 
 #include "editorconfig/ide-editorconfig-file-settings.h"
@@ -156,6 +157,139 @@ test_editorconfig (void)
   g_clear_object (&dummy);
 }
 
+static void
+test_editorconfig_load_cb (GObject      *object,
+                           GAsyncResult *result,
+                           gpointer      user_data)
+{
+  GAsyncInitable *initable = (GAsyncInitable *)object;
+  IdeFileSettings **settings = user_data;
+  GObject *res;
+  GError *error = NULL;
+
+  res = g_async_initable_new_finish (initable, result, &error);
+  g_assert_no_error (error);
+  g_assert (IDE_IS_EDITORCONFIG_FILE_SETTINGS (res));
+
+  *settings = IDE_FILE_SETTINGS (res);
+}
+
+static IdeFileSettings *
+load_editorconfig (IdeContext  *context,
+                   const gchar *path)
+{
+  IdeFileSettings *settings = NULL;
+  IdeFile *file;
+  GFile *gfile;
+
+  gfile = g_file_new_for_path (path);
+  file = g_object_new (IDE_TYPE_FILE,
+                       "context", context,
+                       "file", gfile,
+                       "path", path,
+                       NULL);
+
+  g_async_initable_new_async (IDE_TYPE_EDITORCONFIG_FILE_SETTINGS,
+                              G_PRIORITY_DEFAULT,
+                              NULL,
+                              test_editorconfig_load_cb,
+                              &settings,
+                              "file", file,
+                              "context", context,
+                              NULL);
+
+  while (settings == NULL)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_clear_object (&file);
+  g_clear_object (&gfile);
+
+  return settings;
+}
+
+static void
+write_file (const gchar *path,
+            const gchar *contents)
+{
+  GError *error = NULL;
+
+  g_file_set_contents (path, contents, -1, &error);
+  g_assert_no_error (error);
+}
+
+static void
+test_editorconfig_changes (void)
+{
+  IdeFileSettings *settings;
+  IdeContext *dummy;
+  gchar *tmpdir;
+  gchar *subdir;
+  gchar *root_config;
+  gchar *sub_config;
+  gchar *path_a;
+  gchar *path_b;
+  gchar *path_c;
+
+  tmpdir = g_dir_make_tmp ("test-editorconfig-XXXXXX", NULL);
+  g_assert (tmpdir != NULL);
+
+  subdir = g_build_filename (tmpdir, "sub", NULL);
+  g_assert_cmpint (g_mkdir (subdir, 0750), ==, 0);
+
+  root_config = g_build_filename (tmpdir, ".editorconfig", NULL);
+  sub_config = g_build_filename (subdir, ".editorconfig", NULL);
+  path_a = g_build_filename (tmpdir, "a.c", NULL);
+  path_b = g_build_filename (tmpdir, "b.c", NULL);
+  path_c = g_build_filename (subdir, "c.c", NULL);
+
+  write_file (root_config, "root = true\n\n[*.c]\nindent_size = 3\n");
+
+  dummy = g_object_new (IDE_TYPE_CONTEXT, NULL);
+
+  settings = load_editorconfig (dummy, path_a);
+  g_assert_cmpint (ide_file_settings_get_indent_width (settings), ==, 3);
+  g_assert_cmpint (ide_file_settings_get_tab_width (settings), ==, 3);
+  g_object_unref (settings);
+
+  /* Another file from the same directory shares the cached result */
+  settings = load_editorconfig (dummy, path_b);
+  g_assert_cmpint (ide_file_settings_get_indent_width (settings), ==, 3);
+  g_object_unref (settings);
+
+  settings = load_editorconfig (dummy, path_c);
+  g_assert_cmpint (ide_file_settings_get_indent_width (settings), ==, 3);
+  g_object_unref (settings);
+
+  /* Changed and newly created files are noticed after the check interval */
+  write_file (root_config, "root = true\n\n[*.c]\nindent_size = 5\ntab_width = 8\n");
+  write_file (sub_config, "[c.c]\nindent_size = 7\n");
+  g_usleep (G_USEC_PER_SEC + G_USEC_PER_SEC / 10);
+
+  settings = load_editorconfig (dummy, path_a);
+  g_assert_cmpint (ide_file_settings_get_indent_width (settings), ==, 5);
+  g_assert_cmpint (ide_file_settings_get_tab_width (settings), ==, 8);
+  g_object_unref (settings);
+
+  settings = load_editorconfig (dummy, path_c);
+  g_assert_cmpint (ide_file_settings_get_indent_width (settings), ==, 7);
+  g_assert_cmpint (ide_file_settings_get_tab_width (settings), ==, 8);
+  g_object_unref (settings);
+
+  g_assert_cmpint (g_unlink (sub_config), ==, 0);
+  g_assert_cmpint (g_unlink (root_config), ==, 0);
+  g_assert_cmpint (g_rmdir (subdir), ==, 0);
+  g_assert_cmpint (g_rmdir (tmpdir), ==, 0);
+
+  g_clear_object (&dummy);
+  g_free (path_a);
+  g_free (path_b);
+  g_free (path_c);
+  g_free (root_config);
+  g_free (sub_config);
+  g_free (subdir);
+  g_free (tmpdir);
+}
+
 gint
 main (gint argc,
       gchar *argv[])
@@ -163,5 +297,6 @@ main (gint argc,
   g_test_init (&argc, &argv, NULL);
   g_test_add_func ("/Ide/FileSettings/basic", test_filesettings);
   g_test_add_func ("/Ide/EditorconfigFileSettings/basic", test_editorconfig);
+  g_test_add_func ("/Ide/EditorconfigFileSettings/changes", test_editorconfig_changes);
   return g_test_run ();
 }
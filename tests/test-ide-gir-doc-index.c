@@ -0,0 +1,175 @@
+/* test-ide-gir-doc-index.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib/gstdio.h>
+#include <ide.h>
+
+#include "application/ide-application-tests.h"
+
+static const gchar *gir_v1 =
+  "<?xml version=\"1.0\"?>\n"
+  "<repository version=\"1.2\"\n"
+  "            xmlns=\"http://www.gtk.org/introspection/core/1.0\"\n"
+  "            xmlns:c=\"http://www.gtk.org/introspection/c/1.0\"\n"
+  "            xmlns:glib=\"http://www.gtk.org/introspection/glib/1.0\">\n"
+  "  <namespace name=\"Test\" version=\"1.0\">\n"
+  "    <class name=\"Widget\" c:type=\"TestWidget\" glib:type-name=\"TestWidget\">\n"
+  "      <doc xml:space=\"preserve\">A widget &amp; more.</doc>\n"
+  "      <method name=\"frob\" c:identifier=\"test_widget_frob\">\n"
+  "        <doc xml:space=\"preserve\">Frobs the widget.</doc>\n"
+  "        <parameters>\n"
+  "          <parameter name=\"count\">\n"
+  "            <doc xml:space=\"preserve\">The number of times</doc>\n"
+  "          </parameter>\n"
+  "        </parameters>\n"
+  "      </method>\n"
+  "    </class>\n"
+  "    <function name=\"init\" c:identifier=\"test_init\">\n"
+  "      <doc xml:space=\"preserve\">Initializes the library.</doc>\n"
+  "    </function>\n"
+  "  </namespace>\n"
+  "</repository>\n";
+
+static const gchar *gir_v2 =
+  "<?xml version=\"1.0\"?>\n"
+  "<repository version=\"1.2\"\n"
+  "            xmlns=\"http://www.gtk.org/introspection/core/1.0\"\n"
+  "            xmlns:c=\"http://www.gtk.org/introspection/c/1.0\">\n"
+  "  <namespace name=\"Test\" version=\"1.0\">\n"
+  "    <function name=\"init\" c:identifier=\"test_init\">\n"
+  "      <doc xml:space=\"preserve\">Initializes the library, again.</doc>\n"
+  "    </function>\n"
+  "  </namespace>\n"
+  "</repository>\n";
+
+static void
+update_cb (GObject      *object,
+           GAsyncResult *result,
+           gpointer      user_data)
+{
+  g_autoptr(GError) error = NULL;
+  gboolean *completed = user_data;
+  gboolean ret;
+
+  ret = ide_gir_doc_index_update_finish (IDE_GIR_DOC_INDEX (object), result, &error);
+  g_assert_no_error (error);
+  g_assert_true (ret);
+
+  *completed = TRUE;
+}
+
+static void
+update (IdeGirDocIndex *index)
+{
+  gboolean completed = FALSE;
+
+  ide_gir_doc_index_update_async (index, NULL, update_cb, &completed);
+
+  while (!completed)
+    g_main_context_iteration (NULL, TRUE);
+}
+
+static void
+assert_doc (IdeGirDocIndex *index,
+            const gchar    *symbol,
+            const gchar    *version,
+            const gchar    *expected)
+{
+  g_autofree gchar *doc = ide_gir_doc_index_lookup (index, symbol, version);
+
+  g_assert_cmpstr (doc, ==, expected);
+}
+
+static void
+test_gir_doc_index (GCancellable        *cancellable,
+                    GAsyncReadyCallback  callback,
+                    gpointer             user_data)
+{
+  g_autoptr(GTask) task = NULL;
+  g_autoptr(IdeGirDocIndex) index = NULL;
+  g_autoptr(IdeGirDocIndex) reader = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *tmpdir = NULL;
+  g_autofree gchar *gir_path = NULL;
+  g_autofree gchar *cache_path = NULL;
+  g_autofree gchar *cache_dir = NULL;
+  const gchar *gir_dirs [2] = { NULL };
+
+  task = g_task_new (NULL, cancellable, callback, user_data);
+
+  tmpdir = g_dir_make_tmp ("gb-gir-doc-index-XXXXXX", &error);
+  g_assert_no_error (error);
+
+  gir_path = g_build_filename (tmpdir, "Test-1.0.gir", NULL);
+  cache_dir = g_build_filename (tmpdir, "cache", NULL);
+  cache_path = g_build_filename (cache_dir, "index.gvariant", NULL);
+  gir_dirs [0] = tmpdir;
+
+  g_file_set_contents (gir_path, gir_v1, -1, &error);
+  g_assert_no_error (error);
+
+  index = ide_gir_doc_index_new (cache_path, gir_dirs);
+  update (index);
+
+  assert_doc (index, "TestWidget", "1.0", "A widget & more.");
+  assert_doc (index, "test_widget_frob", "1.0", "Frobs the widget.");
+  assert_doc (index, "test_init", NULL, "Initializes the library.");
+  assert_doc (index, "test_init", "2.0", NULL);
+  assert_doc (index, "count", NULL, NULL);
+  assert_doc (index, "test_missing", NULL, NULL);
+
+  /* Another index sharing the file sees the same documentation */
+  reader = ide_gir_doc_index_new (cache_path, gir_dirs);
+  assert_doc (reader, "test_widget_frob", "1.0", "Frobs the widget.");
+
+  /* Changed files are parsed again */
+  g_file_set_contents (gir_path, gir_v2, -1, &error);
+  g_assert_no_error (error);
+
+  update (index);
+
+  assert_doc (index, "test_init", "1.0", "Initializes the library, again.");
+  assert_doc (index, "test_widget_frob", "1.0", NULL);
+
+  g_unlink (cache_path);
+  g_rmdir (cache_dir);
+  g_unlink (gir_path);
+  g_rmdir (tmpdir);
+
+  g_task_return_boolean (task, TRUE);
+}
+
+gint
+main (gint   argc,
+      gchar *argv[])
+{
+  IdeApplication *app;
+  gint ret;
+
+  g_test_init (&argc, &argv, NULL);
+
+  ide_log_init (TRUE, NULL);
+  ide_log_set_verbosity (4);
+
+  app = ide_application_new ();
+  ide_application_add_test (app, "/Ide/GirDocIndex/update", test_gir_doc_index, NULL);
+  ret = g_application_run (G_APPLICATION (app), argc, argv);
+  g_object_unref (app);
+
+  return ret;
+}
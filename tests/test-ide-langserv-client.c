@@ -0,0 +1,502 @@
+/* test-ide-langserv-client.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define G_LOG_DOMAIN "test-ide-langserv-client"
+
+#include <gio/gunixinputstream.h>
+#include <gio/gunixoutputstream.h>
+#include <glib-unix.h>
+#include <ide.h>
+#include <string.h>
+
+#include "application/ide-application-tests.h"
+
+/*
+ * The client talks to a fake language server over a pair of pipes. The
+ * server records every message it receives and holds back its replies
+ * until the "test/flush" notification, so that the test controls which
+ * requests are in flight while the others queue up.
+ */
+
+#define DOCUMENT_URI "file:///project1/main.c"
+
+typedef struct
+{
+  GTask             *task;
+  IdeContext        *context;
+  IdeLangservClient *client;
+  GCancellable      *queued_cancellable;
+  GCancellable      *sent_cancellable;
+
+  /* The fake server */
+  GDataInputStream  *input;
+  GOutputStream     *output;
+  gsize              content_length;
+  gchar             *body;
+  GPtrArray         *received;
+  GArray            *held_ids;
+  GHashTable        *first_ids;
+  gint64             cancel_request_id;
+  gboolean           replying;
+
+  /* The label and outcome of every call, in the order they completed */
+  GPtrArray         *completed;
+  guint              n_calls;
+} SchedulerState;
+
+typedef struct
+{
+  SchedulerState *state;
+  const gchar    *label;
+} CallData;
+
+static void peer_read_headers (SchedulerState *state);
+
+static void
+scheduler_state_free (SchedulerState *state)
+{
+  g_clear_object (&state->task);
+  g_clear_object (&state->context);
+  g_clear_object (&state->client);
+  g_clear_object (&state->queued_cancellable);
+  g_clear_object (&state->sent_cancellable);
+  g_clear_object (&state->input);
+  g_clear_object (&state->output);
+  g_clear_pointer (&state->body, g_free);
+  g_clear_pointer (&state->received, g_ptr_array_unref);
+  g_clear_pointer (&state->held_ids, g_array_unref);
+  g_clear_pointer (&state->first_ids, g_hash_table_unref);
+  g_clear_pointer (&state->completed, g_ptr_array_unref);
+  g_slice_free (SchedulerState, state);
+}
+
+static void
+peer_reply (SchedulerState *state,
+            gint64          id)
+{
+  g_autofree gchar *body = NULL;
+  g_autofree gchar *message = NULL;
+  g_autoptr(GError) error = NULL;
+  gboolean r;
+
+  body = g_strdup_printf ("{\"jsonrpc\":\"2.0\",\"id\":%"G_GINT64_FORMAT",\"result\":{}}", id);
+  message = g_strdup_printf ("Content-Length: %"G_GSIZE_FORMAT"\r\n\r\n%s", strlen (body), body);
+
+  r = g_output_stream_write_all (state->output, message, strlen (message), NULL, NULL, &error);
+  g_assert_no_error (error);
+  g_assert (r);
+}
+
+static void
+peer_handle_message (SchedulerState *state,
+                     JsonObject     *message)
+{
+  const gchar *method;
+  gint64 id = -1;
+
+  method = json_object_get_string_member (message, "method");
+  g_assert (method != NULL);
+
+  g_ptr_array_add (state->received, g_strdup (method));
+
+  if (json_object_has_member (message, "id"))
+    {
+      id = json_object_get_int_member (message, "id");
+
+      if (!g_hash_table_contains (state->first_ids, method))
+        g_hash_table_insert (state->first_ids, g_strdup (method), g_memdup (&id, sizeof id));
+    }
+
+  if (g_str_equal (method, "$/cancelRequest"))
+    {
+      JsonObject *params = json_object_get_object_member (message, "params");
+
+      state->cancel_request_id = json_object_get_int_member (params, "id");
+    }
+  else if (g_str_equal (method, "test/flush"))
+    {
+      state->replying = TRUE;
+
+      for (guint i = 0; i < state->held_ids->len; i++)
+        peer_reply (state, g_array_index (state->held_ids, gint64, i));
+      g_array_set_size (state->held_ids, 0);
+    }
+
+  if (id < 0)
+    return;
+
+  if (state->replying || g_str_equal (method, "initialize"))
+    peer_reply (state, id);
+  else
+    g_array_append_val (state->held_ids, id);
+}
+
+static void
+peer_read_body_cb (GObject      *object,
+                   GAsyncResult *result,
+                   gpointer      user_data)
+{
+  GInputStream *stream = (GInputStream *)object;
+  SchedulerState *state = user_data;
+  g_autoptr(JsonParser) parser = NULL;
+  g_autoptr(GError) error = NULL;
+  gsize n_read = 0;
+  gboolean r;
+
+  r = g_input_stream_read_all_finish (stream, result, &n_read, &error);
+  g_assert_no_error (error);
+  g_assert (r);
+  g_assert_cmpint (n_read, ==, state->content_length);
+
+  parser = json_parser_new ();
+  r = json_parser_load_from_data (parser, state->body, n_read, &error);
+  g_assert_no_error (error);
+  g_assert (r);
+
+  g_clear_pointer (&state->body, g_free);
+  state->content_length = 0;
+
+  peer_handle_message (state, json_node_get_object (json_parser_get_root (parser)));
+
+  peer_read_headers (state);
+}
+
+static void
+peer_read_line_cb (GObject      *object,
+                   GAsyncResult *result,
+                   gpointer      user_data)
+{
+  GDataInputStream *stream = (GDataInputStream *)object;
+  SchedulerState *state = user_data;
+  g_autofree gchar *line = NULL;
+  g_autoptr(GError) error = NULL;
+
+  line = g_data_input_stream_read_line_finish_utf8 (stream, result, NULL, &error);
+
+  /* The client closed its end once the test completed */
+  if (line == NULL)
+    {
+      scheduler_state_free (state);
+      return;
+    }
+
+  if (g_str_has_prefix (line, "Content-Length: "))
+    state->content_length = g_ascii_strtoull (line + strlen ("Content-Length: "), NULL, 10);
+
+  if (*line != '\0')
+    {
+      peer_read_headers (state);
+      return;
+    }
+
+  g_assert_cmpint (state->content_length, >, 0);
+
+  state->body = g_malloc (state->content_length);
+  g_input_stream_read_all_async (G_INPUT_STREAM (state->input),
+                                 state->body,
+                                 state->content_length,
+                                 G_PRIORITY_DEFAULT,
+                                 NULL,
+                                 peer_read_body_cb,
+                                 state);
+}
+
+static void
+peer_read_headers (SchedulerState *state)
+{
+  g_data_input_stream_read_line_async (state->input,
+                                       G_PRIORITY_DEFAULT,
+                                       NULL,
+                                       peer_read_line_cb,
+                                       state);
+}
+
+static void
+check_results (SchedulerState *state)
+{
+  static const gchar *expected_received[] = {
+    "initialize",
+    "test/background",
+    "test/background",
+    "test/background",
+    "test/background",
+    "test/immediate",
+    "test/immediate",
+    "textDocument/didChange",
+    "test/flush",
+    "$/cancelRequest",
+    /* Queued requests are sent in priority order as replies arrive */
+    "textDocument/documentSymbol",
+    "test/queued",
+  };
+  static const gchar *expected_completed[] = {
+    "symbols1:cancelled",
+    "hover:cancelled",
+    "cancelled:cancelled",
+    "immediate1:cancelled",
+    "background0:ok",
+    "background1:ok",
+    "background2:ok",
+    "background3:ok",
+    "immediate2:ok",
+    "symbols2:ok",
+    "queued:ok",
+  };
+  const gint64 *immediate_id;
+
+  g_assert_cmpint (state->received->len, ==, G_N_ELEMENTS (expected_received));
+  for (guint i = 0; i < G_N_ELEMENTS (expected_received); i++)
+    g_assert_cmpstr (g_ptr_array_index (state->received, i), ==, expected_received [i]);
+
+  g_assert_cmpint (state->completed->len, ==, G_N_ELEMENTS (expected_completed));
+  for (guint i = 0; i < G_N_ELEMENTS (expected_completed); i++)
+    g_assert_cmpstr (g_ptr_array_index (state->completed, i), ==, expected_completed [i]);
+
+  /* Only the request that was in flight is cancelled on the server */
+  immediate_id = g_hash_table_lookup (state->first_ids, "test/immediate");
+  g_assert (immediate_id != NULL);
+  g_assert_cmpint (state->cancel_request_id, ==, *immediate_id);
+
+  ide_langserv_client_stop (state->client);
+  g_task_return_boolean (state->task, TRUE);
+}
+
+static void
+call_cb (GObject      *object,
+         GAsyncResult *result,
+         gpointer      user_data)
+{
+  IdeLangservClient *client = (IdeLangservClient *)object;
+  CallData *data = user_data;
+  SchedulerState *state = data->state;
+  g_autoptr(JsonNode) reply = NULL;
+  g_autoptr(GError) error = NULL;
+  const gchar *outcome;
+
+  if (ide_langserv_client_call_finish (client, result, &reply, &error))
+    outcome = "ok";
+  else if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    outcome = "cancelled";
+  else
+    outcome = error->message;
+
+  g_ptr_array_add (state->completed, g_strdup_printf ("%s:%s", data->label, outcome));
+  g_slice_free (CallData, data);
+
+  if (state->completed->len == state->n_calls)
+    check_results (state);
+}
+
+static CallData *
+call_data_new (SchedulerState *state,
+               const gchar    *label)
+{
+  CallData *data = g_slice_new0 (CallData);
+
+  data->state = state;
+  data->label = label;
+  state->n_calls++;
+
+  return data;
+}
+
+static JsonNode *
+params_new (const gchar *json)
+{
+  g_autoptr(GError) error = NULL;
+  JsonNode *node;
+
+  node = json_from_string (json, &error);
+  g_assert_no_error (error);
+  g_assert (node != NULL);
+
+  return node;
+}
+
+static JsonNode *
+document_params (gboolean with_position)
+{
+  if (with_position)
+    return params_new ("{\"textDocument\":{\"uri\":\"" DOCUMENT_URI "\"},"
+                       "\"position\":{\"line\":0,\"character\":0}}");
+
+  return params_new ("{\"textDocument\":{\"uri\":\"" DOCUMENT_URI "\"}}");
+}
+
+static void
+test_scheduler_cb1 (GObject      *object,
+                    GAsyncResult *result,
+                    gpointer      user_data)
+{
+  static const gchar *background_labels[] = { "background0", "background1", "background2", "background3" };
+  SchedulerState *state = user_data;
+  g_autoptr(GIOStream) io_stream = NULL;
+  g_autoptr(GInputStream) client_input = NULL;
+  g_autoptr(GOutputStream) client_output = NULL;
+  g_autoptr(GInputStream) peer_input = NULL;
+  GError *error = NULL;
+  gint to_peer[2];
+  gint to_client[2];
+
+  state->context = ide_context_new_finish (result, &error);
+  g_assert_no_error (error);
+  g_assert (IDE_IS_CONTEXT (state->context));
+
+  g_unix_open_pipe (to_peer, FD_CLOEXEC, &error);
+  g_assert_no_error (error);
+  g_unix_open_pipe (to_client, FD_CLOEXEC, &error);
+  g_assert_no_error (error);
+
+  client_input = g_unix_input_stream_new (to_client [0], TRUE);
+  client_output = g_unix_output_stream_new (to_peer [1], TRUE);
+  io_stream = g_simple_io_stream_new (client_input, client_output);
+
+  peer_input = g_unix_input_stream_new (to_peer [0], TRUE);
+  state->input = g_data_input_stream_new (peer_input);
+  g_data_input_stream_set_newline_type (state->input, G_DATA_STREAM_NEWLINE_TYPE_CR_LF);
+  state->output = g_unix_output_stream_new (to_client [1], TRUE);
+  peer_read_headers (state);
+
+  state->client = ide_langserv_client_new (state->context, io_stream);
+  ide_langserv_client_start (state->client);
+
+  /* Fill every slot available to non-interactive requests */
+  for (guint i = 0; i < G_N_ELEMENTS (background_labels); i++)
+    ide_langserv_client_call_with_priority_async (state->client,
+                                                  "test/background",
+                                                  params_new ("{}"),
+                                                  IDE_LANGSERV_CALL_PRIORITY_BACKGROUND,
+                                                  NULL,
+                                                  call_cb,
+                                                  call_data_new (state, background_labels [i]));
+
+  /* Queued behind them, but the highlight request is sent first */
+  ide_langserv_client_call_with_priority_async (state->client,
+                                                "test/queued",
+                                                params_new ("{}"),
+                                                IDE_LANGSERV_CALL_PRIORITY_BACKGROUND,
+                                                NULL,
+                                                call_cb,
+                                                call_data_new (state, "queued"));
+
+  /* A newer request for the same method and document supersedes the first */
+  ide_langserv_client_call_with_priority_async (state->client,
+                                                "textDocument/documentSymbol",
+                                                document_params (FALSE),
+                                                IDE_LANGSERV_CALL_PRIORITY_HIGHLIGHT,
+                                                NULL,
+                                                call_cb,
+                                                call_data_new (state, "symbols1"));
+  ide_langserv_client_call_with_priority_async (state->client,
+                                                "textDocument/documentSymbol",
+                                                document_params (FALSE),
+                                                IDE_LANGSERV_CALL_PRIORITY_HIGHLIGHT,
+                                                NULL,
+                                                call_cb,
+                                                call_data_new (state, "symbols2"));
+
+  /* Dropped by the change to the document below */
+  ide_langserv_client_call_with_priority_async (state->client,
+                                                "textDocument/hover",
+                                                document_params (TRUE),
+                                                IDE_LANGSERV_CALL_PRIORITY_BACKGROUND,
+                                                NULL,
+                                                call_cb,
+                                                call_data_new (state, "hover"));
+
+  /* Cancelled before it is ever sent */
+  ide_langserv_client_call_with_priority_async (state->client,
+                                                "test/cancelled",
+                                                params_new ("{}"),
+                                                IDE_LANGSERV_CALL_PRIORITY_BACKGROUND,
+                                                state->queued_cancellable,
+                                                call_cb,
+                                                call_data_new (state, "cancelled"));
+
+  /* The default is sent right away and never superseded */
+  ide_langserv_client_call_async (state->client,
+                                  "test/immediate",
+                                  document_params (TRUE),
+                                  state->sent_cancellable,
+                                  call_cb,
+                                  call_data_new (state, "immediate1"));
+  ide_langserv_client_call_async (state->client,
+                                  "test/immediate",
+                                  document_params (TRUE),
+                                  NULL,
+                                  call_cb,
+                                  call_data_new (state, "immediate2"));
+
+  ide_langserv_client_send_notification_async (state->client,
+                                               "textDocument/didChange",
+                                               params_new ("{\"textDocument\":{\"uri\":\"" DOCUMENT_URI "\","
+                                                           "\"version\":2},\"contentChanges\":[]}"),
+                                               NULL, NULL, NULL);
+
+  g_cancellable_cancel (state->queued_cancellable);
+  g_cancellable_cancel (state->sent_cancellable);
+
+  ide_langserv_client_send_notification_async (state->client,
+                                               "test/flush",
+                                               params_new ("{}"),
+                                               NULL, NULL, NULL);
+}
+
+static void
+test_scheduler (GCancellable        *cancellable,
+                GAsyncReadyCallback  callback,
+                gpointer             user_data)
+{
+  g_autoptr(GFile) project_file = NULL;
+  g_autofree gchar *path = NULL;
+  SchedulerState *state;
+
+  state = g_slice_new0 (SchedulerState);
+  state->task = g_task_new (NULL, cancellable, callback, user_data);
+  state->queued_cancellable = g_cancellable_new ();
+  state->sent_cancellable = g_cancellable_new ();
+  state->received = g_ptr_array_new_with_free_func (g_free);
+  state->held_ids = g_array_new (FALSE, FALSE, sizeof (gint64));
+  state->first_ids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+  state->completed = g_ptr_array_new_with_free_func (g_free);
+  state->cancel_request_id = -1;
+
+  path = g_build_filename (TEST_DATA_DIR, "project1", "configure.ac", NULL);
+  project_file = g_file_new_for_path (path);
+  ide_context_new_async (project_file, cancellable, test_scheduler_cb1, state);
+}
+
+gint
+main (gint   argc,
+      gchar *argv[])
+{
+  IdeApplication *app;
+  gint ret;
+
+  g_test_init (&argc, &argv, NULL);
+
+  ide_log_init (TRUE, NULL);
+  ide_log_set_verbosity (4);
+
+  app = ide_application_new ();
+  ide_application_add_test (app, "/Ide/LangservClient/scheduler", test_scheduler, NULL);
+  ret = g_application_run (G_APPLICATION (app), argc, argv);
+  g_object_unref (app);
+
+  return ret;
+}
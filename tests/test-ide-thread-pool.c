@@ -0,0 +1,199 @@
+/* test-ide-thread-pool.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <ide.h>
+
+#include "application/ide-application-tests.h"
+
+/*
+ * The tests run with the worker process pool, which runs a single item of
+ * each kind at a time. We block the compiler kind with a gate so that the
+ * items we push afterwards are all queued before any of them runs.
+ */
+
+static GMutex   gate_mutex;
+static GCond    gate_cond;
+static gboolean gate_entered;
+static gboolean gate_open;
+static GString *order;
+
+static void
+gate_func (gpointer data)
+{
+  g_mutex_lock (&gate_mutex);
+  gate_entered = TRUE;
+  g_cond_broadcast (&gate_cond);
+  while (!gate_open)
+    g_cond_wait (&gate_cond, &gate_mutex);
+  g_mutex_unlock (&gate_mutex);
+}
+
+static void
+gate_close (void)
+{
+  g_mutex_lock (&gate_mutex);
+  gate_entered = FALSE;
+  gate_open = FALSE;
+  g_mutex_unlock (&gate_mutex);
+
+  ide_thread_pool_push (IDE_THREAD_POOL_COMPILER, gate_func, NULL);
+
+  g_mutex_lock (&gate_mutex);
+  while (!gate_entered)
+    g_cond_wait (&gate_cond, &gate_mutex);
+  g_mutex_unlock (&gate_mutex);
+}
+
+static void
+gate_release (void)
+{
+  g_mutex_lock (&gate_mutex);
+  gate_open = TRUE;
+  g_cond_broadcast (&gate_cond);
+  g_mutex_unlock (&gate_mutex);
+}
+
+static void
+record_func (gpointer data)
+{
+  g_mutex_lock (&gate_mutex);
+  g_string_append_c (order, GPOINTER_TO_INT (data));
+  g_cond_broadcast (&gate_cond);
+  g_mutex_unlock (&gate_mutex);
+}
+
+static void
+test_priority (GCancellable        *cancellable,
+               GAsyncReadyCallback  callback,
+               gpointer             user_data)
+{
+  g_autoptr(GTask) task = NULL;
+
+  task = g_task_new (NULL, cancellable, callback, user_data);
+
+  order = g_string_new (NULL);
+
+  gate_close ();
+
+  ide_thread_pool_push_with_priority (IDE_THREAD_POOL_COMPILER,
+                                      IDE_THREAD_POOL_PRIORITY_BACKGROUND,
+                                      record_func, GINT_TO_POINTER ('b'));
+  ide_thread_pool_push_with_priority (IDE_THREAD_POOL_COMPILER,
+                                      IDE_THREAD_POOL_PRIORITY_VISIBLE,
+                                      record_func, GINT_TO_POINTER ('v'));
+  ide_thread_pool_push_with_priority (IDE_THREAD_POOL_COMPILER,
+                                      IDE_THREAD_POOL_PRIORITY_INTERACTIVE,
+                                      record_func, GINT_TO_POINTER ('i'));
+
+  gate_release ();
+
+  g_mutex_lock (&gate_mutex);
+  while (order->len < 3)
+    g_cond_wait (&gate_cond, &gate_mutex);
+  g_mutex_unlock (&gate_mutex);
+
+  g_assert_cmpstr (order->str, ==, "ivb");
+
+  g_string_free (order, TRUE);
+  order = NULL;
+
+  g_task_return_boolean (task, TRUE);
+}
+
+static void
+cancelled_worker (GTask        *task,
+                  gpointer      source_object,
+                  gpointer      task_data,
+                  GCancellable *cancellable)
+{
+  g_error ("Cancelled task should not run");
+}
+
+static void
+test_cancel_cb (GObject      *object,
+                GAsyncResult *result,
+                gpointer      user_data)
+{
+  g_autoptr(GError) error = NULL;
+  guint *n_completed = user_data;
+  gboolean ret;
+
+  ret = g_task_propagate_boolean (G_TASK (result), &error);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+  g_assert_false (ret);
+
+  (*n_completed)++;
+}
+
+static void
+test_cancel (GCancellable        *cancellable,
+             GAsyncReadyCallback  callback,
+             gpointer             user_data)
+{
+  g_autoptr(GTask) task = NULL;
+  g_autoptr(GTask) queued = NULL;
+  g_autoptr(GTask) precancelled = NULL;
+  g_autoptr(GCancellable) queued_cancellable = NULL;
+  g_autoptr(GCancellable) precancelled_cancellable = NULL;
+  guint n_completed = 0;
+
+  task = g_task_new (NULL, cancellable, callback, user_data);
+
+  gate_close ();
+
+  /* Cancelled while waiting in the queue */
+  queued_cancellable = g_cancellable_new ();
+  queued = g_task_new (NULL, queued_cancellable, test_cancel_cb, &n_completed);
+  ide_thread_pool_push_task (IDE_THREAD_POOL_COMPILER, queued, cancelled_worker);
+  g_cancellable_cancel (queued_cancellable);
+
+  /* Cancelled before it was pushed */
+  precancelled_cancellable = g_cancellable_new ();
+  g_cancellable_cancel (precancelled_cancellable);
+  precancelled = g_task_new (NULL, precancelled_cancellable, test_cancel_cb, &n_completed);
+  ide_thread_pool_push_task (IDE_THREAD_POOL_COMPILER, precancelled, cancelled_worker);
+
+  /* Both complete without the gate being released */
+  while (n_completed < 2)
+    g_main_context_iteration (NULL, TRUE);
+
+  gate_release ();
+
+  g_task_return_boolean (task, TRUE);
+}
+
+gint
+main (gint   argc,
+      gchar *argv[])
+{
+  IdeApplication *app;
+  gint ret;
+
+  g_test_init (&argc, &argv, NULL);
+
+  ide_log_init (TRUE, NULL);
+  ide_log_set_verbosity (4);
+
+  app = ide_application_new ();
+  ide_application_add_test (app, "/Ide/ThreadPool/priority", test_priority, NULL);
+  ide_application_add_test (app, "/Ide/ThreadPool/cancel", test_cancel, NULL);
+  ret = g_application_run (G_APPLICATION (app), argc, argv);
+  g_object_unref (app);
+
+  return ret;
+}
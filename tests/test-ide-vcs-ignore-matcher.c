@@ -0,0 +1,239 @@
+/* test-ide-vcs-ignore-matcher.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <ide.h>
+
+typedef struct
+{
+  const gchar *path;
+  gboolean     is_directory;
+  gboolean     ignored;
+} IgnoreTest;
+
+static void
+check_paths (IdeVcsIgnoreMatcher *matcher,
+             const IgnoreTest    *tests,
+             guint                n_tests)
+{
+  for (guint i = 0; i < n_tests; i++)
+    {
+      gboolean ignored;
+
+      ignored = ide_vcs_ignore_matcher_is_ignored (matcher, tests [i].path, tests [i].is_directory);
+
+      if (ignored != tests [i].ignored)
+        g_error ("%s should%s be ignored", tests [i].path, tests [i].ignored ? "" : " not");
+    }
+}
+
+static void
+test_basic (void)
+{
+  g_autoptr(IdeVcsIgnoreMatcher) matcher = NULL;
+  static const IgnoreTest tests[] = {
+    { "foo.o", FALSE, TRUE },
+    { "src/foo.o", FALSE, TRUE },
+    { "src/foo.c", FALSE, FALSE },
+    { "src/foo.c~", FALSE, TRUE },
+    { "Makefile.in", FALSE, TRUE },
+    { "src/Makefile.in", FALSE, TRUE },
+    { "build", TRUE, TRUE },
+    { "build", FALSE, FALSE },
+    { "build/foo.c", FALSE, TRUE },
+    { "src/build/foo.c", FALSE, TRUE },
+    { "config.h", FALSE, TRUE },
+    { "src/config.h", FALSE, FALSE },
+    { "doc/html", TRUE, TRUE },
+    { "src/doc/html", TRUE, FALSE },
+    { "po/fr.gmo", FALSE, TRUE },
+    { "po/fr.po", FALSE, FALSE },
+    { "important.o", FALSE, FALSE },
+    { "libfoo-1.0.so", FALSE, TRUE },
+    { "# not a comment", FALSE, TRUE },
+    { "trailing", FALSE, TRUE },
+  };
+
+  matcher = ide_vcs_ignore_matcher_new ();
+  ide_vcs_ignore_matcher_add_patterns (matcher, NULL,
+                                       "# comment\n"
+                                       "\n"
+                                       "*.o\n"
+                                       "*~\n"
+                                       "Makefile.in\n"
+                                       "build/\n"
+                                       "/config.h\n"
+                                       "doc/html/\n"
+                                       "po/*.gmo\n"
+                                       "!important.o\n"
+                                       "lib*-[0-9].[0-9].so\n"
+                                       "\\# not a comment\n"
+                                       "trailing   \n");
+
+  check_paths (matcher, tests, G_N_ELEMENTS (tests));
+}
+
+static void
+test_nested (void)
+{
+  g_autoptr(IdeVcsIgnoreMatcher) matcher = NULL;
+  static const IgnoreTest tests[] = {
+    { "a.log", FALSE, TRUE },
+    { "src/a.log", FALSE, FALSE },
+    { "src/sub/a.log", FALSE, FALSE },
+    { "src/generated.c", FALSE, TRUE },
+    { "generated.c", FALSE, FALSE },
+    { "src/sub/generated.c", FALSE, TRUE },
+    { "src/sub/deep/x.tmp", FALSE, TRUE },
+    { "vendor", TRUE, TRUE },
+    { "vendor/keep.c", FALSE, TRUE },
+    { "a/b/c/d.bak", FALSE, TRUE },
+    { "b/x/d.bak", FALSE, FALSE },
+    { "local.txt", FALSE, TRUE },
+    { "src/global.swp", FALSE, TRUE },
+    { "src/global-keep.swp", FALSE, FALSE },
+    { ".git", TRUE, TRUE },
+  };
+
+  matcher = ide_vcs_ignore_matcher_new ();
+  ide_vcs_ignore_matcher_add_patterns (matcher, NULL,
+                                       "*.log\n"
+                                       "vendor/\n"
+                                       "a/**/d.bak\n");
+  ide_vcs_ignore_matcher_add_patterns (matcher, "src",
+                                       "!*.log\n"
+                                       "generated.c\n"
+                                       "sub/deep/*.tmp\n"
+                                       "*-keep.swp\n"
+                                       "!*-keep.swp\n");
+  /* Children of an ignored directory cannot be included again */
+  ide_vcs_ignore_matcher_add_patterns (matcher, "vendor", "!keep.c\n");
+  ide_vcs_ignore_matcher_add_global_patterns (matcher, ".git\n");
+  ide_vcs_ignore_matcher_add_global_patterns (matcher, "local.txt\n*.swp\n");
+
+  check_paths (matcher, tests, G_N_ELEMENTS (tests));
+}
+
+static void
+test_without (void)
+{
+  g_autoptr(IdeVcsIgnoreMatcher) base = NULL;
+  g_autoptr(IdeVcsIgnoreMatcher) matcher = NULL;
+  g_autoptr(IdeVcsIgnoreMatcher) root = NULL;
+  static const IgnoreTest base_tests[] = {
+    { "a.log", FALSE, TRUE },
+    { "src/a.log", FALSE, FALSE },
+    { "src/generated.c", FALSE, TRUE },
+    { "src/sub/x.tmp", FALSE, TRUE },
+    { "srcfoo/y.o", FALSE, TRUE },
+    { "local.txt", FALSE, TRUE },
+  };
+  static const IgnoreTest without_tests[] = {
+    { "a.log", FALSE, TRUE },
+    { "src/a.log", FALSE, TRUE },
+    { "src/generated.c", FALSE, FALSE },
+    { "src/sub/x.tmp", FALSE, FALSE },
+    { "src/sub/x.new", FALSE, TRUE },
+    { "srcfoo/y.o", FALSE, TRUE },
+    { "local.txt", FALSE, TRUE },
+  };
+  static const IgnoreTest root_tests[] = {
+    { "a.log", FALSE, FALSE },
+    { "src/generated.c", FALSE, FALSE },
+    { "srcfoo/y.o", FALSE, FALSE },
+    { "local.txt", FALSE, TRUE },
+  };
+
+  base = ide_vcs_ignore_matcher_new ();
+  ide_vcs_ignore_matcher_add_patterns (base, NULL, "*.log\n");
+  ide_vcs_ignore_matcher_add_patterns (base, "src", "!*.log\ngenerated.c\n");
+  ide_vcs_ignore_matcher_add_patterns (base, "src/sub", "*.tmp\n");
+  ide_vcs_ignore_matcher_add_patterns (base, "srcfoo", "*.o\n");
+  ide_vcs_ignore_matcher_add_global_patterns (base, "local.txt\n");
+
+  /* Only the subtree of "src" is dropped, not the sibling "srcfoo" */
+  matcher = ide_vcs_ignore_matcher_new_without (base, "src/");
+  ide_vcs_ignore_matcher_add_patterns (matcher, "src/sub", "*.new\n");
+
+  /* Adding patterns to a directory shared with @base must not modify @base */
+  ide_vcs_ignore_matcher_add_patterns (matcher, "srcfoo", "*.p\n");
+  g_assert (ide_vcs_ignore_matcher_is_ignored (matcher, "srcfoo/z.p", FALSE));
+  g_assert (!ide_vcs_ignore_matcher_is_ignored (base, "srcfoo/z.p", FALSE));
+
+  check_paths (base, base_tests, G_N_ELEMENTS (base_tests));
+  check_paths (matcher, without_tests, G_N_ELEMENTS (without_tests));
+
+  root = ide_vcs_ignore_matcher_new_without (base, NULL);
+  check_paths (root, root_tests, G_N_ELEMENTS (root_tests));
+}
+
+static void
+test_perf (void)
+{
+  g_autoptr(IdeVcsIgnoreMatcher) matcher = NULL;
+  g_autoptr(GPtrArray) paths = NULL;
+  static const gchar *extensions[] = { ".c", ".h", ".o", ".lo", ".c~", ".ui", ".png", ".txt" };
+  gdouble elapsed;
+  gint64 begin;
+  guint ignored = 0;
+
+  /* 100 directories with 10 subdirectories of 100 files each */
+  paths = g_ptr_array_new_with_free_func (g_free);
+  for (guint i = 0; i < 100; i++)
+    for (guint j = 0; j < 10; j++)
+      for (guint k = 0; k < 100; k++)
+        g_ptr_array_add (paths,
+                         g_strdup_printf ("%s%u/sub%u/file%u%s",
+                                          (i % 10 == 0) ? "build-" : "dir",
+                                          i, j, k,
+                                          extensions [k % G_N_ELEMENTS (extensions)]));
+
+  matcher = ide_vcs_ignore_matcher_new ();
+  ide_vcs_ignore_matcher_add_global_patterns (matcher, ".git\n");
+  ide_vcs_ignore_matcher_add_patterns (matcher, NULL,
+                                       "*.o\n*.lo\n*.la\n*~\n*.swp\n.deps/\n.libs/\n"
+                                       "Makefile\nMakefile.in\nconfig.h\nconfig.log\n"
+                                       "/build-*/\n/_build/\n*.gmo\n*.pyc\n"
+                                       "doc/reference/html/\n**/tmp-*.xml\n"
+                                       "*.[ao]\n!dir1/sub1/file1.o\n");
+  for (guint i = 0; i < 100; i += 7)
+    {
+      g_autofree gchar *dir = g_strdup_printf ("dir%u", i);
+      ide_vcs_ignore_matcher_add_patterns (matcher, dir, "*.txt\n!sub0/*.txt\n");
+    }
+
+  begin = g_get_monotonic_time ();
+  for (guint i = 0; i < paths->len; i++)
+    ignored += ide_vcs_ignore_matcher_is_ignored (matcher, g_ptr_array_index (paths, i), FALSE);
+  elapsed = (g_get_monotonic_time () - begin) / (gdouble)G_USEC_PER_SEC;
+
+  g_test_minimized_result (elapsed, "Checked %u paths in %lf seconds (%u ignored)",
+                           paths->len, elapsed, ignored);
+}
+
+gint
+main (gint   argc,
+      gchar *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+  g_test_add_func ("/Ide/VcsIgnoreMatcher/basic", test_basic);
+  g_test_add_func ("/Ide/VcsIgnoreMatcher/nested", test_nested);
+  g_test_add_func ("/Ide/VcsIgnoreMatcher/without", test_without);
+  if (g_test_perf ())
+    g_test_add_func ("/Ide/VcsIgnoreMatcher/perf", test_perf);
+  return g_test_run ();
+}
@@ -0,0 +1,383 @@
+/* test-jsonrpc-client.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <sys/socket.h>
+
+#include "jcon.h"
+#include "jsonrpc-client.h"
+#include "jsonrpc-server.h"
+
+/*
+ * A JsonrpcClient talks to a JsonrpcServer over a socket pair. The server
+ * echoes the params of every call back as the result, and counts which
+ * signals delivered the messages so that we can tell whether they were
+ * converted between JSON and GVariant on the way.
+ */
+
+typedef struct
+{
+  GMainContext  *main_context;
+  JsonrpcServer *server;
+  JsonrpcClient *client;
+
+  /* The client created by the server for our connection */
+  JsonrpcClient *peer;
+
+  /* If the server handles messages in the GVariant signals */
+  gboolean       handle_variant;
+
+  guint          n_calls;
+  guint          n_variant_calls;
+  guint          n_notifications;
+  guint          n_variant_notifications;
+  guint          n_client_variant_notifications;
+
+  gboolean       done;
+  JsonNode      *result;
+  GVariant      *variant_result;
+} State;
+
+static GIOStream *
+create_io_stream (gint fd)
+{
+  g_autoptr(GSocket) socket = NULL;
+  g_autoptr(GError) error = NULL;
+
+  socket = g_socket_new_from_fd (fd, &error);
+  g_assert_no_error (error);
+
+  return G_IO_STREAM (g_socket_connection_factory_create_connection (socket));
+}
+
+static void
+record_peer (State         *state,
+             JsonrpcClient *client)
+{
+  if (state->peer == NULL)
+    state->peer = g_object_ref (client);
+  g_assert (state->peer == client);
+}
+
+static gboolean
+server_handle_call (JsonrpcServer *server,
+                    JsonrpcClient *client,
+                    const gchar   *method,
+                    JsonNode      *id,
+                    JsonNode      *params,
+                    State         *state)
+{
+  record_peer (state, client);
+
+  if (g_strcmp0 (method, "echo") != 0)
+    return FALSE;
+
+  state->n_calls++;
+  jsonrpc_client_reply_async (client, json_node_copy (id), json_node_copy (params), NULL, NULL, NULL);
+
+  return TRUE;
+}
+
+static gboolean
+server_handle_call_variant (JsonrpcServer *server,
+                            JsonrpcClient *client,
+                            const gchar   *method,
+                            GVariant      *id,
+                            GVariant      *params,
+                            State         *state)
+{
+  record_peer (state, client);
+
+  if (!state->handle_variant || g_strcmp0 (method, "echo") != 0)
+    return FALSE;
+
+  state->n_variant_calls++;
+  jsonrpc_client_reply_variant_async (client, id, params, NULL, NULL, NULL);
+
+  return TRUE;
+}
+
+static void
+server_notification (JsonrpcServer *server,
+                     JsonrpcClient *client,
+                     const gchar   *method,
+                     JsonNode      *params,
+                     State         *state)
+{
+  state->n_notifications++;
+  state->done = TRUE;
+}
+
+static gboolean
+server_notification_variant (JsonrpcServer *server,
+                             JsonrpcClient *client,
+                             const gchar   *method,
+                             GVariant      *params,
+                             State         *state)
+{
+  if (!state->handle_variant)
+    return FALSE;
+
+  state->n_variant_notifications++;
+  state->done = TRUE;
+
+  return TRUE;
+}
+
+static gboolean
+client_notification_variant (JsonrpcClient *client,
+                             const gchar   *method,
+                             GVariant      *params,
+                             State         *state)
+{
+  state->n_client_variant_notifications++;
+  state->done = TRUE;
+
+  return TRUE;
+}
+
+static void
+state_init (State    *state,
+            gboolean  server_use_gvariant,
+            gboolean  client_use_gvariant,
+            gboolean  handle_variant)
+{
+  g_autoptr(GIOStream) server_stream = NULL;
+  g_autoptr(GIOStream) client_stream = NULL;
+  gint fds[2];
+  gint r;
+
+  memset (state, 0, sizeof *state);
+
+  state->handle_variant = handle_variant;
+  state->main_context = g_main_context_new ();
+  g_main_context_push_thread_default (state->main_context);
+
+  r = socketpair (AF_UNIX, SOCK_STREAM, 0, fds);
+  g_assert_cmpint (r, ==, 0);
+
+  server_stream = create_io_stream (fds[0]);
+  client_stream = create_io_stream (fds[1]);
+
+  state->server = jsonrpc_server_new ();
+  jsonrpc_server_set_use_gvariant (state->server, server_use_gvariant);
+  g_signal_connect (state->server, "handle-call", G_CALLBACK (server_handle_call), state);
+  g_signal_connect (state->server, "handle-call-variant", G_CALLBACK (server_handle_call_variant), state);
+  g_signal_connect (state->server, "notification", G_CALLBACK (server_notification), state);
+  g_signal_connect (state->server, "notification-variant", G_CALLBACK (server_notification_variant), state);
+  jsonrpc_server_accept_io_stream (state->server, server_stream);
+
+  state->client = jsonrpc_client_new (client_stream);
+  jsonrpc_client_set_use_gvariant (state->client, client_use_gvariant);
+  g_signal_connect (state->client, "notification-variant", G_CALLBACK (client_notification_variant), state);
+}
+
+static void
+state_clear (State *state)
+{
+  if (state->peer != NULL)
+    jsonrpc_client_close (state->peer, NULL, NULL);
+  jsonrpc_client_close (state->client, NULL, NULL);
+
+  /* Let the cancelled read loops release their references */
+  while (g_main_context_iteration (state->main_context, FALSE)) { }
+
+  g_clear_object (&state->peer);
+  g_clear_object (&state->client);
+  g_clear_object (&state->server);
+  g_clear_pointer (&state->result, json_node_unref);
+  g_clear_pointer (&state->variant_result, g_variant_unref);
+
+  g_main_context_pop_thread_default (state->main_context);
+  g_clear_pointer (&state->main_context, g_main_context_unref);
+}
+
+static void
+state_run (State *state)
+{
+  while (!state->done)
+    g_main_context_iteration (state->main_context, TRUE);
+  state->done = FALSE;
+}
+
+static void
+call_cb (GObject      *object,
+         GAsyncResult *result,
+         gpointer      user_data)
+{
+  State *state = user_data;
+  g_autoptr(GError) error = NULL;
+  gboolean r;
+
+  g_clear_pointer (&state->result, json_node_unref);
+  r = jsonrpc_client_call_finish (JSONRPC_CLIENT (object), result, &state->result, &error);
+  g_assert_no_error (error);
+  g_assert_true (r);
+
+  state->done = TRUE;
+}
+
+static void
+call_variant_cb (GObject      *object,
+                 GAsyncResult *result,
+                 gpointer      user_data)
+{
+  State *state = user_data;
+  g_autoptr(GError) error = NULL;
+  gboolean r;
+
+  g_clear_pointer (&state->variant_result, g_variant_unref);
+  r = jsonrpc_client_call_variant_finish (JSONRPC_CLIENT (object), result, &state->variant_result, &error);
+  g_assert_no_error (error);
+  g_assert_true (r);
+
+  state->done = TRUE;
+}
+
+static void
+call_json (State *state)
+{
+  const gchar *text = NULL;
+  gboolean r;
+
+  jsonrpc_client_call_async (state->client,
+                             "echo",
+                             JCON_NEW ("text", "hello"),
+                             NULL,
+                             call_cb,
+                             state);
+  state_run (state);
+
+  r = JCON_EXTRACT (state->result, "text", JCONE_STRING (text));
+  g_assert_true (r);
+  g_assert_cmpstr (text, ==, "hello");
+}
+
+/*
+ * Tuples have no JSON equivalent and come back as "av" if the message
+ * was converted to JSON on the way, so the type of the result tells us
+ * which encoding was used.
+ */
+static const gchar *
+call_variant (State *state)
+{
+  const gchar *str = NULL;
+  guint32 num = 0;
+
+  jsonrpc_client_call_variant_async (state->client,
+                                     "echo",
+                                     g_variant_new ("(su)", "hello", 42),
+                                     NULL,
+                                     call_variant_cb,
+                                     state);
+  state_run (state);
+
+  if (g_variant_is_of_type (state->variant_result, G_VARIANT_TYPE ("(su)")))
+    {
+      g_variant_get (state->variant_result, "(&su)", &str, &num);
+      g_assert_cmpstr (str, ==, "hello");
+      g_assert_cmpint (num, ==, 42);
+    }
+
+  return g_variant_get_type_string (state->variant_result);
+}
+
+static void
+test_client_json (void)
+{
+  State state;
+
+  state_init (&state, FALSE, FALSE, TRUE);
+
+  call_json (&state);
+  g_assert_cmpint (state.n_calls, ==, 1);
+  g_assert_cmpint (state.n_variant_calls, ==, 0);
+
+  g_assert_cmpstr (call_variant (&state), ==, "av");
+  g_assert_cmpint (state.n_calls, ==, 2);
+  g_assert_cmpint (state.n_variant_calls, ==, 0);
+
+  jsonrpc_client_send_notification_async (state.client, "note", JCON_NEW ("a", "b"), NULL, NULL, NULL);
+  state_run (&state);
+  g_assert_cmpint (state.n_notifications, ==, 1);
+  g_assert_cmpint (state.n_variant_notifications, ==, 0);
+
+  g_assert_false (jsonrpc_client_get_use_gvariant (state.client));
+  g_assert_false (jsonrpc_client_get_use_gvariant (state.peer));
+
+  state_clear (&state);
+}
+
+static void
+test_client_gvariant (void)
+{
+  State state;
+
+  state_init (&state, TRUE, TRUE, TRUE);
+
+  /* Neither side converts the message to JSON */
+  g_assert_cmpstr (call_variant (&state), ==, "(su)");
+  g_assert_cmpint (state.n_calls, ==, 0);
+  g_assert_cmpint (state.n_variant_calls, ==, 1);
+
+  /* JsonNode callers still work, converting only at the API boundary */
+  call_json (&state);
+  g_assert_cmpint (state.n_calls, ==, 0);
+  g_assert_cmpint (state.n_variant_calls, ==, 2);
+
+  jsonrpc_client_send_notification_variant_async (state.client, "note", g_variant_new ("(u)", 1), NULL, NULL, NULL);
+  state_run (&state);
+  g_assert_cmpint (state.n_notifications, ==, 0);
+  g_assert_cmpint (state.n_variant_notifications, ==, 1);
+
+  state_clear (&state);
+}
+
+static void
+test_client_auto_switch (void)
+{
+  State state;
+
+  /* Only the client asks for GVariant and the server only handles JSON */
+  state_init (&state, FALSE, TRUE, FALSE);
+
+  g_assert_cmpstr (call_variant (&state), ==, "av");
+  g_assert_cmpint (state.n_calls, ==, 1);
+  g_assert_cmpint (state.n_variant_calls, ==, 0);
+
+  /* The server side switched to GVariant after reading our message */
+  g_assert_true (jsonrpc_client_get_use_gvariant (state.peer));
+
+  /* So its JsonNode notifications now reach us as GVariant */
+  jsonrpc_client_send_notification_async (state.peer, "note", JCON_NEW ("a", "b"), NULL, NULL, NULL);
+  state_run (&state);
+  g_assert_cmpint (state.n_client_variant_notifications, ==, 1);
+
+  state_clear (&state);
+}
+
+gint
+main (gint argc,
+      gchar *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+  g_test_add_func ("/Jsonrpc/Client/json", test_client_json);
+  g_test_add_func ("/Jsonrpc/Client/gvariant", test_client_gvariant);
+  g_test_add_func ("/Jsonrpc/Client/auto_switch", test_client_auto_switch);
+  return g_test_run ();
+}
@@ -0,0 +1,174 @@
+/* test-jsonrpc-gvariant.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "jcon.h"
+#include "jsonrpc-input-stream.h"
+#include "jsonrpc-output-stream.h"
+
+/* Larger than the input buffer, so part of the body is read directly */
+#define BLOB_SIZE (4096 * 16)
+
+static GVariant *
+create_message (const gchar *method,
+                const gchar *blob)
+{
+  GVariantDict params;
+  GVariantDict dict;
+
+  g_variant_dict_init (&params, NULL);
+  g_variant_dict_insert (&params, "blob", "s", blob);
+
+  g_variant_dict_init (&dict, NULL);
+  g_variant_dict_insert (&dict, "jsonrpc", "s", "2.0");
+  g_variant_dict_insert (&dict, "method", "s", method);
+  g_variant_dict_insert_value (&dict, "params", g_variant_dict_end (&params));
+
+  return g_variant_ref_sink (g_variant_dict_end (&dict));
+}
+
+static GBytes *
+write_messages (GVariant *first,
+                GVariant *third)
+{
+  g_autoptr(GOutputStream) base = NULL;
+  g_autoptr(JsonrpcOutputStream) stream = NULL;
+  g_autoptr(JsonNode) second = NULL;
+  g_autoptr(GError) error = NULL;
+  gboolean r;
+
+  base = g_memory_output_stream_new_resizable ();
+  stream = jsonrpc_output_stream_new (base);
+
+  /* A GVariant message framed without conversion */
+  jsonrpc_output_stream_set_use_gvariant (stream, TRUE);
+  r = jsonrpc_output_stream_write_variant (stream, first, NULL, &error);
+  g_assert_no_error (error);
+  g_assert_true (r);
+
+  /* A JsonNode message converted to GVariant */
+  second = JCON_NEW ("jsonrpc", "2.0", "method", "second");
+  r = jsonrpc_output_stream_write_message (stream, second, NULL, &error);
+  g_assert_no_error (error);
+  g_assert_true (r);
+
+  /* A GVariant message converted to JSON text */
+  jsonrpc_output_stream_set_use_gvariant (stream, FALSE);
+  r = jsonrpc_output_stream_write_variant (stream, third, NULL, &error);
+  g_assert_no_error (error);
+  g_assert_true (r);
+
+  r = g_output_stream_close (G_OUTPUT_STREAM (stream), NULL, &error);
+  g_assert_no_error (error);
+  g_assert_true (r);
+
+  return g_memory_output_stream_steal_as_bytes (G_MEMORY_OUTPUT_STREAM (base));
+}
+
+static void
+test_framing (void)
+{
+  g_autoptr(GVariant) first = NULL;
+  g_autoptr(GVariant) third = NULL;
+  g_autoptr(GVariant) message = NULL;
+  g_autoptr(GInputStream) base = NULL;
+  g_autoptr(JsonrpcInputStream) stream = NULL;
+  g_autoptr(JsonNode) node = NULL;
+  g_autoptr(GBytes) bytes = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *blob = NULL;
+  const gchar *method = NULL;
+  const gchar *data;
+  gsize len;
+  gboolean r;
+
+  blob = g_malloc (BLOB_SIZE + 1);
+  memset (blob, 'x', BLOB_SIZE);
+  blob [BLOB_SIZE] = '\0';
+
+  first = create_message ("first", blob);
+  third = create_message ("third", "abc");
+  bytes = write_messages (first, third);
+
+  data = g_bytes_get_data (bytes, &len);
+  g_assert_true (g_str_has_prefix (data, "Content-Length: "));
+  g_assert_nonnull (g_strstr_len (data, 256, "\r\nContent-Type: application/gvariant\r\n\r\n"));
+
+  base = g_memory_input_stream_new_from_bytes (bytes);
+  stream = jsonrpc_input_stream_new (base);
+
+  g_assert_false (jsonrpc_input_stream_get_has_seen_gvariant (stream));
+
+  r = jsonrpc_input_stream_read_variant (stream, NULL, &message, &error);
+  g_assert_no_error (error);
+  g_assert_true (r);
+  g_assert_true (g_variant_equal (message, first));
+  g_assert_true (jsonrpc_input_stream_get_has_seen_gvariant (stream));
+  g_clear_pointer (&message, g_variant_unref);
+
+  r = jsonrpc_input_stream_read_message (stream, NULL, &node, &error);
+  g_assert_no_error (error);
+  g_assert_true (r);
+  r = JCON_EXTRACT (node, "method", JCONE_STRING (method));
+  g_assert_true (r);
+  g_assert_cmpstr (method, ==, "second");
+
+  r = jsonrpc_input_stream_read_variant (stream, NULL, &message, &error);
+  g_assert_no_error (error);
+  g_assert_true (r);
+  g_assert_true (g_variant_is_of_type (message, G_VARIANT_TYPE_VARDICT));
+  r = g_variant_lookup (message, "method", "&s", &method);
+  g_assert_true (r);
+  g_assert_cmpstr (method, ==, "third");
+  g_clear_pointer (&message, g_variant_unref);
+
+  r = jsonrpc_input_stream_read_variant (stream, NULL, &message, &error);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CLOSED);
+  g_assert_false (r);
+  g_assert_null (message);
+}
+
+static void
+test_invalid_variant (void)
+{
+  g_autoptr(GOutputStream) base = NULL;
+  g_autoptr(JsonrpcOutputStream) stream = NULL;
+  g_autoptr(GVariant) message = NULL;
+  g_autoptr(GError) error = NULL;
+  gboolean r;
+
+  base = g_memory_output_stream_new_resizable ();
+  stream = jsonrpc_output_stream_new (base);
+  jsonrpc_output_stream_set_use_gvariant (stream, TRUE);
+
+  message = g_variant_ref_sink (g_variant_new_string ("not a message"));
+  r = jsonrpc_output_stream_write_variant (stream, message, NULL, &error);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_INVAL);
+  g_assert_false (r);
+}
+
+gint
+main (gint argc,
+      gchar *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+  g_test_add_func ("/Jsonrpc/GVariant/framing", test_framing);
+  g_test_add_func ("/Jsonrpc/GVariant/invalid", test_invalid_variant);
+  return g_test_run ();
+}
@@ -0,0 +1,424 @@
+/* test-static-dict.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <static-dict.h>
+#include <trie.h>
+
+/*
+ * Tests for StaticDict.
+ *
+ * Running with -m perf also runs a microbenchmark comparing it with a
+ * frozen Trie:
+ *
+ *   test-static-dict -m perf [FILENAME]
+ *
+ * FILENAME should contain one key per line, such as /usr/share/dict/words.
+ * Without it, a synthetic set of identifier-like keys is generated.
+ *
+ * The trie has to be built when the program starts, while the data of a
+ * StaticDict is generated at build time. Here it is packed from the same
+ * keys at runtime, and that time is reported separately.
+ */
+
+static const gchar *perf_filename;
+
+#define N_SYNTHETIC 200000
+#define N_ROUNDS    5
+#define SECTION     "words"
+
+/* Records as static-dict.awk and sort(1) would generate them */
+static const gchar html_data[] =
+  "attributes\tclass\0"
+  "attributes\tid\0"
+  "attributes\tidentity\0"
+  "attributes\tstyle\0"
+  "attributes:a\thref\0"
+  "attributes:a\threflang\0"
+  "elements\ta\0"
+  "elements\tabbr\0"
+  "elements\tdiv\0";
+
+static const gchar *prefixes[] = { "g", "gtk_w", "ide_buffer_", "egg_", "a", "th" };
+
+static GPtrArray *
+load_keys (const gchar *filename,
+           guint        n_synthetic)
+{
+  GPtrArray *keys = g_ptr_array_new_with_free_func (g_free);
+
+  if (filename != NULL)
+    {
+      g_autofree gchar *contents = NULL;
+      g_auto(GStrv) lines = NULL;
+
+      if (!g_file_get_contents (filename, &contents, NULL, NULL))
+        g_error ("Failed to load %s", filename);
+
+      lines = g_strsplit (contents, "\n", -1);
+
+      for (guint i = 0; lines [i]; i++)
+        {
+          if (*lines [i])
+            g_ptr_array_add (keys, g_strdup (lines [i]));
+        }
+    }
+  else
+    {
+      static const gchar *starts[] = { "gtk_", "g_", "ide_", "egg_", "pnl_", "gdk_" };
+      static const gchar *words[] = { "widget", "buffer", "get", "set", "new", "free",
+                                      "context", "source", "view", "iter", "text", "file" };
+      GRand *rand = g_rand_new_with_seed (0);
+
+      for (guint i = 0; i < n_synthetic; i++)
+        {
+          GString *str = g_string_new (starts [g_rand_int_range (rand, 0, G_N_ELEMENTS (starts))]);
+          guint n = g_rand_int_range (rand, 1, 4);
+
+          for (guint j = 0; j < n; j++)
+            g_string_append_printf (str, "%s_", words [g_rand_int_range (rand, 0, G_N_ELEMENTS (words))]);
+          g_string_append_printf (str, "%u", i);
+
+          g_ptr_array_add (keys, g_string_free (str, FALSE));
+        }
+
+      g_rand_free (rand);
+    }
+
+  return keys;
+}
+
+static gint
+compare_keys (gconstpointer a,
+              gconstpointer b)
+{
+  return strcmp (*(const gchar * const *)a, *(const gchar * const *)b);
+}
+
+/*
+ * Does what static-dict.awk and sort(1) do at build time.
+ */
+static GString *
+pack_keys (GPtrArray *keys)
+{
+  g_autoptr(GPtrArray) sorted = g_ptr_array_sized_new (keys->len);
+  GString *str = g_string_new (NULL);
+
+  for (guint i = 0; i < keys->len; i++)
+    g_ptr_array_add (sorted, g_ptr_array_index (keys, i));
+
+  g_ptr_array_sort (sorted, compare_keys);
+
+  for (guint i = 0; i < sorted->len; i++)
+    {
+      const gchar *key = g_ptr_array_index (sorted, i);
+
+      if (i > 0 && g_str_equal (key, g_ptr_array_index (sorted, i - 1)))
+        continue;
+
+      g_string_append (str, SECTION "\t");
+      g_string_append (str, key);
+      g_string_append_c (str, '\0');
+    }
+
+  return str;
+}
+
+static gchar *
+collect_words (const StaticDict *dict,
+               const gchar      *section,
+               const gchar      *prefix)
+{
+  GString *str = g_string_new (NULL);
+  StaticDictIter iter;
+  const gchar *word;
+
+  static_dict_iter_init (&iter, dict, section, prefix);
+
+  while (static_dict_iter_next (&iter, &word))
+    {
+      if (str->len > 0)
+        g_string_append_c (str, ' ');
+      g_string_append (str, word);
+    }
+
+  return g_string_free (str, FALSE);
+}
+
+static void
+test_static_dict_contains (void)
+{
+  static const StaticDict dict = STATIC_DICT_INIT (html_data);
+
+  g_assert_true (static_dict_contains (&dict, "attributes", "class"));
+  g_assert_true (static_dict_contains (&dict, "attributes", "id"));
+  g_assert_true (static_dict_contains (&dict, "attributes", "identity"));
+  g_assert_true (static_dict_contains (&dict, "attributes:a", "href"));
+  g_assert_true (static_dict_contains (&dict, "elements", "a"));
+  g_assert_true (static_dict_contains (&dict, "elements", "div"));
+
+  /* Prefixes of words are not words */
+  g_assert_false (static_dict_contains (&dict, "attributes", "ide"));
+  g_assert_false (static_dict_contains (&dict, "elements", "ab"));
+  g_assert_false (static_dict_contains (&dict, "elements", ""));
+
+  /* Words do not leak into the neighbouring sections */
+  g_assert_false (static_dict_contains (&dict, "attributes", "href"));
+  g_assert_false (static_dict_contains (&dict, "attributes:a", "class"));
+  g_assert_false (static_dict_contains (&dict, "attributes:a", "a"));
+  g_assert_false (static_dict_contains (&dict, "elements", "style"));
+
+  /* Missing sections, including prefixes of existing ones */
+  g_assert_false (static_dict_contains (&dict, "attribute", "class"));
+  g_assert_false (static_dict_contains (&dict, "attributes:", "href"));
+  g_assert_false (static_dict_contains (&dict, "links", "a"));
+  g_assert_false (static_dict_contains (&dict, "", "a"));
+
+  /* Keys sorting after the last record */
+  g_assert_false (static_dict_contains (&dict, "elements", "zzz"));
+  g_assert_false (static_dict_contains (&dict, "zzz", "a"));
+}
+
+static void
+test_static_dict_iter (void)
+{
+  static const StaticDict dict = STATIC_DICT_INIT (html_data);
+  static const struct {
+    const gchar *section;
+    const gchar *prefix;
+    const gchar *expected;
+  } tests[] = {
+    { "attributes", "", "class id identity style" },
+    { "attributes", "id", "id identity" },
+    { "attributes", "identity", "identity" },
+    { "attributes", "h", "" },
+    { "attributes:a", "", "href hreflang" },
+    { "attributes:a", "hreflang", "hreflang" },
+    { "elements", "", "a abbr div" },
+    { "elements", "a", "a abbr" },
+    { "elements", "z", "" },
+    { "attribute", "", "" },
+    { "attributes:", "", "" },
+    { "links", "", "" },
+    { "", "", "" },
+  };
+
+  for (guint i = 0; i < G_N_ELEMENTS (tests); i++)
+    {
+      g_autofree gchar *words = NULL;
+
+      words = collect_words (&dict, tests [i].section, tests [i].prefix);
+      g_assert_cmpstr (words, ==, tests [i].expected);
+    }
+}
+
+static void
+test_static_dict_empty (void)
+{
+  static const StaticDict dict = STATIC_DICT_INIT ("");
+  g_autofree gchar *words = NULL;
+
+  g_assert_false (static_dict_contains (&dict, "elements", "a"));
+
+  words = collect_words (&dict, "elements", "");
+  g_assert_cmpstr (words, ==, "");
+}
+
+static gboolean
+count_cb (Trie        *trie,
+          const gchar *key,
+          gpointer     value,
+          gpointer     user_data)
+{
+  guint *count = user_data;
+  (*count)++;
+  return FALSE;
+}
+
+static void
+test_static_dict_trie (void)
+{
+  g_autoptr(GPtrArray) keys = NULL;
+  StaticDict dict;
+  GString *data;
+  Trie *trie;
+
+  keys = load_keys (NULL, 5000);
+  data = pack_keys (keys);
+  dict.data = data->str;
+  dict.len = data->len;
+
+  trie = trie_new (NULL);
+  for (guint i = 0; i < keys->len; i++)
+    trie_insert (trie, g_ptr_array_index (keys, i), g_ptr_array_index (keys, i));
+  trie_freeze (trie);
+
+  for (guint i = 0; i < keys->len; i++)
+    g_assert_true (static_dict_contains (&dict, SECTION, g_ptr_array_index (keys, i)));
+
+  for (guint i = 0; i < G_N_ELEMENTS (prefixes); i++)
+    {
+      StaticDictIter iter;
+      const gchar *word;
+      guint trie_visited = 0;
+      guint dict_visited = 0;
+
+      trie_traverse (trie, prefixes [i], G_PRE_ORDER, G_TRAVERSE_LEAVES, -1, count_cb, &trie_visited);
+
+      static_dict_iter_init (&iter, &dict, SECTION, prefixes [i]);
+      while (static_dict_iter_next (&iter, &word))
+        {
+          g_assert_true (g_str_has_prefix (word, prefixes [i]));
+          dict_visited++;
+        }
+
+      g_assert_cmpint (trie_visited, ==, dict_visited);
+    }
+
+  trie_destroy (trie);
+  g_string_free (data, TRUE);
+}
+
+static gdouble
+msec_since (gint64 begin)
+{
+  return (g_get_monotonic_time () - begin) / 1000.0;
+}
+
+static guint
+run_trie (GPtrArray *keys)
+{
+  Trie *trie;
+  gint64 begin;
+  guint found = 0;
+  guint visited = 0;
+
+  begin = g_get_monotonic_time ();
+  trie = trie_new (NULL);
+  for (guint i = 0; i < keys->len; i++)
+    trie_insert (trie, g_ptr_array_index (keys, i), g_ptr_array_index (keys, i));
+  trie_freeze (trie);
+  g_print ("  startup:  %8.3lf msec\n", msec_since (begin));
+
+  begin = g_get_monotonic_time ();
+  for (guint i = 0; i < keys->len; i++)
+    {
+      const gchar *key = g_ptr_array_index (keys, i);
+
+      if (trie_lookup (trie, key) != NULL)
+        found++;
+    }
+  g_print ("  lookup:   %8.3lf msec\n", msec_since (begin));
+  g_assert_cmpint (found, ==, keys->len);
+
+  begin = g_get_monotonic_time ();
+  for (guint i = 0; i < G_N_ELEMENTS (prefixes); i++)
+    trie_traverse (trie, prefixes [i], G_PRE_ORDER, G_TRAVERSE_LEAVES, -1, count_cb, &visited);
+  g_print ("  prefix:   %8.3lf msec (%u keys)\n", msec_since (begin), visited);
+
+  trie_destroy (trie);
+
+  return visited;
+}
+
+static guint
+run_static_dict (GPtrArray *keys)
+{
+  StaticDict dict;
+  GString *data;
+  gint64 begin;
+  guint found = 0;
+  guint visited = 0;
+
+  begin = g_get_monotonic_time ();
+  data = pack_keys (keys);
+  g_print ("  pack:     %8.3lf msec (%"G_GSIZE_FORMAT" bytes, at build time)\n",
+           msec_since (begin), data->len);
+
+  dict.data = data->str;
+  dict.len = data->len;
+
+  begin = g_get_monotonic_time ();
+  for (guint i = 0; i < keys->len; i++)
+    {
+      if (static_dict_contains (&dict, SECTION, g_ptr_array_index (keys, i)))
+        found++;
+    }
+  g_print ("  lookup:   %8.3lf msec\n", msec_since (begin));
+  g_assert_cmpint (found, ==, keys->len);
+
+  begin = g_get_monotonic_time ();
+  for (guint i = 0; i < G_N_ELEMENTS (prefixes); i++)
+    {
+      StaticDictIter iter;
+      const gchar *word;
+
+      static_dict_iter_init (&iter, &dict, SECTION, prefixes [i]);
+      while (static_dict_iter_next (&iter, &word))
+        visited++;
+    }
+  g_print ("  prefix:   %8.3lf msec (%u keys)\n", msec_since (begin), visited);
+
+  g_assert_false (static_dict_contains (&dict, SECTION "x", g_ptr_array_index (keys, 0)));
+
+  g_string_free (data, TRUE);
+
+  return visited;
+}
+
+static void
+test_static_dict_perf (void)
+{
+  g_autoptr(GPtrArray) keys = NULL;
+
+  keys = load_keys (perf_filename, N_SYNTHETIC);
+
+  g_print ("%u keys\n", keys->len);
+
+  for (guint i = 0; i < N_ROUNDS; i++)
+    {
+      guint trie_visited;
+      guint dict_visited;
+
+      g_print ("Round %u (trie)\n", i + 1);
+      trie_visited = run_trie (keys);
+      g_print ("Round %u (static dict)\n", i + 1);
+      dict_visited = run_static_dict (keys);
+
+      g_assert_cmpint (trie_visited, ==, dict_visited);
+    }
+}
+
+gint
+main (gint   argc,
+      gchar *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  perf_filename = argc > 1 ? argv [1] : NULL;
+
+  g_test_add_func ("/Search/StaticDict/contains", test_static_dict_contains);
+  g_test_add_func ("/Search/StaticDict/iter", test_static_dict_iter);
+  g_test_add_func ("/Search/StaticDict/empty", test_static_dict_empty);
+  g_test_add_func ("/Search/StaticDict/trie", test_static_dict_trie);
+
+  if (g_test_perf ())
+    g_test_add_func ("/Search/StaticDict/perf", test_static_dict_perf);
+
+  return g_test_run ();
+}
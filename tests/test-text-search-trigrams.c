@@ -0,0 +1,388 @@
+/* test-text-search-trigrams.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <glib/gstdio.h>
+
+#include "gbp-text-search-trigrams.h"
+
+#define TRIGRAM(a,b,c) (((guint32)(a) << 16) | ((guint32)(b) << 8) | (guint32)(c))
+
+typedef struct
+{
+  const gchar *path;
+  const gchar *contents;
+} Document;
+
+static const Document documents[] = {
+  { "README", "Builder is an IDE for writing GNOME applications." },
+  { "src/main.c", "int\nmain (int argc, char **argv)\n{\n  return gnome_builder_main (argc, argv);\n}\n" },
+  { "src/app.c", "static void\napp_activate (GApplication *app)\n{\n  g_print (\"Activated\\n\");\n}\n" },
+  { "src/app.h", "#define APP_NAME \"GNOME Builder\"\n" },
+  { "docs/notes.txt", "main points: keep the IDE fast, keep it simple.\n" },
+  { "empty", "" },
+  { "short", "ab" },
+};
+
+static const gchar *queries[] = {
+  "main",
+  "MAIN",
+  "gnome",
+  "builder",
+  "app",
+  "Activate",
+  "keep it",
+  "argc, argv",
+  "not present anywhere",
+  "ide",
+  "tes",
+};
+
+static void
+insert_document (GbpTextSearchTrigrams *trigrams,
+                 const Document        *doc,
+                 guint64                mtime)
+{
+  g_autoptr(GArray) ar = NULL;
+  gsize len = strlen (doc->contents);
+
+  ar = gbp_text_search_collect_trigrams (doc->contents, len);
+  gbp_text_search_trigrams_insert (trigrams, doc->path, mtime, len, ar);
+}
+
+static GbpTextSearchTrigrams *
+create_index (void)
+{
+  GbpTextSearchTrigrams *trigrams = gbp_text_search_trigrams_new ();
+
+  for (guint i = 0; i < G_N_ELEMENTS (documents); i++)
+    insert_document (trigrams, &documents[i], i + 1);
+
+  return trigrams;
+}
+
+static gboolean
+contains_casefold (const gchar *haystack,
+                   const gchar *needle)
+{
+  g_autofree gchar *h = g_ascii_strdown (haystack, -1);
+  g_autofree gchar *n = g_ascii_strdown (needle, -1);
+
+  return strstr (h, n) != NULL;
+}
+
+static gboolean
+has_all_trigrams (const gchar *contents,
+                  const gchar *query)
+{
+  g_autoptr(GArray) q = gbp_text_search_collect_trigrams (query, strlen (query));
+  g_autoptr(GArray) c = gbp_text_search_collect_trigrams (contents, strlen (contents));
+
+  for (guint i = 0; i < q->len; i++)
+    {
+      gboolean found = FALSE;
+
+      for (guint j = 0; j < c->len && !found; j++)
+        found = g_array_index (q, guint32, i) == g_array_index (c, guint32, j);
+
+      if (!found)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static gboolean
+has_path (GPtrArray   *paths,
+          const gchar *path)
+{
+  for (guint i = 0; i < paths->len; i++)
+    {
+      if (g_strcmp0 (g_ptr_array_index (paths, i), path) == 0)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+/*
+ * Compares the candidates for every query with a scan of @docs, which must
+ * be the current contents of the index.
+ */
+static void
+check_candidates (GbpTextSearchTrigrams *trigrams,
+                  const Document        *docs,
+                  guint                  n_docs)
+{
+  for (guint i = 0; i < G_N_ELEMENTS (queries); i++)
+    {
+      g_autoptr(GPtrArray) candidates = NULL;
+      guint n_expected = 0;
+
+      candidates = gbp_text_search_trigrams_get_candidates (trigrams, queries[i]);
+
+      for (guint j = 0; j < n_docs; j++)
+        {
+          gboolean expected = has_all_trigrams (docs[j].contents, queries[i]);
+
+          /* Every real match must be a candidate */
+          if (contains_casefold (docs[j].contents, queries[i]))
+            g_assert_true (expected);
+
+          g_assert_cmpint (has_path (candidates, docs[j].path), ==, expected);
+          n_expected += expected;
+        }
+
+      g_assert_cmpint (candidates->len, ==, n_expected);
+    }
+}
+
+static void
+test_collect (void)
+{
+  g_autoptr(GArray) ar = NULL;
+
+  ar = gbp_text_search_collect_trigrams ("abcab", 5);
+  g_assert_cmpint (ar->len, ==, 3);
+  g_assert_cmpuint (g_array_index (ar, guint32, 0), ==, TRIGRAM ('a', 'b', 'c'));
+  g_assert_cmpuint (g_array_index (ar, guint32, 1), ==, TRIGRAM ('b', 'c', 'a'));
+  g_assert_cmpuint (g_array_index (ar, guint32, 2), ==, TRIGRAM ('c', 'a', 'b'));
+  g_clear_pointer (&ar, g_array_unref);
+
+  /* ASCII case is folded and duplicates are removed */
+  ar = gbp_text_search_collect_trigrams ("aAaAAa", 6);
+  g_assert_cmpint (ar->len, ==, 1);
+  g_assert_cmpuint (g_array_index (ar, guint32, 0), ==, TRIGRAM ('a', 'a', 'a'));
+  g_clear_pointer (&ar, g_array_unref);
+
+  /* Only @len bytes are used */
+  ar = gbp_text_search_collect_trigrams ("xyzw", 3);
+  g_assert_cmpint (ar->len, ==, 1);
+  g_assert_cmpuint (g_array_index (ar, guint32, 0), ==, TRIGRAM ('x', 'y', 'z'));
+  g_clear_pointer (&ar, g_array_unref);
+
+  /* Bytes outside of ASCII are kept as is */
+  ar = gbp_text_search_collect_trigrams ("\xc3\xa9t", 3);
+  g_assert_cmpint (ar->len, ==, 1);
+  g_assert_cmpuint (g_array_index (ar, guint32, 0), ==, TRIGRAM (0xc3, 0xa9, 't'));
+  g_clear_pointer (&ar, g_array_unref);
+
+  ar = gbp_text_search_collect_trigrams ("ab", 2);
+  g_assert_cmpint (ar->len, ==, 0);
+  g_clear_pointer (&ar, g_array_unref);
+
+  ar = gbp_text_search_collect_trigrams ("", 0);
+  g_assert_cmpint (ar->len, ==, 0);
+  g_clear_pointer (&ar, g_array_unref);
+
+  /* The result is sorted */
+  ar = gbp_text_search_collect_trigrams (documents[1].contents, strlen (documents[1].contents));
+  g_assert_cmpint (ar->len, >, 1);
+  for (guint i = 1; i < ar->len; i++)
+    g_assert_cmpuint (g_array_index (ar, guint32, i - 1), <, g_array_index (ar, guint32, i));
+}
+
+static void
+test_candidates (void)
+{
+  g_autoptr(GbpTextSearchTrigrams) trigrams = create_index ();
+  g_autoptr(GPtrArray) candidates = NULL;
+
+  g_assert_cmpint (gbp_text_search_trigrams_get_n_files (trigrams), ==, G_N_ELEMENTS (documents));
+
+  check_candidates (trigrams, documents, G_N_ELEMENTS (documents));
+
+  /* Queries without a trigram cannot use the index */
+  candidates = gbp_text_search_trigrams_get_candidates (trigrams, "ma");
+  g_assert_cmpint (candidates->len, ==, 0);
+}
+
+static void
+test_incremental (void)
+{
+  static const Document changed[] = {
+    { "README", "Nothing to see here." },
+    { "src/app.c", "static void\napp_activate (GApplication *app)\n{\n  g_print (\"Activated\\n\");\n}\n" },
+    { "src/app.h", "#define APP_NAME \"GNOME Builder\"\n" },
+    { "docs/notes.txt", "main points: keep the IDE fast, keep it simple.\n" },
+    { "empty", "" },
+    { "short", "ab" },
+    { "src/new.c", "int\nmain (void)\n{\n  return 0;\n}\n" },
+  };
+  g_autoptr(GbpTextSearchTrigrams) trigrams = create_index ();
+  g_autoptr(GHashTable) seen = NULL;
+  g_autoptr(GPtrArray) candidates = NULL;
+  gsize len = strlen (documents[0].contents);
+
+  g_assert_true (gbp_text_search_trigrams_is_current (trigrams, "README", 1, len));
+  g_assert_false (gbp_text_search_trigrams_is_current (trigrams, "README", 2, len));
+  g_assert_false (gbp_text_search_trigrams_is_current (trigrams, "README", 1, len + 1));
+  g_assert_false (gbp_text_search_trigrams_is_current (trigrams, "missing", 1, len));
+
+  /* Replacing a file drops its old trigrams */
+  insert_document (trigrams, &changed[0], 100);
+  g_assert_true (gbp_text_search_trigrams_is_current (trigrams, "README", 100, strlen (changed[0].contents)));
+
+  /* Removing a file drops it from every posting list */
+  gbp_text_search_trigrams_remove (trigrams, "src/main.c");
+  g_assert_false (gbp_text_search_trigrams_is_current (trigrams, "src/main.c", 2, strlen (documents[1].contents)));
+
+  /* Removing an unknown file is harmless */
+  gbp_text_search_trigrams_remove (trigrams, "src/main.c");
+  gbp_text_search_trigrams_remove (trigrams, "missing");
+
+  insert_document (trigrams, &changed[6], 101);
+
+  g_assert_cmpint (gbp_text_search_trigrams_get_n_files (trigrams), ==, G_N_ELEMENTS (changed));
+  check_candidates (trigrams, changed, G_N_ELEMENTS (changed));
+
+  candidates = gbp_text_search_trigrams_get_candidates (trigrams, "main");
+  g_assert_cmpint (candidates->len, ==, 2);
+  g_assert_true (has_path (candidates, "src/new.c"));
+  g_assert_true (has_path (candidates, "docs/notes.txt"));
+  g_clear_pointer (&candidates, g_ptr_array_unref);
+
+  /* Files that were not seen by a crawl are removed */
+  seen = g_hash_table_new (g_str_hash, g_str_equal);
+  for (guint i = 1; i < G_N_ELEMENTS (changed); i++)
+    g_hash_table_add (seen, (gchar *)changed[i].path);
+
+  gbp_text_search_trigrams_remove_unseen (trigrams, seen);
+
+  g_assert_cmpint (gbp_text_search_trigrams_get_n_files (trigrams), ==, G_N_ELEMENTS (changed) - 1);
+  check_candidates (trigrams, &changed[1], G_N_ELEMENTS (changed) - 1);
+}
+
+static void
+test_reload (void)
+{
+  g_autoptr(GbpTextSearchTrigrams) trigrams = create_index ();
+  g_autoptr(GbpTextSearchTrigrams) loaded = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *tmpdir = NULL;
+  g_autofree gchar *cache_path = NULL;
+  g_autofree gchar *cache_dir = NULL;
+  gboolean r;
+
+  tmpdir = g_dir_make_tmp ("test-text-search-XXXXXX", &error);
+  g_assert_no_error (error);
+
+  /* The parent directory is created when saving */
+  cache_path = g_build_filename (tmpdir, "cache", "project.trigrams", NULL);
+  cache_dir = g_path_get_dirname (cache_path);
+
+  /* Leave tombstones behind so that saving has to compact them */
+  gbp_text_search_trigrams_remove (trigrams, "README");
+  insert_document (trigrams, &documents[0], 1);
+  gbp_text_search_trigrams_remove (trigrams, "src/app.c");
+  insert_document (trigrams, &documents[2], 3);
+
+  r = gbp_text_search_trigrams_save (trigrams, cache_path, "/project", &error);
+  g_assert_no_error (error);
+  g_assert_true (r);
+
+  /* Compaction must not change the results */
+  check_candidates (trigrams, documents, G_N_ELEMENTS (documents));
+
+  loaded = gbp_text_search_trigrams_new ();
+  gbp_text_search_trigrams_load (loaded, cache_path, "/project");
+  g_assert_cmpint (gbp_text_search_trigrams_get_n_files (loaded), ==, G_N_ELEMENTS (documents));
+  check_candidates (loaded, documents, G_N_ELEMENTS (documents));
+
+  for (guint i = 0; i < G_N_ELEMENTS (documents); i++)
+    g_assert_true (gbp_text_search_trigrams_is_current (loaded,
+                                                         documents[i].path,
+                                                         i + 1,
+                                                         strlen (documents[i].contents)));
+
+  /* The loaded index keeps working incrementally */
+  gbp_text_search_trigrams_remove (loaded, "src/main.c");
+  insert_document (loaded, &documents[1], 2);
+  check_candidates (loaded, documents, G_N_ELEMENTS (documents));
+
+  /* A cache written for another project is ignored */
+  gbp_text_search_trigrams_load (loaded, cache_path, "/other");
+  g_assert_cmpint (gbp_text_search_trigrams_get_n_files (loaded), ==, 0);
+
+  /* So is a missing one */
+  gbp_text_search_trigrams_load (loaded, "/nonexistent/project.trigrams", "/project");
+  g_assert_cmpint (gbp_text_search_trigrams_get_n_files (loaded), ==, 0);
+
+  g_unlink (cache_path);
+  g_rmdir (cache_dir);
+  g_rmdir (tmpdir);
+}
+
+static void
+test_reload_corrupt (void)
+{
+  g_autoptr(GbpTextSearchTrigrams) trigrams = gbp_text_search_trigrams_new ();
+  g_autoptr(GVariant) variant = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *tmpdir = NULL;
+  g_autofree gchar *cache_path = NULL;
+  GVariantBuilder files;
+  GVariantBuilder postings;
+  static const guint32 ids[] = { 0, 5 };
+
+  tmpdir = g_dir_make_tmp ("test-text-search-XXXXXX", &error);
+  g_assert_no_error (error);
+  cache_path = g_build_filename (tmpdir, "project.trigrams", NULL);
+
+  /* Garbage is dropped quietly */
+  g_file_set_contents (cache_path, "not a cache", -1, &error);
+  g_assert_no_error (error);
+
+  insert_document (trigrams, &documents[0], 1);
+  gbp_text_search_trigrams_load (trigrams, cache_path, "/project");
+  g_assert_cmpint (gbp_text_search_trigrams_get_n_files (trigrams), ==, 0);
+
+  /* A well-formed cache referring to unknown files is reported */
+  g_variant_builder_init (&files, G_VARIANT_TYPE ("a(stt)"));
+  g_variant_builder_add (&files, "(stt)", "README", (guint64)1, (guint64)1);
+  g_variant_builder_init (&postings, G_VARIANT_TYPE ("a(uau)"));
+  g_variant_builder_add (&postings, "(u@au)",
+                         TRIGRAM ('a', 'b', 'c'),
+                         g_variant_new_fixed_array (G_VARIANT_TYPE_UINT32, ids, G_N_ELEMENTS (ids), sizeof (guint32)));
+  variant = g_variant_ref_sink (g_variant_new ("(usa(stt)a(uau))", 1, "/project", &files, &postings));
+
+  g_file_set_contents (cache_path, g_variant_get_data (variant), g_variant_get_size (variant), &error);
+  g_assert_no_error (error);
+
+  g_test_expect_message ("gbp-text-search-trigrams", G_LOG_LEVEL_WARNING, "*corrupt*");
+  gbp_text_search_trigrams_load (trigrams, cache_path, "/project");
+  g_test_assert_expected_messages ();
+
+  g_assert_cmpint (gbp_text_search_trigrams_get_n_files (trigrams), ==, 0);
+
+  g_unlink (cache_path);
+  g_rmdir (tmpdir);
+}
+
+gint
+main (gint   argc,
+      gchar *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+  g_test_add_func ("/TextSearch/Trigrams/collect", test_collect);
+  g_test_add_func ("/TextSearch/Trigrams/candidates", test_candidates);
+  g_test_add_func ("/TextSearch/Trigrams/incremental", test_incremental);
+  g_test_add_func ("/TextSearch/Trigrams/reload", test_reload);
+  g_test_add_func ("/TextSearch/Trigrams/reload_corrupt", test_reload_corrupt);
+  return g_test_run ();
+}
@@ -0,0 +1,295 @@
+/* test-tmpl-expand.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <tmpl-glib.h>
+
+/*
+ * Checks that expanding the compiled instruction stream produces the same
+ * output as walking the parsed tree.
+ *
+ * Running with -m perf also compares the speed of both:
+ *
+ *   test-tmpl-expand -m perf [FILENAME]
+ *
+ * FILENAME should be a template using only the symbols set below. Without
+ * it, a template resembling a project source file template is used.
+ */
+
+#define N_EXPANSIONS 20000
+#define N_ROUNDS     5
+
+static const gchar *perf_filename;
+
+static const gchar *default_template =
+  "/* {{filename}}\n"
+  " *\n"
+  " * Copyright (C) {{year}} {{author}} <{{email}}>\n"
+  " *\n"
+  " * This program is free software: you can redistribute it and/or modify\n"
+  " * it under the terms of the GNU General Public License as published by\n"
+  " * the Free Software Foundation, either version {{3}} of the License, or\n"
+  " * (at your option) any later version.\n"
+  " */\n"
+  "\n"
+  "{{if language == \"c\"}}"
+  "#include \"{{name}}.h\"\n"
+  "{{else if language == \"vala\"}}"
+  "using GLib;\n"
+  "{{else}}"
+  "# {{name}}\n"
+  "{{end}}"
+  "\n"
+  "{{for ch in name}}"
+  "{{if ch == \"_\"}}-{{else}}{{ch}}{{end}}"
+  "{{end}}\n"
+  "{{if enable_tests}}"
+  "struct _{{Name}} { GObject parent_instance; };\n"
+  "{{end}}";
+
+static TmplScope *
+create_scope (void)
+{
+  TmplScope *scope = tmpl_scope_new ();
+
+  tmpl_scope_set_string (scope, "filename", "my-project-window.c");
+  tmpl_scope_set_string (scope, "name", "my_project_window");
+  tmpl_scope_set_string (scope, "Name", "MyProjectWindow");
+  tmpl_scope_set_string (scope, "author", "Jane Doe");
+  tmpl_scope_set_string (scope, "email", "jane@example.com");
+  tmpl_scope_set_string (scope, "language", "c");
+  tmpl_scope_set_double (scope, "year", 2016);
+  tmpl_scope_set_boolean (scope, "enable_tests", TRUE);
+
+  return scope;
+}
+
+static gdouble
+msec_since (gint64 begin)
+{
+  return (g_get_monotonic_time () - begin) / 1000.0;
+}
+
+static gchar *
+run_round (TmplTemplate *template,
+           TmplScope    *scope,
+           const gchar  *label)
+{
+  g_autoptr(GError) error = NULL;
+  gchar *last = NULL;
+  gint64 begin;
+  gdouble elapsed;
+
+  begin = g_get_monotonic_time ();
+
+  for (guint i = 0; i < N_EXPANSIONS; i++)
+    {
+      g_free (last);
+
+      if (!(last = tmpl_template_expand_string (template, scope, &error)))
+        g_error ("%s", error->message);
+    }
+
+  elapsed = msec_since (begin);
+
+  g_print ("  %-9s %8.3lf msec (%.0lf expansions/sec)\n",
+           label, elapsed, N_EXPANSIONS / (elapsed / 1000.0));
+
+  return last;
+}
+
+static gchar *
+expand_both (const gchar *contents,
+             TmplScope   *scope)
+{
+  g_autoptr(TmplTemplate) ast = NULL;
+  g_autoptr(TmplTemplate) compiled = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *ast_result = NULL;
+  gchar *compiled_result;
+  gboolean r;
+
+  ast = tmpl_template_new (NULL);
+  compiled = tmpl_template_new (NULL);
+
+  r = tmpl_template_parse_string (ast, contents, &error);
+  g_assert_no_error (error);
+  g_assert (r);
+
+  r = tmpl_template_parse_string (compiled, contents, &error);
+  g_assert_no_error (error);
+  g_assert (r);
+
+  r = tmpl_template_compile (compiled, &error);
+  g_assert_no_error (error);
+  g_assert (r);
+
+  ast_result = tmpl_template_expand_string (ast, scope, &error);
+  g_assert_no_error (error);
+  g_assert (ast_result != NULL);
+
+  /* Expand twice, since symbol slots are cached per expansion */
+  for (guint i = 0; i < 2; i++)
+    {
+      compiled_result = tmpl_template_expand_string (compiled, scope, &error);
+      g_assert_no_error (error);
+      g_assert_cmpstr (ast_result, ==, compiled_result);
+
+      if (i == 0)
+        g_free (compiled_result);
+    }
+
+  return compiled_result;
+}
+
+static void
+test_tmpl_compile_matches (void)
+{
+  static const gchar *languages[] = { "c", "vala", "python" };
+
+  for (guint i = 0; i < G_N_ELEMENTS (languages); i++)
+    {
+      for (guint j = 0; j < 2; j++)
+        {
+          g_autoptr(TmplScope) scope = create_scope ();
+          g_autofree gchar *result = NULL;
+
+          tmpl_scope_set_string (scope, "language", languages [i]);
+          tmpl_scope_set_boolean (scope, "enable_tests", j == 0);
+
+          result = expand_both (default_template, scope);
+
+          g_assert (strstr (result, "my-project-window\n") != NULL);
+          g_assert_cmpint (strstr (result, "struct _MyProjectWindow") != NULL, ==, j == 0);
+        }
+    }
+}
+
+static void
+test_tmpl_compile_scopes (void)
+{
+  g_autoptr(TmplScope) scope = create_scope ();
+  g_autofree gchar *result = NULL;
+
+  /* Loop variables shadow, and are restored after, the outer symbol */
+  tmpl_scope_set_string (scope, "ch", "outer");
+
+  result = expand_both ("{{ch}}:{{for ch in name}}{{if ch == \"_\"}}-{{else}}{{ch}}{{end}}{{end}}:{{ch}}"
+                        "{{if enable_tests}}!{{end}}",
+                        scope);
+  g_assert_cmpstr (result, ==, "outer:my-project-window:outer!");
+}
+
+static void
+test_tmpl_compile_invalid (void)
+{
+  g_autoptr(TmplTemplate) template = NULL;
+  g_autoptr(TmplScope) scope = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *result = NULL;
+  gboolean r;
+
+  template = tmpl_template_new (NULL);
+
+  r = tmpl_template_compile (template, &error);
+  g_assert_error (error, TMPL_ERROR, TMPL_ERROR_INVALID_STATE);
+  g_assert (!r);
+  g_clear_error (&error);
+
+  /* Parsing again drops the compiled program */
+  r = tmpl_template_parse_string (template, "a{{name}}", &error);
+  g_assert_no_error (error);
+  g_assert (r);
+
+  r = tmpl_template_compile (template, &error);
+  g_assert_no_error (error);
+  g_assert (r);
+
+  r = tmpl_template_parse_string (template, "b{{name}}", &error);
+  g_assert_no_error (error);
+  g_assert (r);
+
+  scope = create_scope ();
+  result = tmpl_template_expand_string (template, scope, &error);
+  g_assert_no_error (error);
+  g_assert_cmpstr (result, ==, "bmy_project_window");
+}
+
+static void
+test_tmpl_compile_perf (void)
+{
+  g_autoptr(TmplTemplate) ast = NULL;
+  g_autoptr(TmplTemplate) compiled = NULL;
+  g_autoptr(TmplScope) scope = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *contents = NULL;
+  gint64 begin;
+
+  if (perf_filename != NULL)
+    {
+      if (!g_file_get_contents (perf_filename, &contents, NULL, &error))
+        g_error ("%s", error->message);
+    }
+  else
+    contents = g_strdup (default_template);
+
+  ast = tmpl_template_new (NULL);
+  compiled = tmpl_template_new (NULL);
+
+  if (!tmpl_template_parse_string (ast, contents, &error) ||
+      !tmpl_template_parse_string (compiled, contents, &error))
+    g_error ("%s", error->message);
+
+  begin = g_get_monotonic_time ();
+  if (!tmpl_template_compile (compiled, &error))
+    g_error ("%s", error->message);
+  g_print ("compile: %8.3lf msec\n", msec_since (begin));
+
+  scope = create_scope ();
+
+  for (guint i = 0; i < N_ROUNDS; i++)
+    {
+      g_autofree gchar *ast_result = NULL;
+      g_autofree gchar *compiled_result = NULL;
+
+      g_print ("Round %u (%u expansions)\n", i + 1, N_EXPANSIONS);
+
+      ast_result = run_round (ast, scope, "ast:");
+      compiled_result = run_round (compiled, scope, "compiled:");
+
+      g_assert_cmpstr (ast_result, ==, compiled_result);
+    }
+}
+
+gint
+main (gint   argc,
+      gchar *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  perf_filename = argc > 1 ? argv [1] : NULL;
+
+  g_test_add_func ("/Tmpl/Compile/matches", test_tmpl_compile_matches);
+  g_test_add_func ("/Tmpl/Compile/scopes", test_tmpl_compile_scopes);
+  g_test_add_func ("/Tmpl/Compile/invalid", test_tmpl_compile_invalid);
+
+  if (g_test_perf ())
+    g_test_add_func ("/Tmpl/Compile/perf", test_tmpl_compile_perf);
+
+  return g_test_run ();
+}
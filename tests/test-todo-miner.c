@@ -0,0 +1,230 @@
+/* test-todo-miner.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib/gstdio.h>
+#include <string.h>
+
+#include "gbp-todo-item.h"
+#include "gbp-todo-miner.h"
+
+static void
+test_contents (void)
+{
+  static const gchar contents[] =
+    "/* TODO: first\r\n"
+    " * continued */\r\n"
+    "\r\n"
+    "int a;\n"
+    "int b;\n"
+    "int c;\n"
+    "int d;\n"
+    "// FIXME:second\n"
+    "// TODO without colon\n";
+  g_autoptr(GFile) file = g_file_new_for_path ("/tmp/contents.c");
+  g_autoptr(GPtrArray) items = NULL;
+  g_autofree gchar *shortdesc = NULL;
+  GbpTodoItem *item;
+
+  items = gbp_todo_miner_scan_contents (file, contents, strlen (contents));
+  g_assert (items != NULL);
+  g_assert_cmpint (items->len, ==, 2);
+
+  /* Blank lines are left out of the context, but still count */
+  item = g_ptr_array_index (items, 0);
+  g_assert (gbp_todo_item_get_file (item) == file);
+  g_assert_cmpint (gbp_todo_item_get_line (item), ==, 1);
+  g_assert_cmpstr (gbp_todo_item_get_message (item), ==,
+                   "/* TODO: first\n * continued */\nint a;\nint b;\nint c;");
+
+  shortdesc = gbp_todo_item_dup_shortdesc (item);
+  g_assert_cmpstr (shortdesc, ==, "/* TODO: first");
+
+  item = g_ptr_array_index (items, 1);
+  g_assert_cmpint (gbp_todo_item_get_line (item), ==, 8);
+  g_assert_cmpstr (gbp_todo_item_get_message (item), ==, "// FIXME:second\n// TODO without colon");
+}
+
+static gchar *
+write_file (const gchar *dir,
+            const gchar *name,
+            const gchar *contents,
+            gsize        len)
+{
+  g_autofree gchar *path = g_build_filename (dir, name, NULL);
+  g_autoptr(GError) error = NULL;
+
+  g_file_set_contents (path, contents, len, &error);
+  g_assert_no_error (error);
+
+  return g_steal_pointer (&path);
+}
+
+static void
+test_scan_file (void)
+{
+  static const gchar text[] = "XXX: text\n";
+  static const gchar binary[] = "XXX: binary\n\0\1\2";
+  g_autofree gchar *dir = NULL;
+  g_autofree gchar *text_path = NULL;
+  g_autofree gchar *binary_path = NULL;
+  g_autofree gchar *po_path = NULL;
+  g_autoptr(GFile) text_file = NULL;
+  g_autoptr(GFile) binary_file = NULL;
+  g_autoptr(GFile) po_file = NULL;
+  g_autoptr(GFile) missing_file = NULL;
+  g_autoptr(GPtrArray) items = NULL;
+  g_autoptr(GError) error = NULL;
+
+  dir = g_dir_make_tmp ("test-todo-miner-XXXXXX", &error);
+  g_assert_no_error (error);
+
+  text_path = write_file (dir, "text.c", text, sizeof text - 1);
+  binary_path = write_file (dir, "binary.c", binary, sizeof binary - 1);
+  po_path = write_file (dir, "fr.po", text, sizeof text - 1);
+
+  text_file = g_file_new_for_path (text_path);
+  binary_file = g_file_new_for_path (binary_path);
+  po_file = g_file_new_for_path (po_path);
+  missing_file = g_file_get_child (text_file, "missing");
+
+  items = gbp_todo_miner_scan_file (text_file, "text.c", sizeof text - 1, NULL);
+  g_assert_cmpint (items->len, ==, 1);
+  g_clear_pointer (&items, g_ptr_array_unref);
+
+  /* Files that are too large are not even read */
+  items = gbp_todo_miner_scan_file (text_file, "text.c", G_MAXUINT32, NULL);
+  g_assert_cmpint (items->len, ==, 0);
+  g_clear_pointer (&items, g_ptr_array_unref);
+
+  items = gbp_todo_miner_scan_file (binary_file, "binary.c", sizeof binary - 1, NULL);
+  g_assert_cmpint (items->len, ==, 0);
+  g_clear_pointer (&items, g_ptr_array_unref);
+
+  items = gbp_todo_miner_scan_file (po_file, "fr.po", sizeof text - 1, NULL);
+  g_assert_cmpint (items->len, ==, 0);
+  g_clear_pointer (&items, g_ptr_array_unref);
+
+  items = gbp_todo_miner_scan_file (missing_file, "text.c/missing", 0, NULL);
+  g_assert (items == NULL);
+
+  g_unlink (text_path);
+  g_unlink (binary_path);
+  g_unlink (po_path);
+  g_rmdir (dir);
+}
+
+static void
+test_cache (void)
+{
+  g_autofree gchar *dir = NULL;
+  g_autofree gchar *cache_path = NULL;
+  g_autofree gchar *cache_dir = NULL;
+  g_autoptr(GFile) root = NULL;
+  g_autoptr(GFile) other_root = NULL;
+  g_autoptr(GFile) file = NULL;
+  g_autoptr(GHashTable) files = NULL;
+  g_autoptr(GHashTable) loaded = NULL;
+  g_autoptr(GPtrArray) items = NULL;
+  g_autoptr(GError) error = NULL;
+  GbpTodoFileEntry *entry;
+  GbpTodoItem *item;
+  gboolean r;
+
+  dir = g_dir_make_tmp ("test-todo-miner-XXXXXX", &error);
+  g_assert_no_error (error);
+
+  cache_dir = g_build_filename (dir, "cache", NULL);
+  cache_path = g_build_filename (cache_dir, "project.todo", NULL);
+  root = g_file_new_for_path (dir);
+  other_root = g_file_get_child (root, "other");
+  file = g_file_resolve_relative_path (root, "src/main.c");
+
+  /* A missing cache is just empty */
+  loaded = gbp_todo_miner_load_cache (cache_path, root);
+  g_assert_cmpint (g_hash_table_size (loaded), ==, 0);
+  g_clear_pointer (&loaded, g_hash_table_unref);
+
+  items = g_ptr_array_new_with_free_func ((GDestroyNotify)gbp_todo_item_unref);
+  g_ptr_array_add (items, gbp_todo_item_new (file, 3, "TODO: cached\nnext line"));
+
+  files = g_hash_table_new_full (g_str_hash,
+                                 g_str_equal,
+                                 g_free,
+                                 (GDestroyNotify)gbp_todo_file_entry_free);
+  g_hash_table_insert (files,
+                       g_strdup ("src/main.c"),
+                       gbp_todo_file_entry_new (G_GUINT64_CONSTANT (1478000000123456), 42, items));
+
+  r = gbp_todo_miner_save_cache (cache_path, root, files, &error);
+  g_assert_no_error (error);
+  g_assert (r);
+
+  loaded = gbp_todo_miner_load_cache (cache_path, root);
+  g_assert_cmpint (g_hash_table_size (loaded), ==, 1);
+
+  entry = g_hash_table_lookup (loaded, "src/main.c");
+  g_assert (entry != NULL);
+  g_assert_cmpuint (entry->mtime, ==, G_GUINT64_CONSTANT (1478000000123456));
+  g_assert_cmpuint (entry->size, ==, 42);
+  g_assert_cmpint (entry->items->len, ==, 1);
+
+  item = g_ptr_array_index (entry->items, 0);
+  g_assert (g_file_equal (gbp_todo_item_get_file (item), file));
+  g_assert_cmpint (gbp_todo_item_get_line (item), ==, 3);
+  g_assert_cmpstr (gbp_todo_item_get_message (item), ==, "TODO: cached\nnext line");
+  g_clear_pointer (&loaded, g_hash_table_unref);
+
+  /* The paths are meaningless for another directory */
+  loaded = gbp_todo_miner_load_cache (cache_path, other_root);
+  g_assert_cmpint (g_hash_table_size (loaded), ==, 0);
+  g_clear_pointer (&loaded, g_hash_table_unref);
+
+  g_file_set_contents (cache_path, "not a cache", -1, &error);
+  g_assert_no_error (error);
+
+  loaded = gbp_todo_miner_load_cache (cache_path, root);
+  g_assert_cmpint (g_hash_table_size (loaded), ==, 0);
+  g_clear_pointer (&loaded, g_hash_table_unref);
+
+  g_unlink (cache_path);
+  g_rmdir (cache_dir);
+  g_rmdir (dir);
+}
+
+static void
+test_mtime (void)
+{
+  g_autoptr(GFileInfo) info = g_file_info_new ();
+
+  g_file_info_set_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED, 1478000000);
+  g_file_info_set_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC, 500);
+
+  g_assert_cmpuint (gbp_todo_miner_get_mtime (info), ==, G_GUINT64_CONSTANT (1478000000000500));
+}
+
+gint
+main (gint   argc,
+      gchar *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+  g_test_add_func ("/Todo/Miner/contents", test_contents);
+  g_test_add_func ("/Todo/Miner/scan_file", test_scan_file);
+  g_test_add_func ("/Todo/Miner/cache", test_cache);
+  g_test_add_func ("/Todo/Miner/mtime", test_mtime);
+  return g_test_run ();
+}
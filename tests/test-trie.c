@@ -0,0 +1,342 @@
+/* test-trie.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <trie.h>
+
+/*
+ * Tests for the trie used by snippets.
+ *
+ * Running with -m perf also runs a microbenchmark:
+ *
+ *   test-trie -m perf [FILENAME]
+ *
+ * FILENAME should contain one key per line, such as /usr/share/dict/words.
+ * Without it, a synthetic set of identifier-like keys is generated.
+ */
+
+static const gchar *perf_filename;
+
+#define N_SYNTHETIC 200000
+#define N_ROUNDS    5
+
+static GPtrArray *
+load_keys (const gchar *filename)
+{
+  GPtrArray *keys = g_ptr_array_new_with_free_func (g_free);
+
+  if (filename != NULL)
+    {
+      g_autofree gchar *contents = NULL;
+      g_auto(GStrv) lines = NULL;
+
+      if (!g_file_get_contents (filename, &contents, NULL, NULL))
+        g_error ("Failed to load %s", filename);
+
+      lines = g_strsplit (contents, "\n", -1);
+
+      for (guint i = 0; lines [i]; i++)
+        {
+          if (*lines [i])
+            g_ptr_array_add (keys, g_strdup (lines [i]));
+        }
+    }
+  else
+    {
+      static const gchar *prefixes[] = { "gtk_", "g_", "ide_", "egg_", "pnl_", "gdk_" };
+      static const gchar *words[] = { "widget", "buffer", "get", "set", "new", "free",
+                                      "context", "source", "view", "iter", "text", "file" };
+      GRand *rand = g_rand_new_with_seed (0);
+
+      for (guint i = 0; i < N_SYNTHETIC; i++)
+        {
+          GString *str = g_string_new (prefixes [g_rand_int_range (rand, 0, G_N_ELEMENTS (prefixes))]);
+          guint n = g_rand_int_range (rand, 1, 4);
+
+          for (guint j = 0; j < n; j++)
+            g_string_append_printf (str, "%s_", words [g_rand_int_range (rand, 0, G_N_ELEMENTS (words))]);
+          g_string_append_printf (str, "%u", i);
+
+          g_ptr_array_add (keys, g_string_free (str, FALSE));
+        }
+
+      g_rand_free (rand);
+    }
+
+  return keys;
+}
+
+static gboolean
+count_cb (Trie        *trie,
+          const gchar *key,
+          gpointer     value,
+          gpointer     user_data)
+{
+  guint *count = user_data;
+  (*count)++;
+  return FALSE;
+}
+
+static gboolean
+collect_cb (Trie        *trie,
+            const gchar *key,
+            gpointer     value,
+            gpointer     user_data)
+{
+  GString *str = user_data;
+
+  if (str->len > 0)
+    g_string_append_c (str, ' ');
+  g_string_append (str, key);
+
+  return FALSE;
+}
+
+static gchar *
+collect_keys (Trie           *trie,
+              const gchar    *prefix,
+              GTraverseType   order,
+              GTraverseFlags  flags,
+              gint            max_depth)
+{
+  GString *str = g_string_new (NULL);
+
+  trie_traverse (trie, prefix, order, flags, max_depth, collect_cb, str);
+
+  return g_string_free (str, FALSE);
+}
+
+static void
+test_trie_basic (void)
+{
+  Trie *trie;
+
+  trie = trie_new (g_free);
+
+  g_assert (trie_lookup (trie, "") == NULL);
+  g_assert (trie_lookup (trie, "missing") == NULL);
+  g_assert (!trie_remove (trie, "missing"));
+
+  trie_insert (trie, "abc", g_strdup ("1"));
+  trie_insert (trie, "abd", g_strdup ("2"));
+  trie_insert (trie, "ab", g_strdup ("3"));
+  trie_insert (trie, "a", g_strdup ("4"));
+  trie_insert (trie, "b", g_strdup ("5"));
+
+  g_assert_cmpstr (trie_lookup (trie, "abc"), ==, "1");
+  g_assert_cmpstr (trie_lookup (trie, "abd"), ==, "2");
+  g_assert_cmpstr (trie_lookup (trie, "ab"), ==, "3");
+  g_assert_cmpstr (trie_lookup (trie, "a"), ==, "4");
+  g_assert_cmpstr (trie_lookup (trie, "b"), ==, "5");
+
+  /* Positions in the middle of an edge and past the end hold nothing */
+  g_assert (trie_lookup (trie, "abcd") == NULL);
+  g_assert (trie_lookup (trie, "abe") == NULL);
+  g_assert (trie_lookup (trie, "c") == NULL);
+
+  /* Replacing a value frees the old one */
+  trie_insert (trie, "ab", g_strdup ("6"));
+  g_assert_cmpstr (trie_lookup (trie, "ab"), ==, "6");
+
+  /* Removing an inner key merges the edges again */
+  g_assert (trie_remove (trie, "ab"));
+  g_assert (!trie_remove (trie, "ab"));
+  g_assert (trie_lookup (trie, "ab") == NULL);
+  g_assert_cmpstr (trie_lookup (trie, "abc"), ==, "1");
+  g_assert_cmpstr (trie_lookup (trie, "abd"), ==, "2");
+
+  g_assert (trie_remove (trie, "abc"));
+  g_assert_cmpstr (trie_lookup (trie, "abd"), ==, "2");
+  g_assert_cmpstr (trie_lookup (trie, "a"), ==, "4");
+
+  trie_destroy (trie);
+}
+
+static void
+test_trie_traverse (void)
+{
+  static const gchar *keys[] = { "tab", "ta", "team", "tea", "teapot", "ten", "to", "b" };
+  Trie *trie;
+  gchar *str;
+
+  trie = trie_new (NULL);
+
+  for (guint i = 0; i < G_N_ELEMENTS (keys); i++)
+    trie_insert (trie, keys [i], (gpointer)keys [i]);
+
+  /* Children are visited in byte order */
+  str = collect_keys (trie, NULL, G_PRE_ORDER, G_TRAVERSE_LEAVES, -1);
+  g_assert_cmpstr (str, ==, "b ta tab tea team teapot ten to");
+  g_free (str);
+
+  str = collect_keys (trie, "te", G_PRE_ORDER, G_TRAVERSE_LEAVES, -1);
+  g_assert_cmpstr (str, ==, "tea team teapot ten");
+  g_free (str);
+
+  str = collect_keys (trie, "te", G_POST_ORDER, G_TRAVERSE_LEAVES, -1);
+  g_assert_cmpstr (str, ==, "team teapot tea ten");
+  g_free (str);
+
+  /* Compressed edges still report one position per character */
+  str = collect_keys (trie, "tea", G_PRE_ORDER, G_TRAVERSE_ALL, -1);
+  g_assert_cmpstr (str, ==, "tea team teap teapo teapot");
+  g_free (str);
+
+  str = collect_keys (trie, "te", G_PRE_ORDER, G_TRAVERSE_LEAVES, 2);
+  g_assert_cmpstr (str, ==, "tea ten");
+  g_free (str);
+
+  str = collect_keys (trie, "x", G_PRE_ORDER, G_TRAVERSE_ALL, -1);
+  g_assert_cmpstr (str, ==, "");
+  g_free (str);
+
+  trie_destroy (trie);
+}
+
+static void
+test_trie_freeze (void)
+{
+  g_autoptr(GPtrArray) keys = NULL;
+  Trie *trie;
+
+  keys = g_ptr_array_new_with_free_func (g_free);
+  for (guint i = 0; i < 1000; i++)
+    g_ptr_array_add (keys, g_strdup_printf ("key_%u_%u", i % 7, i));
+
+  trie = trie_new (NULL);
+
+  for (guint i = 0; i < keys->len; i++)
+    trie_insert (trie, g_ptr_array_index (keys, i), g_ptr_array_index (keys, i));
+
+  for (guint i = 0; i < keys->len; i += 3)
+    trie_remove (trie, g_ptr_array_index (keys, i));
+
+  trie_freeze (trie);
+
+  for (guint i = 0; i < keys->len; i++)
+    {
+      const gchar *key = g_ptr_array_index (keys, i);
+
+      if (i % 3 == 0)
+        g_assert (trie_lookup (trie, key) == NULL);
+      else
+        g_assert (trie_lookup (trie, key) == key);
+    }
+
+  /* The trie is still mutable after freezing */
+  for (guint i = 0; i < keys->len; i += 3)
+    trie_insert (trie, g_ptr_array_index (keys, i), g_ptr_array_index (keys, i));
+
+  for (guint i = 0; i < keys->len; i++)
+    g_assert (trie_lookup (trie, g_ptr_array_index (keys, i)) == g_ptr_array_index (keys, i));
+
+  trie_destroy (trie);
+}
+
+static gdouble
+msec_since (gint64 begin)
+{
+  return (g_get_monotonic_time () - begin) / 1000.0;
+}
+
+static void
+run_round (GPtrArray *keys,
+           gboolean   freeze)
+{
+  static const gchar *prefixes[] = { "g", "gtk_w", "ide_buffer_", "egg_", "a", "th" };
+  Trie *trie;
+  gint64 begin;
+  guint found = 0;
+  guint visited = 0;
+
+  trie = trie_new (NULL);
+
+  begin = g_get_monotonic_time ();
+  for (guint i = 0; i < keys->len; i++)
+    trie_insert (trie, g_ptr_array_index (keys, i), g_ptr_array_index (keys, i));
+  g_print ("  insert:   %8.3lf msec\n", msec_since (begin));
+
+  if (freeze)
+    {
+      begin = g_get_monotonic_time ();
+      trie_freeze (trie);
+      g_print ("  freeze:   %8.3lf msec\n", msec_since (begin));
+    }
+
+  begin = g_get_monotonic_time ();
+  for (guint i = 0; i < keys->len; i++)
+    {
+      const gchar *key = g_ptr_array_index (keys, i);
+
+      if (g_strcmp0 (trie_lookup (trie, key), key) == 0)
+        found++;
+    }
+  g_print ("  lookup:   %8.3lf msec\n", msec_since (begin));
+  g_assert_cmpint (found, ==, keys->len);
+
+  begin = g_get_monotonic_time ();
+  for (guint i = 0; i < G_N_ELEMENTS (prefixes); i++)
+    trie_traverse (trie, prefixes [i], G_PRE_ORDER, G_TRAVERSE_LEAVES, -1, count_cb, &visited);
+  g_print ("  prefix:   %8.3lf msec (%u keys)\n", msec_since (begin), visited);
+
+  begin = g_get_monotonic_time ();
+  for (guint i = 0; i < keys->len; i += 2)
+    trie_remove (trie, g_ptr_array_index (keys, i));
+  g_print ("  remove:   %8.3lf msec\n", msec_since (begin));
+
+  for (guint i = 0; i < keys->len; i += 2)
+    g_assert (trie_lookup (trie, g_ptr_array_index (keys, i)) == NULL);
+
+  trie_destroy (trie);
+}
+
+static void
+test_trie_perf (void)
+{
+  g_autoptr(GPtrArray) keys = NULL;
+
+  keys = load_keys (perf_filename);
+
+  g_print ("%u keys\n", keys->len);
+
+  for (guint i = 0; i < N_ROUNDS; i++)
+    {
+      g_print ("Round %u\n", i + 1);
+      run_round (keys, FALSE);
+      g_print ("Round %u (frozen)\n", i + 1);
+      run_round (keys, TRUE);
+    }
+}
+
+gint
+main (gint   argc,
+      gchar *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  perf_filename = argc > 1 ? argv [1] : NULL;
+
+  g_test_add_func ("/Search/Trie/basic", test_trie_basic);
+  g_test_add_func ("/Search/Trie/traverse", test_trie_traverse);
+  g_test_add_func ("/Search/Trie/freeze", test_trie_freeze);
+
+  if (g_test_perf ())
+    g_test_add_func ("/Search/Trie/perf", test_trie_perf);
+
+  return g_test_run ();
+}
@@ -0,0 +1,265 @@
+/* ide-dump-trace.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+
+#include "ide-debug.h"
+#include "logging/ide-trace.h"
+
+/*
+ * Dumps a trace written by ide_trace_write_to_file(), either with the
+ * IDE_TRACE_FILE environment variable or the app.trace action.
+ *
+ * By default, a timeline is printed for every thread with the time spent
+ * between each IDE_ENTRY and the matching IDE_EXIT. With --summary, the
+ * calls are aggregated per function instead.
+ */
+
+typedef struct
+{
+  const gchar *func;
+  guint        calls;
+  gint64       total;
+  gint64       max;
+} Summary;
+
+typedef struct
+{
+  guint  func;
+  gint64 time;
+} Frame;
+
+static gboolean summary;
+static gdouble  min_msec;
+
+static GOptionEntry entries[] = {
+  { "summary", 's', 0, G_OPTION_ARG_NONE, &summary, "Aggregate calls per function" },
+  { "min-msec", 'm', 0, G_OPTION_ARG_DOUBLE, &min_msec, "Hide calls shorter than MSEC", "MSEC" },
+  { NULL }
+};
+
+static gint
+summary_compare (gconstpointer a,
+                 gconstpointer b)
+{
+  const Summary *sa = *(const Summary **)a;
+  const Summary *sb = *(const Summary **)b;
+
+  if (sa->total < sb->total)
+    return 1;
+  else if (sa->total > sb->total)
+    return -1;
+  else
+    return 0;
+}
+
+static void
+dump_thread (GVariant    *records,
+             const gchar *names[],
+             gsize        n_names,
+             gint         thread,
+             gint64       begin_time,
+             GHashTable  *summaries)
+{
+  g_autoptr(GArray) stack = NULL;
+  GVariantIter iter;
+  gint64 time;
+  guint func;
+  guint event;
+
+  if (!summary)
+    g_print ("Thread %d\n", thread);
+
+  stack = g_array_new (FALSE, FALSE, sizeof (Frame));
+
+  g_variant_iter_init (&iter, records);
+
+  while (g_variant_iter_next (&iter, "(xuu)", &time, &func, &event))
+    {
+      const gchar *name = func < n_names ? names [func] : "???";
+
+      switch (event)
+        {
+        case IDE_TRACE_EVENT_ENTRY:
+          {
+            Frame frame = { func, time };
+
+            g_array_append_val (stack, frame);
+          }
+          break;
+
+        case IDE_TRACE_EVENT_EXIT:
+          {
+            gint64 begin;
+            gint64 duration;
+            guint i;
+
+            for (i = stack->len; i > 0; i--)
+              {
+                if (g_array_index (stack, Frame, i - 1).func == func)
+                  break;
+              }
+
+            /*
+             * The ring may have dropped the matching IDE_ENTRY, in which case
+             * the exit is skipped. Entries above the match never exited, such
+             * as when a function returned without IDE_EXIT, and are dropped.
+             */
+            if (i == 0)
+              break;
+
+            begin = g_array_index (stack, Frame, i - 1).time;
+            g_array_set_size (stack, i - 1);
+
+            duration = time - begin;
+
+            if (summary)
+              {
+                Summary *s = g_hash_table_lookup (summaries, name);
+
+                if (s == NULL)
+                  {
+                    s = g_slice_new0 (Summary);
+                    s->func = name;
+                    g_hash_table_insert (summaries, (gchar *)name, s);
+                  }
+
+                s->calls++;
+                s->total += duration;
+                s->max = MAX (s->max, duration);
+              }
+            else if (duration / 1000.0 >= min_msec)
+              {
+                g_print ("  %12.3lf  %*s%s() %.3lf msec\n",
+                         (begin - begin_time) / 1000.0,
+                         (gint)stack->len * 2, "",
+                         name,
+                         duration / 1000.0);
+              }
+          }
+          break;
+
+        case IDE_TRACE_EVENT_PROBE:
+          if (!summary && min_msec <= 0)
+            g_print ("  %12.3lf  %*sPROBE %s()\n",
+                     (time - begin_time) / 1000.0,
+                     (gint)stack->len * 2, "",
+                     name);
+          break;
+
+        default:
+          break;
+        }
+    }
+}
+
+static void
+summary_free (gpointer data)
+{
+  g_slice_free (Summary, data);
+}
+
+gint
+main (gint   argc,
+      gchar *argv[])
+{
+  g_autoptr(GOptionContext) context = NULL;
+  g_autoptr(GMappedFile) mapped = NULL;
+  g_autoptr(GBytes) bytes = NULL;
+  g_autoptr(GVariant) variant = NULL;
+  g_autoptr(GVariant) threads = NULL;
+  g_autoptr(GHashTable) summaries = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autofree const gchar **names = NULL;
+  GVariantIter iter;
+  GVariant *records;
+  gint64 begin_time;
+  gsize n_names;
+  gint thread;
+
+  context = g_option_context_new ("TRACE_FILE - dump a libide trace");
+  g_option_context_add_main_entries (context, entries, NULL);
+
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      return EXIT_FAILURE;
+    }
+
+  if (argc != 2)
+    {
+      g_printerr ("usage: %s TRACE_FILE\n", argv [0]);
+      return EXIT_FAILURE;
+    }
+
+  if (!(mapped = g_mapped_file_new (argv [1], FALSE, &error)))
+    {
+      g_printerr ("%s\n", error->message);
+      return EXIT_FAILURE;
+    }
+
+  bytes = g_mapped_file_get_bytes (mapped);
+  variant = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (IDE_TRACE_VARIANT_TYPE),
+                                                          bytes, FALSE));
+
+  if (!g_variant_is_normal_form (variant))
+    {
+      g_printerr ("%s is not a valid trace file\n", argv [1]);
+      return EXIT_FAILURE;
+    }
+
+  g_variant_get (variant, "(x^a&s@a(ia(xuu)))", &begin_time, &names, &threads);
+  n_names = g_strv_length ((gchar **)names);
+
+  summaries = g_hash_table_new_full (NULL, NULL, NULL, summary_free);
+
+  g_variant_iter_init (&iter, threads);
+
+  while (g_variant_iter_next (&iter, "(i@a(xuu))", &thread, &records))
+    {
+      dump_thread (records, names, n_names, thread, begin_time, summaries);
+      g_variant_unref (records);
+    }
+
+  if (summary)
+    {
+      g_autoptr(GPtrArray) sorted = g_ptr_array_new ();
+      GHashTableIter hiter;
+      gpointer value;
+
+      g_hash_table_iter_init (&hiter, summaries);
+      while (g_hash_table_iter_next (&hiter, NULL, &value))
+        g_ptr_array_add (sorted, value);
+      g_ptr_array_sort (sorted, summary_compare);
+
+      g_print ("%-60s %8s %12s %12s\n", "Function", "Calls", "Total msec", "Max msec");
+
+      for (guint i = 0; i < sorted->len; i++)
+        {
+          const Summary *s = g_ptr_array_index (sorted, i);
+
+          if (s->max / 1000.0 < min_msec)
+            continue;
+
+          g_print ("%-60s %8u %12.3lf %12.3lf\n",
+                   s->func, s->calls, s->total / 1000.0, s->max / 1000.0);
+        }
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -62,17 +62,206 @@ int_parse_with_range (gint        *value,
   return TRUE;
 }
 
+static void
+format_usec (gchar  *str,
+             gsize   len,
+             gint64  usec)
+{
+  if (usec < 0)
+    g_snprintf (str, len, "%s", "-");
+  else if (usec == G_MAXINT64)
+    g_snprintf (str, len, "%s", "inf");
+  else if (usec < 1000)
+    g_snprintf (str, len, "%"G_GINT64_FORMAT"us", usec);
+  else if (usec < G_USEC_PER_SEC)
+    g_snprintf (str, len, "%.1lfms", usec / 1000.0);
+  else
+    g_snprintf (str, len, "%.2lfs", usec / (gdouble)G_USEC_PER_SEC);
+}
+
+static void
+print_histogram (EggHistogram  *histogram,
+                 const guint64 *counts,
+                 gdouble        seconds)
+{
+  gchar p50[16], p90[16], p99[16], max[16];
+  guint64 total = 0;
+  gint last = -1;
+  guint i;
+
+  for (i = 0; i < EGG_HISTOGRAM_N_BUCKETS; i++)
+    {
+      total += counts [i];
+      if (counts [i] != 0)
+        last = i;
+    }
+
+  format_usec (p50, sizeof p50, egg_histogram_percentile (counts, 0.50));
+  format_usec (p90, sizeof p90, egg_histogram_percentile (counts, 0.90));
+  format_usec (p99, sizeof p99, egg_histogram_percentile (counts, 0.99));
+  format_usec (max, sizeof max, last < 0 ? -1 : egg_histogram_get_bucket_limit (last));
+
+  if (seconds > 0)
+    g_print ("%-20s : %-32s : %10"G_GUINT64_FORMAT" : %9.1lf/s : %8s %8s %8s %8s\n",
+             histogram->category, histogram->name, total, total / seconds,
+             p50, p90, p99, max);
+  else
+    g_print ("%-20s : %-32s : %10"G_GUINT64_FORMAT" : %8s %8s %8s %8s\n",
+             histogram->category, histogram->name, total,
+             p50, p90, p99, max);
+}
+
+static void
+foreach_histogram_cb (EggHistogram *histogram,
+                      gpointer      user_data)
+{
+  guint *n_histograms = user_data;
+  guint64 counts [EGG_HISTOGRAM_N_BUCKETS];
+
+  (*n_histograms)++;
+
+  egg_histogram_get (histogram, counts);
+  print_histogram (histogram, counts, 0);
+}
+
+typedef struct
+{
+  GHashTable *previous;
+  gdouble     seconds;
+} Watch;
+
+static void
+watch_counter_cb (EggCounter *counter,
+                  gpointer    user_data)
+{
+  Watch *watch = user_data;
+  gint64 *previous;
+  gint64 value;
+
+  value = egg_counter_get (counter);
+
+  if (NULL == (previous = g_hash_table_lookup (watch->previous, counter)))
+    {
+      previous = g_new0 (gint64, 1);
+      *previous = value;
+      g_hash_table_insert (watch->previous, counter, previous);
+    }
+
+  /* Only show counters that are moving to keep the output readable */
+  if (watch->seconds > 0 && value != *previous)
+    g_print ("%-20s : %-32s : %20"G_GINT64_FORMAT" : %+12.1lf/s\n",
+             counter->category,
+             counter->name,
+             value,
+             (value - *previous) / watch->seconds);
+
+  *previous = value;
+}
+
+static void
+watch_histogram_cb (EggHistogram *histogram,
+                    gpointer      user_data)
+{
+  Watch *watch = user_data;
+  guint64 counts [EGG_HISTOGRAM_N_BUCKETS];
+  guint64 delta [EGG_HISTOGRAM_N_BUCKETS];
+  guint64 *previous;
+  gboolean changed = FALSE;
+  guint i;
+
+  egg_histogram_get (histogram, counts);
+
+  if (NULL == (previous = g_hash_table_lookup (watch->previous, histogram)))
+    {
+      previous = g_memdup (counts, sizeof counts);
+      g_hash_table_insert (watch->previous, histogram, previous);
+    }
+
+  for (i = 0; i < EGG_HISTOGRAM_N_BUCKETS; i++)
+    {
+      /* Counters are not exact, so never let a bucket go negative */
+      delta [i] = counts [i] > previous [i] ? counts [i] - previous [i] : 0;
+      changed |= delta [i] != 0;
+    }
+
+  if (watch->seconds > 0 && changed)
+    print_histogram (histogram, delta, watch->seconds);
+
+  memcpy (previous, counts, sizeof counts);
+}
+
+static void
+watch_arena (EggCounterArena *arena,
+             guint            interval)
+{
+  Watch watch = { 0 };
+
+  watch.previous = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+
+  /* Take the initial snapshot */
+  egg_counter_arena_foreach (arena, watch_counter_cb, &watch);
+  egg_counter_arena_foreach_histogram (arena, watch_histogram_cb, &watch);
+
+  for (;;)
+    {
+      g_autoptr(GDateTime) now = NULL;
+      g_autofree gchar *timestr = NULL;
+      gint64 begin = g_get_monotonic_time ();
+
+      g_usleep (interval * G_USEC_PER_SEC);
+
+      watch.seconds = (g_get_monotonic_time () - begin) / (gdouble)G_USEC_PER_SEC;
+
+      now = g_date_time_new_now_local ();
+      timestr = g_date_time_format (now, "%H:%M:%S");
+
+      g_print ("\n%s (%.1lf seconds)\n", timestr, watch.seconds);
+      g_print ("%-20s : %-32s : %10s : %11s : %8s %8s %8s %8s\n",
+               "Category", "Histogram", "Count", "Rate", "p50", "p90", "p99", "max");
+      egg_counter_arena_foreach_histogram (arena, watch_histogram_cb, &watch);
+      g_print ("%-20s : %-32s : %20s : %14s\n",
+               "Category", "Counter", "Value", "Rate");
+      egg_counter_arena_foreach (arena, watch_counter_cb, &watch);
+    }
+}
+
+static void
+usage (const gchar *prgname)
+{
+  fprintf (stderr, "usage: %s [--watch [SECONDS]] <pid>\n", prgname);
+}
+
 gint
 main (gint   argc,
       gchar *argv[])
 {
   EggCounterArena *arena;
+  const gchar *prgname = argv [0];
   guint n_counters = 0;
+  guint n_histograms = 0;
+  gint interval = 0;
   gint pid;
 
+  if (argc > 1 && (g_str_equal (argv [1], "--watch") || g_str_equal (argv [1], "-w")))
+    {
+      interval = 1;
+
+      if (argc == 4)
+        {
+          if (!int_parse_with_range (&interval, 1, 3600, argv [2]))
+            {
+              usage (prgname);
+              return EXIT_FAILURE;
+            }
+          argv++, argc--;
+        }
+
+      argv++, argc--;
+    }
+
   if (argc != 2)
     {
-      fprintf (stderr, "usage: %s <pid>\n", argv [0]);
+      usage (prgname);
       return EXIT_FAILURE;
     }
 
@@ -81,7 +270,7 @@ main (gint   argc,
 
   if (!int_parse_with_range (&pid, 1, G_MAXUSHORT, argv [1]))
     {
-      fprintf (stderr, "usage: %s <pid>\n", argv [0]);
+      usage (prgname);
       return EXIT_FAILURE;
     }
 
@@ -93,6 +282,12 @@ main (gint   argc,
       return EXIT_FAILURE;
     }
 
+  if (interval > 0)
+    {
+      watch_arena (arena, interval);
+      return EXIT_SUCCESS;
+    }
+
   g_print ("%-20s : %-32s : %20s : %-72s\n",
            "      Category",
            "             Name", "Value", "Description");
@@ -107,5 +302,10 @@ main (gint   argc,
            "------------------------------------------------------------------------\n");
   g_print ("Discovered %u counters\n", n_counters);
 
+  g_print ("\n%-20s : %-32s : %10s : %8s %8s %8s %8s\n",
+           "      Category", "             Name", "Count", "p50", "p90", "p99", "max");
+  egg_counter_arena_foreach_histogram (arena, foreach_histogram_cb, &n_histograms);
+  g_print ("Discovered %u histograms\n", n_histograms);
+
   return EXIT_SUCCESS;
 }